@@ -0,0 +1,12 @@
+#ifndef ALLOC_COUNT_H
+#define ALLOC_COUNT_H
+
+#include <glib.h>
+
+/**
+ * Process-wide count of malloc/calloc/realloc calls, GLib's included.  Linking
+ * alloc_count.c into a bench interposes the glibc allocator entry points.
+ */
+guint64 alloc_count_get(void);
+
+#endif
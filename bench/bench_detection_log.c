@@ -0,0 +1,148 @@
+/*
+ * Write-failure check for DetectionLog: caps the file size with RLIMIT_FSIZE so
+ * every segment eventually fails a write part way through a batch, then opens
+ * each segment left behind with the reader and verifies every frame in it.
+ * Exits non-zero when a segment is unreadable or a frame does not match what
+ * was appended, or when frames go missing without being counted as lost.
+ *
+ * usage: bench_detection_log [frames] [records/frame] [file_limit_kb] [batch_frames] [output_dir]
+ */
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <glib.h>
+
+#include "bench_util.h"
+#include "detection_log.h"
+#include "detection_log_reader.h"
+
+static void fill_frame(DetectionFrame *frame, guint frame_num, guint records)
+{
+    frame->frame_num = frame_num;
+    frame->source_id = frame_num % 4;
+    frame->n_records = records;
+    for (guint i = 0; i < records; i++) {
+        DetectionRecord *rec = &frame->records[i];
+        rec->left         = (gfloat)i;
+        rec->top          = (gfloat)frame_num;
+        rec->width        = 10.0f;
+        rec->height       = 5.0f;
+        rec->object_id    = (guint64)frame_num * 100 + i;
+        rec->kind         = DETECTION_KIND_PLATE;
+        rec->component_id = 4;
+        g_snprintf(rec->text, sizeof(rec->text), "F%06uR%02u", frame_num, i);
+    }
+}
+
+/* Zero-padded segment names sort in segment order. */
+static gint cmp_path(gconstpointer a, gconstpointer b)
+{
+    return g_strcmp0(*(const gchar *const *)a, *(const gchar *const *)b);
+}
+
+/* Number of bad frames in the segment; *read counts the frames it holds. */
+static guint check_segment(const char *path, guint records, gint64 *last, guint64 *read)
+{
+    DetLogSegment *seg = detlog_segment_open(path);
+    if (!seg) {
+        fprintf(stderr, "%s: unreadable\n", path);
+        return 1;
+    }
+    guint bad = 0;
+    size_t n = detlog_segment_frame_count(seg);
+    for (size_t i = 0; i < n; i++) {
+        DetLogFrame f;
+        detlog_segment_frame_at(seg, i, &f);
+        gboolean ok = f.frame_num > *last && f.source_id == f.frame_num % 4 &&
+                      f.n_records == records;
+        for (guint r = 0; ok && r < f.n_records; r++) {
+            gchar want[32];
+            g_snprintf(want, sizeof(want), "F%06uR%02u", (guint)f.frame_num, r);
+            ok = f.records[r].object_id == (guint64)f.frame_num * 100 + r &&
+                 strcmp(detlog_record_text(seg, &f.records[r]), want) == 0;
+        }
+        if (!ok) {
+            fprintf(stderr, "%s: frame %zu (frame_num %" G_GINT64_FORMAT ") does not match\n",
+                    path, i, f.frame_num);
+            bad++;
+        }
+        *last = f.frame_num;
+    }
+    *read += n;
+    detlog_segment_close(seg);
+    return bad;
+}
+
+int main(int argc, char **argv)
+{
+    guint frames       = bench_arg_uint(argc, argv, 1, 20000);
+    guint records      = MIN(bench_arg_uint(argc, argv, 2, 8), (guint)DETECTION_MAX_RECORDS_PER_FRAME);
+    guint limit_kb     = bench_arg_uint(argc, argv, 3, 256);
+    guint batch_frames = MAX(bench_arg_uint(argc, argv, 4, 37), 1u);
+    const char *dir    = argc > 5 ? argv[5] : "/tmp/traffic-guard-bench-detlog";
+
+    if (g_mkdir_with_parents(dir, 0755) != 0) {
+        fprintf(stderr, "cannot create %s\n", dir);
+        return 1;
+    }
+    /* Writes past the cap fail with EFBIG instead of killing the process. */
+    signal(SIGXFSZ, SIG_IGN);
+    struct rlimit lim = { .rlim_cur = (rlim_t)limit_kb << 10, .rlim_max = RLIM_INFINITY };
+    if (setrlimit(RLIMIT_FSIZE, &lim) != 0) {
+        perror("setrlimit");
+        return 1;
+    }
+
+    /* Segments are sealed well past the cap, so each one ends in a failed write. */
+    DetectionLog *log = detection_log_new(dir, (guint64)limit_kb << 12);
+    if (!log)
+        return 1;
+
+    DetectionFrame *frame = g_new0(DetectionFrame, 1);
+    guint64 t0 = bench_now_ns();
+    for (guint i = 1; i <= frames; i++) {
+        fill_frame(frame, i, records);
+        detection_log_append(log, frame);
+        if (i % batch_frames == 0)
+            detection_log_sync(log);
+    }
+    detection_log_sync(log);
+    guint64 lost = detection_log_get_lost(log);
+    detection_log_free(log);
+    guint64 elapsed = bench_now_ns() - t0;
+    g_free(frame);
+
+    lim.rlim_cur = RLIM_INFINITY;
+    setrlimit(RLIMIT_FSIZE, &lim);
+
+    GPtrArray *paths = g_ptr_array_new_with_free_func(g_free);
+    GDir *d = g_dir_open(dir, 0, NULL);
+    const gchar *name;
+    while (d && (name = g_dir_read_name(d)))
+        if (g_str_has_suffix(name, ".tgdl"))
+            g_ptr_array_add(paths, g_build_filename(dir, name, NULL));
+    if (d)
+        g_dir_close(d);
+    g_ptr_array_sort(paths, cmp_path);
+
+    guint   bad  = 0;
+    guint64 read = 0;
+    gint64  last = 0;
+    for (guint i = 0; i < paths->len; i++)
+        bad += check_segment(g_ptr_array_index(paths, i), records, &last, &read);
+
+    printf("frames=%u records/frame=%u file_limit=%ukB batch=%u\n",
+           frames, records, limit_kb, batch_frames);
+    printf("log: %u segments, %" G_GUINT64_FORMAT " frames read, %" G_GUINT64_FORMAT " lost, "
+           "%u bad (%.1f ms)\n",
+           paths->len, read, lost, bad, (double)elapsed / 1e6);
+    g_ptr_array_unref(paths);
+
+    if (bad || read + lost != frames) {
+        fprintf(stderr, "FAIL: %" G_GUINT64_FORMAT " read + %" G_GUINT64_FORMAT " lost != %u frames\n",
+                read, lost, frames);
+        return 1;
+    }
+    return 0;
+}
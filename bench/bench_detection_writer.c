@@ -0,0 +1,107 @@
+/*
+ * CPU benchmark for DetectionWriter: pushes synthetic frame records through the
+ * ring and reports producer cost per frame, writer throughput and drops.
+ *
+ * usage: bench_detection_writer [frames] [records/frame] [queue_frames] [flush_ms] [fps] [binary] [output_dir]
+ *        fps 0 pushes as fast as possible; binary 1 writes .tgdl segments instead of detections.txt.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+
+#include "bench_util.h"
+#include "detection_writer.h"
+
+/* Records are generated once; the timed loop only copies them, as the probe does. */
+static void build_template(DetectionFrame *frame, guint records)
+{
+    frame->source_id = 0;
+    frame->n_records = MIN(records, (guint)DETECTION_MAX_RECORDS_PER_FRAME);
+    for (guint i = 0; i < frame->n_records; i++) {
+        DetectionRecord *rec = &frame->records[i];
+        rec->left         = (gfloat)((i * 37) % 1800);
+        rec->top          = (gfloat)((i * 53) % 1000);
+        rec->width        = 120.5f;
+        rec->height       = 80.25f;
+        rec->object_id    = i;
+        rec->kind         = (i % 3 == 2) ? DETECTION_KIND_PLATE : DETECTION_KIND_CAR;
+        rec->component_id = rec->kind == DETECTION_KIND_PLATE ? 4 : 1;
+        g_snprintf(rec->text, sizeof(rec->text), "ABC%04u", (guint)(i * 13 % 10000));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    guint frames       = bench_arg_uint(argc, argv, 1, 100000);
+    guint records      = bench_arg_uint(argc, argv, 2, 20);
+    guint queue_frames = bench_arg_uint(argc, argv, 3, 1024);
+    guint flush_ms     = bench_arg_uint(argc, argv, 4, 250);
+    guint fps          = bench_arg_uint(argc, argv, 5, 0);
+    guint binary       = bench_arg_uint(argc, argv, 6, 0);
+    const char *dir    = argc > 7 ? argv[7] : "/tmp/traffic-guard-bench";
+
+    if (g_mkdir_with_parents(dir, 0755) != 0) {
+        fprintf(stderr, "cannot create %s\n", dir);
+        return 1;
+    }
+    DetectionWriterOptions options = {
+        .format            = binary ? DETECTION_FORMAT_BINARY : DETECTION_FORMAT_TEXT,
+        .queue_frames      = queue_frames,
+        .flush_interval_ms = flush_ms,
+        .segment_bytes     = 64u << 20,
+    };
+    DetectionWriter *writer = detection_writer_new(dir, &options);
+    if (!writer)
+        return 1;
+
+    DetectionFrame *tmpl = g_new0(DetectionFrame, 1);
+    build_template(tmpl, records);
+
+    guint64 *samples = g_new(guint64, frames);
+    guint64  period  = fps ? 1000000000ull / fps : 0;
+    guint64  start   = bench_now_ns();
+
+    for (guint i = 0; i < frames; i++) {
+        if (period) {
+            while (bench_now_ns() - start < (guint64)i * period)
+                ;
+        }
+        guint64 t0 = bench_now_ns();
+        DetectionFrame *frame = detection_writer_begin_frame(writer);
+        if (frame) {
+            frame->frame_num = i + 1;
+            frame->source_id = tmpl->source_id;
+            frame->n_records = tmpl->n_records;
+            memcpy(frame->records, tmpl->records,
+                   tmpl->n_records * sizeof(DetectionRecord));
+            detection_writer_commit_frame(writer);
+        }
+        samples[i] = bench_now_ns() - t0;
+    }
+    guint64 produced = bench_now_ns();
+    detection_writer_flush(writer);
+    guint64 done = bench_now_ns();
+
+    guint64 written = detection_writer_get_written(writer);
+    guint64 dropped = detection_writer_get_dropped(writer);
+    guint64 sum = 0;
+    for (guint i = 0; i < frames; i++)
+        sum += samples[i];
+
+    printf("frames=%u records/frame=%u queue=%u flush=%ums fps=%u format=%s\n",
+           frames, records, queue_frames, flush_ms, fps, binary ? "binary" : "text");
+    printf("producer: mean %.0f ns/frame  p50 %" G_GUINT64_FORMAT " ns  p99 %" G_GUINT64_FORMAT " ns\n",
+           frames ? (double)sum / frames : 0.0,
+           bench_percentile(samples, frames, 50.0),
+           bench_percentile(samples, frames, 99.0));
+    printf("writer:   %" G_GUINT64_FORMAT " written, %" G_GUINT64_FORMAT " dropped, "
+           "%.0f frames/s end to end (drain tail %.1f ms)\n",
+           written, dropped,
+           (double)written * 1e9 / (double)(done - start),
+           (double)(done - produced) / 1e6);
+
+    g_free(samples);
+    g_free(tmpl);
+    detection_writer_free(writer);
+    return 0;
+}
@@ -0,0 +1,330 @@
+/*
+ * Benchmark for the native detection evaluator (deteval) on a synthetic COCO
+ * set: cars with a plate in most, detections jittered, missed, misread and
+ * invented, for two sources in one detections.txt and as legacy
+ * frame_NNNNNN.txt files for source 0.
+ *
+ * Checks, reported per run and reflected in the exit status:
+ *   - every thread count gives what one thread gives;
+ *   - detections.txt and the per-frame files give the same result;
+ *   - with a python interpreter given, the --output JSON equals
+ *     compute_detection_metrics.py's byte for byte, for both layouts.
+ *
+ * usage: bench_deteval [images] [threads] [python] [script]
+ *        script defaults to scripts/metrics/compute_detection_metrics.py, from the repo root.
+ */
+#include <locale.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "bench_util.h"
+#include "detection_eval.h"
+
+#define SOURCE_W 3840
+#define SOURCE_H 2160
+
+static gboolean check(gboolean cond, const gchar *what)
+{
+    if (!cond)
+        printf("  FAILED: %s\n", what);
+    return cond;
+}
+
+static void remove_dir(const gchar *dir)
+{
+    GDir *d = g_dir_open(dir, 0, NULL);
+    const gchar *name;
+    while (d && (name = g_dir_read_name(d)) != NULL) {
+        gchar *path = g_build_filename(dir, name, NULL);
+        if (g_file_test(path, G_FILE_TEST_IS_DIR))
+            remove_dir(path);
+        else
+            g_unlink(path);
+        g_free(path);
+    }
+    if (d)
+        g_dir_close(d);
+    g_rmdir(dir);
+}
+
+/* Ground-truth plate text, including the cases the metrics treat specially. */
+static const gchar *plate_text(GRand *rng, gchar *buf, gsize len)
+{
+    static const gchar alphabet[] = "ABCEHKMOPTXY0123456789";
+    guint r = g_rand_int_range(rng, 0, 100);
+    if (r < 3)
+        return NULL;
+    if (r < 5)
+        return "";
+    if (r < 7)
+        return "-";
+    if (r < 9)
+        return "ab 12  cd";
+    if (r < 10)
+        return "ÄÖ 77";
+    gint n = g_rand_int_range(rng, 5, 10);
+    for (gint i = 0; i < n && i + 1 < (gint)len; i++)
+        buf[i] = alphabet[g_rand_int_range(rng, 0, sizeof(alphabet) - 1)];
+    buf[MIN(n, (gint)len - 1)] = '\0';
+    return buf;
+}
+
+/* What LPR read: mostly right, sometimes a character off, short, lower case or nothing. */
+static void misread(GRand *rng, const gchar *truth, GString *out)
+{
+    guint r = g_rand_int_range(rng, 0, 100);
+    if (!truth || r < 5) {
+        g_string_append(out, r % 2 ? "" : " -");
+        return;
+    }
+    gsize start = out->len;
+    g_string_append_printf(out, " %s", truth);
+    gsize n = out->len - start - 1;
+    if (!g_str_is_ascii(truth))
+        return;   /* kept valid UTF-8: the script cannot read anything else */
+    if (n > 0 && r < 30)
+        out->str[start + 1 + g_rand_int_range(rng, 0, (gint)n)] = 'Q';
+    else if (n > 1 && r < 40)
+        g_string_truncate(out, out->len - 1);
+    else if (r < 50)
+        for (gsize i = start; i < out->len; i++)
+            out->str[i] = g_ascii_tolower(out->str[i]);
+}
+
+typedef struct {
+    gdouble x, y, w, h;
+    const gchar *text;
+    gboolean has_plate;
+} Car;
+
+static void write_set(const gchar *dir, guint images, GRand *rng)
+{
+    GString *coco = g_string_new("{\"info\": {\"description\": \"bench \\\"deteval\\\"\"}, \"images\": [");
+    GString *anns = g_string_new("");
+    GString *log  = g_string_new("car 1 2 3 4 before any header\n");
+    gchar *frames_dir = g_build_filename(dir, "frames", NULL);
+    gchar *log_dir    = g_build_filename(dir, "log", NULL);
+    g_mkdir(frames_dir, 0755);
+    g_mkdir(log_dir, 0755);
+
+    guint ann_id = 1;
+    gchar text_buf[16][16];
+    for (guint i = 0; i < images; i++) {
+        gboolean small = i % 10 == 9;
+        gdouble gw = small ? 1920 : SOURCE_W, gh = small ? 1080 : SOURCE_H;
+        if (i % 50 == 49)
+            g_string_append_printf(coco, "%s{\"id\": %u, \"file_name\": \"still_%u.png\", \"width\": %u, \"height\": %u}",
+                                   i ? ", " : "", i + 1, i, (guint)gw, (guint)gh);
+        else
+            g_string_append_printf(coco, "%s{\"id\": %u, \"file_name\": \"frame_%06u.png\", \"width\": %s, \"height\": %s}",
+                                   i ? ", " : "", i + 1, i, small ? "1920.0" : "3840", small ? "1080.0" : "2160");
+
+        Car cars[16];
+        guint n_cars = (guint)g_rand_int_range(rng, 0, 9);
+        for (guint c = 0; c < n_cars; c++) {
+            Car *car = &cars[c];
+            car->x = g_rand_int_range(rng, 0, (gint)gw - 420) + (c % 3 == 0 ? 0.5 : 0.0);
+            car->y = g_rand_int_range(rng, 0, (gint)gh - 320);
+            car->w = g_rand_int_range(rng, 40, 400);
+            car->h = g_rand_int_range(rng, 40, 300);
+            car->has_plate = g_rand_int_range(rng, 0, 100) < 80;
+            car->text = car->has_plate ? plate_text(rng, text_buf[c], sizeof(text_buf[c])) : NULL;
+            g_string_append_printf(anns, "%s{\"id\": %u, \"image_id\": %u, \"category_id\": 1, \"bbox\": [%g, %g, %g, %g]}",
+                                   anns->len ? ", " : "", ann_id++, i + 1, car->x, car->y, car->w, car->h);
+            if (!car->has_plate)
+                continue;
+            gdouble pw = car->w / 4, ph = car->h / 6;
+            g_string_append_printf(anns, ", {\"id\": %u, \"image_id\": %u, \"category_id\": 2, "
+                                   "\"bbox\": [%.17g, %.17g, %.17g, %.17g], \"attributes\": {\"occluded\": false",
+                                   ann_id++, i + 1, car->x + car->w / 2 - pw / 2, car->y + car->h * 0.7, pw, ph);
+            if (car->text)
+                g_string_append_printf(anns, ", \"value\": \"%s\"}}", car->text);
+            else
+                g_string_append(anns, ", \"value\": null}}");
+        }
+        if (i % 7 == 0)
+            g_string_append_printf(anns, ", {\"id\": %u, \"image_id\": %u, \"category_id\": 3, \"bbox\": [1, 2, 3, 4]}",
+                                   ann_id++, i + 1);
+
+        GString *lines = g_string_new("");
+        gdouble sx = gw / 1920, sy = gh / 1080;
+        for (guint c = 0; c < n_cars; c++) {
+            const Car *car = &cars[c];
+            if (g_rand_int_range(rng, 0, 100) < 15)
+                continue;
+            gdouble jx = g_rand_double_range(rng, -8, 8), jy = g_rand_double_range(rng, -8, 8);
+            g_string_append_printf(lines, "car %.1f %.1f %.2f %.2f", (car->x + jx) / sx, (car->y + jy) / sy,
+                                   (car->w - jx) / sx, (car->h + jy) / sy);
+            misread(rng, car->text, lines);
+            g_string_append_c(lines, '\n');
+            if (car->has_plate && g_rand_int_range(rng, 0, 100) < 70) {
+                gdouble pw = car->w / 4, ph = car->h / 6;
+                g_string_append_printf(lines, "plate %.1f %.1f %.1f %.1f -\n", (car->x + car->w / 2 - pw / 2) / sx,
+                                       (car->y + car->h * 0.7) / sy, pw / sx, ph / sy);
+            }
+        }
+        for (gint k = g_rand_int_range(rng, 0, 3); k > 0; k--)
+            g_string_append_printf(lines, "%s %.1f %.1f %.1f %.1f\n", k % 2 ? "car" : "PLATE",
+                                   g_rand_double_range(rng, 0, 1800), g_rand_double_range(rng, 0, 1000),
+                                   g_rand_double_range(rng, 10, 200), g_rand_double_range(rng, 10, 100));
+        if (i % 31 == 0)
+            g_string_append(lines, "car 1 2 x 4 malformed\n");
+
+        gchar *name = g_strdup_printf("frame_%06u.txt", i + 1);
+        gchar *path = g_build_filename(frames_dir, name, NULL);
+        g_file_set_contents(path, lines->str, (gssize)lines->len, NULL);
+        g_free(path);
+        g_free(name);
+
+        /* Now and then a frame's lines are split by another source's header, or end in CRLF. */
+        if (i % 40 == 0) {
+            gsize half = lines->len / 2;
+            while (half > 0 && lines->str[half - 1] != '\n')
+                half--;
+            g_string_append_printf(log, "frame %u 0\n%.*s", i + 1, (int)half, lines->str);
+            g_string_append_printf(log, "frame %u 1\ncar 1 1 1 1 other source\n", i + 1);
+            g_string_append_printf(log, "frame %u\n%s", i + 1, lines->str + half);
+        } else if (i % 15 == 0) {
+            gchar **split = g_strsplit(lines->str, "\n", -1);
+            gchar *crlf = g_strjoinv("\r\n", split);
+            g_string_append_printf(log, "frame %u 0\r\n%s", i + 1, crlf);
+            g_free(crlf);
+            g_strfreev(split);
+        } else {
+            g_string_append_printf(log, "frame %u 0\n%s", i + 1, lines->str);
+        }
+        if (i % 3 == 0)
+            g_string_append_printf(log, "frame %u 1\n%s", i + 1, lines->str);
+        g_string_free(lines, TRUE);
+    }
+    g_string_append_printf(coco, "], \"annotations\": [%s], \"categories\": [{\"id\": 1, \"name\": \"car\"}, "
+                           "{\"id\": 2, \"name\": \"license_plate\"}, {\"id\": 3, \"name\": \"person\"}]}", anns->str);
+
+    gchar *path = g_build_filename(dir, "instances.json", NULL);
+    g_file_set_contents(path, coco->str, (gssize)coco->len, NULL);
+    g_free(path);
+    path = g_build_filename(log_dir, "detections.txt", NULL);
+    g_file_set_contents(path, log->str, (gssize)log->len, NULL);
+    printf("  %u images, COCO %.1f MB, detections.txt %.1f MB\n", images, coco->len / 1e6, log->len / 1e6);
+    g_free(path);
+    g_free(frames_dir);
+    g_free(log_dir);
+    g_string_free(coco, TRUE);
+    g_string_free(anns, TRUE);
+    g_string_free(log, TRUE);
+}
+
+static gboolean same_result(const DetEvalResult *a, const DetEvalResult *b)
+{
+    return memcmp(&a->car, &b->car, sizeof(a->car)) == 0 &&
+           memcmp(&a->plate, &b->plate, sizeof(a->plate)) == 0 &&
+           a->lpr_exact == b->lpr_exact && a->lpr_total == b->lpr_total &&
+           a->lpr_cer_sum == b->lpr_cer_sum && a->frames == b->frames;
+}
+
+static gboolean evaluate(const gchar *coco, const gchar *dir, const gchar *layout, guint threads,
+                         DetEvalResult *out)
+{
+    DetEvalOptions options;
+    deteval_options_init(&options);
+    options.threads = threads;
+    char err[512];
+    guint64 t0 = bench_now_ns();
+    if (deteval_run(coco, dir, &options, out, err, sizeof(err)) != 0) {
+        printf("  FAILED: %s\n", err);
+        return FALSE;
+    }
+    gdouble s = (bench_now_ns() - t0) / 1e9;
+    printf("  %-6s %2u threads: %7.3f s, %9.0f images/s\n", layout, threads, s, out->frames / s);
+    return TRUE;
+}
+
+/* Runs the script on dir and compares its --output with ours. */
+static gboolean compare_script(const gchar *python, const gchar *script, const gchar *coco,
+                               const gchar *dir, const gchar *layout, const DetEvalResult *result)
+{
+    gchar *py_json = g_build_filename(dir, "summary_py.json", NULL);
+    gchar *c_json  = g_build_filename(dir, "summary_c.json", NULL);
+    const gchar *argv[] = { python, script, "--coco", coco, "--detections-dir", dir,
+                            "--output", py_json, NULL };
+    gint status = -1;
+    GError *error = NULL;
+    guint64 t0 = bench_now_ns();
+    gboolean ran = g_spawn_sync(NULL, (gchar **)argv, NULL, G_SPAWN_SEARCH_PATH | G_SPAWN_STDOUT_TO_DEV_NULL,
+                                NULL, NULL, NULL, NULL, &status, &error);
+    gdouble s = (bench_now_ns() - t0) / 1e9;
+    if (!ran) {
+        printf("  FAILED: %s: %s\n", python, error->message);
+        g_error_free(error);
+        g_free(py_json);
+        g_free(c_json);
+        return FALSE;
+    }
+    printf("  %-6s python:     %7.3f s, %9.0f images/s\n", layout, s, result->frames / s);
+
+    FILE *fp = fopen(c_json, "w");
+    if (fp) {
+        deteval_write_json(result, fp);
+        fclose(fp);
+    }
+    gchar *want = NULL, *got = NULL;
+    gsize want_len = 0, got_len = 0;
+    gboolean same = g_spawn_check_wait_status(status, NULL) &&
+                    g_file_get_contents(py_json, &want, &want_len, NULL) &&
+                    g_file_get_contents(c_json, &got, &got_len, NULL) &&
+                    want_len == got_len && memcmp(want, got, want_len) == 0;
+    if (!same && want && got)
+        printf("  script:\n%s\n  deteval:\n%s\n", want, got);
+    g_free(want);
+    g_free(got);
+    g_free(py_json);
+    g_free(c_json);
+    return check(same, "summary JSON equals compute_detection_metrics.py's");
+}
+
+int main(int argc, char **argv)
+{
+    guint images        = MAX(bench_arg_uint(argc, argv, 1, 20000), 1);
+    guint threads       = MAX(bench_arg_uint(argc, argv, 2, g_get_num_processors()), 1);
+    const gchar *python = argc > 3 ? argv[3] : NULL;
+    const gchar *script = argc > 4 ? argv[4] : "scripts/metrics/compute_detection_metrics.py";
+
+    if (!setlocale(LC_CTYPE, "C.UTF-8"))
+        setlocale(LC_CTYPE, "");
+
+    gchar *dir = g_dir_make_tmp("bench-deteval-XXXXXX", NULL);
+    GRand *rng = g_rand_new_with_seed(1234);
+    write_set(dir, images, rng);
+    g_rand_free(rng);
+
+    gchar *coco       = g_build_filename(dir, "instances.json", NULL);
+    gchar *log_dir    = g_build_filename(dir, "log", NULL);
+    gchar *frames_dir = g_build_filename(dir, "frames", NULL);
+
+    DetEvalResult one, many, frames;
+    gboolean ok = evaluate(coco, log_dir, "log", 1, &one) &&
+                  evaluate(coco, log_dir, "log", threads, &many) &&
+                  evaluate(coco, frames_dir, "frames", threads, &frames);
+    if (ok) {
+        ok &= check(same_result(&one, &many), "same result on every thread count");
+        ok &= check(same_result(&many, &frames), "same result from detections.txt and frame files");
+        printf("  cars TP/FP/FN %" G_GUINT64_FORMAT "/%" G_GUINT64_FORMAT "/%" G_GUINT64_FORMAT
+               ", plates %" G_GUINT64_FORMAT "/%" G_GUINT64_FORMAT "/%" G_GUINT64_FORMAT
+               ", LPR %" G_GUINT64_FORMAT " of %" G_GUINT64_FORMAT " exact\n",
+               many.car.tp, many.car.fp, many.car.fn, many.plate.tp, many.plate.fp, many.plate.fn,
+               many.lpr_exact, many.lpr_total);
+    }
+    if (ok && python) {
+        ok &= compare_script(python, script, coco, log_dir, "log", &many);
+        ok &= compare_script(python, script, coco, frames_dir, "frames", &frames);
+    }
+
+    remove_dir(dir);
+    g_free(coco);
+    g_free(log_dir);
+    g_free(frames_dir);
+    g_free(dir);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,335 @@
+/*
+ * CPU benchmark and self-check of the broker event journal and its replay.
+ *
+ *   append/read   append ns per event, then every event read back in order
+ *   crash         a child appends, consumes and syncs part, appends more and
+ *                 exits without closing; the parent reopens and must find
+ *                 exactly the unconsumed events.  A torn last record is then
+ *                 forged and must be cut on the next open.
+ *   quota         ten times the quota is appended: the oldest events go,
+ *                 disk use stays within the quota, nothing else is lost
+ *   outage        a producer sends live at a fixed rate to a fake broker that
+ *                 goes away for a while, spilling meanwhile; every event must
+ *                 arrive, the spilled ones in order and no faster than the
+ *                 replay rate
+ *
+ * usage: bench_event_journal [events] [payload_bytes] [replay_rate]
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "bench_util.h"
+#include "event_journal.h"
+#include "event_spool.h"
+
+#define SEGMENT_BYTES (256u << 10)
+
+static gboolean check(gboolean cond, const gchar *what)
+{
+    if (!cond)
+        printf("  FAILED: %s\n", what);
+    return cond;
+}
+
+static gsize make_payload(guint8 *buf, gsize len, guint64 n)
+{
+    memcpy(buf, &n, sizeof(n));
+    for (gsize i = sizeof(n); i < len; i++)
+        buf[i] = (guint8)(n * 31 + i);
+    return len;
+}
+
+static gboolean payload_is(const GByteArray *rec, gsize len, guint64 n)
+{
+    guint8 expect[4096];
+    make_payload(expect, len, n);
+    return rec->len == len && memcmp(rec->data, expect, len) == 0;
+}
+
+static void remove_dir(const gchar *dir)
+{
+    GDir *d = g_dir_open(dir, 0, NULL);
+    const gchar *name;
+    while (d && (name = g_dir_read_name(d)) != NULL) {
+        gchar *path = g_build_filename(dir, name, NULL);
+        g_unlink(path);
+        g_free(path);
+    }
+    if (d)
+        g_dir_close(d);
+    g_rmdir(dir);
+}
+
+static guint64 dir_bytes(const gchar *dir)
+{
+    guint64 total = 0;
+    GDir *d = g_dir_open(dir, 0, NULL);
+    const gchar *name;
+    while (d && (name = g_dir_read_name(d)) != NULL) {
+        gchar *path = g_build_filename(dir, name, NULL);
+        GStatBuf st;
+        if (g_stat(path, &st) == 0)
+            total += (guint64)st.st_size;
+        g_free(path);
+    }
+    if (d)
+        g_dir_close(d);
+    return total;
+}
+
+/* Reads everything left, checking that event numbers run on from first; returns how many. */
+static guint64 drain(EventJournal *journal, gsize len, guint64 first, gboolean *in_order)
+{
+    GByteArray *rec = g_byte_array_new();
+    guint64 seq, n = 0;
+    while (event_journal_read(journal, rec, &seq)) {
+        *in_order &= payload_is(rec, len, first + n);
+        event_journal_consume(journal, seq);
+        n++;
+    }
+    g_byte_array_free(rec, TRUE);
+    return n;
+}
+
+static gboolean bench_append_read(const gchar *dir, guint events, gsize len)
+{
+    EventJournalOptions options = { .segment_bytes = SEGMENT_BYTES * 16, .quota_bytes = G_MAXUINT64 };
+    EventJournal *journal = event_journal_open(dir, &options);
+    guint8 buf[4096];
+
+    guint64 t0 = bench_now_ns();
+    for (guint i = 0; i < events; i++)
+        event_journal_append(journal, buf, make_payload(buf, len, i));
+    guint64 t1 = bench_now_ns();
+    gboolean in_order = TRUE;
+    guint64 read = drain(journal, len, 0, &in_order);
+    guint64 t2 = bench_now_ns();
+    event_journal_free(journal);
+
+    printf("  append %.0f ns/event, read+consume %.0f ns/event, %u events of %zu bytes\n",
+           (gdouble)(t1 - t0) / events, (gdouble)(t2 - t1) / events, events, len);
+    gboolean ok = check(read == events && in_order, "every event read back in order");
+    ok &= check(dir_bytes(dir) <= SEGMENT_BYTES * 16 + 4096, "consumed segments deleted");
+    remove_dir(dir);
+    return ok;
+}
+
+static gboolean bench_crash(const gchar *dir, gsize len)
+{
+    const guint first = 3000, consumed = 1000, second = 2000;
+    EventJournalOptions options = { .segment_bytes = SEGMENT_BYTES, .quota_bytes = G_MAXUINT64 };
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        EventJournal *journal = event_journal_open(dir, &options);
+        guint8 buf[4096];
+        GByteArray *rec = g_byte_array_new();
+        guint64 seq;
+        for (guint i = 0; i < first; i++)
+            event_journal_append(journal, buf, make_payload(buf, len, i));
+        for (guint i = 0; i < consumed && event_journal_read(journal, rec, &seq); i++)
+            event_journal_consume(journal, seq);
+        event_journal_sync(journal);
+        for (guint i = 0; i < second; i++)
+            event_journal_append(journal, buf, make_payload(buf, len, first + i));
+        _exit(0);   /* no free, no sync: the mappings are all that is left */
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+
+    EventJournal *journal = event_journal_open(dir, &options);
+    EventJournalStats stats;
+    event_journal_get_stats(journal, &stats);
+    gboolean ok = check(stats.recovered == first - consumed + second, "unconsumed events recovered");
+
+    /* Forge a torn write: the last record's payload changes after its CRC. */
+    GByteArray *rec = g_byte_array_new();
+    guint64 seq;
+    for (guint i = 0; i < first - consumed + second - 1 && event_journal_read(journal, rec, &seq); i++)
+        event_journal_consume(journal, seq);
+    event_journal_free(journal);
+    g_byte_array_free(rec, TRUE);
+
+    gchar *last = NULL;
+    GDir *d = g_dir_open(dir, 0, NULL);
+    const gchar *name;
+    while ((name = g_dir_read_name(d)) != NULL)
+        if (g_str_has_suffix(name, ".tgej") && (!last || g_strcmp0(name, last) > 0)) {
+            g_free(last);
+            last = g_strdup(name);
+        }
+    g_dir_close(d);
+    gchar *path = g_build_filename(dir, last, NULL);
+    gchar *data = NULL;
+    gsize size = 0;
+    g_file_get_contents(path, &data, &size, NULL);
+    /* The last record ends where the zero fill starts. */
+    gsize end = size;
+    while (end > 0 && data[end - 1] == 0)
+        end--;
+    if (end > 0)
+        data[end - 1] ^= 0x5A;
+    g_file_set_contents(path, data, (gssize)size, NULL);
+    g_free(data);
+    g_free(path);
+    g_free(last);
+
+    journal = event_journal_open(dir, &options);
+    event_journal_get_stats(journal, &stats);
+    ok &= check(stats.recovered == 0, "a torn last record is cut");
+    guint8 buf[4096];
+    event_journal_append(journal, buf, make_payload(buf, len, 42));
+    event_journal_free(journal);
+    journal = event_journal_open(dir, &options);
+    gboolean in_order = TRUE;
+    ok &= check(drain(journal, len, 42, &in_order) == 1 && in_order, "appends go on after a cut");
+    event_journal_free(journal);
+
+    printf("  crash: %u appended, %u consumed and synced, %u more appended before exit: %"
+           G_GUINT64_FORMAT " recovered\n", first, consumed, second, (guint64)first - consumed + second);
+    remove_dir(dir);
+    return ok;
+}
+
+static gboolean bench_quota(const gchar *dir, gsize len)
+{
+    EventJournalOptions options = { .segment_bytes = SEGMENT_BYTES, .quota_bytes = 4 * SEGMENT_BYTES };
+    EventJournal *journal = event_journal_open(dir, &options);
+    guint8 buf[4096];
+    guint events = (guint)(10 * options.quota_bytes / (len + 24));
+    for (guint i = 0; i < events; i++)
+        event_journal_append(journal, buf, make_payload(buf, len, i));
+
+    EventJournalStats stats;
+    event_journal_get_stats(journal, &stats);
+    guint64 bytes = dir_bytes(dir);
+    gboolean in_order = TRUE;
+    guint64 read = drain(journal, len, stats.dropped, &in_order);
+    event_journal_free(journal);
+
+    printf("  quota %" G_GUINT64_FORMAT " KiB: %u appended, %" G_GUINT64_FORMAT " dropped, %"
+           G_GUINT64_FORMAT " kept in %" G_GUINT64_FORMAT " KiB\n", options.quota_bytes >> 10,
+           events, stats.dropped, read, bytes >> 10);
+    gboolean ok = check(stats.dropped > 0 && stats.dropped + read == events, "only the oldest dropped");
+    ok &= check(in_order, "kept events in order");
+    ok &= check(bytes <= options.quota_bytes + 4096, "disk use within the quota");
+    remove_dir(dir);
+    return ok;
+}
+
+typedef struct {
+    atomic_bool reachable;
+    GMutex      lock;
+    GArray     *received;   /* event numbers in arrival order */
+    GArray     *replay_ns;  /* arrival times of replayed events */
+    gsize       len;
+} FakeBroker;
+
+static gboolean fake_connect(gpointer data)
+{
+    return atomic_load(&((FakeBroker *)data)->reachable);
+}
+
+static gboolean fake_receive(FakeBroker *broker, const guint8 *payload, gsize len, gboolean replayed)
+{
+    if (!atomic_load(&broker->reachable) || len != broker->len)
+        return FALSE;
+    guint64 n, now = bench_now_ns();
+    memcpy(&n, payload, sizeof(n));
+    g_mutex_lock(&broker->lock);
+    g_array_append_val(broker->received, n);
+    if (replayed)
+        g_array_append_val(broker->replay_ns, now);
+    g_mutex_unlock(&broker->lock);
+    return TRUE;
+}
+
+static gboolean fake_send(const guint8 *payload, gsize len, gpointer data)
+{
+    return fake_receive(data, payload, len, TRUE);
+}
+
+static gboolean bench_outage(const gchar *dir, gsize len, guint replay_rate)
+{
+    const guint live_rate = 2000, run_ms = 1500, down_from_ms = 300, down_until_ms = 800;
+    FakeBroker broker = { .len = len };
+    atomic_init(&broker.reachable, TRUE);
+    g_mutex_init(&broker.lock);
+    broker.received  = g_array_new(FALSE, FALSE, sizeof(guint64));
+    broker.replay_ns = g_array_new(FALSE, FALSE, sizeof(guint64));
+
+    EventJournalOptions journal_options = { .segment_bytes = SEGMENT_BYTES, .quota_bytes = G_MAXUINT64 };
+    EventSpoolOptions options = { .replay_rate = replay_rate, .retry_ms = 50, .sync_ms = 100 };
+    EventSpool *spool = event_spool_new(event_journal_open(dir, &journal_options), &options,
+                                        fake_connect, fake_send, &broker, NULL);
+
+    /* Live traffic the way msg_shed routes it: to the broker while the spool sees it up. */
+    guint8 buf[4096];
+    guint events = live_rate * run_ms / 1000, spilled = 0;
+    guint64 t0 = bench_now_ns();
+    for (guint i = 0; i < events; i++) {
+        guint64 due = t0 + (guint64)i * 1000000000ull / live_rate;
+        while (bench_now_ns() < due)
+            g_usleep(100);
+        guint64 ms = (bench_now_ns() - t0) / 1000000;
+        atomic_store(&broker.reachable, ms < down_from_ms || ms >= down_until_ms);
+        make_payload(buf, len, i);
+        if (!event_spool_broker_up(spool) || !fake_receive(&broker, buf, len, FALSE)) {
+            event_spool_spill(spool, buf, len);
+            spilled++;
+        }
+    }
+    EventSpoolStats stats;
+    for (guint waited = 0; waited < 30000; waited += 10) {
+        event_spool_get_stats(spool, &stats);
+        if (stats.journal.pending == 0)
+            break;
+        g_usleep(10 * 1000);
+    }
+    event_spool_free(spool);
+
+    /* Every event once; the spilled ones in their own order. */
+    GHashTable *seen = g_hash_table_new(g_int64_hash, g_int64_equal);
+    gboolean once = TRUE;
+    for (guint i = 0; i < broker.received->len; i++)
+        once &= g_hash_table_add(seen, &g_array_index(broker.received, guint64, i));
+    guint64 replayed = broker.replay_ns->len;
+    gdouble replay_s = replayed > 1 ? (g_array_index(broker.replay_ns, guint64, replayed - 1) -
+                                       g_array_index(broker.replay_ns, guint64, 0)) / 1e9 : 0.0;
+    gdouble rate = replay_s > 0 ? (replayed - 1) / replay_s : 0.0;
+
+    printf("  outage %u..%u ms of %u ms at %u events/s: %u spilled, %" G_GUINT64_FORMAT
+           " replayed at %.0f/s (limit %u)\n", down_from_ms, down_until_ms, run_ms, live_rate,
+           spilled, replayed, rate, replay_rate);
+    gboolean ok = check(spilled > 0 && replayed == spilled, "every spilled event replayed");
+    ok &= check(once && g_hash_table_size(seen) == events, "every event delivered exactly once");
+    ok &= check(rate <= replay_rate * 1.2, "replay within its rate");
+
+    g_hash_table_destroy(seen);
+    g_array_free(broker.received, TRUE);
+    g_array_free(broker.replay_ns, TRUE);
+    g_mutex_clear(&broker.lock);
+    remove_dir(dir);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    guint events      = MAX(bench_arg_uint(argc, argv, 1, 200000), 1);
+    gsize len         = CLAMP(bench_arg_uint(argc, argv, 2, 160), sizeof(guint64), 4096);
+    guint replay_rate = MAX(bench_arg_uint(argc, argv, 3, 2000), 1);
+
+    gchar *dir = g_dir_make_tmp("bench-event-journal-XXXXXX", NULL);
+    gboolean ok = bench_append_read(dir, events, len);
+    ok &= bench_crash(dir, len);
+    ok &= bench_quota(dir, len);
+    ok &= bench_outage(dir, len, replay_rate);
+    g_rmdir(dir);
+    g_free(dir);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,216 @@
+/*
+ * CPU benchmark for the fused metadata stage: compares the per-probe list walks
+ * that probe_send and probe_write_detections used to do (including the nested
+ * plate search per car) with one FrameIndex build plus the same lookups.
+ * Both paths fold what they read into a checksum; a mismatch is reported and
+ * fails the run, so the bench doubles as a parity check.
+ *
+ * usage: bench_frame_index [iterations] [batch_size] [plate_pct] [label_cardinality]
+ */
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+
+#include "bench_util.h"
+#include "synthetic_meta.h"
+#include "frame_index.h"
+
+static inline guint64 mix(guint64 acc, guint64 v)
+{
+    return (acc ^ v) * 0x100000001b3ull;
+}
+
+static guint64 mix_str(guint64 acc, const gchar *s)
+{
+    if (!s)
+        return mix(acc, 0x9e37);
+    for (; *s; s++)
+        acc = mix(acc, (guchar)*s);
+    return acc;
+}
+
+/* ---- legacy: replica of the walks the two probes did before the stage ---- */
+
+static const gchar *legacy_plate_text(NvDsObjectMeta *plate_obj)
+{
+    for (GList *l_class = plate_obj->classifier_meta_list; l_class; l_class = l_class->next) {
+        NvDsClassifierMeta *cm = (NvDsClassifierMeta *)l_class->data;
+        if (cm->unique_component_id != GIE_ID_PLATE_READER)
+            continue;
+        for (GList *l_label = cm->label_info_list; l_label; l_label = l_label->next)
+            return ((NvDsLabelInfo *)l_label->data)->result_label;
+        return "-";
+    }
+    return NULL;
+}
+
+static const gchar *legacy_plate_for_car(NvDsFrameMeta *frame_meta, NvDsObjectMeta *car)
+{
+    for (GList *l_obj = frame_meta->obj_meta_list; l_obj; l_obj = l_obj->next) {
+        NvDsObjectMeta *obj = (NvDsObjectMeta *)l_obj->data;
+        if (obj->unique_component_id != GIE_ID_PLATE_DETECTOR || obj->object_id != car->object_id)
+            continue;
+        const gchar *text = legacy_plate_text(obj);
+        return text ? text : "-";
+    }
+    return NULL;
+}
+
+static guint64 legacy_frame(NvDsFrameMeta *frame_meta)
+{
+    guint64 acc = 0;
+
+    /* probe_send */
+    for (GList *l_obj = frame_meta->obj_meta_list; l_obj; l_obj = l_obj->next) {
+        NvDsObjectMeta *obj = (NvDsObjectMeta *)l_obj->data;
+        if (obj->class_id != 0)
+            continue;
+        if (obj->unique_component_id != GIE_ID_VEHICLE_DETECTOR &&
+            obj->unique_component_id != GIE_ID_PLATE_DETECTOR)
+            continue;
+        gchar *brand = NULL, *type = NULL, *plate = NULL;
+        for (GList *l_class = obj->classifier_meta_list; l_class; l_class = l_class->next) {
+            NvDsClassifierMeta *cm = (NvDsClassifierMeta *)l_class->data;
+            for (GList *l_label = cm->label_info_list; l_label; l_label = l_label->next) {
+                NvDsLabelInfo *li = (NvDsLabelInfo *)l_label->data;
+                switch (cm->unique_component_id) {
+                case GIE_ID_VEHICLE_MAKE:  brand = g_strdup(li->result_label); break;
+                case GIE_ID_VEHICLE_TYPE:  type  = g_strdup(li->result_label); break;
+                case GIE_ID_PLATE_READER:  plate = g_strdup(li->result_label); break;
+                default: break;
+                }
+            }
+        }
+        acc = mix(acc, obj->object_id);
+        acc = mix_str(mix_str(mix_str(acc, brand), type), plate);
+        g_free(brand);
+        g_free(type);
+        g_free(plate);
+    }
+
+    /* probe_write_detections */
+    for (GList *l_obj = frame_meta->obj_meta_list; l_obj; l_obj = l_obj->next) {
+        NvDsObjectMeta *obj = (NvDsObjectMeta *)l_obj->data;
+        if (obj->class_id != 0 || obj->unique_component_id != GIE_ID_VEHICLE_DETECTOR)
+            continue;
+        const gchar *text = legacy_plate_for_car(frame_meta, obj);
+        acc = mix_str(mix(acc, obj->object_id), (text && text[0]) ? text : "-");
+    }
+    for (GList *l_obj = frame_meta->obj_meta_list; l_obj; l_obj = l_obj->next) {
+        NvDsObjectMeta *obj = (NvDsObjectMeta *)l_obj->data;
+        if (obj->class_id != 0 || obj->unique_component_id != GIE_ID_PLATE_DETECTOR)
+            continue;
+        const gchar *text = legacy_plate_text(obj);
+        acc = mix_str(mix(acc, obj->object_id), (text && text[0]) ? text : "-");
+    }
+    return acc;
+}
+
+/* ---- fused: one build, consumers read buckets and the id hash ---- */
+
+static guint64 fused_frame(FrameIndex *index, NvDsBatchMeta *batch_meta, NvDsFrameMeta *frame_meta)
+{
+    guint64 acc = 0;
+    frame_index_build(index, batch_meta, frame_meta);
+
+    /* Same order as the legacy list walk: plates are appended after every car. */
+    static const gint components[] = { GIE_ID_VEHICLE_DETECTOR, GIE_ID_PLATE_DETECTOR };
+    for (guint c = 0; c < G_N_ELEMENTS(components); c++) {
+        const FrameIndexBucket *bucket = frame_index_bucket(index, components[c]);
+        for (guint i = 0; i < bucket->n; i++) {
+            const FrameIndexObject *e = &bucket->items[i];
+            if (e->obj->class_id != 0)
+                continue;
+            acc = mix(acc, e->obj->object_id);
+            acc = mix_str(mix_str(mix_str(acc, e->brand), e->type), e->plate);
+        }
+    }
+
+    const FrameIndexBucket *cars = frame_index_bucket(index, GIE_ID_VEHICLE_DETECTOR);
+    for (guint i = 0; i < cars->n; i++) {
+        NvDsObjectMeta *obj = cars->items[i].obj;
+        if (obj->class_id != 0)
+            continue;
+        const FrameIndexObject *plate = frame_index_find_plate(index, obj->object_id);
+        const gchar *text = plate ? plate->plate : NULL;
+        acc = mix_str(mix(acc, obj->object_id), (text && text[0]) ? text : "-");
+    }
+    const FrameIndexBucket *plates = frame_index_bucket(index, GIE_ID_PLATE_DETECTOR);
+    for (guint i = 0; i < plates->n; i++) {
+        const gchar *text = plates->items[i].plate;
+        if (plates->items[i].obj->class_id != 0)
+            continue;
+        acc = mix_str(mix(acc, plates->items[i].obj->object_id), (text && text[0]) ? text : "-");
+    }
+    return acc;
+}
+
+static gboolean run_case(guint objects, guint iterations, guint batch_size,
+                         gdouble plate_ratio, guint cardinality)
+{
+    SyntheticMetaParams params = {
+        .batch_size        = batch_size,
+        .objects_per_frame = objects,
+        .plate_ratio       = plate_ratio,
+        .label_cardinality = cardinality,
+        .seed              = 1234 + objects,
+    };
+    NvDsBatchMeta *batch_meta = synthetic_meta_new(&params);
+    FrameIndex *index = frame_index_new();
+
+    guint64 *legacy_ns = g_new(guint64, iterations);
+    guint64 *fused_ns  = g_new(guint64, iterations);
+    guint64 legacy_sum = 0, fused_sum = 0;
+    guint64 legacy_total = 0, fused_total = 0;
+
+    for (guint it = 0; it < iterations; it++) {
+        guint64 t0 = bench_now_ns();
+        for (GList *l = batch_meta->frame_meta_list; l; l = l->next)
+            legacy_sum += legacy_frame((NvDsFrameMeta *)l->data);
+        guint64 t1 = bench_now_ns();
+        for (GList *l = batch_meta->frame_meta_list; l; l = l->next)
+            fused_sum += fused_frame(index, batch_meta, (NvDsFrameMeta *)l->data);
+        guint64 t2 = bench_now_ns();
+
+        legacy_ns[it] = (t1 - t0) / batch_size;
+        fused_ns[it]  = (t2 - t1) / batch_size;
+        legacy_total += t1 - t0;
+        fused_total  += t2 - t1;
+    }
+
+    gdouble legacy_mean = (gdouble)legacy_total / ((gdouble)iterations * batch_size);
+    gdouble fused_mean  = (gdouble)fused_total / ((gdouble)iterations * batch_size);
+    printf("%6u objects  legacy %10.0f ns/frame (p50 %8" G_GUINT64_FORMAT " p99 %8" G_GUINT64_FORMAT ")"
+           "  fused %8.0f ns/frame (p50 %6" G_GUINT64_FORMAT " p99 %6" G_GUINT64_FORMAT ")  x%.1f%s\n",
+           objects,
+           legacy_mean, bench_percentile(legacy_ns, iterations, 50), bench_percentile(legacy_ns, iterations, 99),
+           fused_mean, bench_percentile(fused_ns, iterations, 50), bench_percentile(fused_ns, iterations, 99),
+           legacy_mean / MAX(fused_mean, 1.0),
+           legacy_sum == fused_sum ? "" : "  PARITY MISMATCH");
+
+    g_free(legacy_ns);
+    g_free(fused_ns);
+    frame_index_free(index);
+    nvds_destroy_batch_meta(batch_meta);
+    return legacy_sum == fused_sum;
+}
+
+int main(int argc, char **argv)
+{
+    guint iterations  = bench_arg_uint(argc, argv, 1, 2000);
+    guint batch_size  = MAX(bench_arg_uint(argc, argv, 2, 4), 1);
+    guint plate_pct   = MIN(bench_arg_uint(argc, argv, 3, 60), 100);
+    guint cardinality = bench_arg_uint(argc, argv, 4, 20);
+
+    static const guint object_counts[] = { 10, 100, 1000 };
+    gboolean ok = TRUE;
+
+    printf("iterations=%u batch=%u plates=%u%% labels=%u\n",
+           iterations, batch_size, plate_pct, cardinality);
+    for (guint i = 0; i < G_N_ELEMENTS(object_counts); i++) {
+        /* The legacy plate search is quadratic; keep the large case bounded in time. */
+        guint iters = object_counts[i] >= 1000 ? MAX(iterations / 20, 1) : iterations;
+        ok &= run_case(object_counts[i], iters, batch_size, plate_pct / 100.0, cardinality);
+    }
+    return ok ? 0 : 1;
+}
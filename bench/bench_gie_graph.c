@@ -0,0 +1,278 @@
+/*
+ * Self-check for the GIE topology and the fan-in metadata merge, plus the
+ * merge cost per batch.
+ *
+ * Graph checks load small app YAMLs: the default chain, a parallel layout,
+ * a disabled node bridged over, and the rejected shapes.  The merge check
+ * splits a synthetic batch into what two parallel branches would see behind
+ * a tracker, make on one and type plus plates on the other, folds the second
+ * into the first and compares the result with the unsplit batch.
+ *
+ * usage: bench_gie_graph [sources] [objects_per_frame] [iterations]
+ */
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "bench_util.h"
+#include "synthetic_meta.h"
+#include "frame_index.h"
+#include "gie_graph.h"
+#include "meta_merge.h"
+
+static gboolean check(gboolean cond, const gchar *what)
+{
+    if (!cond)
+        printf("  FAILED: %s\n", what);
+    return cond;
+}
+
+static GieGraph *load(const gchar *dir, const gchar *yaml)
+{
+    gchar *path = g_build_filename(dir, "app.yml", NULL);
+    g_file_set_contents(path, yaml, -1, NULL);
+    GieGraph *graph = gie_graph_load(path);
+    g_unlink(path);
+    g_free(path);
+    return graph;
+}
+
+static gboolean is_node(const GieGraph *graph, guint i, const gchar *name)
+{
+    return i < graph->n_nodes && g_strcmp0(graph->nodes[i].name, name) == 0;
+}
+
+static gboolean check_graphs(void)
+{
+    gboolean ok = TRUE;
+    gchar *dir = g_dir_make_tmp("bench-gie-graph-XXXXXX", NULL);
+    guint peers[GIE_GRAPH_MAX_NODES];
+
+    GieGraph *chain = load(dir, "primary-gie:\n  plugin-type: 0\n");
+    ok &= check(chain && chain->n_nodes == 6 && chain->n_edges == 5, "default chain has 6 nodes");
+    if (chain) {
+        ok &= check(is_node(chain, 0, "primary-inference") && is_node(chain, 1, "tracker") &&
+                    is_node(chain, 5, "secondary-inference-4") &&
+                    chain->nodes[1].type == GIE_NODE_TRACKER, "default chain order");
+        ok &= check(g_strcmp0(gie_graph_exit_name(chain), "secondary-inference-4") == 0,
+                    "default chain exit");
+    }
+    gie_graph_free(chain);
+
+    GieGraph *parallel = load(dir,
+        "gie-graph:\n"
+        "  nodes:\n"
+        "    - { name: primary-inference, config: primary-gie }\n"
+        "    - { name: tracker, type: tracker }\n"
+        "    - { name: make, config: secondary-gie1 }\n"
+        "    - { name: type, config: secondary-gie2 }\n"
+        "    - { name: plate, config: secondary-gie3 }\n"
+        "    - { name: reader, config: secondary-gie4 }\n"
+        "  edges:\n"
+        "    - [primary-inference, tracker]\n"
+        "    - [plate, reader]\n"
+        "    - [tracker, make]\n"
+        "    - [make, type]\n"
+        "    - [tracker, plate]\n");
+    ok &= check(parallel != NULL, "parallel graph loads");
+    if (parallel) {
+        gint tracker = gie_graph_find(parallel, "tracker");
+        gint type    = gie_graph_find(parallel, "type");
+        gint reader  = gie_graph_find(parallel, "reader");
+        ok &= check(is_node(parallel, 0, "primary-inference"), "entry first");
+        ok &= check(tracker >= 0 && gie_graph_successors(parallel, tracker, peers) == 2,
+                    "tracker fans out to two branches");
+        ok &= check(gie_graph_exits(parallel, peers) == 2 &&
+                    g_strcmp0(gie_graph_exit_name(parallel), GIE_GRAPH_EXIT_JOIN) == 0,
+                    "two exits meet at the exit join");
+        guint32 common = gie_graph_ancestors(parallel, type) & gie_graph_ancestors(parallel, reader);
+        ok &= check(type >= 0 && reader >= 0 && common == ((1u << 0) | (1u << tracker)),
+                    "branches share only primary-inference and tracker");
+        gboolean sorted = TRUE;
+        for (guint e = 0; e < parallel->n_edges; e++)
+            sorted &= parallel->edges[e].from < parallel->edges[e].to;
+        ok &= check(sorted, "edges point downstream");
+    }
+    gie_graph_free(parallel);
+
+    GieGraph *bridged = load(dir,
+        "gie-graph:\n"
+        "  nodes:\n"
+        "    - { name: a, config: primary-gie }\n"
+        "    - { name: b, config: secondary-gie1, enable: 0 }\n"
+        "    - { name: c, config: secondary-gie2 }\n"
+        "  edges: [[a, b], [b, c]]\n");
+    ok &= check(bridged && bridged->n_nodes == 2 && bridged->n_edges == 1 &&
+                gie_graph_successors(bridged, 0, peers) == 1 && is_node(bridged, peers[0], "c"),
+                "disabled node is bridged");
+    gie_graph_free(bridged);
+
+    GieGraph *cycle = load(dir,
+        "gie-graph:\n"
+        "  nodes: [{ name: a, config: x }, { name: b, config: y }, { name: c, config: z }]\n"
+        "  edges: [[a, b], [b, c], [c, b]]\n");
+    ok &= check(cycle == NULL, "cycle is rejected");
+    gie_graph_free(cycle);
+
+    GieGraph *two_entries = load(dir,
+        "gie-graph:\n"
+        "  nodes: [{ name: a, config: x }, { name: b, config: y }, { name: c, config: z }]\n"
+        "  edges: [[a, c], [b, c]]\n");
+    ok &= check(two_entries == NULL, "two entry nodes are rejected");
+    gie_graph_free(two_entries);
+
+    g_rmdir(dir);
+    g_free(dir);
+    return ok;
+}
+
+static gboolean keeps(const gint *ids, guint n, gint id)
+{
+    for (guint i = 0; i < n; i++)
+        if (ids[i] == id)
+            return TRUE;
+    return FALSE;
+}
+
+/* What a branch sees: objects and classifiers of the listed components only. */
+static NvDsBatchMeta *branch_view(NvDsBatchMeta *ref, const gint *ids, guint n)
+{
+    NvDsBatchMeta *view = nvds_create_batch_meta(ref->num_frames_in_batch);
+    GHashTable *mapped = g_hash_table_new(g_direct_hash, g_direct_equal);
+    for (GList *l = ref->frame_meta_list; l; l = l->next) {
+        NvDsFrameMeta *src = l->data;
+        NvDsFrameMeta *frame = nvds_acquire_frame_meta_from_pool(view);
+        frame->source_id = src->source_id;
+        frame->pad_index = src->pad_index;
+        frame->frame_num = src->frame_num;
+        nvds_add_frame_meta_to_batch(view, frame);
+
+        for (GList *o = src->obj_meta_list; o; o = o->next) {
+            NvDsObjectMeta *src_obj = o->data;
+            if (!keeps(ids, n, src_obj->unique_component_id))
+                continue;
+            NvDsObjectMeta *obj = nvds_acquire_obj_meta_from_pool(view);
+            obj->unique_component_id = src_obj->unique_component_id;
+            obj->object_id           = src_obj->object_id;
+            obj->rect_params         = src_obj->rect_params;
+            NvDsObjectMeta *parent = src_obj->parent ? g_hash_table_lookup(mapped, src_obj->parent) : NULL;
+            nvds_add_obj_meta_to_frame(frame, obj, parent);
+            g_hash_table_insert(mapped, src_obj, obj);
+
+            for (GList *c = src_obj->classifier_meta_list; c; c = c->next) {
+                NvDsClassifierMeta *src_cm = c->data;
+                if (!keeps(ids, n, src_cm->unique_component_id))
+                    continue;
+                NvDsClassifierMeta *cm = nvds_acquire_classifier_meta_from_pool(view);
+                cm->unique_component_id = src_cm->unique_component_id;
+                cm->num_labels = src_cm->num_labels;
+                for (GList *li = src_cm->label_info_list; li; li = li->next) {
+                    NvDsLabelInfo *label = nvds_acquire_label_info_meta_from_pool(view);
+                    g_strlcpy(label->result_label, ((NvDsLabelInfo *)li->data)->result_label,
+                              sizeof(label->result_label));
+                    nvds_add_label_info_meta_to_classifier(cm, label);
+                }
+                nvds_add_classifier_meta_to_object(obj, cm);
+            }
+        }
+    }
+    g_hash_table_destroy(mapped);
+    return view;
+}
+
+static gint compare_lines(gconstpointer a, gconstpointer b)
+{
+    return g_strcmp0(*(const gchar *const *)a, *(const gchar *const *)b);
+}
+
+/* One sorted line per object: component, id, parent id and its labels. */
+static gchar *signature(NvDsBatchMeta *batch)
+{
+    GString *out = g_string_new(NULL);
+    for (GList *l = batch->frame_meta_list; l; l = l->next) {
+        NvDsFrameMeta *frame = l->data;
+        GPtrArray *lines = g_ptr_array_new_with_free_func(g_free);
+        for (GList *o = frame->obj_meta_list; o; o = o->next) {
+            NvDsObjectMeta *obj = o->data;
+            GString *line = g_string_new(NULL);
+            g_string_append_printf(line, "%d:%" G_GUINT64_FORMAT ":%" G_GUINT64_FORMAT,
+                                   obj->unique_component_id, obj->object_id,
+                                   obj->parent ? obj->parent->object_id : 0);
+            for (GList *c = obj->classifier_meta_list; c; c = c->next) {
+                NvDsClassifierMeta *cm = c->data;
+                for (GList *li = cm->label_info_list; li; li = li->next)
+                    g_string_append_printf(line, " %d=%s", cm->unique_component_id,
+                                           ((NvDsLabelInfo *)li->data)->result_label);
+            }
+            g_ptr_array_add(lines, g_string_free(line, FALSE));
+        }
+        g_ptr_array_sort(lines, compare_lines);
+        g_string_append_printf(out, "frame %u/%u\n", frame->source_id, frame->frame_num);
+        for (guint i = 0; i < lines->len; i++)
+            g_string_append_printf(out, "%s\n", (gchar *)g_ptr_array_index(lines, i));
+        g_ptr_array_free(lines, TRUE);
+    }
+    return g_string_free(out, FALSE);
+}
+
+int main(int argc, char **argv)
+{
+    guint n_sources  = MAX(bench_arg_uint(argc, argv, 1, 8), 1);
+    guint objects    = MAX(bench_arg_uint(argc, argv, 2, 16), 1);
+    guint iterations = MAX(bench_arg_uint(argc, argv, 3, 2000), 1);
+    gboolean ok = TRUE;
+
+    printf("graph checks\n");
+    ok &= check_graphs();
+
+    SyntheticMetaParams params = {
+        .batch_size        = n_sources,
+        .objects_per_frame = objects,
+        .plate_ratio       = 0.6,
+        .label_cardinality = 16,
+        .seed              = 7,
+    };
+    NvDsBatchMeta *ref = synthetic_meta_new(&params);
+
+    /* tracker fans out to make and to type -> plate -> reader. */
+    static const gint first[]  = { GIE_ID_VEHICLE_DETECTOR, GIE_ID_VEHICLE_MAKE };
+    static const gint second[] = { GIE_ID_VEHICLE_DETECTOR, GIE_ID_VEHICLE_TYPE,
+                                   GIE_ID_PLATE_DETECTOR, GIE_ID_PLATE_READER };
+    MetaMergeComponents branch = { { GIE_ID_VEHICLE_TYPE, GIE_ID_PLATE_DETECTOR, GIE_ID_PLATE_READER }, 3 };
+    MetaMergeComponents all    = { { GIE_ID_VEHICLE_MAKE, GIE_ID_VEHICLE_TYPE,
+                                     GIE_ID_PLATE_DETECTOR, GIE_ID_PLATE_READER }, 4 };
+
+    printf("merge checks\n");
+    MetaMerge *merge = meta_merge_new();
+    NvDsBatchMeta *from = branch_view(ref, second, G_N_ELEMENTS(second));
+    NvDsBatchMeta *into = branch_view(ref, first, G_N_ELEMENTS(first));
+    guint copied = meta_merge_batch(merge, into, from, &branch, &all);
+    gchar *want = signature(ref);
+    gchar *got  = signature(into);
+    ok &= check(copied > 0, "merge copies the second branch");
+    ok &= check(g_strcmp0(want, got) == 0, "merged batch equals the unsplit batch");
+    ok &= check(meta_merge_batch(merge, into, into, &branch, &all) == 0, "shared batch is left alone");
+    g_free(want);
+    g_free(got);
+    nvds_destroy_batch_meta(into);
+
+    guint64 *samples = g_new(guint64, iterations);
+    for (guint i = 0; i < iterations; i++) {
+        into = branch_view(ref, first, G_N_ELEMENTS(first));
+        guint64 t0 = bench_now_ns();
+        meta_merge_batch(merge, into, from, &branch, &all);
+        samples[i] = bench_now_ns() - t0;
+        nvds_destroy_batch_meta(into);
+    }
+    guint64 p50 = bench_percentile(samples, iterations, 50);
+    guint64 p99 = bench_percentile(samples, iterations, 99);
+    printf("%u sources x %u objects, %u meta copied per batch: merge p50 %.1f us, p99 %.1f us\n",
+           n_sources, objects, copied, p50 / 1000.0, p99 / 1000.0);
+
+    g_free(samples);
+    nvds_destroy_batch_meta(from);
+    nvds_destroy_batch_meta(ref);
+    meta_merge_free(merge);
+    return ok ? 0 : 1;
+}
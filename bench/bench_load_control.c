@@ -0,0 +1,151 @@
+/*
+ * CPU simulation and self-check of the load controller.
+ *
+ * The pipeline is modelled as one server: capacity_fps frames per second at
+ * level 0, and at other levels that divided by the relative cost of a frame
+ * under load_control_settings() (PGIE share scaled by its interval, make and
+ * type off, LPR share scaled by its cadence).  Frames arrive at the camera
+ * rate, the backlog is the queue and latency is backlog over service rate
+ * plus a noisy base.  A traffic spike overloads level 0; the run checks that
+ * the controller bounds latency where an uncontrolled pipeline does not,
+ * comes back to level 0 within three minutes, changes level no more often
+ * than once per down_samples dwell on average, and ignores noise.
+ *
+ * usage: bench_load_control [capacity_fps] [spike_fps] [spike_s]
+ */
+#include <stdio.h>
+#include <glib.h>
+
+#include "bench_util.h"
+#include "load_control.h"
+
+#define TICK_S        0.5
+#define BASE_FPS      30.0
+#define QUEUE_FRAMES  200.0
+
+typedef struct {
+    gdouble peak_latency_ms;
+    gdouble final_latency_ms;
+    guint   peak_level;
+    guint   final_level;
+    guint64 changes;
+    guint64 ticks_per_level[LOAD_LEVEL_COUNT];
+} SimResult;
+
+static gboolean check(gboolean cond, const gchar *what)
+{
+    if (!cond)
+        printf("  FAILED: %s\n", what);
+    return cond;
+}
+
+/* Relative GPU cost of one frame: PGIE 35%, tracker 10%, make+type 30%, LPD 10%, LPR 15%. */
+static gdouble frame_cost(const LoadLevel *level)
+{
+    return 0.35 / (level->pgie_interval + 1) + 0.10 + (level->classify ? 0.30 : 0.0) +
+           0.10 + 0.15 / MAX(level->lpr_every, 1);
+}
+
+static SimResult simulate(const LoadControlOptions *options, gboolean controlled,
+                          gdouble capacity_fps, gdouble spike_fps, gdouble spike_s)
+{
+    SimResult r = { 0 };
+    LoadControl *lc = load_control_new(options);
+    GRand *rand = g_rand_new_with_seed(3);
+    gdouble backlog = 0.0;
+    guint level = 0;
+    const gdouble total_s = 60.0 + spike_s + 180.0;
+
+    for (gdouble t = 0.0; t < total_s; t += TICK_S) {
+        gdouble arrival = (t >= 60.0 && t < 60.0 + spike_s) ? spike_fps : BASE_FPS;
+        gdouble service = capacity_fps / frame_cost(load_control_settings(level));
+        backlog = MAX(backlog + (arrival - service) * TICK_S, 0.0);
+
+        gdouble latency_ms = 80.0 + backlog / service * 1000.0 + g_rand_double_range(rand, -30.0, 30.0);
+        gdouble fill = MIN(backlog / QUEUE_FRAMES, 1.0);
+        if (controlled) {
+            guint next = load_control_update(lc, latency_ms, fill);
+            r.changes += next != level;
+            level = next;
+        }
+        r.peak_latency_ms  = MAX(r.peak_latency_ms, latency_ms);
+        r.peak_level       = MAX(r.peak_level, level);
+        r.ticks_per_level[level]++;
+        r.final_latency_ms = latency_ms;
+    }
+    r.final_level = level;
+    g_rand_free(rand);
+    load_control_free(lc);
+    return r;
+}
+
+/* Feeds a fixed signal; returns the level changes it caused. */
+static guint64 steady(const LoadControlOptions *options, gdouble lo_ms, gdouble hi_ms,
+                      gboolean alternate, guint samples)
+{
+    LoadControl *lc = load_control_new(options);
+    GRand *rand = g_rand_new_with_seed(5);
+    for (guint i = 0; i < samples; i++) {
+        gdouble latency = alternate ? ((i & 1) ? hi_ms : lo_ms) : g_rand_double_range(rand, lo_ms, hi_ms);
+        load_control_update(lc, latency, 0.1);
+    }
+    LoadControlStats stats;
+    load_control_get_stats(lc, &stats);
+    g_rand_free(rand);
+    load_control_free(lc);
+    return stats.steps_up + stats.steps_down;
+}
+
+int main(int argc, char **argv)
+{
+    gdouble capacity = MAX(bench_arg_uint(argc, argv, 1, 40), 1);
+    gdouble spike    = MAX(bench_arg_uint(argc, argv, 2, 70), 1);
+    gdouble spike_s  = MAX(bench_arg_uint(argc, argv, 3, 120), 1);
+    gboolean ok = TRUE;
+
+    LoadControlOptions options = {
+        .high_latency_ms = 1000.0,
+        .low_latency_ms  = 300.0,
+        .high_queue_fill = 0.8,
+        .low_queue_fill  = 0.3,
+        .up_samples      = 3,
+        .down_samples    = 20,
+        .smoothing       = 0.3,
+        .max_level       = LOAD_LEVEL_COUNT - 1,
+    };
+
+    printf("levels (relative frame cost):");
+    for (guint l = 0; l < LOAD_LEVEL_COUNT; l++)
+        printf(" %u=%.2f", l, frame_cost(load_control_settings(l)));
+    printf("\n");
+
+    SimResult open = simulate(&options, FALSE, capacity, spike, spike_s);
+    SimResult ctl  = simulate(&options, TRUE,  capacity, spike, spike_s);
+    printf("capacity %.0f fps, %.0f fps for %.0f s between %.0f fps\n", capacity, spike, spike_s, BASE_FPS);
+    printf("  uncontrolled: peak latency %.1f s\n", open.peak_latency_ms / 1000.0);
+    printf("  controlled:   peak latency %.1f s, peak level %u, %" G_GUINT64_FORMAT
+           " changes, final level %u at %.0f ms\n", ctl.peak_latency_ms / 1000.0, ctl.peak_level,
+           ctl.changes, ctl.final_level, ctl.final_latency_ms);
+    printf("  time per level:");
+    for (guint l = 0; l < LOAD_LEVEL_COUNT; l++)
+        printf(" %u=%.0fs", l, ctl.ticks_per_level[l] * TICK_S);
+    printf("\n");
+
+    if (spike > capacity) {
+        ok &= check(open.peak_latency_ms > 10 * options.high_latency_ms, "uncontrolled latency runs away");
+        ok &= check(ctl.peak_level > 0, "controller sheds under the spike");
+        ok &= check(ctl.peak_latency_ms < open.peak_latency_ms / 4, "controller bounds latency");
+    }
+    ok &= check(ctl.final_level == 0, "controller recovers to level 0");
+    gdouble total_s = 60.0 + spike_s + 180.0;
+    ok &= check(ctl.changes * options.down_samples * TICK_S <= total_s,
+                "on average a down_samples dwell or more between changes");
+
+    guint64 noisy = steady(&options, 350.0, 950.0, FALSE, 2000);
+    guint64 alternating = steady(&options, 100.0, 1400.0, TRUE, 2000);
+    printf("  steady noise between the marks: %" G_GUINT64_FORMAT " changes; alternating 100/1400 ms: %"
+           G_GUINT64_FORMAT " changes\n", noisy, alternating);
+    ok &= check(noisy == 0, "noise between the marks changes nothing");
+    ok &= check(alternating <= 2, "alternating samples do not flap");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+/*
+ * Cost and self-check of the metrics registry, plus an end-to-end run of the
+ * exporter against a pipeline of stock GStreamer elements.
+ *
+ * Times metrics_counter_add from one thread and from several threads on one
+ * shared counter, checks that no increment is lost and that the rendered
+ * text carries every series.  With a port, then runs
+ *   videotestsrc ! queue name=queue1 ! fakesink sync=true
+ * for the given seconds with the exporter and pipeline_metrics_watch on it,
+ * so it can be checked with
+ *   curl http://localhost:<port>/metrics
+ *
+ * usage: bench_metrics [iterations] [threads] [port] [seconds]
+ */
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+#include <gst/gst.h>
+
+#include "bench_util.h"
+#include "metrics.h"
+#include "metrics_server.h"
+#include "pipeline_metrics.h"
+
+typedef struct {
+    MetricsCounter *counter;
+    guint           iterations;
+} Worker;
+
+static gpointer run_worker(gpointer data)
+{
+    const Worker *w = (const Worker *)data;
+    for (guint i = 0; i < w->iterations; i++)
+        metrics_counter_add(w->counter, 1);
+    return NULL;
+}
+
+static gboolean time_adds(guint iterations, guint threads)
+{
+    gchar label[16];
+    g_snprintf(label, sizeof(label), "%u", threads);
+    MetricsCounter *counter = metrics_counter("bench_adds_total", "Adds per run.",
+                                              "threads", label, TRUE);
+    Worker worker = { .counter = counter, .iterations = iterations };
+    GThread **pool = g_new(GThread *, threads);
+
+    guint64 t0 = bench_now_ns();
+    for (guint t = 0; t < threads; t++)
+        pool[t] = g_thread_new("bench-metrics", run_worker, &worker);
+    for (guint t = 0; t < threads; t++)
+        g_thread_join(pool[t]);
+    guint64 elapsed = bench_now_ns() - t0;
+    g_free(pool);
+
+    guint64 expected = (guint64)iterations * threads;
+    guint64 got = metrics_counter_get(counter);
+    printf("  metrics_counter_add, %u thread%s on one counter  %6.2f ns/add (wall)  %s\n",
+           threads, threads == 1 ? " " : "s", (gdouble)elapsed / (gdouble)expected,
+           got == expected ? "ok" : "LOST INCREMENTS");
+    return got == expected;
+}
+
+static gboolean check_render(void)
+{
+    MetricsCounter *dropped = metrics_counter("bench_dropped_total", "Dropped.", NULL, NULL, FALSE);
+    MetricsGauge *level = metrics_gauge("bench_level", "Level.", "queue", "q\"1");
+    metrics_counter_add(dropped, 3);
+    metrics_gauge_set(level, 2.5);
+    metrics_tick(1.0);
+
+    GString *out = g_string_new(NULL);
+    metrics_render(out);
+    static const gchar *expected[] = {
+        "# TYPE bench_dropped_total counter\n",
+        "bench_dropped_total 3\n",
+        "# TYPE bench_level gauge\n",
+        "bench_level{queue=\"q\\\"1\"} 2.5\n",
+        "# TYPE bench_adds_per_second gauge\n",
+    };
+    gboolean ok = TRUE;
+    for (guint i = 0; i < G_N_ELEMENTS(expected); i++) {
+        if (!strstr(out->str, expected[i])) {
+            printf("  render: missing %s", expected[i]);
+            ok = FALSE;
+        }
+    }
+    printf("  render of %" G_GSIZE_FORMAT " bytes  %s\n", out->len, ok ? "ok" : "FAILED");
+    g_string_free(out, TRUE);
+    return ok;
+}
+
+static gboolean quit_loop(gpointer data)
+{
+    g_main_loop_quit((GMainLoop *)data);
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean serve_stock_pipeline(guint port, guint seconds)
+{
+    GError *error = NULL;
+    GstElement *pipeline = gst_parse_launch(
+        "videotestsrc name=source ! video/x-raw,width=320,height=240,framerate=30/1 "
+        "! queue name=queue1 ! fakesink name=sink sync=true", &error);
+    if (!pipeline) {
+        printf("  pipeline: %s\n", error ? error->message : "parse failed");
+        g_clear_error(&error);
+        return FALSE;
+    }
+
+    MetricsServer *server = metrics_server_new((guint16)port);
+    if (!server) {
+        gst_object_unref(pipeline);
+        return FALSE;
+    }
+    pipeline_metrics_watch(server, pipeline);
+
+    printf("  serving for %u s: curl http://localhost:%u/metrics\n", seconds, port);
+    GMainLoop *loop = g_main_loop_new(NULL, FALSE);
+    g_timeout_add_seconds(seconds, quit_loop, loop);
+    gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    g_main_loop_run(loop);
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+
+    GString *out = g_string_new(NULL);
+    metrics_render(out);
+    gboolean ok = strstr(out->str, "traffic_guard_element_buffers_total{element=\"sink\"}") &&
+                  strstr(out->str, "traffic_guard_queue_level_buffers{queue=\"queue1\"}");
+    printf("  stock pipeline series  %s\n", ok ? "ok" : "MISSING");
+    g_string_free(out, TRUE);
+
+    metrics_server_free(server);
+    g_main_loop_unref(loop);
+    gst_object_unref(pipeline);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    guint iterations = MAX(bench_arg_uint(argc, argv, 1, 10000000), 1);
+    guint threads    = MAX(bench_arg_uint(argc, argv, 2, 4), 1);
+    guint port       = bench_arg_uint(argc, argv, 3, 0);
+    guint seconds    = MAX(bench_arg_uint(argc, argv, 4, 30), 1);
+
+    gst_init(&argc, &argv);
+
+    gboolean ok = time_adds(iterations, 1);
+    if (threads > 1)
+        ok &= time_adds(iterations / threads, threads);
+    ok &= check_render();
+    if (port)
+        ok &= serve_stock_pipeline(port, seconds);
+    return ok ? 0 : 1;
+}
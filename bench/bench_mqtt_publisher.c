@@ -0,0 +1,215 @@
+/*
+ * Native MQTT publisher against a live broker, e.g. the one in infra/
+ * (docker compose -f infra/docker-compose.yaml up -d mqtt).  Events are
+ * posted as fast as the queue takes them while a second client subscribed to
+ * the same topic splits the publishes back into events and counts them.
+ *
+ * Reports events/s end to end, events per publish, payload bytes on the wire
+ * per event and publish latency.  Fails below 20000 events/s, and at QoS 1 or
+ * 2 when an event is missing, repeated or out of order.
+ *
+ * usage: bench_mqtt_publisher [host] [port] [events] [payload_bytes] [qos] [deflate]
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <mosquitto.h>
+#include <zlib.h>
+#include <glib.h>
+
+#include "bench_util.h"
+#include "mqtt_publisher.h"
+
+#define MIN_EVENTS_PER_SECOND 20000
+#define BATCH_BYTES           65536
+#define IDLE_TIMEOUT_US       (3 * G_TIME_SPAN_SECOND)
+
+typedef struct {
+    GMutex   lock;
+    gboolean subscribed;
+    gboolean deflate;
+    guint8  *seen;          /* per event number */
+    guint    events;
+    guint    received;
+    guint    repeated;
+    guint    out_of_order;
+    guint    next;
+    guint64  last_ns;
+    guint8  *inflated;
+} Subscriber;
+
+static void on_subscribe(struct mosquitto *mosq, void *obj, int mid, int qos_count, const int *granted_qos)
+{
+    (void)mosq;
+    (void)mid;
+    (void)qos_count;
+    (void)granted_qos;
+    Subscriber *sub = obj;
+    g_mutex_lock(&sub->lock);
+    sub->subscribed = TRUE;
+    g_mutex_unlock(&sub->lock);
+}
+
+static void count_event(Subscriber *sub, const gchar *event, gsize len)
+{
+    if (len < 6 || strncmp(event, "event ", 6) != 0)
+        return;
+    guint n = (guint)strtoul(event + 6, NULL, 10);
+    if (n >= sub->events)
+        return;
+    if (sub->seen[n])
+        sub->repeated++;
+    sub->seen[n] = 1;
+    if (n != sub->next)
+        sub->out_of_order++;
+    sub->next = n + 1;
+    sub->received++;
+}
+
+static void on_message(struct mosquitto *mosq, void *obj, const struct mosquitto_message *message)
+{
+    (void)mosq;
+    Subscriber *sub = obj;
+    const gchar *data = message->payload;
+    gsize len = (gsize)message->payloadlen;
+    if (sub->deflate) {
+        uLongf out = BATCH_BYTES + MQTT_PUBLISHER_EVENT_BYTES;
+        if (uncompress(sub->inflated, &out, message->payload, (uLong)message->payloadlen) != Z_OK)
+            return;
+        data = (const gchar *)sub->inflated;
+        len  = out;
+    }
+
+    g_mutex_lock(&sub->lock);
+    const gchar *end = data + len;
+    while (data < end) {
+        const gchar *nl = memchr(data, '\n', (gsize)(end - data));
+        const gchar *stop = nl ? nl : end;
+        count_event(sub, data, (gsize)(stop - data));
+        data = stop + 1;
+    }
+    sub->last_ns = bench_now_ns();
+    g_mutex_unlock(&sub->lock);
+}
+
+static gboolean check(gboolean cond, const gchar *what)
+{
+    if (!cond)
+        printf("  FAILED: %s\n", what);
+    return cond;
+}
+
+int main(int argc, char **argv)
+{
+    const gchar *host = argc > 1 ? argv[1] : "127.0.0.1";
+    guint port    = bench_arg_uint(argc, argv, 2, 1883);
+    guint events  = MAX(bench_arg_uint(argc, argv, 3, 500000), 1);
+    guint payload = CLAMP(bench_arg_uint(argc, argv, 4, 160), 24, MQTT_PUBLISHER_EVENT_BYTES);
+    guint qos     = MIN(bench_arg_uint(argc, argv, 5, 1), 2);
+    gboolean deflate = bench_arg_uint(argc, argv, 6, 0) != 0;
+
+    gchar *topic = g_strdup_printf("traffic-guard/bench/%d", (int)getpid());
+    mosquitto_lib_init();
+
+    Subscriber sub = { .deflate = deflate, .events = events };
+    g_mutex_init(&sub.lock);
+    sub.seen     = g_malloc0(events);
+    sub.inflated = g_malloc(BATCH_BYTES + MQTT_PUBLISHER_EVENT_BYTES);
+    struct mosquitto *client = mosquitto_new(NULL, true, &sub);
+    mosquitto_subscribe_callback_set(client, on_subscribe);
+    mosquitto_message_callback_set(client, on_message);
+    if (mosquitto_connect(client, host, (int)port, 60) != MOSQ_ERR_SUCCESS ||
+        mosquitto_loop_start(client) != MOSQ_ERR_SUCCESS ||
+        mosquitto_subscribe(client, NULL, topic, (int)qos) != MOSQ_ERR_SUCCESS) {
+        printf("  no broker at %s:%u (docker compose -f infra/docker-compose.yaml up -d mqtt)  FAILED\n",
+               host, port);
+        return 1;
+    }
+
+    MqttPublisherOptions options = {
+        .host         = host,
+        .port         = port,
+        .topic        = topic,
+        .qos          = qos,
+        .keepalive_s  = 60,
+        .queue_events = 16384,
+        .batch_bytes  = BATCH_BYTES,
+        .batch_ms     = 20,
+        .max_inflight = 64,
+        .compression  = deflate ? MQTT_COMPRESSION_DEFLATE : MQTT_COMPRESSION_NONE,
+    };
+    MqttPublisher *publisher = mqtt_publisher_new(&options);
+    gint64 deadline = g_get_monotonic_time() + IDLE_TIMEOUT_US;
+    gboolean ready = FALSE;
+    while (!ready && g_get_monotonic_time() < deadline) {
+        g_mutex_lock(&sub.lock);
+        ready = sub.subscribed && mqtt_publisher_connected(publisher);
+        g_mutex_unlock(&sub.lock);
+        g_usleep(10 * G_TIME_SPAN_MILLISECOND);
+    }
+    if (!ready) {
+        printf("  publisher or subscriber did not connect to %s:%u  FAILED\n", host, port);
+        return 1;
+    }
+
+    gchar event[MQTT_PUBLISHER_EVENT_BYTES];
+    memset(event, 'x', sizeof(event));
+    guint full = 0;
+    guint64 t0 = bench_now_ns();
+    for (guint i = 0; i < events; i++) {
+        gint head = g_snprintf(event, sizeof(event), "event %010u ", i);
+        event[head] = 'x';
+        while (!mqtt_publisher_post(publisher, event, payload)) {
+            full++;
+            g_usleep(100);
+        }
+    }
+    guint64 t_posted = bench_now_ns();
+
+    /* Until everything arrived, or nothing did for a while. */
+    guint received = 0, last = 0;
+    deadline = g_get_monotonic_time() + IDLE_TIMEOUT_US;
+    while (received < events && g_get_monotonic_time() < deadline) {
+        g_usleep(10 * G_TIME_SPAN_MILLISECOND);
+        g_mutex_lock(&sub.lock);
+        received = sub.received;
+        g_mutex_unlock(&sub.lock);
+        if (received != last)
+            deadline = g_get_monotonic_time() + IDLE_TIMEOUT_US;
+        last = received;
+    }
+
+    MqttPublisherStats stats;
+    mqtt_publisher_get_stats(publisher, &stats);
+    mqtt_publisher_free(publisher);
+    mosquitto_disconnect(client);
+    mosquitto_loop_stop(client, false);
+    mosquitto_destroy(client);
+    mosquitto_lib_cleanup();
+
+    g_mutex_lock(&sub.lock);
+    gdouble seconds = (MAX(sub.last_ns, t_posted) - t0) / 1e9;
+    gdouble rate = sub.received / MAX(seconds, 1e-9);
+    printf("%u events of %u bytes to %s:%u at QoS %u%s\n", events, payload, host, port, qos,
+           deflate ? ", deflate" : "");
+    printf("  %.0f events/s end to end, %u received, posting waited on a full queue %u times\n",
+           rate, sub.received, full);
+    printf("  %" G_GUINT64_FORMAT " publishes of %.1f events, %.1f wire bytes per event, "
+           "latency %.2f ms mean %.2f ms max\n",
+           stats.publishes, stats.publishes ? (gdouble)stats.published / stats.publishes : 0.0,
+           stats.published ? (gdouble)stats.bytes / stats.published : 0.0,
+           stats.latency_ms, stats.max_latency_ms);
+
+    gboolean ok = check(rate >= MIN_EVENTS_PER_SECOND, "sustains 20000 events/s");
+    if (qos > 0) {
+        ok &= check(sub.received == events, "every event received");
+        ok &= check(sub.repeated == 0, "no event repeated");
+        ok &= check(sub.out_of_order == 0, "events arrive in order");
+    }
+    g_mutex_unlock(&sub.lock);
+    g_free(sub.seen);
+    g_free(sub.inflated);
+    g_free(topic);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,315 @@
+/*
+ * CPU benchmark for broker event aggregation (ProbeSendContext.blob): one
+ * NvDsUserMeta per vehicle against one blob per frame, for each payload
+ * format, on the same synthetic frames.  probe_send runs through a MetaStage
+ * without tracks, so every vehicle is an event on every frame.  Downstream
+ * is what the broker branch does to each user meta: copy_func, as when the
+ * buffer is made writable, then the release of both.
+ *
+ * Reports send and downstream ns/frame, user metas, payload bytes and
+ * mallocs per frame.  Fails when a frame that fits in max_bytes takes more
+ * than one user meta, when frame blobs do not hold exactly the frame's
+ * per-vehicle messages, when they allocate, or when a window blob exceeds
+ * its max_bytes or loses an event.
+ *
+ * usage: bench_msg_aggregate [iterations] [batch_size] [objects_per_frame] [max_bytes]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+
+#include "nvdsmeta.h"
+#include "nvdsmeta_schema.h"
+
+#include "alloc_count.h"
+#include "bench_util.h"
+#include "synthetic_meta.h"
+#include "meta_stage.h"
+#include "msg_pool.h"
+#include "payload_encoder.h"
+#include "probes/probe_send.h"
+
+#define WARMUP_ITERATIONS 50
+#define WINDOW_MAX_BYTES  2048
+#define JSON_RECORD       "{\"v\":1,\"object_id\":"
+
+static const gchar *formats[] = { "text", "json", "binary" };
+
+typedef enum { MODE_NONE, MODE_FRAME, MODE_WINDOW, N_MODES } Mode;
+
+static const gchar *mode_names[] = { "none", "frame", "window" };
+
+typedef struct {
+    ProbeSendContext ctx;
+    MetaStage       *stage;
+    guint64          send_ns;
+    guint64          downstream_ns;
+    guint64          allocs;
+    guint64          metas;
+    guint64          bytes;
+    guint64          records;
+    gsize            frame_bytes;  /* largest frame of the last step, payloads plus a separator each */
+    GPtrArray       *payloads;   /* GBytes, this frame's, checked iterations only */
+} Run;
+
+static gboolean check(gboolean cond, const gchar *what)
+{
+    if (!cond)
+        printf("  FAILED: %s\n", what);
+    return cond;
+}
+
+static gint compare_bytes(gconstpointer a, gconstpointer b)
+{
+    return g_bytes_compare(*(GBytes *const *)a, *(GBytes *const *)b);
+}
+
+static gboolean add_record(const void *record, gsize len, gpointer user_data)
+{
+    g_ptr_array_add((GPtrArray *)user_data, g_bytes_new(record, len));
+    return TRUE;
+}
+
+/* Appends a blob's records to out; -1 when the blob is malformed or its count is wrong. */
+static gint split_blob(PayloadFormat format, const gchar *data, gsize len, GPtrArray *out)
+{
+    guint before = out->len;
+    gchar *text = g_strndup(data, len);
+    guint count = 0;
+    gboolean ok = TRUE;
+
+    if (format == PAYLOAD_FORMAT_BINARY) {
+        ok = payload_split_binary_blob(data, len, add_record, out);
+        /* The count is the first varint after magic and version. */
+        guint shift = 0;
+        for (gsize i = 2; ok && i < len; i++, shift += 7) {
+            count |= ((guint)data[i] & 0x7f) << shift;
+            if (!((guchar)data[i] & 0x80))
+                break;
+        }
+    } else if (format == PAYLOAD_FORMAT_TEXT) {
+        ok = g_str_has_prefix(text, "Events: ");
+        gchar **lines = g_strsplit(text, "\n", -1);
+        count = (guint)strtoul(text + 8, NULL, 10);
+        for (guint i = 1; ok && lines[i]; i++)
+            add_record(lines[i], strlen(lines[i]), out);
+        g_strfreev(lines);
+    } else {
+        static const gchar head[] = "{\"v\":1,\"count\":";
+        gchar *events = strstr(text, ",\"events\":[");
+        ok = g_str_has_prefix(text, head) && events && g_str_has_suffix(text, "]}");
+        if (ok) {
+            count = (guint)strtoul(text + strlen(head), NULL, 10);
+            /* Quotes inside labels are escaped, so a record can only start here. */
+            const gchar *p = events + strlen(",\"events\":[");
+            const gchar *end = text + len - 2;
+            while (p < end) {
+                const gchar *next = strstr(p + 1, "," JSON_RECORD);
+                if (!next || next > end)
+                    next = end;
+                add_record(p, (gsize)(next - p), out);
+                p = next + 1;
+            }
+        }
+    }
+    g_free(text);
+    return ok && out->len - before == count ? (gint)count : -1;
+}
+
+/* What the broker branch does with each message, timed separately from the send. */
+static void downstream(NvDsFrameMeta *frame_meta, Run *run, gboolean keep)
+{
+    gsize bytes = 0, separators = 0;
+    guint64 t0 = bench_now_ns();
+    for (NvDsUserMetaList *l = frame_meta->frame_user_meta_list; l; l = l->next) {
+        NvDsUserMeta *user_meta = (NvDsUserMeta *)l->data;
+        NvDsCustomMsgInfo *copy = user_meta->base_meta.copy_func(user_meta, NULL);
+        msg_pool_release(copy);
+        run->metas++;
+        bytes += ((NvDsCustomMsgInfo *)user_meta->user_meta_data)->size;
+        separators += 2;
+    }
+    run->downstream_ns += bench_now_ns() - t0;
+    run->bytes      += bytes;
+    run->frame_bytes = MAX(run->frame_bytes, bytes + separators);
+
+    if (keep)
+        for (NvDsUserMetaList *l = frame_meta->frame_user_meta_list; l; l = l->next) {
+            const NvDsCustomMsgInfo *msg = ((NvDsUserMeta *)l->data)->user_meta_data;
+            g_ptr_array_add(run->payloads, g_bytes_new(msg->message, msg->size));
+        }
+    nvds_clear_frame_user_meta_list(frame_meta, frame_meta->frame_user_meta_list);
+}
+
+static void step(NvDsBatchMeta *batch_meta, Run *run, gboolean timed, gboolean keep)
+{
+    guint64 a0 = alloc_count_get();
+    guint64 t0 = bench_now_ns();
+    meta_stage_process(run->stage, batch_meta);
+    guint64 elapsed = bench_now_ns() - t0;
+    if (!timed)
+        return;
+    run->send_ns += elapsed;
+    run->allocs  += alloc_count_get() - a0;
+    run->frame_bytes = 0;
+    for (NvDsMetaList *l = batch_meta->frame_meta_list; l; l = l->next)
+        downstream((NvDsFrameMeta *)l->data, run, keep);
+}
+
+static void clear_frames(NvDsBatchMeta *batch_meta)
+{
+    for (NvDsMetaList *l = batch_meta->frame_meta_list; l; l = l->next) {
+        NvDsFrameMeta *frame_meta = (NvDsFrameMeta *)l->data;
+        if (frame_meta->frame_user_meta_list)
+            nvds_clear_frame_user_meta_list(frame_meta, frame_meta->frame_user_meta_list);
+    }
+}
+
+static void next_frame(NvDsBatchMeta *batch_meta)
+{
+    for (NvDsMetaList *l = batch_meta->frame_meta_list; l; l = l->next)
+        ((NvDsFrameMeta *)l->data)->frame_num++;
+}
+
+int main(int argc, char **argv)
+{
+    guint iterations = MAX(bench_arg_uint(argc, argv, 1, 2000), 1);
+    SyntheticMetaParams params = {
+        .batch_size        = MAX(bench_arg_uint(argc, argv, 2, 4), 1),
+        .objects_per_frame = bench_arg_uint(argc, argv, 3, 40),
+        .plate_ratio       = 0.6,
+        .label_cardinality = 20,
+        .seed              = 7,
+    };
+    gsize max_bytes = MAX(bench_arg_uint(argc, argv, 4, 16384), MSG_POOL_PAYLOAD_BYTES);
+
+    NvDsBatchMeta *batch_meta = synthetic_meta_new(&params);
+    guint frames = MAX(batch_meta->num_frames_in_batch, 1);
+    MsgPool *pool = msg_pool_new(4096);
+    MsgPool *blob_pool = msg_pool_new_full(256, MAX(max_bytes, WINDOW_MAX_BYTES));
+
+    printf("%u iterations, batch %u, %u objects/frame, blobs up to %" G_GSIZE_FORMAT " bytes\n",
+           iterations, params.batch_size, params.objects_per_frame, max_bytes);
+    printf("  %-8s %-6s %12s %14s %12s %12s %14s\n", "format", "mode", "send ns", "downstream ns",
+           "metas/frame", "bytes/frame", "mallocs/frame");
+
+    gboolean ok = TRUE;
+    for (guint f = 0; f < G_N_ELEMENTS(formats); f++) {
+        const PayloadEncoder *encoder = payload_encoder_lookup(formats[f]);
+        Run runs[N_MODES];
+        for (guint m = 0; m < N_MODES; m++) {
+            runs[m] = (Run){
+                .ctx = { .pool = m == MODE_NONE ? pool : blob_pool, .encoder = encoder },
+                .stage = meta_stage_new(),
+                .payloads = g_ptr_array_new_with_free_func((GDestroyNotify)g_bytes_unref),
+            };
+            if (m == MODE_FRAME)
+                runs[m].ctx.blob = payload_blob_new(encoder, max_bytes);
+            if (m == MODE_WINDOW) {
+                runs[m].ctx.blob = payload_blob_new(encoder, WINDOW_MAX_BYTES);
+                runs[m].ctx.blob_window_ms = G_MAXUINT / 2;
+            }
+            meta_stage_add_consumer(runs[m].stage, "send", probe_send, &runs[m].ctx);
+        }
+
+        for (guint i = 0; i < WARMUP_ITERATIONS; i++) {
+            for (guint m = MODE_NONE; m <= MODE_FRAME; m++) {
+                step(batch_meta, &runs[m], FALSE, FALSE);
+                clear_frames(batch_meta);
+            }
+            next_frame(batch_meta);
+        }
+
+        /* Every mode sees the same frames; only the first few are kept and compared. */
+        gboolean one_meta = TRUE, same = TRUE, window_ok = TRUE;
+        guint64 events = 0;
+        for (guint i = 0; i < iterations; i++) {
+            gboolean keep = i < 16;
+            for (guint m = 0; m < N_MODES; m++) {
+                guint64 metas = runs[m].metas;
+                step(batch_meta, &runs[m], TRUE, keep || m == MODE_WINDOW);
+                if (m == MODE_NONE)
+                    events += runs[m].metas - metas;
+                /* A frame larger than a blob takes several; the none run came first on this frame. */
+                if (m == MODE_FRAME && runs[MODE_NONE].frame_bytes + 64 <= max_bytes)
+                    one_meta &= runs[m].metas - metas == frames;
+            }
+
+            if (keep) {
+                GPtrArray *records = g_ptr_array_new_with_free_func((GDestroyNotify)g_bytes_unref);
+                for (guint b = 0; b < runs[MODE_FRAME].payloads->len; b++) {
+                    gsize len;
+                    const gchar *data = g_bytes_get_data(runs[MODE_FRAME].payloads->pdata[b], &len);
+                    same &= split_blob(encoder->format, data, len, records) >= 0;
+                }
+                GPtrArray *messages = runs[MODE_NONE].payloads;
+                g_ptr_array_sort(records, compare_bytes);
+                g_ptr_array_sort(messages, compare_bytes);
+                same &= records->len == messages->len;
+                for (guint r = 0; same && r < records->len; r++)
+                    same &= g_bytes_equal(records->pdata[r], messages->pdata[r]);
+                g_ptr_array_unref(records);
+                g_ptr_array_set_size(messages, 0);
+                g_ptr_array_set_size(runs[MODE_FRAME].payloads, 0);
+            }
+
+            GPtrArray *window = runs[MODE_WINDOW].payloads;
+            GPtrArray *records = g_ptr_array_new_with_free_func((GDestroyNotify)g_bytes_unref);
+            for (guint b = 0; b < window->len; b++) {
+                gsize len;
+                const gchar *data = g_bytes_get_data(window->pdata[b], &len);
+                gint n = split_blob(encoder->format, data, len, records);
+                window_ok &= n > 0 && len <= WINDOW_MAX_BYTES;
+                runs[MODE_WINDOW].records += MAX(n, 0);
+            }
+            g_ptr_array_unref(records);
+            g_ptr_array_set_size(window, 0);
+            next_frame(batch_meta);
+        }
+        /* The window never elapses: the open blob is left, taken as at EOS. */
+        NvDsCustomMsgInfo *last = probe_send_take_blob(&runs[MODE_WINDOW].ctx);
+        if (last) {
+            GPtrArray *records = g_ptr_array_new_with_free_func((GDestroyNotify)g_bytes_unref);
+            gint n = split_blob(encoder->format, last->message, last->size, records);
+            window_ok &= n > 0 && last->size <= WINDOW_MAX_BYTES;
+            runs[MODE_WINDOW].records += MAX(n, 0);
+            g_ptr_array_unref(records);
+            msg_pool_release(last);
+        }
+        window_ok &= payload_blob_count(runs[MODE_WINDOW].ctx.blob) == 0;
+        window_ok &= runs[MODE_WINDOW].records == events;
+
+        for (guint m = 0; m < N_MODES; m++) {
+            const Run *r = &runs[m];
+            gdouble n = (gdouble)iterations * frames;
+            printf("  %-8s %-6s %12.1f %14.1f %12.2f %12.1f %14.3f\n", formats[f], mode_names[m],
+                   r->send_ns / n, r->downstream_ns / n, r->metas / n, r->bytes / n, r->allocs / n);
+        }
+
+        gchar *what = g_strdup_printf("%s: a frame that fits is one user meta", formats[f]);
+        ok &= check(one_meta, what);
+        g_free(what);
+        what = g_strdup_printf("%s: a frame blob holds exactly the frame's messages", formats[f]);
+        ok &= check(same, what);
+        g_free(what);
+        what = g_strdup_printf("%s: frame blobs do not allocate", formats[f]);
+        ok &= check(runs[MODE_FRAME].allocs == 0, what);
+        g_free(what);
+        what = g_strdup_printf("%s: window blobs stay within %u bytes and keep every event",
+                               formats[f], WINDOW_MAX_BYTES);
+        ok &= check(window_ok, what);
+        g_free(what);
+
+        for (guint m = 0; m < N_MODES; m++) {
+            meta_stage_free(runs[m].stage);
+            payload_blob_free(runs[m].ctx.blob);
+            g_ptr_array_unref(runs[m].payloads);
+        }
+    }
+
+    nvds_destroy_batch_meta(batch_meta);
+    msg_pool_free(blob_pool);
+    msg_pool_free(pool);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,192 @@
+/*
+ * Broker stall on the software backend (PIPELINE_BACKEND=software): the whole
+ * application from director_build, with a stand-in broker that sleeps
+ * broker_ms on every batch at the "msg-broker" sink.
+ *
+ * Three runs over the same H.264 stream: a broker that keeps up, a stalled
+ * one behind a blocking queue1 (MSG_QUEUE_LEAKY=no, the old behaviour) and a
+ * stalled one behind the default leaky queue1.  Frames/s are measured at the
+ * render sink.  The bench spreads the attached messages evenly over the three
+ * MsgPriority values so each has samples, and counts per priority what
+ * reaches the broker.  The leaky run must keep most of the unstalled rate
+ * where the blocking one drops to the broker's, and must deliver a larger
+ * share of high priority messages than of low ones.
+ *
+ * usage: bench_msg_branch <h264_file> [broker_ms] [objects_per_frame]
+ */
+#include <stdio.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+
+#include "bench_util.h"
+#include "director.h"
+#include "pipeline_controller.h"
+#include "msg_pool.h"
+#include "gstnvdsmeta.h"
+
+typedef struct {
+    guint   broker_ms;
+    guint   next_priority;
+    guint64 frames;
+    guint64 attached[MSG_PRIORITY_HIGH + 1];
+    guint64 delivered[MSG_PRIORITY_HIGH + 1];
+    gdouble fps;
+} BranchRun;
+
+static void count_messages(NvDsBatchMeta *batch_meta, guint64 *counts, guint *spread)
+{
+    for (GList *l = batch_meta->frame_meta_list; l; l = l->next) {
+        for (GList *u = ((NvDsFrameMeta *)l->data)->frame_user_meta_list; u; u = u->next) {
+            NvDsUserMeta *user_meta = u->data;
+            if (user_meta->base_meta.meta_type != NVDS_CUSTOM_MSG_BLOB)
+                continue;
+            NvDsCustomMsgInfo *msg = user_meta->user_meta_data;
+            if (spread)
+                msg_pool_set_priority(msg, (MsgPriority)((*spread)++ % (MSG_PRIORITY_HIGH + 1)));
+            counts[msg_pool_get_priority(msg)]++;
+        }
+    }
+}
+
+/* After probe_send on the nvosd sink, before the tee. */
+static GstPadProbeReturn spread_priorities(GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+    (void)pad;
+    BranchRun *run = user_data;
+    NvDsBatchMeta *batch_meta = gst_buffer_get_nvds_batch_meta(GST_PAD_PROBE_INFO_BUFFER(info));
+    if (batch_meta)
+        count_messages(batch_meta, run->attached, &run->next_priority);
+    return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn stalled_broker(GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+    (void)pad;
+    BranchRun *run = user_data;
+    NvDsBatchMeta *batch_meta = gst_buffer_get_nvds_batch_meta(GST_PAD_PROBE_INFO_BUFFER(info));
+    if (batch_meta)
+        count_messages(batch_meta, run->delivered, NULL);
+    if (run->broker_ms)
+        g_usleep(run->broker_ms * G_TIME_SPAN_MILLISECOND);
+    return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn count_frames(GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+    (void)pad;
+    (void)info;
+    ((BranchRun *)user_data)->frames++;
+    return GST_PAD_PROBE_OK;
+}
+
+static gboolean probe(GstElement *pipeline, const gchar *element, const gchar *pad_name,
+                      GstPadProbeCallback callback, gpointer user_data)
+{
+    GstElement *elem = gst_bin_get_by_name(GST_BIN(pipeline), element);
+    GstPad *pad = elem ? gst_element_get_static_pad(elem, pad_name) : NULL;
+    if (pad)
+        gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, callback, user_data, NULL);
+    if (pad)  gst_object_unref(pad);
+    if (elem) gst_object_unref(elem);
+    return pad != NULL;
+}
+
+static gboolean run_pipeline(const gchar *yaml, const gchar *leaky, BranchRun *run)
+{
+    g_setenv("MSG_QUEUE_LEAKY", leaky, TRUE);
+    GstElement *pipeline = director_build(yaml);
+    if (!pipeline)
+        return FALSE;
+    if (!probe(pipeline, "on-screen-display", "src", spread_priorities, run) ||
+        !probe(pipeline, "msg-broker", "sink", stalled_broker, run) ||
+        !probe(pipeline, "fake-sink", "sink", count_frames, run)) {
+        gst_object_unref(pipeline);
+        return FALSE;
+    }
+
+    PipelineController *controller = pipeline_controller_new(pipeline);
+    guint64 t0 = bench_now_ns();
+    pipeline_controller_play(controller);
+    pipeline_controller_run_loop(controller);
+    run->fps = run->frames / MAX((bench_now_ns() - t0) / 1e9, 1e-9);
+    pipeline_controller_stop(controller);
+    pipeline_controller_free(controller);
+    return TRUE;
+}
+
+static gdouble share(const BranchRun *run, MsgPriority priority)
+{
+    return run->attached[priority] ? (gdouble)run->delivered[priority] / run->attached[priority] : 0.0;
+}
+
+static void report(const gchar *what, const BranchRun *run)
+{
+    printf("  %-26s %8.1f fps, delivered low %5.1f%%  normal %5.1f%%  high %5.1f%%\n", what, run->fps,
+           100.0 * share(run, MSG_PRIORITY_LOW), 100.0 * share(run, MSG_PRIORITY_NORMAL),
+           100.0 * share(run, MSG_PRIORITY_HIGH));
+}
+
+static gboolean check(gboolean cond, const gchar *what)
+{
+    if (!cond)
+        printf("  FAILED: %s\n", what);
+    return cond;
+}
+
+int main(int argc, char **argv)
+{
+    gst_init(&argc, &argv);
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <h264_file> [broker_ms] [objects_per_frame]\n", argv[0]);
+        return 2;
+    }
+    guint broker_ms = MAX(bench_arg_uint(argc, argv, 2, 50), 1);
+    guint objects   = MAX(bench_arg_uint(argc, argv, 3, 8), 1);
+
+    gchar objects_str[16];
+    g_snprintf(objects_str, sizeof(objects_str), "%u", objects);
+    g_setenv("PIPELINE_BACKEND", "software", TRUE);
+    g_setenv("FAKE_INFER_OBJECTS", objects_str, TRUE);
+    g_setenv("TRACK_HEARTBEAT_FRAMES", "1", TRUE);
+    g_setenv("DETECTION_OUTPUT_DIR", "", FALSE);
+
+    gchar *dir  = g_dir_make_tmp("bench-msg-branch-XXXXXX", NULL);
+    gchar *yaml = g_build_filename(dir, "bench_msg_branch.yml", NULL);
+    gchar *text = g_strdup_printf("sources:\n  - name: bench\n    location: %s\n"
+                                  "msgbroker:\n  conn-str: 127.0.0.1;1883\n  topic: bench\n", argv[1]);
+    g_file_set_contents(yaml, text, -1, NULL);
+    g_free(text);
+
+    BranchRun fast     = { 0 };
+    BranchRun blocking = { .broker_ms = broker_ms };
+    BranchRun leaky    = { .broker_ms = broker_ms };
+    gboolean ok = run_pipeline(yaml, "downstream", &fast) &&
+                  run_pipeline(yaml, "no", &blocking) &&
+                  run_pipeline(yaml, "downstream", &leaky);
+    g_remove(yaml);
+    g_rmdir(dir);
+    g_free(yaml);
+    g_free(dir);
+    if (!ok) {
+        printf("  software pipeline could not be built  FAILED\n");
+        return 1;
+    }
+
+    printf("broker stall of %u ms per batch, %u objects per frame\n", broker_ms, objects);
+    report("broker keeping up", &fast);
+    report("stalled, blocking queue1", &blocking);
+    report("stalled, leaky queue1", &leaky);
+
+    /* Below about four batches per stall the broker is not the bottleneck to begin with. */
+    if (fast.fps * broker_ms / 1000.0 >= 4.0) {
+        ok &= check(blocking.fps < fast.fps / 2, "a blocking queue1 passes the stall upstream");
+        ok &= check(leaky.fps > 2 * blocking.fps, "a leaky queue1 decouples the broker");
+        ok &= check(share(&leaky, MSG_PRIORITY_HIGH) > share(&leaky, MSG_PRIORITY_LOW),
+                    "high priority messages outlast low priority ones");
+    } else {
+        printf("  source too slow for a %u ms stall to matter; raise broker_ms\n", broker_ms);
+    }
+    ok &= check(leaky.fps > 0.7 * fast.fps, "the leaky run keeps most of the frame rate");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,251 @@
+/*
+ * CPU benchmark for the broker message path of probe_send: the previous
+ * heap-per-message path (printf + concat + strdup, memdup on copy) against
+ * MsgPool.  Each message is attached, copied once and both copies released,
+ * as nvmsgconv and the buffer release do downstream.
+ *
+ * Fails when pooled payloads differ from the heap ones, when the pooled path
+ * allocates in steady state, or when a cross-thread release run leaks blocks.
+ *
+ * usage: bench_msg_pool [frames] [objects/frame] [pool_blocks]
+ */
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+
+#include "alloc_count.h"
+#include "bench_util.h"
+#include "frame_index.h"
+#include "msg_pool.h"
+#include "spsc_ring.h"
+#include "synthetic_meta.h"
+
+#define WARMUP_FRAMES 16
+
+/* ---- previous path, as probe_send did it before the pool ---- */
+
+static gchar *legacy_build_payload(guint64 id, const gchar *brand, const gchar *type,
+                                   const gchar *plate)
+{
+    gchar *safe_id  = g_strdup_printf("%" G_GUINT64_FORMAT, id);
+    gchar *payload  = g_strconcat("Vehicle ID: ", safe_id,
+                                  ", Brand: ", brand ? brand : "NULL",
+                                  ", Type: ",  type  ? type  : "NULL",
+                                  ", Plate: ", plate ? plate : "NULL", NULL);
+    g_free(safe_id);
+    return payload;
+}
+
+static NvDsCustomMsgInfo *legacy_message(const FrameIndexObject *e)
+{
+    NvDsCustomMsgInfo *msg = g_malloc0(sizeof(NvDsCustomMsgInfo));
+    gchar *payload = legacy_build_payload(e->obj->object_id, e->brand, e->type, e->plate);
+    msg->size    = (guint)strlen(payload);
+    msg->message = g_strdup(payload);
+    g_free(payload);
+    return msg;
+}
+
+static NvDsCustomMsgInfo *legacy_copy(const NvDsCustomMsgInfo *src)
+{
+    NvDsCustomMsgInfo *dst = g_memdup2(src, sizeof(NvDsCustomMsgInfo));
+    dst->message = g_strdup((const char *)src->message);
+    return dst;
+}
+
+static void legacy_release(NvDsCustomMsgInfo *msg)
+{
+    g_free(msg->message);
+    g_free(msg);
+}
+
+/* ---- pooled path, as probe_send does it now ---- */
+
+static NvDsCustomMsgInfo *pool_message(MsgPool *pool, const FrameIndexObject *e)
+{
+    return msg_pool_format(pool,
+        "Vehicle ID: %" G_GUINT64_FORMAT ", Brand: %s, Type: %s, Plate: %s",
+        e->obj->object_id,
+        e->brand ? e->brand : "NULL",
+        e->type  ? e->type  : "NULL",
+        e->plate ? e->plate : "NULL");
+}
+
+typedef struct {
+    guint64 ns;
+    guint64 allocs;   /* after warm-up */
+    guint   messages;
+} PathResult;
+
+static guint collect_objects(FrameIndex *index, NvDsBatchMeta *batch_meta,
+                             const FrameIndexObject **out, guint max)
+{
+    NvDsFrameMeta *frame_meta = (NvDsFrameMeta *)batch_meta->frame_meta_list->data;
+    frame_index_build(index, batch_meta, frame_meta);
+    guint n = 0;
+    static const gint components[] = { GIE_ID_VEHICLE_DETECTOR, GIE_ID_PLATE_DETECTOR };
+    for (guint c = 0; c < G_N_ELEMENTS(components); c++) {
+        const FrameIndexBucket *bucket = frame_index_bucket(index, components[c]);
+        for (guint i = 0; i < bucket->n && n < max; i++)
+            out[n++] = &bucket->items[i];
+    }
+    return n;
+}
+
+static PathResult run_path(gboolean pooled, MsgPool *pool, const FrameIndexObject **objs,
+                           guint n, guint frames)
+{
+    PathResult res = { 0, 0, 0 };
+    NvDsCustomMsgInfo **msgs   = g_new(NvDsCustomMsgInfo *, n);
+    NvDsCustomMsgInfo **copies = g_new(NvDsCustomMsgInfo *, n);
+    guint64 allocs0 = 0;
+
+    for (guint f = 0; f < frames + WARMUP_FRAMES; f++) {
+        if (f == WARMUP_FRAMES)
+            allocs0 = alloc_count_get();
+        guint64 t0 = bench_now_ns();
+        for (guint i = 0; i < n; i++) {
+            msgs[i]   = pooled ? pool_message(pool, objs[i]) : legacy_message(objs[i]);
+            copies[i] = pooled ? msg_pool_copy(msgs[i]) : legacy_copy(msgs[i]);
+        }
+        for (guint i = 0; i < n; i++) {
+            if (pooled) {
+                msg_pool_release(msgs[i]);
+                msg_pool_release(copies[i]);
+            } else {
+                legacy_release(msgs[i]);
+                legacy_release(copies[i]);
+            }
+        }
+        if (f >= WARMUP_FRAMES) {
+            res.ns += bench_now_ns() - t0;
+            res.messages += n;
+        }
+    }
+    res.allocs = alloc_count_get() - allocs0;
+    g_free(msgs);
+    g_free(copies);
+    return res;
+}
+
+static gboolean check_parity(MsgPool *pool, const FrameIndexObject **objs, guint n)
+{
+    guint mismatches = 0;
+    for (guint i = 0; i < n; i++) {
+        NvDsCustomMsgInfo *a = legacy_message(objs[i]);
+        NvDsCustomMsgInfo *b = pool_message(pool, objs[i]);
+        NvDsCustomMsgInfo *c = msg_pool_copy(b);
+        if (a->size != b->size || strcmp(a->message, b->message) != 0 ||
+            c->size != b->size || strcmp(c->message, b->message) != 0)
+            mismatches++;
+        legacy_release(a);
+        msg_pool_release(b);
+        msg_pool_release(c);
+    }
+    if (mismatches)
+        printf("PAYLOAD MISMATCH: %u of %u messages differ\n", mismatches, n);
+    return mismatches == 0;
+}
+
+/* ---- cross-thread release: the broker side drops messages on its own thread ---- */
+
+typedef struct {
+    SpscRing *ring;
+    gint      done;
+    guint64   released;
+} Releaser;
+
+static gpointer releaser_main(gpointer data)
+{
+    Releaser *r = data;
+    for (;;) {
+        NvDsCustomMsgInfo **slot = spsc_ring_peek(r->ring);
+        if (!slot) {
+            if (g_atomic_int_get(&r->done) && !spsc_ring_peek(r->ring))
+                break;
+            g_thread_yield();
+            continue;
+        }
+        NvDsCustomMsgInfo *copy = msg_pool_copy(*slot);
+        msg_pool_release(*slot);
+        msg_pool_release(copy);
+        spsc_ring_release(r->ring);
+        r->released++;
+    }
+    return NULL;
+}
+
+static gboolean run_cross_thread(MsgPool *pool, const FrameIndexObject **objs, guint n, guint frames)
+{
+    Releaser r = { spsc_ring_new(1024, sizeof(NvDsCustomMsgInfo *)), 0, 0 };
+    GThread *thread = g_thread_new("releaser", releaser_main, &r);
+    guint64 sent = 0;
+
+    guint64 t0 = bench_now_ns();
+    for (guint f = 0; f < frames; f++) {
+        for (guint i = 0; i < n; i++) {
+            NvDsCustomMsgInfo **slot;
+            while (!(slot = spsc_ring_reserve(r.ring)))
+                g_thread_yield();
+            *slot = pool_message(pool, objs[i]);
+            spsc_ring_commit(r.ring);
+            sent++;
+        }
+    }
+    g_atomic_int_set(&r.done, 1);
+    g_thread_join(thread);
+    guint64 elapsed = bench_now_ns() - t0;
+    spsc_ring_free(r.ring);
+
+    MsgPoolStats stats;
+    msg_pool_get_stats(pool, &stats);
+    printf("cross-thread: %" G_GUINT64_FORMAT " messages released on a second thread, %.0f ns/message,"
+           " acquired %" G_GUINT64_FORMAT " released %" G_GUINT64_FORMAT " misses %" G_GUINT64_FORMAT "\n",
+           r.released, (gdouble)elapsed / MAX(sent, 1), stats.acquired, stats.released, stats.misses);
+    if (r.released != sent || stats.acquired != stats.released) {
+        printf("LEAK: %" G_GUINT64_FORMAT " messages outstanding\n", stats.acquired - stats.released);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+int main(int argc, char **argv)
+{
+    guint frames  = MAX(bench_arg_uint(argc, argv, 1, 20000), 1);
+    guint objects = MAX(bench_arg_uint(argc, argv, 2, 20), 1);
+    guint blocks  = bench_arg_uint(argc, argv, 3, 4096);
+    gboolean ok = TRUE;
+
+    SyntheticMetaParams params = {
+        .batch_size = 1, .objects_per_frame = objects, .plate_ratio = 0.6,
+        .label_cardinality = 20, .seed = 99,
+    };
+    NvDsBatchMeta *batch_meta = synthetic_meta_new(&params);
+    FrameIndex *index = frame_index_new();
+    const FrameIndexObject **objs = g_new(const FrameIndexObject *, objects);
+    guint n = collect_objects(index, batch_meta, objs, objects);
+
+    MsgPool *pool = msg_pool_new(blocks);
+    ok &= check_parity(pool, objs, n);
+
+    PathResult heap = run_path(FALSE, NULL, objs, n, frames);
+    PathResult pooled = run_path(TRUE, pool, objs, n, frames);
+
+    printf("%u messages/frame, %u frames\n", n, frames);
+    printf("  heap    %8.1f ns/message  %6.2f mallocs/frame\n",
+           (gdouble)heap.ns / MAX(heap.messages, 1), (gdouble)heap.allocs / frames);
+    printf("  pooled  %8.1f ns/message  %6.2f mallocs/frame\n",
+           (gdouble)pooled.ns / MAX(pooled.messages, 1), (gdouble)pooled.allocs / frames);
+    if (pooled.allocs != 0 && blocks >= 2 * n) {
+        printf("STEADY-STATE ALLOCATIONS: %" G_GUINT64_FORMAT " in the pooled path\n", pooled.allocs);
+        ok = FALSE;
+    }
+
+    ok &= run_cross_thread(pool, objs, n, frames);
+
+    msg_pool_free(pool);
+    g_free(objs);
+    frame_index_free(index);
+    nvds_destroy_batch_meta(batch_meta);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,227 @@
+/*
+ * CPU benchmark for the broker payload encoders (payload_encoder.h): bytes
+ * and encode time per event for text, json and binary over a mix of tracked
+ * and untracked events, lost tracks without a box and labels not yet known.
+ * Each event is encoded into a preallocated buffer, as MsgPool blocks are.
+ *
+ * Fails when text differs from the legacy format string, when a binary
+ * payload does not decode back to what was encoded, when json escapes a label
+ * wrongly, when an encoder writes past a short buffer or allocates, or when
+ * binary is not the smallest.
+ *
+ * usage: bench_payload_encoder [events] [variants]
+ */
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+
+#include "alloc_count.h"
+#include "bench_util.h"
+#include "payload_encoder.h"
+
+#define BUF_BYTES 1024
+
+static const gchar *formats[] = { "text", "json", "binary" };
+
+typedef struct {
+    PayloadEvent event;
+    gchar        plate[12];
+} Variant;
+
+static void make_variants(Variant *v, guint n)
+{
+    static const gchar *brands[] = { "toyota", "ford", "bmw", "honda", "mercedes-benz", NULL };
+    static const gchar *types[]  = { "sedan", "suv", "truck", "van", NULL };
+    GRand *rand = g_rand_new_with_seed(7);
+    for (guint i = 0; i < n; i++) {
+        PayloadEvent *e = &v[i].event;
+        guint kind = g_rand_int_range(rand, 0, 10);
+        *e = (PayloadEvent){
+            .object_id    = g_rand_int_range(rand, 1, 5000000),
+            .source_id    = g_rand_int_range(rand, 0, 16),
+            .frame_num    = g_rand_int_range(rand, 0, 2000000),
+            .timestamp_ns = G_GUINT64_CONSTANT(1760000000000000000) + (guint64)i * 33333333u,
+            .event        = kind < 3 ? TRACK_EVENT_NONE : (TrackEvent)(kind % 4 + 1),
+            .confidence   = -1.0f,
+            .brand_conf   = (gfloat)g_rand_double(rand),
+            .type_conf    = (gfloat)g_rand_double(rand),
+            .plate_conf   = (gfloat)g_rand_double(rand),
+        };
+        if (e->event != TRACK_EVENT_LOST) {
+            e->has_bbox   = TRUE;
+            e->left       = (gfloat)g_rand_double_range(rand, -4, 1900);
+            e->top        = (gfloat)g_rand_double_range(rand, 0, 1060);
+            e->width      = (gfloat)g_rand_double_range(rand, 20, 400);
+            e->height     = (gfloat)g_rand_double_range(rand, 20, 300);
+            e->confidence = (gfloat)g_rand_double(rand);
+        }
+        e->brand = brands[g_rand_int_range(rand, 0, G_N_ELEMENTS(brands))];
+        e->type  = types[g_rand_int_range(rand, 0, G_N_ELEMENTS(types))];
+        if (g_rand_boolean(rand)) {
+            for (guint c = 0; c < 7; c++)
+                v[i].plate[c] = c < 3 ? (gchar)('A' + g_rand_int_range(rand, 0, 26))
+                                      : (gchar)('0' + g_rand_int_range(rand, 0, 10));
+            v[i].plate[7] = '\0';
+            e->plate = v[i].plate;
+        }
+    }
+    g_rand_free(rand);
+}
+
+static gboolean check(gboolean cond, const gchar *what)
+{
+    if (!cond)
+        printf("  FAILED: %s\n", what);
+    return cond;
+}
+
+static gboolean same_text(const PayloadEvent *e, const gchar *payload, gsize len)
+{
+    gchar *legacy = e->event != TRACK_EVENT_NONE
+        ? g_strdup_printf("Vehicle ID: %" G_GUINT64_FORMAT ", Brand: %s, Type: %s, Plate: %s, Source: %u, Event: %s",
+                          e->object_id, e->brand ? e->brand : "NULL", e->type ? e->type : "NULL",
+                          e->plate ? e->plate : "NULL", e->source_id, track_event_name(e->event))
+        : g_strdup_printf("Vehicle ID: %" G_GUINT64_FORMAT ", Brand: %s, Type: %s, Plate: %s, Source: %u",
+                          e->object_id, e->brand ? e->brand : "NULL", e->type ? e->type : "NULL",
+                          e->plate ? e->plate : "NULL", e->source_id);
+    gboolean same = strlen(legacy) == len && memcmp(legacy, payload, len) == 0;
+    g_free(legacy);
+    return same;
+}
+
+static gboolean near(gfloat a, gfloat b, gfloat tolerance)
+{
+    return a - b <= tolerance && b - a <= tolerance;
+}
+
+static gboolean same_conf(gfloat decoded, gfloat encoded)
+{
+    return encoded < 0 ? decoded < 0 : near(decoded, CLAMP(encoded, 0.0f, 1.0f), 0.0006f);
+}
+
+static gboolean round_trips(const PayloadEvent *e, const gchar *payload, gsize len)
+{
+    PayloadDecoded d;
+    if (!payload_decode_binary(payload, len, &d))
+        return FALSE;
+    const PayloadEvent *o = &d.event;
+    gboolean ok = o->object_id == e->object_id && o->source_id == e->source_id &&
+                  o->frame_num == e->frame_num && o->timestamp_ns == e->timestamp_ns &&
+                  o->event == e->event && o->has_bbox == e->has_bbox &&
+                  g_strcmp0(o->brand, e->brand) == 0 && g_strcmp0(o->type, e->type) == 0 &&
+                  g_strcmp0(o->plate, e->plate) == 0;
+    if (e->has_bbox)
+        ok = ok && near(o->left, e->left, 0.5f) && near(o->top, e->top, 0.5f) &&
+             near(o->width, e->width, 0.5f) && near(o->height, e->height, 0.5f) &&
+             same_conf(o->confidence, e->confidence);
+    if (e->brand) ok = ok && same_conf(o->brand_conf, e->brand_conf);
+    if (e->type)  ok = ok && same_conf(o->type_conf, e->type_conf);
+    if (e->plate) ok = ok && same_conf(o->plate_conf, e->plate_conf);
+    return ok;
+}
+
+/* Every short size: the same full length back, and nothing written at or past size. */
+static gboolean respects_size(const PayloadEncoder *enc, const PayloadEvent *e)
+{
+    gchar buf[BUF_BYTES + 1];
+    gsize full = enc->encode(e, buf, BUF_BYTES);
+    for (gsize size = 0; size <= full; size++) {
+        memset(buf, 0x5a, sizeof(buf));
+        if (enc->encode(e, buf, size) != full)
+            return FALSE;
+        for (gsize i = size; i < sizeof(buf); i++)
+            if ((guchar)buf[i] != 0x5a)
+                return FALSE;
+    }
+    return TRUE;
+}
+
+static gboolean check_json(void)
+{
+    const PayloadEncoder *enc = payload_encoder_lookup("json");
+    PayloadEvent e = {
+        .object_id = 42, .source_id = 3, .frame_num = 1200, .timestamp_ns = 5,
+        .event = TRACK_EVENT_NEW, .has_bbox = TRUE,
+        .left = -1.6f, .top = 10.4f, .width = 120.5f, .height = 80.0f, .confidence = 0.9127f,
+        .brand = "a\"b\\c\n\x01", .brand_conf = 1.2f, .type = NULL, .type_conf = 0.5f,
+        .plate = "ABC123", .plate_conf = -1.0f,
+    };
+    static const gchar expected[] =
+        "{\"v\":1,\"object_id\":42,\"source_id\":3,\"frame\":1200,\"timestamp_ns\":5,\"event\":\"new\","
+        "\"bbox\":[-2,10,121,80],\"confidence\":0.913,"
+        "\"brand\":\"a\\\"b\\\\c\\u000a\\u0001\",\"brand_conf\":1.000,"
+        "\"type\":null,\"type_conf\":null,\"plate\":\"ABC123\",\"plate_conf\":null}";
+    gchar buf[BUF_BYTES];
+    gsize len = enc->encode(&e, buf, sizeof(buf));
+    gboolean ok = len == strlen(expected) && strcmp(buf, expected) == 0;
+    if (!ok)
+        printf("  json: %s\n", buf);
+    return ok;
+}
+
+typedef struct {
+    gdouble ns;
+    gdouble bytes;
+    gdouble allocs;
+} Result;
+
+static Result run(const PayloadEncoder *enc, const Variant *v, guint n_variants, guint events)
+{
+    static gchar buf[BUF_BYTES];
+    guint64 bytes = 0;
+    for (guint i = 0; i < n_variants; i++)
+        enc->encode(&v[i].event, buf, sizeof(buf));
+
+    guint64 allocs0 = alloc_count_get();
+    guint64 t0 = bench_now_ns();
+    for (guint i = 0; i < events; i++)
+        bytes += enc->encode(&v[i % n_variants].event, buf, sizeof(buf));
+    guint64 t1 = bench_now_ns();
+    return (Result){
+        .ns     = (gdouble)(t1 - t0) / events,
+        .bytes  = (gdouble)bytes / events,
+        .allocs = (gdouble)(alloc_count_get() - allocs0) / events,
+    };
+}
+
+int main(int argc, char **argv)
+{
+    guint events     = MAX(bench_arg_uint(argc, argv, 1, 2000000), 1);
+    guint n_variants = MAX(bench_arg_uint(argc, argv, 2, 4096), 1);
+
+    Variant *variants = g_new0(Variant, n_variants);
+    make_variants(variants, n_variants);
+
+    gboolean text_ok = TRUE, binary_ok = TRUE, sizes_ok = TRUE;
+    gchar buf[BUF_BYTES];
+    for (guint i = 0; i < n_variants; i++) {
+        const PayloadEvent *e = &variants[i].event;
+        gsize len = payload_encoder_lookup("text")->encode(e, buf, sizeof(buf));
+        text_ok &= same_text(e, buf, len);
+        len = payload_encoder_lookup("binary")->encode(e, buf, sizeof(buf));
+        binary_ok &= round_trips(e, buf, len);
+        if (i < 64)
+            for (guint f = 0; f < G_N_ELEMENTS(formats); f++)
+                sizes_ok &= respects_size(payload_encoder_lookup(formats[f]), e);
+    }
+
+    printf("%u events over %u variants\n", events, n_variants);
+    printf("  %-8s %12s %12s %14s\n", "format", "bytes/event", "ns/event", "mallocs/event");
+    Result results[G_N_ELEMENTS(formats)];
+    for (guint f = 0; f < G_N_ELEMENTS(formats); f++) {
+        results[f] = run(payload_encoder_lookup(formats[f]), variants, n_variants, events);
+        printf("  %-8s %12.1f %12.1f %14.3f\n", formats[f], results[f].bytes, results[f].ns,
+               results[f].allocs);
+    }
+
+    gboolean ok = check(payload_encoder_lookup("xml") == NULL, "unknown format rejected");
+    ok &= check(text_ok, "text is the legacy payload byte for byte");
+    ok &= check(binary_ok, "binary decodes to the encoded event");
+    ok &= check(check_json(), "json escapes labels and rounds as documented");
+    ok &= check(sizes_ok, "short buffers report the full length and are not overrun");
+    ok &= check(results[1].allocs == 0 && results[2].allocs == 0, "json and binary do not allocate");
+    ok &= check(results[2].bytes < results[0].bytes && results[2].bytes < results[1].bytes,
+                "binary is the smallest");
+    g_free(variants);
+    return ok ? 0 : 1;
+}
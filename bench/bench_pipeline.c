@@ -0,0 +1,123 @@
+/*
+ * Whole application on the software backend (PIPELINE_BACKEND=software):
+ * director_build and the pipeline controller exactly as main.c runs them,
+ * with avdec_h264 decoding and fake inference in place of the GPU.
+ *
+ * A YAML with n_sources copies of the given H.264 stream is written to a temp
+ * dir.  Out of the OSD, ahead of the tee, every source must deliver the same,
+ * non-zero number of frames, each carrying objects_per_frame objects, and
+ * probe_send must have attached broker messages.  Throughput and the probe latency
+ * report (ENABLE_PROBE_STATS builds) are printed for regression tracking.
+ * DETECTION_OUTPUT_DIR and the other variables of the app still apply; the
+ * detection dump is off unless it is set.  HEADLESS=1 drops the render branch
+ * and adds the app's own run report.
+ *
+ * usage: bench_pipeline <h264_file> [n_sources] [objects_per_frame]
+ */
+#include <stdio.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+
+#include "bench_util.h"
+#include "director.h"
+#include "pipeline_controller.h"
+#include "source_config.h"
+#include "metrics.h"
+#include "gstnvdsmeta.h"
+
+typedef struct {
+    guint64 frames[SOURCE_CONFIG_MAX_SOURCES];
+    guint64 objects;
+    guint64 total;
+} FrameCounts;
+
+static GstPadProbeReturn count_frames(GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+    (void)pad;
+    FrameCounts *counts = user_data;
+    NvDsBatchMeta *batch_meta = gst_buffer_get_nvds_batch_meta(GST_PAD_PROBE_INFO_BUFFER(info));
+    if (!batch_meta)
+        return GST_PAD_PROBE_OK;
+    for (GList *l = batch_meta->frame_meta_list; l; l = l->next) {
+        NvDsFrameMeta *frame_meta = l->data;
+        if (frame_meta->source_id < SOURCE_CONFIG_MAX_SOURCES)
+            counts->frames[frame_meta->source_id]++;
+        counts->objects += frame_meta->num_obj_meta;
+        counts->total++;
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+static gchar *write_config(const gchar *dir, const gchar *location, guint n_sources)
+{
+    GString *yaml = g_string_new("sources:\n");
+    for (guint i = 0; i < n_sources; i++)
+        g_string_append_printf(yaml, "  - name: bench-%u\n    location: %s\n", i, location);
+    /* Required by the config check; the publisher keeps retrying without a broker there. */
+    g_string_append(yaml, "msgbroker:\n  conn-str: 127.0.0.1;1883\n  topic: bench\n");
+    gchar *path = g_build_filename(dir, "bench_pipeline.yml", NULL);
+    g_file_set_contents(path, yaml->str, -1, NULL);
+    g_string_free(yaml, TRUE);
+    return path;
+}
+
+int main(int argc, char **argv)
+{
+    gst_init(&argc, &argv);
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <h264_file> [n_sources] [objects_per_frame]\n", argv[0]);
+        return 2;
+    }
+    guint n_sources = MIN(MAX(bench_arg_uint(argc, argv, 2, 4), 1), SOURCE_CONFIG_MAX_SOURCES);
+    guint objects   = MAX(bench_arg_uint(argc, argv, 3, 8), 1);
+
+    gchar objects_str[16];
+    g_snprintf(objects_str, sizeof(objects_str), "%u", objects);
+    g_setenv("PIPELINE_BACKEND", "software", TRUE);
+    g_setenv("FAKE_INFER_OBJECTS", objects_str, TRUE);
+    g_setenv("DETECTION_OUTPUT_DIR", "", FALSE);
+
+    gchar *dir  = g_dir_make_tmp("bench-pipeline-XXXXXX", NULL);
+    gchar *yaml = write_config(dir, argv[1], n_sources);
+    GstElement *pipeline = director_build(yaml);
+    g_remove(yaml);
+    g_rmdir(dir);
+    g_free(yaml);
+    g_free(dir);
+    if (!pipeline) {
+        printf("  software pipeline could not be built  FAILED\n");
+        return 1;
+    }
+
+    FrameCounts counts = { 0 };
+    /* Every frame passes here, with or without the render branch. */
+    GstElement *osd = gst_bin_get_by_name(GST_BIN(pipeline), "on-screen-display");
+    GstPad *osd_pad = gst_element_get_static_pad(osd, "src");
+    gst_pad_add_probe(osd_pad, GST_PAD_PROBE_TYPE_BUFFER, count_frames, &counts, NULL);
+    gst_object_unref(osd_pad);
+    gst_object_unref(osd);
+
+    /* The controller takes the pipeline reference. */
+    PipelineController *controller = pipeline_controller_new(pipeline);
+    guint64 t0 = bench_now_ns();
+    pipeline_controller_play(controller);
+    pipeline_controller_run_loop(controller);
+    gdouble seconds = (bench_now_ns() - t0) / 1e9;
+    pipeline_controller_stop(controller);
+    pipeline_controller_free(controller);
+
+    guint64 messages = metrics_counter_get(metrics_counter("traffic_guard_messages_attached_total",
+                                                           NULL, NULL, NULL, TRUE));
+    gboolean ok = counts.total > 0 && messages > 0 &&
+                  counts.objects == counts.total * objects;
+    for (guint i = 0; i < n_sources; i++) {
+        printf("  source %u  %" G_GUINT64_FORMAT " frames\n", i, counts.frames[i]);
+        ok &= counts.frames[i] > 0 && counts.frames[i] == counts.frames[0];
+    }
+    printf("  %u sources x %u objects: %" G_GUINT64_FORMAT " frames in %.2f s (%.1f fps), "
+           "%" G_GUINT64_FORMAT " objects, %" G_GUINT64_FORMAT " messages  %s\n",
+           n_sources, objects, counts.total, seconds, counts.total / MAX(seconds, 1e-9),
+           counts.objects, messages, ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
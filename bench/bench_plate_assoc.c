@@ -0,0 +1,254 @@
+/*
+ * CPU benchmark for PlateAssoc against the brute-force IoU scan that
+ * probe_match_tracker_ids used before (replicated below), on synthetic
+ * intersections with many overlapping cars.
+ *
+ * Checks, reported per scene and reflected in the exit status:
+ *   - IoU mode without parent links picks exactly the car the old scan picked;
+ *   - parent links recover the generating car for every linked plate.
+ * Containment and one-to-one accuracy against the generating car is printed
+ * for comparison with the old scan.
+ *
+ * usage: bench_plate_assoc [iterations] [plate_pct] [seed]
+ */
+#include <math.h>
+#include <stdio.h>
+#include <glib.h>
+
+#include "bench_util.h"
+#include "frame_index.h"
+#include "plate_assoc.h"
+
+/* ---- the original matcher, verbatim apart from the component id macro ---- */
+
+static float legacy_iou(NvOSD_RectParams a, NvOSD_RectParams b)
+{
+    float x1 = fmaxf(a.left, b.left);
+    float y1 = fmaxf(a.top,  b.top);
+    float x2 = fminf(a.left + a.width,  b.left + b.width);
+    float y2 = fminf(a.top  + a.height, b.top  + b.height);
+
+    float iw = fmaxf(0.0f, x2 - x1);
+    float ih = fmaxf(0.0f, y2 - y1);
+    float intersection = iw * ih;
+
+    float area_a = a.width * a.height;
+    float area_b = b.width * b.height;
+    float union_area = area_a + area_b - intersection;
+
+    return (union_area > 0.0f) ? (intersection / union_area) : 0.0f;
+}
+
+static NvDsObjectMeta *legacy_find_parent_car(NvDsFrameMeta *frame_meta, NvDsObjectMeta *plate)
+{
+    float max_iou = 0.0f;
+    NvDsObjectMeta *parent = NULL;
+
+    for (GList *l_obj = frame_meta->obj_meta_list; l_obj; l_obj = l_obj->next) {
+        NvDsObjectMeta *obj = (NvDsObjectMeta *)l_obj->data;
+        if (obj->unique_component_id != GIE_ID_VEHICLE_DETECTOR)
+            continue;
+        float score = legacy_iou(obj->rect_params, plate->rect_params);
+        if (score > max_iou) {
+            max_iou = score;
+            parent = obj;
+        }
+    }
+    return (parent && max_iou > 0.0f) ? parent : NULL;
+}
+
+/* ---- scene: cars scattered over 1080p, each plate inside its car's lower half ---- */
+
+typedef struct {
+    NvDsBatchMeta   *batch_meta;
+    NvDsFrameMeta   *frame_meta;
+    NvDsObjectMeta **plates;   /* list order */
+    guint64         *truth;    /* generating car's object_id per plate */
+    guint            n_plates;
+} Scene;
+
+static NvDsObjectMeta *scene_object(Scene *scene, gint component, guint64 id,
+                                    gfloat left, gfloat top, gfloat width, gfloat height,
+                                    NvDsObjectMeta *parent)
+{
+    NvDsObjectMeta *obj = nvds_acquire_obj_meta_from_pool(scene->batch_meta);
+    obj->unique_component_id = component;
+    obj->class_id            = 0;
+    obj->object_id           = id;
+    obj->rect_params.left    = left;
+    obj->rect_params.top     = top;
+    obj->rect_params.width   = width;
+    obj->rect_params.height  = height;
+    nvds_add_obj_meta_to_frame(scene->frame_meta, obj, parent);
+    return obj;
+}
+
+static Scene scene_new(guint n_cars, gdouble plate_ratio, gboolean link_parents, guint32 seed)
+{
+    Scene scene = { 0 };
+    GRand *rand = g_rand_new_with_seed(seed);
+    scene.batch_meta = nvds_create_batch_meta(1);
+    scene.frame_meta = nvds_acquire_frame_meta_from_pool(scene.batch_meta);
+    nvds_add_frame_meta_to_batch(scene.batch_meta, scene.frame_meta);
+
+    NvDsObjectMeta **cars = g_new(NvDsObjectMeta *, n_cars);
+    for (guint i = 0; i < n_cars; i++)
+        cars[i] = scene_object(&scene, GIE_ID_VEHICLE_DETECTOR, i + 1,
+                               (gfloat)g_rand_int_range(rand, 0, 1700),
+                               (gfloat)g_rand_int_range(rand, 0, 950),
+                               (gfloat)g_rand_int_range(rand, 60, 220),
+                               (gfloat)g_rand_int_range(rand, 40, 130), NULL);
+
+    scene.plates = g_new(NvDsObjectMeta *, n_cars);
+    scene.truth  = g_new(guint64, n_cars);
+    for (guint i = 0; i < n_cars; i++) {
+        if (g_rand_double(rand) >= plate_ratio)
+            continue;
+        const NvOSD_RectParams *car = &cars[i]->rect_params;
+        gfloat w = car->width * (gfloat)g_rand_double_range(rand, 0.2, 0.4);
+        gfloat h = car->height * (gfloat)g_rand_double_range(rand, 0.1, 0.2);
+        gfloat left = car->left + (car->width - w) * (gfloat)g_rand_double(rand);
+        gfloat top  = car->top + car->height * 0.5f + (car->height * 0.5f - h) * (gfloat)g_rand_double(rand);
+        scene.plates[scene.n_plates] =
+            scene_object(&scene, GIE_ID_PLATE_DETECTOR, 1000000 + i, left, top, w, h,
+                         link_parents ? cars[i] : NULL);
+        scene.truth[scene.n_plates++] = cars[i]->object_id;
+    }
+
+    g_free(cars);
+    g_rand_free(rand);
+    return scene;
+}
+
+static void scene_free(Scene *scene)
+{
+    g_free(scene->plates);
+    g_free(scene->truth);
+    nvds_destroy_batch_meta(scene->batch_meta);
+}
+
+/* ---- runs ---- */
+
+typedef struct {
+    gdouble ns_per_frame;
+    guint64 p99;
+    guint   correct;   /* plates matched to their generating car */
+    guint   matched;
+} RunResult;
+
+static RunResult run_legacy(Scene *scene, guint iterations, NvDsObjectMeta **out)
+{
+    RunResult res = { 0 };
+    guint64 *samples = g_new(guint64, iterations);
+    guint64 total = 0;
+    for (guint it = 0; it < iterations; it++) {
+        guint64 t0 = bench_now_ns();
+        for (guint p = 0; p < scene->n_plates; p++)
+            out[p] = legacy_find_parent_car(scene->frame_meta, scene->plates[p]);
+        samples[it] = bench_now_ns() - t0;
+        total += samples[it];
+    }
+    for (guint p = 0; p < scene->n_plates; p++) {
+        res.matched += out[p] != NULL;
+        res.correct += out[p] && out[p]->object_id == scene->truth[p];
+    }
+    res.ns_per_frame = (gdouble)total / iterations;
+    res.p99 = bench_percentile(samples, iterations, 99);
+    g_free(samples);
+    return res;
+}
+
+static RunResult run_assoc(Scene *scene, guint iterations, const PlateAssocOptions *options,
+                           NvDsObjectMeta **out)
+{
+    RunResult res = { 0 };
+    PlateAssoc *assoc = plate_assoc_new(options);
+    guint64 *samples = g_new(guint64, iterations);
+    guint64 total = 0;
+    for (guint it = 0; it < iterations; it++) {
+        guint64 t0 = bench_now_ns();
+        plate_assoc_match_frame(assoc, scene->frame_meta);
+        samples[it] = bench_now_ns() - t0;
+        total += samples[it];
+    }
+    for (guint p = 0; p < scene->n_plates; p++) {
+        out[p] = plate_assoc_car(assoc, p);
+        res.matched += out[p] != NULL;
+        res.correct += out[p] && out[p]->object_id == scene->truth[p];
+    }
+    res.ns_per_frame = (gdouble)total / iterations;
+    res.p99 = bench_percentile(samples, iterations, 99);
+    g_free(samples);
+    plate_assoc_free(assoc);
+    return res;
+}
+
+static void report(const char *name, const RunResult *res, guint n_plates, gdouble baseline)
+{
+    printf("  %-24s %12.0f ns/frame  p99 %10" G_GUINT64_FORMAT "  x%-6.1f matched %4u/%-4u correct %5.1f%%\n",
+           name, res->ns_per_frame, res->p99, baseline / MAX(res->ns_per_frame, 1.0),
+           res->matched, n_plates, n_plates ? 100.0 * res->correct / n_plates : 100.0);
+}
+
+static gboolean run_scene(guint n_cars, guint iterations, gdouble plate_ratio, guint32 seed)
+{
+    gboolean ok = TRUE;
+    Scene scene = scene_new(n_cars, plate_ratio, FALSE, seed);
+    Scene linked = scene_new(n_cars, plate_ratio, TRUE, seed);
+    NvDsObjectMeta **legacy = g_new0(NvDsObjectMeta *, MAX(scene.n_plates, 1));
+    NvDsObjectMeta **out    = g_new0(NvDsObjectMeta *, MAX(scene.n_plates, 1));
+
+    printf("%u cars, %u plates\n", n_cars, scene.n_plates);
+    RunResult base = run_legacy(&scene, iterations, legacy);
+    report("legacy iou scan", &base, scene.n_plates, base.ns_per_frame);
+
+    PlateAssocOptions iou = { PLATE_ASSOC_SCORE_IOU, 0.0f, FALSE, FALSE };
+    RunResult res = run_assoc(&scene, iterations, &iou, out);
+    guint mismatches = 0;
+    for (guint p = 0; p < scene.n_plates; p++)
+        mismatches += out[p] != legacy[p];
+    report("grid iou", &res, scene.n_plates, base.ns_per_frame);
+    if (mismatches) {
+        printf("  PARITY MISMATCH: %u plates differ from the legacy scan\n", mismatches);
+        ok = FALSE;
+    }
+
+    PlateAssocOptions cont = { PLATE_ASSOC_SCORE_CONTAINMENT, 0.5f, FALSE, FALSE };
+    res = run_assoc(&scene, iterations, &cont, out);
+    report("grid containment", &res, scene.n_plates, base.ns_per_frame);
+
+    PlateAssocOptions one = { PLATE_ASSOC_SCORE_CONTAINMENT, 0.5f, FALSE, TRUE };
+    res = run_assoc(&scene, iterations, &one, out);
+    report("grid containment 1:1", &res, scene.n_plates, base.ns_per_frame);
+
+    PlateAssocOptions parent = { PLATE_ASSOC_SCORE_CONTAINMENT, 0.5f, TRUE, FALSE };
+    res = run_assoc(&linked, iterations, &parent, out);
+    report("parent links", &res, linked.n_plates, base.ns_per_frame);
+    if (res.correct != linked.n_plates) {
+        printf("  PARENT MISMATCH: %u of %u linked plates lost their car\n",
+               linked.n_plates - res.correct, linked.n_plates);
+        ok = FALSE;
+    }
+
+    g_free(legacy);
+    g_free(out);
+    scene_free(&scene);
+    scene_free(&linked);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    guint iterations = MAX(bench_arg_uint(argc, argv, 1, 500), 1);
+    guint plate_pct  = MIN(bench_arg_uint(argc, argv, 2, 60), 100);
+    guint seed       = bench_arg_uint(argc, argv, 3, 7);
+
+    static const guint car_counts[] = { 10, 100, 1000 };
+    gboolean ok = TRUE;
+    for (guint i = 0; i < G_N_ELEMENTS(car_counts); i++) {
+        /* The legacy scan is quadratic; keep the large scene bounded in time. */
+        guint iters = car_counts[i] >= 1000 ? MAX(iterations / 20, 1) : iterations;
+        ok &= run_scene(car_counts[i], iters, plate_pct / 100.0, seed + i);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,220 @@
+/*
+ * CPU microbenchmarks for the pad probes, called directly on a GstBuffer that
+ * carries a synthetic NvDsBatchMeta, the way the pads would call them.
+ *
+ * Each probe runs against the same scene for a warm-up, then for the timed
+ * iterations.  Between iterations, outside the timing, the user meta that
+ * probe_send attached is released and every frame_num advances by one, so
+ * track state sees a steady stream rather than one frame repeated.  Reports
+ * ns/frame as mean, p50 and p99 over iterations, and mallocs per frame
+ * (GLib's included).  DeepStream's own meta pools count too where they
+ * allocate.  When built with ENABLE_PROBE_STATS, drop_frame runs once more
+ * through the probe_stats wrapper to show its per-call overhead.
+ *
+ * usage: bench_probes [iterations] [batch_size] [objects_per_frame] [plate_ratio_pct]
+ *                     [label_cardinality] [output_dir]
+ */
+#include <stdio.h>
+#include <glib.h>
+
+#include "gstnvdsmeta.h"
+
+#include "alloc_count.h"
+#include "probe_stats.h"
+#include "bench_util.h"
+#include "synthetic_meta.h"
+#include "meta_stage.h"
+#include "plate_assoc.h"
+#include "msg_pool.h"
+#include "track_state.h"
+#include "track_consensus.h"
+#include "detection_writer.h"
+#include "probes/probe_send.h"
+#include "probes/probe_detections.h"
+#include "probes/probe_tracker_match.h"
+#include "probes/probe_consensus.h"
+#include "probes/probe_drop.h"
+
+#define WARMUP_ITERATIONS 50
+
+typedef struct {
+    const gchar        *name;
+    GstPadProbeCallback probe;
+    gpointer            user_data;
+    GstPadProbeCallback after;   /* optional second probe timed with the first */
+    gpointer            after_data;
+} ProbeCase;
+
+static gpointer batch_meta_copy(gpointer data, gpointer user_data)
+{
+    (void)user_data;
+    return data;
+}
+
+/* The bench owns the batch and destroys it itself. */
+static void batch_meta_release(gpointer data, gpointer user_data)
+{
+    (void)data;
+    (void)user_data;
+}
+
+static GstBuffer *wrap_batch(NvDsBatchMeta *batch_meta)
+{
+    GstBuffer *buf = gst_buffer_new();
+    NvDsMeta *meta = gst_buffer_add_nvds_meta(buf, batch_meta, NULL,
+                                              batch_meta_copy, batch_meta_release);
+    meta->meta_type = NVDS_BATCH_GST_META;
+    return buf;
+}
+
+static void next_frame(NvDsBatchMeta *batch_meta)
+{
+    for (NvDsMetaList *l_frame = batch_meta->frame_meta_list; l_frame != NULL;
+         l_frame = l_frame->next) {
+        NvDsFrameMeta *frame_meta = (NvDsFrameMeta *)(l_frame->data);
+        if (frame_meta->frame_user_meta_list)
+            nvds_clear_frame_user_meta_list(frame_meta, frame_meta->frame_user_meta_list);
+        frame_meta->frame_num++;
+    }
+}
+
+static void run_case(const ProbeCase *c, GstBuffer *buf, NvDsBatchMeta *batch_meta,
+                     guint iterations)
+{
+    GstPadProbeInfo info = { 0 };
+    info.type = GST_PAD_PROBE_TYPE_BUFFER;
+    info.data = buf;
+    guint frames = MAX(batch_meta->num_frames_in_batch, 1);
+
+    for (guint i = 0; i < WARMUP_ITERATIONS; i++) {
+        c->probe(NULL, &info, c->user_data);
+        if (c->after)
+            c->after(NULL, &info, c->after_data);
+        next_frame(batch_meta);
+    }
+
+    guint64 *samples = g_new(guint64, iterations);
+    guint64 total_ns = 0, allocs = 0;
+    for (guint i = 0; i < iterations; i++) {
+        guint64 a0 = alloc_count_get();
+        guint64 t0 = bench_now_ns();
+        c->probe(NULL, &info, c->user_data);
+        if (c->after)
+            c->after(NULL, &info, c->after_data);
+        guint64 elapsed = bench_now_ns() - t0;
+        allocs += alloc_count_get() - a0;
+        samples[i] = elapsed;
+        total_ns += elapsed;
+        next_frame(batch_meta);
+    }
+
+    guint64 p50 = bench_percentile(samples, iterations, 50.0);
+    guint64 p99 = bench_percentile(samples, iterations, 99.0);
+    printf("  %-32s %9.1f ns/frame  p50 %9.1f  p99 %9.1f  %7.2f mallocs/frame\n",
+           c->name, (gdouble)total_ns / ((gdouble)iterations * frames),
+           (gdouble)p50 / frames, (gdouble)p99 / frames,
+           (gdouble)allocs / ((gdouble)iterations * frames));
+    g_free(samples);
+}
+
+int main(int argc, char **argv)
+{
+    guint iterations = MAX(bench_arg_uint(argc, argv, 1, 2000), 1);
+    SyntheticMetaParams params = {
+        .batch_size        = MAX(bench_arg_uint(argc, argv, 2, 4), 1),
+        .objects_per_frame = bench_arg_uint(argc, argv, 3, 40),
+        .plate_ratio       = bench_arg_uint(argc, argv, 4, 60) / 100.0,
+        .label_cardinality = MAX(bench_arg_uint(argc, argv, 5, 20), 1),
+        .seed              = 7,
+    };
+
+    const char *dir = argc > 6 ? argv[6] : "/tmp/traffic-guard-bench";
+
+    gst_init(&argc, &argv);
+    NvDsBatchMeta *batch_meta = synthetic_meta_new(&params);
+    GstBuffer *buf = wrap_batch(batch_meta);
+
+    PlateAssocOptions assoc_options = {
+        .score = PLATE_ASSOC_SCORE_CONTAINMENT, .min_score = 0.5f, .use_parent = TRUE,
+    };
+    PlateAssoc *plate_assoc = plate_assoc_new(&assoc_options);
+    MsgPool *pool = msg_pool_new(4096);
+
+    TrackStateOptions track_options = {
+        .max_tracks = 4096, .heartbeat_frames = 300, .lost_after_frames = 90,
+    };
+    ProbeSendContext per_object = { .pool = pool };
+    ProbeSendContext tracked = { .pool = pool, .tracks = track_state_new(&track_options) };
+
+    TrackConsensusOptions consensus_options = {
+        .max_tracks = 4096, .ttl_frames = 90, .min_votes = 5, .min_share = 0.7f,
+        .recheck_frames = 150, .require_plate = TRUE,
+    };
+    ProbeSendContext full = {
+        .pool      = pool,
+        .tracks    = track_state_new(&track_options),
+        .consensus = track_consensus_new(&consensus_options),
+    };
+
+    DetectionWriterOptions writer_options = {
+        .format = DETECTION_FORMAT_BINARY, .queue_frames = 1024,
+        .flush_interval_ms = 250, .segment_bytes = 64ull << 20,
+    };
+    DetectionWriter *writer = g_mkdir_with_parents(dir, 0755) == 0
+                            ? detection_writer_new(dir, &writer_options) : NULL;
+
+    MetaStage *send_per_object = meta_stage_new();
+    meta_stage_add_consumer(send_per_object, "send", probe_send, &per_object);
+    MetaStage *send_tracked = meta_stage_new();
+    meta_stage_add_consumer(send_tracked, "send", probe_send, &tracked);
+    MetaStage *detections = meta_stage_new();
+    MetaStage *director = meta_stage_new();
+    meta_stage_add_consumer(director, "consensus", probe_consensus_vote, full.consensus);
+    meta_stage_add_consumer(director, "send", probe_send, &full);
+    if (writer) {
+        meta_stage_add_consumer(detections, "detections", probe_write_detections, writer);
+        meta_stage_add_consumer(director, "detections", probe_write_detections, writer);
+    }
+
+    /* Same order as the pipeline, so later probes see what earlier ones left. */
+    const ProbeCase cases[] = {
+        { "match_tracker_ids",              probe_match_tracker_ids, plate_assoc, NULL, NULL },
+        { "meta_stage[send per object]",    meta_stage_probe, send_per_object,    NULL, NULL },
+        { "meta_stage[send track events]",  meta_stage_probe, send_tracked,       NULL, NULL },
+        { "meta_stage[detections]",         meta_stage_probe, detections,         NULL, NULL },
+        { "meta_stage[consensus+send+det]", meta_stage_probe, director,           NULL, NULL },
+        { "consensus_gate+restore",         probe_consensus_gate, full.consensus,
+                                            probe_consensus_restore, NULL },
+        { "drop_frame",                     probe_drop_frame, NULL,               NULL, NULL },
+    };
+
+    printf("%u iterations, batch %u, %u objects/frame, plate ratio %.2f, %u labels\n",
+           iterations, params.batch_size, params.objects_per_frame, params.plate_ratio,
+           params.label_cardinality);
+    if (!writer)
+        printf("  (no detection writer: detections cases run without a consumer)\n");
+    for (guint i = 0; i < G_N_ELEMENTS(cases); i++)
+        run_case(&cases[i], buf, batch_meta, iterations);
+
+    /* The cheapest probe again, through the probe_stats wrapper: the difference is its overhead. */
+    ProbeStatsSlot *slot = probe_stats_register("drop_frame", probe_drop_frame, NULL);
+    if (slot) {
+        const ProbeCase timed = { "drop_frame [probe_stats]", probe_stats_probe, slot, NULL, NULL };
+        run_case(&timed, buf, batch_meta, iterations);
+        probe_stats_log();
+    }
+
+    meta_stage_free(send_per_object);
+    meta_stage_free(send_tracked);
+    meta_stage_free(detections);
+    meta_stage_free(director);
+    detection_writer_free(writer);
+    track_state_free(tracked.tracks);
+    track_state_free(full.tracks);
+    track_consensus_free(full.consensus);
+    gst_buffer_unref(buf);
+    nvds_destroy_batch_meta(batch_meta);
+    msg_pool_free(pool);
+    plate_assoc_free(plate_assoc);
+    return 0;
+}
@@ -0,0 +1,389 @@
+/*
+ * CPU benchmark and self-check for TrackConsensus.
+ *
+ * Simulated classifiers: make and type are right with probability 0.8 at
+ * confidence 0.6..1.0 and otherwise report another label at 0.2..0.7; LPDNet
+ * finds the plate on 70% of frames and LPRNet reads it right 60% of the time,
+ * otherwise with one character wrong and a low attributeConfidence.  Each
+ * frame goes through the real gate on a hand-built NvDsFrameMeta: masked cars
+ * get no classifier output, like the SGIEs behind operate-on-class-ids would
+ * give.  Compares what probe_send would report per car-frame, the frame's own
+ * labels against the voted ones, and counts SGIE runs saved.  Fixed checks
+ * cover the vote arithmetic, the class_id round trip on a synthetic batch and
+ * the table bound.
+ *
+ * usage: bench_track_consensus [tracks] [concurrent] [min_votes] [min_share_pct] [recheck]
+ */
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+
+#include "bench_util.h"
+#include "synthetic_meta.h"
+#include "frame_index.h"
+#include "track_consensus.h"
+
+#define N_BRANDS 20
+#define N_TYPES  6
+
+typedef struct {
+    gint64          start;
+    guint           length;
+    guint           brand;
+    guint           type;
+    gchar           plate[12];
+    NvDsObjectMeta  obj;
+    GList           link;
+} SimTrack;
+
+typedef struct {
+    guint64 car_frames;
+    guint64 sgie_runs;
+    guint64 raw_right[CONSENSUS_N_ATTRS];
+    guint64 voted_right[CONSENSUS_N_ATTRS];
+    guint64 stable_frames;
+    guint64 stable_wrong;
+    guint64 ns;
+    TrackConsensusStats stats;
+} SimResult;
+
+static gboolean check(gboolean cond, const gchar *what)
+{
+    if (!cond)
+        printf("  FAILED: %s\n", what);
+    return cond;
+}
+
+static gchar brands[N_BRANDS][16];
+static gchar types[N_TYPES][16];
+
+static guint noisy_index(GRand *rand, guint truth, guint n, gfloat *prob)
+{
+    if (g_rand_double(rand) < 0.8) {
+        *prob = (gfloat)g_rand_double_range(rand, 0.6, 1.0);
+        return truth;
+    }
+    *prob = (gfloat)g_rand_double_range(rand, 0.2, 0.7);
+    return (truth + 1 + (guint)g_rand_int_range(rand, 0, (gint32)n - 1)) % n;
+}
+
+/* NULL when LPDNet missed the plate this frame. */
+static const gchar *noisy_plate(GRand *rand, const SimTrack *t, gchar *buf, gfloat *prob)
+{
+    if (g_rand_double(rand) >= 0.7)
+        return NULL;
+    memcpy(buf, t->plate, sizeof(t->plate));
+    if (g_rand_double(rand) < 0.6) {
+        *prob = (gfloat)g_rand_double_range(rand, 0.5, 0.95);
+    } else {
+        gsize pos = (gsize)g_rand_int_range(rand, 0, (gint32)strlen(buf));
+        buf[pos] = buf[pos] == '8' ? 'B' : '8';
+        *prob = (gfloat)g_rand_double_range(rand, 0.1, 0.6);
+    }
+    return buf;
+}
+
+static gint cmp_start(gconstpointer a, gconstpointer b, gpointer data)
+{
+    const SimTrack *tracks = data;
+    gint64 x = tracks[*(const guint *)a].start, y = tracks[*(const guint *)b].start;
+    return (x > y) - (x < y);
+}
+
+static SimTrack *make_tracks(guint n_tracks, guint concurrent, guint32 seed, gint64 *last_frame)
+{
+    GRand *rand = g_rand_new_with_seed(seed);
+    SimTrack *tracks = g_new0(SimTrack, n_tracks);
+    gint64 span = MAX((gint64)n_tracks * 315 / MAX(concurrent, 1), 1);
+    *last_frame = 0;
+    for (guint i = 0; i < n_tracks; i++) {
+        SimTrack *t = &tracks[i];
+        t->start  = g_rand_int_range(rand, 0, (gint32)MIN(span, G_MAXINT32));
+        t->length = (guint)g_rand_int_range(rand, 30, 601);
+        t->brand  = (guint)g_rand_int_range(rand, 0, N_BRANDS);
+        t->type   = (guint)g_rand_int_range(rand, 0, N_TYPES);
+        g_snprintf(t->plate, sizeof(t->plate), "%c%c%c%04u",
+                   'A' + i % 26, 'A' + (i / 26) % 26, 'A' + (i / 676) % 26, i % 10000);
+        t->obj.unique_component_id = GIE_ID_VEHICLE_DETECTOR;
+        t->obj.class_id            = 0;
+        t->obj.object_id           = i + 1;
+        t->link.data               = &t->obj;
+        *last_frame = MAX(*last_frame, t->start + t->length);
+    }
+    g_rand_free(rand);
+    return tracks;
+}
+
+static SimResult simulate(SimTrack *tracks, guint n_tracks, const TrackConsensusOptions *options,
+                          gint64 last_frame, gboolean gate)
+{
+    SimResult res = { 0 };
+    TrackConsensus *tc = track_consensus_new(options);
+    GRand *rand = g_rand_new_with_seed(7);
+    NvDsFrameMeta frame_meta;
+    memset(&frame_meta, 0, sizeof(frame_meta));
+
+    guint *order  = g_new(guint, n_tracks);
+    guint *active = g_new(guint, n_tracks);
+    guint n_active = 0, next = 0;
+    for (guint i = 0; i < n_tracks; i++)
+        order[i] = i;
+    g_qsort_with_data(order, (gint)n_tracks, sizeof(guint), cmp_start, tracks);
+
+    for (gint64 f = 0; f <= last_frame; f++) {
+        while (next < n_tracks && tracks[order[next]].start <= f)
+            active[n_active++] = order[next++];
+
+        /* Chain the live cars into the frame's object list. */
+        GList *head = NULL;
+        for (guint k = 0; k < n_active; k++) {
+            SimTrack *t = &tracks[active[k]];
+            t->link.next = head;
+            t->link.prev = NULL;
+            if (head)
+                head->prev = &t->link;
+            head = &t->link;
+        }
+        frame_meta.obj_meta_list = head;
+        frame_meta.frame_num     = f;
+
+        guint64 t0 = bench_now_ns();
+        track_consensus_advance(tc, 0, f);
+        if (gate)
+            track_consensus_gate_frame(tc, &frame_meta);
+        res.ns += bench_now_ns() - t0;
+
+        for (guint k = 0; k < n_active; k++) {
+            SimTrack *t = &tracks[active[k]];
+            guint64 id = t->obj.object_id;
+            gboolean skipped = t->obj.class_id >= TRACK_CONSENSUS_CLASS_OFFSET;
+            const gchar *brand = NULL, *type = NULL, *plate = NULL;
+            gfloat brand_prob = 0, type_prob = 0, plate_prob = 0;
+            gchar plate_buf[sizeof(t->plate)];
+
+            res.car_frames++;
+            if (!skipped) {
+                res.sgie_runs++;
+                brand = brands[noisy_index(rand, t->brand, N_BRANDS, &brand_prob)];
+                type  = types[noisy_index(rand, t->type, N_TYPES, &type_prob)];
+                plate = noisy_plate(rand, t, plate_buf, &plate_prob);
+            }
+
+            t0 = bench_now_ns();
+            track_consensus_vote(tc, 0, id, CONSENSUS_BRAND, brand, brand_prob);
+            if (type)
+                track_consensus_vote(tc, 0, id, CONSENSUS_TYPE, type, type_prob);
+            if (plate)
+                track_consensus_vote(tc, 0, id, CONSENSUS_PLATE, plate, plate_prob);
+            TrackConsensusView view;
+            gboolean known = track_consensus_lookup(tc, 0, id, &view);
+            res.ns += bench_now_ns() - t0;
+
+            res.raw_right[CONSENSUS_BRAND] += brand && brand == brands[t->brand];
+            res.raw_right[CONSENSUS_TYPE]  += type && type == types[t->type];
+            res.raw_right[CONSENSUS_PLATE] += plate && strcmp(plate, t->plate) == 0;
+            if (known) {
+                gboolean b = strcmp(view.brand, brands[t->brand]) == 0;
+                gboolean y = strcmp(view.type, types[t->type]) == 0;
+                gboolean p = strcmp(view.plate, t->plate) == 0;
+                res.voted_right[CONSENSUS_BRAND] += b;
+                res.voted_right[CONSENSUS_TYPE]  += y;
+                res.voted_right[CONSENSUS_PLATE] += p;
+                if (view.stable) {
+                    res.stable_frames++;
+                    res.stable_wrong += !(b && y && p);
+                }
+            }
+        }
+
+        if (gate)
+            track_consensus_restore_frame(&frame_meta);
+
+        for (guint k = 0; k < n_active; ) {
+            const SimTrack *t = &tracks[active[k]];
+            if (f >= t->start + (gint64)t->length - 1)
+                active[k] = active[--n_active];
+            else
+                k++;
+        }
+    }
+    track_consensus_get_stats(tc, &res.stats);
+    track_consensus_free(tc);
+    g_rand_free(rand);
+    g_free(order);
+    g_free(active);
+    return res;
+}
+
+static gboolean check_votes(void)
+{
+    gboolean ok = TRUE;
+    TrackConsensusOptions options = { .max_tracks = 8, .ttl_frames = 10, .min_votes = 3,
+                                      .min_share = 0.7f, .require_plate = FALSE };
+    TrackConsensus *tc = track_consensus_new(&options);
+    TrackConsensusView view;
+
+    track_consensus_advance(tc, 0, 1);
+    track_consensus_vote(tc, 0, 5, CONSENSUS_BRAND, "ford", 0.9f);
+    track_consensus_vote(tc, 0, 5, CONSENSUS_TYPE, "suv", 0.9f);
+    track_consensus_advance(tc, 0, 2);
+    track_consensus_vote(tc, 0, 5, CONSENSUS_BRAND, "kia", 0.4f);
+    track_consensus_vote(tc, 0, 5, CONSENSUS_TYPE, "suv", 0.9f);
+    track_consensus_lookup(tc, 0, 5, &view);
+    ok &= check(strcmp(view.brand, "ford") == 0, "heavier label leads");
+    ok &= check(!view.stable, "not stable below min_votes");
+
+    track_consensus_advance(tc, 0, 3);
+    track_consensus_vote(tc, 0, 5, CONSENSUS_BRAND, "ford", 0.8f);
+    track_consensus_vote(tc, 0, 5, CONSENSUS_TYPE, "suv", 0.9f);
+    track_consensus_lookup(tc, 0, 5, &view);
+    /* ford 1.7 of 2.1 = 0.81 */
+    ok &= check(view.stable, "stable once share and votes are met");
+    ok &= check(view.share[CONSENSUS_BRAND] > 0.80f && view.share[CONSENSUS_BRAND] < 0.82f,
+                "share is the winner's weight over the total");
+
+    track_consensus_advance(tc, 0, 4);
+    track_consensus_vote(tc, 0, 5, CONSENSUS_BRAND, "kia", 1.0f);
+    track_consensus_lookup(tc, 0, 5, &view);
+    ok &= check(!view.stable && strcmp(view.brand, "ford") == 0,
+                "contradicting votes drop stability but keep the leader");
+
+    /* Space-saving: a fifth label takes the lightest slot and inherits its weight. */
+    const gchar *labels[] = { "a", "b", "c", "d" };
+    track_consensus_advance(tc, 1, 1);
+    for (guint i = 0; i < 4; i++)
+        track_consensus_vote(tc, 1, 9, CONSENSUS_TYPE, labels[i], 0.1f * (gfloat)(i + 1));
+    track_consensus_vote(tc, 1, 9, CONSENSUS_TYPE, "e", 0.35f);
+    track_consensus_lookup(tc, 1, 9, &view);
+    ok &= check(strcmp(view.type, "e") == 0, "replacement inherits the evicted weight");
+
+    ok &= check(!track_consensus_lookup(tc, 1, 5, &view), "sources are separate keys");
+    track_consensus_advance(tc, 0, 20);
+    track_consensus_vote(tc, 0, 6, CONSENSUS_BRAND, "bmw", 1.0f);
+    track_consensus_advance(tc, 0, 40);
+    track_consensus_vote(tc, 0, 6, CONSENSUS_BRAND, "bmw", 1.0f);
+    ok &= check(!track_consensus_lookup(tc, 0, 5, &view), "unseen tracks expire");
+
+    track_consensus_free(tc);
+    return ok;
+}
+
+/* Real NvDsBatchMeta: every labelled car becomes stable on its first vote and must come back unchanged. */
+static gboolean check_batch(void)
+{
+    gboolean ok = TRUE;
+    SyntheticMetaParams params = { .batch_size = 4, .objects_per_frame = 60, .plate_ratio = 0.5,
+                                   .label_cardinality = 10, .seed = 3 };
+    NvDsBatchMeta *batch_meta = synthetic_meta_new(&params);
+    FrameIndex *index = frame_index_new();
+    TrackConsensusOptions options = { .max_tracks = 1024, .ttl_frames = 30, .min_votes = 1,
+                                      .min_share = 0.5f, .require_plate = FALSE };
+    TrackConsensus *tc = track_consensus_new(&options);
+    guint cars = 0, labelled = 0, matched = 0, masked = 0;
+
+    for (NvDsMetaList *l_frame = batch_meta->frame_meta_list; l_frame; l_frame = l_frame->next) {
+        NvDsFrameMeta *frame_meta = l_frame->data;
+        frame_index_build(index, batch_meta, frame_meta);
+        track_consensus_vote_frame(tc, index);
+
+        const FrameIndexBucket *bucket = frame_index_bucket(index, GIE_ID_VEHICLE_DETECTOR);
+        for (guint i = 0; i < bucket->n; i++) {
+            const FrameIndexObject *e = &bucket->items[i];
+            TrackConsensusView view;
+            cars++;
+            if (!e->brand || !e->type)
+                continue;
+            labelled++;
+            matched += track_consensus_lookup(tc, frame_meta->source_id, e->obj->object_id, &view) &&
+                       strcmp(view.brand, e->brand) == 0 && strcmp(view.type, e->type) == 0 &&
+                       view.stable;
+        }
+
+        masked += track_consensus_gate_frame(tc, frame_meta);
+        track_consensus_restore_frame(frame_meta);
+        for (NvDsMetaList *l = frame_meta->obj_meta_list; l; l = l->next)
+            ok &= check(((NvDsObjectMeta *)l->data)->class_id == 0, "class_id restored");
+    }
+    ok &= check(labelled > 0 && matched == labelled, "vote_frame records every labelled car");
+    ok &= check(masked == labelled, "gate masks exactly the stable cars");
+    printf("  synthetic batch: %u cars, %u labelled, %u voted back, %u masked\n",
+           cars, labelled, matched, masked);
+
+    track_consensus_free(tc);
+    frame_index_free(index);
+    nvds_destroy_batch_meta(batch_meta);
+    return ok;
+}
+
+static gdouble pct(guint64 n, guint64 d)
+{
+    return 100.0 * (gdouble)n / (gdouble)MAX(d, 1);
+}
+
+int main(int argc, char **argv)
+{
+    guint n_tracks   = MAX(bench_arg_uint(argc, argv, 1, 5000), 1);
+    guint concurrent = MAX(bench_arg_uint(argc, argv, 2, 100), 1);
+    guint min_votes  = bench_arg_uint(argc, argv, 3, 5);
+    guint share_pct  = MIN(bench_arg_uint(argc, argv, 4, 70), 100u);
+    guint recheck    = bench_arg_uint(argc, argv, 5, 150);
+    gboolean ok = TRUE;
+
+    for (guint i = 0; i < N_BRANDS; i++)
+        g_snprintf(brands[i], sizeof(brands[i]), "make%02u", i);
+    for (guint i = 0; i < N_TYPES; i++)
+        g_snprintf(types[i], sizeof(types[i]), "type%u", i);
+
+    printf("vote checks\n");
+    ok &= check_votes();
+    ok &= check_batch();
+
+    gint64 last_frame;
+    SimTrack *tracks = make_tracks(n_tracks, concurrent, 42, &last_frame);
+    last_frame += 2 * 90 + 2;
+    TrackConsensusOptions options = {
+        .max_tracks     = concurrent * 4,
+        .ttl_frames     = 90,
+        .min_votes      = min_votes,
+        .min_share      = share_pct / 100.0f,
+        .recheck_frames = recheck,
+        .require_plate  = TRUE,
+    };
+
+    SimResult open  = simulate(tracks, n_tracks, &options, last_frame, FALSE);
+    SimResult gated = simulate(tracks, n_tracks, &options, last_frame, TRUE);
+
+    printf("%u tracks, ~%u concurrent, min_votes %u, min_share %u%%, recheck %u\n",
+           n_tracks, concurrent, min_votes, share_pct, recheck);
+    static const gchar *names[] = { "make", "type", "plate" };
+    for (gint a = 0; a < CONSENSUS_N_ATTRS; a++)
+        printf("  %-5s right per car-frame: frame label %5.1f%%, voted %5.1f%%, voted+skip %5.1f%%\n",
+               names[a], pct(open.raw_right[a], open.car_frames),
+               pct(open.voted_right[a], open.car_frames), pct(gated.voted_right[a], gated.car_frames));
+    printf("  SGIE runs: %" G_GUINT64_FORMAT " of %" G_GUINT64_FORMAT " car-frames (%.1f%% skipped, %"
+           G_GUINT64_FORMAT " rechecks)\n",
+           gated.sgie_runs, gated.car_frames, 100.0 - pct(gated.sgie_runs, gated.car_frames),
+           gated.stats.rechecks);
+    printf("  stable car-frames with a wrong label: %" G_GUINT64_FORMAT " of %" G_GUINT64_FORMAT
+           " (%.2f%%)\n", gated.stable_wrong, gated.stable_frames,
+           pct(gated.stable_wrong, gated.stable_frames));
+    printf("  %.1f ns/car-frame, %u tracks left, %" G_GUINT64_FORMAT " evicted\n",
+           (gdouble)gated.ns / MAX(gated.car_frames, 1), gated.stats.tracks, gated.stats.evicted);
+
+    for (gint a = 0; a < CONSENSUS_N_ATTRS; a++)
+        ok &= check(open.voted_right[a] > open.raw_right[a], "voting beats the frame's own label");
+    ok &= check(gated.sgie_runs < gated.car_frames / 2, "stable tracks skip most SGIE runs");
+    ok &= check(gated.stable_wrong * 100 <= gated.stable_frames, "under 1% of stable car-frames wrong");
+    ok &= check(gated.stats.tracks == 0 && gated.stats.evicted == 0, "every track expires, none evicted");
+
+    /* Bounded memory: a quarter-size table evicts instead of growing. */
+    options.max_tracks = MAX(concurrent / 4, 1);
+    SimResult tight = simulate(tracks, n_tracks, &options, last_frame, TRUE);
+    printf("  max_tracks %u: %" G_GUINT64_FORMAT " evicted, peak bound held: %s\n",
+           options.max_tracks, tight.stats.evicted,
+           tight.stats.tracks <= options.max_tracks ? "yes" : "no");
+    ok &= check(tight.stats.tracks <= options.max_tracks && tight.stats.evicted > 0, "table bound");
+
+    g_free(tracks);
+    return ok ? 0 : 1;
+}
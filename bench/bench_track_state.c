@@ -0,0 +1,247 @@
+/*
+ * CPU benchmark and self-check for TrackState on synthetic object sequences.
+ *
+ * Tracks enter at random frames, live 30..600 frames with occasional short
+ * occlusions, get make/type two frames in and a plate fifteen frames in.  A
+ * per-track reference model predicts NEW, CHANGED and HEARTBEAT counts
+ * exactly; LOST must fire once per track, between lost_after and twice that
+ * after the last sighting.  A second run with a table smaller than the live
+ * track count checks that memory stays bounded.
+ *
+ * usage: bench_track_state [tracks] [concurrent] [heartbeat] [lost_after]
+ */
+#include <stdio.h>
+#include <glib.h>
+
+#include "bench_util.h"
+#include "track_state.h"
+
+#define LABEL_FRAME 2
+#define PLATE_FRAME 15
+
+typedef struct {
+    gint64   start;
+    guint    length;
+    guint32  occlusion_seed;
+    gchar    plate[16];
+    gint64   last_seen;
+    gint64   lost_at;
+    guint    events[TRACK_EVENT_LOST + 1];
+} SimTrack;
+
+static gboolean visible(const SimTrack *t, gint64 frame)
+{
+    if (frame < t->start || frame >= t->start + t->length)
+        return FALSE;
+    guint64 rel = (guint64)(frame - t->start);
+    /* Short occlusions: a few frames dropped now and then, never the first. */
+    return rel == 0 || ((rel * 2654435761u) ^ t->occlusion_seed) % 23 != 0;
+}
+
+static void labels_for(const SimTrack *t, gint64 frame, gint idx,
+                       const gchar **brand, const gchar **type, const gchar **plate)
+{
+    gint64 rel = frame - t->start;
+    static const gchar *brands[] = { "toyota", "ford", "bmw", "honda", "kia" };
+    static const gchar *types[]  = { "sedan", "suv", "truck", "van" };
+    *brand = rel >= LABEL_FRAME ? brands[idx % 5] : NULL;
+    *type  = rel >= LABEL_FRAME ? types[idx % 4] : NULL;
+    *plate = rel >= PLATE_FRAME ? t->plate : NULL;
+}
+
+/* Independent replay of one track: which events the policy should produce while it is visible. */
+static void reference(const SimTrack *t, guint heartbeat, guint expect[TRACK_EVENT_LOST + 1])
+{
+    gint64 last_emitted = 0;
+    gboolean announced = FALSE, have_labels = FALSE, have_plate = FALSE;
+    for (gint64 f = t->start; f < t->start + t->length; f++) {
+        if (!visible(t, f))
+            continue;
+        gint64 rel = f - t->start;
+        gboolean dirty = FALSE;
+        if (rel >= LABEL_FRAME && !have_labels) { have_labels = TRUE; dirty = TRUE; }
+        if (rel >= PLATE_FRAME && !have_plate)  { have_plate = TRUE;  dirty = TRUE; }
+
+        TrackEvent ev = TRACK_EVENT_NONE;
+        if (!announced)
+            ev = TRACK_EVENT_NEW;
+        else if (dirty)
+            ev = TRACK_EVENT_CHANGED;
+        else if (heartbeat && f - last_emitted >= (gint64)heartbeat)
+            ev = TRACK_EVENT_HEARTBEAT;
+        if (ev != TRACK_EVENT_NONE) {
+            expect[ev]++;
+            announced = TRUE;
+            last_emitted = f;
+        }
+    }
+}
+
+typedef struct {
+    SimTrack *tracks;
+    gint64    frame;
+} EmitCtx;
+
+static void on_event(const TrackInfo *info, TrackEvent event, gpointer user_data)
+{
+    EmitCtx *ctx = user_data;
+    SimTrack *t = &ctx->tracks[info->object_id - 1];
+    t->events[event]++;
+    if (event == TRACK_EVENT_LOST)
+        t->lost_at = ctx->frame;
+}
+
+typedef struct {
+    guint64 observations;
+    guint64 ns;
+    TrackStateStats stats;
+} SimResult;
+
+static gint cmp_start(gconstpointer a, gconstpointer b, gpointer data)
+{
+    const SimTrack *tracks = data;
+    gint64 x = tracks[*(const guint *)a].start, y = tracks[*(const guint *)b].start;
+    return (x > y) - (x < y);
+}
+
+static SimResult simulate(SimTrack *tracks, guint n_tracks, const TrackStateOptions *options,
+                          gint64 last_frame)
+{
+    SimResult res = { 0 };
+    TrackState *state = track_state_new(options);
+    EmitCtx ctx = { tracks, 0 };
+
+    /* Walk only tracks in their lifetime so the timing is TrackState, not the scene. */
+    guint *order  = g_new(guint, n_tracks);
+    guint *active = g_new(guint, n_tracks);
+    guint n_active = 0, next = 0;
+    for (guint i = 0; i < n_tracks; i++)
+        order[i] = i;
+    g_qsort_with_data(order, (gint)n_tracks, sizeof(guint), cmp_start, tracks);
+
+    for (gint64 f = 0; f <= last_frame; f++) {
+        while (next < n_tracks && tracks[order[next]].start <= f)
+            active[n_active++] = order[next++];
+
+        ctx.frame = f;
+        guint64 t0 = bench_now_ns();
+        track_state_begin_frame(state, 0, f, on_event, &ctx);
+        for (guint k = 0; k < n_active; k++) {
+            guint i = active[k];
+            SimTrack *t = &tracks[i];
+            if (!visible(t, f))
+                continue;
+            const gchar *brand, *type, *plate;
+            labels_for(t, f, (gint)i, &brand, &type, &plate);
+            track_state_observe(state, i + 1, brand, type, plate);
+            t->last_seen = f;
+            res.observations++;
+        }
+        track_state_end_frame(state, on_event, &ctx);
+        res.ns += bench_now_ns() - t0;
+
+        for (guint k = 0; k < n_active; ) {
+            const SimTrack *t = &tracks[active[k]];
+            if (f >= t->start + (gint64)t->length - 1)
+                active[k] = active[--n_active];
+            else
+                k++;
+        }
+    }
+    track_state_get_stats(state, &res.stats);
+    track_state_free(state);
+    g_free(order);
+    g_free(active);
+    return res;
+}
+
+static SimTrack *make_tracks(guint n_tracks, guint concurrent, guint32 seed, gint64 *last_frame)
+{
+    GRand *rand = g_rand_new_with_seed(seed);
+    SimTrack *tracks = g_new0(SimTrack, n_tracks);
+    /* Arrivals spread so about `concurrent` tracks overlap on average (mean life 315 frames). */
+    gint64 span = MAX((gint64)n_tracks * 315 / MAX(concurrent, 1), 1);
+    *last_frame = 0;
+    for (guint i = 0; i < n_tracks; i++) {
+        tracks[i].start          = g_rand_int_range(rand, 0, (gint32)MIN(span, G_MAXINT32));
+        tracks[i].length         = (guint)g_rand_int_range(rand, 30, 601);
+        tracks[i].occlusion_seed = g_rand_int(rand);
+        tracks[i].last_seen      = -1;
+        tracks[i].lost_at        = -1;
+        g_snprintf(tracks[i].plate, sizeof(tracks[i].plate), "PL%05u", i);
+        *last_frame = MAX(*last_frame, tracks[i].start + tracks[i].length);
+    }
+    g_rand_free(rand);
+    return tracks;
+}
+
+int main(int argc, char **argv)
+{
+    guint n_tracks   = MAX(bench_arg_uint(argc, argv, 1, 5000), 1);
+    guint concurrent = MAX(bench_arg_uint(argc, argv, 2, 100), 1);
+    guint heartbeat  = bench_arg_uint(argc, argv, 3, 300);
+    guint lost_after = MAX(bench_arg_uint(argc, argv, 4, 90), 1);
+    gboolean ok = TRUE;
+
+    gint64 last_frame;
+    SimTrack *tracks = make_tracks(n_tracks, concurrent, 42, &last_frame);
+    /* Run past the last exit long enough for every track to be swept. */
+    last_frame += 2 * lost_after + 2;
+
+    TrackStateOptions options = {
+        .max_tracks        = concurrent * 4,
+        .heartbeat_frames  = heartbeat,
+        .lost_after_frames = lost_after,
+    };
+    SimResult res = simulate(tracks, n_tracks, &options, last_frame);
+
+    guint bad_events = 0, bad_lost = 0;
+    for (guint i = 0; i < n_tracks; i++) {
+        guint expect[TRACK_EVENT_LOST + 1] = { 0 };
+        reference(&tracks[i], heartbeat, expect);
+        if (tracks[i].events[TRACK_EVENT_NEW] != expect[TRACK_EVENT_NEW] ||
+            tracks[i].events[TRACK_EVENT_CHANGED] != expect[TRACK_EVENT_CHANGED] ||
+            tracks[i].events[TRACK_EVENT_HEARTBEAT] != expect[TRACK_EVENT_HEARTBEAT])
+            bad_events++;
+        gint64 latency = tracks[i].lost_at - tracks[i].last_seen;
+        if (tracks[i].events[TRACK_EVENT_LOST] != 1 ||
+            latency < (gint64)lost_after || latency > 2 * (gint64)lost_after + 1)
+            bad_lost++;
+    }
+
+    const TrackStateStats *st = &res.stats;
+    guint64 emitted = st->emitted[TRACK_EVENT_NEW] + st->emitted[TRACK_EVENT_CHANGED] +
+                      st->emitted[TRACK_EVENT_HEARTBEAT] + st->emitted[TRACK_EVENT_LOST];
+    printf("%u tracks, ~%u concurrent, %" G_GINT64_FORMAT " frames, heartbeat %u, lost after %u\n",
+           n_tracks, concurrent, last_frame + 1, heartbeat, lost_after);
+    printf("  %" G_GUINT64_FORMAT " observations -> %" G_GUINT64_FORMAT " messages"
+           " (new %" G_GUINT64_FORMAT ", changed %" G_GUINT64_FORMAT ", heartbeat %" G_GUINT64_FORMAT
+           ", lost %" G_GUINT64_FORMAT "), %" G_GUINT64_FORMAT " suppressed, %.1fx fewer\n",
+           res.observations, emitted, st->emitted[TRACK_EVENT_NEW], st->emitted[TRACK_EVENT_CHANGED],
+           st->emitted[TRACK_EVENT_HEARTBEAT], st->emitted[TRACK_EVENT_LOST], st->suppressed,
+           (gdouble)res.observations / MAX(emitted, 1));
+    printf("  %.1f ns/observation, %u tracks left, %" G_GUINT64_FORMAT " evicted\n",
+           (gdouble)res.ns / MAX(res.observations, 1), st->tracks, st->evicted);
+    if (bad_events || bad_lost || st->evicted || st->tracks) {
+        printf("  MISMATCH: %u tracks with wrong new/changed/heartbeat counts, %u with a wrong lost event\n",
+               bad_events, bad_lost);
+        ok = FALSE;
+    }
+
+    /* Bounded memory: a table a quarter of the live set evicts instead of growing. */
+    SimTrack *crowd = make_tracks(n_tracks, concurrent, 43, &last_frame);
+    TrackStateOptions small = { .max_tracks = MAX(concurrent / 4, 1),
+                                .heartbeat_frames = heartbeat, .lost_after_frames = lost_after };
+    SimResult tight = simulate(crowd, n_tracks, &small, last_frame);
+    printf("  max_tracks %u: %" G_GUINT64_FORMAT " evicted, %" G_GUINT64_FORMAT " overflowed, peak bound held: %s\n",
+           small.max_tracks, tight.stats.evicted, tight.stats.overflow,
+           tight.stats.tracks <= small.max_tracks ? "yes" : "no");
+    if (tight.stats.tracks > small.max_tracks || tight.stats.evicted == 0) {
+        printf("  BOUND VIOLATED\n");
+        ok = FALSE;
+    }
+
+    g_free(tracks);
+    g_free(crowd);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,38 @@
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <stdlib.h>
+#include <time.h>
+#include <glib.h>
+
+static inline guint64 bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (guint64)ts.tv_sec * 1000000000ull + (guint64)ts.tv_nsec;
+}
+
+static inline int bench_cmp_u64(const void *a, const void *b)
+{
+    guint64 x = *(const guint64 *)a;
+    guint64 y = *(const guint64 *)b;
+    return (x > y) - (x < y);
+}
+
+/** Sorts samples in place; pct in [0, 100]. */
+static inline guint64 bench_percentile(guint64 *samples, gsize n, double pct)
+{
+    if (n == 0)
+        return 0;
+    qsort(samples, n, sizeof(*samples), bench_cmp_u64);
+    gsize idx = (gsize)((pct / 100.0) * (double)(n - 1) + 0.5);
+    return samples[MIN(idx, n - 1)];
+}
+
+/** argv[idx] as unsigned, or fallback when absent. */
+static inline guint bench_arg_uint(int argc, char **argv, int idx, guint fallback)
+{
+    return (idx < argc) ? (guint)strtoul(argv[idx], NULL, 10) : fallback;
+}
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef BROKER_LINK_H
+#define BROKER_LINK_H
+
+#include <glib.h>
+
+/** From the "msgbroker" section of the app YAML (MsgbrokerConfig in pipeline_config.h). */
+typedef struct {
+    gchar *proto_lib;   /* msgapi adapter, e.g. libnvds_mqtt_proto.so */
+    gchar *conn_str;    /* "host;port" */
+    gchar *topic;
+    gchar *config;      /* adapter config file; NULL for none */
+} BrokerLinkOptions;
+
+void        broker_link_options_clear(BrokerLinkOptions *options);
+
+/**
+ * A connection of its own to the broker nvmsgbroker publishes to, through
+ * the same DeepStream msgapi adapter library, for sending outside the
+ * pipeline.  Sends are synchronous.  The adapter reports a lost connection
+ * through its callback, which may run on any thread; everything else
+ * belongs to one thread.
+ */
+typedef struct BrokerLink BrokerLink;
+
+/** Loads the adapter without connecting; NULL (logged) without proto-lib or when it cannot be loaded. */
+BrokerLink *broker_link_new(const BrokerLinkOptions *options);
+void        broker_link_free(BrokerLink *link);
+
+/** Connects when not connected; TRUE when connected afterwards. */
+gboolean    broker_link_connect(BrokerLink *link);
+/** Publishes payload on the topic; a failure drops the connection for the next connect. */
+gboolean    broker_link_send(BrokerLink *link, const guint8 *payload, gsize len);
+
+#endif
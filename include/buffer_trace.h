@@ -0,0 +1,33 @@
+#ifndef BUFFER_TRACE_H
+#define BUFFER_TRACE_H
+
+#include <gst/gst.h>
+
+/* Elements a trace can tell apart; the rest are not stamped. */
+#define BUFFER_TRACE_MAX_ELEMENTS 256
+
+/**
+ * Per-buffer latency trace of a built pipeline.  Every buffer leaving an
+ * element, or arriving at a sink, is stamped with the time, the element and
+ * the calling thread, keyed by PTS and source id: one stamp per frame of a
+ * batch, from its NvDsFrameMeta, and the source bin's index before the muxer.
+ * Stamps go to a lock-free ring of the streaming thread's own; a collector
+ * thread moves them to memory every 50 ms, up to max_events, and counts
+ * what does not fit.  Without a BufferTrace no probe is attached.
+ *
+ * buffer_trace_write() writes a Chrome trace (chrome://tracing, Perfetto):
+ * one span per element and frame on the thread that pushed it, from the
+ * frame leaving the element upstream to leaving this one, and one async
+ * span per frame from its first stamp to its last.
+ */
+typedef struct BufferTrace BufferTrace;
+
+/** Probes every element of pipeline, bins entered; call once, after linking and before the pipeline starts. */
+BufferTrace *buffer_trace_new(GstElement *pipeline, const gchar *path, guint max_events);
+/** Stops the collector; call once the streaming threads have stopped. */
+void         buffer_trace_free(BufferTrace *trace);
+
+/** Writes everything stamped so far to path, replacing it whole; FALSE (logged) on an I/O error. */
+gboolean     buffer_trace_write(BufferTrace *trace);
+
+#endif
@@ -4,7 +4,97 @@
 /** Path from DEEPSTREAM_CONFIG_YAML, or DEEPSTREAM_CONFIG; default configs/deepstream_config.yml */
 const char *config_get_yaml_path(void);
 
-/** Directory from DETECTION_OUTPUT_DIR; default logs/detections */
-const char *config_get_detection_output_dir(void);
+/**
+ * Settings taken from the environment, read and checked once by
+ * config_load_settings() as part of pipeline_config_load().  Numbers are
+ * decimal and range-checked, flags are 0 or 1, and a choice holds one of the
+ * names listed for it (the static string, never the raw value).  Text points
+ * into the environment.
+ */
+typedef struct {
+    const char  *detection_output_dir;       /* DETECTION_OUTPUT_DIR; default logs/detections, "" for none */
+    unsigned int detection_queue_frames;     /* DETECTION_QUEUE_FRAMES, frames between the detection probe and its writer thread; default 1024 */
+    unsigned int detection_flush_interval_ms; /* DETECTION_FLUSH_INTERVAL_MS, writer wake-up period; default 250 */
+    const char  *detection_output_format;    /* DETECTION_OUTPUT_FORMAT, "text" or "binary"; default text */
+    unsigned int detection_segment_mb;       /* DETECTION_SEGMENT_MB, binary segment rollover size, 1..; default 64 */
+
+    const char  *plate_assoc_score;          /* PLATE_ASSOC_SCORE, "containment" or "iou"; default containment */
+    unsigned int plate_assoc_one_to_one;     /* PLATE_ASSOC_ONE_TO_ONE, limits each car to one plate; default 0 */
+    unsigned int msg_pool_blocks;            /* MSG_POOL_BLOCKS, pooled broker message blocks; default 4096 */
+
+    unsigned int track_events;               /* TRACK_EVENTS, broker messages on track events only; default 1 */
+    unsigned int track_max;                  /* TRACK_MAX, most tracks held for event state; default 4096 */
+    unsigned int track_heartbeat_frames;     /* TRACK_HEARTBEAT_FRAMES, between heartbeats of an unchanged track (0 = off); default 300 */
+    unsigned int track_lost_frames;          /* TRACK_LOST_FRAMES, unseen before a track is reported lost; default 90 */
+
+    unsigned int consensus;                  /* CONSENSUS, per-track voted labels instead of the current frame's; default 1 */
+    /* CONSENSUS_SKIP, with CONSENSUS lets the SGIEs skip cars whose votes are stable; default 0.
+     * Skipped cars get no plate detections either. */
+    unsigned int consensus_skip;
+    unsigned int consensus_min_votes;        /* CONSENSUS_MIN_VOTES, votes an attribute needs to be stable; default 5 */
+    unsigned int consensus_min_share_pct;    /* CONSENSUS_MIN_SHARE_PCT, winning label's share of the vote weight; default 70 */
+    unsigned int consensus_recheck_frames;   /* CONSENSUS_RECHECK_FRAMES, between SGIE re-runs on a stable car (0 = never); default 150 */
+
+    unsigned int probe_stats_interval_s;     /* PROBE_STATS_INTERVAL_S, between probe latency reports (0 = at EOS only); default 60 */
+    unsigned int metrics_port;               /* METRICS_PORT, Prometheus /metrics exporter (0 = off); default 0 */
+
+    const char  *pipeline_backend;           /* PIPELINE_BACKEND, "deepstream" or "software" (CPU elements plus fake inference); default deepstream */
+    unsigned int headless;                   /* HEADLESS, no OSD and render branch, throughput report at EOS; default 0 */
+    unsigned int fake_infer_objects;         /* FAKE_INFER_OBJECTS, software backend cars plus plates per frame; default 8 */
+    unsigned int fake_infer_plate_pct;       /* FAKE_INFER_PLATE_PCT, software backend plates per 100 cars; default 50 */
+    unsigned int fake_infer_seed;            /* FAKE_INFER_SEED, software backend seed of the synthetic objects; default 1 */
+
+    unsigned int load_control;               /* LOAD_CONTROL, sheds GIE work while the pipeline falls behind (load_control.h); default 0 */
+    unsigned int load_interval_ms;           /* LOAD_INTERVAL_MS, between load controller samples; default 500 */
+    unsigned int load_high_latency_ms;       /* LOAD_HIGH_LATENCY_MS, smoothed latency above which GIE work is shed; default 1000 */
+    unsigned int load_low_latency_ms;        /* LOAD_LOW_LATENCY_MS, smoothed latency below which shed work comes back; default 300 */
+    unsigned int load_high_queue_pct;        /* LOAD_HIGH_QUEUE_PCT, fill of the fullest queue above which GIE work is shed; default 80 */
+    unsigned int load_low_queue_pct;         /* LOAD_LOW_QUEUE_PCT, queue fill below which shed work comes back; default 30 */
+    unsigned int load_up_samples;            /* LOAD_UP_SAMPLES, hot samples in a row before shedding one more level; default 3 */
+    unsigned int load_down_samples;          /* LOAD_DOWN_SAMPLES, cool samples in a row before restoring one level; default 20 */
+    unsigned int load_max_level;             /* LOAD_MAX_LEVEL, deepest degradation level, 0..4; default 4 */
+
+    /* MSG_QUEUE_BUFFERS, batches queue1 holds in front of the message broker; default 2.
+     * Queued batches keep their nvstreammux surfaces, so keep both queues below its buffer-pool-size. */
+    unsigned int msg_queue_buffers;
+    const char  *msg_queue_leaky;            /* MSG_QUEUE_LEAKY, queue1 "leaky": "no", "upstream" or "downstream"; default downstream */
+    unsigned int render_queue_buffers;       /* RENDER_QUEUE_BUFFERS, batches queue2 holds in front of the renderer; default 2 */
+    const char  *render_queue_leaky;         /* RENDER_QUEUE_LEAKY, queue2 "leaky"; default no */
+    unsigned int msg_shed_low_pct;           /* MSG_SHED_LOW_PCT, queue1 fill from which heartbeats and per-frame messages are shed; default 50 */
+    unsigned int msg_shed_normal_pct;        /* MSG_SHED_NORMAL_PCT, queue1 fill from which label changes and lost tracks are shed too; default 100 */
+
+    const char  *journal_dir;                /* JOURNAL_DIR, broker event journal (event_spool.h); default "" (off) */
+    unsigned int journal_segment_mb;         /* JOURNAL_SEGMENT_MB, size of each journal segment file, 1..; default 16 */
+    unsigned int journal_quota_mb;           /* JOURNAL_QUOTA_MB, journal disk quota, oldest events dropped beyond it; default 1024 */
+    unsigned int journal_replay_rate;        /* JOURNAL_REPLAY_RATE, events replayed per second once the broker is back; default 200 */
+
+    /* MSG_PUBLISHER, "native" (mqtt_publisher.h, in process) or "nvmsgbroker" (nvmsgconv and nvmsgbroker
+     * with the msgbroker proto-lib); default native.  Both use msgbroker conn-str and topic. */
+    const char  *msg_publisher;
+    unsigned int mqtt_qos;                   /* MQTT_QOS, QoS of native publishes, 0..2; default 1 */
+    unsigned int mqtt_batch_bytes;           /* MQTT_BATCH_BYTES, largest native publish before compression; default 65536 */
+    unsigned int mqtt_batch_ms;              /* MQTT_BATCH_MS, longest an event waits for its publish to fill (0 = unbatched); default 20 */
+    const char  *mqtt_compress;              /* MQTT_COMPRESS, "none" or "deflate" (zlib stream per publish); default none */
+    unsigned int mqtt_queue_events;          /* MQTT_QUEUE_EVENTS, events queued for the MQTT I/O thread; default 8192 */
+    unsigned int mqtt_max_inflight;          /* MQTT_MAX_INFLIGHT, native publishes awaiting their ack; default 64 */
+
+    const char  *payload_format;             /* PAYLOAD_FORMAT, "text", "json" or "binary" (payload_encoder.h); default text */
+    /* MSG_AGGREGATE, "none" (one broker message per event), "frame" (one blob per frame) or "window"
+     * (one blob per MSG_AGGREGATE_WINDOW_MS); default none */
+    const char  *msg_aggregate;
+    unsigned int msg_aggregate_window_ms;    /* MSG_AGGREGATE_WINDOW_MS, time a window blob collects events, 1..; default 100 */
+    unsigned int msg_aggregate_max_bytes;    /* MSG_AGGREGATE_MAX_BYTES, largest blob; default 8192 */
+
+    const char  *trace_file;                 /* TRACE_FILE, Chrome trace of per-buffer latency (buffer_trace.h); default "" (off) */
+    unsigned int trace_max_events;           /* TRACE_MAX_EVENTS, stamps a trace keeps; default 2000000 */
+    unsigned int config_watch_ms;            /* CONFIG_WATCH_MS, app YAML edit check period (config_reload.h), 0 = SIGHUP only; default 0 */
+} AppSettings;
+
+/**
+ * Fills settings from the environment, defaults for what is unset or empty.
+ * Returns the number of malformed or unknown values, each logged with its
+ * variable; those settings keep their defaults.
+ */
+unsigned int config_load_settings(AppSettings *settings);
 
 #endif
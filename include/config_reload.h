@@ -0,0 +1,53 @@
+#ifndef CONFIG_RELOAD_H
+#define CONFIG_RELOAD_H
+
+#include <gst/gst.h>
+
+#include "detection_writer.h"
+#include "load_shedder.h"
+#include "meta_stage.h"
+#include "mqtt_publisher.h"
+#include "pipeline_config.h"
+#include "probes/probe_send.h"
+
+/** What a reload changes in place; any may be NULL.  Borrowed, but for the elements, which are reffed. */
+typedef struct {
+    GstElement       *pgie;              /* "interval" */
+    LoadShedder      *load_shedder;      /* takes the PGIE interval instead, as its level 0 */
+    MetaStage        *meta_stage;        /* classifier thresholds */
+    ProbeSendContext *send_ctx;          /* track event timing, when it has tracks */
+    MqttPublisher    *publisher;         /* topic, MSG_PUBLISHER=native */
+    GstElement       *msgbroker;         /* topic, nvmsgbroker */
+    DetectionWriter  *detection_writer;  /* output dir */
+} ConfigReloadTargets;
+
+/**
+ * Settings of a built pipeline that change without rebuilding it, read from
+ * the app YAML's "runtime:" section (RuntimeConfig in pipeline_config.h) and
+ * msgbroker.topic.  A key taken out goes back to its default.  Every other
+ * top-level section, and the files its config-file-path, ll-config-file and
+ * config keys name, is compared with what the pipeline was built from and
+ * each one that differs is logged as needing a restart, as is turning the
+ * detection output on or off.  Main loop only.
+ */
+typedef struct ConfigReload ConfigReload;
+
+/**
+ * Snapshot of config's document, as the pipeline was built from it.  Its
+ * runtime section and topic are taken as what targets already run with, so
+ * nothing is applied until the file changes.  Only borrows config.
+ */
+ConfigReload *config_reload_new(const PipelineConfig *config, const ConfigReloadTargets *targets);
+void          config_reload_free(ConfigReload *reload);
+
+/**
+ * Re-reads the config and applies each setting that changed, logging it; the
+ * stream is not interrupted.  FALSE (logged) when the file cannot be read or
+ * a setting is invalid, and then nothing is applied.
+ */
+gboolean      config_reload_apply(ConfigReload *reload);
+
+/** TRUE when the config file was modified or replaced since the last apply. */
+gboolean      config_reload_file_changed(ConfigReload *reload);
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef DETECTION_EVAL_H
+#define DETECTION_EVAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Car, plate and LPR metrics of a detection dump against COCO ground truth,
+ * as scripts/metrics/compute_detection_metrics.py computes them and with the
+ * same summary.  Plain C with no GLib dependency so tools can link it on its
+ * own.  The COCO file and detections.txt are memory-mapped; the log is parsed
+ * in chunks split at frame headers and frames are evaluated in parallel, then
+ * summed in image order so the result does not depend on the thread count.
+ */
+
+typedef struct {
+    int64_t  frame_offset;     /* detection frame = COCO frame index + this */
+    int64_t  source_id;        /* frames of this source in detections.txt */
+    int      det_width;        /* resolution of the detection boxes */
+    int      det_height;
+    double   iou_threshold;
+    unsigned threads;          /* 0: one per online CPU */
+} DetEvalOptions;
+
+typedef struct {
+    uint64_t tp, fp, fn;
+} DetEvalCounts;
+
+typedef struct {
+    DetEvalCounts car;
+    DetEvalCounts plate;
+    uint64_t      lpr_exact;
+    uint64_t      lpr_total;
+    double        lpr_cer_sum;
+    size_t        frames;      /* COCO images evaluated (file name frame_NNNNNN.*) */
+} DetEvalResult;
+
+/** The script's defaults: offset 1, source 0, 1920x1080, IoU 0.5. */
+void deteval_options_init(DetEvalOptions *options);
+
+/**
+ * Evaluates detections_dir (detections.txt, else frame_NNNNNN.txt files)
+ * against coco_path.  0 on success; -1 with a message in err otherwise.
+ */
+int  deteval_run(const char *coco_path, const char *detections_dir,
+                 const DetEvalOptions *options, DetEvalResult *out,
+                 char *err, size_t err_len);
+
+/** The summary as the script's json.dump(indent=2), byte for byte. */
+void deteval_write_json(const DetEvalResult *result, FILE *out);
+/** The summary as the script prints it. */
+void deteval_print_summary(const DetEvalResult *result, FILE *out);
+
+/** Levenshtein distance over code points, bit-parallel when the shorter one fits in 64. */
+size_t deteval_edit_distance(const uint32_t *a, size_t a_len,
+                             const uint32_t *b, size_t b_len);
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef DETECTION_LOG_H
+#define DETECTION_LOG_H
+
+#include <glib.h>
+
+#include "detection_writer.h"
+
+/**
+ * Append-only writer for binary detection segments (detection_log_format.h).
+ * Frames are encoded into a batch buffer and written by detection_log_sync();
+ * a segment is sealed with its frame index and a new one started once it
+ * grows past segment_bytes.  A write error cuts the segment back to the
+ * batches written whole and moves on to the next one; when no segment can be
+ * opened frames are dropped.  Either way they are counted as lost.  Not
+ * thread-safe; owned by the writer thread.
+ */
+typedef struct DetectionLog DetectionLog;
+
+/** Deletes the segments already in output_dir and numbers from 0.  NULL on I/O failure. */
+DetectionLog *detection_log_new(const char *output_dir, guint64 segment_bytes);
+/** Writes pending frames and seals the current segment. */
+void          detection_log_free(DetectionLog *log);
+
+void          detection_log_append(DetectionLog *log, const DetectionFrame *frame);
+/** Writes the pending batch in one write; rolls over to a new segment when due. */
+void          detection_log_sync(DetectionLog *log);
+
+/** Frames appended but never written whole. */
+guint64       detection_log_get_lost(const DetectionLog *log);
+
+#endif
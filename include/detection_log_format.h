@@ -0,0 +1,75 @@
+#ifndef DETECTION_LOG_FORMAT_H
+#define DETECTION_LOG_FORMAT_H
+
+#include <stdint.h>
+
+/*
+ * On-disk layout of binary detection log segments (native little-endian,
+ * 8-byte aligned).  A segment is a DetLogFileHeader followed by blocks:
+ *
+ *   STRINGS  NUL-terminated plate texts interned for this segment
+ *   FRAME    DetLogRecord[count] for one frame of one source
+ *   INDEX    DetLogIndexEntry[count], written when the segment is sealed
+ *
+ * A sealed segment ends with a DetLogTrailer pointing at its INDEX block.  A
+ * segment cut short by a crash has no trailer; readers rebuild the index by
+ * walking the blocks and ignore a torn last block.  Every block starts on an
+ * 8-byte boundary and its length includes the padding.
+ */
+
+#define DETLOG_MAGIC           0x4C444754u   /* "TGDL" */
+#define DETLOG_TRAILER_MAGIC   0x58444E49u   /* "INDX" */
+#define DETLOG_VERSION         1
+#define DETLOG_SEGMENT_PATTERN "detections_%06u.tgdl"
+
+#define DETLOG_BLOCK_STRINGS   1u
+#define DETLOG_BLOCK_FRAME     2u
+#define DETLOG_BLOCK_INDEX     3u
+
+#define DETLOG_KIND_CAR        0u
+#define DETLOG_KIND_PLATE      1u
+
+/* text_offset value for records without plate text (exported as "-"). */
+#define DETLOG_NO_TEXT         0u
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t segment_index;
+    uint32_t reserved;
+} DetLogFileHeader;
+
+typedef struct {
+    uint32_t type;
+    uint32_t length;      /* payload bytes after this header, padding included */
+    uint32_t source_id;   /* FRAME only */
+    uint32_t count;       /* records, strings or index entries */
+    int64_t  frame_num;   /* FRAME only */
+} DetLogBlockHeader;
+
+typedef struct {
+    float    left;
+    float    top;
+    float    width;
+    float    height;
+    uint64_t object_id;
+    uint32_t text_offset;   /* segment offset of the NUL-terminated text */
+    uint16_t component_id;  /* unique_component_id of the producing GIE */
+    uint16_t kind;          /* DETLOG_KIND_* */
+} DetLogRecord;
+
+typedef struct {
+    int64_t  frame_num;
+    uint32_t source_id;
+    uint32_t n_records;
+    uint64_t offset;        /* segment offset of the FRAME block header */
+} DetLogIndexEntry;
+
+typedef struct {
+    uint64_t index_offset;  /* segment offset of the INDEX block header */
+    uint32_t index_count;
+    uint32_t magic;         /* DETLOG_TRAILER_MAGIC */
+} DetLogTrailer;
+
+#endif
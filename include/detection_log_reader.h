@@ -0,0 +1,49 @@
+#ifndef DETECTION_LOG_READER_H
+#define DETECTION_LOG_READER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "detection_log_format.h"
+
+/**
+ * Read-only, memory-mapped view of one binary detection segment.  Plain C with
+ * no GLib dependency so tools can link it on its own.  Records and texts point
+ * into the mapping and stay valid until detlog_segment_close().
+ */
+typedef struct DetLogSegment DetLogSegment;
+
+typedef struct {
+    int64_t             frame_num;
+    uint32_t            source_id;
+    uint32_t            n_records;
+    const DetLogRecord *records;
+} DetLogFrame;
+
+/** NULL when the file cannot be mapped or is not a segment (errno is set). */
+DetLogSegment *detlog_segment_open(const char *path);
+void           detlog_segment_close(DetLogSegment *segment);
+
+/** Non-zero when the segment carries a trailer; otherwise its index was rebuilt by scanning. */
+int            detlog_segment_is_sealed(const DetLogSegment *segment);
+uint32_t       detlog_segment_index(const DetLogSegment *segment);
+size_t         detlog_segment_frame_count(const DetLogSegment *segment);
+
+/** Frames in write order.  0 on success, -1 when i is out of range. */
+int            detlog_segment_frame_at(const DetLogSegment *segment, size_t i,
+                                       DetLogFrame *out);
+/** 0 on success, -1 when the segment holds no such frame. */
+int            detlog_segment_find_frame(const DetLogSegment *segment,
+                                         int64_t frame_num, uint32_t source_id,
+                                         DetLogFrame *out);
+
+/** Plate text of a record; "-" when it has none. */
+const char    *detlog_record_text(const DetLogSegment *segment,
+                                  const DetLogRecord *record);
+
+/** Writes the frame as legacy "car|plate left top width height text" lines. */
+void           detlog_write_legacy_lines(const DetLogSegment *segment,
+                                         const DetLogFrame *frame, FILE *out);
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef DETECTION_WRITER_H
+#define DETECTION_WRITER_H
+
+#include <glib.h>
+
+#define DETECTION_MAX_RECORDS_PER_FRAME 128
+#define DETECTION_TEXT_MAX              24
+
+typedef enum {
+    DETECTION_KIND_CAR,
+    DETECTION_KIND_PLATE,
+} DetectionKind;
+
+typedef struct {
+    gfloat  left;
+    gfloat  top;
+    gfloat  width;
+    gfloat  height;
+    guint64 object_id;
+    guint16 component_id;
+    guint8  kind;                      /* DetectionKind */
+    gchar   text[DETECTION_TEXT_MAX];  /* "-" when no plate was read */
+} DetectionRecord;
+
+/** One frame as copied off the streaming thread; records beyond the limit are cut and counted. */
+typedef struct {
+    gint64          frame_num;
+    guint32         source_id;
+    guint32         n_records;
+    guint32         n_cut;     /* records that did not fit; the writer logs the total */
+    DetectionRecord records[DETECTION_MAX_RECORDS_PER_FRAME];
+} DetectionFrame;
+
+typedef enum {
+    DETECTION_FORMAT_TEXT,    /* <output_dir>/detections.txt, truncated when opened */
+    DETECTION_FORMAT_BINARY,  /* <output_dir>/detections_NNNNNN.tgdl segments, see detection_log.h */
+} DetectionFormat;
+
+typedef struct {
+    DetectionFormat format;
+    guint           queue_frames;
+    guint           flush_interval_ms;
+    guint64         segment_bytes;  /* binary only: size at which a segment is sealed */
+} DetectionWriterOptions;
+
+/**
+ * Background writer for detection dumps.  The streaming thread fills frames in a
+ * bounded lock-free ring; a writer thread drains it every flush interval and
+ * appends the batch to the output in one sequential write.
+ */
+typedef struct DetectionWriter DetectionWriter;
+
+/** NULL when the output cannot be opened. */
+DetectionWriter *detection_writer_new(const char                   *output_dir,
+                                      const DetectionWriterOptions *options);
+/** Drains pending frames, joins the writer thread and reports totals. */
+void             detection_writer_free(DetectionWriter *writer);
+
+/**
+ * Single producer.  Returns a frame with n_records and n_cut reset, or NULL when the ring
+ * is full (the frame is counted as dropped).  Every non-NULL frame must be committed.
+ */
+DetectionFrame  *detection_writer_begin_frame(DetectionWriter *writer);
+void             detection_writer_commit_frame(DetectionWriter *writer);
+
+/**
+ * Moves the output to output_dir, created when missing, in the writer's
+ * format: the writer thread closes the current file or segment after its
+ * next pass, so frames committed before that still land in the old one.
+ * A detections.txt already in output_dir is replaced.
+ * Main loop.  FALSE (logged) when output_dir cannot be opened; the writer
+ * then keeps its own.
+ */
+gboolean         detection_writer_set_output_dir(DetectionWriter *writer, const char *output_dir);
+
+/** Blocks until every committed frame has been written. */
+void             detection_writer_flush(DetectionWriter *writer);
+
+guint64          detection_writer_get_written(DetectionWriter *writer);
+guint64          detection_writer_get_dropped(DetectionWriter *writer);
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef ELEMENT_UTIL_H
+#define ELEMENT_UTIL_H
+
+#include <gst/gst.h>
+
+/** TRUE when element is non-NULL and its class has the property. */
+gboolean   element_util_has_property(GstElement *element, const gchar *name);
+
+/**
+ * Drains it into an array of its elements in iteration order, each once
+ * however often the iterator resyncs, and frees it.  The elements are
+ * borrowed from their bin.
+ */
+GPtrArray *element_util_collect(GstIterator *it);
+
+/**
+ * g_object_get of a queue's "current-level-*" and "max-size-*" properties,
+ * NULL-terminated.  The queue takes its own lock for them, so any thread may
+ * read them, streaming threads included.
+ */
+void       element_util_queue_level(GstElement *queue, const gchar *first_property, ...) G_GNUC_NULL_TERMINATED;
+
+#endif
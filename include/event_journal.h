@@ -0,0 +1,54 @@
+#ifndef EVENT_JOURNAL_H
+#define EVENT_JOURNAL_H
+
+#include <glib.h>
+
+#define EVENT_JOURNAL_SEGMENT_PATTERN "journal_%08u.tgej"
+
+typedef struct {
+    guint64 segment_bytes;   /* size of each memory-mapped segment file */
+    guint64 quota_bytes;     /* segments kept on disk, at least two; the oldest goes first */
+} EventJournalOptions;
+
+typedef struct {
+    guint64 appended;
+    guint64 consumed;
+    guint64 dropped;         /* unconsumed records lost to the quota */
+    guint64 rejected;        /* larger than a segment */
+    guint64 recovered;       /* unconsumed records found at open */
+    guint64 pending;         /* appended, not yet consumed */
+    guint   segments;
+} EventJournalStats;
+
+/**
+ * Durable FIFO of opaque payloads in a ring of memory-mapped segment files
+ * under one directory.  Records carry a sequence number and a CRC; the
+ * consumed sequence is kept in a "cursor" file replaced atomically by
+ * event_journal_sync.  On open, segments are walked and cut at the first torn
+ * or corrupt record, so a crash loses at most the record being written and
+ * replays at most what was consumed since the last sync (at-least-once).
+ * When a new segment would exceed the quota, the oldest one is deleted with
+ * whatever it still held.  All calls are thread-safe; records are read and
+ * consumed by one thread.
+ */
+typedef struct EventJournal EventJournal;
+
+/** Creates dir if needed and recovers what it holds; NULL (logged) on failure. */
+EventJournal *event_journal_open(const gchar *dir, const EventJournalOptions *options);
+/** Syncs and unmaps. */
+void          event_journal_free(EventJournal *journal);
+
+/** Copies one record in; FALSE when it can never fit a segment. */
+gboolean      event_journal_append(EventJournal *journal, const void *data, gsize len);
+
+/** Copies the oldest unconsumed record into out; FALSE when there is none. */
+gboolean      event_journal_read(EventJournal *journal, GByteArray *out, guint64 *seq);
+/** Marks every record up to seq consumed, deleting segments left with nothing to read. */
+void          event_journal_consume(EventJournal *journal, guint64 seq);
+
+/** Writes the cursor file and flushes the mapped segments to disk. */
+void          event_journal_sync(EventJournal *journal);
+
+void          event_journal_get_stats(EventJournal *journal, EventJournalStats *stats);
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef EVENT_SPOOL_H
+#define EVENT_SPOOL_H
+
+#include <glib.h>
+
+#include "event_journal.h"
+
+/** Connects when needed; TRUE while the broker is reachable.  Called on the replay thread. */
+typedef gboolean (*EventSpoolConnectFunc)(gpointer user_data);
+/** Publishes one payload; FALSE when the broker did not take it (it is retried). */
+typedef gboolean (*EventSpoolSendFunc)(const guint8 *payload, gsize len, gpointer user_data);
+
+typedef struct {
+    guint replay_rate;   /* events per second replayed, so the backlog leaves room for live traffic */
+    guint retry_ms;      /* between connection attempts while the broker is down */
+    guint sync_ms;       /* between cursor and segment syncs */
+} EventSpoolOptions;
+
+typedef struct {
+    gboolean          broker_up;
+    guint64           spilled;
+    guint64           replayed;
+    EventJournalStats journal;
+} EventSpoolStats;
+
+/**
+ * Store-and-forward for broker events: payloads spilled while the broker is
+ * unreachable or behind go to an EventJournal, and a replay thread sends
+ * them back in order, at most replay_rate per second, once connect succeeds.
+ * A record is consumed only after its send succeeded.  Exported in
+ * metrics.h as traffic_guard_journal_*_total and traffic_guard_broker_up.
+ * Spills are safe from any streaming thread.
+ */
+typedef struct EventSpool EventSpool;
+
+/** Takes ownership of journal; user_data is freed with destroy before the journal closes, so it may still spill. */
+EventSpool *event_spool_new(EventJournal            *journal,
+                            const EventSpoolOptions *options,
+                            EventSpoolConnectFunc    connect,
+                            EventSpoolSendFunc       send,
+                            gpointer                 user_data,
+                            GDestroyNotify           destroy);
+/** Stops the replay thread and syncs the journal; what is left replays on the next run. */
+void        event_spool_free(EventSpool *spool);
+
+/** As last seen by the replay thread: FALSE from a failed connect or send until a connect succeeds. */
+gboolean    event_spool_broker_up(const EventSpool *spool);
+/** Journals one payload for replay; FALSE when the journal refused it. */
+gboolean    event_spool_spill(EventSpool *spool, const void *payload, gsize len);
+
+void        event_spool_get_stats(EventSpool *spool, EventSpoolStats *stats);
+
+#endif
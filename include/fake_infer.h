@@ -0,0 +1,20 @@
+#ifndef FAKE_INFER_H
+#define FAKE_INFER_H
+
+#include <gst/gst.h>
+
+#define FAKE_INFER_FACTORY "tgfakeinfer"
+
+/**
+ * In-place transform that stands in for nvstreammux plus the GIE chain on
+ * machines without a GPU: every buffer gets an NvDsBatchMeta holding one
+ * frame of synthetic_meta.h objects (cars with make/type labels, plates with
+ * LPR text) for its "source-id", numbered per source from 0 like the muxer.
+ * Output depends only on the properties and the frame count, so runs repeat.
+ *
+ * Properties: source-id, objects-per-frame, plate-ratio, label-cardinality, seed.
+ * Registers FAKE_INFER_FACTORY with the application; safe to call more than once.
+ */
+gboolean fake_infer_register(void);
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef FRAME_INDEX_H
+#define FRAME_INDEX_H
+
+#include <glib.h>
+
+#include "nvdsmeta.h"
+
+/* gie-unique-id of each model (configs/sgie_*_config.yml). */
+#define GIE_ID_VEHICLE_DETECTOR 1   /* TrafficCamNet */
+#define GIE_ID_VEHICLE_MAKE     2   /* VehicleMakeNet */
+#define GIE_ID_VEHICLE_TYPE     3   /* VehicleTypeNet */
+#define GIE_ID_PLATE_DETECTOR   4   /* LPDNet */
+#define GIE_ID_PLATE_READER     5   /* LPRNet */
+
+#define FRAME_INDEX_MAX_COMPONENTS 8
+
+/** One object with its classifier labels pre-extracted; strings are borrowed from the label meta. */
+typedef struct {
+    NvDsObjectMeta *obj;
+    const gchar    *brand;       /* NULL when VehicleMakeNet left no label */
+    const gchar    *type;        /* NULL when VehicleTypeNet left no label */
+    const gchar    *plate;       /* LPRNet text on this object; NULL when absent */
+    gfloat          brand_prob;
+    gfloat          type_prob;
+    gfloat          plate_prob;
+    gboolean        has_plate_classifier;  /* LPRNet attached classifier meta, even if empty */
+} FrameIndexObject;
+
+typedef struct {
+    FrameIndexObject *items;
+    guint             n;
+    guint             capacity;
+} FrameIndexBucket;
+
+/**
+ * Per-frame view built in one walk over obj_meta_list: objects bucketed by
+ * unique_component_id plus an object_id hash over cars and plates.  Buffers are
+ * reused between frames, so steady-state builds do not allocate.
+ */
+typedef struct FrameIndex FrameIndex;
+
+FrameIndex *frame_index_new(void);
+void        frame_index_free(FrameIndex *index);
+
+void        frame_index_build(FrameIndex     *index,
+                              NvDsBatchMeta  *batch_meta,
+                              NvDsFrameMeta  *frame_meta);
+
+NvDsBatchMeta *frame_index_batch_meta(const FrameIndex *index);
+NvDsFrameMeta *frame_index_frame_meta(const FrameIndex *index);
+
+/**
+ * Classifier labels of component_id below min_prob are left out of later builds, as if the
+ * classifier had not reported them; 0 (the default) keeps every label.
+ */
+void        frame_index_set_min_prob(FrameIndex *index,
+                                     gint        component_id,
+                                     gfloat      min_prob);
+
+/** Objects of one GIE in list order; empty bucket for ids out of range. */
+const FrameIndexBucket *frame_index_bucket(const FrameIndex *index,
+                                           gint              component_id);
+
+/** First car (GIE_ID_VEHICLE_DETECTOR) / plate (GIE_ID_PLATE_DETECTOR) with this object_id, or NULL. */
+const FrameIndexObject *frame_index_find_car(const FrameIndex *index,
+                                             guint64           object_id);
+const FrameIndexObject *frame_index_find_plate(const FrameIndex *index,
+                                               guint64           object_id);
+
+#endif
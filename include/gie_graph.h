@@ -0,0 +1,72 @@
+#ifndef GIE_GRAPH_H
+#define GIE_GRAPH_H
+
+#include <glib.h>
+#include <yaml.h>
+
+#define GIE_GRAPH_MAX_NODES 16
+
+/* Plumbing element names, shared by PipelineBuilder and PipelineLinker. */
+#define GIE_GRAPH_TEE_FMT   "%s-tee"        /* after a node with several successors */
+#define GIE_GRAPH_QUEUE_FMT "%s-queue-%u"   /* tee branch towards the node's k-th successor */
+#define GIE_GRAPH_JOIN_FMT  "%s-join"       /* before a node with several predecessors */
+#define GIE_GRAPH_EXIT_JOIN "gie-join"      /* merges the sink nodes when there are several */
+
+typedef enum {
+    GIE_NODE_INFER,     /* nvinfer, configured by an InferConfig section (pipeline_config.h) */
+    GIE_NODE_TRACKER,   /* nvtracker, configured by a TrackerConfig section */
+} GieNodeType;
+
+typedef struct {
+    gchar      *name;     /* element name */
+    gchar      *config;   /* section of the app YAML holding the element's settings */
+    GieNodeType type;
+} GieNode;
+
+typedef struct {
+    guint from;
+    guint to;
+} GieEdge;
+
+/**
+ * Inference topology between the muxer and nvvideoconvert.  Nodes are in
+ * topological order, so node 0 is the single entry and every edge goes from a
+ * lower to a higher index; edges are sorted by (from, to).
+ */
+typedef struct {
+    GieNode *nodes;
+    guint    n_nodes;
+    GieEdge *edges;
+    guint    n_edges;
+} GieGraph;
+
+/**
+ * Reads "gie-graph:" from the app YAML: "nodes:" (name, config, optional
+ * type: infer|tracker and enable: 0) and "edges:" as [from, to] pairs of node
+ * names.  Edges through a node that is not declared, or is disabled, are
+ * bridged from each of its predecessors to each of its successors, so a model
+ * is dropped by deleting its node.  Without a gie-graph: section the graph is
+ * the historical chain primary-inference -> tracker -> secondary-inference-1..4.
+ * NULL (logged) on a cycle, several entry nodes or more than GIE_GRAPH_MAX_NODES.
+ */
+GieGraph *gie_graph_load(const char *yaml_path);
+/** The same, from an already parsed app YAML. */
+GieGraph *gie_graph_parse(yaml_document_t *doc);
+void      gie_graph_free(GieGraph *graph);
+
+/** Index of the node named name, or -1. */
+gint      gie_graph_find(const GieGraph *graph, const gchar *name);
+
+/** Writes up to GIE_GRAPH_MAX_NODES node indices in ascending order; returns the count. */
+guint     gie_graph_successors(const GieGraph *graph, guint node, guint *out);
+guint     gie_graph_predecessors(const GieGraph *graph, guint node, guint *out);
+/** Nodes without successors. */
+guint     gie_graph_exits(const GieGraph *graph, guint *out);
+
+/** Bit i set for node i and every node upstream of it. */
+guint32   gie_graph_ancestors(const GieGraph *graph, guint node);
+
+/** Element whose src pad carries the graph's output: the only exit node, or GIE_GRAPH_EXIT_JOIN. */
+const gchar *gie_graph_exit_name(const GieGraph *graph);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef GIE_JOIN_H
+#define GIE_JOIN_H
+
+#include <gst/gst.h>
+
+#include "meta_merge.h"
+
+#define GIE_JOIN_FACTORY      "tggiejoin"
+#define GIE_JOIN_MAX_BRANCHES 8
+
+/**
+ * Fan-in of parallel GIE branches split by a tee: an aggregator that waits
+ * for the same batch on every "sink_%u" pad, merges the metadata each branch
+ * added into the sink_0 buffer (meta_merge.h) and pushes that one buffer.
+ * Each branch needs its own batch meta, see gie_join_split_branch.  Registers GIE_JOIN_FACTORY with the application; safe to call more than once.
+ */
+gboolean gie_join_register(void);
+
+/**
+ * Requests the join's next sink pad, links upstream's src pad to it and
+ * records the gie-unique-ids produced on that branch.  FALSE (logged) on a
+ * link failure or beyond GIE_JOIN_MAX_BRANCHES.
+ */
+gboolean gie_join_link_branch(GstElement                *join,
+                              GstElement                *upstream,
+                              const MetaMergeComponents *components);
+
+/**
+ * Gives every buffer entering queue, a tee branch, its own copy of the batch
+ * meta so parallel GIEs never write to the same lists.  The copy is made on
+ * the tee's thread before the buffer is queued; video surfaces stay shared.
+ */
+void     gie_join_split_branch(GstElement *queue);
+
+#endif
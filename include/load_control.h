@@ -0,0 +1,57 @@
+#ifndef LOAD_CONTROL_H
+#define LOAD_CONTROL_H
+
+#include <glib.h>
+
+#define LOAD_LEVEL_COUNT 5
+
+/** What the GIEs do at one degradation level; level 0 is full work. */
+typedef struct {
+    guint    pgie_interval;   /* batches the PGIE skips between inferences; the tracker fills in */
+    gboolean classify;        /* make and type SGIEs run */
+    guint    lpr_every;       /* LPRNet reads plates on one frame in lpr_every */
+} LoadLevel;
+
+typedef struct {
+    gdouble high_latency_ms;  /* shed above this smoothed latency */
+    gdouble low_latency_ms;   /* recover below it */
+    gdouble high_queue_fill;  /* or above this fill of the fullest queue, 0..1 */
+    gdouble low_queue_fill;
+    guint   up_samples;       /* consecutive hot, not improving, samples before a step up */
+    guint   down_samples;     /* consecutive cool samples before a step down */
+    gdouble smoothing;        /* weight of a new latency sample, 0..1 */
+    guint   max_level;        /* below LOAD_LEVEL_COUNT */
+} LoadControlOptions;
+
+typedef struct {
+    guint   level;
+    gdouble latency_ms;       /* smoothed */
+    gdouble queue_fill;       /* last sample */
+    guint64 steps_up;
+    guint64 steps_down;
+} LoadControlStats;
+
+/**
+ * Degradation level from latency and queue fill samples, one step at a time
+ * with hysteresis: a step up needs up_samples hot samples in a row during
+ * which latency is not already falling, a step down needs down_samples cool
+ * ones, and samples between the low and high marks reset both counts.  A
+ * step up within 2 x down_samples of a step down doubles the cool samples
+ * the next step down needs, up to 8x; a step down that holds that long
+ * halves it again.  No
+ * GStreamer; the caller applies load_control_settings() of the level.
+ * Not thread-safe.
+ */
+typedef struct LoadControl LoadControl;
+
+LoadControl *load_control_new(const LoadControlOptions *options);
+void         load_control_free(LoadControl *lc);
+
+/** Feeds one sample; returns the level in force after it. */
+guint        load_control_update(LoadControl *lc, gdouble latency_ms, gdouble queue_fill);
+void         load_control_get_stats(const LoadControl *lc, LoadControlStats *stats);
+
+/** Settings of level, clamped to the last one. */
+const LoadLevel *load_control_settings(guint level);
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef LOAD_SHEDDER_H
+#define LOAD_SHEDDER_H
+
+#include <gst/gst.h>
+
+#include "nvdsmeta.h"
+#include "load_control.h"
+
+/* Added to unique_component_id to hide an object from the SGIEs that operate on that id. */
+#define LOAD_SHED_COMPONENT_OFFSET 1000
+
+/**
+ * Applies a LoadControl to the running pipeline: the PGIE "interval"
+ * property, and gates on the make/type and LPR SGIEs (see LoadShedGate).
+ * Samples the latency noted by probe_load_shed_latency and the fill of the
+ * added queues.  Setup calls and load_shedder_tick belong to the main loop;
+ * the gate and note calls are safe from streaming threads.
+ */
+typedef struct LoadShedder LoadShedder;
+
+/** Per-SGIE user_data of probe_load_shed_hide/restore; owned by the LoadShedder. */
+typedef struct LoadShedGate LoadShedGate;
+
+LoadShedder  *load_shedder_new(const LoadControlOptions *options);
+void          load_shedder_free(LoadShedder *ls);
+
+/**
+ * Keeps a ref; its "interval" follows the level when the element has that
+ * property.  The interval it has now becomes the level 0 one.
+ */
+void          load_shedder_set_pgie(LoadShedder *ls, GstElement *pgie);
+/** PGIE interval at level 0, and the least at any level; applied now. */
+void          load_shedder_set_pgie_interval(LoadShedder *ls, guint interval);
+/** Keeps a ref; fill is current-level over max-size, in buffers or else time. */
+void          load_shedder_add_queue(LoadShedder *ls, GstElement *queue);
+
+/**
+ * Gate for an nvinfer whose "unique-id" is the make, type (frame_index.h
+ * GIE_ID_VEHICLE_MAKE, _TYPE) or plate reader model; NULL for any other
+ * element, which is never shed.  The objects hidden are those of its
+ * "operate-on-gie-id".
+ */
+LoadShedGate *load_shedder_gate(LoadShedder *ls, GstElement *sgie);
+
+/**
+ * Hides the frame's objects from the gate's SGIE when the level sheds it;
+ * returns the count.  This edits the batch meta, so a gate whose SGIE has a
+ * parallel sibling relies on the fan-out's per-branch copy (gie_join.h).
+ */
+guint         load_shedder_hide_frame(const LoadShedGate *gate, NvDsFrameMeta *frame_meta);
+/** Undoes load_shedder_hide_frame, whatever the level is by now. */
+void          load_shedder_restore_frame(const LoadShedGate *gate, NvDsFrameMeta *frame_meta);
+
+/** Records one end-to-end latency sample; the tick uses the worst since the last one. */
+void          load_shedder_note_latency(LoadShedder *ls, gint64 latency_us);
+
+/** Feeds one sample to the controller and applies the level; TRUE when it changed. */
+gboolean      load_shedder_tick(LoadShedder *ls, LoadControlStats *stats);
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef META_MERGE_H
+#define META_MERGE_H
+
+#include <glib.h>
+
+#include "nvdsmeta.h"
+
+#define META_MERGE_MAX_COMPONENTS 16
+
+/** gie-unique-ids of the models on one parallel branch. */
+typedef struct {
+    gint  ids[META_MERGE_MAX_COMPONENTS];
+    guint n;
+} MetaMergeComponents;
+
+/**
+ * Folds what one parallel GIE branch added into the batch that continues
+ * downstream.  Both batches are copies of the same batch at the fan-out
+ * (gie_join_split_branch), so frames pair up by position and objects that
+ * existed there (components outside every branch, listed in all_branches)
+ * pair up by list order.  From `from` are copied: classifier meta of branch
+ * components on those objects, and new objects of branch components with
+ * their classifiers, their parent remapped to the paired object.  Takes the
+ * meta lock of `into`; does nothing when both are the same batch.  Not
+ * thread-safe; one instance per join.
+ */
+typedef struct MetaMerge MetaMerge;
+
+MetaMerge *meta_merge_new(void);
+void       meta_merge_free(MetaMerge *merge);
+
+/** Returns the number of objects and classifiers copied. */
+guint      meta_merge_batch(MetaMerge                 *merge,
+                            NvDsBatchMeta             *into,
+                            NvDsBatchMeta             *from,
+                            const MetaMergeComponents *branch,
+                            const MetaMergeComponents *all_branches);
+
+#endif
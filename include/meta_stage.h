@@ -0,0 +1,38 @@
+#ifndef META_STAGE_H
+#define META_STAGE_H
+
+#include <gst/gst.h>
+
+#include "nvdsmeta.h"
+#include "frame_index.h"
+
+/** Called once per frame with the index built for it; must not keep the index. */
+typedef void (*MetaStageConsumer)(const FrameIndex *index, gpointer user_data);
+
+/**
+ * Fused metadata stage: one pad probe walks each frame's object list once into
+ * a FrameIndex and hands it to every registered consumer in registration order.
+ */
+typedef struct MetaStage MetaStage;
+
+MetaStage *meta_stage_new(void);
+void       meta_stage_free(MetaStage *stage);
+
+/** name is used in logs; user_data stays owned by the caller. */
+void       meta_stage_add_consumer(MetaStage        *stage,
+                                   const gchar      *name,
+                                   MetaStageConsumer consumer,
+                                   gpointer          user_data);
+
+/** frame_index_set_min_prob for the index; any thread, applied from the next batch. */
+void       meta_stage_set_min_prob(MetaStage *stage, gint component_id, gfloat min_prob);
+
+/** Runs every consumer over each frame of the batch; usable without a pad. */
+void       meta_stage_process(MetaStage *stage, NvDsBatchMeta *batch_meta);
+
+/** Pad probe with the MetaStage as user_data. */
+GstPadProbeReturn meta_stage_probe(GstPad          *pad,
+                                   GstPadProbeInfo *info,
+                                   gpointer         user_data);
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <glib.h>
+
+#define METRICS_MAX_SERIES 256
+#define METRICS_NAME_MAX   64
+#define METRICS_HELP_MAX   128
+#define METRICS_LABEL_MAX  96
+
+/**
+ * Process-wide registry of counters and gauges, rendered in the Prometheus
+ * text format.  Registration takes a lock and belongs in setup code; updates
+ * are single relaxed atomics, safe from any streaming thread.  Series are
+ * never freed, so handles stay valid for the life of the process.  Every
+ * update accepts a NULL handle, which is what registration returns once all
+ * METRICS_MAX_SERIES are taken.
+ */
+typedef struct MetricsSeries MetricsCounter;
+typedef struct MetricsSeries MetricsGauge;
+
+/**
+ * Returns the counter name{label_key="label_value"}, registering it on first
+ * use; label_key NULL for an unlabelled series.  With rate, metrics_tick also
+ * publishes its per-second rate as a gauge named after the counter with the
+ * "_total" suffix replaced by "_per_second".
+ */
+MetricsCounter *metrics_counter(const gchar *name, const gchar *help,
+                                const gchar *label_key, const gchar *label_value,
+                                gboolean rate);
+void            metrics_counter_add(MetricsCounter *counter, guint64 n);
+guint64         metrics_counter_get(MetricsCounter *counter);
+
+MetricsGauge *metrics_gauge(const gchar *name, const gchar *help,
+                            const gchar *label_key, const gchar *label_value);
+void          metrics_gauge_set(MetricsGauge *gauge, gdouble value);
+
+/** Recomputes counter rates over the elapsed_s since the previous call; call from one thread only. */
+void metrics_tick(gdouble elapsed_s);
+
+/** Appends every series, grouped by name, in the Prometheus text exposition format 0.0.4. */
+void metrics_render(GString *out);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+
+#include <glib.h>
+
+/** Refreshes gauges just before a render; runs on the exporter thread. */
+typedef void (*MetricsCollectFunc)(gpointer user_data);
+
+/**
+ * Minimal HTTP exporter for the metrics registry on its own thread: GET
+ * /metrics answers with metrics_render(), anything else with 404.  The same
+ * thread calls metrics_tick() once a second, so counter rates are at most a
+ * second old, and keeps process_resident_memory_bytes current.
+ */
+typedef struct MetricsServer MetricsServer;
+
+/** Listens on port on all interfaces; NULL (logged) when the socket cannot be bound. */
+MetricsServer *metrics_server_new(guint16 port);
+/** Stops and joins the exporter thread, then destroys the collectors' user data. */
+void           metrics_server_free(MetricsServer *server);
+
+/** destroy (may be NULL) runs on user_data in metrics_server_free. */
+void metrics_server_add_collector(MetricsServer     *server,
+                                  MetricsCollectFunc collect,
+                                  gpointer           user_data,
+                                  GDestroyNotify     destroy);
+
+#endif
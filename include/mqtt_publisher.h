@@ -0,0 +1,86 @@
+#ifndef MQTT_PUBLISHER_H
+#define MQTT_PUBLISHER_H
+
+#include <glib.h>
+
+/* Default event_bytes. */
+#define MQTT_PUBLISHER_EVENT_BYTES 1024
+
+typedef enum {
+    MQTT_COMPRESSION_NONE,
+    MQTT_COMPRESSION_DEFLATE,   /* each publish is one zlib stream */
+} MqttCompression;
+
+typedef enum {
+    MQTT_FRAMING_NEWLINE,   /* events joined by '\n', for text payloads */
+    MQTT_FRAMING_LENGTH,    /* each event after its length as a varint, for binary payloads */
+} MqttFraming;
+
+/** Takes an event the publisher cannot send while disconnected; FALSE drops it.  Runs on the I/O thread. */
+typedef gboolean (*MqttPublisherSpillFunc)(const void *event, gsize len, gpointer user_data);
+
+typedef struct {
+    const gchar    *host;
+    guint           port;
+    const gchar    *topic;
+    const gchar    *client_id;     /* NULL lets the broker pick one */
+    guint           qos;           /* 0, 1 or 2 */
+    guint           keepalive_s;
+    guint           queue_events;  /* slots between the probes and the I/O thread */
+    guint           event_bytes;   /* longest event post and replay accept, the slot size; 0 for the default */
+    guint           batch_bytes;   /* a publish closes before it would exceed this ... */
+    guint           batch_ms;      /* ... or this long after its first event; 0 publishes each event alone */
+    guint           max_inflight;  /* publishes written but not yet acknowledged */
+    MqttCompression compression;
+    MqttFraming     framing;
+} MqttPublisherOptions;
+
+typedef struct {
+    gboolean connected;
+    guint64  posted;        /* accepted by post and replay */
+    guint64  dropped;       /* queue full, too long, or not taken by the spill function */
+    guint64  spilled;
+    guint64  published;     /* events in completed publishes */
+    guint64  publishes;
+    guint64  bytes;         /* publish payload bytes, after compression */
+    guint    inflight;
+    gdouble  latency_ms;    /* mean, from the oldest event of a publish to its completion */
+    gdouble  max_latency_ms;
+} MqttPublisherStats;
+
+/**
+ * In-process MQTT publisher on libmosquitto.  Probes post events into a
+ * bounded lock-free ring; an I/O thread of its own drains it, frames events
+ * into one payload per publish, closed by size or age, and
+ * drives the connection, reconnecting every second while the broker is away.
+ * A publish completes when written (QoS 0) or acknowledged (QoS 1 and 2).
+ * While disconnected, events go to the spill function when there is one;
+ * without it they wait in the ring, and post drops once it is full.  Exported
+ * in metrics.h as traffic_guard_mqtt_*.
+ */
+typedef struct MqttPublisher MqttPublisher;
+
+/** Starts the I/O thread, which connects in the background; NULL (logged) on bad options. */
+MqttPublisher *mqtt_publisher_new(const MqttPublisherOptions *options);
+/** Publishes what is queued while connected, waits briefly for acks, spills or drops the rest. */
+void           mqtt_publisher_free(MqttPublisher *publisher);
+
+/** Where undeliverable events go from now on; NULL func waits for the broker instead. */
+void           mqtt_publisher_set_spill(MqttPublisher *publisher, MqttPublisherSpillFunc func,
+                                        gpointer user_data);
+
+/** Topic of the publishes that follow; copied.  Events already in a publish keep theirs. */
+void           mqtt_publisher_set_topic(MqttPublisher *publisher, const gchar *topic);
+
+/** Single producer, the streaming thread.  Copies the event; FALSE when dropped. */
+gboolean       mqtt_publisher_post(MqttPublisher *publisher, const void *event, gsize len);
+/**
+ * Second single producer, for replayed events.  FALSE while disconnected or
+ * while the replay slots are full behind a slow broker.
+ */
+gboolean       mqtt_publisher_replay(MqttPublisher *publisher, const void *event, gsize len);
+
+gboolean       mqtt_publisher_connected(MqttPublisher *publisher);
+void           mqtt_publisher_get_stats(MqttPublisher *publisher, MqttPublisherStats *stats);
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef MSG_POOL_H
+#define MSG_POOL_H
+
+#include <glib.h>
+
+#include "nvdsmeta_schema.h"
+
+/* Payload bytes per block of msg_pool_new, NUL included; longer payloads fall back to the heap. */
+#define MSG_POOL_PAYLOAD_BYTES 512
+
+/** Shedding order when the broker branch backs up; the lowest goes first. */
+typedef enum {
+    MSG_PRIORITY_LOW,      /* heartbeats, per-frame repeats without track events */
+    MSG_PRIORITY_NORMAL,   /* label changes, lost tracks; the default */
+    MSG_PRIORITY_HIGH,     /* first sighting of a track, a new plate reading */
+} MsgPriority;
+
+/**
+ * Fixed slab of NvDsCustomMsgInfo blocks, each with an inline payload buffer,
+ * recycled through a lock-free free list.  Acquire runs on the streaming
+ * thread; release may run on any thread that drops the meta.  Outstanding
+ * messages keep the pool alive past msg_pool_free().
+ */
+typedef struct MsgPool MsgPool;
+
+typedef struct {
+    guint64 acquired;     /* messages handed out, pooled or not */
+    guint64 released;
+    guint64 misses;       /* slab empty or payload too long */
+    guint64 heap_allocs;  /* heap blocks allocated for misses */
+    guint   blocks;       /* slab size */
+} MsgPoolStats;
+
+MsgPool *msg_pool_new(guint n_blocks);
+/** With payload_bytes per block, NUL included, for payloads larger than MSG_POOL_PAYLOAD_BYTES. */
+MsgPool *msg_pool_new_full(guint n_blocks, gsize payload_bytes);
+/** Drops the owner's reference and logs totals; the slab goes with the last outstanding message. */
+void     msg_pool_free(MsgPool *pool);
+
+/** Formats the payload straight into a block; message is NUL-terminated and size excludes the NUL. */
+NvDsCustomMsgInfo *msg_pool_format(MsgPool *pool, const gchar *format, ...) G_GNUC_PRINTF(2, 3);
+
+/** Writes a payload like snprintf: the full length is returned, and all of it is written only when below size. */
+typedef gsize (*MsgPoolWriteFunc)(gchar *buf, gsize size, gpointer user_data);
+
+/** Runs write straight into a block, and again into a heap block when it did not fit; NUL-terminated like format. */
+NvDsCustomMsgInfo *msg_pool_write(MsgPool *pool, MsgPoolWriteFunc write, gpointer user_data);
+
+/** Copy of a pooled message from the same pool, for NvDsUserMeta copy_func. */
+NvDsCustomMsgInfo *msg_pool_copy(const NvDsCustomMsgInfo *msg);
+
+/** Of a pooled message; travels with it and its copies.  Set before the message is shared. */
+void        msg_pool_set_priority(NvDsCustomMsgInfo *msg, MsgPriority priority);
+MsgPriority msg_pool_get_priority(const NvDsCustomMsgInfo *msg);
+
+/** Returns a message from msg_pool_format or msg_pool_copy; NULL is ignored. */
+void     msg_pool_release(NvDsCustomMsgInfo *msg);
+
+void     msg_pool_get_stats(MsgPool *pool, MsgPoolStats *stats);
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef MSG_SHED_H
+#define MSG_SHED_H
+
+#include <gst/gst.h>
+
+#include "nvdsmeta.h"
+#include "msg_pool.h"
+#include "event_spool.h"
+
+typedef struct {
+    guint low_pct;      /* queue fill, in percent, from which LOW messages are removed */
+    guint normal_pct;   /* and from which NORMAL ones are too; HIGH stays */
+} MsgShedOptions;
+
+/**
+ * Priority shedding in front of the bounded broker queue: as its fill rises,
+ * removes the broker messages (msg_pool.h MsgPriority) of each batch below a
+ * floor, so that batches left without messages are dropped by
+ * probe_drop_frame and the queue holds the high priority ones when it leaks.
+ * With an EventSpool, removed messages are spilled to it rather than lost,
+ * and while the spool sees the broker down every message is.  Counts what it
+ * discards, and the queue's overruns, in metrics.h.  Setup belongs to the
+ * main loop; msg_shed_batch runs on the streaming thread feeding the queue.
+ */
+typedef struct MsgShed MsgShed;
+
+/** Keeps a ref on queue, an element with the queue level properties. */
+MsgShed    *msg_shed_new(GstElement *queue, const MsgShedOptions *options);
+void        msg_shed_free(MsgShed *shed);
+
+/** Spill target for removed messages; NULL discards them.  Not owned. */
+void        msg_shed_set_spool(MsgShed *shed, EventSpool *spool);
+
+/** Lowest priority kept at fill_pct. */
+MsgPriority msg_shed_floor(const MsgShedOptions *options, guint fill_pct);
+
+/** Removes the batch's messages below the floor at the queue's current fill; returns how many. */
+guint       msg_shed_batch(MsgShed *shed, NvDsBatchMeta *batch_meta);
+
+#endif
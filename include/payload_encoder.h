@@ -0,0 +1,117 @@
+#ifndef PAYLOAD_ENCODER_H
+#define PAYLOAD_ENCODER_H
+
+#include <glib.h>
+
+#include "track_state.h"
+
+/* First byte of every binary payload, never the first byte of text or JSON, then the schema version. */
+#define PAYLOAD_BINARY_MAGIC      0xA5
+#define PAYLOAD_BINARY_BLOB_MAGIC 0xA6
+#define PAYLOAD_BINARY_VERSION    1
+
+/* Label bytes payload_decode_binary keeps, NUL included; longer labels are truncated. */
+#define PAYLOAD_LABEL_MAX 64
+
+/** One broker event; strings are borrowed for the duration of the encode. */
+typedef struct {
+    guint64      object_id;
+    guint        source_id;
+    gint64       frame_num;
+    guint64      timestamp_ns;   /* frame ntp_timestamp (LOST: of the frame that noticed it); 0 when the muxer set none */
+    TrackEvent   event;          /* TRACK_EVENT_NONE for untracked per-frame messages */
+    gboolean     has_bbox;       /* FALSE when the object is not in this frame (lost tracks) */
+    gfloat       left, top, width, height;
+    gfloat       confidence;     /* detector, with has_bbox; every confidence is negative when unknown */
+    const gchar *brand;          /* NULL when unknown; its confidence is then ignored */
+    const gchar *type;
+    const gchar *plate;
+    gfloat       brand_conf;     /* classifier probability or consensus share */
+    gfloat       type_conf;
+    gfloat       plate_conf;
+} PayloadEvent;
+
+/**
+ * Writes event into buf like snprintf: returns the full encoded length and
+ * writes all of it only when that is below size.  Never allocates.
+ */
+typedef gsize (*PayloadEncodeFunc)(const PayloadEvent *event, gchar *buf, gsize size);
+
+/**
+ * A payload format for broker messages:
+ *
+ * - "text": the legacy "Vehicle ID: 42, Brand: ford, ..." line, kept byte for
+ *   byte.  Carries no frame, timestamp, box or confidences.
+ * - "json": one object with every key present; unknown values, and the box
+ *   of a lost track, are null.  Confidences have three decimals and box
+ *   coordinates are rounded to whole pixels.
+ * - "binary": PAYLOAD_BINARY_MAGIC, PAYLOAD_BINARY_VERSION, then fields in the
+ *   protobuf wire format, so a decoder skips fields it does not know.  Field
+ *   numbers: 1 object_id, 2 source_id, 3 frame_num, 4 timestamp_ns,
+ *   5 event (TrackEvent), 6 left and 7 top (zigzag), 8 width, 9 height,
+ *   10 confidence, 11 brand, 12 brand_conf, 13 type, 14 type_conf, 15 plate,
+ *   16 plate_conf.  Confidences are in thousandths and boxes in whole pixels.
+ *   Unknown values are left out and decode as NULL labels and -1
+ *   confidences.  The version changes only when an existing field changes
+ *   meaning.
+ */
+typedef enum {
+    PAYLOAD_FORMAT_TEXT,
+    PAYLOAD_FORMAT_JSON,
+    PAYLOAD_FORMAT_BINARY,
+} PayloadFormat;
+
+typedef struct {
+    const gchar      *name;
+    PayloadFormat     format;
+    gboolean          binary;   /* payloads may hold any byte, newlines included */
+    PayloadEncodeFunc encode;
+} PayloadEncoder;
+
+/** "text", "json" or "binary"; NULL for anything else. */
+const PayloadEncoder *payload_encoder_lookup(const gchar *name);
+
+/** A binary payload decoded; the event's labels point into the arrays. */
+typedef struct {
+    PayloadEvent event;
+    gchar        brand[PAYLOAD_LABEL_MAX];
+    gchar        type[PAYLOAD_LABEL_MAX];
+    gchar        plate[PAYLOAD_LABEL_MAX];
+} PayloadDecoded;
+
+/** FALSE on a truncated payload, a wrong magic or a newer schema version. */
+gboolean payload_decode_binary(const void *data, gsize len, PayloadDecoded *out);
+
+/**
+ * Several events in one payload: a count, then one record per event in the
+ * encoder's format.
+ *
+ * - text: "Events: <n>", then each legacy line after a newline.
+ * - json: {"v":1,"count":<n>,"events":[...]}.
+ * - binary: PAYLOAD_BINARY_BLOB_MAGIC, PAYLOAD_BINARY_VERSION, the count as
+ *   a varint, then each binary payload after its length as a varint.
+ *
+ * Records are encoded as events are added, so an event only has to live
+ * through payload_blob_add.  Not thread-safe.
+ */
+typedef struct PayloadBlob PayloadBlob;
+
+/** max_bytes bounds the finished payload, count and framing included. */
+PayloadBlob *payload_blob_new(const PayloadEncoder *encoder, gsize max_bytes);
+void         payload_blob_free(PayloadBlob *blob);
+
+/** FALSE, leaving the blob as it was, when the event would take it past max_bytes. */
+gboolean     payload_blob_add(PayloadBlob *blob, const PayloadEvent *event);
+guint        payload_blob_count(const PayloadBlob *blob);
+/** Writes the finished payload like a PayloadEncodeFunc; the records stay until reset. */
+gsize        payload_blob_write(const PayloadBlob *blob, gchar *buf, gsize size);
+void         payload_blob_reset(PayloadBlob *blob);
+
+/** Called with each record of a binary blob, a binary payload of its own; FALSE stops. */
+typedef gboolean (*PayloadRecordFunc)(const void *record, gsize len, gpointer user_data);
+
+/** FALSE when data is not a whole binary blob or func stopped early. */
+gboolean     payload_split_binary_blob(const void *data, gsize len, PayloadRecordFunc func,
+                                       gpointer user_data);
+
+#endif
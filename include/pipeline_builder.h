@@ -3,13 +3,42 @@
 
 #include <gst/gst.h>
 
+#include "pipeline_config.h"
+#include "synthetic_meta.h"
+
 /**
  * Opaque handle for element creation; linking is handled by PipelineLinker.
  * Pointers returned by add_* belong to the pipeline bin; do not unref them.
  */
 typedef struct PipelineBuilder PipelineBuilder;
 
-PipelineBuilder *pipeline_builder_new(const char *config_path);
+typedef enum {
+    PIPELINE_BACKEND_DEEPSTREAM,
+    /**
+     * No GPU: avdec_h264 decoders each followed by a fake_infer.h element, funnel
+     * as the muxer, identity for every DeepStream filter and fakesink for the
+     * broker and display.  Element names, and so probe attachment, are unchanged.
+     */
+    PIPELINE_BACKEND_SOFTWARE,
+} PipelineBackend;
+
+typedef struct {
+    PipelineBackend     backend;
+    SyntheticMetaParams synthetic;   /* software only: object density per frame (batch_size unused) */
+    /**
+     * Nothing is drawn or displayed: nvvideoconvert and nvdsosd become identity
+     * and the broker sink does not sync to the clock.  The caller leaves out
+     * the tiler, tee, render queue and display sink.
+     */
+    gboolean            headless;
+} PipelineBuilderOptions;
+
+/**
+ * Every element is configured from config, which must outlive the builder;
+ * no file is read.  options NULL builds the DeepStream pipeline.
+ */
+PipelineBuilder *pipeline_builder_new(const PipelineConfig         *config,
+                                      const PipelineBuilderOptions *options);
 void             pipeline_builder_free(PipelineBuilder *builder);
 
 /** Returned reference is not owned by the caller. */
@@ -19,26 +48,55 @@ GstElement      *pipeline_builder_get_pipeline(PipelineBuilder *builder);
 GstElement      *pipeline_builder_get_element(PipelineBuilder *builder,
                                                const gchar     *name);
 
-GstElement *pipeline_builder_add_source    (PipelineBuilder *builder);
-GstElement *pipeline_builder_add_h264parser(PipelineBuilder *builder);
-GstElement *pipeline_builder_add_decoder   (PipelineBuilder *builder);
+/** One "source-bin-<i>" per config source (see source_bin.h); FALSE when one cannot be built. */
+gboolean    pipeline_builder_add_sources(PipelineBuilder *builder);
+guint       pipeline_builder_get_n_sources(PipelineBuilder *builder);
+
+/** batch-size is set to the number of sources added before it. */
 GstElement *pipeline_builder_add_streamux  (PipelineBuilder *builder);
-GstElement *pipeline_builder_add_tracker   (PipelineBuilder *builder);
 GstElement *pipeline_builder_add_nvvidconv (PipelineBuilder *builder);
 GstElement *pipeline_builder_add_nvosd     (PipelineBuilder *builder);
+/** Grid of all sources at the muxer resolution, for the render branch. */
+GstElement *pipeline_builder_add_tiler     (PipelineBuilder *builder);
 GstElement *pipeline_builder_add_tee       (PipelineBuilder *builder);
 GstElement *pipeline_builder_add_msgconv   (PipelineBuilder *builder);
 GstElement *pipeline_builder_add_msgbroker (PipelineBuilder *builder);
+/** "msg-broker" as a fakesink, for an in-process publisher in place of nvmsgconv and nvmsgbroker. */
+GstElement *pipeline_builder_add_msg_sink  (PipelineBuilder *builder);
 
-/** Picks nv3dsink (integrated GPU) or nveglglessink (discrete) according to CUDA device. */
+/** Picks nv3dsink (integrated GPU) or nveglglessink (discrete) according to CUDA device; "fake-sink" in software. */
 GstElement *pipeline_builder_add_sink(PipelineBuilder *builder);
 
-/** config_section: YAML key passed to nvds_parse_gie (e.g. "primary-gie", "secondary-gie1"). */
-GstElement *pipeline_builder_add_infer(PipelineBuilder *builder,
-                                       const gchar     *element_name,
-                                       const gchar     *config_section);
+/** config: the node's section of the app YAML (e.g. "primary-gie", "secondary-gie1"). */
+GstElement *pipeline_builder_add_infer(PipelineBuilder   *builder,
+                                       const gchar       *element_name,
+                                       const InferConfig *config);
+
+/** config: the node's section of the app YAML (e.g. "tracker"). */
+GstElement *pipeline_builder_add_tracker(PipelineBuilder     *builder,
+                                         const gchar         *element_name,
+                                         const TrackerConfig *config);
 
 GstElement *pipeline_builder_add_queue(PipelineBuilder *builder,
                                        const gchar     *element_name);
 
+/**
+ * Queue bounded to max_buffers only (no byte or time limit); leaky is the
+ * queue "leaky" nick: "no", "upstream" (drops new buffers) or "downstream"
+ * (drops the oldest).
+ */
+GstElement *pipeline_builder_add_bounded_queue(PipelineBuilder *builder,
+                                               const gchar     *element_name,
+                                               guint            max_buffers,
+                                               const gchar     *leaky);
+
+/**
+ * One element per node of the config's gie_graph, plus the tee and queues
+ * after each fan-out and a gie_join.h element before each fan-in and, with
+ * several exits, before nvvideoconvert (names in gie_graph.h).
+ */
+gboolean    pipeline_builder_add_gie_graph(PipelineBuilder *builder);
+/** The config's graph, for the linker. */
+const GieGraph *pipeline_builder_get_gie_graph(PipelineBuilder *builder);
+
 #endif
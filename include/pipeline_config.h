@@ -0,0 +1,138 @@
+#ifndef PIPELINE_CONFIG_H
+#define PIPELINE_CONFIG_H
+
+#include <glib.h>
+#include <yaml.h>
+
+#include "broker_link.h"
+#include "config.h"
+#include "gie_graph.h"
+#include "source_config.h"
+
+/*
+ * A number or flag a section leaves out, so the element keeps its own
+ * default; text left out is NULL.  File names are relative to the app YAML's
+ * directory and are stored absolute; library names without a '/' are left
+ * to dlopen.
+ */
+#define PIPELINE_CONFIG_UNSET G_MININT
+
+/** "streammux:" for nvstreammux; batch-size is accepted and ignored (one frame per source). */
+typedef struct {
+    gint batched_push_timeout;   /* us; -1 waits for a full batch */
+    gint width;                  /* required with DeepStream */
+    gint height;
+    gint live_source;
+    gint enable_padding;
+    gint gpu_id;
+    gint nvbuf_memory_type;
+} StreammuxConfig;
+
+/** The section an infer node of gie-graph names, for nvinfer (plugin-type 0 only). */
+typedef struct {
+    gchar *config_file_path;     /* required with DeepStream */
+    gint   batch_size;
+    gint   interval;
+    gint   gpu_id;
+    gint   unique_id;
+} InferConfig;
+
+/** The section a tracker node names ("tracker:" by default), for nvtracker. */
+typedef struct {
+    gint   tracker_width;
+    gint   tracker_height;
+    gint   gpu_id;
+    gchar *ll_lib_file;          /* required with DeepStream */
+    gchar *ll_config_file;
+    gint   display_tracking_id;
+} TrackerConfig;
+
+/** Settings of one gie-graph node: infer or tracker, after its GieNodeType. */
+typedef struct {
+    InferConfig   infer;
+    TrackerConfig tracker;
+} GieNodeConfig;
+
+/** "msgconv:" for nvmsgconv. */
+typedef struct {
+    gchar *config;               /* schema file */
+    gint   payload_type;         /* 0, 1, 2 or 257 (custom) */
+    gchar *msg2p_lib;
+    gint   msg2p_newapi;
+    gint   frame_interval;
+    gchar *debug_payload_dir;    /* must exist */
+    gint   comp_id;
+} MsgconvConfig;
+
+/** "msgbroker:", for nvmsgbroker, the native publisher and the journal's own link. */
+typedef struct {
+    BrokerLinkOptions link;      /* conn-str and topic always required */
+    gint              sync;
+    gint              comp_id;
+} MsgbrokerConfig;
+
+/* Classifier thresholds of the runtime section, in RuntimeConfig.min_prob order. */
+typedef enum {
+    RUNTIME_MAKE_THRESHOLD,      /* make-threshold:  VehicleMakeNet */
+    RUNTIME_TYPE_THRESHOLD,      /* type-threshold:  VehicleTypeNet */
+    RUNTIME_PLATE_THRESHOLD,     /* plate-threshold: LPRNet */
+    RUNTIME_N_THRESHOLDS,
+} RuntimeThreshold;
+
+/**
+ * "runtime:", what config_reload.h changes on a running pipeline:
+ *
+ *   pgie-interval            PGIE "interval"; left alone when unset
+ *   make-threshold,          result_prob below which VehicleMakeNet, VehicleTypeNet
+ *   type-threshold,          and LPRNet labels are ignored (frame_index_set_min_prob);
+ *   plate-threshold          default 0
+ *   detection-output-dir     default DETECTION_OUTPUT_DIR, "" for none
+ *   track-heartbeat-frames   default TRACK_HEARTBEAT_FRAMES
+ *   track-lost-frames        default TRACK_LOST_FRAMES
+ */
+typedef struct {
+    gint    pgie_interval;
+    gfloat  min_prob[RUNTIME_N_THRESHOLDS];
+    gchar  *detection_output_dir;
+    gint    track_heartbeat_frames;
+    gint    track_lost_frames;
+} RuntimeConfig;
+
+/** The app YAML, parsed once; nothing in it is read again to build the pipeline. */
+typedef struct {
+    gchar          *path;
+    yaml_document_t *doc;        /* as parsed, for config_reload_new() */
+    gint64          mtime_ns;    /* yaml_util_stamp() of path before it was parsed */
+    gint64          size;
+    SourceList     *sources;
+    StreammuxConfig streammux;
+    GieGraph       *gie_graph;
+    GieNodeConfig  *nodes;       /* one per gie_graph node */
+    MsgconvConfig   msgconv;
+    MsgbrokerConfig msgbroker;
+    RuntimeConfig   runtime;
+    AppSettings     settings;    /* the environment's, config.h */
+} PipelineConfig;
+
+/**
+ * Reads the settings from the environment and parses and checks the whole
+ * file before any element exists: value types and ranges, unknown keys,
+ * every section a gie-graph node names and, for the backend and publisher
+ * the settings choose, that each file named is there.  NULL when anything
+ * is wrong, after logging each problem with its line or variable.  A
+ * section whose keys are all commented out counts as empty.
+ */
+PipelineConfig *pipeline_config_load(const char *yaml_path);
+void            pipeline_config_free(PipelineConfig *config);
+
+/** The runtime section of doc, settings' defaults for what it leaves out; FALSE (logged against yaml_path) on a bad value. */
+gboolean     pipeline_config_parse_runtime(yaml_document_t *doc, const char *yaml_path,
+                                           const AppSettings *settings, RuntimeConfig *out);
+/** Defaults only, as without a runtime section. */
+void         runtime_config_init(RuntimeConfig *runtime, const AppSettings *settings);
+void         runtime_config_clear(RuntimeConfig *runtime);
+/** YAML key of threshold, e.g. "make-threshold", and the unique-id of its classifier. */
+const gchar *runtime_threshold_key(RuntimeThreshold threshold);
+gint         runtime_threshold_component(RuntimeThreshold threshold);
+
+#endif
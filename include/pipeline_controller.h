@@ -3,7 +3,15 @@
 
 #include <gst/gst.h>
 
-/** Owns the pipeline and main loop; the bus watch quits the loop on EOS or error. */
+/**
+ * Owns the pipeline and main loop; the bus watch quits the loop on EOS or error.
+ * When the director attached a "load-shedder" (LOAD_CONTROL), it is ticked
+ * every LOAD_INTERVAL_MS and each level change is logged and posted on the
+ * bus as a "load-level" application message (level, latency-ms, queue-fill).
+ * A "run-report" (HEADLESS) is logged at EOS.  A "buffer-trace" (TRACE_FILE)
+ * is written at EOS and on each SIGUSR1.  A "config-reload" is applied on each
+ * SIGHUP and, with CONFIG_WATCH_MS, whenever the config file changes.
+ */
 typedef struct PipelineController PipelineController;
 
 PipelineController *pipeline_controller_new(GstElement *pipeline);
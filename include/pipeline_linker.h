@@ -6,7 +6,11 @@
 
 /**
  * Links all elements built by the builder.  TRUE on success, FALSE on link or
- * pad-request failure.  Request pads are used for streamux (sink_0) and tee (src_%u).
+ * pad-request failure.  Request pads are used for streamux (sink_<i> per
+ * source bin) and tee (src_%u); a "tiler", when built, goes before the sink.
+ * The GIE graph between muxer and nvvideoconvert follows
+ * pipeline_builder_get_gie_graph(), each join branch tagged with the
+ * gie-unique-ids it adds (gie_join_link_branch).
  */
 gboolean pipeline_linker_link(PipelineBuilder *builder);
 
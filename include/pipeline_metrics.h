@@ -0,0 +1,16 @@
+#ifndef PIPELINE_METRICS_H
+#define PIPELINE_METRICS_H
+
+#include <gst/gst.h>
+
+#include "metrics_server.h"
+
+/**
+ * Samples a built pipeline into the metrics registry: a buffer counter (with
+ * rate) on every element's src pad, or sink pad for sinks, and the current
+ * level of every queue, read when the server renders.  Needs only stock
+ * GStreamer elements.  Call once, before the pipeline starts.
+ */
+void pipeline_metrics_watch(MetricsServer *server, GstElement *pipeline);
+
+#endif
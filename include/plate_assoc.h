@@ -0,0 +1,43 @@
+#ifndef PLATE_ASSOC_H
+#define PLATE_ASSOC_H
+
+#include <glib.h>
+
+#include "nvdsmeta.h"
+
+typedef enum {
+    PLATE_ASSOC_SCORE_CONTAINMENT,  /* share of the plate box inside the car box; ties go to the higher IoU */
+    PLATE_ASSOC_SCORE_IOU,          /* IoU, as the original brute-force match */
+} PlateAssocScore;
+
+typedef struct {
+    PlateAssocScore score;
+    gfloat          min_score;   /* a pair must score strictly above this */
+    gboolean        use_parent;  /* trust obj->parent when nvinfer linked the plate to a TrafficCamNet car */
+    gboolean        one_to_one;  /* at most one plate per car; best-scoring pairs claim first */
+} PlateAssocOptions;
+
+/**
+ * Matches LPDNet plates to TrafficCamNet cars in one frame.  Plates linked to
+ * a car through obj->parent take that car; the rest are scored only against
+ * cars sharing a cell of a uniform grid over the car boxes, with a SIMD kernel
+ * (AVX when built with -mavx, else SSE2, else scalar) over structure-of-arrays
+ * rects.  Scratch buffers are reused between frames.  Not thread-safe; use one
+ * instance per streaming thread.
+ */
+typedef struct PlateAssoc PlateAssoc;
+
+PlateAssoc *plate_assoc_new(const PlateAssocOptions *options);
+void        plate_assoc_free(PlateAssoc *assoc);
+
+/** Matches the frame's plates without touching the meta; returns the number of plates. */
+guint plate_assoc_match_frame(PlateAssoc *assoc, NvDsFrameMeta *frame_meta);
+
+/** i-th plate of the last match, in obj_meta_list order, and its car or NULL. */
+NvDsObjectMeta *plate_assoc_plate(const PlateAssoc *assoc, guint i);
+NvDsObjectMeta *plate_assoc_car(const PlateAssoc *assoc, guint i);
+
+/** Matches and copies each car's object_id onto its plate; returns the number of plates matched. */
+guint plate_assoc_apply(PlateAssoc *assoc, NvDsFrameMeta *frame_meta);
+
+#endif
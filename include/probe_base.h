@@ -3,11 +3,21 @@
 
 #include <gst/gst.h>
 
-/** Registers a buffer probe on the static pad (pad unreffed after registration).  TRUE on success. */
+/**
+ * Registers a buffer probe on the static pad (pad unreffed after registration).  TRUE on success.
+ * With ENABLE_PROBE_STATS the callback is timed under the name "element:pad"; see probe_stats.h.
+ */
 gboolean probe_base_add_buffer_probe(
     GstElement *element,
     const char *pad_name,
     GstPadProbeReturn (*callback)(GstPad *, GstPadProbeInfo *, gpointer),
     gpointer user_data);
 
+/** Registers a downstream event probe on the static pad, like probe_base_add_buffer_probe but untimed. */
+gboolean probe_base_add_event_probe(
+    GstElement *element,
+    const char *pad_name,
+    GstPadProbeReturn (*callback)(GstPad *, GstPadProbeInfo *, gpointer),
+    gpointer user_data);
+
 #endif
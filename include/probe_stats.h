@@ -0,0 +1,54 @@
+#ifndef PROBE_STATS_H
+#define PROBE_STATS_H
+
+#include <gst/gst.h>
+
+#define PROBE_STATS_MAX_PROBES 32
+#define PROBE_STATS_NAME_MAX   64
+
+/* Log-linear buckets: 2^SUB_BITS linear steps per power of two of nanoseconds. */
+#define PROBE_STATS_SUB_BITS   3
+#define PROBE_STATS_BUCKETS    ((40 - PROBE_STATS_SUB_BITS + 2) << PROBE_STATS_SUB_BITS)  /* up to 2^41 ns */
+
+/** Point-in-time copy of one probe's counters; percentiles are bucket upper bounds. */
+typedef struct {
+    gchar   name[PROBE_STATS_NAME_MAX];
+    guint64 calls;
+    guint64 drops;      /* calls that returned GST_PAD_PROBE_DROP */
+    guint64 total_ns;
+    guint64 max_ns;
+    guint64 p50_ns;
+    guint64 p90_ns;
+    guint64 p99_ns;
+} ProbeStatsSnapshot;
+
+/**
+ * Per-probe call counts and latency histograms for callbacks registered
+ * through probe_base.  Recording is a few relaxed atomic adds on counters
+ * private to the probe, so streaming threads never contend on a lock.  Built
+ * only with -DENABLE_PROBE_STATS; otherwise registration returns NULL,
+ * snapshots are empty and nothing wraps the callbacks.
+ */
+typedef struct ProbeStatsSlot ProbeStatsSlot;
+
+/** NULL when stats are compiled out or all PROBE_STATS_MAX_PROBES slots are taken. */
+ProbeStatsSlot   *probe_stats_register(const gchar        *name,
+                                       GstPadProbeCallback callback,
+                                       gpointer            user_data);
+
+/** Pad probe with a ProbeStatsSlot as user_data; times the wrapped callback. */
+GstPadProbeReturn probe_stats_probe(GstPad          *pad,
+                                    GstPadProbeInfo *info,
+                                    gpointer         user_data);
+
+/** Fills up to max snapshots in registration order; returns how many. */
+guint probe_stats_snapshot(ProbeStatsSnapshot *out, guint max);
+
+/** Raw histogram of probe i; counts[k] holds calls at most probe_stats_bucket_upper_ns(k). FALSE if i is out of range. */
+gboolean probe_stats_histogram(guint i, guint64 counts[PROBE_STATS_BUCKETS]);
+guint64  probe_stats_bucket_upper_ns(guint bucket);
+
+/** One log_info line per registered probe. */
+void  probe_stats_log(void);
+
+#endif
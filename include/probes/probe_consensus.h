@@ -0,0 +1,24 @@
+#ifndef PROBE_CONSENSUS_H
+#define PROBE_CONSENSUS_H
+
+#include <gst/gst.h>
+
+#include "frame_index.h"
+
+/** Meta stage consumer on nvosd sink with a TrackConsensus as user_data; votes the frame's labels. */
+void probe_consensus_vote(const FrameIndex *index, gpointer user_data);
+
+/**
+ * Attach to the tracker src with a TrackConsensus as user_data; hides stable
+ * cars from the SGIEs behind it by offsetting their class_id.
+ */
+GstPadProbeReturn probe_consensus_gate(GstPad *pad,
+                                       GstPadProbeInfo *info,
+                                       gpointer user_data);
+
+/** Attach to the last SGIE's src; restores the class_id probe_consensus_gate offset. */
+GstPadProbeReturn probe_consensus_restore(GstPad *pad,
+                                          GstPadProbeInfo *info,
+                                          gpointer user_data);
+
+#endif
@@ -1,11 +1,15 @@
 #ifndef PROBE_DETECTIONS_H
 #define PROBE_DETECTIONS_H
 
-#include <gst/gst.h>
+#include <glib.h>
 
-/** Attach to nvosd sink; writes .txt files under config_get_detection_output_dir(). */
-GstPadProbeReturn probe_write_detections(GstPad *pad,
-                                         GstPadProbeInfo *info,
-                                         gpointer user_data);
+#include "frame_index.h"
+
+/**
+ * Meta stage consumer on nvosd sink with a DetectionWriter as user_data; copies
+ * car and plate boxes into the writer's queue.  Frames are numbered per source,
+ * from frame_meta->frame_num + 1.  File I/O happens on the writer thread.
+ */
+void probe_write_detections(const FrameIndex *index, gpointer user_data);
 
 #endif
@@ -3,7 +3,11 @@
 
 #include <gst/gst.h>
 
-/** Attach to queue1 sink; drops buffers that carry no user meta (nothing to send to the broker branch). */
+/**
+ * Attach to queue1 sink; drops buffers none of whose frames carry user meta
+ * (nothing to send to the broker branch).  user_data is an optional MetricsCounter that
+ * counts the frames of every dropped batch.
+ */
 GstPadProbeReturn probe_drop_frame(GstPad *pad,
                                    GstPadProbeInfo *info,
                                    gpointer user_data);
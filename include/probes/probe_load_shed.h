@@ -0,0 +1,25 @@
+#ifndef PROBE_LOAD_SHED_H
+#define PROBE_LOAD_SHED_H
+
+#include <gst/gst.h>
+
+/** Attach to a shed SGIE's sink with its LoadShedGate as user_data; hides objects while shed. */
+GstPadProbeReturn probe_load_shed_hide(GstPad *pad,
+                                       GstPadProbeInfo *info,
+                                       gpointer user_data);
+
+/** Attach to the same SGIE's src with the same gate; undoes probe_load_shed_hide. */
+GstPadProbeReturn probe_load_shed_restore(GstPad *pad,
+                                          GstPadProbeInfo *info,
+                                          gpointer user_data);
+
+/**
+ * Attach to a sink pad past the GIEs (the broker sink, or queue1 when it
+ * leaks) with a LoadShedder as user_data; notes running time at arrival minus
+ * buffer PTS, which for sources played in real time is the latency up to there.
+ */
+GstPadProbeReturn probe_load_shed_latency(GstPad *pad,
+                                          GstPadProbeInfo *info,
+                                          gpointer user_data);
+
+#endif
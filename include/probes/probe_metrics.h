@@ -0,0 +1,24 @@
+#ifndef PROBE_METRICS_H
+#define PROBE_METRICS_H
+
+#include <gst/gst.h>
+
+#include "metrics.h"
+
+#define PROBE_METRICS_MAX_SOURCES 64
+
+/** One frame counter per source_id, registered the first time that source is seen. */
+typedef struct {
+    MetricsCounter *frames[PROBE_METRICS_MAX_SOURCES];
+} SourceFrameCounters;
+
+/**
+ * Attach to the streammux src pad with a zeroed SourceFrameCounters as
+ * user_data; counts frames per source into traffic_guard_frames_total.
+ * Sources at or past PROBE_METRICS_MAX_SOURCES are not counted.
+ */
+GstPadProbeReturn probe_count_source_frames(GstPad *pad,
+                                            GstPadProbeInfo *info,
+                                            gpointer user_data);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef PROBE_MSG_SHED_H
+#define PROBE_MSG_SHED_H
+
+#include <gst/gst.h>
+
+/**
+ * Attach to queue1 sink with a MsgShed as user_data, before probe_drop_frame
+ * so that batches it empties are dropped too.
+ */
+GstPadProbeReturn probe_msg_shed(GstPad *pad,
+                                 GstPadProbeInfo *info,
+                                 gpointer user_data);
+
+#endif
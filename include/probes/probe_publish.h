@@ -0,0 +1,33 @@
+#ifndef PROBE_PUBLISH_H
+#define PROBE_PUBLISH_H
+
+#include <gst/gst.h>
+
+#include "mqtt_publisher.h"
+#include "probes/probe_send.h"
+
+/**
+ * Attach to the msg-broker sink (a fakesink with MSG_PUBLISHER=native) with an
+ * MqttPublisher as user_data; posts the payload of every broker message in the
+ * batch to it.
+ */
+GstPadProbeReturn probe_publish(GstPad *pad,
+                                GstPadProbeInfo *info,
+                                gpointer user_data);
+
+typedef struct {
+    MqttPublisher    *publisher;
+    ProbeSendContext *send;   /* its window blob is posted at EOS */
+} ProbePublishEos;
+
+/**
+ * Downstream event probe on the same pad with a ProbePublishEos as user_data.
+ * At EOS, posts the window blob probe_send still has open, which has no batch
+ * left to ride on.  The EOS follows the last frame through probe_send, so the
+ * blob is no longer written to.
+ */
+GstPadProbeReturn probe_publish_eos(GstPad *pad,
+                                    GstPadProbeInfo *info,
+                                    gpointer user_data);
+
+#endif
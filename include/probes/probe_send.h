@@ -1,11 +1,60 @@
 #ifndef PROBE_SEND_H
 #define PROBE_SEND_H
 
+#include <stdatomic.h>
 #include <gst/gst.h>
 
-/** Attach to nvosd sink; attaches NVDS_CUSTOM_MSG_BLOB payload for the message broker. */
-GstPadProbeReturn probe_send(GstPad *pad,
-                             GstPadProbeInfo *info,
-                             gpointer user_data);
+#include "frame_index.h"
+#include "metrics.h"
+#include "msg_pool.h"
+#include "payload_encoder.h"
+#include "track_state.h"
+#include "track_consensus.h"
+
+typedef struct {
+    MsgPool    *pool;
+    TrackState *tracks;   /* NULL sends every vehicle and plate on every frame */
+    TrackConsensus *consensus;  /* NULL sends the current frame's labels */
+    MetricsCounter *messages;   /* counts attached messages; may be NULL */
+    const PayloadEncoder *encoder;  /* NULL encodes the legacy text */
+    PayloadBlob    *blob;       /* NULL attaches one message per event; else events are packed into blobs */
+    guint           blob_window_ms;  /* 0 sends the blob at the end of every frame */
+
+    /* probe_send's own: the open blob */
+    MsgPriority     blob_priority;
+    gint64          blob_opened_us;
+
+    /* From probe_send_set_track_timing, for the tracks from the next frame. */
+    atomic_uint     next_heartbeat_frames;
+    atomic_uint     next_lost_frames;
+    atomic_bool     track_timing_changed;
+} ProbeSendContext;
+
+/**
+ * Meta stage consumer on nvosd sink with a ProbeSendContext as user_data;
+ * attaches NVDS_CUSTOM_MSG_BLOB payloads for the message broker, encoded by
+ * the context's PayloadEncoder straight into MsgPool blocks.  Without a
+ * TrackState, one event per vehicle and plate on every frame; with one, one
+ * per track event.  Each event is a message of its own or, with a
+ * PayloadBlob, a record of a blob sent when it is full or blob_window_ms
+ * after its first event, on whichever frame comes then (see
+ * probe_send_take_blob for the one open at EOS).  Each message
+ * carries a MsgPriority for msg_shed.h: first sightings and plate changes
+ * high, heartbeats and untracked per-frame events low; a blob takes the
+ * highest of its events.  With a TrackConsensus, each track's voted labels
+ * replace the frame's where known.
+ */
+void probe_send(const FrameIndex *index, gpointer user_data);
+
+/**
+ * The blob still open, as one pooled message at its priority, and the blob
+ * reset; NULL when none is open.  For the end of stream, where no frame is
+ * left to send it on: call once the last frame has been through probe_send,
+ * and msg_pool_release the message.
+ */
+NvDsCustomMsgInfo *probe_send_take_blob(ProbeSendContext *ctx);
+
+/** track_state_set_timing for the context's tracks; any thread, applied from the next frame. */
+void probe_send_set_track_timing(ProbeSendContext *ctx, guint heartbeat_frames, guint lost_after_frames);
 
 #endif
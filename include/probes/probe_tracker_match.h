@@ -3,7 +3,10 @@
 
 #include <gst/gst.h>
 
-/** Attach to nvvidconv sink; copies parent car object_id to plate via IoU match so both share one tracker ID. */
+/**
+ * Attach to nvvidconv sink with a PlateAssoc as user_data; copies each plate's
+ * car object_id onto the plate so both share one tracker ID.
+ */
 GstPadProbeReturn probe_match_tracker_ids(GstPad *pad,
                                           GstPadProbeInfo *info,
                                           gpointer user_data);
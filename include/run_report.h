@@ -0,0 +1,25 @@
+#ifndef RUN_REPORT_H
+#define RUN_REPORT_H
+
+#include <gst/gst.h>
+
+/**
+ * End-of-run throughput report for a built pipeline: frames out of the
+ * muxer, wall time from its first batch to the last batch into a sink,
+ * frames/s, and the mean time a batch spends in each element with a "sink"
+ * and a "src" pad, from one pad to the other.  A batch is matched across the
+ * element by its first frame's source and PTS, so elements that output a new
+ * buffer are timed too; batches that never come out are counted apart.
+ * Needs only stock GStreamer elements; frames are counted from
+ * NvDsBatchMeta, one per buffer without it.
+ */
+typedef struct RunReport RunReport;
+
+/** Probes every top-level element; call once, before the pipeline starts. */
+RunReport *run_report_new(GstElement *pipeline);
+void       run_report_free(RunReport *report);
+
+/** Logs the report; call once the streaming threads have stopped (after EOS). */
+void       run_report_log(RunReport *report);
+
+#endif
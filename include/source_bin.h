@@ -0,0 +1,30 @@
+#ifndef SOURCE_BIN_H
+#define SOURCE_BIN_H
+
+#include <gst/gst.h>
+
+#include "source_config.h"
+
+/**
+ * filesrc ! h264parse ! <decoder_factory> for one source, in a bin named
+ * "source-bin-<index>" with a ghost "src" pad.  Only the decoder is
+ * DeepStream-specific, so "avdec_h264" builds the same graph on CPU.
+ * Floating reference, or NULL (logged) when an element cannot be created.
+ */
+GstElement *source_bin_new(guint index, const SourceSpec *spec, const gchar *decoder_factory);
+
+/**
+ * Adds element to the bin after the current last element and moves the ghost
+ * "src" pad onto it.  The bin takes the floating reference; FALSE when the
+ * link fails.
+ */
+gboolean source_bin_append(GstElement *source_bin, GstElement *element);
+
+/**
+ * Links the bin's src pad to the muxer's request pad "sink_<index>", which
+ * makes index the frame_meta->source_id of its frames.  Works with any muxer
+ * whose request template is "sink_%u" (nvstreammux, funnel).  TRUE on success.
+ */
+gboolean source_bin_link(GstElement *source_bin, GstElement *muxer, guint index);
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef SOURCE_CONFIG_H
+#define SOURCE_CONFIG_H
+
+#include <glib.h>
+#include <yaml.h>
+
+#define SOURCE_CONFIG_MAX_SOURCES 64
+
+typedef struct {
+    gchar *name;       /* "name:" or "source-<index>" */
+    gchar *location;   /* H.264 elementary stream */
+} SourceSpec;
+
+/** Sources in YAML order; a source's index is its muxer pad and frame_meta->source_id. */
+typedef struct {
+    SourceSpec *items;
+    guint       n;
+} SourceList;
+
+/**
+ * Reads the "sources:" sequence of mappings (each with "location:" and an
+ * optional "name:") from the app YAML, or the single "source:" mapping when
+ * there is no list.  NULL (logged) when the file cannot be parsed, no source
+ * is given, an entry has no location, or there are more than
+ * SOURCE_CONFIG_MAX_SOURCES.
+ */
+SourceList *source_list_load(const char *yaml_path);
+/** The same, from an already parsed app YAML. */
+SourceList *source_list_parse(yaml_document_t *doc);
+void        source_list_free(SourceList *sources);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <glib.h>
+
+/**
+ * Bounded single-producer/single-consumer ring of fixed-size slots.  Lock-free:
+ * the producer fills a slot in place between reserve and commit, the consumer
+ * reads it in place between peek and release.
+ */
+typedef struct SpscRing SpscRing;
+
+/** capacity is rounded up to a power of two. */
+SpscRing *spsc_ring_new(guint capacity, gsize slot_size);
+void      spsc_ring_free(SpscRing *ring);
+
+guint     spsc_ring_capacity(const SpscRing *ring);
+/** Approximate when called concurrently with the other side. */
+guint     spsc_ring_count(const SpscRing *ring);
+
+/** Producer side.  NULL when the ring is full; otherwise commit after filling. */
+gpointer  spsc_ring_reserve(SpscRing *ring);
+void      spsc_ring_commit(SpscRing *ring);
+
+/** Consumer side.  NULL when the ring is empty; otherwise release after reading. */
+gpointer  spsc_ring_peek(SpscRing *ring);
+void      spsc_ring_release(SpscRing *ring);
+
+#endif
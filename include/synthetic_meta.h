@@ -0,0 +1,33 @@
+#ifndef SYNTHETIC_META_H
+#define SYNTHETIC_META_H
+
+#include <glib.h>
+
+#include "nvdsmeta.h"
+
+/** Shape of a generated batch; the same seed always yields the same batch. */
+typedef struct {
+    guint   batch_size;          /* frames in the batch (synthetic_meta_new only) */
+    guint   objects_per_frame;   /* cars plus plates per frame */
+    gdouble plate_ratio;         /* chance a car gets an LPDNet plate, 0..1 */
+    guint   label_cardinality;   /* distinct make/type labels */
+    guint32 seed;
+} SyntheticMetaParams;
+
+/**
+ * Builds an NvDsBatchMeta through the regular pool API, shaped like the output
+ * of the full GIE chain after probe_match_tracker_ids: cars from
+ * TrafficCamNet with make/type labels, plates from LPDNet carrying their car's
+ * object_id and an LPRNet label.  Release with nvds_destroy_batch_meta().
+ */
+NvDsBatchMeta *synthetic_meta_new(const SyntheticMetaParams *params);
+
+/**
+ * Appends one such frame for source_id to batch_meta, drawing from rand; the
+ * same draw sequence yields the same frame.  Car object_ids depend only on
+ * source_id and slot, so they persist across frames like tracker ids.
+ */
+void synthetic_meta_add_frame(NvDsBatchMeta *batch_meta, const SyntheticMetaParams *params,
+                              guint source_id, guint frame_num, GRand *rand);
+
+#endif
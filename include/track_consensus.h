@@ -0,0 +1,88 @@
+#ifndef TRACK_CONSENSUS_H
+#define TRACK_CONSENSUS_H
+
+#include <glib.h>
+
+#include "nvdsmeta.h"
+#include "frame_index.h"
+
+#define TRACK_CONSENSUS_LABEL_MAX  32    /* stored label bytes, NUL included */
+#define TRACK_CONSENSUS_CANDIDATES 4     /* labels tracked per attribute */
+/* Added to a stable car's class_id so SGIEs with operate-on-class-ids: 0 pass it by. */
+#define TRACK_CONSENSUS_CLASS_OFFSET 1000
+
+typedef enum {
+    CONSENSUS_BRAND,
+    CONSENSUS_TYPE,
+    CONSENSUS_PLATE,
+    CONSENSUS_N_ATTRS,
+} ConsensusAttr;
+
+typedef struct {
+    guint    max_tracks;      /* table bound; the stalest track is evicted when full */
+    guint    ttl_frames;      /* tracks unseen this long are dropped */
+    guint    min_votes;       /* votes an attribute needs before it can be stable */
+    gfloat   min_share;       /* winner's share of the attribute's vote weight, 0..1 */
+    guint    recheck_frames;  /* stable tracks run the SGIEs again every N frames; 0 never */
+    gboolean require_plate;   /* a track without a stable plate never becomes stable */
+} TrackConsensusOptions;
+
+/** Winning labels of one track; empty strings when an attribute has no votes yet. */
+typedef struct {
+    gchar    brand[TRACK_CONSENSUS_LABEL_MAX];
+    gchar    type[TRACK_CONSENSUS_LABEL_MAX];
+    gchar    plate[TRACK_CONSENSUS_LABEL_MAX];
+    gfloat   share[CONSENSUS_N_ATTRS];
+    gboolean stable;
+} TrackConsensusView;
+
+typedef struct {
+    guint64 votes;
+    guint64 masked;       /* car-frames the SGIEs skipped */
+    guint64 rechecks;     /* stable car-frames let through to re-verify */
+    guint64 evicted;
+    guint64 expired;
+    guint   tracks;
+    guint   stable;
+} TrackConsensusStats;
+
+/**
+ * Confidence-weighted vote per tracked vehicle over make, type and plate text,
+ * keyed by (source_id, object_id).  Each attribute keeps the heaviest few
+ * labels (space-saving), weighted by the classifier's result_prob; for LPR that
+ * is the attributeConfidence from NvDsInferParseCustomNVPlate.  Memory is fixed
+ * at creation.  Calls lock internally, so the gate on the tracker pad and the
+ * vote on the OSD pad may run on different streaming threads.
+ */
+typedef struct TrackConsensus TrackConsensus;
+
+TrackConsensus *track_consensus_new(const TrackConsensusOptions *options);
+/** Logs totals. */
+void            track_consensus_free(TrackConsensus *tc);
+
+/** Moves source_id's clock to frame_num and expires a slice of stale tracks. */
+void     track_consensus_advance(TrackConsensus *tc, guint source_id, gint64 frame_num);
+
+/**
+ * Marks the track seen at its source's current frame and, when label is
+ * non-empty, adds prob (clamped to [0.01, 1]) to it.
+ */
+void     track_consensus_vote(TrackConsensus *tc, guint source_id, guint64 object_id,
+                              ConsensusAttr attr, const gchar *label, gfloat prob);
+
+/** Advances the frame's source, then votes every car's make/type and every plate's text. */
+void     track_consensus_vote_frame(TrackConsensus *tc, const FrameIndex *index);
+
+/** FALSE when the track is unknown. */
+gboolean track_consensus_lookup(TrackConsensus *tc, guint source_id, guint64 object_id,
+                                TrackConsensusView *view);
+
+/** Offsets the class_id of stable cars so the SGIEs skip them, except on recheck frames; returns how many. */
+guint    track_consensus_gate_frame(TrackConsensus *tc, NvDsFrameMeta *frame_meta);
+
+/** Undoes track_consensus_gate_frame; needs no TrackConsensus. */
+void     track_consensus_restore_frame(NvDsFrameMeta *frame_meta);
+
+void     track_consensus_get_stats(TrackConsensus *tc, TrackConsensusStats *stats);
+
+#endif
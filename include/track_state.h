@@ -0,0 +1,85 @@
+#ifndef TRACK_STATE_H
+#define TRACK_STATE_H
+
+#include <glib.h>
+
+#define TRACK_STATE_LABEL_MAX 32   /* stored label bytes, NUL included; longer labels are truncated */
+#define TRACK_STATE_MAX_SOURCES 64 /* source ids share frame clocks modulo this */
+
+typedef enum {
+    TRACK_EVENT_NONE,
+    TRACK_EVENT_NEW,        /* first frame the track is seen */
+    TRACK_EVENT_CHANGED,    /* brand, type or plate differs from the last emission */
+    TRACK_EVENT_HEARTBEAT,  /* unchanged for heartbeat_frames */
+    TRACK_EVENT_LOST,       /* unseen for lost_after_frames; the track is dropped */
+} TrackEvent;
+
+typedef struct {
+    guint max_tracks;         /* table bound; the stalest track is evicted when full */
+    guint heartbeat_frames;   /* 0 disables heartbeats */
+    guint lost_after_frames;  /* 0 disables lost events; tracks then leave only by eviction */
+} TrackStateOptions;
+
+/** Merged view of one track handed to emit callbacks; strings are valid only during the call. */
+typedef struct {
+    guint64      object_id;
+    guint        source_id;
+    gint64       last_seen;  /* frame, in source_id's numbering, that last observed it */
+    const gchar *brand;   /* NULL until a classifier reported one */
+    const gchar *type;
+    const gchar *plate;
+    gboolean     plate_changed;   /* CHANGED: the plate is among what changed */
+} TrackInfo;
+
+typedef void (*TrackStateEmitFunc)(const TrackInfo *track, TrackEvent event, gpointer user_data);
+
+typedef struct {
+    guint64 observed;     /* track_state_observe calls */
+    guint64 emitted[TRACK_EVENT_LOST + 1];
+    guint64 suppressed;   /* tracks seen in a frame without an emission */
+    guint64 evicted;      /* dropped for room, without a lost event */
+    guint64 overflow;     /* observations dropped because every track was live this frame */
+    guint   tracks;
+    guint   max_tracks;
+} TrackStateStats;
+
+/**
+ * Per-track emission state keyed by (source_id, object_id): an open-addressing
+ * table with backward-shift deletion, so lookups stay O(1) and memory is fixed
+ * at creation.  Expiry runs a clock hand over a slice of the table each frame,
+ * so a lost track is reported between lost_after_frames and twice that.
+ *
+ * Per frame: begin_frame, observe each object (several observations of one
+ * track merge; a NULL label keeps the previous value), end_frame.  Each track
+ * yields at most one event per frame.  Not thread-safe.
+ */
+typedef struct TrackState TrackState;
+
+TrackState *track_state_new(const TrackStateOptions *options);
+void        track_state_free(TrackState *state);
+
+/** Advances source_id's clock to frame_num and reports tracks that expired, as TRACK_EVENT_LOST. */
+void track_state_begin_frame(TrackState        *state,
+                             guint              source_id,
+                             gint64             frame_num,
+                             TrackStateEmitFunc lost,
+                             gpointer           user_data);
+
+void track_state_observe(TrackState  *state,
+                         guint64      object_id,
+                         const gchar *brand,
+                         const gchar *type,
+                         const gchar *plate);
+
+/** Reports NEW, CHANGED or HEARTBEAT for tracks observed this frame and counts the rest as suppressed. */
+void track_state_end_frame(TrackState        *state,
+                           TrackStateEmitFunc emit,
+                           gpointer           user_data);
+
+/** New heartbeat_frames and lost_after_frames (max_tracks stays); tracks already seen are judged by them too. */
+void        track_state_set_timing(TrackState *state, guint heartbeat_frames, guint lost_after_frames);
+
+void        track_state_get_stats(const TrackState *state, TrackStateStats *stats);
+const char *track_event_name(TrackEvent event);
+
+#endif
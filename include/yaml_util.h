@@ -0,0 +1,19 @@
+#ifndef YAML_UTIL_H
+#define YAML_UTIL_H
+
+#include <glib.h>
+#include <yaml.h>
+
+/** Parses the first document of yaml_path into doc; FALSE (logged under component) on error. */
+gboolean     yaml_util_load(const char *yaml_path, yaml_document_t *doc, const gchar *component);
+
+/** Modification time and size of yaml_path, both -1 when it cannot be stat'ed; a change to either means it was rewritten. */
+void         yaml_util_stamp(const char *yaml_path, gint64 *mtime_ns, gint64 *size);
+
+/** Scalar text, or NULL when node is missing or not a scalar.  Borrowed from the document. */
+const gchar *yaml_util_scalar(yaml_node_t *node);
+
+/** Value of key in a mapping node; NULL when absent or when map is not a mapping. */
+yaml_node_t *yaml_util_get(yaml_document_t *doc, yaml_node_t *map, const gchar *key);
+
+#endif
@@ -0,0 +1,308 @@
+/*
+ * CPU benchmark and self-check for the LPR CTC decoder; needs no DeepStream.
+ *
+ * Synthetic LPRNet output: a 4..8 character plate laid along seq_len steps
+ * with repeats, blanks between and around characters, and the odd
+ * out-of-range index, as ArgMax (int) and Max (float) tensors.  Every sequence
+ * is decoded by a copy of the original vector/string decoder and by
+ * lpr::CtcDecode; text, character count and confidence must match exactly.
+ * Also checks the length cap, table loading, and that threads decoding
+ * against one table agree with a single-threaded run.  Heap allocations are
+ * counted through operator new.
+ *
+ * usage: bench_lpr_ctc [sequences] [seq_len] [threads]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lpr_ctc_decoder.h"
+
+static std::atomic<unsigned long> g_allocations(0);
+
+// Out of line, or GCC pairs the inlined malloc/free against new/delete and warns.
+__attribute__((noinline)) void *operator new(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    void *p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept { free(p); }
+
+static double NowNs()
+{
+    return std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool Check(bool cond, const char *what)
+{
+    if (!cond)
+        printf("  FAILED: %s\n", what);
+    return cond;
+}
+
+/* The decoder as it was in nvinfer_custom_lpr_parser.cpp, with the table passed in. */
+namespace legacy {
+
+static const int kMaxPlateLength = 16;
+
+std::vector<int> CtcDecoder(const std::vector<std::string> &dict_table, int seq_len,
+                            const float* outputConfBuffer,
+                            const int* outputChrBuffer,
+                            std::vector<double> &probs,
+                            unsigned int &plate_char_count)
+{
+    bool do_softmax = false;
+    int prev = 0;
+    std::vector<int> idx;
+
+    for (int seq_id = 0; seq_id < seq_len; seq_id++) {
+        int curr_data = outputChrBuffer[seq_id];
+        if (curr_data < 0 || curr_data > static_cast<int>(dict_table.size()))
+            continue;
+
+        if (seq_id == 0) {
+            prev = curr_data;
+            idx.push_back(curr_data);
+            if (curr_data != static_cast<int>(dict_table.size()))
+                do_softmax = true;
+        } else {
+            if (curr_data != prev) {
+                idx.push_back(curr_data);
+                if (curr_data != static_cast<int>(dict_table.size()))
+                    do_softmax = true;
+            }
+            prev = curr_data;
+        }
+
+        if (do_softmax) {
+            do_softmax = false;
+            probs[plate_char_count] = outputConfBuffer[seq_id];
+            plate_char_count++;
+        }
+    }
+    return idx;
+}
+
+std::string GetPlate(const std::vector<std::string> &dict_table, const std::vector<int> &idx)
+{
+    std::string plate = "";
+    for (unsigned int id = 0; id < idx.size(); id++) {
+        if (static_cast<unsigned int>(idx[id]) != dict_table.size())
+            plate += dict_table[idx[id]];
+    }
+    return plate;
+}
+
+struct Result {
+    std::string text;
+    unsigned int count;
+    float confidence;
+};
+
+Result Decode(const std::vector<std::string> &dict_table, const int *chars, const float *probs,
+              int seq_len)
+{
+    std::vector<double> p(kMaxPlateLength, 0.0);
+    Result r;
+    r.count = 0;
+    std::vector<int> idx = CtcDecoder(dict_table, seq_len, probs, chars, p, r.count);
+    r.text = GetPlate(dict_table, idx);
+    r.confidence = 1.0;
+    for (unsigned int k = 0; k < r.count; k++)
+        r.confidence *= p[k];
+    return r;
+}
+
+}  // namespace legacy
+
+struct Tensors {
+    int seq_len;
+    int count;
+    std::vector<int>   chars;
+    std::vector<float> probs;
+};
+
+// Index 0 is always a valid symbol: the original decoder reads an uninitialised prev otherwise.
+static Tensors MakeTensors(int count, int seq_len, int dict_size, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> conf(0.5f, 1.0f);
+    const int blank = dict_size;
+    Tensors t;
+    t.seq_len = seq_len;
+    t.count = count;
+    t.chars.assign(static_cast<size_t>(count) * seq_len, blank);
+    t.probs.assign(static_cast<size_t>(count) * seq_len, 0.0f);
+
+    for (int n = 0; n < count; n++) {
+        int *chars = &t.chars[static_cast<size_t>(n) * seq_len];
+        float *probs = &t.probs[static_cast<size_t>(n) * seq_len];
+        int length = 4 + static_cast<int>(rng() % 5);
+        int pos = static_cast<int>(rng() % 3);
+        int last = -1;
+        for (int k = 0; k < length && pos < seq_len; k++) {
+            int c = static_cast<int>(rng() % dict_size);
+            if (c == last)
+                pos++;   // a repeat needs a blank between
+            int reps = 1 + static_cast<int>(rng() % 2);
+            for (int r = 0; r < reps && pos < seq_len; r++)
+                chars[pos++] = c;
+            last = c;
+            if (rng() % 3 == 0)
+                pos++;
+        }
+        for (int i = 0; i < seq_len; i++) {
+            probs[i] = conf(rng);
+            if (i > 0 && rng() % 50 == 0)
+                chars[i] = (rng() & 1) ? -1 : blank + 1 + static_cast<int>(rng() % 4);
+        }
+    }
+    return t;
+}
+
+static const char *kUsChars[] = {
+    "0", "1", "2", "3", "4", "5", "6", "7", "8", "9",
+    "A", "B", "C", "D", "E", "F", "G", "H", "I", "J", "K", "L", "M",
+    "N", "P", "Q", "R", "S", "T", "U", "V", "W", "X", "Y", "Z",
+};
+
+static bool CheckTable()
+{
+    bool ok = true;
+    const char *lines[] = { "A", "B\r", "\xc3\x84", "" };
+    lpr::CharTable table;
+    ok &= Check(table.LoadLines(lines, 4) && table.size() == 4, "LoadLines keeps every line");
+    ok &= Check(table.entry_length(1) == 1, "trailing \\r dropped");
+    ok &= Check(table.entry_length(2) == 2 && memcmp(table.entry(2), "\xc3\x84", 2) == 0,
+                "multi-byte entry kept");
+
+    const int chars[] = { 0, 0, 4, 1, 2, 2, 3, 0 };
+    const float probs[] = { 0.5f, 0.9f, 1.0f, 0.5f, 0.5f, 0.9f, 1.0f, 0.5f };
+    lpr::Plate plate;
+    lpr::CtcDecode(table, chars, probs, 8, &plate);
+    ok &= Check(strcmp(plate.text, "AB\xc3\x84" "A") == 0 && plate.char_count == 5,
+                "collapse, blank, multi-byte and empty entries");
+    ok &= Check(plate.probs[0] == 0.5f && plate.probs[1] == 0.5f && plate.probs[2] == 0.5f,
+                "probability of each run's first step");
+
+    ok &= Check(!table.LoadFile("/nonexistent/us_lp_characters.txt"), "missing file reported");
+
+    // Thirty alternating characters: the first kMaxPlateLength are kept.
+    lpr::CharTable us;
+    us.LoadLines(kUsChars, 35);
+    int many[30];
+    float ones[30];
+    for (int i = 0; i < 30; i++) {
+        many[i] = i % 2;
+        ones[i] = 1.0f;
+    }
+    lpr::CtcDecode(us, many, ones, 30, &plate);
+    ok &= Check(plate.char_count == lpr::kMaxPlateLength &&
+                plate.text_length == lpr::kMaxPlateLength &&
+                strcmp(plate.text, "0101010101010101") == 0, "plate length capped");
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    int count    = argc > 1 ? atoi(argv[1]) : 200000;
+    int seq_len  = argc > 2 ? atoi(argv[2]) : 24;
+    int nthreads = argc > 3 ? atoi(argv[3]) : 8;
+    if (count < 1) count = 1;
+    if (seq_len < 1) seq_len = 1;
+    if (nthreads < 1) nthreads = 1;
+    bool ok = true;
+
+    printf("table checks\n");
+    ok &= CheckTable();
+
+    lpr::CharTable table;
+    table.LoadLines(kUsChars, 35);
+    std::vector<std::string> dict(kUsChars, kUsChars + 35);
+    Tensors t = MakeTensors(count, seq_len, table.size(), 42);
+
+    // Parity against the original decoder.
+    std::vector<legacy::Result> expected(count);
+    std::vector<lpr::Plate> plates(count);
+    double t0 = NowNs();
+    unsigned long a0 = g_allocations.load();
+    for (int n = 0; n < count; n++)
+        expected[n] = legacy::Decode(dict, &t.chars[static_cast<size_t>(n) * seq_len],
+                                     &t.probs[static_cast<size_t>(n) * seq_len], seq_len);
+    double legacy_ns = NowNs() - t0;
+    unsigned long legacy_allocs = g_allocations.load() - a0;
+
+    t0 = NowNs();
+    a0 = g_allocations.load();
+    for (int n = 0; n < count; n++)
+        lpr::CtcDecode(table, &t.chars[static_cast<size_t>(n) * seq_len],
+                       &t.probs[static_cast<size_t>(n) * seq_len], seq_len, &plates[n]);
+    double single_ns = NowNs() - t0;
+    unsigned long single_allocs = g_allocations.load() - a0;
+
+    int mismatches = 0;
+    for (int n = 0; n < count; n++) {
+        const lpr::Plate &p = plates[n];
+        if (expected[n].text != p.text || expected[n].count != static_cast<unsigned>(p.char_count) ||
+            expected[n].confidence != p.confidence)
+            mismatches++;
+    }
+
+    std::vector<lpr::Plate> batch(count);
+    t0 = NowNs();
+    a0 = g_allocations.load();
+    lpr::CtcDecodeBatch(table, t.chars.data(), t.probs.data(), seq_len, count, batch.data());
+    double batch_ns = NowNs() - t0;
+    unsigned long batch_allocs = g_allocations.load() - a0;
+    int batch_mismatches = 0;
+    for (int n = 0; n < count; n++)
+        batch_mismatches += strcmp(batch[n].text, plates[n].text) != 0 ||
+                            batch[n].confidence != plates[n].confidence;
+
+    // Threads share the table; each decodes the whole set into its own plates.
+    std::vector<std::vector<lpr::Plate> > per_thread(nthreads, std::vector<lpr::Plate>(count));
+    std::vector<std::thread> threads;
+    t0 = NowNs();
+    for (int k = 0; k < nthreads; k++)
+        threads.push_back(std::thread([&, k]() {
+            lpr::CtcDecodeBatch(table, t.chars.data(), t.probs.data(), seq_len, count,
+                                per_thread[k].data());
+        }));
+    for (size_t k = 0; k < threads.size(); k++)
+        threads[k].join();
+    double threaded_ns = NowNs() - t0;
+    int thread_mismatches = 0;
+    for (int k = 0; k < nthreads; k++)
+        for (int n = 0; n < count; n++)
+            thread_mismatches += strcmp(per_thread[k][n].text, plates[n].text) != 0 ||
+                                 per_thread[k][n].confidence != plates[n].confidence;
+
+    printf("%d sequences, seq_len %d\n", count, seq_len);
+    printf("  original: %6.1f ns/seq, %.2f allocations/seq\n",
+           legacy_ns / count, static_cast<double>(legacy_allocs) / count);
+    printf("  CtcDecode: %6.1f ns/seq, %.2f allocations/seq, %d mismatches\n",
+           single_ns / count, static_cast<double>(single_allocs) / count, mismatches);
+    printf("  batch:     %6.1f ns/seq, %.2f allocations/seq, %d mismatches\n",
+           batch_ns / count, static_cast<double>(batch_allocs) / count, batch_mismatches);
+    printf("  %d threads: %6.1f ns/seq wall, %d mismatches\n",
+           nthreads, threaded_ns / (static_cast<double>(count) * nthreads), thread_mismatches);
+
+    ok &= Check(mismatches == 0, "CtcDecode matches the original decoder");
+    ok &= Check(batch_mismatches == 0, "batch matches single decodes");
+    ok &= Check(thread_mismatches == 0, "threads match a single-threaded run");
+    ok &= Check(single_allocs == 0 && batch_allocs == 0, "no allocations while decoding");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+#include <string.h>
+#include <fstream>
+#include <string>
+
+#include "lpr_ctc_decoder.h"
+
+namespace lpr {
+
+CharTable::CharTable() : size_(0)
+{
+    memset(bytes_, 0, sizeof(bytes_));
+    memset(length_, 0, sizeof(length_));
+}
+
+bool CharTable::Add(const char *line, int length)
+{
+    if (size_ >= kMaxDictSize)
+        return false;
+    if (length > 0 && line[length - 1] == '\r')
+        length--;
+    if (length > kMaxCharBytes)
+        length = kMaxCharBytes;
+    memcpy(&bytes_[size_ * kMaxCharBytes], line, length);
+    length_[size_] = static_cast<uint8_t>(length);
+    size_++;
+    return true;
+}
+
+bool CharTable::LoadFile(const char *path)
+{
+    std::ifstream fdict(path);
+    if (!fdict.is_open())
+        return false;
+
+    *this = CharTable();
+    std::string line;
+    while (std::getline(fdict, line)) {
+        if (!Add(line.data(), static_cast<int>(line.size())))
+            return false;
+    }
+    return true;
+}
+
+bool CharTable::LoadLines(const char *const *lines, int count)
+{
+    *this = CharTable();
+    for (int i = 0; i < count; i++) {
+        if (!Add(lines[i], static_cast<int>(strlen(lines[i]))))
+            return false;
+    }
+    return true;
+}
+
+int CtcDecode(const CharTable &table, const int *chars, const float *probs, int seq_len,
+              Plate *plate)
+{
+    const int blank = table.size();
+    int prev = -1;
+    int count = 0;
+    int text_length = 0;
+
+    for (int i = 0; i < seq_len; i++) {
+        const int c = chars[i];
+        if (static_cast<unsigned>(c) > static_cast<unsigned>(blank))
+            continue;
+
+        // Store unconditionally into the next slot; emit decides whether it is kept.
+        const int emit = (c != prev) & (c != blank) & (count < kMaxPlateLength);
+        prev = c;
+        plate->probs[count] = probs[i];
+        memcpy(&plate->text[text_length], table.entry(c), kMaxCharBytes);
+        text_length += table.entry_length(c) & -emit;
+        count += emit;
+    }
+
+    float confidence = 1.0f;
+    for (int k = 0; k < count; k++)
+        confidence = static_cast<float>(confidence * static_cast<double>(plate->probs[k]));
+
+    plate->text[text_length] = '\0';
+    plate->text_length = text_length;
+    plate->char_count  = count;
+    plate->confidence  = confidence;
+    return count;
+}
+
+void CtcDecodeBatch(const CharTable &table, const int *chars, const float *probs, int seq_len,
+                    int count, Plate *plates)
+{
+    for (int n = 0; n < count; n++) {
+        const long offset = static_cast<long>(n) * seq_len;
+        CtcDecode(table, chars + offset, probs + offset, seq_len, &plates[n]);
+    }
+}
+
+}  // namespace lpr
@@ -0,0 +1,63 @@
+#ifndef LPR_CTC_DECODER_H
+#define LPR_CTC_DECODER_H
+
+#include <stdint.h>
+
+/*
+ * Greedy CTC collapse for LPRNet's ArgMax/Max output, kept free of DeepStream
+ * headers so it builds and benchmarks on any CPU.  Nothing here allocates after
+ * the character table is loaded, and a loaded table is read-only, so any
+ * number of threads may decode against it.
+ */
+namespace lpr {
+
+static const int kMaxPlateLength = 16;   // decoded characters kept per plate
+static const int kMaxCharBytes   = 4;    // one UTF-8 character per table entry
+static const int kMaxDictSize    = 256;
+
+/** Characters by index; the blank index is size(). */
+class CharTable {
+public:
+    CharTable();
+
+    /** One entry per line, trailing '\r' dropped; false if the file cannot be read or has too many lines. */
+    bool LoadFile(const char *path);
+    /** Same as LoadFile from in-memory lines. */
+    bool LoadLines(const char *const *lines, int count);
+
+    int size() const { return size_; }
+    const char *entry(int i) const { return &bytes_[i * kMaxCharBytes]; }
+    int entry_length(int i) const { return length_[i]; }
+
+private:
+    bool Add(const char *line, int length);
+
+    char    bytes_[(kMaxDictSize + 1) * kMaxCharBytes];  // zero-padded, so 4-byte copies are safe
+    uint8_t length_[kMaxDictSize + 1];
+    int     size_;
+};
+
+// Each array has one spare slot so the decode loop can store before it knows whether to keep.
+struct Plate {
+    char  text[(kMaxPlateLength + 1) * kMaxCharBytes];  // NUL-terminated
+    int   text_length;
+    float probs[kMaxPlateLength + 1];
+    int   char_count;
+    float confidence;   // product of probs, rounded to float at each step like the original parser
+};
+
+/**
+ * Decodes one sequence: indices outside [0, size()] are skipped, runs of
+ * the same index collapse to one, and blanks are dropped.  Characters after
+ * the kMaxPlateLength-th are dropped too.  Returns char_count.
+ */
+int CtcDecode(const CharTable &table, const int *chars, const float *probs, int seq_len,
+              Plate *plate);
+
+/** Decodes count sequences stored back to back, seq_len apart, into plates[0..count). */
+void CtcDecodeBatch(const CharTable &table, const int *chars, const float *probs, int seq_len,
+                    int count, Plate *plates);
+
+}  // namespace lpr
+
+#endif
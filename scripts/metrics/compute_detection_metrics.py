@@ -3,10 +3,16 @@
 Compute object detection and LPR metrics by comparing DeepStream per-frame
 detections to COCO ground truth from CVAT.
 
-Each prediction file covers one frame at 1920x1080. Lines take the form:
+Predictions are read from detections.txt, the log appended by the pipeline's
+detection writer, where each frame starts with a header line
+  frame frame_num source_id
+followed by its detections at 1920x1080:
   car left top width height plate_text
   plate left top width height plate_text
 
+Directories with legacy per-frame frame_NNNNNN.txt files (same detection lines,
+no header) are still accepted.
+
 Usage:
   python compute_detection_metrics.py
   python compute_detection_metrics.py --coco path/to/instances.json --detections-dir path/to/detections
@@ -18,6 +24,9 @@ import re
 import sys
 from dataclasses import dataclass
 from pathlib import Path
+from typing import Callable
+
+DETECTION_LOG_NAME = "detections.txt"
 
 
 def _safe_div(num: float, den: float) -> float:
@@ -177,6 +186,43 @@ def load_predictions_for_frame(detections_dir: Path, frame_num: int) -> tuple[li
     return cars, plates
 
 
+def load_detection_log(path: Path, source_id: int = 0) -> dict[int, tuple[list, list]]:
+    """Read one source's frames from a detections.txt log into frame_num -> (cars, plates).
+
+    Frames are numbered per source.  Headers without a source_id count as source 0.
+    Lines before the first frame header and malformed lines are skipped.
+    """
+    frames: dict[int, tuple[list, list]] = {}
+    current = None
+    with open(path) as f:
+        for line in f:
+            parts = line.split()
+            if len(parts) >= 2 and parts[0] == "frame":
+                try:
+                    frame_source = int(parts[2]) if len(parts) >= 3 else 0
+                    current = frames.setdefault(int(parts[1]), ([], [])) if frame_source == source_id else None
+                except ValueError:
+                    current = None
+                continue
+            if current is None:
+                continue
+            parsed = parse_detection_line(line)
+            if not parsed:
+                continue
+            kind, left, top, width, height, plate_text = parsed
+            (current[1] if kind == "plate" else current[0]).append((left, top, width, height, plate_text))
+    return frames
+
+
+def make_prediction_loader(detections_dir: Path, source_id: int = 0) -> Callable[[int], tuple[list, list]]:
+    """Return frame_num -> (cars, plates), backed by detections.txt when present, else per-frame files."""
+    log_path = detections_dir / DETECTION_LOG_NAME
+    if log_path.exists():
+        frames = load_detection_log(log_path, source_id)
+        return lambda frame_num: frames.get(frame_num, ([], []))
+    return lambda frame_num: load_predictions_for_frame(detections_dir, frame_num)
+
+
 def coco_frame_index_from_file_name(file_name: str) -> int | None:
     """Parse the frame index from a filename like 'frame_000042.png' -> 42.
 
@@ -286,7 +332,7 @@ def _evaluate_frame(
     cars_by_iid: dict,
     plates_by_iid: dict,
     size_by_iid: dict,
-    detections_dir: Path,
+    load_frame: Callable[[int], tuple[list, list]],
     frame_offset: int,
     det_width: int,
     det_height: int,
@@ -304,7 +350,7 @@ def _evaluate_frame(
     gt_w, gt_h = size_by_iid.get(image_id, (3840, 2160))
     scale_x, scale_y = gt_w / det_width, gt_h / det_height
 
-    pred_cars, pred_plates = load_predictions_for_frame(detections_dir, coco_frame_idx + frame_offset)
+    pred_cars, pred_plates = load_frame(coco_frame_idx + frame_offset)
     gt_cars = cars_by_iid.get(image_id, [])
     gt_plates = plates_by_iid.get(image_id, [])
 
@@ -347,14 +393,16 @@ def evaluate(
     det_width: int,
     det_height: int,
     iou_threshold: float,
+    source_id: int = 0,
 ) -> tuple[DetectionCounts, DetectionCounts, LprCounts]:
     car_total = DetectionCounts()
     lpd_total = DetectionCounts()
     lpr_total = LprCounts()
+    load_frame = make_prediction_loader(detections_dir, source_id)
     for image in images:
         result = _evaluate_frame(
             image, cars_by_iid, plates_by_iid, size_by_iid,
-            detections_dir, frame_offset, det_width, det_height, iou_threshold,
+            load_frame, frame_offset, det_width, det_height, iou_threshold,
         )
         if result is None:
             continue
@@ -422,13 +470,19 @@ def build_arg_parser() -> argparse.ArgumentParser:
         "--detections-dir",
         type=Path,
         default=repo_root / "logs" / "detections",
-        help="Directory with frame_NNNNNN.txt prediction files",
+        help="Directory with detections.txt (or legacy frame_NNNNNN.txt prediction files)",
     )
     parser.add_argument(
         "--frame-offset",
         type=int,
         default=1,
-        help="Detection frame number = COCO frame index + this (default 1: COCO frame_000000 -> frame_000001.txt)",
+        help="Detection frame number = COCO frame index + this (default 1: COCO frame_000000 -> detection frame 1)",
+    )
+    parser.add_argument(
+        "--source-id",
+        type=int,
+        default=0,
+        help="Source whose frames are compared, as in the frame header line (default 0)",
     )
     parser.add_argument(
         "--detection-width",
@@ -474,6 +528,7 @@ def main() -> int:
         images, cars_by_iid, plates_by_iid, size_by_iid,
         args.detections_dir, args.frame_offset,
         args.detection_width, args.detection_height, args.iou_threshold,
+        args.source_id,
     )
 
     summary = build_summary(car_counts, lpd_counts, lpr_counts)
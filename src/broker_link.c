@@ -0,0 +1,136 @@
+#include <dlfcn.h>
+#include <stdatomic.h>
+
+#include "nvds_msgapi.h"
+
+#include "broker_link.h"
+#include "logger.h"
+
+typedef NvDsMsgApiHandle    (*ConnectFunc)(char *, nvds_msgapi_connect_cb_t, char *);
+typedef NvDsMsgApiErrorType (*SendFunc)(NvDsMsgApiHandle, char *, const uint8_t *, size_t);
+typedef void                (*DoWorkFunc)(NvDsMsgApiHandle);
+typedef NvDsMsgApiErrorType (*DisconnectFunc)(NvDsMsgApiHandle);
+
+struct BrokerLink {
+    BrokerLinkOptions options;
+    void             *lib;
+    ConnectFunc       connect;
+    SendFunc          send;
+    DoWorkFunc        do_work;
+    DisconnectFunc    disconnect;
+    NvDsMsgApiHandle  handle;
+    atomic_bool       lost;
+};
+
+/* The adapter callback carries only the handle: map it back to its link. */
+G_LOCK_DEFINE_STATIC(links);
+static GSList *links;
+
+static void on_connection_event(NvDsMsgApiHandle handle, NvDsMsgApiEventType event)
+{
+    if (event == NVDS_MSGAPI_EVT_SUCCESS)
+        return;
+    G_LOCK(links);
+    for (GSList *l = links; l; l = l->next) {
+        BrokerLink *link = l->data;
+        if (link->handle == handle)
+            atomic_store(&link->lost, TRUE);
+    }
+    G_UNLOCK(links);
+}
+
+void broker_link_options_clear(BrokerLinkOptions *options)
+{
+    g_clear_pointer(&options->proto_lib, g_free);
+    g_clear_pointer(&options->conn_str, g_free);
+    g_clear_pointer(&options->topic, g_free);
+    g_clear_pointer(&options->config, g_free);
+}
+
+BrokerLink *broker_link_new(const BrokerLinkOptions *options)
+{
+    if (!options->proto_lib) {
+        log_error("broker_link: msgbroker has no proto-lib");
+        return NULL;
+    }
+    void *lib = dlopen(options->proto_lib, RTLD_NOW | RTLD_LOCAL);
+    if (!lib) {
+        log_error("broker_link: cannot load %s: %s", options->proto_lib, dlerror());
+        return NULL;
+    }
+    BrokerLink *link = g_new0(BrokerLink, 1);
+    link->lib        = lib;
+    link->connect    = (ConnectFunc)dlsym(lib, "nvds_msgapi_connect");
+    link->send       = (SendFunc)dlsym(lib, "nvds_msgapi_send");
+    link->do_work    = (DoWorkFunc)dlsym(lib, "nvds_msgapi_do_work");
+    link->disconnect = (DisconnectFunc)dlsym(lib, "nvds_msgapi_disconnect");
+    if (!link->connect || !link->send || !link->do_work || !link->disconnect) {
+        log_error("broker_link: %s is not a msgapi adapter", options->proto_lib);
+        dlclose(lib);
+        g_free(link);
+        return NULL;
+    }
+    link->options.proto_lib = g_strdup(options->proto_lib);
+    link->options.conn_str  = g_strdup(options->conn_str);
+    link->options.topic     = g_strdup(options->topic);
+    link->options.config    = g_strdup(options->config);
+    atomic_init(&link->lost, FALSE);
+
+    G_LOCK(links);
+    links = g_slist_prepend(links, link);
+    G_UNLOCK(links);
+    return link;
+}
+
+static void drop_connection(BrokerLink *link)
+{
+    if (!link->handle)
+        return;
+    G_LOCK(links);
+    NvDsMsgApiHandle handle = link->handle;
+    link->handle = NULL;
+    G_UNLOCK(links);
+    link->disconnect(handle);
+    atomic_store(&link->lost, FALSE);
+}
+
+void broker_link_free(BrokerLink *link)
+{
+    if (!link)
+        return;
+    G_LOCK(links);
+    links = g_slist_remove(links, link);
+    G_UNLOCK(links);
+    drop_connection(link);
+    dlclose(link->lib);
+    broker_link_options_clear(&link->options);
+    g_free(link);
+}
+
+gboolean broker_link_connect(BrokerLink *link)
+{
+    if (link->handle && !atomic_exchange(&link->lost, FALSE)) {
+        link->do_work(link->handle);
+        return TRUE;
+    }
+    drop_connection(link);
+    NvDsMsgApiHandle handle = link->connect(link->options.conn_str, on_connection_event,
+                                            link->options.config);
+    G_LOCK(links);
+    link->handle = handle;
+    G_UNLOCK(links);
+    return handle != NULL;
+}
+
+gboolean broker_link_send(BrokerLink *link, const guint8 *payload, gsize len)
+{
+    if (!link->handle)
+        return FALSE;
+    NvDsMsgApiErrorType status = link->send(link->handle, link->options.topic, payload, len);
+    link->do_work(link->handle);
+    if (status != NVDS_MSGAPI_OK) {
+        atomic_store(&link->lost, TRUE);
+        return FALSE;
+    }
+    return TRUE;
+}
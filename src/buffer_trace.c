@@ -0,0 +1,458 @@
+#include "buffer_trace.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/prctl.h>
+
+#include "gstnvdsmeta.h"
+
+#include "element_util.h"
+#include "spsc_ring.h"
+#include "logger.h"
+
+/* Per thread; the collector empties it every COLLECT_INTERVAL_US. */
+#define RING_STAMPS         8192
+#define COLLECT_INTERVAL_US (50 * G_TIME_SPAN_MILLISECOND)
+#define UPSTREAM_WORDS      (BUFFER_TRACE_MAX_ELEMENTS / 64)
+
+typedef struct {
+    guint64 t_ns;
+    guint64 pts;
+    guint16 element;
+    guint16 source;
+    guint16 thread;
+} Stamp;
+
+typedef struct {
+    SpscRing   *ring;
+    guint16     index;
+    gchar       name[17];   /* the kernel's thread name, 16 bytes at most */
+    atomic_uint dropped;    /* stamps the ring had no room for */
+} ThreadRing;
+
+typedef struct {
+    BufferTrace *trace;
+    guint16      element;
+    gint         source;   /* the source bin's index; -1 reads NvDsFrameMeta */
+} TracePoint;
+
+typedef struct {
+    gchar  *name;
+    guint64 upstream[UPSTREAM_WORDS];   /* bit per element feeding this one */
+} TraceElement;
+
+struct BufferTrace {
+    gchar     *path;
+    guint      max_events;
+    guint      generation;
+    guint64    t0_ns;
+    GPtrArray *elements;     /* TraceElement, by index */
+    GPtrArray *points;       /* TracePoint, owned for the probes */
+
+    GMutex     lock;         /* rings, stamps, dropped and stopping */
+    GCond      cond;
+    GPtrArray *rings;        /* ThreadRing, by index */
+    GArray    *stamps;       /* Stamp, collected */
+    guint64    dropped;      /* over max_events */
+    gboolean   stopping;
+    GThread   *collector;
+};
+
+/* Which trace a thread's ring belongs to; a new trace starts a new generation. */
+typedef struct {
+    guint       generation;
+    ThreadRing *ring;
+} ThreadSlot;
+
+static GPrivate    thread_slot = G_PRIVATE_INIT(g_free);
+static atomic_uint generations;
+
+static inline guint64 clock_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (guint64)ts.tv_sec * 1000000000ull + (guint64)ts.tv_nsec;
+}
+
+static void thread_ring_free(gpointer data)
+{
+    ThreadRing *ring = (ThreadRing *)data;
+    spsc_ring_free(ring->ring);
+    g_free(ring);
+}
+
+/* The calling thread's ring; registration locks, once per thread. */
+static ThreadRing *thread_ring(BufferTrace *trace)
+{
+    ThreadSlot *slot = g_private_get(&thread_slot);
+    if (G_LIKELY(slot && slot->generation == trace->generation))
+        return slot->ring;
+    if (!slot) {
+        slot = g_new0(ThreadSlot, 1);
+        g_private_set(&thread_slot, slot);
+    }
+
+    ThreadRing *ring = NULL;
+    g_mutex_lock(&trace->lock);
+    if (trace->rings->len <= G_MAXUINT16) {
+        ring = g_new0(ThreadRing, 1);
+        ring->ring  = spsc_ring_new(RING_STAMPS, sizeof(Stamp));
+        ring->index = (guint16)trace->rings->len;
+        if (prctl(PR_GET_NAME, ring->name, 0, 0, 0) != 0 || !ring->name[0])
+            g_snprintf(ring->name, sizeof(ring->name), "thread-%u", ring->index);
+        g_ptr_array_add(trace->rings, ring);
+    }
+    g_mutex_unlock(&trace->lock);
+    slot->generation = trace->generation;
+    slot->ring       = ring;
+    return ring;
+}
+
+static inline void push(ThreadRing *ring, guint16 element, guint source, guint64 pts, guint64 now)
+{
+    if (!GST_CLOCK_TIME_IS_VALID(pts))
+        return;
+    Stamp *stamp = spsc_ring_reserve(ring->ring);
+    if (G_UNLIKELY(!stamp)) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return;
+    }
+    *stamp = (Stamp){ now, pts, element, (guint16)MIN(source, G_MAXUINT16), ring->index };
+    spsc_ring_commit(ring->ring);
+}
+
+static GstPadProbeReturn stamp_buffer(GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+    (void)pad;
+    const TracePoint *point = (const TracePoint *)user_data;
+    GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER(info);
+    guint64 now = clock_ns();
+    ThreadRing *ring = thread_ring(point->trace);
+    if (!ring)
+        return GST_PAD_PROBE_OK;
+
+    NvDsBatchMeta *batch_meta = point->source < 0 ? gst_buffer_get_nvds_batch_meta(buf) : NULL;
+    if (!batch_meta) {
+        push(ring, point->element, (guint)MAX(point->source, 0), GST_BUFFER_PTS(buf), now);
+        return GST_PAD_PROBE_OK;
+    }
+    for (NvDsMetaList *l = batch_meta->frame_meta_list; l; l = l->next) {
+        const NvDsFrameMeta *frame_meta = (const NvDsFrameMeta *)l->data;
+        push(ring, point->element, frame_meta->source_id, frame_meta->buf_pts, now);
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+/* Moves every ring into stamps; the collector is each ring's only consumer, under lock. */
+static void drain_locked(BufferTrace *trace)
+{
+    for (guint i = 0; i < trace->rings->len; i++) {
+        SpscRing *ring = ((ThreadRing *)trace->rings->pdata[i])->ring;
+        const Stamp *stamp;
+        while ((stamp = spsc_ring_peek(ring)) != NULL) {
+            if (trace->stamps->len < trace->max_events)
+                g_array_append_vals(trace->stamps, stamp, 1);
+            else
+                trace->dropped++;
+            spsc_ring_release(ring);
+        }
+    }
+}
+
+static gpointer collect(gpointer data)
+{
+    BufferTrace *trace = (BufferTrace *)data;
+    g_mutex_lock(&trace->lock);
+    while (!trace->stopping) {
+        drain_locked(trace);
+        g_cond_wait_until(&trace->cond, &trace->lock, g_get_monotonic_time() + COLLECT_INTERVAL_US);
+    }
+    g_mutex_unlock(&trace->lock);
+    return NULL;
+}
+
+/* Elements of the pipeline, bins entered but not kept, in no particular order. */
+static GPtrArray *list_elements(GstElement *pipeline)
+{
+    GPtrArray *elements = element_util_collect(gst_bin_iterate_recurse(GST_BIN(pipeline)));
+    for (guint i = elements->len; i > 0; i--)
+        if (GST_IS_BIN(elements->pdata[i - 1]))
+            g_ptr_array_remove_index(elements, i - 1);
+    return elements;
+}
+
+/* The element on the other side of a link, through ghost pads; NULL when unlinked.  New reference. */
+static GstElement *peer_element(GstPad *pad)
+{
+    GstPad *peer = gst_pad_get_peer(pad);
+    while (peer && GST_IS_GHOST_PAD(peer)) {
+        GstPad *target = gst_ghost_pad_get_target(GST_GHOST_PAD(peer));
+        gst_object_unref(peer);
+        peer = target;
+    }
+    GstElement *element = peer ? gst_pad_get_parent_element(peer) : NULL;
+    if (peer)
+        gst_object_unref(peer);
+    return element;
+}
+
+/* Calls func on each pad of direction; the pads are borrowed for the call. */
+static void for_each_pad(GstElement *element, GstPadDirection direction,
+                         void (*func)(GstPad *pad, gpointer user_data), gpointer user_data)
+{
+    GstIterator *it = direction == GST_PAD_SRC ? gst_element_iterate_src_pads(element)
+                                               : gst_element_iterate_sink_pads(element);
+    GValue item = G_VALUE_INIT;
+    gboolean done = FALSE;
+    while (!done) {
+        switch (gst_iterator_next(it, &item)) {
+        case GST_ITERATOR_OK:
+            func(GST_PAD(g_value_get_object(&item)), user_data);
+            g_value_reset(&item);
+            break;
+        case GST_ITERATOR_RESYNC:
+            gst_iterator_resync(it);
+            break;
+        default:
+            done = TRUE;
+            break;
+        }
+    }
+    g_value_unset(&item);
+    gst_iterator_free(it);
+}
+
+typedef struct {
+    GHashTable   *index;    /* GstElement -> element index + 1 */
+    TraceElement *element;
+} UpstreamJob;
+
+static void add_upstream(GstPad *pad, gpointer user_data)
+{
+    UpstreamJob *job = (UpstreamJob *)user_data;
+    GstElement *peer = peer_element(pad);
+    guint i = peer ? GPOINTER_TO_UINT(g_hash_table_lookup(job->index, peer)) : 0;
+    if (i--)
+        job->element->upstream[i / 64] |= G_GUINT64_CONSTANT(1) << (i % 64);
+    if (peer)
+        gst_object_unref(peer);
+}
+
+static void add_stamp_probe(GstPad *pad, gpointer user_data)
+{
+    gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, stamp_buffer, user_data, NULL);
+}
+
+/* "source-bin-<i>" as i, for elements ahead of the muxer; -1 elsewhere. */
+static gint source_index(GstElement *element)
+{
+    GstObject *parent = gst_object_get_parent(GST_OBJECT(element));
+    gint source = -1;
+    if (parent) {
+        const gchar *name = GST_OBJECT_NAME(parent);
+        if (g_str_has_prefix(name, "source-bin-"))
+            source = (gint)strtol(name + strlen("source-bin-"), NULL, 10);
+        gst_object_unref(parent);
+    }
+    return source;
+}
+
+static void trace_element_free(gpointer data)
+{
+    TraceElement *element = (TraceElement *)data;
+    g_free(element->name);
+    g_free(element);
+}
+
+BufferTrace *buffer_trace_new(GstElement *pipeline, const gchar *path, guint max_events)
+{
+    if (!GST_IS_BIN(pipeline) || !path || !path[0])
+        return NULL;
+
+    BufferTrace *trace = g_new0(BufferTrace, 1);
+    trace->path       = g_strdup(path);
+    trace->max_events = max_events;
+    trace->generation = atomic_fetch_add(&generations, 1) + 1;
+    trace->elements   = g_ptr_array_new_with_free_func(trace_element_free);
+    trace->points     = g_ptr_array_new_with_free_func(g_free);
+    trace->rings      = g_ptr_array_new_with_free_func(thread_ring_free);
+    trace->stamps     = g_array_new(FALSE, FALSE, sizeof(Stamp));
+    g_mutex_init(&trace->lock);
+    g_cond_init(&trace->cond);
+
+    GPtrArray *elements = list_elements(pipeline);
+    if (elements->len > BUFFER_TRACE_MAX_ELEMENTS)
+        log_warning("buffer_trace: %u elements, only the first %u are traced",
+                    elements->len, BUFFER_TRACE_MAX_ELEMENTS);
+    g_ptr_array_set_size(elements, MIN(elements->len, BUFFER_TRACE_MAX_ELEMENTS));
+
+    GHashTable *index = g_hash_table_new(g_direct_hash, g_direct_equal);
+    for (guint i = 0; i < elements->len; i++) {
+        TraceElement *element = g_new0(TraceElement, 1);
+        element->name = g_strdup(GST_ELEMENT_NAME(elements->pdata[i]));
+        g_ptr_array_add(trace->elements, element);
+        g_hash_table_insert(index, elements->pdata[i], GUINT_TO_POINTER(i + 1));
+    }
+
+    /* Buffers are stamped leaving an element, or arriving when it has no src pad. */
+    for (guint i = 0; i < elements->len; i++) {
+        GstElement *element = elements->pdata[i];
+        UpstreamJob job = { index, trace->elements->pdata[i] };
+        for_each_pad(element, GST_PAD_SINK, add_upstream, &job);
+
+        TracePoint *point = g_new0(TracePoint, 1);
+        point->trace   = trace;
+        point->element = (guint16)i;
+        point->source  = source_index(element);
+        g_ptr_array_add(trace->points, point);
+        GstPadDirection direction = element->numsrcpads ? GST_PAD_SRC : GST_PAD_SINK;
+        for_each_pad(element, direction, add_stamp_probe, point);
+    }
+    g_hash_table_destroy(index);
+
+    trace->t0_ns     = clock_ns();
+    trace->collector = g_thread_new("buffer-trace", collect, trace);
+    log_info("buffer_trace: %u elements traced to %s, up to %u stamps",
+             elements->len, trace->path, trace->max_events);
+    g_ptr_array_free(elements, TRUE);
+    return trace;
+}
+
+void buffer_trace_free(BufferTrace *trace)
+{
+    if (!trace)
+        return;
+    g_mutex_lock(&trace->lock);
+    trace->stopping = TRUE;
+    g_cond_signal(&trace->cond);
+    g_mutex_unlock(&trace->lock);
+    g_thread_join(trace->collector);
+
+    g_ptr_array_unref(trace->rings);
+    g_array_free(trace->stamps, TRUE);
+    g_ptr_array_unref(trace->points);
+    g_ptr_array_unref(trace->elements);
+    g_mutex_clear(&trace->lock);
+    g_cond_clear(&trace->cond);
+    g_free(trace->path);
+    g_free(trace);
+}
+
+static gint compare_stamps(gconstpointer a, gconstpointer b)
+{
+    const Stamp *x = (const Stamp *)a, *y = (const Stamp *)b;
+    if (x->source != y->source) return x->source < y->source ? -1 : 1;
+    if (x->pts    != y->pts)    return x->pts    < y->pts    ? -1 : 1;
+    if (x->t_ns   != y->t_ns)   return x->t_ns   < y->t_ns   ? -1 : 1;
+    return 0;
+}
+
+static void write_string(FILE *f, const gchar *s)
+{
+    fputc('"', f);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\')
+            fprintf(f, "\\%c", *s);
+        else if ((guchar)*s < 0x20)
+            fprintf(f, "\\u%04x", (guint)(guchar)*s);
+        else
+            fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+static gdouble trace_us(const BufferTrace *trace, guint64 t_ns)
+{
+    return t_ns > trace->t0_ns ? (t_ns - trace->t0_ns) / 1e3 : 0.0;
+}
+
+/* One frame's stamps, sorted by time: each element's span, then the frame's own. */
+static void write_frame(FILE *f, const BufferTrace *trace, const Stamp *stamps, guint n, guint64 *frames)
+{
+    for (guint i = 0; i < n; i++) {
+        const Stamp *s = &stamps[i];
+        const TraceElement *element = trace->elements->pdata[s->element];
+        /* Starts when the last of its inputs left upstream, so a join waits for every branch. */
+        const Stamp *start = NULL;
+        for (guint j = 0; j < i; j++) {
+            guint up = stamps[j].element;
+            if (element->upstream[up / 64] & (G_GUINT64_CONSTANT(1) << (up % 64)))
+                start = &stamps[j];
+        }
+        if (!start)
+            continue;
+        fputs(",\n{\"name\":", f);
+        write_string(f, element->name);
+        fprintf(f, ",\"cat\":\"element\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,"
+                   "\"args\":{\"source\":%u,\"pts\":%" G_GUINT64_FORMAT "}}",
+                s->thread, trace_us(trace, start->t_ns), (s->t_ns - start->t_ns) / 1e3,
+                s->source, s->pts);
+    }
+    if (n < 2)
+        return;
+    guint64 id = ++*frames;
+    fprintf(f, ",\n{\"name\":\"frame\",\"cat\":\"frame\",\"ph\":\"b\",\"id\":%" G_GUINT64_FORMAT
+               ",\"pid\":2,\"tid\":%u,\"ts\":%.3f,\"args\":{\"source\":%u,\"pts\":%" G_GUINT64_FORMAT
+               ",\"latency_ms\":%.3f}}",
+            id, stamps[0].source, trace_us(trace, stamps[0].t_ns), stamps[0].source, stamps[0].pts,
+            (stamps[n - 1].t_ns - stamps[0].t_ns) / 1e6);
+    fprintf(f, ",\n{\"name\":\"frame\",\"cat\":\"frame\",\"ph\":\"e\",\"id\":%" G_GUINT64_FORMAT
+               ",\"pid\":2,\"tid\":%u,\"ts\":%.3f}",
+            id, stamps[0].source, trace_us(trace, stamps[n - 1].t_ns));
+}
+
+gboolean buffer_trace_write(BufferTrace *trace)
+{
+    if (!trace)
+        return FALSE;
+
+    gchar *tmp = g_strconcat(trace->path, ".tmp", NULL);
+    FILE *f = fopen(tmp, "w");
+    if (!f) {
+        log_error("buffer_trace: cannot write %s", tmp);
+        g_free(tmp);
+        return FALSE;
+    }
+
+    g_mutex_lock(&trace->lock);
+    drain_locked(trace);
+    g_array_sort(trace->stamps, compare_stamps);
+    guint64 dropped = trace->dropped;
+    for (guint i = 0; i < trace->rings->len; i++)
+        dropped += atomic_load_explicit(&((ThreadRing *)trace->rings->pdata[i])->dropped,
+                                        memory_order_relaxed);
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+          "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"elements\"}},\n"
+          "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,\"args\":{\"name\":\"frames by source\"}}", f);
+    for (guint i = 0; i < trace->rings->len; i++) {
+        const ThreadRing *ring = trace->rings->pdata[i];
+        fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", ring->index);
+        write_string(f, ring->name);
+        fputs("}}", f);
+    }
+
+    const Stamp *stamps = (const Stamp *)trace->stamps->data;
+    guint n = trace->stamps->len;
+    guint64 frames = 0;
+    for (guint begin = 0, end; begin < n; begin = end) {
+        for (end = begin + 1; end < n && stamps[end].source == stamps[begin].source &&
+                              stamps[end].pts == stamps[begin].pts; end++)
+            ;
+        write_frame(f, trace, &stamps[begin], end - begin, &frames);
+    }
+    fprintf(f, "\n],\"otherData\":{\"stamps\":%u,\"dropped\":%" G_GUINT64_FORMAT "}}\n", n, dropped);
+    g_mutex_unlock(&trace->lock);
+
+    gboolean ok = fclose(f) == 0 && rename(tmp, trace->path) == 0;
+    if (ok)
+        log_info("buffer_trace: %" G_GUINT64_FORMAT " frames from %u stamps to %s, %" G_GUINT64_FORMAT " dropped",
+                 frames, n, trace->path, dropped);
+    else
+        log_error("buffer_trace: writing %s failed", trace->path);
+    g_free(tmp);
+    return ok;
+}
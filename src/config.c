@@ -1,8 +1,169 @@
+#include <errno.h>
+#include <limits.h>
+#include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
+
 #include "config.h"
+#include "logger.h"
+
+#define DEFAULT_YAML_PATH "configs/deepstream_config.yml"
+
+typedef enum {
+    ENV_NUMBER,    /* unsigned int in [min, max] */
+    ENV_FLAG,      /* unsigned int, 0 or 1 */
+    ENV_CHOICE,    /* one of choices; the first is the default */
+    ENV_TEXT,
+} EnvKind;
+
+typedef struct {
+    const char        *name;
+    EnvKind            kind;
+    size_t             offset;
+    unsigned int       fallback;
+    unsigned int       min;
+    unsigned int       max;
+    const char *const *choices;   /* ENV_CHOICE, NULL-terminated */
+    const char        *text;      /* ENV_TEXT default */
+} EnvSpec;
+
+#define NUMBER(name, field, fallback, min, max) \
+    { name, ENV_NUMBER, offsetof(AppSettings, field), fallback, min, max, NULL, NULL }
+#define COUNT(name, field, fallback)  NUMBER(name, field, fallback, 0, UINT_MAX)
+#define PCT(name, field, fallback)    NUMBER(name, field, fallback, 0, 100)
+#define FLAG(name, field, fallback) \
+    { name, ENV_FLAG, offsetof(AppSettings, field), fallback, 0, 1, NULL, NULL }
+#define CHOICE(name, field, choices) \
+    { name, ENV_CHOICE, offsetof(AppSettings, field), 0, 0, 0, choices, NULL }
+#define TEXT(name, field, text) \
+    { name, ENV_TEXT, offsetof(AppSettings, field), 0, 0, 0, NULL, text }
+
+static const char *const output_formats[]  = { "text", "binary", NULL };
+static const char *const assoc_scores[]    = { "containment", "iou", NULL };
+static const char *const backends[]        = { "deepstream", "software", NULL };
+static const char *const leaky_drop_old[]  = { "downstream", "no", "upstream", NULL };
+static const char *const leaky_block[]     = { "no", "upstream", "downstream", NULL };
+static const char *const publishers[]      = { "native", "nvmsgbroker", NULL };
+static const char *const compressions[]    = { "none", "deflate", NULL };
+static const char *const payload_formats[] = { "text", "json", "binary", NULL };
+static const char *const aggregates[]      = { "none", "frame", "window", NULL };
 
-#define DEFAULT_YAML_PATH        "configs/deepstream_config.yml"
-#define DEFAULT_DETECTION_OUTPUT "logs/detections"
+static const EnvSpec env_specs[] = {
+    TEXT  ("DETECTION_OUTPUT_DIR",        detection_output_dir,        "logs/detections"),
+    COUNT ("DETECTION_QUEUE_FRAMES",      detection_queue_frames,      1024),
+    COUNT ("DETECTION_FLUSH_INTERVAL_MS", detection_flush_interval_ms, 250),
+    CHOICE("DETECTION_OUTPUT_FORMAT",     detection_output_format,     output_formats),
+    NUMBER("DETECTION_SEGMENT_MB",        detection_segment_mb,        64, 1, 1u << 20),
+    CHOICE("PLATE_ASSOC_SCORE",           plate_assoc_score,           assoc_scores),
+    FLAG  ("PLATE_ASSOC_ONE_TO_ONE",      plate_assoc_one_to_one,      0),
+    COUNT ("MSG_POOL_BLOCKS",             msg_pool_blocks,             4096),
+    FLAG  ("TRACK_EVENTS",                track_events,                1),
+    COUNT ("TRACK_MAX",                   track_max,                   4096),
+    NUMBER("TRACK_HEARTBEAT_FRAMES",      track_heartbeat_frames,      300, 0, INT_MAX),
+    NUMBER("TRACK_LOST_FRAMES",           track_lost_frames,           90,  0, INT_MAX),
+    FLAG  ("CONSENSUS",                   consensus,                   1),
+    FLAG  ("CONSENSUS_SKIP",              consensus_skip,              0),
+    COUNT ("CONSENSUS_MIN_VOTES",         consensus_min_votes,         5),
+    PCT   ("CONSENSUS_MIN_SHARE_PCT",     consensus_min_share_pct,     70),
+    COUNT ("CONSENSUS_RECHECK_FRAMES",    consensus_recheck_frames,    150),
+    COUNT ("PROBE_STATS_INTERVAL_S",      probe_stats_interval_s,      60),
+    NUMBER("METRICS_PORT",                metrics_port,                0, 0, 65535),
+    CHOICE("PIPELINE_BACKEND",            pipeline_backend,            backends),
+    FLAG  ("HEADLESS",                    headless,                    0),
+    COUNT ("FAKE_INFER_OBJECTS",          fake_infer_objects,          8),
+    PCT   ("FAKE_INFER_PLATE_PCT",        fake_infer_plate_pct,        50),
+    COUNT ("FAKE_INFER_SEED",             fake_infer_seed,             1),
+    FLAG  ("LOAD_CONTROL",                load_control,                0),
+    COUNT ("LOAD_INTERVAL_MS",            load_interval_ms,            500),
+    COUNT ("LOAD_HIGH_LATENCY_MS",        load_high_latency_ms,        1000),
+    COUNT ("LOAD_LOW_LATENCY_MS",         load_low_latency_ms,         300),
+    PCT   ("LOAD_HIGH_QUEUE_PCT",         load_high_queue_pct,         80),
+    PCT   ("LOAD_LOW_QUEUE_PCT",          load_low_queue_pct,          30),
+    COUNT ("LOAD_UP_SAMPLES",             load_up_samples,             3),
+    COUNT ("LOAD_DOWN_SAMPLES",           load_down_samples,           20),
+    NUMBER("LOAD_MAX_LEVEL",              load_max_level,              4, 0, 4),
+    COUNT ("MSG_QUEUE_BUFFERS",           msg_queue_buffers,           2),
+    CHOICE("MSG_QUEUE_LEAKY",             msg_queue_leaky,             leaky_drop_old),
+    COUNT ("RENDER_QUEUE_BUFFERS",        render_queue_buffers,        2),
+    CHOICE("RENDER_QUEUE_LEAKY",          render_queue_leaky,          leaky_block),
+    PCT   ("MSG_SHED_LOW_PCT",            msg_shed_low_pct,            50),
+    PCT   ("MSG_SHED_NORMAL_PCT",         msg_shed_normal_pct,         100),
+    TEXT  ("JOURNAL_DIR",                 journal_dir,                 ""),
+    NUMBER("JOURNAL_SEGMENT_MB",          journal_segment_mb,          16, 1, 1u << 20),
+    NUMBER("JOURNAL_QUOTA_MB",            journal_quota_mb,            1024, 0, 1u << 30),
+    COUNT ("JOURNAL_REPLAY_RATE",         journal_replay_rate,         200),
+    CHOICE("MSG_PUBLISHER",               msg_publisher,               publishers),
+    NUMBER("MQTT_QOS",                    mqtt_qos,                    1, 0, 2),
+    COUNT ("MQTT_BATCH_BYTES",            mqtt_batch_bytes,            65536),
+    COUNT ("MQTT_BATCH_MS",               mqtt_batch_ms,               20),
+    CHOICE("MQTT_COMPRESS",               mqtt_compress,               compressions),
+    COUNT ("MQTT_QUEUE_EVENTS",           mqtt_queue_events,           8192),
+    COUNT ("MQTT_MAX_INFLIGHT",           mqtt_max_inflight,           64),
+    CHOICE("PAYLOAD_FORMAT",              payload_format,              payload_formats),
+    CHOICE("MSG_AGGREGATE",               msg_aggregate,               aggregates),
+    NUMBER("MSG_AGGREGATE_WINDOW_MS",     msg_aggregate_window_ms,     100, 1, UINT_MAX),
+    COUNT ("MSG_AGGREGATE_MAX_BYTES",     msg_aggregate_max_bytes,     8192),
+    TEXT  ("TRACE_FILE",                  trace_file,                  ""),
+    COUNT ("TRACE_MAX_EVENTS",            trace_max_events,            2000000),
+    COUNT ("CONFIG_WATCH_MS",             config_watch_ms,             0),
+};
+
+#define FIELD_UINT(settings, spec) (*(unsigned int *)((char *)(settings) + (spec)->offset))
+#define FIELD_TEXT(settings, spec) (*(const char **)((char *)(settings) + (spec)->offset))
+
+/* Sets the default, then the value when it is set and valid; 1 when it is set and not. */
+static unsigned int parse_env(const EnvSpec *spec, AppSettings *settings)
+{
+    const char *value = getenv(spec->name);
+    switch (spec->kind) {
+    case ENV_TEXT:
+        FIELD_TEXT(settings, spec) = value ? value : spec->text;
+        return 0;
+    case ENV_CHOICE:
+        FIELD_TEXT(settings, spec) = spec->choices[0];
+        if (!value || !value[0])
+            return 0;
+    {
+        char names[128] = "";
+        for (const char *const *c = spec->choices; *c; c++) {
+            if (strcmp(value, *c) == 0) {
+                FIELD_TEXT(settings, spec) = *c;
+                return 0;
+            }
+            if (names[0])
+                strncat(names, ", ", sizeof(names) - strlen(names) - 1);
+            strncat(names, *c, sizeof(names) - strlen(names) - 1);
+        }
+        log_error("config: %s: '%s' is not one of %s", spec->name, value, names);
+        return 1;
+    }
+    case ENV_NUMBER:
+    case ENV_FLAG:
+        break;
+    }
+
+    FIELD_UINT(settings, spec) = spec->fallback;
+    if (!value || !value[0])
+        return 0;
+    char *end = NULL;
+    errno = 0;
+    unsigned long parsed = strtoul(value, &end, 10);
+    int number = value[0] >= '0' && value[0] <= '9' && !*end && errno != ERANGE;
+    if (spec->kind == ENV_FLAG && (!number || parsed > 1)) {
+        log_error("config: %s: '%s' is not 0 or 1", spec->name, value);
+        return 1;
+    }
+    if (!number) {
+        log_error("config: %s: '%s' is not a number", spec->name, value);
+        return 1;
+    }
+    if (parsed < spec->min || parsed > spec->max) {
+        log_error("config: %s: %s is not in %u..%u", spec->name, value, spec->min, spec->max);
+        return 1;
+    }
+    FIELD_UINT(settings, spec) = (unsigned int)parsed;
+    return 0;
+}
 
 const char *config_get_yaml_path(void)
 {
@@ -14,10 +175,10 @@ const char *config_get_yaml_path(void)
     return path;
 }
 
-const char *config_get_detection_output_dir(void)
+unsigned int config_load_settings(AppSettings *settings)
 {
-    const char *dir = getenv("DETECTION_OUTPUT_DIR");
-    if (!dir)
-        dir = DEFAULT_DETECTION_OUTPUT;
-    return dir;
+    unsigned int errors = 0;
+    for (size_t i = 0; i < sizeof(env_specs) / sizeof(env_specs[0]); i++)
+        errors += parse_env(&env_specs[i], settings);
+    return errors;
 }
@@ -0,0 +1,294 @@
+#include "config_reload.h"
+
+#include <stdlib.h>
+
+#include "element_util.h"
+#include "yaml_util.h"
+#include "logger.h"
+
+#define RUNTIME_SECTION "runtime"
+
+typedef struct {
+    RuntimeConfig runtime;
+    gchar        *topic;
+} RuntimeSettings;
+
+struct ConfigReload {
+    gchar              *path;
+    gchar              *base_dir;    /* relative file names in the config are under it */
+    ConfigReloadTargets targets;
+    AppSettings         settings;    /* defaults of what the runtime section leaves out */
+    RuntimeSettings     current;
+    GHashTable         *built;       /* section -> canonical text, as the pipeline was built */
+    gint64              mtime_ns;
+    gint64              size;
+};
+
+static void settings_clear(RuntimeSettings *settings)
+{
+    runtime_config_clear(&settings->runtime);
+    g_clear_pointer(&settings->topic, g_free);
+}
+
+/* Names a file the element reads at start: its contents are part of what was built. */
+static gboolean is_file_key(const gchar *key)
+{
+    return g_strcmp0(key, "config-file-path") == 0 || g_strcmp0(key, "ll-config-file") == 0 ||
+           g_strcmp0(key, "config") == 0;
+}
+
+static void append_file_digest(const ConfigReload *reload, const gchar *name, GString *out)
+{
+    gchar *path = g_path_is_absolute(name) ? g_strdup(name) : g_build_filename(reload->base_dir, name, NULL);
+    gchar *contents = NULL;
+    gsize len = 0;
+    if (g_file_get_contents(path, &contents, &len, NULL)) {
+        gchar *digest = g_compute_checksum_for_data(G_CHECKSUM_SHA1, (const guchar *)contents, len);
+        g_string_append_printf(out, "@%s", digest);
+        g_free(digest);
+        g_free(contents);
+    }
+    g_free(path);
+}
+
+/* node as text that differs exactly when node does; skip is a key left out at the top of node. */
+static void canonical(const ConfigReload *reload, yaml_document_t *doc, yaml_node_t *node,
+                      const gchar *skip, GString *out)
+{
+    if (!node)
+        return;
+    switch (node->type) {
+    case YAML_SCALAR_NODE:
+        g_string_append_printf(out, "%zu:", node->data.scalar.length);
+        g_string_append_len(out, (const gchar *)node->data.scalar.value, (gssize)node->data.scalar.length);
+        break;
+    case YAML_SEQUENCE_NODE:
+        g_string_append_c(out, '[');
+        for (yaml_node_item_t *item = node->data.sequence.items.start;
+             item < node->data.sequence.items.top; item++) {
+            canonical(reload, doc, yaml_document_get_node(doc, *item), NULL, out);
+            g_string_append_c(out, ',');
+        }
+        g_string_append_c(out, ']');
+        break;
+    case YAML_MAPPING_NODE:
+        g_string_append_c(out, '{');
+        for (yaml_node_pair_t *pair = node->data.mapping.pairs.start;
+             pair < node->data.mapping.pairs.top; pair++) {
+            yaml_node_t *key   = yaml_document_get_node(doc, pair->key);
+            yaml_node_t *value = yaml_document_get_node(doc, pair->value);
+            if (skip && g_strcmp0(yaml_util_scalar(key), skip) == 0)
+                continue;
+            canonical(reload, doc, key, NULL, out);
+            g_string_append_c(out, '=');
+            canonical(reload, doc, value, NULL, out);
+            if (is_file_key(yaml_util_scalar(key)) && yaml_util_scalar(value))
+                append_file_digest(reload, yaml_util_scalar(value), out);
+            g_string_append_c(out, ';');
+        }
+        g_string_append_c(out, '}');
+        break;
+    default:
+        break;
+    }
+}
+
+/* Every top-level section but the runtime one, msgbroker without its topic. */
+static GHashTable *snapshot(const ConfigReload *reload, yaml_document_t *doc)
+{
+    GHashTable *sections = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    yaml_node_t *root = yaml_document_get_root_node(doc);
+    if (!root || root->type != YAML_MAPPING_NODE)
+        return sections;
+    for (yaml_node_pair_t *pair = root->data.mapping.pairs.start;
+         pair < root->data.mapping.pairs.top; pair++) {
+        const gchar *name = yaml_util_scalar(yaml_document_get_node(doc, pair->key));
+        if (!name || g_strcmp0(name, RUNTIME_SECTION) == 0)
+            continue;
+        GString *text = g_string_new(NULL);
+        canonical(reload, doc, yaml_document_get_node(doc, pair->value),
+                  g_strcmp0(name, "msgbroker") == 0 ? "topic" : NULL, text);
+        g_hash_table_replace(sections, g_strdup(name), g_string_free(text, FALSE));
+    }
+    return sections;
+}
+
+/* Logs each section that differs from the built one; returns how many. */
+static guint report_rebuild(const ConfigReload *reload, GHashTable *now)
+{
+    guint n = 0;
+    GHashTableIter it;
+    gpointer name, text;
+    g_hash_table_iter_init(&it, now);
+    while (g_hash_table_iter_next(&it, &name, &text)) {
+        const gchar *built = g_hash_table_lookup(reload->built, name);
+        if (g_strcmp0(built, text) != 0) {
+            log_warning("config_reload: '%s' %s; needs a restart", (const gchar *)name,
+                        built ? "changed" : "added");
+            n++;
+        }
+    }
+    g_hash_table_iter_init(&it, reload->built);
+    while (g_hash_table_iter_next(&it, &name, NULL)) {
+        if (!g_hash_table_contains(now, name)) {
+            log_warning("config_reload: '%s' removed; needs a restart", (const gchar *)name);
+            n++;
+        }
+    }
+    return n;
+}
+
+void config_reload_free(ConfigReload *reload)
+{
+    if (!reload)
+        return;
+    if (reload->targets.pgie)
+        gst_object_unref(reload->targets.pgie);
+    if (reload->targets.msgbroker)
+        gst_object_unref(reload->targets.msgbroker);
+    settings_clear(&reload->current);
+    g_hash_table_destroy(reload->built);
+    g_free(reload->base_dir);
+    g_free(reload->path);
+    g_free(reload);
+}
+
+/* The same directory however it is spelled; "" (none) only matches itself. */
+static gboolean same_dir(const gchar *a, const gchar *b)
+{
+    if (!a[0] || !b[0])
+        return a[0] == b[0];
+    gchar *ca = g_canonicalize_filename(a, NULL);
+    gchar *cb = g_canonicalize_filename(b, NULL);
+    gboolean same = g_strcmp0(ca, cb) == 0;
+    g_free(ca);
+    g_free(cb);
+    return same;
+}
+
+/* Applies what differs from current; next takes what could not be applied back from current. */
+static guint apply_settings(ConfigReload *reload, RuntimeSettings *next)
+{
+    const ConfigReloadTargets *t = &reload->targets;
+    RuntimeConfig *cur  = &reload->current.runtime;
+    RuntimeConfig *want = &next->runtime;
+    guint n = 0;
+
+    if (want->pgie_interval >= 0 && want->pgie_interval != cur->pgie_interval) {
+        if (t->load_shedder)
+            load_shedder_set_pgie_interval(t->load_shedder, (guint)want->pgie_interval);
+        else if (element_util_has_property(t->pgie, "interval"))
+            g_object_set(G_OBJECT(t->pgie), "interval", (guint)want->pgie_interval, NULL);
+        log_info("config_reload: pgie-interval %d", want->pgie_interval);
+        n++;
+    } else if (want->pgie_interval < 0) {
+        want->pgie_interval = cur->pgie_interval;   /* unset: the element keeps what it has */
+    }
+
+    for (guint i = 0; i < RUNTIME_N_THRESHOLDS; i++) {
+        if (want->min_prob[i] == cur->min_prob[i])
+            continue;
+        if (t->meta_stage)
+            meta_stage_set_min_prob(t->meta_stage, runtime_threshold_component(i), want->min_prob[i]);
+        log_info("config_reload: %s %.3f", runtime_threshold_key(i), want->min_prob[i]);
+        n++;
+    }
+
+    if (!next->topic)
+        next->topic = g_strdup(reload->current.topic);
+    if (g_strcmp0(next->topic, reload->current.topic) != 0) {
+        if (t->publisher)
+            mqtt_publisher_set_topic(t->publisher, next->topic);
+        if (element_util_has_property(t->msgbroker, "topic"))
+            g_object_set(G_OBJECT(t->msgbroker), "topic", next->topic, NULL);
+        log_info("config_reload: msgbroker.topic %s", next->topic);
+        n++;
+    }
+
+    if (!same_dir(want->detection_output_dir, cur->detection_output_dir)) {
+        gboolean applied = FALSE;
+        if (!t->detection_writer || !want->detection_output_dir[0])
+            log_warning("config_reload: detection output turned %s; needs a restart",
+                        t->detection_writer ? "off" : "on");
+        else if (detection_writer_set_output_dir(t->detection_writer, want->detection_output_dir))
+            applied = TRUE;
+        if (applied) {
+            log_info("config_reload: detection-output-dir %s", want->detection_output_dir);
+            n++;
+        } else {
+            g_free(want->detection_output_dir);
+            want->detection_output_dir = g_strdup(cur->detection_output_dir);
+        }
+    }
+
+    if (want->track_heartbeat_frames != cur->track_heartbeat_frames ||
+        want->track_lost_frames != cur->track_lost_frames) {
+        if (t->send_ctx && t->send_ctx->tracks) {
+            probe_send_set_track_timing(t->send_ctx, (guint)want->track_heartbeat_frames,
+                                        (guint)want->track_lost_frames);
+            log_info("config_reload: track-heartbeat-frames %d, track-lost-frames %d",
+                     want->track_heartbeat_frames, want->track_lost_frames);
+            n++;
+        } else {
+            log_warning("config_reload: track timing has no effect without TRACK_EVENTS=1");
+        }
+    }
+
+    settings_clear(&reload->current);
+    reload->current = *next;
+    return n;
+}
+
+ConfigReload *config_reload_new(const PipelineConfig *config, const ConfigReloadTargets *targets)
+{
+    ConfigReload *reload = g_new0(ConfigReload, 1);
+    reload->path     = g_strdup(config->path);
+    reload->base_dir = g_path_get_dirname(config->path);
+    reload->targets  = *targets;
+    reload->settings = config->settings;
+    if (targets->pgie)
+        gst_object_ref(targets->pgie);
+    if (targets->msgbroker)
+        gst_object_ref(targets->msgbroker);
+    /* What the director built with, so only later edits are applied. */
+    reload->current.runtime = config->runtime;
+    reload->current.runtime.detection_output_dir = g_strdup(config->runtime.detection_output_dir);
+    reload->current.topic = g_strdup(config->msgbroker.link.topic);
+    reload->built    = snapshot(reload, config->doc);
+    reload->mtime_ns = config->mtime_ns;
+    reload->size     = config->size;
+    return reload;
+}
+
+gboolean config_reload_apply(ConfigReload *reload)
+{
+    yaml_util_stamp(reload->path, &reload->mtime_ns, &reload->size);
+    yaml_document_t doc;
+    if (!yaml_util_load(reload->path, &doc, "config_reload"))
+        return FALSE;
+
+    RuntimeSettings next = { 0 };
+    if (!pipeline_config_parse_runtime(&doc, reload->path, &reload->settings, &next.runtime)) {
+        yaml_document_delete(&doc);
+        log_error("config_reload: %s not applied", reload->path);
+        return FALSE;
+    }
+    yaml_node_t *msgbroker = yaml_util_get(&doc, yaml_document_get_root_node(&doc), "msgbroker");
+    next.topic = g_strdup(yaml_util_scalar(yaml_util_get(&doc, msgbroker, "topic")));
+    GHashTable *sections = snapshot(reload, &doc);
+    yaml_document_delete(&doc);
+
+    guint rebuild = report_rebuild(reload, sections);
+    g_hash_table_destroy(sections);
+    guint applied = apply_settings(reload, &next);
+    log_info("config_reload: %s: %u settings applied, %u sections need a restart",
+             reload->path, applied, rebuild);
+    return TRUE;
+}
+
+gboolean config_reload_file_changed(ConfigReload *reload)
+{
+    gint64 mtime_ns, size;
+    yaml_util_stamp(reload->path, &mtime_ns, &size);
+    return mtime_ns != reload->mtime_ns || size != reload->size;
+}
@@ -0,0 +1,1747 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <wctype.h>
+
+#include "detection_eval.h"
+
+#define DETECTION_LOG_NAME  "detections.txt"
+#define JSON_MAX_DEPTH      512
+#define IMAGES_PER_CLAIM    64
+/* Below this the log is parsed on the calling thread. */
+#define LOG_CHUNK_MIN_BYTES (1u << 20)
+
+static void *xrealloc(void *p, size_t size)
+{
+    p = realloc(p, size ? size : 1);
+    if (!p) {
+        fputs("deteval: out of memory\n", stderr);
+        abort();
+    }
+    return p;
+}
+
+static void *xcalloc(size_t n, size_t size)
+{
+    void *p = calloc(n ? n : 1, size);
+    if (!p) {
+        fputs("deteval: out of memory\n", stderr);
+        abort();
+    }
+    return p;
+}
+
+/* Makes room for need items of size bytes in *items. */
+static void reserve(void *items, size_t *cap, size_t need, size_t size)
+{
+    if (need <= *cap)
+        return;
+    size_t n = *cap ? *cap : 16;
+    while (n < need)
+        n *= 2;
+    *(void **)items = xrealloc(*(void **)items, n * size);
+    *cap = n;
+}
+
+static int fail(char *err, size_t err_len, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(err, err_len, fmt, ap);
+    va_end(ap);
+    return -1;
+}
+
+/* ---- mapped files ---- */
+
+typedef struct {
+    const char *data;
+    size_t      size;
+} Mapping;
+
+/* -1 with errno set when path cannot be opened or mapped; an empty file maps to no data. */
+static int map_file(const char *path, Mapping *m)
+{
+    m->data = NULL;
+    m->size = 0;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    if (st.st_size > 0) {
+        void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            close(fd);
+            return -1;
+        }
+        m->data = p;
+        m->size = (size_t)st.st_size;
+    }
+    close(fd);
+    return 0;
+}
+
+static void unmap_file(Mapping *m)
+{
+    if (m->data)
+        munmap((void *)m->data, m->size);
+    m->data = NULL;
+}
+
+/* ---- text, as Python's str sees it ---- */
+
+typedef struct {
+    const char *s;
+    size_t      len;
+} Span;
+
+/* Next UTF-8 code point; a byte that starts no valid sequence stands for itself. */
+static uint32_t next_cp(const char **pp, const char *end)
+{
+    const unsigned char *p = (const unsigned char *)*pp;
+    uint32_t c = p[0];
+    size_t n;
+    if (c < 0x80) {
+        *pp += 1;
+        return c;
+    }
+    if ((c & 0xe0) == 0xc0) {
+        n = 1;
+        c &= 0x1f;
+    } else if ((c & 0xf0) == 0xe0) {
+        n = 2;
+        c &= 0x0f;
+    } else if ((c & 0xf8) == 0xf0) {
+        n = 3;
+        c &= 0x07;
+    } else {
+        *pp += 1;
+        return c;
+    }
+    if ((size_t)((const unsigned char *)end - p) <= n) {
+        *pp += 1;
+        return p[0];
+    }
+    for (size_t i = 1; i <= n; i++) {
+        if ((p[i] & 0xc0) != 0x80) {
+            *pp += 1;
+            return p[0];
+        }
+        c = (c << 6) | (p[i] & 0x3f);
+    }
+    *pp += n + 1;
+    return c;
+}
+
+/* What str.split() splits on. */
+static int is_space(uint32_t c)
+{
+    return (c >= 0x09 && c <= 0x0d) || (c >= 0x1c && c <= 0x20) || c == 0x85 || c == 0xa0 ||
+           c == 0x1680 || (c >= 0x2000 && c <= 0x200a) || c == 0x2028 || c == 0x2029 ||
+           c == 0x202f || c == 0x205f || c == 0x3000;
+}
+
+static uint32_t to_upper(uint32_t c)
+{
+    if (c < 0x80)
+        return (c >= 'a' && c <= 'z') ? c - 32 : c;
+    return (uint32_t)towupper((wint_t)c);
+}
+
+/*
+ * str.split() of [p, end): the first max-1 tokens, then everything from the
+ * max-th token to the end of the last as one span.  Returns the token count.
+ */
+static size_t split_line(const char *p, const char *end, Span *tok, size_t max)
+{
+    size_t n = 0;
+    while (p < end) {
+        const char *start = p;
+        if (is_space(next_cp(&p, end)))
+            continue;
+        const char *stop = p;
+        while (p < end) {
+            const char *q = p;
+            if (is_space(next_cp(&p, end))) {
+                p = q;
+                break;
+            }
+            stop = p;
+        }
+        if (n < max) {
+            tok[n].s   = start;
+            tok[n].len = (size_t)(stop - start);
+        } else {
+            tok[max - 1].len = (size_t)(stop - tok[max - 1].s);
+        }
+        n++;
+    }
+    return n;
+}
+
+/* Line of [*pp, end) in universal-newline mode: returns its end and moves *pp past "\n", "\r" or "\r\n". */
+static const char *next_line(const char **pp, const char *end)
+{
+    const char *p = *pp;
+    const char *nl = memchr(p, '\n', (size_t)(end - p));
+    const char *stop = nl ? nl : end;
+    const char *cr = memchr(p, '\r', (size_t)(stop - p));
+    if (cr) {
+        *pp = (cr + 1 < end && cr[1] == '\n') ? cr + 2 : cr + 1;
+        return cr;
+    }
+    *pp = nl ? nl + 1 : end;
+    return stop;
+}
+
+static int is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+/* int(): optional sign, digits, single underscores between digits. */
+static int parse_int(Span t, int64_t *out)
+{
+    size_t i = 0;
+    int neg = 0;
+    if (i < t.len && (t.s[i] == '+' || t.s[i] == '-'))
+        neg = t.s[i++] == '-';
+    if (i == t.len)
+        return -1;
+    uint64_t v = 0;
+    int after_digit = 0;
+    for (; i < t.len; i++) {
+        char c = t.s[i];
+        if (c == '_' && after_digit && i + 1 < t.len && is_digit(t.s[i + 1])) {
+            after_digit = 0;
+            continue;
+        }
+        if (!is_digit(c) || v > ((uint64_t)INT64_MAX - 9) / 10)
+            return -1;
+        v = v * 10 + (uint64_t)(c - '0');
+        after_digit = 1;
+    }
+    *out = neg ? -(int64_t)v : (int64_t)v;
+    return 0;
+}
+
+/* float(): what strtod takes but hex and nan(...), plus underscores between digits. */
+static int parse_float(Span t, double *out)
+{
+    char buf[128];
+    size_t n = 0;
+    if (t.len == 0 || t.len >= sizeof(buf))
+        return -1;
+    for (size_t i = 0; i < t.len; i++) {
+        char c = t.s[i];
+        if (c == '_') {
+            if (i == 0 || i + 1 == t.len || !is_digit(t.s[i - 1]) || !is_digit(t.s[i + 1]))
+                return -1;
+            continue;
+        }
+        if (c == 'x' || c == 'X' || c == '(')
+            return -1;
+        buf[n++] = c;
+    }
+    buf[n] = '\0';
+    char *end;
+    *out = strtod(buf, &end);
+    return end == buf + n ? 0 : -1;
+}
+
+/* ---- detections ---- */
+
+typedef struct {
+    double      left, top, width, height;
+    const char *text;        /* tokens 5.. as written; "-" when there are none */
+    uint32_t    text_len;
+    uint32_t    is_plate;
+} Pred;
+
+#define LINE_TOKENS 6
+
+/* parse_detection_line(): "car|plate left top width height [text]". */
+static int parse_detection(const Span *t, size_t n, Pred *out)
+{
+    if (n < 5)
+        return -1;
+    if (t[0].len == 3 && strncasecmp(t[0].s, "car", 3) == 0)
+        out->is_plate = 0;
+    else if (t[0].len == 5 && strncasecmp(t[0].s, "plate", 5) == 0)
+        out->is_plate = 1;
+    else
+        return -1;
+    if (parse_float(t[1], &out->left) != 0 || parse_float(t[2], &out->top) != 0 ||
+        parse_float(t[3], &out->width) != 0 || parse_float(t[4], &out->height) != 0)
+        return -1;
+    if (n > 5) {
+        out->text     = t[5].s;
+        out->text_len = (uint32_t)t[5].len;
+    } else {
+        out->text     = "-";
+        out->text_len = 1;
+    }
+    return 0;
+}
+
+static int is_header(const Span *t, size_t n)
+{
+    return n >= 2 && t[0].len == 5 && memcmp(t[0].s, "frame", 5) == 0;
+}
+
+/* "frame N [SOURCE]": 1 with *frame set for one of source_id's frames, 0 for any other header. */
+static int parse_header(const Span *t, size_t n, int64_t source_id, int64_t *frame)
+{
+    int64_t source = 0;
+    if (n >= 3 && parse_int(t[2], &source) != 0)
+        return 0;
+    if (source != source_id)
+        return 0;
+    return parse_int(t[1], frame) == 0;
+}
+
+/* One header's detections; a frame whose header repeats has several, in file order. */
+typedef struct {
+    int64_t     frame;
+    size_t      seq;         /* header order in the whole file */
+    size_t      first;       /* into its chunk's preds */
+    size_t      count;
+    const Pred *preds;       /* set once every chunk is parsed */
+} Block;
+
+typedef struct {
+    const char *begin, *end;
+    int64_t     source_id;
+    Pred       *preds;
+    size_t      n_preds, cap_preds;
+    Block      *blocks;
+    size_t      n_blocks, cap_blocks;
+} LogChunk;
+
+static void *parse_chunk(void *arg)
+{
+    LogChunk *c = arg;
+    const char *p = c->begin;
+    size_t current = SIZE_MAX;
+    while (p < c->end) {
+        const char *line = p;
+        const char *stop = next_line(&p, c->end);
+        Span t[LINE_TOKENS];
+        size_t n = split_line(line, stop, t, LINE_TOKENS);
+        if (is_header(t, n)) {
+            int64_t frame;
+            current = SIZE_MAX;
+            if (parse_header(t, n, c->source_id, &frame)) {
+                reserve(&c->blocks, &c->cap_blocks, c->n_blocks + 1, sizeof(Block));
+                c->blocks[c->n_blocks] = (Block){ .frame = frame, .first = c->n_preds };
+                current = c->n_blocks++;
+            }
+            continue;
+        }
+        Pred d;
+        if (current == SIZE_MAX || parse_detection(t, n, &d) != 0)
+            continue;
+        reserve(&c->preds, &c->cap_preds, c->n_preds + 1, sizeof(Pred));
+        c->preds[c->n_preds++] = d;
+        c->blocks[current].count++;
+    }
+    return NULL;
+}
+
+/* Start of the first header line at or after pos: what follows does not depend on what came before. */
+static const char *header_from(const char *base, const char *pos, const char *end)
+{
+    const char *p = pos;
+    if (p > base && p < end) {
+        if (p[-1] == '\r' && p[0] == '\n')
+            p++;
+        else if (p[-1] != '\n' && p[-1] != '\r')
+            next_line(&p, end);
+    }
+    while (p < end) {
+        const char *line = p;
+        const char *stop = next_line(&p, end);
+        Span t[LINE_TOKENS];
+        if (is_header(t, split_line(line, stop, t, LINE_TOKENS)))
+            return line;
+    }
+    return end;
+}
+
+static int cmp_block(const void *a, const void *b)
+{
+    const Block *x = a, *y = b;
+    if (x->frame != y->frame)
+        return x->frame < y->frame ? -1 : 1;
+    return (x->seq > y->seq) - (x->seq < y->seq);
+}
+
+typedef struct {
+    const char *dir;
+    int         per_frame;   /* no detections.txt: frame_NNNNNN.txt files */
+    Mapping     log;
+    LogChunk   *chunks;
+    unsigned    n_chunks;
+    Block      *blocks;      /* by (frame, file order), empty ones left out */
+    size_t      n_blocks;
+} Predictions;
+
+static void predictions_load_log(Predictions *pr, int64_t source_id, unsigned threads)
+{
+    const char *base = pr->log.data, *end = base + pr->log.size;
+    unsigned n = pr->log.size < LOG_CHUNK_MIN_BYTES ? 1 : threads;
+    pr->chunks   = xcalloc(n, sizeof(LogChunk));
+    pr->n_chunks = n;
+
+    const char *from = base;
+    for (unsigned i = 0; i < n; i++) {
+        const char *to = i + 1 == n ? end : header_from(base, base + pr->log.size / n * (i + 1), end);
+        if (to < from)
+            to = from;
+        pr->chunks[i] = (LogChunk){ .begin = from, .end = to, .source_id = source_id };
+        from = to;
+    }
+
+    pthread_t *tids = xcalloc(n, sizeof(pthread_t));
+    unsigned started = 0;
+    for (unsigned i = 1; i < n; i++, started++)
+        if (pthread_create(&tids[i], NULL, parse_chunk, &pr->chunks[i]) != 0)
+            break;
+    parse_chunk(&pr->chunks[0]);
+    for (unsigned i = 1; i <= started; i++)
+        pthread_join(tids[i], NULL);
+    for (unsigned i = started + 1; i < n; i++)
+        parse_chunk(&pr->chunks[i]);
+    free(tids);
+
+    size_t total = 0, seq = 0;
+    for (unsigned i = 0; i < n; i++)
+        total += pr->chunks[i].n_blocks;
+    pr->blocks = xrealloc(NULL, total * sizeof(Block));
+    for (unsigned i = 0; i < n; i++) {
+        const LogChunk *c = &pr->chunks[i];
+        for (size_t b = 0; b < c->n_blocks; b++, seq++) {
+            if (c->blocks[b].count == 0)
+                continue;
+            Block *out = &pr->blocks[pr->n_blocks++];
+            *out = c->blocks[b];
+            out->preds = c->preds + out->first;
+            out->seq   = seq;
+        }
+    }
+    qsort(pr->blocks, pr->n_blocks, sizeof(Block), cmp_block);
+}
+
+static void predictions_clear(Predictions *pr)
+{
+    for (unsigned i = 0; i < pr->n_chunks; i++) {
+        free(pr->chunks[i].preds);
+        free(pr->chunks[i].blocks);
+    }
+    free(pr->chunks);
+    free(pr->blocks);
+    unmap_file(&pr->log);
+}
+
+/* ---- COCO ground truth ---- */
+
+typedef struct {
+    double x, y, w, h;
+} Box;
+
+typedef struct {
+    Box   box;
+    char *text;              /* attributes.value; NULL when it is null */
+    size_t text_len;
+} GtPlate;
+
+/* Everything under one image id. */
+typedef struct {
+    double   width, height;
+    Box     *cars;
+    size_t   n_cars;
+    GtPlate *plates;
+    size_t   n_plates;
+} GtImage;
+
+enum { FRAME_NONE, FRAME_OK, FRAME_OUT_OF_RANGE };
+
+typedef struct {
+    double   id;
+    int      has_id, has_width, has_height;
+    double   width, height;
+    int      frame_state;
+    int64_t  frame;
+    size_t   gt;
+} CocoImage;
+
+enum { CAT_OTHER, CAT_CAR, CAT_PLATE };
+enum { TEXT_DEFAULT, TEXT_STRING, TEXT_NULL, TEXT_OTHER };
+
+typedef struct {
+    double   image_id, category_id;
+    int      has_image_id, has_category_id, has_bbox;
+    double   bbox[4];
+    size_t   bbox_len;
+    int      bbox_numeric;
+    int      text_state;
+    char    *text;
+    size_t   text_len;
+} CocoAnn;
+
+typedef struct {
+    double   id;
+    int      has_id, has_name;
+    int      kind;
+} CocoCat;
+
+typedef struct {
+    CocoImage *images;
+    size_t     n_images, cap_images;
+    CocoAnn   *anns;
+    size_t     n_anns, cap_anns;
+    CocoCat   *cats;
+    size_t     n_cats, cap_cats;
+    GtImage   *gt;
+    size_t     n_gt;
+    Box       *car_boxes;
+    GtPlate   *plates;
+} Coco;
+
+/* ---- a JSON reader for just the parts of COCO the metrics use ---- */
+
+typedef struct {
+    const char *start, *p, *end;
+    int         depth;
+    char        msg[256];
+} Json;
+
+static int json_fail(Json *j, const char *fmt, ...)
+{
+    if (!j->msg[0]) {
+        va_list ap;
+        va_start(ap, fmt);
+        vsnprintf(j->msg, sizeof(j->msg), fmt, ap);
+        va_end(ap);
+    }
+    return -1;
+}
+
+static int json_syntax(Json *j)
+{
+    return json_fail(j, "invalid JSON at byte %zu", (size_t)(j->p - j->start));
+}
+
+static void json_ws(Json *j)
+{
+    while (j->p < j->end && (*j->p == ' ' || *j->p == '\t' || *j->p == '\n' || *j->p == '\r'))
+        j->p++;
+}
+
+static char json_peek(Json *j)
+{
+    json_ws(j);
+    return j->p < j->end ? *j->p : '\0';
+}
+
+static int json_literal(Json *j, const char *word)
+{
+    size_t n = strlen(word);
+    if ((size_t)(j->end - j->p) < n || memcmp(j->p, word, n) != 0)
+        return 0;
+    j->p += n;
+    return 1;
+}
+
+static size_t put_utf8(char *out, uint32_t c)
+{
+    if (c < 0x80) {
+        out[0] = (char)c;
+        return 1;
+    }
+    if (c < 0x800) {
+        out[0] = (char)(0xc0 | (c >> 6));
+        out[1] = (char)(0x80 | (c & 0x3f));
+        return 2;
+    }
+    if (c < 0x10000) {
+        out[0] = (char)(0xe0 | (c >> 12));
+        out[1] = (char)(0x80 | ((c >> 6) & 0x3f));
+        out[2] = (char)(0x80 | (c & 0x3f));
+        return 3;
+    }
+    out[0] = (char)(0xf0 | (c >> 18));
+    out[1] = (char)(0x80 | ((c >> 12) & 0x3f));
+    out[2] = (char)(0x80 | ((c >> 6) & 0x3f));
+    out[3] = (char)(0x80 | (c & 0x3f));
+    return 4;
+}
+
+static int hex4(const char *p, const char *end, uint32_t *out)
+{
+    if (end - p < 4)
+        return -1;
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = p[i];
+        v <<= 4;
+        if (c >= '0' && c <= '9')
+            v |= (uint32_t)(c - '0');
+        else if (c >= 'a' && c <= 'f')
+            v |= (uint32_t)(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F')
+            v |= (uint32_t)(c - 'A' + 10);
+        else
+            return -1;
+    }
+    *out = v;
+    return 0;
+}
+
+/* A string, unescaped into a new buffer when out is set (never longer than it is escaped). */
+static int json_string(Json *j, char **out, size_t *out_len)
+{
+    if (json_peek(j) != '"')
+        return json_syntax(j);
+    const char *s = ++j->p;
+    while (j->p < j->end && *j->p != '"')
+        j->p += *j->p == '\\' ? 2 : 1;
+    if (j->p >= j->end)
+        return json_syntax(j);
+    const char *e = j->p++;
+    if (!out)
+        return 0;
+
+    char *buf = xrealloc(NULL, (size_t)(e - s) + 1);
+    size_t n = 0;
+    while (s < e) {
+        if (*s != '\\') {
+            buf[n++] = *s++;
+            continue;
+        }
+        char c = s[1];
+        s += 2;
+        switch (c) {
+        case 'b': buf[n++] = '\b'; break;
+        case 'f': buf[n++] = '\f'; break;
+        case 'n': buf[n++] = '\n'; break;
+        case 'r': buf[n++] = '\r'; break;
+        case 't': buf[n++] = '\t'; break;
+        case 'u': {
+            uint32_t cp, lo;
+            if (hex4(s, e, &cp) != 0) {
+                free(buf);
+                return json_syntax(j);
+            }
+            s += 4;
+            if (cp >= 0xd800 && cp < 0xdc00 && e - s >= 6 && s[0] == '\\' && s[1] == 'u' &&
+                hex4(s + 2, e, &lo) == 0 && lo >= 0xdc00 && lo < 0xe000) {
+                cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+                s += 6;
+            }
+            n += put_utf8(buf + n, cp);
+            break;
+        }
+        default:
+            buf[n++] = c;
+            break;
+        }
+    }
+    buf[n] = '\0';
+    *out = buf;
+    if (out_len)
+        *out_len = n;
+    return 0;
+}
+
+/* Numbers as Python's json reads them, NaN and Infinity included. */
+static int json_number(Json *j, double *out)
+{
+    json_ws(j);
+    if (json_literal(j, "NaN")) {
+        *out = NAN;
+        return 0;
+    }
+    if (json_literal(j, "Infinity")) {
+        *out = INFINITY;
+        return 0;
+    }
+    if (json_literal(j, "-Infinity")) {
+        *out = -INFINITY;
+        return 0;
+    }
+    const char *s = j->p;
+    while (j->p < j->end && (is_digit(*j->p) || *j->p == '-' || *j->p == '+' || *j->p == '.' ||
+                             *j->p == 'e' || *j->p == 'E'))
+        j->p++;
+    char buf[128];
+    size_t n = (size_t)(j->p - s);
+    if (n == 0 || n >= sizeof(buf))
+        return json_syntax(j);
+    memcpy(buf, s, n);
+    buf[n] = '\0';
+    char *end;
+    *out = strtod(buf, &end);
+    return end == buf + n ? 0 : json_syntax(j);
+}
+
+static int json_skip(Json *j);
+
+/* Calls field for each member; field reads the value. */
+static int json_object(Json *j, int (*field)(Json *, const char *key, void *ctx), void *ctx)
+{
+    if (json_peek(j) != '{')
+        return json_syntax(j);
+    if (++j->depth > JSON_MAX_DEPTH)
+        return json_fail(j, "JSON nested too deep");
+    j->p++;
+    if (json_peek(j) == '}') {
+        j->p++;
+        j->depth--;
+        return 0;
+    }
+    for (;;) {
+        char *key;
+        if (json_string(j, &key, NULL) != 0)
+            return -1;
+        if (json_peek(j) != ':') {
+            free(key);
+            return json_syntax(j);
+        }
+        j->p++;
+        int rc = field(j, key, ctx);
+        free(key);
+        if (rc != 0)
+            return -1;
+        char c = json_peek(j);
+        j->p++;
+        if (c == '}')
+            break;
+        if (c != ',')
+            return json_syntax(j);
+    }
+    j->depth--;
+    return 0;
+}
+
+/* Calls item for each element with its index; item reads it. */
+static int json_array(Json *j, int (*item)(Json *, size_t i, void *ctx), void *ctx)
+{
+    if (json_peek(j) != '[')
+        return json_syntax(j);
+    if (++j->depth > JSON_MAX_DEPTH)
+        return json_fail(j, "JSON nested too deep");
+    j->p++;
+    if (json_peek(j) == ']') {
+        j->p++;
+        j->depth--;
+        return 0;
+    }
+    for (size_t i = 0;; i++) {
+        if (item(j, i, ctx) != 0)
+            return -1;
+        char c = json_peek(j);
+        j->p++;
+        if (c == ']')
+            break;
+        if (c != ',')
+            return json_syntax(j);
+    }
+    j->depth--;
+    return 0;
+}
+
+static int skip_field(Json *j, const char *key, void *ctx)
+{
+    (void)key;
+    (void)ctx;
+    return json_skip(j);
+}
+
+static int skip_item(Json *j, size_t i, void *ctx)
+{
+    (void)i;
+    (void)ctx;
+    return json_skip(j);
+}
+
+static int json_skip(Json *j)
+{
+    switch (json_peek(j)) {
+    case '{': return json_object(j, skip_field, NULL);
+    case '[': return json_array(j, skip_item, NULL);
+    case '"': return json_string(j, NULL, NULL);
+    case 't': return json_literal(j, "true") ? 0 : json_syntax(j);
+    case 'f': return json_literal(j, "false") ? 0 : json_syntax(j);
+    case 'n': return json_literal(j, "null") ? 0 : json_syntax(j);
+    default: {
+        double v;
+        return json_number(j, &v);
+    }
+    }
+}
+
+static int is_number_start(char c)
+{
+    return is_digit(c) || c == '-' || c == 'N' || c == 'I';
+}
+
+/* A numeric member: *has is set when it is one, anything else is an error. */
+static int json_member_number(Json *j, const char *what, double *out, int *has)
+{
+    if (!is_number_start(json_peek(j)))
+        return json_fail(j, "%s is not a number", what);
+    *has = 1;
+    return json_number(j, out);
+}
+
+/* re.match(r"frame_(\d+)\.\w+", name) */
+static int frame_from_file_name(const char *s, size_t len, int64_t *frame)
+{
+    if (len < 6 || memcmp(s, "frame_", 6) != 0)
+        return FRAME_NONE;
+    size_t i = 6;
+    uint64_t v = 0;
+    int overflow = 0;
+    for (; i < len && is_digit(s[i]); i++) {
+        if (v > ((uint64_t)INT64_MAX - 9) / 10)
+            overflow = 1;
+        else
+            v = v * 10 + (uint64_t)(s[i] - '0');
+    }
+    if (i == 6 || i + 1 >= len || s[i] != '.')
+        return FRAME_NONE;
+    unsigned char c = (unsigned char)s[i + 1];
+    if (!(is_digit((char)c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c >= 0x80))
+        return FRAME_NONE;
+    *frame = (int64_t)v;
+    return overflow ? FRAME_OUT_OF_RANGE : FRAME_OK;
+}
+
+static int image_field(Json *j, const char *key, void *ctx)
+{
+    CocoImage *img = ctx;
+    if (strcmp(key, "id") == 0)
+        return json_member_number(j, "image id", &img->id, &img->has_id);
+    if (strcmp(key, "width") == 0)
+        return json_member_number(j, "image width", &img->width, &img->has_width);
+    if (strcmp(key, "height") == 0)
+        return json_member_number(j, "image height", &img->height, &img->has_height);
+    if (strcmp(key, "file_name") == 0) {
+        char *name;
+        size_t len;
+        if (json_peek(j) != '"')
+            return json_fail(j, "image file_name is not a string");
+        if (json_string(j, &name, &len) != 0)
+            return -1;
+        img->frame_state = frame_from_file_name(name, len, &img->frame);
+        free(name);
+        return 0;
+    }
+    return json_skip(j);
+}
+
+static int image_item(Json *j, size_t i, void *ctx)
+{
+    Coco *coco = ctx;
+    reserve(&coco->images, &coco->cap_images, coco->n_images + 1, sizeof(CocoImage));
+    CocoImage *img = &coco->images[coco->n_images++];
+    memset(img, 0, sizeof(*img));
+    if (json_object(j, image_field, img) != 0)
+        return -1;
+    if (!img->has_id || !img->has_width || !img->has_height)
+        return json_fail(j, "images[%zu] needs id, width and height", i);
+    return 0;
+}
+
+static int bbox_item(Json *j, size_t i, void *ctx)
+{
+    CocoAnn *ann = ctx;
+    ann->bbox_len = i + 1;
+    if (!is_number_start(json_peek(j))) {
+        ann->bbox_numeric = 0;
+        return json_skip(j);
+    }
+    double v;
+    if (json_number(j, &v) != 0)
+        return -1;
+    if (i < 4)
+        ann->bbox[i] = v;
+    return 0;
+}
+
+static int attributes_field(Json *j, const char *key, void *ctx)
+{
+    CocoAnn *ann = ctx;
+    if (strcmp(key, "value") != 0)
+        return json_skip(j);
+    free(ann->text);
+    ann->text = NULL;
+    switch (json_peek(j)) {
+    case '"':
+        ann->text_state = TEXT_STRING;
+        return json_string(j, &ann->text, &ann->text_len);
+    case 'n':
+        ann->text_state = TEXT_NULL;
+        return json_skip(j);
+    default:
+        ann->text_state = TEXT_OTHER;
+        return json_skip(j);
+    }
+}
+
+static int ann_field(Json *j, const char *key, void *ctx)
+{
+    CocoAnn *ann = ctx;
+    if (strcmp(key, "image_id") == 0)
+        return json_member_number(j, "annotation image_id", &ann->image_id, &ann->has_image_id);
+    if (strcmp(key, "category_id") == 0)
+        return json_member_number(j, "annotation category_id", &ann->category_id, &ann->has_category_id);
+    if (strcmp(key, "bbox") == 0) {
+        if (json_peek(j) != '[')
+            return json_fail(j, "annotation bbox is not a list");
+        ann->has_bbox     = 1;
+        ann->bbox_len     = 0;
+        ann->bbox_numeric = 1;
+        return json_array(j, bbox_item, ann);
+    }
+    if (strcmp(key, "attributes") == 0) {
+        free(ann->text);
+        ann->text       = NULL;
+        ann->text_state = TEXT_DEFAULT;
+        if (json_peek(j) == '{')
+            return json_object(j, attributes_field, ann);
+        return json_skip(j);
+    }
+    return json_skip(j);
+}
+
+static int ann_item(Json *j, size_t i, void *ctx)
+{
+    Coco *coco = ctx;
+    reserve(&coco->anns, &coco->cap_anns, coco->n_anns + 1, sizeof(CocoAnn));
+    CocoAnn *ann = &coco->anns[coco->n_anns++];
+    memset(ann, 0, sizeof(*ann));
+    if (json_object(j, ann_field, ann) != 0)
+        return -1;
+    if (!ann->has_image_id || !ann->has_category_id || !ann->has_bbox)
+        return json_fail(j, "annotations[%zu] needs image_id, category_id and bbox", i);
+    return 0;
+}
+
+static int cat_field(Json *j, const char *key, void *ctx)
+{
+    CocoCat *cat = ctx;
+    if (strcmp(key, "id") == 0)
+        return json_member_number(j, "category id", &cat->id, &cat->has_id);
+    if (strcmp(key, "name") == 0) {
+        cat->has_name = 1;
+        cat->kind     = CAT_OTHER;
+        if (json_peek(j) != '"')
+            return json_skip(j);
+        char *name;
+        if (json_string(j, &name, NULL) != 0)
+            return -1;
+        if (strcmp(name, "car") == 0)
+            cat->kind = CAT_CAR;
+        else if (strcmp(name, "license_plate") == 0)
+            cat->kind = CAT_PLATE;
+        free(name);
+        return 0;
+    }
+    return json_skip(j);
+}
+
+static int cat_item(Json *j, size_t i, void *ctx)
+{
+    Coco *coco = ctx;
+    reserve(&coco->cats, &coco->cap_cats, coco->n_cats + 1, sizeof(CocoCat));
+    CocoCat *cat = &coco->cats[coco->n_cats++];
+    memset(cat, 0, sizeof(*cat));
+    if (json_object(j, cat_field, cat) != 0)
+        return -1;
+    if (!cat->has_id || !cat->has_name)
+        return json_fail(j, "categories[%zu] needs id and name", i);
+    return 0;
+}
+
+static void coco_clear_anns(Coco *coco)
+{
+    for (size_t i = 0; i < coco->n_anns; i++)
+        free(coco->anns[i].text);
+    coco->n_anns = 0;
+}
+
+/* A repeated top-level key replaces the earlier list, as json.load does. */
+static int root_field(Json *j, const char *key, void *ctx)
+{
+    Coco *coco = ctx;
+    int (*item)(Json *, size_t, void *) = NULL;
+    if (strcmp(key, "images") == 0) {
+        coco->n_images = 0;
+        item = image_item;
+    } else if (strcmp(key, "annotations") == 0) {
+        coco_clear_anns(coco);
+        item = ann_item;
+    } else if (strcmp(key, "categories") == 0) {
+        coco->n_cats = 0;
+        item = cat_item;
+    } else {
+        return json_skip(j);
+    }
+    if (json_peek(j) != '[')
+        return json_fail(j, "'%s' is not a list", key);
+    return json_array(j, item, coco);
+}
+
+/* ---- image ids ---- */
+
+typedef struct {
+    uint64_t *keys;
+    size_t   *vals;
+    size_t    mask;
+} IdMap;
+
+static uint64_t id_key(double id)
+{
+    uint64_t k;
+    if (id == 0.0)
+        id = 0.0;
+    memcpy(&k, &id, sizeof(k));
+    return k;
+}
+
+static uint64_t mix64(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+static void id_map_init(IdMap *m, size_t n)
+{
+    size_t cap = 16;
+    while (cap < n * 2)
+        cap *= 2;
+    m->keys = xrealloc(NULL, cap * sizeof(uint64_t));
+    m->vals = xrealloc(NULL, cap * sizeof(size_t));
+    m->mask = cap - 1;
+    for (size_t i = 0; i < cap; i++)
+        m->vals[i] = SIZE_MAX;
+}
+
+/* Slot of id; with insert, a new one numbered *next when absent.  SIZE_MAX when absent otherwise. */
+static size_t id_map_get(IdMap *m, double id, int insert, size_t *next)
+{
+    uint64_t k = id_key(id);
+    for (size_t i = mix64(k) & m->mask;; i = (i + 1) & m->mask) {
+        if (m->vals[i] == SIZE_MAX) {
+            if (!insert)
+                return SIZE_MAX;
+            m->keys[i] = k;
+            m->vals[i] = (*next)++;
+            return m->vals[i];
+        }
+        if (m->keys[i] == k)
+            return m->vals[i];
+    }
+}
+
+static void id_map_free(IdMap *m)
+{
+    free(m->keys);
+    free(m->vals);
+}
+
+static int category_kind(const Coco *coco, double category_id)
+{
+    for (size_t i = coco->n_cats; i-- > 0;)
+        if (coco->cats[i].id == category_id)
+            return coco->cats[i].kind;
+    return CAT_OTHER;
+}
+
+/* build_gt_by_image(): car and plate boxes per image id, in annotation order. */
+static int coco_index(Coco *coco, char *err, size_t err_len)
+{
+    IdMap ids;
+    id_map_init(&ids, coco->n_images);
+    for (size_t i = 0; i < coco->n_images; i++)
+        coco->images[i].gt = id_map_get(&ids, coco->images[i].id, 1, &coco->n_gt);
+
+    coco->gt = xcalloc(coco->n_gt, sizeof(GtImage));
+    for (size_t i = 0; i < coco->n_images; i++) {
+        GtImage *gt = &coco->gt[coco->images[i].gt];
+        gt->width  = coco->images[i].width;
+        gt->height = coco->images[i].height;
+    }
+
+    size_t n_cars = 0, n_plates = 0;
+    size_t *slot = xrealloc(NULL, coco->n_anns * sizeof(size_t));
+    int *kind = xrealloc(NULL, coco->n_anns * sizeof(int));
+    int rc = 0;
+    for (size_t i = 0; i < coco->n_anns && rc == 0; i++) {
+        const CocoAnn *ann = &coco->anns[i];
+        kind[i] = category_kind(coco, ann->category_id);
+        if (kind[i] == CAT_OTHER)
+            continue;
+        slot[i] = id_map_get(&ids, ann->image_id, 0, NULL);
+        if (slot[i] == SIZE_MAX)
+            rc = fail(err, err_len, "annotations[%zu]: image_id %g is not an image", i, ann->image_id);
+        else if (ann->bbox_len != 4 || !ann->bbox_numeric)
+            rc = fail(err, err_len, "annotations[%zu]: bbox is not 4 numbers", i);
+        else if (kind[i] == CAT_PLATE && ann->text_state == TEXT_OTHER)
+            rc = fail(err, err_len, "annotations[%zu]: plate text is not a string", i);
+        else if (kind[i] == CAT_CAR) {
+            coco->gt[slot[i]].n_cars++;
+            n_cars++;
+        } else {
+            coco->gt[slot[i]].n_plates++;
+            n_plates++;
+        }
+    }
+    id_map_free(&ids);
+
+    if (rc == 0) {
+        coco->car_boxes = xrealloc(NULL, n_cars * sizeof(Box));
+        coco->plates    = xrealloc(NULL, n_plates * sizeof(GtPlate));
+        size_t c = 0, p = 0;
+        for (size_t g = 0; g < coco->n_gt; g++) {
+            GtImage *gt = &coco->gt[g];
+            gt->cars   = coco->car_boxes + c;
+            gt->plates = coco->plates + p;
+            c += gt->n_cars;
+            p += gt->n_plates;
+            gt->n_cars = gt->n_plates = 0;
+        }
+        for (size_t i = 0; i < coco->n_anns; i++) {
+            CocoAnn *ann = &coco->anns[i];
+            Box box = { ann->bbox[0], ann->bbox[1], ann->bbox[2], ann->bbox[3] };
+            GtImage *gt = kind[i] == CAT_OTHER ? NULL : &coco->gt[slot[i]];
+            if (kind[i] == CAT_CAR) {
+                gt->cars[gt->n_cars++] = box;
+            } else if (kind[i] == CAT_PLATE) {
+                GtPlate *pl = &gt->plates[gt->n_plates++];
+                pl->box = box;
+                if (ann->text_state == TEXT_NULL) {
+                    pl->text = NULL;
+                } else if (ann->text_state == TEXT_STRING) {
+                    pl->text     = ann->text;
+                    pl->text_len = ann->text_len;
+                    ann->text    = NULL;
+                } else {
+                    pl->text     = xrealloc(NULL, 1);
+                    pl->text[0]  = '\0';
+                    pl->text_len = 0;
+                }
+            }
+        }
+    }
+    free(slot);
+    free(kind);
+    return rc;
+}
+
+static int coco_load(Coco *coco, const char *path, char *err, size_t err_len)
+{
+    Mapping m;
+    if (map_file(path, &m) != 0)
+        return fail(err, err_len, "%s: %s", path, strerror(errno));
+    Json j = { .start = m.data, .p = m.data, .end = m.data + m.size };
+    int rc = json_peek(&j) == '{' ? json_object(&j, root_field, coco) : json_syntax(&j);
+    if (rc == 0 && json_peek(&j) != '\0')
+        rc = json_syntax(&j);
+    unmap_file(&m);
+    if (rc != 0)
+        return fail(err, err_len, "%s: %s", path, j.msg);
+    return coco_index(coco, err, err_len);
+}
+
+static void coco_clear(Coco *coco)
+{
+    coco_clear_anns(coco);
+    for (size_t i = 0; coco->plates && i < coco->n_gt; i++)
+        for (size_t p = 0; p < coco->gt[i].n_plates; p++)
+            free(coco->gt[i].plates[p].text);
+    free(coco->images);
+    free(coco->anns);
+    free(coco->cats);
+    free(coco->gt);
+    free(coco->car_boxes);
+    free(coco->plates);
+}
+
+/* ---- edit distance ---- */
+
+static size_t edit_distance_dp(const uint32_t *a, size_t n, const uint32_t *b, size_t m)
+{
+    size_t *row = xrealloc(NULL, (m + 1) * sizeof(size_t));
+    for (size_t j = 0; j <= m; j++)
+        row[j] = j;
+    for (size_t i = 1; i <= n; i++) {
+        size_t diag = row[0];
+        row[0] = i;
+        for (size_t j = 1; j <= m; j++) {
+            size_t up = row[j];
+            size_t best = diag + (a[i - 1] != b[j - 1]);
+            if (up + 1 < best)
+                best = up + 1;
+            if (row[j - 1] + 1 < best)
+                best = row[j - 1] + 1;
+            row[j] = best;
+            diag = up;
+        }
+    }
+    size_t d = row[m];
+    free(row);
+    return d;
+}
+
+/* Myers' bit-vector algorithm in Hyyrö's form for global distance: one column of b per bit. */
+size_t deteval_edit_distance(const uint32_t *a, size_t n, const uint32_t *b, size_t m)
+{
+    if (n < m) {
+        const uint32_t *t = a;
+        a = b;
+        b = t;
+        size_t tn = n;
+        n = m;
+        m = tn;
+    }
+    if (m == 0)
+        return n;
+    if (m > 64)
+        return edit_distance_dp(a, n, b, m);
+
+    uint32_t keys[64];
+    uint64_t peq[64];
+    size_t n_keys = 0;
+    for (size_t j = 0; j < m; j++) {
+        size_t k = 0;
+        while (k < n_keys && keys[k] != b[j])
+            k++;
+        if (k == n_keys) {
+            keys[n_keys]  = b[j];
+            peq[n_keys++] = 0;
+        }
+        peq[k] |= 1ull << j;
+    }
+
+    uint64_t pv = ~0ull, mv = 0, last = 1ull << (m - 1);
+    size_t score = m;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t eq = 0;
+        for (size_t k = 0; k < n_keys; k++) {
+            if (keys[k] == a[i]) {
+                eq = peq[k];
+                break;
+            }
+        }
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+        if (ph & last)
+            score++;
+        else if (mh & last)
+            score--;
+        ph = (ph << 1) | 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+    }
+    return score;
+}
+
+/* ---- per-frame evaluation ---- */
+
+typedef struct {
+    double   iou;
+    uint32_t p, g;
+} Candidate;
+
+typedef struct {
+    Pred      *preds;      size_t cap_preds;
+    Pred      *sorted;     size_t cap_sorted;
+    Box       *boxes;      size_t cap_boxes;
+    Box       *gt_boxes;   size_t cap_gt_boxes;
+    Candidate *cands;      size_t cap_cands;
+    uint8_t   *used;       size_t cap_used;
+    uint32_t  *pairs;      size_t cap_pairs;
+    uint32_t  *car_pairs;  size_t cap_car_pairs;
+    size_t    *assoc;      size_t cap_assoc;
+    uint32_t  *cp_a;       size_t cap_cp_a;
+    uint32_t  *cp_b;       size_t cap_cp_b;
+} Scratch;
+
+typedef struct {
+    uint32_t car_tp, car_fp, car_fn;
+    uint32_t plate_tp, plate_fp, plate_fn;
+    uint32_t lpr_exact, lpr_total;
+    double   cer_sum;
+    int      evaluated;
+} FrameResult;
+
+typedef struct {
+    const Coco        *coco;
+    const Predictions *preds;
+    DetEvalOptions     opt;
+    FrameResult       *results;
+    size_t             next;
+} Eval;
+
+static void scratch_free(Scratch *s)
+{
+    free(s->preds);
+    free(s->sorted);
+    free(s->boxes);
+    free(s->gt_boxes);
+    free(s->cands);
+    free(s->used);
+    free(s->pairs);
+    free(s->car_pairs);
+    free(s->assoc);
+    free(s->cp_a);
+    free(s->cp_b);
+}
+
+/* bbox_iou() of two xywh boxes, operation for operation. */
+static double box_iou(const Box *a, const Box *b)
+{
+    double ax1 = a->x, ay1 = a->y, ax2 = a->x + a->w, ay2 = a->y + a->h;
+    double bx1 = b->x, by1 = b->y, bx2 = b->x + b->w, by2 = b->y + b->h;
+    double ix1 = bx1 > ax1 ? bx1 : ax1, iy1 = by1 > ay1 ? by1 : ay1;
+    double ix2 = bx2 < ax2 ? bx2 : ax2, iy2 = by2 < ay2 ? by2 : ay2;
+    if (ix2 <= ix1 || iy2 <= iy1)
+        return 0.0;
+    double inter = (ix2 - ix1) * (iy2 - iy1);
+    double uni   = (ax2 - ax1) * (ay2 - ay1) + (bx2 - bx1) * (by2 - by1) - inter;
+    return uni > 0 ? inter / uni : 0.0;
+}
+
+/* Descending IoU; ties keep (pred, gt) order, as the script's stable sort does. */
+static int cmp_candidate(const void *a, const void *b)
+{
+    const Candidate *x = a, *y = b;
+    if (x->iou > y->iou)
+        return -1;
+    if (x->iou < y->iou)
+        return 1;
+    if (x->p != y->p)
+        return x->p < y->p ? -1 : 1;
+    return (x->g > y->g) - (x->g < y->g);
+}
+
+/* match_pred_to_gt(): pairs (pred, gt) into pairs, two entries each, in match order; returns how many. */
+static size_t match_boxes(Scratch *s, const Box *pred, size_t np, const Box *gt, size_t ng,
+                          double threshold, uint32_t *pairs)
+{
+    if (np == 0 || ng == 0)
+        return 0;
+    reserve(&s->cands, &s->cap_cands, np * ng, sizeof(Candidate));
+    size_t n = 0;
+    for (size_t p = 0; p < np; p++) {
+        for (size_t g = 0; g < ng; g++) {
+            double iou = box_iou(&pred[p], &gt[g]);
+            if (iou >= threshold)
+                s->cands[n++] = (Candidate){ iou, (uint32_t)p, (uint32_t)g };
+        }
+    }
+    qsort(s->cands, n, sizeof(Candidate), cmp_candidate);
+
+    reserve(&s->used, &s->cap_used, np + ng, 1);
+    memset(s->used, 0, np + ng);
+    uint8_t *used_p = s->used, *used_g = s->used + np;
+    size_t n_pairs = 0;
+    for (size_t i = 0; i < n; i++) {
+        const Candidate *c = &s->cands[i];
+        if (used_p[c->p] || used_g[c->g])
+            continue;
+        used_p[c->p] = used_g[c->g] = 1;
+        pairs[2 * n_pairs]     = c->p;
+        pairs[2 * n_pairs + 1] = c->g;
+        n_pairs++;
+    }
+    return n_pairs;
+}
+
+/* associate_plates_to_cars(): per car, the first unclaimed plate centred in it, or SIZE_MAX. */
+static void associate(const GtImage *gt, size_t *assoc, uint8_t *used)
+{
+    if (gt->n_plates)
+        memset(used, 0, gt->n_plates);
+    for (size_t c = 0; c < gt->n_cars; c++) {
+        const Box *car = &gt->cars[c];
+        assoc[c] = SIZE_MAX;
+        for (size_t p = 0; p < gt->n_plates; p++) {
+            if (used[p])
+                continue;
+            const Box *pl = &gt->plates[p].box;
+            double px = pl->x + pl->w / 2, py = pl->y + pl->h / 2;
+            if (car->x <= px && px <= car->x + car->w && car->y <= py && py <= car->y + car->h) {
+                assoc[c] = p;
+                used[p]  = 1;
+                break;
+            }
+        }
+    }
+}
+
+/* normalize_plate_text() as code points: "" for "" and "-", else upper-cased, whitespace collapsed. */
+static size_t normalize_text(const char *s, size_t len, uint32_t **buf, size_t *cap)
+{
+    if (len == 0 || (len == 1 && s[0] == '-'))
+        return 0;
+    reserve(buf, cap, len, sizeof(uint32_t));
+    const char *p = s, *end = s + len;
+    size_t n = 0;
+    int gap = 0;
+    while (p < end) {
+        uint32_t c = next_cp(&p, end);
+        if (is_space(c)) {
+            gap = n > 0;
+            continue;
+        }
+        if (gap)
+            (*buf)[n++] = ' ';
+        gap = 0;
+        (*buf)[n++] = to_upper(c);
+    }
+    return n;
+}
+
+/* Appends the detections of one frame_NNNNNN.txt to s->preds; mapping stays for their texts. */
+static size_t load_frame_file(const char *dir, int64_t frame, Scratch *s, Mapping *m)
+{
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/frame_%06lld.txt", dir, (long long)frame);
+    if (map_file(path, m) != 0)
+        return 0;
+    const char *p = m->data, *end = m->data + m->size;
+    size_t n = 0;
+    while (p < end) {
+        const char *line = p;
+        const char *stop = next_line(&p, end);
+        Span t[LINE_TOKENS];
+        Pred d;
+        if (parse_detection(t, split_line(line, stop, t, LINE_TOKENS), &d) != 0)
+            continue;
+        reserve(&s->preds, &s->cap_preds, n + 1, sizeof(Pred));
+        s->preds[n++] = d;
+    }
+    return n;
+}
+
+/* Into s->sorted, cars then plates, each in file order; returns the total, *n_cars of them cars. */
+static size_t gather_preds(const Eval *ev, int64_t frame, Scratch *s, Mapping *m, size_t *n_cars)
+{
+    const Predictions *pr = ev->preds;
+    size_t n = 0;
+    if (pr->per_frame) {
+        n = load_frame_file(pr->dir, frame, s, m);
+    } else {
+        size_t lo = 0, hi = pr->n_blocks;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (pr->blocks[mid].frame < frame)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        for (size_t b = lo; b < pr->n_blocks && pr->blocks[b].frame == frame; b++) {
+            reserve(&s->preds, &s->cap_preds, n + pr->blocks[b].count, sizeof(Pred));
+            memcpy(s->preds + n, pr->blocks[b].preds, pr->blocks[b].count * sizeof(Pred));
+            n += pr->blocks[b].count;
+        }
+    }
+
+    reserve(&s->sorted, &s->cap_sorted, n, sizeof(Pred));
+    size_t c = 0;
+    for (size_t i = 0; i < n; i++)
+        if (!s->preds[i].is_plate)
+            s->sorted[c++] = s->preds[i];
+    *n_cars = c;
+    for (size_t i = 0; i < n; i++)
+        if (s->preds[i].is_plate)
+            s->sorted[c++] = s->preds[i];
+    return n;
+}
+
+/* _evaluate_frame() */
+static void eval_image(const Eval *ev, const CocoImage *img, Scratch *s, FrameResult *r)
+{
+    if (img->frame_state == FRAME_NONE)
+        return;
+    r->evaluated = 1;
+    const GtImage *gt = &ev->coco->gt[img->gt];
+    double sx = gt->width / ev->opt.det_width, sy = gt->height / ev->opt.det_height;
+
+    Mapping m = { 0 };
+    size_t n = 0, n_cars = 0;
+    int64_t frame;
+    if (img->frame_state == FRAME_OK && !__builtin_add_overflow(img->frame, ev->opt.frame_offset, &frame))
+        n = gather_preds(ev, frame, s, &m, &n_cars);
+    size_t n_plates = n - n_cars;
+
+    reserve(&s->boxes, &s->cap_boxes, n, sizeof(Box));
+    for (size_t i = 0; i < n; i++) {
+        const Pred *d = &s->sorted[i];
+        s->boxes[i] = (Box){ d->left * sx, d->top * sy, d->width * sx, d->height * sy };
+    }
+    reserve(&s->gt_boxes, &s->cap_gt_boxes, gt->n_plates, sizeof(Box));
+    for (size_t i = 0; i < gt->n_plates; i++)
+        s->gt_boxes[i] = gt->plates[i].box;
+
+    size_t most = n_cars < gt->n_cars ? n_cars : gt->n_cars;
+    reserve(&s->car_pairs, &s->cap_car_pairs, 2 * most, sizeof(uint32_t));
+    size_t car_tp = match_boxes(s, s->boxes, n_cars, gt->cars, gt->n_cars,
+                                ev->opt.iou_threshold, s->car_pairs);
+    most = n_plates < gt->n_plates ? n_plates : gt->n_plates;
+    reserve(&s->pairs, &s->cap_pairs, 2 * most, sizeof(uint32_t));
+    size_t plate_tp = match_boxes(s, s->boxes + n_cars, n_plates, s->gt_boxes, gt->n_plates,
+                                  ev->opt.iou_threshold, s->pairs);
+    r->car_tp   = (uint32_t)car_tp;
+    r->car_fp   = (uint32_t)(n_cars - car_tp);
+    r->car_fn   = (uint32_t)(gt->n_cars - car_tp);
+    r->plate_tp = (uint32_t)plate_tp;
+    r->plate_fp = (uint32_t)(n_plates - plate_tp);
+    r->plate_fn = (uint32_t)(gt->n_plates - plate_tp);
+
+    reserve(&s->assoc, &s->cap_assoc, gt->n_cars, sizeof(size_t));
+    reserve(&s->used, &s->cap_used, gt->n_plates, 1);
+    associate(gt, s->assoc, s->used);
+    for (size_t i = 0; i < car_tp; i++) {
+        size_t plate = s->assoc[s->car_pairs[2 * i + 1]];
+        if (plate == SIZE_MAX || !gt->plates[plate].text)
+            continue;
+        const Pred *d = &s->sorted[s->car_pairs[2 * i]];
+        size_t pn = normalize_text(d->text, d->text_len, &s->cp_a, &s->cap_cp_a);
+        size_t gn = normalize_text(gt->plates[plate].text, gt->plates[plate].text_len,
+                                   &s->cp_b, &s->cap_cp_b);
+        r->lpr_total++;
+        if (pn == gn && (gn == 0 || memcmp(s->cp_a, s->cp_b, gn * sizeof(uint32_t)) == 0))
+            r->lpr_exact++;
+        if (gn == 0)
+            r->cer_sum += pn == 0 ? 0.0 : 1.0;
+        else
+            r->cer_sum += (double)deteval_edit_distance(s->cp_a, pn, s->cp_b, gn) / (double)gn;
+    }
+    unmap_file(&m);
+}
+
+static void *eval_worker(void *arg)
+{
+    Eval *ev = arg;
+    Scratch s = { 0 };
+    size_t n = ev->coco->n_images;
+    for (;;) {
+        size_t first = __atomic_fetch_add(&ev->next, IMAGES_PER_CLAIM, __ATOMIC_RELAXED);
+        if (first >= n)
+            break;
+        size_t last = first + IMAGES_PER_CLAIM < n ? first + IMAGES_PER_CLAIM : n;
+        for (size_t i = first; i < last; i++)
+            eval_image(ev, &ev->coco->images[i], &s, &ev->results[i]);
+    }
+    scratch_free(&s);
+    return NULL;
+}
+
+/* ---- public ---- */
+
+void deteval_options_init(DetEvalOptions *options)
+{
+    *options = (DetEvalOptions){
+        .frame_offset  = 1,
+        .source_id     = 0,
+        .det_width     = 1920,
+        .det_height    = 1080,
+        .iou_threshold = 0.5,
+        .threads       = 0,
+    };
+}
+
+int deteval_run(const char *coco_path, const char *detections_dir,
+                const DetEvalOptions *options, DetEvalResult *out,
+                char *err, size_t err_len)
+{
+    struct stat st;
+    if (options->det_width <= 0 || options->det_height <= 0)
+        return fail(err, err_len, "detection width and height must be positive");
+    if (stat(coco_path, &st) != 0)
+        return fail(err, err_len, "COCO file not found: %s", coco_path);
+    if (stat(detections_dir, &st) != 0)
+        return fail(err, err_len, "Detections dir not found: %s", detections_dir);
+
+    Eval ev = { .opt = *options };
+    if (ev.opt.threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        ev.opt.threads = cpus > 0 ? (unsigned)cpus : 1;
+    }
+
+    Coco coco = { 0 };
+    if (coco_load(&coco, coco_path, err, err_len) != 0) {
+        coco_clear(&coco);
+        return -1;
+    }
+
+    Predictions preds = { .dir = detections_dir };
+    char log_path[4096];
+    snprintf(log_path, sizeof(log_path), "%s/%s", detections_dir, DETECTION_LOG_NAME);
+    if (stat(log_path, &st) != 0) {
+        preds.per_frame = 1;
+    } else if (map_file(log_path, &preds.log) != 0) {
+        coco_clear(&coco);
+        return fail(err, err_len, "%s: %s", log_path, strerror(errno));
+    } else {
+        predictions_load_log(&preds, options->source_id, ev.opt.threads);
+    }
+
+    ev.coco    = &coco;
+    ev.preds   = &preds;
+    ev.results = xcalloc(coco.n_images, sizeof(FrameResult));
+    unsigned workers = ev.opt.threads;
+    if (workers > coco.n_images / IMAGES_PER_CLAIM + 1)
+        workers = (unsigned)(coco.n_images / IMAGES_PER_CLAIM + 1);
+    pthread_t *tids = xcalloc(workers, sizeof(pthread_t));
+    unsigned started = 0;
+    for (unsigned i = 1; i < workers; i++, started++)
+        if (pthread_create(&tids[i], NULL, eval_worker, &ev) != 0)
+            break;
+    eval_worker(&ev);
+    for (unsigned i = 1; i <= started; i++)
+        pthread_join(tids[i], NULL);
+    free(tids);
+
+    /* Summed in image order, so the float sum is the script's. */
+    memset(out, 0, sizeof(*out));
+    for (size_t i = 0; i < coco.n_images; i++) {
+        const FrameResult *r = &ev.results[i];
+        if (!r->evaluated)
+            continue;
+        out->car.tp     += r->car_tp;
+        out->car.fp     += r->car_fp;
+        out->car.fn     += r->car_fn;
+        out->plate.tp   += r->plate_tp;
+        out->plate.fp   += r->plate_fp;
+        out->plate.fn   += r->plate_fn;
+        out->lpr_exact  += r->lpr_exact;
+        out->lpr_total  += r->lpr_total;
+        out->lpr_cer_sum += r->cer_sum;
+        out->frames++;
+    }
+    free(ev.results);
+    predictions_clear(&preds);
+    coco_clear(&coco);
+    return 0;
+}
+
+/* ---- summary ---- */
+
+static double safe_div(double num, double den)
+{
+    return den > 0 ? num / den : 0.0;
+}
+
+typedef struct {
+    double precision, recall, f1;
+} DetRates;
+
+static DetRates det_rates(const DetEvalCounts *c)
+{
+    DetRates r;
+    r.precision = safe_div((double)c->tp, (double)(c->tp + c->fp));
+    r.recall    = safe_div((double)c->tp, (double)(c->tp + c->fn));
+    r.f1        = safe_div(2 * r.precision * r.recall, r.precision + r.recall);
+    return r;
+}
+
+/* repr(round(x, 4)) */
+static const char *rate_str(double x, char *buf, size_t len)
+{
+    snprintf(buf, len, "%.4f", x);
+    char *dot = strchr(buf, '.');
+    if (dot) {
+        char *e = buf + strlen(buf) - 1;
+        while (e > dot + 1 && *e == '0')
+            *e-- = '\0';
+    }
+    return buf;
+}
+
+static void write_det_json(const char *key, const DetEvalCounts *c, int last, FILE *out)
+{
+    DetRates r = det_rates(c);
+    char a[64], b[64], d[64];
+    fprintf(out,
+            "  \"%s\": {\n"
+            "    \"mAP@0.5\": %s,\n"
+            "    \"precision\": %s,\n"
+            "    \"recall\": %s,\n"
+            "    \"f1\": %s,\n"
+            "    \"TP\": %llu,\n"
+            "    \"FP\": %llu,\n"
+            "    \"FN\": %llu\n"
+            "  }%s\n",
+            key, rate_str(r.precision, a, sizeof(a)), a, rate_str(r.recall, b, sizeof(b)),
+            rate_str(r.f1, d, sizeof(d)), (unsigned long long)c->tp, (unsigned long long)c->fp,
+            (unsigned long long)c->fn, last ? "" : ",");
+}
+
+void deteval_write_json(const DetEvalResult *result, FILE *out)
+{
+    char a[64], b[64];
+    fputs("{\n", out);
+    write_det_json("car_detection", &result->car, 0, out);
+    write_det_json("license_plate_detection", &result->plate, 0, out);
+    fprintf(out,
+            "  \"lpr\": {\n"
+            "    \"exact_match_rate\": %s,\n"
+            "    \"character_error_rate_mean\": %s,\n"
+            "    \"pairs_evaluated\": %llu\n"
+            "  }\n"
+            "}",
+            rate_str(safe_div((double)result->lpr_exact, (double)result->lpr_total), a, sizeof(a)),
+            rate_str(safe_div(result->lpr_cer_sum, (double)result->lpr_total), b, sizeof(b)),
+            (unsigned long long)result->lpr_total);
+}
+
+static void print_det(const char *title, const DetEvalCounts *c, FILE *out)
+{
+    DetRates r = det_rates(c);
+    char a[64];
+    fprintf(out, "## %s\n", title);
+    fprintf(out, "  mAP@0.5:   %s\n", rate_str(r.precision, a, sizeof(a)));
+    fprintf(out, "  Precision: %s\n", a);
+    fprintf(out, "  Recall:    %s\n", rate_str(r.recall, a, sizeof(a)));
+    fprintf(out, "  F1:        %s\n", rate_str(r.f1, a, sizeof(a)));
+    fprintf(out, "  TP/FP/FN:  %llu / %llu / %llu\n\n", (unsigned long long)c->tp,
+            (unsigned long long)c->fp, (unsigned long long)c->fn);
+}
+
+void deteval_print_summary(const DetEvalResult *result, FILE *out)
+{
+    char a[64];
+    print_det("Car detection (vs COCO car)", &result->car, out);
+    print_det("License plate detection (vs COCO license_plate)", &result->plate, out);
+    fputs("## LPR (plate text)\n", out);
+    fprintf(out, "  Exact match rate:  %s\n",
+            rate_str(safe_div((double)result->lpr_exact, (double)result->lpr_total), a, sizeof(a)));
+    fprintf(out, "  CER (mean):        %s\n",
+            rate_str(safe_div(result->lpr_cer_sum, (double)result->lpr_total), a, sizeof(a)));
+    fprintf(out, "  Pairs evaluated:   %llu\n", (unsigned long long)result->lpr_total);
+}
@@ -0,0 +1,289 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "detection_log.h"
+#include "detection_log_format.h"
+#include "logger.h"
+
+#define DETLOG_ALIGN 8u
+
+struct DetectionLog {
+    gchar      *dir;
+    guint64     segment_bytes;
+    guint       segment_index;
+    gchar      *path;
+    int         fd;
+    guint64     offset;    /* bytes already written to the current segment */
+    guint       pending;   /* frames in batch */
+    guint64     lost;      /* frames dropped by write errors, or with no segment open */
+
+    GByteArray *batch;     /* encoded blocks not yet written */
+    GByteArray *scratch;   /* strings interned by the frame being encoded */
+    GHashTable *strings;   /* text -> segment offset, reset per segment */
+    GArray     *index;     /* DetLogIndexEntry for the current segment */
+};
+
+/* FALSE (logged) when not all of data reached the file. */
+static gboolean write_all(DetectionLog *log, const guint8 *data, gsize len)
+{
+    while (len > 0) {
+        ssize_t n = write(log->fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            log_error("detection_log: write to %s failed: %s",
+                      log->path, strerror(errno));
+            return FALSE;
+        }
+        data        += n;
+        len         -= (gsize)n;
+        log->offset += (guint64)n;
+    }
+    return TRUE;
+}
+
+/*
+ * After a failed write: cuts the segment back to good, the end of the last
+ * batch written whole, so it reads like a segment left by a crash (removed
+ * when nothing is left), and closes it.  The batch's frames are lost.
+ */
+static void cut_segment(DetectionLog *log, guint64 good)
+{
+    if (good == 0 || ftruncate(log->fd, (off_t)good) != 0)
+        unlink(log->path);
+    close(log->fd);
+    log->fd = -1;
+    log_warning("detection_log: %s cut back to %" G_GUINT64_FORMAT " bytes, %u frames lost",
+                log->path, good, log->pending);
+    log->lost   += log->pending;
+    log->pending = 0;
+    g_byte_array_set_size(log->batch, 0);
+}
+
+static void append_block(GByteArray *out, guint32 type, guint32 source_id,
+                         guint32 count, gint64 frame_num,
+                         const guint8 *payload, guint32 length)
+{
+    DetLogBlockHeader hdr = {
+        .type      = type,
+        .length    = length,
+        .source_id = source_id,
+        .count     = count,
+        .frame_num = frame_num,
+    };
+    g_byte_array_append(out, (const guint8 *)&hdr, sizeof(hdr));
+    g_byte_array_append(out, payload, length);
+}
+
+/* Deletes the segments of an earlier run so output_dir holds this one only. */
+static void remove_old_segments(const gchar *dir)
+{
+    GDir *d = g_dir_open(dir, 0, NULL);
+    if (!d)
+        return;
+
+    guint removed = 0;
+    const gchar *name;
+    while ((name = g_dir_read_name(d)) != NULL) {
+        guint idx;
+        if (!g_str_has_suffix(name, ".tgdl") || sscanf(name, "detections_%u", &idx) != 1)
+            continue;
+        gchar *path = g_build_filename(dir, name, NULL);
+        if (unlink(path) == 0)
+            removed++;
+        else
+            log_warning("detection_log: cannot remove %s: %s", path, strerror(errno));
+        g_free(path);
+    }
+    g_dir_close(d);
+    if (removed)
+        log_info("detection_log: removed %u segments of an earlier run from %s", removed, dir);
+}
+
+static void open_segment(DetectionLog *log, guint segment_index)
+{
+    gchar *name = g_strdup_printf(DETLOG_SEGMENT_PATTERN, segment_index);
+    g_free(log->path);
+    log->path          = g_build_filename(log->dir, name, NULL);
+    log->segment_index = segment_index;
+    log->offset        = 0;
+    g_free(name);
+
+    g_hash_table_remove_all(log->strings);
+    g_array_set_size(log->index, 0);
+
+    log->fd = open(log->path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (log->fd < 0) {
+        log_error("detection_log: cannot open %s: %s", log->path, strerror(errno));
+        return;
+    }
+
+    DetLogFileHeader hdr = {
+        .magic         = DETLOG_MAGIC,
+        .version       = DETLOG_VERSION,
+        .header_size   = sizeof(DetLogFileHeader),
+        .segment_index = segment_index,
+    };
+    g_byte_array_append(log->batch, (const guint8 *)&hdr, sizeof(hdr));
+}
+
+/* Writes the frame index and trailer, then closes the segment. */
+static void seal_segment(DetectionLog *log)
+{
+    if (log->fd < 0)
+        return;
+
+    DetLogTrailer trailer = {
+        .index_offset = log->offset + log->batch->len,
+        .index_count  = log->index->len,
+        .magic        = DETLOG_TRAILER_MAGIC,
+    };
+    append_block(log->batch, DETLOG_BLOCK_INDEX, 0, log->index->len, 0,
+                 (const guint8 *)log->index->data,
+                 log->index->len * (guint32)sizeof(DetLogIndexEntry));
+    g_byte_array_append(log->batch, (const guint8 *)&trailer, sizeof(trailer));
+
+    guint64 good = log->offset;
+    if (!write_all(log, log->batch->data, log->batch->len)) {
+        cut_segment(log, good);
+        return;
+    }
+    g_byte_array_set_size(log->batch, 0);
+    log->pending = 0;
+    close(log->fd);
+    log->fd = -1;
+}
+
+DetectionLog *detection_log_new(const char *output_dir, guint64 segment_bytes)
+{
+    DetectionLog *log = g_new0(DetectionLog, 1);
+    log->dir           = g_strdup(output_dir);
+    log->segment_bytes = MAX(segment_bytes, (guint64)(1u << 16));
+    log->fd            = -1;
+    log->batch         = g_byte_array_sized_new(1u << 20);
+    log->scratch       = g_byte_array_new();
+    log->strings       = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    log->index         = g_array_new(FALSE, FALSE, sizeof(DetLogIndexEntry));
+
+    remove_old_segments(output_dir);
+    open_segment(log, 0);
+    if (log->fd < 0) {
+        detection_log_free(log);
+        return NULL;
+    }
+    return log;
+}
+
+void detection_log_free(DetectionLog *log)
+{
+    if (!log)
+        return;
+    seal_segment(log);
+    if (log->lost)
+        log_warning("detection_log: %" G_GUINT64_FORMAT " frames lost to write errors in %s",
+                    log->lost, log->dir);
+    g_byte_array_unref(log->batch);
+    g_byte_array_unref(log->scratch);
+    g_hash_table_destroy(log->strings);
+    g_array_unref(log->index);
+    g_free(log->path);
+    g_free(log->dir);
+    g_free(log);
+}
+
+/* Offset the text will have in the segment, adding it to scratch when new. */
+static guint32 intern_text(DetectionLog *log, const gchar *text,
+                           guint64 strings_payload_offset)
+{
+    if (!text[0] || (text[0] == '-' && !text[1]))
+        return DETLOG_NO_TEXT;
+
+    gpointer found;
+    if (g_hash_table_lookup_extended(log->strings, text, NULL, &found))
+        return GPOINTER_TO_UINT(found);
+
+    guint32 offset = (guint32)(strings_payload_offset + log->scratch->len);
+    g_byte_array_append(log->scratch, (const guint8 *)text, (guint)strlen(text) + 1);
+    g_hash_table_insert(log->strings, g_strdup(text), GUINT_TO_POINTER(offset));
+    return offset;
+}
+
+void detection_log_append(DetectionLog *log, const DetectionFrame *frame)
+{
+    if (log->fd >= 0 && log->offset + log->batch->len >= log->segment_bytes)
+        detection_log_sync(log);
+    if (log->fd < 0) {
+        log->lost++;
+        return;
+    }
+
+    DetLogRecord records[DETECTION_MAX_RECORDS_PER_FRAME];
+    guint64 strings_payload = log->offset + log->batch->len + sizeof(DetLogBlockHeader);
+    guint   n_strings_before = g_hash_table_size(log->strings);
+
+    g_byte_array_set_size(log->scratch, 0);
+    for (guint i = 0; i < frame->n_records; i++) {
+        const DetectionRecord *src = &frame->records[i];
+        DetLogRecord *dst = &records[i];
+        dst->left         = src->left;
+        dst->top          = src->top;
+        dst->width        = src->width;
+        dst->height       = src->height;
+        dst->object_id    = src->object_id;
+        dst->component_id = src->component_id;
+        dst->kind         = src->kind == DETECTION_KIND_PLATE ? DETLOG_KIND_PLATE
+                                                              : DETLOG_KIND_CAR;
+        dst->text_offset  = intern_text(log, src->text, strings_payload);
+    }
+
+    if (log->scratch->len > 0) {
+        static const guint8 zeros[DETLOG_ALIGN] = { 0 };
+        guint pad = (DETLOG_ALIGN - log->scratch->len % DETLOG_ALIGN) % DETLOG_ALIGN;
+        g_byte_array_append(log->scratch, zeros, pad);
+        append_block(log->batch, DETLOG_BLOCK_STRINGS, 0,
+                     g_hash_table_size(log->strings) - n_strings_before, 0,
+                     log->scratch->data, log->scratch->len);
+    }
+
+    DetLogIndexEntry entry = {
+        .frame_num = frame->frame_num,
+        .source_id = frame->source_id,
+        .n_records = frame->n_records,
+        .offset    = log->offset + log->batch->len,
+    };
+    g_array_append_val(log->index, entry);
+
+    append_block(log->batch, DETLOG_BLOCK_FRAME, frame->source_id,
+                 frame->n_records, frame->frame_num, (const guint8 *)records,
+                 frame->n_records * (guint32)sizeof(DetLogRecord));
+    log->pending++;
+}
+
+void detection_log_sync(DetectionLog *log)
+{
+    if (log->fd < 0)
+        return;
+    if (log->batch->len > 0) {
+        guint64 good = log->offset;
+        if (!write_all(log, log->batch->data, log->batch->len)) {
+            /* Offsets in index and strings assumed the batch landed; start clean. */
+            cut_segment(log, good);
+            open_segment(log, log->segment_index + 1);
+            return;
+        }
+        g_byte_array_set_size(log->batch, 0);
+        log->pending = 0;
+    }
+    if (log->offset >= log->segment_bytes) {
+        seal_segment(log);
+        open_segment(log, log->segment_index + 1);
+    }
+}
+
+guint64 detection_log_get_lost(const DetectionLog *log)
+{
+    return log->lost;
+}
@@ -0,0 +1,250 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "detection_log_reader.h"
+
+struct DetLogSegment {
+    const uint8_t    *base;
+    size_t            size;
+    uint32_t          segment_index;
+    int               sealed;
+    /* Points into the mapping for sealed segments, heap-allocated when rebuilt. */
+    const DetLogIndexEntry *index;
+    DetLogIndexEntry *owned_index;
+    size_t            n_frames;
+    int               sorted;   /* index ordered by (frame_num, source_id) */
+};
+
+static int entry_before(const DetLogIndexEntry *a, int64_t frame_num,
+                        uint32_t source_id)
+{
+    return a->frame_num < frame_num ||
+           (a->frame_num == frame_num && a->source_id < source_id);
+}
+
+static int load_trailer_index(DetLogSegment *seg)
+{
+    if (seg->size < sizeof(DetLogFileHeader) + sizeof(DetLogTrailer))
+        return -1;
+
+    DetLogTrailer trailer;
+    memcpy(&trailer, seg->base + seg->size - sizeof(trailer), sizeof(trailer));
+    if (trailer.magic != DETLOG_TRAILER_MAGIC)
+        return -1;
+
+    uint64_t entries = trailer.index_offset + sizeof(DetLogBlockHeader);
+    uint64_t end     = entries + (uint64_t)trailer.index_count * sizeof(DetLogIndexEntry);
+    if (trailer.index_offset % 8 != 0 || end > seg->size - sizeof(trailer))
+        return -1;
+
+    const DetLogBlockHeader *hdr =
+        (const DetLogBlockHeader *)(seg->base + trailer.index_offset);
+    if (hdr->type != DETLOG_BLOCK_INDEX || hdr->count != trailer.index_count)
+        return -1;
+
+    seg->index    = (const DetLogIndexEntry *)(seg->base + entries);
+    seg->n_frames = trailer.index_count;
+    seg->sealed   = 1;
+    return 0;
+}
+
+/* Unsealed segment: walk the blocks, stopping at the first torn one. */
+static int rebuild_index(DetLogSegment *seg)
+{
+    size_t cap = 256, n = 0;
+    DetLogIndexEntry *idx = malloc(cap * sizeof(*idx));
+    if (!idx)
+        return -1;
+
+    size_t pos = sizeof(DetLogFileHeader);
+    while (pos + sizeof(DetLogBlockHeader) <= seg->size) {
+        const DetLogBlockHeader *hdr = (const DetLogBlockHeader *)(seg->base + pos);
+        size_t end = pos + sizeof(*hdr) + hdr->length;
+        if (hdr->length % 8 != 0 || end > seg->size)
+            break;
+        if (hdr->type == DETLOG_BLOCK_FRAME) {
+            if ((uint64_t)hdr->count * sizeof(DetLogRecord) > hdr->length)
+                break;
+            if (n == cap) {
+                cap *= 2;
+                DetLogIndexEntry *grown = realloc(idx, cap * sizeof(*idx));
+                if (!grown) {
+                    free(idx);
+                    return -1;
+                }
+                idx = grown;
+            }
+            idx[n].frame_num = hdr->frame_num;
+            idx[n].source_id = hdr->source_id;
+            idx[n].n_records = hdr->count;
+            idx[n].offset    = pos;
+            n++;
+        } else if (hdr->type != DETLOG_BLOCK_STRINGS) {
+            break;
+        }
+        pos = end;
+    }
+
+    seg->owned_index = idx;
+    seg->index       = idx;
+    seg->n_frames    = n;
+    return 0;
+}
+
+DetLogSegment *detlog_segment_open(const char *path)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(DetLogFileHeader)) {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return NULL;
+
+    const DetLogFileHeader *hdr = map;
+    if (hdr->magic != DETLOG_MAGIC || hdr->version != DETLOG_VERSION ||
+        hdr->header_size != sizeof(DetLogFileHeader)) {
+        munmap(map, (size_t)st.st_size);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    DetLogSegment *seg = calloc(1, sizeof(*seg));
+    if (!seg) {
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+    seg->base          = map;
+    seg->size          = (size_t)st.st_size;
+    seg->segment_index = hdr->segment_index;
+
+    if (load_trailer_index(seg) != 0 && rebuild_index(seg) != 0) {
+        detlog_segment_close(seg);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    seg->sorted = 1;
+    for (size_t i = 1; i < seg->n_frames && seg->sorted; i++) {
+        const DetLogIndexEntry *cur = &seg->index[i];
+        if (entry_before(cur, seg->index[i - 1].frame_num, seg->index[i - 1].source_id))
+            seg->sorted = 0;
+    }
+    return seg;
+}
+
+void detlog_segment_close(DetLogSegment *segment)
+{
+    if (!segment)
+        return;
+    munmap((void *)segment->base, segment->size);
+    free(segment->owned_index);
+    free(segment);
+}
+
+int detlog_segment_is_sealed(const DetLogSegment *segment)
+{
+    return segment->sealed;
+}
+
+uint32_t detlog_segment_index(const DetLogSegment *segment)
+{
+    return segment->segment_index;
+}
+
+size_t detlog_segment_frame_count(const DetLogSegment *segment)
+{
+    return segment->n_frames;
+}
+
+int detlog_segment_frame_at(const DetLogSegment *segment, size_t i,
+                            DetLogFrame *out)
+{
+    if (i >= segment->n_frames)
+        return -1;
+
+    const DetLogIndexEntry *entry = &segment->index[i];
+    if (entry->offset + sizeof(DetLogBlockHeader) +
+        (uint64_t)entry->n_records * sizeof(DetLogRecord) > segment->size)
+        return -1;
+
+    out->frame_num = entry->frame_num;
+    out->source_id = entry->source_id;
+    out->n_records = entry->n_records;
+    out->records   = (const DetLogRecord *)(segment->base + entry->offset +
+                                            sizeof(DetLogBlockHeader));
+    return 0;
+}
+
+int detlog_segment_find_frame(const DetLogSegment *segment,
+                              int64_t frame_num, uint32_t source_id,
+                              DetLogFrame *out)
+{
+    if (segment->sorted) {
+        size_t lo = 0, hi = segment->n_frames;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (entry_before(&segment->index[mid], frame_num, source_id))
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (lo < segment->n_frames &&
+            segment->index[lo].frame_num == frame_num &&
+            segment->index[lo].source_id == source_id)
+            return detlog_segment_frame_at(segment, lo, out);
+        return -1;
+    }
+
+    for (size_t i = 0; i < segment->n_frames; i++) {
+        if (segment->index[i].frame_num == frame_num &&
+            segment->index[i].source_id == source_id)
+            return detlog_segment_frame_at(segment, i, out);
+    }
+    return -1;
+}
+
+const char *detlog_record_text(const DetLogSegment *segment,
+                               const DetLogRecord *record)
+{
+    uint32_t off = record->text_offset;
+    if (off == DETLOG_NO_TEXT || off >= segment->size)
+        return "-";
+    const char *text = (const char *)segment->base + off;
+    if (!memchr(text, '\0', segment->size - off))
+        return "-";
+    return text;
+}
+
+void detlog_write_legacy_lines(const DetLogSegment *segment,
+                               const DetLogFrame *frame, FILE *out)
+{
+    /* Legacy dumps list every car before every plate. */
+    for (uint16_t kind = DETLOG_KIND_CAR; kind <= DETLOG_KIND_PLATE; kind++) {
+        for (uint32_t i = 0; i < frame->n_records; i++) {
+            const DetLogRecord *rec = &frame->records[i];
+            if (rec->kind != kind)
+                continue;
+            fprintf(out, "%s %.6g %.6g %.6g %.6g %s\n",
+                    kind == DETLOG_KIND_PLATE ? "plate" : "car",
+                    (double)rec->left,
+                    (double)rec->top,
+                    (double)rec->width,
+                    (double)rec->height,
+                    detlog_record_text(segment, rec));
+        }
+    }
+}
@@ -0,0 +1,471 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#include "detection_writer.h"
+#include "detection_log.h"
+#include "spsc_ring.h"
+#include "logger.h"
+
+#define DETECTION_LOG_FILENAME "detections.txt"
+#define WRITE_BATCH_BYTES      (1u << 20)
+/* Upper bound of one formatted record line: kind, four %.6g floats, text. */
+#define MAX_RECORD_LINE_BYTES  (DETECTION_TEXT_MAX + 80)
+#define MAX_FRAME_TEXT_BYTES   (64 + DETECTION_MAX_RECORDS_PER_FRAME * MAX_RECORD_LINE_BYTES)
+
+struct DetectionWriter {
+    SpscRing   *ring;
+    guint       high_watermark;
+    guint       flush_interval_ms;
+    int         fd;         /* text format */
+    DetectionLog *log;      /* binary format */
+    gchar      *path;
+    gboolean    binary;
+    guint64     segment_bytes;
+
+    /* From detection_writer_set_output_dir, protected by lock; the writer thread switches to them. */
+    gboolean    next_ready;
+    int         next_fd;
+    DetectionLog *next_log;
+    gchar      *next_path;
+
+    /* Writer-thread only.  Two buffers so formatting overlaps an in-flight io_uring write. */
+    gchar      *buf[2];
+    guint       cur;
+    gsize       len;
+#ifdef HAVE_LIBURING
+    struct io_uring uring;
+    gboolean    uring_ready;
+    gsize       inflight_len;
+    off_t       offset;
+#endif
+
+    GThread    *thread;
+    GMutex      lock;
+    GCond       wake;
+    GCond       drained;
+    gboolean    stopping;     /* protected by lock */
+    guint64     flush_seq;    /* protected by lock */
+    guint64     flushed_seq;  /* protected by lock */
+
+    atomic_bool     kick;
+    atomic_uint_least64_t written;
+    atomic_uint_least64_t dropped;
+    atomic_uint_least64_t records_cut;
+};
+
+static void write_all(DetectionWriter *writer, const gchar *data, gsize len,
+                      off_t offset)
+{
+    while (len > 0) {
+#ifdef HAVE_LIBURING
+        ssize_t n = pwrite(writer->fd, data, len, offset);
+#else
+        (void)offset;
+        ssize_t n = write(writer->fd, data, len);
+#endif
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            log_error("detection_writer: write to %s failed: %s",
+                      writer->path, strerror(errno));
+            return;
+        }
+        data   += n;
+        len    -= (gsize)n;
+        offset += n;
+    }
+}
+
+#ifdef HAVE_LIBURING
+static void wait_inflight(DetectionWriter *writer)
+{
+    if (writer->inflight_len == 0)
+        return;
+
+    struct io_uring_cqe *cqe = NULL;
+    int rc = io_uring_wait_cqe(&writer->uring, &cqe);
+    gsize len = writer->inflight_len;
+    writer->inflight_len = 0;
+    if (rc < 0) {
+        log_error("detection_writer: io_uring wait failed: %s", strerror(-rc));
+        return;
+    }
+
+    int res = cqe->res;
+    io_uring_cqe_seen(&writer->uring, cqe);
+    if (res < 0) {
+        log_error("detection_writer: write to %s failed: %s",
+                  writer->path, strerror(-res));
+        return;
+    }
+    /* Short write: finish the tail synchronously from the buffer just submitted. */
+    if ((gsize)res < len) {
+        const gchar *inflight = writer->buf[writer->cur ^ 1];
+        write_all(writer, inflight + res, len - (gsize)res,
+                  writer->offset - (off_t)(len - (gsize)res));
+    }
+}
+
+static void submit_batch(DetectionWriter *writer)
+{
+    if (writer->len == 0)
+        return;
+
+    wait_inflight(writer);
+
+    struct io_uring_sqe *sqe = io_uring_get_sqe(&writer->uring);
+    if (!sqe) {
+        write_all(writer, writer->buf[writer->cur], writer->len, writer->offset);
+        writer->offset += (off_t)writer->len;
+        writer->len = 0;
+        return;
+    }
+    io_uring_prep_write(sqe, writer->fd, writer->buf[writer->cur],
+                        (unsigned)writer->len, (__u64)writer->offset);
+    io_uring_submit(&writer->uring);
+
+    writer->offset      += (off_t)writer->len;
+    writer->inflight_len = writer->len;
+    writer->cur         ^= 1;
+    writer->len          = 0;
+}
+#else
+static void submit_batch(DetectionWriter *writer)
+{
+    if (writer->len == 0)
+        return;
+    write_all(writer, writer->buf[writer->cur], writer->len, 0);
+    writer->len = 0;
+}
+
+static void wait_inflight(DetectionWriter *writer)
+{
+    (void)writer;
+}
+#endif
+
+static gsize format_frame(gchar *out, gsize avail, const DetectionFrame *frame)
+{
+    static const char *const kind_names[] = { "car", "plate" };
+    gsize len = (gsize)g_snprintf(out, avail, "frame %" G_GINT64_FORMAT " %u\n",
+                                  frame->frame_num, frame->source_id);
+
+    for (guint i = 0; i < frame->n_records && len < avail; i++) {
+        const DetectionRecord *rec = &frame->records[i];
+        len += (gsize)g_snprintf(out + len, avail - len,
+                                 "%s %.6g %.6g %.6g %.6g %s\n",
+                                 kind_names[rec->kind == DETECTION_KIND_PLATE],
+                                 (double)rec->left,
+                                 (double)rec->top,
+                                 (double)rec->width,
+                                 (double)rec->height,
+                                 rec->text);
+    }
+    return MIN(len, avail);
+}
+
+/* Writer thread, once the frame is out. */
+static void count_frame(DetectionWriter *writer, const DetectionFrame *frame)
+{
+    atomic_fetch_add_explicit(&writer->written, 1, memory_order_relaxed);
+    if (frame->n_cut == 0)
+        return;
+    if (atomic_fetch_add_explicit(&writer->records_cut, frame->n_cut, memory_order_relaxed) == 0)
+        log_warning("detection_writer: frame %" G_GINT64_FORMAT " of source %u has %u records "
+                    "beyond the %d kept per frame; later cuts are only counted",
+                    frame->frame_num, frame->source_id, frame->n_cut, DETECTION_MAX_RECORDS_PER_FRAME);
+}
+
+static void drain(DetectionWriter *writer)
+{
+    const DetectionFrame *frame;
+
+    if (writer->log) {
+        while ((frame = spsc_ring_peek(writer->ring)) != NULL) {
+            detection_log_append(writer->log, frame);
+            count_frame(writer, frame);
+            spsc_ring_release(writer->ring);
+        }
+        detection_log_sync(writer->log);
+        return;
+    }
+
+    while ((frame = spsc_ring_peek(writer->ring)) != NULL) {
+        if (writer->len + MAX_FRAME_TEXT_BYTES > WRITE_BATCH_BYTES)
+            submit_batch(writer);
+        writer->len += format_frame(writer->buf[writer->cur] + writer->len,
+                                    WRITE_BATCH_BYTES - writer->len, frame);
+        count_frame(writer, frame);
+        spsc_ring_release(writer->ring);
+    }
+    submit_batch(writer);
+    wait_inflight(writer);
+}
+
+/*
+ * Opens output_dir for the format, binary when binary; FALSE (logged) on I/O
+ * failure.  detections.txt is truncated so the file holds one run only.
+ */
+static gboolean open_output(const char *output_dir, gboolean binary, guint64 segment_bytes,
+                            int *fd, DetectionLog **log, gchar **path)
+{
+    *fd  = -1;
+    *log = NULL;
+    if (binary) {
+        *log = detection_log_new(output_dir, segment_bytes);
+        if (!*log)
+            return FALSE;
+        *path = g_strdup(output_dir);
+        return TRUE;
+    }
+    *path = g_build_filename(output_dir, DETECTION_LOG_FILENAME, NULL);
+#ifdef HAVE_LIBURING
+    *fd = open(*path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+#else
+    *fd = open(*path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+#endif
+    if (*fd < 0) {
+        log_error("detection_writer: cannot open %s: %s", *path, strerror(errno));
+        g_clear_pointer(path, g_free);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static void close_output(int fd, DetectionLog *log)
+{
+    if (fd >= 0)
+        close(fd);
+    detection_log_free(log);
+}
+
+/* Writer thread, between drains: what was queued so far went to the old output. */
+static void switch_output(DetectionWriter *writer)
+{
+    g_mutex_lock(&writer->lock);
+    if (!writer->next_ready) {
+        g_mutex_unlock(&writer->lock);
+        return;
+    }
+    int           fd   = writer->next_fd;
+    DetectionLog *log  = writer->next_log;
+    gchar        *path = writer->next_path;
+    writer->next_ready = FALSE;
+    writer->next_fd    = -1;
+    writer->next_log   = NULL;
+    writer->next_path  = NULL;
+    g_mutex_unlock(&writer->lock);
+
+    close_output(writer->fd, writer->log);
+    g_free(writer->path);
+    writer->fd   = fd;
+    writer->log  = log;
+    writer->path = path;
+#ifdef HAVE_LIBURING
+    writer->offset = 0;
+#endif
+    log_info("detection_writer: writing to %s", path);
+}
+
+static gpointer writer_thread(gpointer data)
+{
+    DetectionWriter *writer = (DetectionWriter *)data;
+
+    g_mutex_lock(&writer->lock);
+    for (;;) {
+        gint64 deadline = g_get_monotonic_time() +
+                          (gint64)writer->flush_interval_ms * 1000;
+        while (!writer->stopping &&
+               !atomic_load_explicit(&writer->kick, memory_order_relaxed) &&
+               writer->flush_seq == writer->flushed_seq) {
+            if (!g_cond_wait_until(&writer->wake, &writer->lock, deadline))
+                break;
+        }
+        gboolean stopping = writer->stopping;
+        guint64  seq      = writer->flush_seq;
+        atomic_store_explicit(&writer->kick, FALSE, memory_order_relaxed);
+        g_mutex_unlock(&writer->lock);
+
+        drain(writer);
+        switch_output(writer);
+
+        g_mutex_lock(&writer->lock);
+        writer->flushed_seq = seq;
+        g_cond_broadcast(&writer->drained);
+        if (stopping)
+            break;
+    }
+    g_mutex_unlock(&writer->lock);
+    return NULL;
+}
+
+DetectionWriter *detection_writer_new(const char                   *output_dir,
+                                      const DetectionWriterOptions *options)
+{
+    gchar *path = NULL;
+    int fd = -1;
+    DetectionLog *log = NULL;
+    if (!open_output(output_dir, options->format == DETECTION_FORMAT_BINARY, options->segment_bytes,
+                     &fd, &log, &path))
+        return NULL;
+
+    DetectionWriter *writer = g_new0(DetectionWriter, 1);
+    writer->fd                = fd;
+    writer->log               = log;
+    writer->path              = path;
+    writer->binary            = options->format == DETECTION_FORMAT_BINARY;
+    writer->segment_bytes     = options->segment_bytes;
+    writer->next_fd           = -1;
+    writer->ring              = spsc_ring_new(MAX(options->queue_frames, 2u),
+                                              sizeof(DetectionFrame));
+    writer->high_watermark    = spsc_ring_capacity(writer->ring) / 2;
+    writer->flush_interval_ms = MAX(options->flush_interval_ms, 1u);
+    writer->buf[0]            = g_malloc(WRITE_BATCH_BYTES);
+    writer->buf[1]            = g_malloc(WRITE_BATCH_BYTES);
+    atomic_init(&writer->kick, FALSE);
+    atomic_init(&writer->written, 0);
+    atomic_init(&writer->dropped, 0);
+    atomic_init(&writer->records_cut, 0);
+    g_mutex_init(&writer->lock);
+    g_cond_init(&writer->wake);
+    g_cond_init(&writer->drained);
+
+#ifdef HAVE_LIBURING
+    if (fd >= 0) {
+        writer->offset = 0;
+        int rc = io_uring_queue_init(4, &writer->uring, 0);
+        if (rc < 0) {
+            log_error("detection_writer: io_uring setup failed: %s", strerror(-rc));
+            detection_writer_free(writer);
+            return NULL;
+        }
+        writer->uring_ready = TRUE;
+    }
+#endif
+
+    writer->thread = g_thread_new("detection-writer", writer_thread, writer);
+    return writer;
+}
+
+void detection_writer_free(DetectionWriter *writer)
+{
+    if (!writer)
+        return;
+
+    if (writer->thread) {
+        g_mutex_lock(&writer->lock);
+        writer->stopping = TRUE;
+        g_cond_signal(&writer->wake);
+        g_mutex_unlock(&writer->lock);
+        g_thread_join(writer->thread);
+    }
+#ifdef HAVE_LIBURING
+    if (writer->uring_ready)
+        io_uring_queue_exit(&writer->uring);
+#endif
+
+    guint64 written = atomic_load(&writer->written);
+    guint64 dropped = atomic_load(&writer->dropped);
+    guint64 cut     = atomic_load(&writer->records_cut);
+    if (cut > 0)
+        log_warning("detection_writer: %" G_GUINT64_FORMAT " records cut, beyond %d per frame",
+                    cut, DETECTION_MAX_RECORDS_PER_FRAME);
+    if (dropped > 0)
+        log_warning("detection_writer: %" G_GUINT64_FORMAT " frames written to %s, "
+                    "%" G_GUINT64_FORMAT " dropped (queue full)",
+                    written, writer->path, dropped);
+    else
+        log_info("detection_writer: %" G_GUINT64_FORMAT " frames written to %s",
+                 written, writer->path);
+
+    close_output(writer->fd, writer->log);
+    close_output(writer->next_fd, writer->next_log);
+    spsc_ring_free(writer->ring);
+    g_mutex_clear(&writer->lock);
+    g_cond_clear(&writer->wake);
+    g_cond_clear(&writer->drained);
+    g_free(writer->buf[0]);
+    g_free(writer->buf[1]);
+    g_free(writer->path);
+    g_free(writer->next_path);
+    g_free(writer);
+}
+
+DetectionFrame *detection_writer_begin_frame(DetectionWriter *writer)
+{
+    DetectionFrame *frame = spsc_ring_reserve(writer->ring);
+    if (!frame) {
+        atomic_fetch_add_explicit(&writer->dropped, 1, memory_order_relaxed);
+        return NULL;
+    }
+    frame->n_records = 0;
+    frame->n_cut     = 0;
+    return frame;
+}
+
+void detection_writer_commit_frame(DetectionWriter *writer)
+{
+    spsc_ring_commit(writer->ring);
+
+    /* Wake the writer early only when the ring is filling up; the lock is off the common path. */
+    if (spsc_ring_count(writer->ring) >= writer->high_watermark &&
+        !atomic_exchange_explicit(&writer->kick, TRUE, memory_order_relaxed)) {
+        g_mutex_lock(&writer->lock);
+        g_cond_signal(&writer->wake);
+        g_mutex_unlock(&writer->lock);
+    }
+}
+
+void detection_writer_flush(DetectionWriter *writer)
+{
+    g_mutex_lock(&writer->lock);
+    guint64 seq = ++writer->flush_seq;
+    g_cond_signal(&writer->wake);
+    while (writer->flushed_seq < seq)
+        g_cond_wait(&writer->drained, &writer->lock);
+    g_mutex_unlock(&writer->lock);
+}
+
+guint64 detection_writer_get_written(DetectionWriter *writer)
+{
+    return atomic_load_explicit(&writer->written, memory_order_relaxed);
+}
+
+guint64 detection_writer_get_dropped(DetectionWriter *writer)
+{
+    return atomic_load_explicit(&writer->dropped, memory_order_relaxed);
+}
+
+gboolean detection_writer_set_output_dir(DetectionWriter *writer, const char *output_dir)
+{
+    if (g_mkdir_with_parents(output_dir, 0755) != 0) {
+        log_error("detection_writer: cannot create %s: %s", output_dir, strerror(errno));
+        return FALSE;
+    }
+    int fd;
+    DetectionLog *log;
+    gchar *path;
+    if (!open_output(output_dir, writer->binary, writer->segment_bytes, &fd, &log, &path))
+        return FALSE;
+
+    g_mutex_lock(&writer->lock);
+    if (writer->next_ready) {
+        close_output(writer->next_fd, writer->next_log);
+        g_free(writer->next_path);
+    }
+    writer->next_ready = TRUE;
+    writer->next_fd    = fd;
+    writer->next_log   = log;
+    writer->next_path  = path;
+    atomic_store_explicit(&writer->kick, TRUE, memory_order_relaxed);
+    g_cond_signal(&writer->wake);
+    g_mutex_unlock(&writer->lock);
+    return TRUE;
+}
@@ -3,85 +3,539 @@
 #include "director.h"
 #include "pipeline_builder.h"
 #include "pipeline_linker.h"
+#include "pipeline_config.h"
 #include "probe_base.h"
 #include "probes/probe_send.h"
 #include "probes/probe_detections.h"
 #include "probes/probe_tracker_match.h"
 #include "probes/probe_drop.h"
+#include "probes/probe_consensus.h"
+#include "probes/probe_metrics.h"
+#include "probes/probe_load_shed.h"
+#include "probes/probe_msg_shed.h"
+#include "probes/probe_publish.h"
+#include "detection_writer.h"
+#include "meta_stage.h"
+#include "plate_assoc.h"
+#include "msg_pool.h"
+#include "track_state.h"
+#include "track_consensus.h"
+#include "metrics.h"
+#include "load_shedder.h"
+#include "msg_shed.h"
+#include "event_spool.h"
+#include "broker_link.h"
+#include "mqtt_publisher.h"
+#include "payload_encoder.h"
+#include "run_report.h"
+#include "buffer_trace.h"
+#include "config_reload.h"
 #include "config.h"
 #include "logger.h"
 
+/* Largest blob with MSG_AGGREGATE, 0 without; *window_ms is 0 for a blob per frame. */
+static guint blob_bytes(const AppSettings *settings, guint *window_ms)
+{
+    *window_ms = 0;
+    if (g_strcmp0(settings->msg_aggregate, "window") == 0)
+        *window_ms = settings->msg_aggregate_window_ms;
+    else if (g_strcmp0(settings->msg_aggregate, "frame") != 0)
+        return 0;
+    return MAX(settings->msg_aggregate_max_bytes, MSG_POOL_PAYLOAD_BYTES);
+}
+
+/* Slots of slot_bytes that take the memory n slots of default_bytes would, at least 64. */
+static guint same_memory(guint n, gsize default_bytes, gsize slot_bytes)
+{
+    return (guint)MAX((guint64)n * default_bytes / slot_bytes, 64);
+}
+
+/* To the msgbroker conn-str ("host;port") and topic. */
+static MqttPublisher *new_mqtt_publisher(const AppSettings *settings, const BrokerLinkOptions *link_options,
+                                         const PayloadEncoder *encoder, guint event_bytes)
+{
+    gchar **conn = g_strsplit(link_options->conn_str, ";", 3);
+    MqttPublisherOptions options = {
+        .host         = conn[0],
+        .port         = conn[0] && conn[1] ? (guint)g_ascii_strtoull(conn[1], NULL, 10) : 0,
+        .topic        = link_options->topic,
+        .qos          = settings->mqtt_qos,
+        .keepalive_s  = 60,
+        .queue_events = settings->mqtt_queue_events,
+        .event_bytes  = event_bytes,
+        .batch_bytes  = settings->mqtt_batch_bytes,
+        .batch_ms     = settings->mqtt_batch_ms,
+        .max_inflight = settings->mqtt_max_inflight,
+        .compression  = g_strcmp0(settings->mqtt_compress, "deflate") == 0
+                            ? MQTT_COMPRESSION_DEFLATE : MQTT_COMPRESSION_NONE,
+        .framing      = encoder->binary ? MQTT_FRAMING_LENGTH : MQTT_FRAMING_NEWLINE,
+    };
+    if (!options.port)
+        options.port = 1883;
+    if (event_bytes)
+        options.queue_events = same_memory(options.queue_events, MQTT_PUBLISHER_EVENT_BYTES, event_bytes);
+
+    MqttPublisher *publisher = mqtt_publisher_new(&options);
+    g_strfreev(conn);
+    return publisher;
+}
+
+static gboolean spool_link_connect(gpointer link)
+{
+    return broker_link_connect((BrokerLink *)link);
+}
+
+static gboolean spool_link_send(const guint8 *payload, gsize len, gpointer link)
+{
+    return broker_link_send((BrokerLink *)link, payload, len);
+}
+
+static gboolean spool_publisher_connect(gpointer publisher)
+{
+    return mqtt_publisher_connected((MqttPublisher *)publisher);
+}
+
+static gboolean spool_publisher_send(const guint8 *payload, gsize len, gpointer publisher)
+{
+    return mqtt_publisher_replay((MqttPublisher *)publisher, payload, len);
+}
+
+static gboolean spill_to_spool(const void *event, gsize len, gpointer spool)
+{
+    return event_spool_spill((EventSpool *)spool, event, len);
+}
+
+/*
+ * Journal under JOURNAL_DIR; NULL when off or unavailable.  Replayed through
+ * publisher, which the spool then owns and which spills into it, or without
+ * one over a BrokerLink of its own.
+ */
+static EventSpool *attach_event_spool(PipelineBuilder *builder, const AppSettings *settings,
+                                      const BrokerLinkOptions *link_options, MqttPublisher *publisher)
+{
+    const gchar *dir = settings->journal_dir;
+    if (!dir[0])
+        return NULL;
+
+    EventSpoolConnectFunc connect = spool_publisher_connect;
+    EventSpoolSendFunc    send    = spool_publisher_send;
+    gpointer              target  = publisher;
+    GDestroyNotify        destroy = (GDestroyNotify)mqtt_publisher_free;
+    if (!publisher) {
+        target = broker_link_new(link_options);
+        if (!target) {
+            log_warning("director: no broker link, journal off");
+            return NULL;
+        }
+        connect = spool_link_connect;
+        send    = spool_link_send;
+        destroy = (GDestroyNotify)broker_link_free;
+    }
+
+    EventJournalOptions journal_options = {
+        .segment_bytes = (guint64)settings->journal_segment_mb << 20,
+        .quota_bytes   = (guint64)settings->journal_quota_mb << 20,
+    };
+    EventJournal *journal = event_journal_open(dir, &journal_options);
+    if (!journal) {
+        if (!publisher)
+            destroy(target);
+        return NULL;
+    }
+    EventSpoolOptions spool_options = {
+        .replay_rate = settings->journal_replay_rate,
+        .retry_ms    = 1000,
+        .sync_ms     = 1000,
+    };
+    EventSpool *spool = event_spool_new(journal, &spool_options, connect, send, target, destroy);
+    if (publisher)
+        mqtt_publisher_set_spill(publisher, spill_to_spool, spool);
+    g_object_set_data_full(G_OBJECT(pipeline_builder_get_pipeline(builder)),
+                           "event-spool", spool, (GDestroyNotify)event_spool_free);
+    return spool;
+}
+
+/* Wires a LoadShedder to the graph entry, the shed SGIEs, every queue and the broker sink. */
+static gboolean attach_load_shedder(PipelineBuilder *builder, const AppSettings *settings)
+{
+    LoadControlOptions options = {
+        .high_latency_ms = settings->load_high_latency_ms,
+        .low_latency_ms  = settings->load_low_latency_ms,
+        .high_queue_fill = settings->load_high_queue_pct / 100.0,
+        .low_queue_fill  = settings->load_low_queue_pct / 100.0,
+        .up_samples      = settings->load_up_samples,
+        .down_samples    = settings->load_down_samples,
+        .smoothing       = 0.3,
+        .max_level       = settings->load_max_level,
+    };
+    LoadShedder *shedder = load_shedder_new(&options);
+    g_object_set_data_full(G_OBJECT(pipeline_builder_get_pipeline(builder)),
+                           "load-shedder", shedder, (GDestroyNotify)load_shedder_free);
+
+    const GieGraph *graph = pipeline_builder_get_gie_graph(builder);
+    guint n_gates = 0;
+    for (guint i = 0; i < graph->n_nodes; i++) {
+        GstElement *elem = pipeline_builder_get_element(builder, graph->nodes[i].name);
+        if (!elem)
+            continue;
+        LoadShedGate *gate = NULL;
+        if (i == 0)
+            load_shedder_set_pgie(shedder, elem);
+        else
+            gate = load_shedder_gate(shedder, elem);
+        /* Hiding edits the batch meta; after a fan-out each branch has its own copy. */
+        if (gate) {
+            probe_base_add_buffer_probe(elem, "sink", probe_load_shed_hide,    gate);
+            probe_base_add_buffer_probe(elem, "src",  probe_load_shed_restore, gate);
+            n_gates++;
+        }
+        gst_object_unref(elem);
+
+        guint succs[GIE_GRAPH_MAX_NODES];
+        guint n_succ = gie_graph_successors(graph, i, succs);
+        for (guint k = 0; n_succ > 1 && k < n_succ; k++) {
+            gchar name[64];
+            g_snprintf(name, sizeof(name), GIE_GRAPH_QUEUE_FMT, graph->nodes[i].name, k);
+            GstElement *queue = pipeline_builder_get_element(builder, name);
+            if (queue) {
+                load_shedder_add_queue(shedder, queue);
+                gst_object_unref(queue);
+            }
+        }
+    }
+
+    GstElement *queue1    = pipeline_builder_get_element(builder, "queue1");
+    GstElement *queue2    = pipeline_builder_get_element(builder, "queue2");
+    GstElement *msgbroker = pipeline_builder_get_element(builder, "msg-broker");
+    gboolean ok = queue1 && msgbroker;
+    if (ok) {
+        /* A leaky broker queue decouples the broker: its stalls are not the GIEs' to shed. */
+        gint leaky = 0;
+        g_object_get(G_OBJECT(queue1), "leaky", &leaky, NULL);
+        gboolean broker_decoupled = leaky != 0;
+        if (!broker_decoupled)
+            load_shedder_add_queue(shedder, queue1);
+        /* None headless. */
+        if (queue2)
+            load_shedder_add_queue(shedder, queue2);
+        ok = probe_base_add_buffer_probe(broker_decoupled ? queue1 : msgbroker, "sink",
+                                         probe_load_shed_latency, shedder);
+    } else {
+        log_error("director: could not retrieve elements for load control");
+    }
+    if (queue1)    gst_object_unref(queue1);
+    if (queue2)    gst_object_unref(queue2);
+    if (msgbroker) gst_object_unref(msgbroker);
+
+    if (ok)
+        log_info("director: load control on, %u SGIE gates, latency %u..%u ms",
+                 n_gates, settings->load_low_latency_ms, settings->load_high_latency_ms);
+    return ok;
+}
+
 GstElement *director_build(const char *config_path)
 {
-    PipelineBuilder *builder = pipeline_builder_new(config_path);
+    /* Read and checked whole before the first element, so a bad file or setting costs no element setup. */
+    PipelineConfig *config = pipeline_config_load(config_path);
+    if (!config)
+        return NULL;
+    const AppSettings *settings = &config->settings;
+
+    PipelineBuilderOptions builder_options = {
+        .backend   = g_strcmp0(settings->pipeline_backend, "software") == 0
+                         ? PIPELINE_BACKEND_SOFTWARE : PIPELINE_BACKEND_DEEPSTREAM,
+        .synthetic = {
+            .objects_per_frame = settings->fake_infer_objects,
+            .plate_ratio       = settings->fake_infer_plate_pct / 100.0,
+            .label_cardinality = 16,
+            .seed              = settings->fake_infer_seed,
+        },
+        .headless  = settings->headless != 0,
+    };
+    if (builder_options.backend == PIPELINE_BACKEND_SOFTWARE)
+        log_info("director: software backend, %u synthetic objects per frame",
+                 builder_options.synthetic.objects_per_frame);
+    gboolean native = g_strcmp0(settings->msg_publisher, "native") == 0;
+
+    PipelineBuilder *builder = pipeline_builder_new(config, &builder_options);
     if (!builder) {
         log_error("director: failed to create PipelineBuilder");
+        pipeline_config_free(config);
         return NULL;
     }
 
-    if (!pipeline_builder_add_source(builder))     goto fail;
-    if (!pipeline_builder_add_h264parser(builder)) goto fail;
-    if (!pipeline_builder_add_decoder(builder))    goto fail;
+    if (!pipeline_builder_add_sources(builder))    goto fail;
     if (!pipeline_builder_add_streamux(builder))   goto fail;
-    if (!pipeline_builder_add_infer(builder, "primary-inference",     "primary-gie"))   goto fail;
-    if (!pipeline_builder_add_infer(builder, "secondary-inference-1", "secondary-gie1")) goto fail;
-    if (!pipeline_builder_add_infer(builder, "secondary-inference-2", "secondary-gie2")) goto fail;
-    if (!pipeline_builder_add_infer(builder, "secondary-inference-3", "secondary-gie3")) goto fail;
-    if (!pipeline_builder_add_infer(builder, "secondary-inference-4", "secondary-gie4")) goto fail;
-    if (!pipeline_builder_add_tracker(builder))    goto fail;
+    if (!pipeline_builder_add_gie_graph(builder))  goto fail;
     if (!pipeline_builder_add_nvvidconv(builder))  goto fail;
     if (!pipeline_builder_add_nvosd(builder))      goto fail;
-    if (!pipeline_builder_add_tee(builder))        goto fail;
-    if (!pipeline_builder_add_queue(builder, "queue1")) goto fail;
-    if (!pipeline_builder_add_queue(builder, "queue2")) goto fail;
-    if (!pipeline_builder_add_msgconv(builder))    goto fail;
-    if (!pipeline_builder_add_msgbroker(builder))  goto fail;
-    if (!pipeline_builder_add_sink(builder))       goto fail;
+    gboolean render = !builder_options.headless;
+    if (render && pipeline_builder_get_n_sources(builder) > 1 &&
+        !pipeline_builder_add_tiler(builder))      goto fail;
+    if (render && !pipeline_builder_add_tee(builder)) goto fail;
+    /* Bounded so a stalled broker or display never backpressures the tee into inference. */
+    if (!pipeline_builder_add_bounded_queue(builder, "queue1", settings->msg_queue_buffers,
+                                            settings->msg_queue_leaky))
+        goto fail;
+    if (render &&
+        !pipeline_builder_add_bounded_queue(builder, "queue2", settings->render_queue_buffers,
+                                            settings->render_queue_leaky))
+        goto fail;
+    if (native) {
+        if (!pipeline_builder_add_msg_sink(builder))  goto fail;
+    } else {
+        if (!pipeline_builder_add_msgconv(builder))   goto fail;
+        if (!pipeline_builder_add_msgbroker(builder)) goto fail;
+    }
+    if (render && !pipeline_builder_add_sink(builder)) goto fail;
 
     if (!pipeline_linker_link(builder)) {
         log_error("director: pipeline linking failed");
         goto fail;
     }
 
+    /* Probed first, so each element's time includes the probes attached to it below. */
+    if (builder_options.headless) {
+        g_object_set_data_full(G_OBJECT(pipeline_builder_get_pipeline(builder)), "run-report",
+                               run_report_new(pipeline_builder_get_pipeline(builder)),
+                               (GDestroyNotify)run_report_free);
+        log_info("director: headless, no OSD or render branch; run report at end of stream");
+    }
+    if (settings->trace_file[0])
+        g_object_set_data_full(G_OBJECT(pipeline_builder_get_pipeline(builder)), "buffer-trace",
+                               buffer_trace_new(pipeline_builder_get_pipeline(builder), settings->trace_file,
+                                                settings->trace_max_events),
+                               (GDestroyNotify)buffer_trace_free);
+
+    /* Owned by the pipeline so the writer drains and stops when the bin is finalized. */
+    DetectionWriter *detection_writer = NULL;
     {
-        const gchar *dir = config_get_detection_output_dir();
-        if (dir && dir[0]) {
+        const gchar *dir = config->runtime.detection_output_dir;
+        if (dir[0]) {
             if (g_mkdir_with_parents(dir, 0755) != 0)
                 log_warning("director: could not create detection output dir %s", dir);
+            else {
+                DetectionWriterOptions options = {
+                    .format            = g_strcmp0(settings->detection_output_format, "binary") == 0
+                                             ? DETECTION_FORMAT_BINARY : DETECTION_FORMAT_TEXT,
+                    .queue_frames      = settings->detection_queue_frames,
+                    .flush_interval_ms = settings->detection_flush_interval_ms,
+                    .segment_bytes     = (guint64)settings->detection_segment_mb << 20,
+                };
+                detection_writer = detection_writer_new(dir, &options);
+            }
         }
+        if (detection_writer)
+            g_object_set_data_full(G_OBJECT(pipeline_builder_get_pipeline(builder)),
+                                   "detection-writer", detection_writer,
+                                   (GDestroyNotify)detection_writer_free);
+    }
+
+    PlateAssocOptions assoc_options = {
+        .score      = PLATE_ASSOC_SCORE_CONTAINMENT,
+        .min_score  = 0.5f,
+        .use_parent = TRUE,
+        .one_to_one = settings->plate_assoc_one_to_one != 0,
+    };
+    if (g_strcmp0(settings->plate_assoc_score, "iou") == 0) {
+        assoc_options.score     = PLATE_ASSOC_SCORE_IOU;
+        assoc_options.min_score = 0.0f;
+    }
+    PlateAssoc *plate_assoc = plate_assoc_new(&assoc_options);
+    g_object_set_data_full(G_OBJECT(pipeline_builder_get_pipeline(builder)),
+                           "plate-assoc", plate_assoc, (GDestroyNotify)plate_assoc_free);
+
+    /* Messages still queued downstream keep the pool alive past the pipeline.
+     * Blobs take bigger blocks, as many as fit in the same memory. */
+    guint blob_window_ms;
+    guint max_blob = blob_bytes(settings, &blob_window_ms);
+    /* nvmsgconv takes messages only on batches, and none is left for the blob open at EOS. */
+    if (blob_window_ms && !native) {
+        log_warning("director: MSG_AGGREGATE=window needs MSG_PUBLISHER=native, sending a blob per frame");
+        blob_window_ms = 0;
+    }
+    MsgPool *msg_pool = max_blob
+        ? msg_pool_new_full(same_memory(settings->msg_pool_blocks, MSG_POOL_PAYLOAD_BYTES, max_blob), max_blob)
+        : msg_pool_new(settings->msg_pool_blocks);
+    g_object_set_data_full(G_OBJECT(pipeline_builder_get_pipeline(builder)),
+                           "msg-pool", msg_pool, (GDestroyNotify)msg_pool_free);
+
+    ProbeSendContext *send_ctx = g_new0(ProbeSendContext, 1);
+    send_ctx->pool     = msg_pool;
+    send_ctx->encoder  = payload_encoder_lookup(settings->payload_format);
+    send_ctx->messages = metrics_counter("traffic_guard_messages_attached_total",
+                                         "Broker messages attached by probe_send.",
+                                         NULL, NULL, TRUE);
+    if (max_blob) {
+        send_ctx->blob           = payload_blob_new(send_ctx->encoder, max_blob);
+        send_ctx->blob_window_ms = blob_window_ms;
+        g_object_set_data_full(G_OBJECT(pipeline_builder_get_pipeline(builder)),
+                               "payload-blob", send_ctx->blob, (GDestroyNotify)payload_blob_free);
     }
+    if (settings->track_events) {
+        TrackStateOptions track_options = {
+            .max_tracks        = settings->track_max,
+            .heartbeat_frames  = (guint)config->runtime.track_heartbeat_frames,
+            .lost_after_frames = (guint)config->runtime.track_lost_frames,
+        };
+        send_ctx->tracks = track_state_new(&track_options);
+        g_object_set_data_full(G_OBJECT(pipeline_builder_get_pipeline(builder)),
+                               "track-state", send_ctx->tracks, (GDestroyNotify)track_state_free);
+    }
+    if (settings->consensus) {
+        TrackConsensusOptions consensus_options = {
+            .max_tracks     = settings->track_max,
+            .ttl_frames     = settings->track_lost_frames,
+            .min_votes      = settings->consensus_min_votes,
+            .min_share      = settings->consensus_min_share_pct / 100.0f,
+            .recheck_frames = settings->consensus_recheck_frames,
+            .require_plate  = TRUE,
+        };
+        send_ctx->consensus = track_consensus_new(&consensus_options);
+        g_object_set_data_full(G_OBJECT(pipeline_builder_get_pipeline(builder)),
+                               "track-consensus", send_ctx->consensus,
+                               (GDestroyNotify)track_consensus_free);
+    }
+    g_object_set_data_full(G_OBJECT(pipeline_builder_get_pipeline(builder)),
+                           "send-context", send_ctx, g_free);
+
+    /* The spool, when there is one, owns the publisher: it replays through it and takes its spills. */
+    MqttPublisher *publisher = NULL;
+    if (native && !(publisher = new_mqtt_publisher(settings, &config->msgbroker.link, send_ctx->encoder, max_blob)))
+        goto fail;
+    EventSpool *spool = attach_event_spool(builder, settings, &config->msgbroker.link, publisher);
+    if (publisher && !spool)
+        g_object_set_data_full(G_OBJECT(pipeline_builder_get_pipeline(builder)),
+                               "mqtt-publisher", publisher, (GDestroyNotify)mqtt_publisher_free);
+
+    /* Consumers on nvosd sink share one walk of the object list per frame. */
+    MetaStage *meta_stage = meta_stage_new();
+    for (guint i = 0; i < RUNTIME_N_THRESHOLDS; i++)
+        meta_stage_set_min_prob(meta_stage, runtime_threshold_component(i), config->runtime.min_prob[i]);
+    if (send_ctx->consensus)
+        meta_stage_add_consumer(meta_stage, "consensus", probe_consensus_vote, send_ctx->consensus);
+    meta_stage_add_consumer(meta_stage, "send", probe_send, send_ctx);
+    if (detection_writer)
+        meta_stage_add_consumer(meta_stage, "detections", probe_write_detections, detection_writer);
+    g_object_set_data_full(G_OBJECT(pipeline_builder_get_pipeline(builder)),
+                           "meta-stage", meta_stage, (GDestroyNotify)meta_stage_free);
 
     {
         GstElement *nvosd     = pipeline_builder_get_element(builder, "on-screen-display");
         GstElement *nvvidconv = pipeline_builder_get_element(builder, "nvvideo-converter");
         GstElement *queue1    = pipeline_builder_get_element(builder, "queue1");
+        GstElement *msgbroker = pipeline_builder_get_element(builder, "msg-broker");
 
-        if (!nvosd || !nvvidconv || !queue1) {
+        if (!nvosd || !nvvidconv || !queue1 || !msgbroker) {
             log_error("director: could not retrieve elements for probe attachment");
             if (nvosd)     gst_object_unref(nvosd);
             if (nvvidconv) gst_object_unref(nvvidconv);
             if (queue1)    gst_object_unref(queue1);
+            if (msgbroker) gst_object_unref(msgbroker);
             goto fail;
         }
 
-        probe_base_add_buffer_probe(nvosd,     "sink", probe_send,              NULL);
-        probe_base_add_buffer_probe(nvosd,     "sink", probe_write_detections,  NULL);
-        probe_base_add_buffer_probe(nvvidconv, "sink", probe_match_tracker_ids, NULL);
-        probe_base_add_buffer_probe(queue1,    "sink", probe_drop_frame,        NULL);
+        probe_base_add_buffer_probe(nvosd,     "sink", meta_stage_probe,        meta_stage);
+        probe_base_add_buffer_probe(nvvidconv, "sink", probe_match_tracker_ids, plate_assoc);
+
+        MsgShedOptions shed_options = {
+            .low_pct    = settings->msg_shed_low_pct,
+            .normal_pct = settings->msg_shed_normal_pct,
+        };
+        MsgShed *msg_shed = msg_shed_new(queue1, &shed_options);
+        msg_shed_set_spool(msg_shed, spool);
+        g_object_set_data_full(G_OBJECT(pipeline_builder_get_pipeline(builder)),
+                               "msg-shed", msg_shed, (GDestroyNotify)msg_shed_free);
+        /* Shed first: batches it leaves without messages are dropped below. */
+        probe_base_add_buffer_probe(queue1,    "sink", probe_msg_shed,          msg_shed);
+        probe_base_add_buffer_probe(queue1,    "sink", probe_drop_frame,
+                                    metrics_counter("traffic_guard_frames_dropped_total",
+                                                    "Frames dropped before the broker branch.",
+                                                    NULL, NULL, TRUE));
+        if (publisher)
+            probe_base_add_buffer_probe(msgbroker, "sink", probe_publish, publisher);
+        if (publisher && send_ctx->blob_window_ms) {
+            ProbePublishEos *eos = g_new0(ProbePublishEos, 1);
+            eos->publisher = publisher;
+            eos->send      = send_ctx;
+            g_object_set_data_full(G_OBJECT(pipeline_builder_get_pipeline(builder)),
+                                   "publish-eos", eos, g_free);
+            probe_base_add_event_probe(msgbroker, "sink", probe_publish_eos, eos);
+        }
 
         gst_object_unref(nvosd);
         gst_object_unref(nvvidconv);
         gst_object_unref(queue1);
+        gst_object_unref(msgbroker);
+    }
+
+    /* Stable cars bypass the secondary GIEs after the tracker; their class_id is offset in between. */
+    if (send_ctx->consensus && settings->consensus_skip) {
+        const gchar *exit_name = gie_graph_exit_name(pipeline_builder_get_gie_graph(builder));
+        GstElement *tracker = pipeline_builder_get_element(builder, "tracker");
+        GstElement *exit    = pipeline_builder_get_element(builder, exit_name);
+
+        if (!tracker || !exit) {
+            log_warning("director: gie graph has no 'tracker' or '%s', consensus gating off", exit_name);
+        } else {
+            probe_base_add_buffer_probe(tracker, "src", probe_consensus_gate,    send_ctx->consensus);
+            probe_base_add_buffer_probe(exit,    "src", probe_consensus_restore, NULL);
+        }
+        if (tracker) gst_object_unref(tracker);
+        if (exit)    gst_object_unref(exit);
+    }
+
+    if (settings->load_control && !attach_load_shedder(builder, settings))
+        goto fail;
+
+    /* Starts from the runtime section and topic built above; later edits are applied to these. */
+    {
+        const GieGraph *graph = pipeline_builder_get_gie_graph(builder);
+        GstElement *pgie      = pipeline_builder_get_element(builder, graph->nodes[0].name);
+        GstElement *msgbroker = pipeline_builder_get_element(builder, "msg-broker");
+        ConfigReloadTargets targets = {
+            .pgie             = pgie,
+            .load_shedder     = g_object_get_data(G_OBJECT(pipeline_builder_get_pipeline(builder)),
+                                                  "load-shedder"),
+            .meta_stage       = meta_stage,
+            .send_ctx         = send_ctx,
+            .publisher        = publisher,
+            .msgbroker        = msgbroker,
+            .detection_writer = detection_writer,
+        };
+        ConfigReload *reload = config_reload_new(config, &targets);
+        if (pgie)      gst_object_unref(pgie);
+        if (msgbroker) gst_object_unref(msgbroker);
+        g_object_set_data_full(G_OBJECT(pipeline_builder_get_pipeline(builder)),
+                               "config-reload", reload, (GDestroyNotify)config_reload_free);
     }
 
+    if (settings->metrics_port) {
+        GstElement *muxer = pipeline_builder_get_element(builder, "muxer");
+        if (muxer) {
+            SourceFrameCounters *frame_counters = g_new0(SourceFrameCounters, 1);
+            g_object_set_data_full(G_OBJECT(pipeline_builder_get_pipeline(builder)),
+                                   "source-frame-counters", frame_counters, g_free);
+            probe_base_add_buffer_probe(muxer, "src", probe_count_source_frames, frame_counters);
+            gst_object_unref(muxer);
+        }
+    }
+
+    /* For the controller and main, which run past the config. */
+    AppSettings *kept = g_new(AppSettings, 1);
+    *kept = *settings;
+    g_object_set_data_full(G_OBJECT(pipeline_builder_get_pipeline(builder)), "settings", kept, g_free);
+
     GstElement *pipeline = pipeline_builder_get_pipeline(builder);
     gst_object_ref(pipeline);
     /* Caller holds the ref; pipeline_builder_free leaves the bin intact. */
     pipeline_builder_free(builder);
+    pipeline_config_free(config);
 
     return pipeline;
 
 fail:
     pipeline_builder_free(builder);
+    pipeline_config_free(config);
     return NULL;
 }
@@ -0,0 +1,43 @@
+#include "element_util.h"
+
+gboolean element_util_has_property(GstElement *element, const gchar *name)
+{
+    return element && g_object_class_find_property(G_OBJECT_GET_CLASS(element), name) != NULL;
+}
+
+GPtrArray *element_util_collect(GstIterator *it)
+{
+    GPtrArray *elements = g_ptr_array_new();
+    GValue item = G_VALUE_INIT;
+    GHashTable *seen = g_hash_table_new(g_direct_hash, g_direct_equal);   /* across resyncs */
+    gboolean done = FALSE;
+    while (!done) {
+        switch (gst_iterator_next(it, &item)) {
+        case GST_ITERATOR_OK: {
+            GstElement *element = GST_ELEMENT(g_value_get_object(&item));
+            if (g_hash_table_add(seen, element))
+                g_ptr_array_add(elements, element);
+            g_value_reset(&item);
+            break;
+        }
+        case GST_ITERATOR_RESYNC:
+            gst_iterator_resync(it);
+            break;
+        default:
+            done = TRUE;
+            break;
+        }
+    }
+    g_value_unset(&item);
+    gst_iterator_free(it);
+    g_hash_table_destroy(seen);
+    return elements;
+}
+
+void element_util_queue_level(GstElement *queue, const gchar *first_property, ...)
+{
+    va_list args;
+    va_start(args, first_property);
+    g_object_get_valist(G_OBJECT(queue), first_property, args);
+    va_end(args);
+}
@@ -0,0 +1,450 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+
+#include "event_journal.h"
+#include "logger.h"
+
+/*
+ * Segment layout (native little-endian, 8-byte aligned): a JournalHeader,
+ * then records back to back, each a RecordHeader followed by its payload
+ * padded to 8 bytes.  Segments are created zero-filled, so a zero magic ends
+ * the records.  A record counts once its magic, sequence and payload CRC all
+ * check out; sequences run on across segments.
+ */
+#define JOURNAL_MAGIC       0x4A454754u   /* "TGEJ" */
+#define RECORD_MAGIC        0x43455254u   /* "TREC" */
+#define CURSOR_MAGIC        0x52434754u   /* "TGCR" */
+#define JOURNAL_VERSION     1
+#define JOURNAL_ALIGN       8u
+#define JOURNAL_CURSOR_NAME "cursor"
+#define MIN_SEGMENT_BYTES   (64u << 10)
+
+typedef struct {
+    guint32 magic;
+    guint16 version;
+    guint16 header_size;
+    guint32 segment_index;
+    guint32 reserved;
+    guint64 first_seq;
+} JournalHeader;
+
+typedef struct {
+    guint32 magic;
+    guint32 length;     /* payload bytes, padding excluded */
+    guint32 crc;        /* CRC-32 of the payload */
+    guint32 reserved;
+    guint64 seq;
+} RecordHeader;
+
+typedef struct {
+    guint64 consumed_seq;
+    guint32 magic;
+    guint32 crc;        /* CRC-32 of consumed_seq */
+} JournalCursor;
+
+typedef struct {
+    guint    index;
+    gchar   *path;
+    guint8  *data;
+    gsize    size;
+    gsize    end;          /* bytes holding valid records */
+    gsize    read_offset;  /* first unconsumed record */
+    guint64  first_seq;
+    guint64  next_seq;     /* one past its last record */
+} Segment;
+
+struct EventJournal {
+    GMutex             lock;
+    gchar             *dir;
+    gchar             *cursor_path;
+    guint64            segment_bytes;
+    guint              max_segments;
+    GQueue             segments;      /* Segment *, oldest first */
+    guint64            next_seq;
+    guint64            consumed_seq;
+    guint64            synced_seq;
+    gboolean           full_logged;
+    EventJournalStats  stats;
+};
+
+static guint32 crc_table[256];
+
+static guint32 crc32(const void *data, gsize len)
+{
+    static gsize init = 0;
+    if (g_once_init_enter(&init)) {
+        for (guint32 i = 0; i < 256; i++) {
+            guint32 c = i;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            crc_table[i] = c;
+        }
+        g_once_init_leave(&init, 1);
+    }
+    const guint8 *p = data;
+    guint32 c = 0xFFFFFFFFu;
+    while (len--)
+        c = crc_table[(c ^ *p++) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+static gsize record_bytes(gsize len)
+{
+    return sizeof(RecordHeader) + ((len + JOURNAL_ALIGN - 1) & ~(gsize)(JOURNAL_ALIGN - 1));
+}
+
+static const RecordHeader *record_at(const Segment *seg, gsize offset)
+{
+    return (const RecordHeader *)(seg->data + offset);
+}
+
+/* size 0 maps an existing file whole; otherwise the file is created at that size. */
+static Segment *map_segment(const gchar *dir, guint index, gsize size)
+{
+    gchar *name = g_strdup_printf(EVENT_JOURNAL_SEGMENT_PATTERN, index);
+    Segment *seg = g_new0(Segment, 1);
+    seg->index = index;
+    seg->path  = g_build_filename(dir, name, NULL);
+    g_free(name);
+
+    int fd = open(seg->path, O_RDWR | O_CLOEXEC | (size ? O_CREAT | O_TRUNC : 0), 0644);
+    struct stat st;
+    if (fd < 0 || (size && ftruncate(fd, (off_t)size) != 0) || fstat(fd, &st) != 0 ||
+        (gsize)st.st_size < sizeof(JournalHeader)) {
+        log_error("event_journal: cannot open %s: %s", seg->path, strerror(errno));
+        goto fail;
+    }
+    seg->size = (gsize)st.st_size;
+    seg->data = mmap(NULL, seg->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (seg->data == MAP_FAILED) {
+        log_error("event_journal: cannot map %s: %s", seg->path, strerror(errno));
+        seg->data = NULL;
+        goto fail;
+    }
+    close(fd);
+    return seg;
+
+fail:
+    if (fd >= 0)
+        close(fd);
+    if (size)
+        g_unlink(seg->path);
+    g_free(seg->path);
+    g_free(seg);
+    return NULL;
+}
+
+static void segment_free(Segment *seg, gboolean remove)
+{
+    munmap(seg->data, seg->size);
+    if (remove)
+        g_unlink(seg->path);
+    g_free(seg->path);
+    g_free(seg);
+}
+
+static Segment *new_segment(EventJournal *journal, guint index)
+{
+    Segment *seg = map_segment(journal->dir, index, journal->segment_bytes);
+    if (!seg)
+        return NULL;
+    JournalHeader *hdr = (JournalHeader *)seg->data;
+    hdr->first_seq     = journal->next_seq;
+    hdr->segment_index = index;
+    hdr->header_size   = sizeof(JournalHeader);
+    hdr->version       = JOURNAL_VERSION;
+    hdr->magic         = JOURNAL_MAGIC;
+    seg->end = seg->read_offset = sizeof(JournalHeader);
+    seg->first_seq = seg->next_seq = journal->next_seq;
+    return seg;
+}
+
+/* Walks the records; FALSE when the header is not a journal segment's. */
+static gboolean scan_segment(Segment *seg)
+{
+    const JournalHeader *hdr = (const JournalHeader *)seg->data;
+    if (hdr->magic != JOURNAL_MAGIC || hdr->version != JOURNAL_VERSION ||
+        hdr->header_size != sizeof(JournalHeader))
+        return FALSE;
+
+    seg->first_seq = seg->next_seq = hdr->first_seq;
+    gsize offset = sizeof(JournalHeader);
+    while (offset + sizeof(RecordHeader) <= seg->size) {
+        const RecordHeader *rec = record_at(seg, offset);
+        if (rec->magic != RECORD_MAGIC || rec->seq != seg->next_seq ||
+            rec->length > seg->size - offset - sizeof(RecordHeader) ||
+            crc32(rec + 1, rec->length) != rec->crc)
+            break;
+        seg->next_seq++;
+        offset += record_bytes(rec->length);
+    }
+    seg->end         = MIN(offset, seg->size);
+    seg->read_offset = sizeof(JournalHeader);
+    return TRUE;
+}
+
+/* Unconsumed records of seg. */
+static guint64 segment_pending(const EventJournal *journal, const Segment *seg)
+{
+    guint64 from = MAX(seg->first_seq, journal->consumed_seq + 1);
+    return seg->next_seq > from ? seg->next_seq - from : 0;
+}
+
+/* Moves the read offset past records up to the consumed sequence; returns how many. */
+static guint64 skip_consumed(const EventJournal *journal, Segment *seg)
+{
+    guint64 skipped = 0;
+    while (seg->read_offset < seg->end) {
+        const RecordHeader *rec = record_at(seg, seg->read_offset);
+        if (rec->seq > journal->consumed_seq)
+            break;
+        seg->read_offset += record_bytes(rec->length);
+        skipped++;
+    }
+    return skipped;
+}
+
+static guint64 read_cursor(const gchar *path)
+{
+    gchar *contents = NULL;
+    gsize len = 0;
+    guint64 seq = 0;
+    if (g_file_get_contents(path, &contents, &len, NULL)) {
+        const JournalCursor *cursor = (const JournalCursor *)contents;
+        if (len == sizeof(JournalCursor) && cursor->magic == CURSOR_MAGIC &&
+            cursor->crc == crc32(&cursor->consumed_seq, sizeof(cursor->consumed_seq)))
+            seq = cursor->consumed_seq;
+        else
+            log_warning("event_journal: ignoring corrupt %s, replaying everything", path);
+    }
+    g_free(contents);
+    return seq;
+}
+
+static gint compare_index(gconstpointer a, gconstpointer b)
+{
+    guint x = *(const guint *)a, y = *(const guint *)b;
+    return x < y ? -1 : x > y;
+}
+
+static gboolean recover(EventJournal *journal)
+{
+    GDir *d = g_dir_open(journal->dir, 0, NULL);
+    if (!d) {
+        log_error("event_journal: cannot read %s", journal->dir);
+        return FALSE;
+    }
+    GArray *indices = g_array_new(FALSE, FALSE, sizeof(guint));
+    const gchar *name;
+    while ((name = g_dir_read_name(d)) != NULL) {
+        guint index;
+        if (sscanf(name, EVENT_JOURNAL_SEGMENT_PATTERN, &index) == 1 && g_str_has_suffix(name, ".tgej"))
+            g_array_append_val(indices, index);
+    }
+    g_dir_close(d);
+    g_array_sort(indices, compare_index);
+    guint next_index = indices->len ? g_array_index(indices, guint, indices->len - 1) + 1 : 0;
+
+    journal->consumed_seq = journal->synced_seq = read_cursor(journal->cursor_path);
+    journal->next_seq = journal->consumed_seq + 1;
+    for (guint i = 0; i < indices->len; i++) {
+        Segment *seg = map_segment(journal->dir, g_array_index(indices, guint, i), 0);
+        if (!seg)
+            continue;
+        Segment *last = g_queue_peek_tail(&journal->segments);
+        if (!scan_segment(seg) || (last && seg->first_seq < last->next_seq)) {
+            log_warning("event_journal: discarding %s, not a segment in sequence", seg->path);
+            segment_free(seg, TRUE);
+            continue;
+        }
+        journal->stats.recovered += segment_pending(journal, seg);
+        skip_consumed(journal, seg);
+        journal->next_seq = MAX(journal->next_seq, seg->next_seq);
+        g_queue_push_tail(&journal->segments, seg);
+    }
+    g_array_free(indices, TRUE);
+
+    while (g_queue_get_length(&journal->segments) > 1) {
+        Segment *head = g_queue_peek_head(&journal->segments);
+        if (head->read_offset < head->end)
+            break;
+        segment_free(g_queue_pop_head(&journal->segments), TRUE);
+    }
+
+    /* Appends go on in the last segment when its sequence runs on from the cursor. */
+    Segment *tail = g_queue_peek_tail(&journal->segments);
+    if (tail && tail->next_seq == journal->next_seq) {
+        /* Clear a torn end so that nothing after the last good record can scan as valid later. */
+        memset(tail->data + tail->end, 0, tail->size - tail->end);
+        return TRUE;
+    }
+    tail = new_segment(journal, next_index);
+    if (!tail)
+        return FALSE;
+    g_queue_push_tail(&journal->segments, tail);
+    return TRUE;
+}
+
+EventJournal *event_journal_open(const gchar *dir, const EventJournalOptions *options)
+{
+    if (g_mkdir_with_parents(dir, 0755) != 0) {
+        log_error("event_journal: cannot create %s: %s", dir, strerror(errno));
+        return NULL;
+    }
+    EventJournal *journal = g_new0(EventJournal, 1);
+    g_mutex_init(&journal->lock);
+    journal->dir           = g_strdup(dir);
+    journal->cursor_path   = g_build_filename(dir, JOURNAL_CURSOR_NAME, NULL);
+    journal->segment_bytes = MAX(options->segment_bytes, (guint64)MIN_SEGMENT_BYTES) & ~(guint64)(JOURNAL_ALIGN - 1);
+    journal->max_segments  = (guint)MAX(options->quota_bytes / journal->segment_bytes, 2);
+    g_queue_init(&journal->segments);
+
+    if (!recover(journal)) {
+        event_journal_free(journal);
+        return NULL;
+    }
+    log_info("event_journal: %s, %u segments, %" G_GUINT64_FORMAT " records to replay",
+             dir, g_queue_get_length(&journal->segments), journal->stats.recovered);
+    return journal;
+}
+
+void event_journal_free(EventJournal *journal)
+{
+    if (!journal)
+        return;
+    event_journal_sync(journal);
+    Segment *seg;
+    while ((seg = g_queue_pop_head(&journal->segments)) != NULL)
+        segment_free(seg, FALSE);
+    g_mutex_clear(&journal->lock);
+    g_free(journal->cursor_path);
+    g_free(journal->dir);
+    g_free(journal);
+}
+
+/* Starts the next segment, deleting the oldest beyond the quota; NULL when it cannot be created. */
+static Segment *roll(EventJournal *journal, Segment *tail)
+{
+    msync(tail->data, tail->size, MS_ASYNC);
+    if (g_queue_get_length(&journal->segments) >= journal->max_segments) {
+        Segment *head = g_queue_pop_head(&journal->segments);
+        journal->stats.dropped += segment_pending(journal, head);
+        journal->consumed_seq = MAX(journal->consumed_seq, head->next_seq - 1);
+        segment_free(head, TRUE);
+    }
+    Segment *next = new_segment(journal, tail->index + 1);
+    if (next) {
+        g_queue_push_tail(&journal->segments, next);
+        journal->full_logged = FALSE;
+    } else if (!journal->full_logged) {
+        log_error("event_journal: cannot add a segment to %s, dropping events", journal->dir);
+        journal->full_logged = TRUE;
+    }
+    return next;
+}
+
+gboolean event_journal_append(EventJournal *journal, const void *data, gsize len)
+{
+    gsize need = record_bytes(len);
+    g_mutex_lock(&journal->lock);
+    Segment *tail = g_queue_peek_tail(&journal->segments);
+    if (len > G_MAXUINT32 || need > journal->segment_bytes - sizeof(JournalHeader)) {
+        journal->stats.rejected++;
+        g_mutex_unlock(&journal->lock);
+        return FALSE;
+    }
+    if (tail->end + need > tail->size && !(tail = roll(journal, tail))) {
+        journal->stats.dropped++;
+        g_mutex_unlock(&journal->lock);
+        return FALSE;
+    }
+
+    RecordHeader *rec = (RecordHeader *)(tail->data + tail->end);
+    memcpy(rec + 1, data, len);
+    rec->length = (guint32)len;
+    rec->crc    = crc32(data, len);
+    rec->seq    = journal->next_seq++;
+    rec->magic  = RECORD_MAGIC;
+    tail->end     += need;
+    tail->next_seq = journal->next_seq;
+    journal->stats.appended++;
+    g_mutex_unlock(&journal->lock);
+    return TRUE;
+}
+
+gboolean event_journal_read(EventJournal *journal, GByteArray *out, guint64 *seq)
+{
+    gboolean found = FALSE;
+    g_mutex_lock(&journal->lock);
+    for (GList *l = journal->segments.head; l && !found; l = l->next) {
+        Segment *seg = l->data;
+        skip_consumed(journal, seg);
+        if (seg->read_offset >= seg->end)
+            continue;
+        const RecordHeader *rec = record_at(seg, seg->read_offset);
+        g_byte_array_set_size(out, rec->length);
+        memcpy(out->data, rec + 1, rec->length);
+        *seq  = rec->seq;
+        found = TRUE;
+    }
+    g_mutex_unlock(&journal->lock);
+    return found;
+}
+
+void event_journal_consume(EventJournal *journal, guint64 seq)
+{
+    g_mutex_lock(&journal->lock);
+    if (seq > journal->consumed_seq && seq < journal->next_seq) {
+        journal->consumed_seq = seq;
+        for (GList *l = journal->segments.head; l; l = l->next)
+            journal->stats.consumed += skip_consumed(journal, l->data);
+        while (g_queue_get_length(&journal->segments) > 1) {
+            Segment *head = g_queue_peek_head(&journal->segments);
+            if (head->read_offset < head->end)
+                break;
+            segment_free(g_queue_pop_head(&journal->segments), TRUE);
+        }
+    }
+    g_mutex_unlock(&journal->lock);
+}
+
+void event_journal_sync(EventJournal *journal)
+{
+    g_mutex_lock(&journal->lock);
+    JournalCursor cursor = { .consumed_seq = journal->consumed_seq, .magic = CURSOR_MAGIC };
+    gboolean moved = cursor.consumed_seq != journal->synced_seq;
+    journal->synced_seq = cursor.consumed_seq;
+    Segment *tail = g_queue_peek_tail(&journal->segments);
+    guint8 *data = tail->data;
+    gsize   size = tail->size;
+    g_mutex_unlock(&journal->lock);
+
+    /* Outside the lock so appends on streaming threads never wait for the disk.  A segment
+     * unmapped meanwhile only makes msync fail; it was synced when it stopped being the tail. */
+    msync(data, size, MS_SYNC);
+    if (moved) {
+        cursor.crc = crc32(&cursor.consumed_seq, sizeof(cursor.consumed_seq));
+        GError *error = NULL;
+        if (!g_file_set_contents(journal->cursor_path, (const gchar *)&cursor, sizeof(cursor), &error)) {
+            log_warning("event_journal: cannot write %s: %s", journal->cursor_path, error->message);
+            g_error_free(error);
+        }
+    }
+}
+
+void event_journal_get_stats(EventJournal *journal, EventJournalStats *stats)
+{
+    g_mutex_lock(&journal->lock);
+    *stats = journal->stats;
+    stats->pending  = 0;
+    stats->segments = g_queue_get_length(&journal->segments);
+    for (GList *l = journal->segments.head; l; l = l->next)
+        stats->pending += segment_pending(journal, l->data);
+    g_mutex_unlock(&journal->lock);
+}
@@ -0,0 +1,188 @@
+#include <stdatomic.h>
+
+#include "event_spool.h"
+#include "metrics.h"
+#include "logger.h"
+
+/* Replay thread period; the token bucket holds at most one period's worth. */
+#define SPOOL_TICK_US (10 * G_TIME_SPAN_MILLISECOND)
+
+struct EventSpool {
+    EventJournal          *journal;
+    EventSpoolOptions      options;
+    EventSpoolConnectFunc  connect;
+    EventSpoolSendFunc     send;
+    gpointer               user_data;
+    GDestroyNotify         destroy;
+
+    GThread               *thread;
+    GMutex                 lock;
+    GCond                  wake;
+    gboolean               stop;
+    atomic_bool            up;
+    atomic_ullong          spilled;
+    atomic_ullong          replayed;
+
+    MetricsCounter        *spilled_counter;
+    MetricsCounter        *replayed_counter;
+    MetricsCounter        *dropped_counter;
+    MetricsGauge          *pending_gauge;
+    MetricsGauge          *up_gauge;
+};
+
+static void publish_stats(EventSpool *spool, guint64 *dropped_seen)
+{
+    EventJournalStats stats;
+    event_journal_get_stats(spool->journal, &stats);
+    metrics_counter_add(spool->dropped_counter, stats.dropped - *dropped_seen);
+    *dropped_seen = stats.dropped;
+    metrics_gauge_set(spool->pending_gauge, (gdouble)stats.pending);
+    metrics_gauge_set(spool->up_gauge, atomic_load(&spool->up) ? 1.0 : 0.0);
+}
+
+/* Sends what the token bucket allows; FALSE when a send failed. */
+static gboolean replay(EventSpool *spool, GByteArray *record, gdouble *tokens)
+{
+    guint64 seq;
+    while (*tokens >= 1.0 && event_journal_read(spool->journal, record, &seq)) {
+        if (!spool->send(record->data, record->len, spool->user_data))
+            return FALSE;
+        event_journal_consume(spool->journal, seq);
+        atomic_fetch_add_explicit(&spool->replayed, 1, memory_order_relaxed);
+        metrics_counter_add(spool->replayed_counter, 1);
+        *tokens -= 1.0;
+    }
+    return TRUE;
+}
+
+static gpointer replay_thread(gpointer data)
+{
+    EventSpool *spool = data;
+    GByteArray *record = g_byte_array_new();
+    gdouble burst  = MAX(spool->options.replay_rate * (SPOOL_TICK_US / (gdouble)G_TIME_SPAN_SECOND), 1.0);
+    gdouble tokens = 0.0;
+    gint64 last = g_get_monotonic_time(), next_connect = last, next_sync = last;
+    guint64 dropped_seen = 0;
+
+    g_mutex_lock(&spool->lock);
+    while (!spool->stop) {
+        g_mutex_unlock(&spool->lock);
+        gint64 now = g_get_monotonic_time();
+        gboolean up = atomic_load(&spool->up);
+
+        if (!up && now >= next_connect) {
+            up = spool->connect(spool->user_data);
+            next_connect = now + spool->options.retry_ms * G_TIME_SPAN_MILLISECOND;
+            if (up) {
+                EventJournalStats stats;
+                event_journal_get_stats(spool->journal, &stats);
+                log_info("event_spool: broker reachable, %" G_GUINT64_FORMAT " events to replay", stats.pending);
+            }
+        } else if (up) {
+            up = spool->connect(spool->user_data);
+        }
+        if (up) {
+            tokens = MIN(tokens + (now - last) * spool->options.replay_rate / (gdouble)G_TIME_SPAN_SECOND, burst);
+            up = replay(spool, record, &tokens);
+        }
+        if (!up && atomic_load(&spool->up))
+            log_warning("event_spool: broker unreachable, spilling events to the journal");
+        atomic_store(&spool->up, up);
+        last = now;
+
+        if (now >= next_sync) {
+            event_journal_sync(spool->journal);
+            publish_stats(spool, &dropped_seen);
+            next_sync = now + spool->options.sync_ms * G_TIME_SPAN_MILLISECOND;
+        }
+        g_mutex_lock(&spool->lock);
+        if (!spool->stop)
+            g_cond_wait_until(&spool->wake, &spool->lock, g_get_monotonic_time() + SPOOL_TICK_US);
+    }
+    g_mutex_unlock(&spool->lock);
+    g_byte_array_free(record, TRUE);
+    return NULL;
+}
+
+EventSpool *event_spool_new(EventJournal            *journal,
+                            const EventSpoolOptions *options,
+                            EventSpoolConnectFunc    connect,
+                            EventSpoolSendFunc       send,
+                            gpointer                 user_data,
+                            GDestroyNotify           destroy)
+{
+    EventSpool *spool = g_new0(EventSpool, 1);
+    spool->journal   = journal;
+    spool->options   = *options;
+    spool->options.replay_rate = MAX(spool->options.replay_rate, 1);
+    spool->options.sync_ms     = MAX(spool->options.sync_ms, 1);
+    spool->connect   = connect;
+    spool->send      = send;
+    spool->user_data = user_data;
+    spool->destroy   = destroy;
+    g_mutex_init(&spool->lock);
+    g_cond_init(&spool->wake);
+    /* Spill nothing until a connect attempt says otherwise. */
+    atomic_init(&spool->up, TRUE);
+    atomic_init(&spool->spilled, 0);
+    atomic_init(&spool->replayed, 0);
+
+    spool->spilled_counter  = metrics_counter("traffic_guard_journal_spilled_total",
+                                              "Broker events written to the journal.", NULL, NULL, TRUE);
+    spool->replayed_counter = metrics_counter("traffic_guard_journal_replayed_total",
+                                              "Journaled broker events sent after all.", NULL, NULL, TRUE);
+    spool->dropped_counter  = metrics_counter("traffic_guard_journal_dropped_total",
+                                              "Journaled broker events lost to the disk quota.", NULL, NULL, FALSE);
+    spool->pending_gauge    = metrics_gauge("traffic_guard_journal_pending",
+                                            "Journaled broker events not yet replayed.", NULL, NULL);
+    spool->up_gauge         = metrics_gauge("traffic_guard_broker_up",
+                                            "1 while the broker accepts events, as seen by the journal replay.",
+                                            NULL, NULL);
+    spool->thread = g_thread_new("event-spool", replay_thread, spool);
+    return spool;
+}
+
+void event_spool_free(EventSpool *spool)
+{
+    if (!spool)
+        return;
+    g_mutex_lock(&spool->lock);
+    spool->stop = TRUE;
+    g_cond_signal(&spool->wake);
+    g_mutex_unlock(&spool->lock);
+    g_thread_join(spool->thread);
+    if (spool->destroy)
+        spool->destroy(spool->user_data);
+
+    EventSpoolStats stats;
+    event_spool_get_stats(spool, &stats);
+    log_info("event_spool: %" G_GUINT64_FORMAT " spilled, %" G_GUINT64_FORMAT " replayed, %"
+             G_GUINT64_FORMAT " lost to the quota, %" G_GUINT64_FORMAT " left for the next run",
+             stats.spilled, stats.replayed, stats.journal.dropped, stats.journal.pending);
+    event_journal_free(spool->journal);
+    g_cond_clear(&spool->wake);
+    g_mutex_clear(&spool->lock);
+    g_free(spool);
+}
+
+gboolean event_spool_broker_up(const EventSpool *spool)
+{
+    return atomic_load_explicit(&((EventSpool *)spool)->up, memory_order_relaxed);
+}
+
+gboolean event_spool_spill(EventSpool *spool, const void *payload, gsize len)
+{
+    if (!event_journal_append(spool->journal, payload, len))
+        return FALSE;
+    atomic_fetch_add_explicit(&spool->spilled, 1, memory_order_relaxed);
+    metrics_counter_add(spool->spilled_counter, 1);
+    return TRUE;
+}
+
+void event_spool_get_stats(EventSpool *spool, EventSpoolStats *stats)
+{
+    stats->broker_up = atomic_load(&spool->up);
+    stats->spilled   = atomic_load(&spool->spilled);
+    stats->replayed  = atomic_load(&spool->replayed);
+    event_journal_get_stats(spool->journal, &stats->journal);
+}
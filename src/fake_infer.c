@@ -0,0 +1,163 @@
+#include <gst/gst.h>
+#include <gst/base/gstbasetransform.h>
+
+#include "gstnvdsmeta.h"
+#include "fake_infer.h"
+#include "synthetic_meta.h"
+
+typedef struct {
+    GstBaseTransform parent;
+
+    guint               source_id;
+    SyntheticMetaParams params;
+    GRand              *rand;       /* created on start so every run replays from seed */
+    guint               frame_num;
+} TgFakeInfer;
+
+typedef struct {
+    GstBaseTransformClass parent_class;
+} TgFakeInferClass;
+
+enum {
+    PROP_0,
+    PROP_SOURCE_ID,
+    PROP_OBJECTS_PER_FRAME,
+    PROP_PLATE_RATIO,
+    PROP_LABEL_CARDINALITY,
+    PROP_SEED,
+};
+
+GType tg_fake_infer_get_type(void);
+G_DEFINE_TYPE(TgFakeInfer, tg_fake_infer, GST_TYPE_BASE_TRANSFORM)
+
+static GstStaticPadTemplate sink_template =
+    GST_STATIC_PAD_TEMPLATE("sink", GST_PAD_SINK, GST_PAD_ALWAYS, GST_STATIC_CAPS_ANY);
+static GstStaticPadTemplate src_template =
+    GST_STATIC_PAD_TEMPLATE("src", GST_PAD_SRC, GST_PAD_ALWAYS, GST_STATIC_CAPS_ANY);
+
+static gboolean fake_infer_start(GstBaseTransform *trans)
+{
+    TgFakeInfer *self = (TgFakeInfer *)trans;
+    /* Per-source stream, so two sources with one seed still differ. */
+    guint32 seed[2] = { self->params.seed, self->source_id };
+    g_clear_pointer(&self->rand, g_rand_free);
+    self->rand      = g_rand_new_with_seed_array(seed, G_N_ELEMENTS(seed));
+    self->frame_num = 0;
+    return TRUE;
+}
+
+static gboolean fake_infer_stop(GstBaseTransform *trans)
+{
+    g_clear_pointer(&((TgFakeInfer *)trans)->rand, g_rand_free);
+    return TRUE;
+}
+
+static GstFlowReturn fake_infer_transform_ip(GstBaseTransform *trans, GstBuffer *buf)
+{
+    TgFakeInfer *self = (TgFakeInfer *)trans;
+    if (gst_buffer_get_nvds_batch_meta(buf))
+        return GST_FLOW_OK;
+
+    /* Same attachment nvstreammux performs; the release func destroys the batch with the buffer. */
+    NvDsBatchMeta *batch_meta = nvds_create_batch_meta(1);
+    NvDsMeta *meta = gst_buffer_add_nvds_meta(buf, batch_meta, NULL,
+                                              nvds_batch_meta_copy_func,
+                                              nvds_batch_meta_release_func);
+    meta->meta_type = NVDS_BATCH_GST_META;
+    batch_meta->base_meta.batch_meta   = batch_meta;
+    batch_meta->base_meta.copy_func    = nvds_batch_meta_copy_func;
+    batch_meta->base_meta.release_func = nvds_batch_meta_release_func;
+
+    synthetic_meta_add_frame(batch_meta, &self->params, self->source_id,
+                             self->frame_num++, self->rand);
+    NvDsFrameMeta *frame_meta = (NvDsFrameMeta *)batch_meta->frame_meta_list->data;
+    frame_meta->buf_pts = GST_BUFFER_PTS(buf);
+    return GST_FLOW_OK;
+}
+
+static void fake_infer_set_property(GObject *object, guint prop_id,
+                                    const GValue *value, GParamSpec *pspec)
+{
+    TgFakeInfer *self = (TgFakeInfer *)object;
+    switch (prop_id) {
+    case PROP_SOURCE_ID:         self->source_id = g_value_get_uint(value);                break;
+    case PROP_OBJECTS_PER_FRAME: self->params.objects_per_frame = g_value_get_uint(value); break;
+    case PROP_PLATE_RATIO:       self->params.plate_ratio = g_value_get_double(value);     break;
+    case PROP_LABEL_CARDINALITY: self->params.label_cardinality = g_value_get_uint(value); break;
+    case PROP_SEED:              self->params.seed = g_value_get_uint(value);              break;
+    default: G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);                    break;
+    }
+}
+
+static void fake_infer_get_property(GObject *object, guint prop_id,
+                                    GValue *value, GParamSpec *pspec)
+{
+    TgFakeInfer *self = (TgFakeInfer *)object;
+    switch (prop_id) {
+    case PROP_SOURCE_ID:         g_value_set_uint(value, self->source_id);                break;
+    case PROP_OBJECTS_PER_FRAME: g_value_set_uint(value, self->params.objects_per_frame); break;
+    case PROP_PLATE_RATIO:       g_value_set_double(value, self->params.plate_ratio);     break;
+    case PROP_LABEL_CARDINALITY: g_value_set_uint(value, self->params.label_cardinality); break;
+    case PROP_SEED:              g_value_set_uint(value, self->params.seed);              break;
+    default: G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);                   break;
+    }
+}
+
+static void fake_infer_finalize(GObject *object)
+{
+    g_clear_pointer(&((TgFakeInfer *)object)->rand, g_rand_free);
+    G_OBJECT_CLASS(tg_fake_infer_parent_class)->finalize(object);
+}
+
+static void tg_fake_infer_class_init(TgFakeInferClass *klass)
+{
+    GObjectClass          *gobject_class   = G_OBJECT_CLASS(klass);
+    GstElementClass       *element_class   = GST_ELEMENT_CLASS(klass);
+    GstBaseTransformClass *transform_class = GST_BASE_TRANSFORM_CLASS(klass);
+    const GParamFlags      flags = G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS;
+
+    gobject_class->set_property = fake_infer_set_property;
+    gobject_class->get_property = fake_infer_get_property;
+    gobject_class->finalize     = fake_infer_finalize;
+
+    g_object_class_install_property(gobject_class, PROP_SOURCE_ID,
+        g_param_spec_uint("source-id", "Source id", "frame_meta->source_id of every frame",
+                          0, G_MAXUINT, 0, flags));
+    g_object_class_install_property(gobject_class, PROP_OBJECTS_PER_FRAME,
+        g_param_spec_uint("objects-per-frame", "Objects per frame", "Cars plus plates per frame",
+                          1, 1024, 8, flags));
+    g_object_class_install_property(gobject_class, PROP_PLATE_RATIO,
+        g_param_spec_double("plate-ratio", "Plate ratio", "Plates per car",
+                            0.0, 1.0, 0.5, flags));
+    g_object_class_install_property(gobject_class, PROP_LABEL_CARDINALITY,
+        g_param_spec_uint("label-cardinality", "Label cardinality", "Distinct make/type labels",
+                          1, G_MAXUINT, 16, flags));
+    g_object_class_install_property(gobject_class, PROP_SEED,
+        g_param_spec_uint("seed", "Seed", "Seed of the generated objects",
+                          0, G_MAXUINT, 1, flags));
+
+    gst_element_class_set_static_metadata(element_class, "Traffic Guard fake inference",
+        "Filter/Analyzer/Video", "Attaches synthetic DeepStream batch metadata",
+        "traffic-guard");
+    gst_element_class_add_static_pad_template(element_class, &sink_template);
+    gst_element_class_add_static_pad_template(element_class, &src_template);
+
+    transform_class->start        = fake_infer_start;
+    transform_class->stop         = fake_infer_stop;
+    transform_class->transform_ip = fake_infer_transform_ip;
+}
+
+static void tg_fake_infer_init(TgFakeInfer *self)
+{
+    self->params.objects_per_frame = 8;
+    self->params.plate_ratio       = 0.5;
+    self->params.label_cardinality = 16;
+    self->params.seed              = 1;
+    /* Never passthrough: the meta has to be added to every buffer. */
+    gst_base_transform_set_in_place(GST_BASE_TRANSFORM(self), TRUE);
+}
+
+gboolean fake_infer_register(void)
+{
+    return gst_element_register(NULL, FAKE_INFER_FACTORY, GST_RANK_NONE, tg_fake_infer_get_type());
+}
@@ -0,0 +1,248 @@
+#include "frame_index.h"
+
+#define NO_ENTRY (-1)
+
+typedef struct {
+    guint64 object_id;
+    guint32 generation;  /* slot is empty unless it matches the index generation */
+    gint32  car;         /* position in the vehicle bucket, NO_ENTRY when none */
+    gint32  plate;       /* position in the plate bucket, NO_ENTRY when none */
+} IdSlot;
+
+struct FrameIndex {
+    NvDsBatchMeta   *batch_meta;
+    NvDsFrameMeta   *frame_meta;
+    FrameIndexBucket buckets[FRAME_INDEX_MAX_COMPONENTS];
+    gfloat           min_prob[FRAME_INDEX_MAX_COMPONENTS];
+
+    IdSlot  *slots;
+    guint    slot_mask;
+    guint    slot_used;
+    guint32  generation;
+};
+
+static const FrameIndexBucket empty_bucket = { NULL, 0, 0 };
+
+FrameIndex *frame_index_new(void)
+{
+    FrameIndex *index = g_new0(FrameIndex, 1);
+    index->slot_mask = 63;
+    index->slots     = g_new0(IdSlot, index->slot_mask + 1);
+    return index;
+}
+
+void frame_index_free(FrameIndex *index)
+{
+    if (!index)
+        return;
+    for (guint i = 0; i < FRAME_INDEX_MAX_COMPONENTS; i++)
+        g_free(index->buckets[i].items);
+    g_free(index->slots);
+    g_free(index);
+}
+
+static inline guint hash_id(guint64 id)
+{
+    id ^= id >> 33;
+    id *= 0xff51afd7ed558ccdull;
+    id ^= id >> 33;
+    return (guint)id;
+}
+
+static IdSlot *slot_for(FrameIndex *index, guint64 object_id)
+{
+    guint i = hash_id(object_id) & index->slot_mask;
+    for (;;) {
+        IdSlot *slot = &index->slots[i];
+        if (slot->generation != index->generation) {
+            index->slot_used++;
+            slot->generation = index->generation;
+            slot->object_id  = object_id;
+            slot->car        = NO_ENTRY;
+            slot->plate      = NO_ENTRY;
+            return slot;
+        }
+        if (slot->object_id == object_id)
+            return slot;
+        i = (i + 1) & index->slot_mask;
+    }
+}
+
+static const IdSlot *find_slot(const FrameIndex *index, guint64 object_id)
+{
+    guint i = hash_id(object_id) & index->slot_mask;
+    for (;;) {
+        const IdSlot *slot = &index->slots[i];
+        if (slot->generation != index->generation)
+            return NULL;
+        if (slot->object_id == object_id)
+            return slot;
+        i = (i + 1) & index->slot_mask;
+    }
+}
+
+/* Sized for n objects at most half full; invalidating the old contents is O(1). */
+static void reset_slots(FrameIndex *index, guint n_objects)
+{
+    guint needed = index->slot_mask + 1;
+    while (needed < 2 * n_objects + 2)
+        needed <<= 1;
+
+    index->slot_used = 0;
+    if (needed != index->slot_mask + 1 || ++index->generation == 0) {
+        g_free(index->slots);
+        index->slots      = g_new0(IdSlot, needed);
+        index->slot_mask  = needed - 1;
+        index->generation = 1;
+    }
+}
+
+/* num_obj_meta undercounted the list: double the table and re-insert. */
+static void grow_slots(FrameIndex *index)
+{
+    reset_slots(index, index->slot_mask + 1);
+
+    const FrameIndexBucket *cars = &index->buckets[GIE_ID_VEHICLE_DETECTOR];
+    for (guint i = 0; i < cars->n; i++) {
+        IdSlot *slot = slot_for(index, cars->items[i].obj->object_id);
+        if (slot->car == NO_ENTRY)
+            slot->car = (gint32)i;
+    }
+    const FrameIndexBucket *plates = &index->buckets[GIE_ID_PLATE_DETECTOR];
+    for (guint i = 0; i < plates->n; i++) {
+        IdSlot *slot = slot_for(index, plates->items[i].obj->object_id);
+        if (slot->plate == NO_ENTRY)
+            slot->plate = (gint32)i;
+    }
+}
+
+static FrameIndexObject *bucket_push(FrameIndexBucket *bucket)
+{
+    if (bucket->n == bucket->capacity) {
+        bucket->capacity = bucket->capacity ? bucket->capacity * 2 : 64;
+        bucket->items    = g_renew(FrameIndexObject, bucket->items, bucket->capacity);
+    }
+    return &bucket->items[bucket->n++];
+}
+
+void frame_index_set_min_prob(FrameIndex *index, gint component_id, gfloat min_prob)
+{
+    if (component_id >= 0 && component_id < FRAME_INDEX_MAX_COMPONENTS)
+        index->min_prob[component_id] = min_prob;
+}
+
+static void extract_labels(const FrameIndex *index, FrameIndexObject *entry, NvDsObjectMeta *obj)
+{
+    entry->brand = entry->type = entry->plate = NULL;
+    entry->brand_prob = entry->type_prob = entry->plate_prob = 0.0f;
+    entry->has_plate_classifier = FALSE;
+
+    for (NvDsClassifierMetaList *l_class = obj->classifier_meta_list;
+         l_class != NULL; l_class = l_class->next) {
+        NvDsClassifierMeta *cm = (NvDsClassifierMeta *)(l_class->data);
+        NvDsLabelInfo *li = cm->label_info_list
+                          ? (NvDsLabelInfo *)cm->label_info_list->data : NULL;
+        if (li && cm->unique_component_id >= 0 && cm->unique_component_id < FRAME_INDEX_MAX_COMPONENTS &&
+            li->result_prob < index->min_prob[cm->unique_component_id])
+            li = NULL;
+
+        switch (cm->unique_component_id) {
+        case GIE_ID_VEHICLE_MAKE:
+            if (li && !entry->brand) {
+                entry->brand      = li->result_label;
+                entry->brand_prob = li->result_prob;
+            }
+            break;
+        case GIE_ID_VEHICLE_TYPE:
+            if (li && !entry->type) {
+                entry->type      = li->result_label;
+                entry->type_prob = li->result_prob;
+            }
+            break;
+        case GIE_ID_PLATE_READER:
+            if (!entry->has_plate_classifier) {
+                entry->has_plate_classifier = TRUE;
+                if (li) {
+                    entry->plate      = li->result_label;
+                    entry->plate_prob = li->result_prob;
+                }
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void frame_index_build(FrameIndex    *index,
+                       NvDsBatchMeta *batch_meta,
+                       NvDsFrameMeta *frame_meta)
+{
+    index->batch_meta = batch_meta;
+    index->frame_meta = frame_meta;
+    for (guint i = 0; i < FRAME_INDEX_MAX_COMPONENTS; i++)
+        index->buckets[i].n = 0;
+    reset_slots(index, frame_meta->num_obj_meta);
+
+    for (NvDsMetaList *l_obj = frame_meta->obj_meta_list; l_obj != NULL;
+         l_obj = l_obj->next) {
+        NvDsObjectMeta *obj = (NvDsObjectMeta *)(l_obj->data);
+        gint comp = obj->unique_component_id;
+        if (comp < 0 || comp >= FRAME_INDEX_MAX_COMPONENTS)
+            continue;
+
+        if (2 * (index->slot_used + 1) > index->slot_mask + 1)
+            grow_slots(index);
+
+        FrameIndexBucket *bucket = &index->buckets[comp];
+        FrameIndexObject *entry  = bucket_push(bucket);
+        entry->obj = obj;
+        extract_labels(index, entry, obj);
+
+        if (comp == GIE_ID_VEHICLE_DETECTOR) {
+            IdSlot *slot = slot_for(index, obj->object_id);
+            if (slot->car == NO_ENTRY)
+                slot->car = (gint32)(bucket->n - 1);
+        } else if (comp == GIE_ID_PLATE_DETECTOR) {
+            IdSlot *slot = slot_for(index, obj->object_id);
+            if (slot->plate == NO_ENTRY)
+                slot->plate = (gint32)(bucket->n - 1);
+        }
+    }
+}
+
+NvDsBatchMeta *frame_index_batch_meta(const FrameIndex *index)
+{
+    return index->batch_meta;
+}
+
+NvDsFrameMeta *frame_index_frame_meta(const FrameIndex *index)
+{
+    return index->frame_meta;
+}
+
+const FrameIndexBucket *frame_index_bucket(const FrameIndex *index,
+                                           gint              component_id)
+{
+    if (component_id < 0 || component_id >= FRAME_INDEX_MAX_COMPONENTS)
+        return &empty_bucket;
+    return &index->buckets[component_id];
+}
+
+const FrameIndexObject *frame_index_find_car(const FrameIndex *index,
+                                             guint64           object_id)
+{
+    const IdSlot *slot = find_slot(index, object_id);
+    if (!slot || slot->car == NO_ENTRY)
+        return NULL;
+    return &index->buckets[GIE_ID_VEHICLE_DETECTOR].items[slot->car];
+}
+
+const FrameIndexObject *frame_index_find_plate(const FrameIndex *index,
+                                               guint64           object_id)
+{
+    const IdSlot *slot = find_slot(index, object_id);
+    if (!slot || slot->plate == NO_ENTRY)
+        return NULL;
+    return &index->buckets[GIE_ID_PLATE_DETECTOR].items[slot->plate];
+}
@@ -0,0 +1,352 @@
+#include <stdlib.h>
+
+#include "gie_graph.h"
+#include "yaml_util.h"
+#include "logger.h"
+
+typedef struct {
+    gchar *from;
+    gchar *to;
+} NamedEdge;
+
+static const GieNode default_nodes[] = {
+    { "primary-inference",     "primary-gie",    GIE_NODE_INFER   },
+    { "tracker",               "tracker",        GIE_NODE_TRACKER },
+    { "secondary-inference-1", "secondary-gie1", GIE_NODE_INFER   },
+    { "secondary-inference-2", "secondary-gie2", GIE_NODE_INFER   },
+    { "secondary-inference-3", "secondary-gie3", GIE_NODE_INFER   },
+    { "secondary-inference-4", "secondary-gie4", GIE_NODE_INFER   },
+};
+
+static void add_named_edge(GArray *edges, const gchar *from, const gchar *to)
+{
+    NamedEdge e = { g_strdup(from), g_strdup(to) };
+    g_array_append_val(edges, e);
+}
+
+static void clear_named_edge(gpointer data)
+{
+    NamedEdge *e = data;
+    g_free(e->from);
+    g_free(e->to);
+}
+
+static void clear_node(gpointer data)
+{
+    GieNode *n = data;
+    g_free(n->name);
+    g_free(n->config);
+}
+
+static gint find_node(GArray *nodes, const gchar *name)
+{
+    for (guint i = 0; i < nodes->len; i++)
+        if (g_strcmp0(g_array_index(nodes, GieNode, i).name, name) == 0)
+            return (gint)i;
+    return -1;
+}
+
+static gboolean parse_nodes(GArray *nodes, yaml_document_t *doc, yaml_node_t *list)
+{
+    if (!list || list->type != YAML_SEQUENCE_NODE) {
+        log_error("gie_graph: gie-graph.nodes: must be a list");
+        return FALSE;
+    }
+    for (yaml_node_item_t *item = list->data.sequence.items.start;
+         item < list->data.sequence.items.top; item++) {
+        yaml_node_t *entry  = yaml_document_get_node(doc, *item);
+        const gchar *name   = yaml_util_scalar(yaml_util_get(doc, entry, "name"));
+        const gchar *config = yaml_util_scalar(yaml_util_get(doc, entry, "config"));
+        const gchar *type   = yaml_util_scalar(yaml_util_get(doc, entry, "type"));
+        const gchar *enable = yaml_util_scalar(yaml_util_get(doc, entry, "enable"));
+
+        if (!name || !name[0]) {
+            log_error("gie_graph: node %u has no name", nodes->len);
+            return FALSE;
+        }
+        if (find_node(nodes, name) >= 0) {
+            log_error("gie_graph: node '%s' declared twice", name);
+            return FALSE;
+        }
+        GieNode node = { .type = GIE_NODE_INFER };
+        if (g_strcmp0(type, "tracker") == 0)
+            node.type = GIE_NODE_TRACKER;
+        else if (type && g_strcmp0(type, "infer") != 0) {
+            log_error("gie_graph: node '%s' has unknown type '%s'", name, type);
+            return FALSE;
+        }
+        /* Left out of nodes, so bridge_missing reroutes its edges. */
+        if (g_strcmp0(enable, "0") == 0)
+            continue;
+        if (!config && node.type == GIE_NODE_TRACKER)
+            config = "tracker";
+        if (!config || !config[0]) {
+            log_error("gie_graph: node '%s' has no config section", name);
+            return FALSE;
+        }
+        if (nodes->len == GIE_GRAPH_MAX_NODES) {
+            log_error("gie_graph: more than %u nodes", GIE_GRAPH_MAX_NODES);
+            return FALSE;
+        }
+        node.name   = g_strdup(name);
+        node.config = g_strdup(config);
+        g_array_append_val(nodes, node);
+    }
+    return TRUE;
+}
+
+static gboolean parse_edges(GArray *edges, yaml_document_t *doc, yaml_node_t *list)
+{
+    if (!list)
+        return TRUE;
+    if (list->type != YAML_SEQUENCE_NODE) {
+        log_error("gie_graph: gie-graph.edges: must be a list");
+        return FALSE;
+    }
+    for (yaml_node_item_t *item = list->data.sequence.items.start;
+         item < list->data.sequence.items.top; item++) {
+        yaml_node_t *pair = yaml_document_get_node(doc, *item);
+        const gchar *from = NULL, *to = NULL;
+        if (pair && pair->type == YAML_SEQUENCE_NODE &&
+            pair->data.sequence.items.top - pair->data.sequence.items.start == 2) {
+            from = yaml_util_scalar(yaml_document_get_node(doc, pair->data.sequence.items.start[0]));
+            to   = yaml_util_scalar(yaml_document_get_node(doc, pair->data.sequence.items.start[1]));
+        }
+        if (!from || !to) {
+            log_error("gie_graph: edge %u is not a [from, to] pair of names", edges->len);
+            return FALSE;
+        }
+        add_named_edge(edges, from, to);
+    }
+    return TRUE;
+}
+
+/* Replaces every edge through an undeclared node by edges around it. */
+static void bridge_missing(GArray *nodes, GArray *edges)
+{
+    for (;;) {
+        const gchar *missing = NULL;
+        for (guint i = 0; i < edges->len && !missing; i++) {
+            NamedEdge *e = &g_array_index(edges, NamedEdge, i);
+            if (find_node(nodes, e->from) < 0)
+                missing = e->from;
+            else if (find_node(nodes, e->to) < 0)
+                missing = e->to;
+        }
+        if (!missing)
+            return;
+
+        gchar *name = g_strdup(missing);
+        GArray *kept = g_array_new(FALSE, FALSE, sizeof(NamedEdge));
+        g_array_set_clear_func(kept, clear_named_edge);
+        for (guint i = 0; i < edges->len; i++) {
+            NamedEdge *in = &g_array_index(edges, NamedEdge, i);
+            if (g_strcmp0(in->to, name) == 0) {
+                for (guint j = 0; j < edges->len; j++) {
+                    NamedEdge *out = &g_array_index(edges, NamedEdge, j);
+                    if (g_strcmp0(out->from, name) == 0 && g_strcmp0(in->from, out->to) != 0)
+                        add_named_edge(kept, in->from, out->to);
+                }
+            } else if (g_strcmp0(in->from, name) != 0) {
+                add_named_edge(kept, in->from, in->to);
+            }
+        }
+        log_info("gie_graph: node '%s' omitted", name);
+        g_free(name);
+        g_array_set_size(edges, 0);
+        for (guint i = 0; i < kept->len; i++) {
+            NamedEdge *e = &g_array_index(kept, NamedEdge, i);
+            add_named_edge(edges, e->from, e->to);
+        }
+        g_array_free(kept, TRUE);
+    }
+}
+
+static gint compare_edges(gconstpointer a, gconstpointer b)
+{
+    const GieEdge *x = a, *y = b;
+    if (x->from != y->from)
+        return x->from < y->from ? -1 : 1;
+    return (x->to > y->to) - (x->to < y->to);
+}
+
+/* Kahn's algorithm; fills graph in topological order.  FALSE on a cycle or several entries. */
+static gboolean build_graph(GieGraph *graph, GArray *nodes, GArray *edges)
+{
+    guint n = nodes->len;
+    guint32 adjacency[GIE_GRAPH_MAX_NODES] = { 0 };
+    guint in_degree[GIE_GRAPH_MAX_NODES] = { 0 };
+    for (guint i = 0; i < edges->len; i++) {
+        NamedEdge *e = &g_array_index(edges, NamedEdge, i);
+        guint from = (guint)find_node(nodes, e->from), to = (guint)find_node(nodes, e->to);
+        if (from == to) {
+            log_error("gie_graph: node '%s' feeds itself", e->from);
+            return FALSE;
+        }
+        if (!(adjacency[from] & (1u << to))) {
+            adjacency[from] |= 1u << to;
+            in_degree[to]++;
+        }
+    }
+
+    guint entries = 0;
+    for (guint i = 0; i < n; i++)
+        entries += in_degree[i] == 0;
+    if (n == 0 || entries != 1) {
+        log_error("gie_graph: needs exactly one entry node, found %u", entries);
+        return FALSE;
+    }
+
+    guint order[GIE_GRAPH_MAX_NODES], position[GIE_GRAPH_MAX_NODES];
+    guint n_ordered = 0;
+    guint32 done = 0;
+    while (n_ordered < n) {
+        guint next = n;
+        for (guint i = 0; i < n && next == n; i++)
+            if (!(done & (1u << i)) && in_degree[i] == 0)
+                next = i;
+        if (next == n) {
+            log_error("gie_graph: edges form a cycle");
+            return FALSE;
+        }
+        done |= 1u << next;
+        position[next] = n_ordered;
+        order[n_ordered++] = next;
+        for (guint j = 0; j < n; j++)
+            if (adjacency[next] & (1u << j))
+                in_degree[j]--;
+    }
+
+    graph->n_nodes = n;
+    graph->nodes   = g_new0(GieNode, n);
+    for (guint i = 0; i < n; i++) {
+        GieNode *src = &g_array_index(nodes, GieNode, order[i]);
+        graph->nodes[i] = (GieNode){ g_strdup(src->name), g_strdup(src->config), src->type };
+    }
+    graph->edges = g_new0(GieEdge, MAX(edges->len, 1));
+    for (guint from = 0; from < n; from++)
+        for (guint to = 0; to < n; to++)
+            if (adjacency[from] & (1u << to))
+                graph->edges[graph->n_edges++] = (GieEdge){ position[from], position[to] };
+    qsort(graph->edges, graph->n_edges, sizeof(GieEdge), compare_edges);
+    return TRUE;
+}
+
+static gboolean collect(GArray *nodes, GArray *edges, yaml_document_t *doc)
+{
+    yaml_node_t *root    = yaml_document_get_root_node(doc);
+    yaml_node_t *section = yaml_util_get(doc, root, "gie-graph");
+    if (!section) {
+        for (guint i = 0; i < G_N_ELEMENTS(default_nodes); i++) {
+            GieNode node = { g_strdup(default_nodes[i].name), g_strdup(default_nodes[i].config),
+                             default_nodes[i].type };
+            g_array_append_val(nodes, node);
+            if (i > 0)
+                add_named_edge(edges, default_nodes[i - 1].name, default_nodes[i].name);
+        }
+        return TRUE;
+    }
+
+    return parse_nodes(nodes, doc, yaml_util_get(doc, section, "nodes")) &&
+           parse_edges(edges, doc, yaml_util_get(doc, section, "edges"));
+}
+
+GieGraph *gie_graph_parse(yaml_document_t *doc)
+{
+    GArray *nodes = g_array_new(FALSE, FALSE, sizeof(GieNode));
+    GArray *edges = g_array_new(FALSE, FALSE, sizeof(NamedEdge));
+    g_array_set_clear_func(nodes, clear_node);
+    g_array_set_clear_func(edges, clear_named_edge);
+
+    gboolean ok = collect(nodes, edges, doc);
+    if (ok)
+        bridge_missing(nodes, edges);
+
+    GieGraph *graph = g_new0(GieGraph, 1);
+    ok = ok && build_graph(graph, nodes, edges);
+    g_array_free(nodes, TRUE);
+    g_array_free(edges, TRUE);
+    if (!ok) {
+        gie_graph_free(graph);
+        return NULL;
+    }
+    return graph;
+}
+
+GieGraph *gie_graph_load(const char *yaml_path)
+{
+    yaml_document_t doc;
+    if (!yaml_util_load(yaml_path, &doc, "gie_graph"))
+        return NULL;
+    GieGraph *graph = gie_graph_parse(&doc);
+    yaml_document_delete(&doc);
+    return graph;
+}
+
+void gie_graph_free(GieGraph *graph)
+{
+    if (!graph)
+        return;
+    for (guint i = 0; i < graph->n_nodes; i++) {
+        g_free(graph->nodes[i].name);
+        g_free(graph->nodes[i].config);
+    }
+    g_free(graph->nodes);
+    g_free(graph->edges);
+    g_free(graph);
+}
+
+gint gie_graph_find(const GieGraph *graph, const gchar *name)
+{
+    for (guint i = 0; i < graph->n_nodes; i++)
+        if (g_strcmp0(graph->nodes[i].name, name) == 0)
+            return (gint)i;
+    return -1;
+}
+
+guint gie_graph_successors(const GieGraph *graph, guint node, guint *out)
+{
+    guint n = 0;
+    for (guint i = 0; i < graph->n_edges; i++)
+        if (graph->edges[i].from == node)
+            out[n++] = graph->edges[i].to;
+    return n;
+}
+
+guint gie_graph_predecessors(const GieGraph *graph, guint node, guint *out)
+{
+    guint n = 0;
+    for (guint i = 0; i < graph->n_edges; i++)
+        if (graph->edges[i].to == node)
+            out[n++] = graph->edges[i].from;
+    return n;
+}
+
+guint gie_graph_exits(const GieGraph *graph, guint *out)
+{
+    guint n = 0, succ[GIE_GRAPH_MAX_NODES];
+    for (guint i = 0; i < graph->n_nodes; i++)
+        if (gie_graph_successors(graph, i, succ) == 0)
+            out[n++] = i;
+    return n;
+}
+
+guint32 gie_graph_ancestors(const GieGraph *graph, guint node)
+{
+    /* Predecessors have lower indices, so one pass in order suffices. */
+    guint32 ancestors[GIE_GRAPH_MAX_NODES] = { 0 };
+    for (guint i = 0; i <= node; i++) {
+        ancestors[i] = 1u << i;
+        for (guint e = 0; e < graph->n_edges; e++)
+            if (graph->edges[e].to == i)
+                ancestors[i] |= ancestors[graph->edges[e].from];
+    }
+    return ancestors[node];
+}
+
+const gchar *gie_graph_exit_name(const GieGraph *graph)
+{
+    guint exits[GIE_GRAPH_MAX_NODES];
+    guint n = gie_graph_exits(graph, exits);
+    return n == 1 ? graph->nodes[exits[0]].name : GIE_GRAPH_EXIT_JOIN;
+}
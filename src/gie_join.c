@@ -0,0 +1,159 @@
+#include <gst/gst.h>
+#include <gst/base/gstaggregator.h>
+
+#include "gstnvdsmeta.h"
+#include "gie_join.h"
+#include "logger.h"
+
+typedef struct {
+    GstAggregator parent;
+
+    MetaMergeComponents branches[GIE_JOIN_MAX_BRANCHES];
+    MetaMergeComponents all_branches;   /* union, for telling fan-out objects apart */
+    guint               n_branches;
+    MetaMerge          *merge;
+} TgGieJoin;
+
+typedef struct {
+    GstAggregatorClass parent_class;
+} TgGieJoinClass;
+
+GType tg_gie_join_get_type(void);
+G_DEFINE_TYPE(TgGieJoin, tg_gie_join, GST_TYPE_AGGREGATOR)
+
+static GstStaticPadTemplate sink_template =
+    GST_STATIC_PAD_TEMPLATE("sink_%u", GST_PAD_SINK, GST_PAD_REQUEST, GST_STATIC_CAPS_ANY);
+static GstStaticPadTemplate src_template =
+    GST_STATIC_PAD_TEMPLATE("src", GST_PAD_SRC, GST_PAD_ALWAYS, GST_STATIC_CAPS_ANY);
+
+static GstFlowReturn gie_join_aggregate(GstAggregator *agg, gboolean timeout)
+{
+    (void)timeout;
+    TgGieJoin *self = (TgGieJoin *)agg;
+    GstBuffer *out = NULL;
+    guint index = 0;
+
+    GST_OBJECT_LOCK(agg);
+    for (GList *l = GST_ELEMENT(agg)->sinkpads; l; l = l->next, index++) {
+        GstBuffer *buf = gst_aggregator_pad_pop_buffer(GST_AGGREGATOR_PAD(l->data));
+        if (!buf)
+            continue;
+        if (!out) {
+            out = buf;
+            continue;
+        }
+        if (index < self->n_branches)
+            meta_merge_batch(self->merge, gst_buffer_get_nvds_batch_meta(out),
+                             gst_buffer_get_nvds_batch_meta(buf),
+                             &self->branches[index], &self->all_branches);
+        gst_buffer_unref(buf);
+    }
+    GST_OBJECT_UNLOCK(agg);
+
+    /* Called with no buffer only once every pad is at EOS. */
+    if (!out)
+        return GST_FLOW_EOS;
+    return gst_aggregator_finish_buffer(agg, out);
+}
+
+/* Output caps are the branches' caps: the same batch went down every branch. */
+static GstFlowReturn gie_join_update_src_caps(GstAggregator *agg, GstCaps *caps, GstCaps **ret)
+{
+    (void)caps;
+    GstPad *first = GST_ELEMENT(agg)->sinkpads ? GST_ELEMENT(agg)->sinkpads->data : NULL;
+    GstCaps *current = first ? gst_pad_get_current_caps(first) : NULL;
+    if (!current)
+        return GST_AGGREGATOR_FLOW_NEED_DATA;
+    *ret = current;
+    return GST_FLOW_OK;
+}
+
+static void gie_join_finalize(GObject *object)
+{
+    meta_merge_free(((TgGieJoin *)object)->merge);
+    G_OBJECT_CLASS(tg_gie_join_parent_class)->finalize(object);
+}
+
+static void tg_gie_join_class_init(TgGieJoinClass *klass)
+{
+    GObjectClass       *gobject_class   = G_OBJECT_CLASS(klass);
+    GstElementClass    *element_class   = GST_ELEMENT_CLASS(klass);
+    GstAggregatorClass *aggregator_class = GST_AGGREGATOR_CLASS(klass);
+
+    gobject_class->finalize = gie_join_finalize;
+
+    gst_element_class_set_static_metadata(element_class, "Traffic Guard GIE join",
+        "Filter/Analyzer/Video", "Merges the metadata of parallel inference branches",
+        "traffic-guard");
+    gst_element_class_add_static_pad_template_with_gtype(element_class, &sink_template,
+                                                         GST_TYPE_AGGREGATOR_PAD);
+    gst_element_class_add_static_pad_template(element_class, &src_template);
+
+    aggregator_class->aggregate       = gie_join_aggregate;
+    aggregator_class->update_src_caps = gie_join_update_src_caps;
+}
+
+static void tg_gie_join_init(TgGieJoin *self)
+{
+    self->merge = meta_merge_new();
+}
+
+gboolean gie_join_register(void)
+{
+    return gst_element_register(NULL, GIE_JOIN_FACTORY, GST_RANK_NONE, tg_gie_join_get_type());
+}
+
+/* gst_buffer_copy runs the batch meta's copy function, so the copy owns new frame and object lists. */
+static GstPadProbeReturn copy_batch_meta_probe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+    (void)pad;
+    (void)user_data;
+    GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER(info);
+    if (!buf || !gst_buffer_get_nvds_batch_meta(buf))
+        return GST_PAD_PROBE_OK;
+    GST_PAD_PROBE_INFO_DATA(info) = gst_buffer_copy(buf);
+    gst_buffer_unref(buf);
+    return GST_PAD_PROBE_OK;
+}
+
+void gie_join_split_branch(GstElement *queue)
+{
+    GstPad *sinkpad = gst_element_get_static_pad(queue, "sink");
+    if (!sinkpad) {
+        log_warning("gie_join: %s has no sink pad to split", GST_ELEMENT_NAME(queue));
+        return;
+    }
+    gst_pad_add_probe(sinkpad, GST_PAD_PROBE_TYPE_BUFFER, copy_batch_meta_probe, NULL, NULL);
+    gst_object_unref(sinkpad);
+}
+
+gboolean gie_join_link_branch(GstElement                *join,
+                              GstElement                *upstream,
+                              const MetaMergeComponents *components)
+{
+    TgGieJoin *self = (TgGieJoin *)join;
+    if (self->n_branches == GIE_JOIN_MAX_BRANCHES) {
+        log_error("gie_join: %s has more than %u branches", GST_ELEMENT_NAME(join),
+                  GIE_JOIN_MAX_BRANCHES);
+        return FALSE;
+    }
+
+    GstPad *sinkpad = gst_element_request_pad_simple(join, "sink_%u");
+    GstPad *srcpad  = gst_element_get_static_pad(upstream, "src");
+    gboolean ok = sinkpad && srcpad && gst_pad_link(srcpad, sinkpad) == GST_PAD_LINK_OK;
+    if (srcpad)  gst_object_unref(srcpad);
+    if (sinkpad) gst_object_unref(sinkpad);
+    if (!ok) {
+        log_error("gie_join: failed to link %s → %s", GST_ELEMENT_NAME(upstream),
+                  GST_ELEMENT_NAME(join));
+        return FALSE;
+    }
+
+    /* Branches are linked before the pipeline starts, so aggregate never sees a partial set. */
+    GST_OBJECT_LOCK(join);
+    self->branches[self->n_branches++] = *components;
+    for (guint i = 0; i < components->n && self->all_branches.n < META_MERGE_MAX_COMPONENTS; i++)
+        self->all_branches.ids[self->all_branches.n++] = components->ids[i];
+    GST_OBJECT_UNLOCK(join);
+    return TRUE;
+}
@@ -0,0 +1,99 @@
+#include "load_control.h"
+
+/* Cheapest first: PGIE cadence, then make/type, then plate reads. */
+static const LoadLevel levels[LOAD_LEVEL_COUNT] = {
+    { 0, TRUE,  1 },
+    { 1, TRUE,  1 },
+    { 1, FALSE, 1 },
+    { 2, FALSE, 3 },
+    { 4, FALSE, 6 },
+};
+
+#define LOAD_CONTROL_MAX_BACKOFF 8
+
+struct LoadControl {
+    LoadControlOptions options;
+    LoadControlStats   stats;
+    gboolean           primed;
+    guint              hot_run;
+    guint              cool_run;
+    guint              since_down;   /* samples since a step down not yet reverted */
+    guint              backoff;      /* multiplier of down_samples */
+};
+
+LoadControl *load_control_new(const LoadControlOptions *options)
+{
+    LoadControl *lc = g_new0(LoadControl, 1);
+    lc->options = *options;
+    lc->options.max_level    = MIN(lc->options.max_level, LOAD_LEVEL_COUNT - 1);
+    lc->options.up_samples   = MAX(lc->options.up_samples, 1);
+    lc->options.down_samples = MAX(lc->options.down_samples, 1);
+    lc->options.smoothing    = CLAMP(lc->options.smoothing, 0.01, 1.0);
+    lc->since_down           = G_MAXUINT;
+    lc->backoff              = 1;
+    return lc;
+}
+
+void load_control_free(LoadControl *lc)
+{
+    g_free(lc);
+}
+
+guint load_control_update(LoadControl *lc, gdouble latency_ms, gdouble queue_fill)
+{
+    const LoadControlOptions *o = &lc->options;
+    LoadControlStats *s = &lc->stats;
+
+    gdouble previous = s->latency_ms;
+    s->latency_ms = lc->primed ? previous + o->smoothing * (latency_ms - previous) : latency_ms;
+    s->queue_fill = queue_fill;
+    gboolean improving = lc->primed && s->latency_ms < previous;
+    lc->primed = TRUE;
+
+    gboolean hot  = s->latency_ms > o->high_latency_ms || queue_fill > o->high_queue_fill;
+    gboolean cool = s->latency_ms < o->low_latency_ms  && queue_fill < o->low_queue_fill;
+
+    if (hot) {
+        lc->cool_run = 0;
+        /* A backlog draining after the last step needs time, not another step. */
+        if (!improving)
+            lc->hot_run++;
+    } else if (cool) {
+        lc->hot_run = 0;
+        lc->cool_run++;
+    } else {
+        lc->hot_run = lc->cool_run = 0;
+    }
+
+    if (lc->since_down < G_MAXUINT)
+        lc->since_down++;
+    /* A step down that held: the load has eased, probe faster again. */
+    if (lc->since_down == 2 * o->down_samples)
+        lc->backoff = MAX(lc->backoff / 2, 1);
+
+    if (lc->hot_run >= o->up_samples && s->level < o->max_level) {
+        /* The load still needs this level: wait longer before trying the one below again. */
+        if (lc->since_down < 2 * o->down_samples)
+            lc->backoff = MIN(lc->backoff * 2, LOAD_CONTROL_MAX_BACKOFF);
+        lc->since_down = G_MAXUINT;
+        s->level++;
+        s->steps_up++;
+        lc->hot_run = 0;
+    } else if (s->level > 0 && lc->cool_run >= o->down_samples * lc->backoff) {
+        s->level--;
+        s->steps_down++;
+        lc->cool_run   = 0;
+        lc->since_down = 0;
+    }
+    return s->level;
+}
+
+void load_control_get_stats(const LoadControl *lc, LoadControlStats *stats)
+{
+    *stats = lc->stats;
+}
+
+const LoadLevel *load_control_settings(guint level)
+{
+    return &levels[MIN(level, LOAD_LEVEL_COUNT - 1)];
+}
@@ -0,0 +1,213 @@
+#include <stdatomic.h>
+
+#include "load_shedder.h"
+#include "element_util.h"
+#include "frame_index.h"
+#include "metrics.h"
+#include "logger.h"
+
+typedef enum {
+    SHED_CLASSIFY,     /* make, type: off from the level that stops classification */
+    SHED_PLATE_READ,   /* LPR: runs on one frame in lpr_every */
+} ShedRole;
+
+struct LoadShedGate {
+    LoadShedder *ls;
+    ShedRole     role;
+    gint         component;   /* operate-on-gie-id of the SGIE */
+};
+
+struct LoadShedder {
+    LoadControl  *control;
+    atomic_uint   level;
+    atomic_llong  worst_latency_us;   /* -1: no buffer since the last tick */
+    gdouble       last_latency_ms;
+    GstElement   *pgie;
+    guint         pgie_interval;      /* at level 0 */
+    GPtrArray    *queues;
+    GPtrArray    *gates;
+
+    MetricsGauge   *level_gauge;
+    MetricsGauge   *latency_gauge;
+    MetricsGauge   *fill_gauge;
+    MetricsCounter *steps_up;
+    MetricsCounter *steps_down;
+};
+
+LoadShedder *load_shedder_new(const LoadControlOptions *options)
+{
+    LoadShedder *ls = g_new0(LoadShedder, 1);
+    ls->control = load_control_new(options);
+    atomic_init(&ls->level, 0);
+    atomic_init(&ls->worst_latency_us, -1);
+    ls->queues = g_ptr_array_new_with_free_func(gst_object_unref);
+    ls->gates  = g_ptr_array_new_with_free_func(g_free);
+
+    ls->level_gauge   = metrics_gauge("traffic_guard_load_level",
+                                      "Degradation level of the load controller (0 = full work).",
+                                      NULL, NULL);
+    ls->latency_gauge = metrics_gauge("traffic_guard_load_latency_ms",
+                                      "Smoothed end-to-end latency seen by the load controller.",
+                                      NULL, NULL);
+    ls->fill_gauge    = metrics_gauge("traffic_guard_load_queue_fill_ratio",
+                                      "Fill of the fullest watched queue, 0..1.", NULL, NULL);
+    ls->steps_up      = metrics_counter("traffic_guard_load_level_changes_total",
+                                        "Load controller level changes.", "direction", "up", FALSE);
+    ls->steps_down    = metrics_counter("traffic_guard_load_level_changes_total",
+                                        "Load controller level changes.", "direction", "down", FALSE);
+    return ls;
+}
+
+void load_shedder_free(LoadShedder *ls)
+{
+    if (!ls)
+        return;
+    if (ls->pgie)
+        gst_object_unref(ls->pgie);
+    g_ptr_array_free(ls->queues, TRUE);
+    g_ptr_array_free(ls->gates, TRUE);
+    load_control_free(ls->control);
+    g_free(ls);
+}
+
+void load_shedder_set_pgie(LoadShedder *ls, GstElement *pgie)
+{
+    if (!element_util_has_property(pgie, "interval")) {
+        log_warning("load_shedder: %s has no interval property, PGIE cadence left alone",
+                    GST_ELEMENT_NAME(pgie));
+        return;
+    }
+    if (ls->pgie)
+        gst_object_unref(ls->pgie);
+    ls->pgie = gst_object_ref(pgie);
+    /* The configured interval is the level 0 one; a level never lowers it. */
+    g_object_get(G_OBJECT(pgie), "interval", &ls->pgie_interval, NULL);
+}
+
+static void apply_pgie_interval(LoadShedder *ls, guint level)
+{
+    if (ls->pgie)
+        g_object_set(G_OBJECT(ls->pgie), "interval",
+                     MAX(ls->pgie_interval, load_control_settings(level)->pgie_interval), NULL);
+}
+
+void load_shedder_set_pgie_interval(LoadShedder *ls, guint interval)
+{
+    ls->pgie_interval = interval;
+    apply_pgie_interval(ls, atomic_load_explicit(&ls->level, memory_order_relaxed));
+}
+
+void load_shedder_add_queue(LoadShedder *ls, GstElement *queue)
+{
+    g_ptr_array_add(ls->queues, gst_object_ref(queue));
+}
+
+LoadShedGate *load_shedder_gate(LoadShedder *ls, GstElement *sgie)
+{
+    if (!element_util_has_property(sgie, "unique-id") ||
+        !element_util_has_property(sgie, "operate-on-gie-id"))
+        return NULL;
+
+    guint id = 0;
+    gint operate_on = -1;
+    g_object_get(G_OBJECT(sgie), "unique-id", &id, "operate-on-gie-id", &operate_on, NULL);
+    ShedRole role;
+    if (id == GIE_ID_VEHICLE_MAKE || id == GIE_ID_VEHICLE_TYPE)
+        role = SHED_CLASSIFY;
+    else if (id == GIE_ID_PLATE_READER)
+        role = SHED_PLATE_READ;
+    else
+        return NULL;
+    if (operate_on < 0) {
+        log_warning("load_shedder: %s operates on every GIE, not shed", GST_ELEMENT_NAME(sgie));
+        return NULL;
+    }
+
+    LoadShedGate *gate = g_new0(LoadShedGate, 1);
+    gate->ls        = ls;
+    gate->role      = role;
+    gate->component = operate_on;
+    g_ptr_array_add(ls->gates, gate);
+    return gate;
+}
+
+static gboolean shed(const LoadShedGate *gate, const NvDsFrameMeta *frame_meta)
+{
+    const LoadLevel *level = load_control_settings(atomic_load_explicit(&gate->ls->level,
+                                                                        memory_order_relaxed));
+    if (gate->role == SHED_CLASSIFY)
+        return !level->classify;
+    return level->lpr_every > 1 && frame_meta->frame_num % level->lpr_every != 0;
+}
+
+guint load_shedder_hide_frame(const LoadShedGate *gate, NvDsFrameMeta *frame_meta)
+{
+    if (!shed(gate, frame_meta))
+        return 0;
+    guint hidden = 0;
+    for (NvDsMetaList *l = frame_meta->obj_meta_list; l; l = l->next) {
+        NvDsObjectMeta *obj = (NvDsObjectMeta *)l->data;
+        if (obj->unique_component_id == gate->component) {
+            obj->unique_component_id += LOAD_SHED_COMPONENT_OFFSET;
+            hidden++;
+        }
+    }
+    return hidden;
+}
+
+void load_shedder_restore_frame(const LoadShedGate *gate, NvDsFrameMeta *frame_meta)
+{
+    for (NvDsMetaList *l = frame_meta->obj_meta_list; l; l = l->next) {
+        NvDsObjectMeta *obj = (NvDsObjectMeta *)l->data;
+        if (obj->unique_component_id == gate->component + LOAD_SHED_COMPONENT_OFFSET)
+            obj->unique_component_id = gate->component;
+    }
+}
+
+void load_shedder_note_latency(LoadShedder *ls, gint64 latency_us)
+{
+    long long worst = atomic_load_explicit(&ls->worst_latency_us, memory_order_relaxed);
+    while (latency_us > worst &&
+           !atomic_compare_exchange_weak_explicit(&ls->worst_latency_us, &worst, latency_us,
+                                                  memory_order_relaxed, memory_order_relaxed))
+        ;
+}
+
+static gdouble queue_fill(GstElement *queue)
+{
+    guint buffers = 0, max_buffers = 0;
+    guint64 time = 0, max_time = 0;
+    element_util_queue_level(queue, "current-level-buffers", &buffers, "max-size-buffers", &max_buffers,
+                                    "current-level-time", &time, "max-size-time", &max_time, NULL);
+    if (max_buffers)
+        return (gdouble)buffers / max_buffers;
+    if (max_time)
+        return (gdouble)time / (gdouble)max_time;
+    return 0.0;
+}
+
+gboolean load_shedder_tick(LoadShedder *ls, LoadControlStats *stats)
+{
+    long long worst = atomic_exchange_explicit(&ls->worst_latency_us, -1, memory_order_relaxed);
+    /* Nothing reached the sink: keep the last reading, queue fill shows a stall. */
+    if (worst >= 0)
+        ls->last_latency_ms = worst / 1000.0;
+
+    gdouble fill = 0.0;
+    for (guint i = 0; i < ls->queues->len; i++)
+        fill = MAX(fill, queue_fill(g_ptr_array_index(ls->queues, i)));
+
+    guint before = atomic_load_explicit(&ls->level, memory_order_relaxed);
+    guint level  = load_control_update(ls->control, ls->last_latency_ms, fill);
+    load_control_get_stats(ls->control, stats);
+    metrics_gauge_set(ls->latency_gauge, stats->latency_ms);
+    metrics_gauge_set(ls->fill_gauge, fill);
+    if (level == before)
+        return FALSE;
+
+    atomic_store_explicit(&ls->level, level, memory_order_relaxed);
+    apply_pgie_interval(ls, level);
+    metrics_gauge_set(ls->level_gauge, level);
+    metrics_counter_add(level > before ? ls->steps_up : ls->steps_down, 1);
+    return TRUE;
+}
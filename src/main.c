@@ -4,7 +4,9 @@
 #include "config.h"
 #include "director.h"
 #include "logger.h"
+#include "metrics_server.h"
 #include "pipeline_controller.h"
+#include "pipeline_metrics.h"
 
 int main(int argc, char *argv[])
 {
@@ -30,10 +32,17 @@ int main(int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
+    MetricsServer *metrics = NULL;
+    const AppSettings *settings = g_object_get_data(G_OBJECT(pipeline), "settings");
+    if (settings->metrics_port)
+        metrics = metrics_server_new((guint16)settings->metrics_port);
+    pipeline_metrics_watch(metrics, pipeline);
+
     pipeline_controller_play(controller);
     pipeline_controller_run_loop(controller);
     pipeline_controller_stop(controller);
     pipeline_controller_free(controller);
+    metrics_server_free(metrics);
     gst_object_unref(pipeline);
 
     return EXIT_SUCCESS;
@@ -0,0 +1,153 @@
+#include "meta_merge.h"
+
+typedef struct {
+    NvDsObjectMeta *from;
+    NvDsObjectMeta *into;
+} ObjectPair;
+
+struct MetaMerge {
+    GArray *pairs;   /* ObjectPair, reused between frames */
+};
+
+MetaMerge *meta_merge_new(void)
+{
+    MetaMerge *merge = g_new0(MetaMerge, 1);
+    merge->pairs = g_array_sized_new(FALSE, FALSE, sizeof(ObjectPair), 64);
+    return merge;
+}
+
+void meta_merge_free(MetaMerge *merge)
+{
+    if (!merge)
+        return;
+    g_array_free(merge->pairs, TRUE);
+    g_free(merge);
+}
+
+static gboolean has_component(const MetaMergeComponents *set, gint id)
+{
+    for (guint i = 0; i < set->n; i++)
+        if (set->ids[i] == id)
+            return TRUE;
+    return FALSE;
+}
+
+static NvDsObjectMeta *paired(const GArray *pairs, const NvDsObjectMeta *from)
+{
+    for (guint i = 0; i < pairs->len; i++)
+        if (g_array_index(pairs, ObjectPair, i).from == from)
+            return g_array_index(pairs, ObjectPair, i).into;
+    return NULL;
+}
+
+static void copy_classifier(NvDsBatchMeta *batch_meta, NvDsObjectMeta *obj,
+                            const NvDsClassifierMeta *src)
+{
+    NvDsClassifierMeta *cm = nvds_acquire_classifier_meta_from_pool(batch_meta);
+    cm->num_labels          = src->num_labels;
+    cm->unique_component_id = src->unique_component_id;
+    for (GList *l = src->label_info_list; l; l = l->next) {
+        const NvDsLabelInfo *src_li = l->data;
+        NvDsLabelInfo *li = nvds_acquire_label_info_meta_from_pool(batch_meta);
+        li->num_classes     = src_li->num_classes;
+        li->result_class_id = src_li->result_class_id;
+        li->label_id        = src_li->label_id;
+        li->result_prob     = src_li->result_prob;
+        /* pResult_label belongs to the source pool; long labels are cut to result_label. */
+        g_strlcpy(li->result_label, src_li->pResult_label ? src_li->pResult_label : src_li->result_label,
+                  sizeof(li->result_label));
+        nvds_add_label_info_meta_to_classifier(cm, li);
+    }
+    nvds_add_classifier_meta_to_object(obj, cm);
+}
+
+static guint copy_classifiers(NvDsBatchMeta *batch_meta, NvDsObjectMeta *into,
+                              const NvDsObjectMeta *from, const MetaMergeComponents *branch)
+{
+    guint copied = 0;
+    for (GList *l = from->classifier_meta_list; l; l = l->next) {
+        const NvDsClassifierMeta *cm = l->data;
+        if (has_component(branch, cm->unique_component_id)) {
+            copy_classifier(batch_meta, into, cm);
+            copied++;
+        }
+    }
+    return copied;
+}
+
+static NvDsObjectMeta *copy_object(NvDsBatchMeta *batch_meta, NvDsFrameMeta *frame_meta,
+                                   const NvDsObjectMeta *src, NvDsObjectMeta *parent)
+{
+    NvDsObjectMeta *obj = nvds_acquire_obj_meta_from_pool(batch_meta);
+    obj->unique_component_id = src->unique_component_id;
+    obj->class_id            = src->class_id;
+    obj->object_id           = src->object_id;
+    obj->confidence          = src->confidence;
+    obj->tracker_confidence  = src->tracker_confidence;
+    obj->rect_params         = src->rect_params;
+    obj->detector_bbox_info  = src->detector_bbox_info;
+    obj->tracker_bbox_info   = src->tracker_bbox_info;
+    g_strlcpy(obj->obj_label, src->obj_label, sizeof(obj->obj_label));
+    nvds_add_obj_meta_to_frame(frame_meta, obj, parent);
+    return obj;
+}
+
+static guint merge_frame(MetaMerge *merge, NvDsBatchMeta *batch_meta,
+                         NvDsFrameMeta *into, const NvDsFrameMeta *from,
+                         const MetaMergeComponents *branch, const MetaMergeComponents *all_branches)
+{
+    guint copied = 0;
+    g_array_set_size(merge->pairs, 0);
+
+    /* Objects present at the fan-out: the same sequence in both lists. */
+    GList *into_l = into->obj_meta_list;
+    for (GList *l = from->obj_meta_list; l; l = l->next) {
+        NvDsObjectMeta *obj = l->data;
+        if (has_component(all_branches, obj->unique_component_id))
+            continue;
+        while (into_l && has_component(all_branches, ((NvDsObjectMeta *)into_l->data)->unique_component_id))
+            into_l = into_l->next;
+        if (!into_l)
+            break;
+        ObjectPair pair = { obj, into_l->data };
+        g_array_append_val(merge->pairs, pair);
+        copied += copy_classifiers(batch_meta, pair.into, obj, branch);
+        into_l = into_l->next;
+    }
+
+    /* Branch objects; a parent precedes its children in the list, as nvinfer appends them. */
+    for (GList *l = from->obj_meta_list; l; l = l->next) {
+        NvDsObjectMeta *obj = l->data;
+        if (!has_component(branch, obj->unique_component_id))
+            continue;
+        NvDsObjectMeta *parent = obj->parent ? paired(merge->pairs, obj->parent) : NULL;
+        ObjectPair pair = { obj, copy_object(batch_meta, into, obj, parent) };
+        g_array_append_val(merge->pairs, pair);
+        copied += 1 + copy_classifiers(batch_meta, pair.into, obj, branch);
+    }
+    return copied;
+}
+
+guint meta_merge_batch(MetaMerge                 *merge,
+                       NvDsBatchMeta             *into,
+                       NvDsBatchMeta             *from,
+                       const MetaMergeComponents *branch,
+                       const MetaMergeComponents *all_branches)
+{
+    if (!into || !from || into == from || branch->n == 0)
+        return 0;
+
+    guint copied = 0;
+    nvds_acquire_meta_lock(into);
+    GList *into_l = into->frame_meta_list;
+    for (GList *l = from->frame_meta_list; l && into_l; l = l->next, into_l = into_l->next) {
+        NvDsFrameMeta *into_frame = into_l->data;
+        const NvDsFrameMeta *from_frame = l->data;
+        if (into_frame->source_id != from_frame->source_id ||
+            into_frame->frame_num != from_frame->frame_num)
+            continue;
+        copied += merge_frame(merge, into, into_frame, from_frame, branch, all_branches);
+    }
+    nvds_release_meta_lock(into);
+    return copied;
+}
@@ -0,0 +1,101 @@
+#include <stdatomic.h>
+
+#include "gstnvdsmeta.h"
+
+#include "meta_stage.h"
+#include "logger.h"
+
+#define META_STAGE_MAX_CONSUMERS 16
+
+typedef struct {
+    gchar            *name;
+    MetaStageConsumer consumer;
+    gpointer          user_data;
+} Consumer;
+
+struct MetaStage {
+    FrameIndex *index;
+    Consumer    consumers[META_STAGE_MAX_CONSUMERS];
+    guint       n_consumers;
+
+    GMutex      lock;                                   /* min_prob */
+    gfloat      min_prob[FRAME_INDEX_MAX_COMPONENTS];   /* for the index, from the next batch */
+    atomic_bool min_prob_changed;
+};
+
+MetaStage *meta_stage_new(void)
+{
+    MetaStage *stage = g_new0(MetaStage, 1);
+    stage->index = frame_index_new();
+    g_mutex_init(&stage->lock);
+    atomic_init(&stage->min_prob_changed, FALSE);
+    return stage;
+}
+
+void meta_stage_free(MetaStage *stage)
+{
+    if (!stage)
+        return;
+    for (guint i = 0; i < stage->n_consumers; i++)
+        g_free(stage->consumers[i].name);
+    frame_index_free(stage->index);
+    g_mutex_clear(&stage->lock);
+    g_free(stage);
+}
+
+void meta_stage_add_consumer(MetaStage        *stage,
+                             const gchar      *name,
+                             MetaStageConsumer consumer,
+                             gpointer          user_data)
+{
+    if (stage->n_consumers == META_STAGE_MAX_CONSUMERS) {
+        log_error("meta_stage: too many consumers, '%s' not registered", name);
+        return;
+    }
+    Consumer *c  = &stage->consumers[stage->n_consumers++];
+    c->name      = g_strdup(name);
+    c->consumer  = consumer;
+    c->user_data = user_data;
+}
+
+void meta_stage_set_min_prob(MetaStage *stage, gint component_id, gfloat min_prob)
+{
+    if (component_id < 0 || component_id >= FRAME_INDEX_MAX_COMPONENTS)
+        return;
+    g_mutex_lock(&stage->lock);
+    stage->min_prob[component_id] = min_prob;
+    g_mutex_unlock(&stage->lock);
+    atomic_store_explicit(&stage->min_prob_changed, TRUE, memory_order_release);
+}
+
+void meta_stage_process(MetaStage *stage, NvDsBatchMeta *batch_meta)
+{
+    if (!batch_meta || stage->n_consumers == 0)
+        return;
+
+    if (atomic_exchange_explicit(&stage->min_prob_changed, FALSE, memory_order_acquire)) {
+        g_mutex_lock(&stage->lock);
+        for (gint i = 0; i < FRAME_INDEX_MAX_COMPONENTS; i++)
+            frame_index_set_min_prob(stage->index, i, stage->min_prob[i]);
+        g_mutex_unlock(&stage->lock);
+    }
+
+    for (NvDsMetaList *l_frame = batch_meta->frame_meta_list; l_frame != NULL;
+         l_frame = l_frame->next) {
+        NvDsFrameMeta *frame_meta = (NvDsFrameMeta *)(l_frame->data);
+        frame_index_build(stage->index, batch_meta, frame_meta);
+        for (guint i = 0; i < stage->n_consumers; i++)
+            stage->consumers[i].consumer(stage->index, stage->consumers[i].user_data);
+    }
+}
+
+GstPadProbeReturn meta_stage_probe(GstPad          *pad,
+                                   GstPadProbeInfo *info,
+                                   gpointer         user_data)
+{
+    (void)pad;
+
+    GstBuffer *buf = (GstBuffer *)info->data;
+    meta_stage_process((MetaStage *)user_data, gst_buffer_get_nvds_batch_meta(buf));
+    return GST_PAD_PROBE_OK;
+}
@@ -0,0 +1,204 @@
+#include <stdatomic.h>
+#include <string.h>
+
+#include "metrics.h"
+#include "logger.h"
+
+typedef enum {
+    METRIC_COUNTER,
+    METRIC_GAUGE,
+} MetricKind;
+
+typedef struct MetricsSeries MetricsSeries;
+
+struct MetricsSeries {
+    MetricKind            kind;
+    gchar                 name[METRICS_NAME_MAX];
+    gchar                 rate_name[METRICS_NAME_MAX];   /* empty without a rate */
+    gchar                 help[METRICS_HELP_MAX];
+    gchar                 labels[METRICS_LABEL_MAX];     /* key="value", or empty */
+    atomic_uint_least64_t value;                         /* count, or gauge bits */
+    atomic_uint_least64_t rate_bits;
+    guint64               last;                          /* metrics_tick only */
+};
+
+static MetricsSeries series[METRICS_MAX_SERIES];
+static atomic_uint   n_series;
+static GMutex        register_lock;
+
+static inline guint64 double_bits(gdouble v)
+{
+    guint64 bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return bits;
+}
+
+static inline gdouble bits_double(guint64 bits)
+{
+    gdouble v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+static void format_labels(gchar *out, gsize size, const gchar *key, const gchar *value)
+{
+    if (!key) {
+        out[0] = '\0';
+        return;
+    }
+    GString *s = g_string_new(key);
+    g_string_append(s, "=\"");
+    for (const gchar *p = value ? value : ""; *p; p++) {
+        if (*p == '\\' || *p == '"')
+            g_string_append_c(s, '\\');
+        if (*p == '\n')
+            g_string_append(s, "\\n");
+        else
+            g_string_append_c(s, *p);
+    }
+    g_string_append_c(s, '"');
+    g_strlcpy(out, s->str, size);
+    g_string_free(s, TRUE);
+}
+
+static MetricsSeries *lookup_or_register(MetricKind kind, const gchar *name, const gchar *help,
+                                         const gchar *label_key, const gchar *label_value,
+                                         gboolean rate)
+{
+    gchar labels[METRICS_LABEL_MAX];
+    format_labels(labels, sizeof(labels), label_key, label_value);
+
+    MetricsSeries *s = NULL;
+    g_mutex_lock(&register_lock);
+    guint n = atomic_load_explicit(&n_series, memory_order_relaxed);
+    for (guint i = 0; i < n && !s; i++) {
+        if (series[i].kind == kind && strcmp(series[i].name, name) == 0 &&
+            strcmp(series[i].labels, labels) == 0)
+            s = &series[i];
+    }
+    if (!s && n < METRICS_MAX_SERIES) {
+        s = &series[n];
+        s->kind = kind;
+        g_strlcpy(s->name,   name, sizeof(s->name));
+        g_strlcpy(s->help,   help ? help : "", sizeof(s->help));
+        g_strlcpy(s->labels, labels, sizeof(s->labels));
+        if (rate) {
+            gsize len = strlen(name);
+            if (g_str_has_suffix(name, "_total"))
+                len -= strlen("_total");
+            g_snprintf(s->rate_name, sizeof(s->rate_name), "%.*s_per_second", (int)len, name);
+        }
+        /* Publish after the series is filled, for renders on the exporter thread. */
+        atomic_store_explicit(&n_series, n + 1, memory_order_release);
+    }
+    g_mutex_unlock(&register_lock);
+    if (!s)
+        log_warning("metrics: no series left for %s{%s}", name, labels);
+    return s;
+}
+
+MetricsCounter *metrics_counter(const gchar *name, const gchar *help,
+                                const gchar *label_key, const gchar *label_value,
+                                gboolean rate)
+{
+    return lookup_or_register(METRIC_COUNTER, name, help, label_key, label_value, rate);
+}
+
+void metrics_counter_add(MetricsCounter *counter, guint64 n)
+{
+    if (counter)
+        atomic_fetch_add_explicit(&counter->value, n, memory_order_relaxed);
+}
+
+guint64 metrics_counter_get(MetricsCounter *counter)
+{
+    return counter ? atomic_load_explicit(&counter->value, memory_order_relaxed) : 0;
+}
+
+MetricsGauge *metrics_gauge(const gchar *name, const gchar *help,
+                            const gchar *label_key, const gchar *label_value)
+{
+    return lookup_or_register(METRIC_GAUGE, name, help, label_key, label_value, FALSE);
+}
+
+void metrics_gauge_set(MetricsGauge *gauge, gdouble value)
+{
+    if (gauge)
+        atomic_store_explicit(&gauge->value, double_bits(value), memory_order_relaxed);
+}
+
+void metrics_tick(gdouble elapsed_s)
+{
+    guint n = atomic_load_explicit(&n_series, memory_order_acquire);
+    for (guint i = 0; i < n; i++) {
+        MetricsSeries *s = &series[i];
+        if (!s->rate_name[0])
+            continue;
+        guint64 now = atomic_load_explicit(&s->value, memory_order_relaxed);
+        gdouble rate = elapsed_s > 0.0 ? (gdouble)(now - s->last) / elapsed_s : 0.0;
+        s->last = now;
+        atomic_store_explicit(&s->rate_bits, double_bits(rate), memory_order_relaxed);
+    }
+}
+
+static void append_double(GString *out, gdouble v)
+{
+    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+    g_string_append(out, g_ascii_formatd(buf, sizeof(buf), "%.15g", v));
+}
+
+static void append_sample(GString *out, const gchar *name, const gchar *labels)
+{
+    g_string_append(out, name);
+    if (labels[0])
+        g_string_append_printf(out, "{%s}", labels);
+    g_string_append_c(out, ' ');
+}
+
+/* One family per name, in first-registration order; rates are families of their own. */
+static void render_families(GString *out, guint n, gboolean rates)
+{
+    for (guint i = 0; i < n; i++) {
+        const MetricsSeries *first = &series[i];
+        const gchar *name = rates ? first->rate_name : first->name;
+        if (!name[0])
+            continue;
+
+        gboolean seen = FALSE;
+        for (guint j = 0; j < i && !seen; j++)
+            seen = strcmp(rates ? series[j].rate_name : series[j].name, name) == 0;
+        if (seen)
+            continue;
+
+        if (rates)
+            g_string_append_printf(out, "# HELP %s Per-second rate of %s over the last tick.\n"
+                                        "# TYPE %s gauge\n", name, first->name, name);
+        else
+            g_string_append_printf(out, "# HELP %s %s\n# TYPE %s %s\n", name, first->help, name,
+                                   first->kind == METRIC_COUNTER ? "counter" : "gauge");
+
+        for (guint k = i; k < n; k++) {
+            const MetricsSeries *s = &series[k];
+            if (strcmp(rates ? s->rate_name : s->name, name) != 0)
+                continue;
+            append_sample(out, name, s->labels);
+            if (rates)
+                append_double(out, bits_double(atomic_load_explicit(&s->rate_bits,
+                                                                    memory_order_relaxed)));
+            else if (s->kind == METRIC_COUNTER)
+                g_string_append_printf(out, "%" G_GUINT64_FORMAT,
+                                       atomic_load_explicit(&s->value, memory_order_relaxed));
+            else
+                append_double(out, bits_double(atomic_load_explicit(&s->value,
+                                                                    memory_order_relaxed)));
+            g_string_append_c(out, '\n');
+        }
+    }
+}
+
+void metrics_render(GString *out)
+{
+    guint n = atomic_load_explicit(&n_series, memory_order_acquire);
+    render_families(out, n, FALSE);
+    render_families(out, n, TRUE);
+}
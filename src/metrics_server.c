@@ -0,0 +1,248 @@
+#define _GNU_SOURCE   /* accept4, pipe2 */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "metrics_server.h"
+#include "metrics.h"
+#include "logger.h"
+
+#define TICK_US          G_USEC_PER_SEC
+#define REQUEST_MAX      4096
+#define CLIENT_TIMEOUT_S 2
+
+typedef struct {
+    MetricsCollectFunc collect;
+    gpointer           user_data;
+    GDestroyNotify     destroy;
+} Collector;
+
+struct MetricsServer {
+    int           listen_fd;
+    int           wake_fds[2];
+    GThread      *thread;
+    GMutex        lock;         /* guards collectors */
+    GArray       *collectors;   /* Collector */
+    GString      *body;         /* exporter thread only */
+    MetricsGauge *rss;
+};
+
+static void collect_rss(MetricsServer *server)
+{
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (!f)
+        return;
+    unsigned long size = 0, resident = 0;
+    if (fscanf(f, "%lu %lu", &size, &resident) == 2)
+        metrics_gauge_set(server->rss, (gdouble)resident * (gdouble)sysconf(_SC_PAGESIZE));
+    fclose(f);
+}
+
+static void collect(MetricsServer *server)
+{
+    collect_rss(server);
+    g_mutex_lock(&server->lock);
+    for (guint i = 0; i < server->collectors->len; i++) {
+        const Collector *c = &g_array_index(server->collectors, Collector, i);
+        c->collect(c->user_data);
+    }
+    g_mutex_unlock(&server->lock);
+}
+
+static gboolean send_all(int fd, const gchar *data, gsize len)
+{
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return FALSE;
+        data += n;
+        len  -= (gsize)n;
+    }
+    return TRUE;
+}
+
+static gboolean is_metrics_request(const gchar *request)
+{
+    if (!g_str_has_prefix(request, "GET /metrics"))
+        return FALSE;
+    gchar next = request[strlen("GET /metrics")];
+    return next == ' ' || next == '?';
+}
+
+static void serve_client(MetricsServer *server, int fd)
+{
+    struct timeval timeout = { .tv_sec = CLIENT_TIMEOUT_S };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    /* Only the request line matters; the rest of the headers are read and ignored. */
+    gchar request[REQUEST_MAX + 1];
+    gsize len = 0;
+    while (len < REQUEST_MAX) {
+        ssize_t n = recv(fd, request + len, REQUEST_MAX - len, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        len += (gsize)n;
+        request[len] = '\0';
+        if (strstr(request, "\r\n\r\n"))
+            break;
+    }
+    request[len] = '\0';
+
+    GString *body = server->body;
+    g_string_truncate(body, 0);
+    const gchar *status = "404 Not Found";
+    if (is_metrics_request(request)) {
+        status = "200 OK";
+        collect(server);
+        metrics_render(body);
+    } else {
+        g_string_append(body, "not found; metrics are at /metrics\n");
+    }
+
+    gchar header[256];
+    int header_len = g_snprintf(header, sizeof(header),
+                                "HTTP/1.1 %s\r\n"
+                                "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                                "Content-Length: %" G_GSIZE_FORMAT "\r\n"
+                                "Connection: close\r\n\r\n",
+                                status, body->len);
+    if (send_all(fd, header, (gsize)header_len))
+        send_all(fd, body->str, body->len);
+}
+
+static gpointer serve(gpointer data)
+{
+    MetricsServer *server = (MetricsServer *)data;
+    gint64 last_tick = g_get_monotonic_time();
+
+    for (;;) {
+        gint64 now = g_get_monotonic_time();
+        int wait_ms = (int)MAX((last_tick + TICK_US - now) / 1000, 0);
+        struct pollfd fds[2] = {
+            { .fd = server->listen_fd,   .events = POLLIN },
+            { .fd = server->wake_fds[0], .events = POLLIN },
+        };
+        int ready = poll(fds, 2, wait_ms);
+        if (ready < 0 && errno != EINTR) {
+            log_error("metrics_server: poll failed: %s", g_strerror(errno));
+            break;
+        }
+        if (ready > 0 && fds[1].revents)
+            break;
+
+        now = g_get_monotonic_time();
+        if (now - last_tick >= TICK_US) {
+            metrics_tick((gdouble)(now - last_tick) / G_USEC_PER_SEC);
+            last_tick = now;
+        }
+
+        if (ready > 0 && (fds[0].revents & POLLIN)) {
+            int fd = accept4(server->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+            if (fd >= 0) {
+                serve_client(server, fd);
+                close(fd);
+            }
+        }
+    }
+    return NULL;
+}
+
+static int open_listener(guint16 port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr = {
+        .sin_family      = AF_INET,
+        .sin_port        = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+MetricsServer *metrics_server_new(guint16 port)
+{
+    int listen_fd = open_listener(port);
+    if (listen_fd < 0) {
+        log_error("metrics_server: cannot listen on port %u: %s", port, g_strerror(errno));
+        return NULL;
+    }
+
+    MetricsServer *server = g_new0(MetricsServer, 1);
+    server->listen_fd = listen_fd;
+    if (pipe2(server->wake_fds, O_CLOEXEC) != 0) {
+        log_error("metrics_server: pipe failed: %s", g_strerror(errno));
+        close(listen_fd);
+        g_free(server);
+        return NULL;
+    }
+    g_mutex_init(&server->lock);
+    server->collectors = g_array_new(FALSE, FALSE, sizeof(Collector));
+    server->body       = g_string_sized_new(16384);
+    server->rss        = metrics_gauge("process_resident_memory_bytes",
+                                       "Resident set size in bytes.", NULL, NULL);
+    server->thread     = g_thread_new("metrics-http", serve, server);
+
+    log_info("metrics_server: serving http://0.0.0.0:%u/metrics", port);
+    return server;
+}
+
+void metrics_server_free(MetricsServer *server)
+{
+    if (!server)
+        return;
+
+    const gchar stop = 1;
+    while (write(server->wake_fds[1], &stop, 1) < 0 && errno == EINTR)
+        ;
+    g_thread_join(server->thread);
+
+    close(server->listen_fd);
+    close(server->wake_fds[0]);
+    close(server->wake_fds[1]);
+
+    for (guint i = 0; i < server->collectors->len; i++) {
+        const Collector *c = &g_array_index(server->collectors, Collector, i);
+        if (c->destroy)
+            c->destroy(c->user_data);
+    }
+    g_array_free(server->collectors, TRUE);
+    g_string_free(server->body, TRUE);
+    g_mutex_clear(&server->lock);
+    g_free(server);
+}
+
+void metrics_server_add_collector(MetricsServer     *server,
+                                  MetricsCollectFunc collect,
+                                  gpointer           user_data,
+                                  GDestroyNotify     destroy)
+{
+    if (!server || !collect)
+        return;
+    Collector c = { .collect = collect, .user_data = user_data, .destroy = destroy };
+    g_mutex_lock(&server->lock);
+    g_array_append_val(server->collectors, c);
+    g_mutex_unlock(&server->lock);
+}
@@ -0,0 +1,616 @@
+#include <errno.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <mosquitto.h>
+#include <zlib.h>
+
+#include "mqtt_publisher.h"
+#include "spsc_ring.h"
+#include "metrics.h"
+#include "logger.h"
+
+#define CONNECT_RETRY_US  G_TIME_SPAN_SECOND
+#define IDLE_POLL_MS      5
+#define DRAIN_TIMEOUT_US  (2 * G_TIME_SPAN_SECOND)
+/* Replay is rate-limited upstream: a few ticks of it fit. */
+#define REPLAY_SLOTS      1024
+
+typedef struct {
+    gint64  posted_us;
+    guint32 len;
+    guint8  data[];
+} EventSlot;
+
+typedef struct {
+    gint64 oldest_us;
+    guint  events;
+} Inflight;
+
+/* Where an event sits in the batch, framing excluded. */
+typedef struct {
+    guint32 start;
+    guint32 end;
+} BatchEvent;
+
+struct MqttPublisher {
+    MqttPublisherOptions options;
+    gchar               *host;
+    gchar               *topic;
+    gchar               *client_id;
+    struct mosquitto    *mosq;
+    SpscRing            *live;
+    SpscRing            *replayed;
+
+    /* I/O thread only. */
+    guint8              *batch;
+    gsize                batch_cap;
+    gsize                batch_len;
+    GArray              *batch_events;     /* BatchEvent of each event in batch */
+    gint64               batch_oldest_us;
+    guint8              *deflated;
+    gsize                deflated_cap;
+    GHashTable          *inflight;         /* mid -> Inflight * */
+    gboolean             early;            /* on_publish ran inside mosquitto_publish */
+    gint                 early_mid;
+    gboolean             socket_up;
+    gboolean             down_logged;
+    gint64               next_connect_us;
+    gint64               next_metrics_us;
+    guint64              window_sum_us;
+    guint64              window_max_us;
+    guint                window_n;
+
+    GThread             *thread;
+    GMutex               lock;
+    gboolean             stop;             /* protected by lock */
+    MqttPublisherSpillFunc spill;          /* protected by lock */
+    gpointer             spill_data;       /* protected by lock */
+    gchar               *next_topic;       /* protected by lock; taken by the I/O thread */
+
+    atomic_bool          connected;
+    atomic_uint          inflight_count;
+    atomic_ullong        posted;
+    atomic_ullong        dropped;
+    atomic_ullong        spilled;
+    atomic_ullong        published;
+    atomic_ullong        publishes;
+    atomic_ullong        bytes;
+    atomic_ullong        completed;
+    atomic_ullong        latency_sum_us;
+    atomic_ullong        latency_max_us;
+
+    MetricsCounter      *published_counter;
+    MetricsCounter      *dropped_counter;
+    MetricsCounter      *spilled_counter;
+    MetricsCounter      *publishes_counter;
+    MetricsCounter      *bytes_counter;
+    MetricsGauge        *connected_gauge;
+    MetricsGauge        *inflight_gauge;
+    MetricsGauge        *queue_gauge;
+    MetricsGauge        *latency_gauge;
+    MetricsGauge        *max_latency_gauge;
+};
+
+static void count_dropped(MqttPublisher *pub, guint n)
+{
+    atomic_fetch_add_explicit(&pub->dropped, n, memory_order_relaxed);
+    metrics_counter_add(pub->dropped_counter, n);
+}
+
+static void complete(MqttPublisher *pub, const Inflight *f)
+{
+    guint64 latency = (guint64)MAX(g_get_monotonic_time() - f->oldest_us, 0);
+    atomic_fetch_add_explicit(&pub->published, f->events, memory_order_relaxed);
+    atomic_fetch_add_explicit(&pub->completed, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&pub->latency_sum_us, latency, memory_order_relaxed);
+    if (latency > atomic_load_explicit(&pub->latency_max_us, memory_order_relaxed))
+        atomic_store_explicit(&pub->latency_max_us, latency, memory_order_relaxed);
+    metrics_counter_add(pub->published_counter, f->events);
+    pub->window_sum_us += latency;
+    pub->window_max_us  = MAX(pub->window_max_us, latency);
+    pub->window_n++;
+}
+
+static void on_publish(struct mosquitto *mosq, void *obj, int mid)
+{
+    (void)mosq;
+    MqttPublisher *pub = obj;
+    Inflight *f = g_hash_table_lookup(pub->inflight, GINT_TO_POINTER(mid));
+    if (!f) {
+        /* QoS 0 can complete before mosquitto_publish returns its mid. */
+        pub->early     = TRUE;
+        pub->early_mid = mid;
+        return;
+    }
+    complete(pub, f);
+    g_hash_table_remove(pub->inflight, GINT_TO_POINTER(mid));
+    atomic_store(&pub->inflight_count, g_hash_table_size(pub->inflight));
+}
+
+static void on_connect(struct mosquitto *mosq, void *obj, int rc)
+{
+    MqttPublisher *pub = obj;
+    if (rc != 0) {
+        if (!pub->down_logged)
+            log_warning("mqtt_publisher: %s:%u refused the connection: %s",
+                        pub->host, pub->options.port, mosquitto_connack_string(rc));
+        pub->down_logged = TRUE;
+        mosquitto_disconnect(mosq);
+        return;
+    }
+    log_info("mqtt_publisher: connected to %s:%u, publishing to %s at QoS %u",
+             pub->host, pub->options.port, pub->topic, pub->options.qos);
+    pub->down_logged = FALSE;
+    atomic_store(&pub->connected, TRUE);
+}
+
+static const gchar *error_string(int rc)
+{
+    return rc == MOSQ_ERR_ERRNO ? g_strerror(errno) : mosquitto_strerror(rc);
+}
+
+/* Idempotent: from on_disconnect and from a failed mosquitto_loop; rc 0 is our own disconnect. */
+static void lost(MqttPublisher *pub, int rc)
+{
+    if (rc != MOSQ_ERR_SUCCESS && !pub->down_logged) {
+        log_warning("mqtt_publisher: %s %s:%u: %s, retrying every second",
+                    atomic_load(&pub->connected) ? "lost the connection to" : "cannot connect to",
+                    pub->host, pub->options.port, error_string(rc));
+        pub->down_logged = TRUE;
+    }
+    atomic_store(&pub->connected, FALSE);
+    pub->socket_up = FALSE;
+    /* libmosquitto sends QoS 1 and 2 again after reconnecting; QoS 0 not yet written is gone. */
+    if (pub->options.qos == 0) {
+        GHashTableIter iter;
+        gpointer value;
+        g_hash_table_iter_init(&iter, pub->inflight);
+        while (g_hash_table_iter_next(&iter, NULL, &value))
+            count_dropped(pub, ((Inflight *)value)->events);
+        g_hash_table_remove_all(pub->inflight);
+        atomic_store(&pub->inflight_count, 0);
+    }
+}
+
+static void on_disconnect(struct mosquitto *mosq, void *obj, int rc)
+{
+    (void)mosq;
+    lost((MqttPublisher *)obj, rc);
+}
+
+static void try_connect(MqttPublisher *pub, gint64 now)
+{
+    if (now < pub->next_connect_us)
+        return;
+    pub->next_connect_us = now + CONNECT_RETRY_US;
+    /* Non-blocking: the TCP handshake and CONNACK complete in mosquitto_loop. */
+    int rc = mosquitto_connect_async(pub->mosq, pub->host, (int)pub->options.port,
+                                     (int)pub->options.keepalive_s);
+    if (rc == MOSQ_ERR_SUCCESS)
+        pub->socket_up = TRUE;
+    else
+        lost(pub, rc);
+}
+
+/* Live events ahead of replayed ones when both wait. */
+static EventSlot *next_event(MqttPublisher *pub, SpscRing **ring)
+{
+    EventSlot *slot = spsc_ring_peek(pub->live);
+    *ring = pub->live;
+    if (!slot) {
+        slot  = spsc_ring_peek(pub->replayed);
+        *ring = pub->replayed;
+    }
+    return slot;
+}
+
+/* Bytes an event adds to the open batch, framing included. */
+static gsize framed_len(const MqttPublisher *pub, gsize len)
+{
+    if (pub->options.framing == MQTT_FRAMING_NEWLINE)
+        return (pub->batch_len ? 1 : 0) + len;
+    gsize prefix = 1;
+    for (gsize v = len; v >= 0x80; v >>= 7)
+        prefix++;
+    return prefix + len;
+}
+
+static void append(MqttPublisher *pub, const EventSlot *slot)
+{
+    if (!pub->batch_len)
+        pub->batch_oldest_us = slot->posted_us;
+    if (pub->options.framing == MQTT_FRAMING_NEWLINE) {
+        if (pub->batch_len)
+            pub->batch[pub->batch_len++] = '\n';
+    } else {
+        gsize v = slot->len;
+        for (; v >= 0x80; v >>= 7)
+            pub->batch[pub->batch_len++] = (guint8)(v | 0x80);
+        pub->batch[pub->batch_len++] = (guint8)v;
+    }
+    BatchEvent event = { (guint32)pub->batch_len, (guint32)(pub->batch_len + slot->len) };
+    memcpy(pub->batch + pub->batch_len, slot->data, slot->len);
+    pub->batch_len += slot->len;
+    g_array_append_val(pub->batch_events, event);
+}
+
+static void reset_batch(MqttPublisher *pub)
+{
+    pub->batch_len = 0;
+    g_array_set_size(pub->batch_events, 0);
+}
+
+static gboolean batch_due(const MqttPublisher *pub, gint64 now, gboolean force)
+{
+    return pub->batch_len &&
+           (force || pub->batch_len >= pub->options.batch_bytes ||
+            now >= pub->batch_oldest_us + (gint64)pub->options.batch_ms * G_TIME_SPAN_MILLISECOND);
+}
+
+/* FALSE when the batch has to wait: too many in flight, or no connection. */
+static gboolean publish_batch(MqttPublisher *pub)
+{
+    if (g_hash_table_size(pub->inflight) >= pub->options.max_inflight)
+        return FALSE;
+
+    const void *payload = pub->batch;
+    gsize len = pub->batch_len;
+    if (pub->options.compression == MQTT_COMPRESSION_DEFLATE) {
+        uLongf out = (uLongf)pub->deflated_cap;
+        if (compress2(pub->deflated, &out, pub->batch, (uLong)pub->batch_len, Z_BEST_SPEED) == Z_OK) {
+            payload = pub->deflated;
+            len     = out;
+        }
+    }
+
+    int mid = 0;
+    pub->early = FALSE;
+    int rc = mosquitto_publish(pub->mosq, &mid, pub->topic, (int)len, payload, (int)pub->options.qos, false);
+    if (rc == MOSQ_ERR_NO_CONN || rc == MOSQ_ERR_CONN_LOST) {
+        lost(pub, rc);
+        return FALSE;
+    }
+    if (rc != MOSQ_ERR_SUCCESS) {
+        log_warning("mqtt_publisher: dropping %u events: %s", pub->batch_events->len, error_string(rc));
+        count_dropped(pub, pub->batch_events->len);
+        reset_batch(pub);
+        return TRUE;
+    }
+
+    Inflight *f = g_new(Inflight, 1);
+    f->oldest_us = pub->batch_oldest_us;
+    f->events    = pub->batch_events->len;
+    if (pub->early && pub->early_mid == mid) {
+        complete(pub, f);
+        g_free(f);
+    } else {
+        g_hash_table_insert(pub->inflight, GINT_TO_POINTER(mid), f);
+        atomic_store(&pub->inflight_count, g_hash_table_size(pub->inflight));
+    }
+    atomic_fetch_add_explicit(&pub->publishes, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&pub->bytes, len, memory_order_relaxed);
+    metrics_counter_add(pub->publishes_counter, 1);
+    metrics_counter_add(pub->bytes_counter, len);
+    reset_batch(pub);
+    return TRUE;
+}
+
+/* Moves queued events into publishes until the queues run dry or publishing has to wait. */
+static void fill_and_publish(MqttPublisher *pub, gint64 now, gboolean force)
+{
+    /* Age closes a batch only once the queues are empty, so a backlog still goes out in full publishes. */
+    gboolean unbatched = pub->options.batch_ms == 0;
+    for (;;) {
+        if (pub->batch_len && (unbatched || pub->batch_len >= pub->options.batch_bytes) &&
+            !publish_batch(pub))
+            return;
+        SpscRing *ring;
+        EventSlot *slot = next_event(pub, &ring);
+        if (!slot)
+            break;
+        if (pub->batch_len && pub->batch_len + framed_len(pub, slot->len) > pub->options.batch_bytes &&
+            !publish_batch(pub))
+            return;
+        append(pub, slot);
+        spsc_ring_release(ring);
+    }
+    if (batch_due(pub, now, force))
+        publish_batch(pub);
+}
+
+static void spill_one(MqttPublisher *pub, MqttPublisherSpillFunc spill, gpointer spill_data,
+                      const void *event, gsize len)
+{
+    if (spill && spill(event, len, spill_data)) {
+        atomic_fetch_add_explicit(&pub->spilled, 1, memory_order_relaxed);
+        metrics_counter_add(pub->spilled_counter, 1);
+    } else {
+        count_dropped(pub, 1);
+    }
+}
+
+/* Hands the open batch and every queued event to spill; NULL spill drops them. */
+static void spill_all(MqttPublisher *pub, MqttPublisherSpillFunc spill, gpointer spill_data)
+{
+    for (guint i = 0; i < pub->batch_events->len; i++) {
+        const BatchEvent *event = &g_array_index(pub->batch_events, BatchEvent, i);
+        spill_one(pub, spill, spill_data, pub->batch + event->start, event->end - event->start);
+    }
+    reset_batch(pub);
+
+    SpscRing *ring;
+    EventSlot *slot;
+    while ((slot = next_event(pub, &ring)) != NULL) {
+        spill_one(pub, spill, spill_data, slot->data, slot->len);
+        spsc_ring_release(ring);
+    }
+}
+
+static void publish_metrics(MqttPublisher *pub, gint64 now)
+{
+    if (now < pub->next_metrics_us)
+        return;
+    pub->next_metrics_us = now + G_TIME_SPAN_SECOND;
+    metrics_gauge_set(pub->connected_gauge, atomic_load(&pub->connected) ? 1.0 : 0.0);
+    metrics_gauge_set(pub->inflight_gauge, g_hash_table_size(pub->inflight));
+    metrics_gauge_set(pub->queue_gauge, spsc_ring_count(pub->live) + spsc_ring_count(pub->replayed));
+    metrics_gauge_set(pub->latency_gauge, pub->window_n ? pub->window_sum_us / 1e3 / pub->window_n : 0.0);
+    metrics_gauge_set(pub->max_latency_gauge, pub->window_max_us / 1e3);
+    pub->window_sum_us = pub->window_max_us = 0;
+    pub->window_n = 0;
+}
+
+/* Until the batch is due when one is open; a short poll otherwise. */
+static int loop_timeout_ms(const MqttPublisher *pub, gint64 now)
+{
+    if (!pub->batch_len || g_hash_table_size(pub->inflight) >= pub->options.max_inflight)
+        return IDLE_POLL_MS;
+    gint64 due = pub->batch_oldest_us + (gint64)pub->options.batch_ms * G_TIME_SPAN_MILLISECOND;
+    return (int)CLAMP((due - now) / G_TIME_SPAN_MILLISECOND, 0, IDLE_POLL_MS);
+}
+
+static void run_loop(MqttPublisher *pub, int timeout_ms)
+{
+    if (!pub->socket_up) {
+        g_usleep((gulong)timeout_ms * G_TIME_SPAN_MILLISECOND);
+        return;
+    }
+    int rc = mosquitto_loop(pub->mosq, timeout_ms, 1);
+    if (rc != MOSQ_ERR_SUCCESS)
+        lost(pub, rc);
+}
+
+static gpointer io_thread(gpointer data)
+{
+    MqttPublisher *pub = data;
+    MqttPublisherSpillFunc spill;
+    gpointer spill_data;
+
+    for (;;) {
+        g_mutex_lock(&pub->lock);
+        gboolean stop = pub->stop;
+        spill      = pub->spill;
+        spill_data = pub->spill_data;
+        gchar *topic = pub->next_topic;
+        pub->next_topic = NULL;
+        g_mutex_unlock(&pub->lock);
+        if (topic) {
+            g_free(pub->topic);
+            pub->topic         = topic;
+            pub->options.topic = topic;
+        }
+        if (stop)
+            break;
+
+        gint64 now = g_get_monotonic_time();
+        if (!pub->socket_up)
+            try_connect(pub, now);
+        if (atomic_load(&pub->connected))
+            fill_and_publish(pub, now, FALSE);
+        else if (spill)
+            spill_all(pub, spill, spill_data);
+        run_loop(pub, loop_timeout_ms(pub, now));
+        publish_metrics(pub, now);
+    }
+
+    /* Publish what is queued and give the acks a moment. */
+    gint64 deadline = g_get_monotonic_time() + DRAIN_TIMEOUT_US;
+    while (atomic_load(&pub->connected) && g_get_monotonic_time() < deadline &&
+           (pub->batch_len || spsc_ring_count(pub->live) || spsc_ring_count(pub->replayed) ||
+            g_hash_table_size(pub->inflight))) {
+        fill_and_publish(pub, g_get_monotonic_time(), TRUE);
+        run_loop(pub, IDLE_POLL_MS);
+    }
+    spill_all(pub, spill, spill_data);
+    if (g_hash_table_size(pub->inflight))
+        log_warning("mqtt_publisher: %u publishes still unacknowledged at exit", g_hash_table_size(pub->inflight));
+    if (pub->socket_up) {
+        mosquitto_disconnect(pub->mosq);
+        mosquitto_loop(pub->mosq, 0, 1);
+    }
+    return NULL;
+}
+
+MqttPublisher *mqtt_publisher_new(const MqttPublisherOptions *options)
+{
+    if (!options->host || !options->host[0] || !options->topic || !options->topic[0] || options->qos > 2) {
+        log_error("mqtt_publisher: needs a host, a topic and a QoS of 0, 1 or 2");
+        return NULL;
+    }
+    static gsize lib_ready = 0;
+    if (g_once_init_enter(&lib_ready)) {
+        mosquitto_lib_init();
+        g_once_init_leave(&lib_ready, 1);
+    }
+
+    MqttPublisher *pub = g_new0(MqttPublisher, 1);
+    pub->options = *options;
+    pub->options.keepalive_s  = MAX(pub->options.keepalive_s, 5);
+    pub->options.batch_bytes  = MAX(pub->options.batch_bytes, 1);
+    pub->options.max_inflight = MAX(pub->options.max_inflight, 1);
+    if (!pub->options.event_bytes)
+        pub->options.event_bytes = MQTT_PUBLISHER_EVENT_BYTES;
+    pub->host      = g_strdup(options->host);
+    pub->topic     = g_strdup(options->topic);
+    pub->client_id = g_strdup(options->client_id);
+    pub->options.host      = pub->host;
+    pub->options.topic     = pub->topic;
+    pub->options.client_id = pub->client_id;
+
+    pub->mosq = mosquitto_new(pub->client_id, true, pub);
+    if (!pub->mosq) {
+        log_error("mqtt_publisher: cannot create a client: %s", g_strerror(errno));
+        g_free(pub->host);
+        g_free(pub->topic);
+        g_free(pub->client_id);
+        g_free(pub);
+        return NULL;
+    }
+    mosquitto_connect_callback_set(pub->mosq, on_connect);
+    mosquitto_disconnect_callback_set(pub->mosq, on_disconnect);
+    mosquitto_publish_callback_set(pub->mosq, on_publish);
+    mosquitto_max_inflight_messages_set(pub->mosq, pub->options.max_inflight);
+
+    gsize slot_bytes  = (sizeof(EventSlot) + pub->options.event_bytes + 7) & ~(gsize)7;
+    pub->live         = spsc_ring_new(MAX(options->queue_events, 2u), slot_bytes);
+    pub->replayed     = spsc_ring_new(REPLAY_SLOTS, slot_bytes);
+    pub->batch_cap    = MAX(pub->options.batch_bytes, pub->options.event_bytes + 5);
+    pub->batch        = g_malloc(pub->batch_cap);
+    pub->batch_events = g_array_new(FALSE, FALSE, sizeof(BatchEvent));
+    pub->deflated_cap = compressBound((uLong)pub->batch_cap);
+    pub->deflated     = options->compression == MQTT_COMPRESSION_DEFLATE ? g_malloc(pub->deflated_cap) : NULL;
+    pub->inflight     = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+    g_mutex_init(&pub->lock);
+    atomic_init(&pub->connected, FALSE);
+    atomic_init(&pub->inflight_count, 0);
+    atomic_init(&pub->posted, 0);
+    atomic_init(&pub->dropped, 0);
+    atomic_init(&pub->spilled, 0);
+    atomic_init(&pub->published, 0);
+    atomic_init(&pub->publishes, 0);
+    atomic_init(&pub->bytes, 0);
+    atomic_init(&pub->completed, 0);
+    atomic_init(&pub->latency_sum_us, 0);
+    atomic_init(&pub->latency_max_us, 0);
+
+    pub->published_counter = metrics_counter("traffic_guard_mqtt_events_total",
+                                             "Broker events by outcome.", "result", "published", TRUE);
+    pub->dropped_counter   = metrics_counter("traffic_guard_mqtt_events_total",
+                                             "Broker events by outcome.", "result", "dropped", TRUE);
+    pub->spilled_counter   = metrics_counter("traffic_guard_mqtt_events_total",
+                                             "Broker events by outcome.", "result", "spilled", TRUE);
+    pub->publishes_counter = metrics_counter("traffic_guard_mqtt_publishes_total",
+                                             "MQTT publishes, each carrying a batch of events.", NULL, NULL, TRUE);
+    pub->bytes_counter     = metrics_counter("traffic_guard_mqtt_bytes_total",
+                                             "MQTT publish payload bytes, after compression.", NULL, NULL, TRUE);
+    pub->connected_gauge   = metrics_gauge("traffic_guard_mqtt_connected",
+                                           "1 while the MQTT connection is up.", NULL, NULL);
+    pub->inflight_gauge    = metrics_gauge("traffic_guard_mqtt_inflight",
+                                           "MQTT publishes written but not yet acknowledged.", NULL, NULL);
+    pub->queue_gauge       = metrics_gauge("traffic_guard_mqtt_queued_events",
+                                           "Broker events waiting for the MQTT I/O thread.", NULL, NULL);
+    pub->latency_gauge     = metrics_gauge("traffic_guard_mqtt_publish_latency_ms",
+                                           "Oldest event to publish completion over the last second.",
+                                           "stat", "mean");
+    pub->max_latency_gauge = metrics_gauge("traffic_guard_mqtt_publish_latency_ms",
+                                           "Oldest event to publish completion over the last second.",
+                                           "stat", "max");
+
+    pub->thread = g_thread_new("mqtt-publisher", io_thread, pub);
+    return pub;
+}
+
+void mqtt_publisher_free(MqttPublisher *publisher)
+{
+    if (!publisher)
+        return;
+    g_mutex_lock(&publisher->lock);
+    publisher->stop = TRUE;
+    g_mutex_unlock(&publisher->lock);
+    g_thread_join(publisher->thread);
+
+    MqttPublisherStats stats;
+    mqtt_publisher_get_stats(publisher, &stats);
+    log_info("mqtt_publisher: %" G_GUINT64_FORMAT " events in %" G_GUINT64_FORMAT " publishes, %"
+             G_GUINT64_FORMAT " spilled, %" G_GUINT64_FORMAT " dropped, latency %.1f ms mean %.1f ms max",
+             stats.published, stats.publishes, stats.spilled, stats.dropped,
+             stats.latency_ms, stats.max_latency_ms);
+
+    mosquitto_destroy(publisher->mosq);
+    spsc_ring_free(publisher->live);
+    spsc_ring_free(publisher->replayed);
+    g_hash_table_destroy(publisher->inflight);
+    g_array_free(publisher->batch_events, TRUE);
+    g_mutex_clear(&publisher->lock);
+    g_free(publisher->batch);
+    g_free(publisher->deflated);
+    g_free(publisher->host);
+    g_free(publisher->topic);
+    g_free(publisher->next_topic);
+    g_free(publisher->client_id);
+    g_free(publisher);
+}
+
+void mqtt_publisher_set_spill(MqttPublisher *publisher, MqttPublisherSpillFunc func, gpointer user_data)
+{
+    g_mutex_lock(&publisher->lock);
+    publisher->spill      = func;
+    publisher->spill_data = user_data;
+    g_mutex_unlock(&publisher->lock);
+}
+
+void mqtt_publisher_set_topic(MqttPublisher *publisher, const gchar *topic)
+{
+    if (!topic || !topic[0])
+        return;
+    g_mutex_lock(&publisher->lock);
+    g_free(publisher->next_topic);
+    publisher->next_topic = g_strdup(topic);
+    g_mutex_unlock(&publisher->lock);
+}
+
+static gboolean enqueue(MqttPublisher *pub, SpscRing *ring, const void *event, gsize len)
+{
+    EventSlot *slot = len <= pub->options.event_bytes ? spsc_ring_reserve(ring) : NULL;
+    if (!slot)
+        return FALSE;
+    slot->posted_us = g_get_monotonic_time();
+    slot->len       = (guint32)len;
+    memcpy(slot->data, event, len);
+    spsc_ring_commit(ring);
+    atomic_fetch_add_explicit(&pub->posted, 1, memory_order_relaxed);
+    return TRUE;
+}
+
+gboolean mqtt_publisher_post(MqttPublisher *publisher, const void *event, gsize len)
+{
+    if (enqueue(publisher, publisher->live, event, len))
+        return TRUE;
+    count_dropped(publisher, 1);
+    return FALSE;
+}
+
+gboolean mqtt_publisher_replay(MqttPublisher *publisher, const void *event, gsize len)
+{
+    return atomic_load(&publisher->connected) && enqueue(publisher, publisher->replayed, event, len);
+}
+
+gboolean mqtt_publisher_connected(MqttPublisher *publisher)
+{
+    return atomic_load(&publisher->connected);
+}
+
+void mqtt_publisher_get_stats(MqttPublisher *publisher, MqttPublisherStats *stats)
+{
+    guint64 completed = atomic_load(&publisher->completed);
+    stats->connected      = atomic_load(&publisher->connected);
+    stats->posted         = atomic_load(&publisher->posted);
+    stats->dropped        = atomic_load(&publisher->dropped);
+    stats->spilled        = atomic_load(&publisher->spilled);
+    stats->published      = atomic_load(&publisher->published);
+    stats->publishes      = atomic_load(&publisher->publishes);
+    stats->bytes          = atomic_load(&publisher->bytes);
+    stats->inflight       = atomic_load(&publisher->inflight_count);
+    stats->latency_ms     = completed ? atomic_load(&publisher->latency_sum_us) / 1e3 / completed : 0.0;
+    stats->max_latency_ms = atomic_load(&publisher->latency_max_us) / 1e3;
+}
@@ -0,0 +1,241 @@
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "msg_pool.h"
+#include "logger.h"
+
+typedef struct {
+    NvDsCustomMsgInfo info;      /* first, so the meta's pointer is the block */
+    MsgPool          *pool;
+    atomic_uint       next;      /* free-list link as index + 1; 0 ends the list */
+    gboolean          heap;      /* allocated for a miss; freed on release */
+    MsgPriority       priority;
+    gchar             payload[];
+} MsgBlock;
+
+struct MsgPool {
+    guint8          *slab;
+    gsize            stride;     /* block header plus payload_bytes, aligned */
+    gsize            payload_bytes;
+    guint            n_blocks;
+    /* (tag << 32) | (index + 1); the tag changes on every pop and push so a stale CAS fails. */
+    _Atomic guint64  head;
+    atomic_int       ref;        /* owner plus one per outstanding message */
+
+    atomic_ullong    acquired;
+    atomic_ullong    released;
+    atomic_ullong    misses;
+    atomic_ullong    heap_allocs;
+};
+
+#define HEAD(tag, link) (((guint64)(tag) << 32) | (guint64)(link))
+
+static inline MsgBlock *block_at(MsgPool *pool, guint32 index)
+{
+    return (MsgBlock *)(pool->slab + (gsize)index * pool->stride);
+}
+
+static void push_block(MsgPool *pool, MsgBlock *block)
+{
+    guint32 link = (guint32)(((guint8 *)block - pool->slab) / pool->stride) + 1;
+    guint64 head = atomic_load_explicit(&pool->head, memory_order_relaxed);
+    guint64 next;
+    do {
+        atomic_store_explicit(&block->next, (guint32)head, memory_order_relaxed);
+        next = HEAD((head >> 32) + 1, link);
+    } while (!atomic_compare_exchange_weak_explicit(&pool->head, &head, next,
+                                                    memory_order_release,
+                                                    memory_order_relaxed));
+}
+
+static MsgBlock *pop_block(MsgPool *pool)
+{
+    guint64 head = atomic_load_explicit(&pool->head, memory_order_acquire);
+    for (;;) {
+        guint32 link = (guint32)head;
+        if (link == 0)
+            return NULL;
+        MsgBlock *block = block_at(pool, link - 1);
+        guint32 after = atomic_load_explicit(&block->next, memory_order_relaxed);
+        if (atomic_compare_exchange_weak_explicit(&pool->head, &head,
+                                                  HEAD((head >> 32) + 1, after),
+                                                  memory_order_acquire,
+                                                  memory_order_acquire))
+            return block;
+    }
+}
+
+MsgPool *msg_pool_new(guint n_blocks)
+{
+    return msg_pool_new_full(n_blocks, MSG_POOL_PAYLOAD_BYTES);
+}
+
+MsgPool *msg_pool_new_full(guint n_blocks, gsize payload_bytes)
+{
+    MsgPool *pool = g_new0(MsgPool, 1);
+    pool->payload_bytes = MAX(payload_bytes, 1);
+    pool->stride        = (offsetof(MsgBlock, payload) + pool->payload_bytes + 7) & ~(gsize)7;
+    pool->n_blocks      = n_blocks;
+    pool->slab          = n_blocks ? g_malloc0(pool->stride * n_blocks) : NULL;
+    atomic_init(&pool->head, 0);
+    atomic_init(&pool->ref, 1);
+    atomic_init(&pool->acquired, 0);
+    atomic_init(&pool->released, 0);
+    atomic_init(&pool->misses, 0);
+    atomic_init(&pool->heap_allocs, 0);
+
+    for (guint i = n_blocks; i > 0; i--) {
+        MsgBlock *block = block_at(pool, i - 1);
+        block->pool = pool;
+        atomic_init(&block->next, 0);
+        push_block(pool, block);
+    }
+    return pool;
+}
+
+static void pool_unref(MsgPool *pool)
+{
+    if (atomic_fetch_sub_explicit(&pool->ref, 1, memory_order_acq_rel) != 1)
+        return;
+    g_free(pool->slab);
+    g_free(pool);
+}
+
+void msg_pool_free(MsgPool *pool)
+{
+    if (!pool)
+        return;
+    MsgPoolStats stats;
+    msg_pool_get_stats(pool, &stats);
+    log_info("msg_pool: %" G_GUINT64_FORMAT " messages, %" G_GUINT64_FORMAT
+             " pool misses (%" G_GUINT64_FORMAT " heap blocks), %u blocks",
+             stats.acquired, stats.misses, stats.heap_allocs, stats.blocks);
+    pool_unref(pool);
+}
+
+static MsgBlock *heap_block(MsgPool *pool, gsize payload_len)
+{
+    MsgBlock *block = g_malloc(offsetof(MsgBlock, payload) + payload_len + 1);
+    block->pool = pool;
+    block->heap = TRUE;
+    atomic_fetch_add_explicit(&pool->misses, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&pool->heap_allocs, 1, memory_order_relaxed);
+    return block;
+}
+
+static NvDsCustomMsgInfo *hand_out(MsgPool *pool, MsgBlock *block, gsize len, MsgPriority priority)
+{
+    block->info.message = block->payload;
+    block->info.size    = (guint)len;
+    block->priority     = priority;
+    atomic_fetch_add_explicit(&pool->ref, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&pool->acquired, 1, memory_order_relaxed);
+    return &block->info;
+}
+
+NvDsCustomMsgInfo *msg_pool_format(MsgPool *pool, const gchar *format, ...)
+{
+    va_list args;
+    gint len;
+
+    MsgBlock *block = pop_block(pool);
+    if (block) {
+        va_start(args, format);
+        len = g_vsnprintf(block->payload, (gulong)pool->payload_bytes, format, args);
+        va_end(args);
+        if (len >= 0 && (gsize)len < pool->payload_bytes) {
+            block->heap = FALSE;
+            return hand_out(pool, block, (gsize)len, MSG_PRIORITY_NORMAL);
+        }
+        push_block(pool, block);
+    }
+
+    va_start(args, format);
+    len = g_vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if (len < 0)
+        return NULL;
+
+    block = heap_block(pool, (gsize)len);
+    va_start(args, format);
+    g_vsnprintf(block->payload, (gulong)len + 1, format, args);
+    va_end(args);
+    return hand_out(pool, block, (gsize)len, MSG_PRIORITY_NORMAL);
+}
+
+NvDsCustomMsgInfo *msg_pool_write(MsgPool *pool, MsgPoolWriteFunc write, gpointer user_data)
+{
+    gsize len;
+    MsgBlock *block = pop_block(pool);
+    if (block) {
+        len = write(block->payload, pool->payload_bytes, user_data);
+        if (len < pool->payload_bytes) {
+            block->payload[len] = '\0';
+            block->heap = FALSE;
+            return hand_out(pool, block, len, MSG_PRIORITY_NORMAL);
+        }
+        push_block(pool, block);
+    } else {
+        len = write(NULL, 0, user_data);
+    }
+
+    block = heap_block(pool, len);
+    write(block->payload, len + 1, user_data);
+    block->payload[len] = '\0';
+    return hand_out(pool, block, len, MSG_PRIORITY_NORMAL);
+}
+
+NvDsCustomMsgInfo *msg_pool_copy(const NvDsCustomMsgInfo *msg)
+{
+    if (!msg)
+        return NULL;
+    const MsgBlock *src = (const MsgBlock *)msg;
+    MsgPool *pool = src->pool;
+    gsize len = msg->size;
+
+    MsgBlock *block = len < pool->payload_bytes ? pop_block(pool) : NULL;
+    if (block)
+        block->heap = FALSE;
+    else
+        block = heap_block(pool, len);
+    memcpy(block->payload, msg->message, len);
+    block->payload[len] = '\0';
+    return hand_out(pool, block, len, src->priority);
+}
+
+void msg_pool_set_priority(NvDsCustomMsgInfo *msg, MsgPriority priority)
+{
+    if (msg)
+        ((MsgBlock *)msg)->priority = priority;
+}
+
+MsgPriority msg_pool_get_priority(const NvDsCustomMsgInfo *msg)
+{
+    return msg ? ((const MsgBlock *)msg)->priority : MSG_PRIORITY_NORMAL;
+}
+
+void msg_pool_release(NvDsCustomMsgInfo *msg)
+{
+    if (!msg)
+        return;
+    MsgBlock *block = (MsgBlock *)msg;
+    MsgPool *pool = block->pool;
+
+    atomic_fetch_add_explicit(&pool->released, 1, memory_order_relaxed);
+    if (block->heap)
+        g_free(block);
+    else
+        push_block(pool, block);
+    pool_unref(pool);
+}
+
+void msg_pool_get_stats(MsgPool *pool, MsgPoolStats *stats)
+{
+    stats->acquired    = atomic_load_explicit(&pool->acquired, memory_order_relaxed);
+    stats->released    = atomic_load_explicit(&pool->released, memory_order_relaxed);
+    stats->misses      = atomic_load_explicit(&pool->misses, memory_order_relaxed);
+    stats->heap_allocs = atomic_load_explicit(&pool->heap_allocs, memory_order_relaxed);
+    stats->blocks      = pool->n_blocks;
+}
@@ -0,0 +1,114 @@
+#include "msg_shed.h"
+#include "element_util.h"
+#include "metrics.h"
+
+/* Floor while the broker is down: every message goes to the spool. */
+#define SHED_ALL (MSG_PRIORITY_HIGH + 1)
+
+struct MsgShed {
+    GstElement     *queue;
+    MsgShedOptions  options;
+    gulong          overrun_id;
+    EventSpool     *spool;
+    MetricsCounter *shed[MSG_PRIORITY_HIGH + 1];
+    MetricsCounter *overruns;
+};
+
+static void on_overrun(GstElement *queue, gpointer user_data)
+{
+    (void)queue;
+    metrics_counter_add((MetricsCounter *)user_data, 1);
+}
+
+MsgShed *msg_shed_new(GstElement *queue, const MsgShedOptions *options)
+{
+    MsgShed *shed = g_new0(MsgShed, 1);
+    shed->queue   = gst_object_ref(queue);
+    shed->options = *options;
+    shed->shed[MSG_PRIORITY_LOW]    = metrics_counter("traffic_guard_messages_shed_total",
+                                                      "Broker messages removed before the broker queue.",
+                                                      "priority", "low", TRUE);
+    shed->shed[MSG_PRIORITY_NORMAL] = metrics_counter("traffic_guard_messages_shed_total",
+                                                      "Broker messages removed before the broker queue.",
+                                                      "priority", "normal", TRUE);
+    /* Only while the broker is down and the spool cannot take them. */
+    shed->shed[MSG_PRIORITY_HIGH]   = metrics_counter("traffic_guard_messages_shed_total",
+                                                      "Broker messages removed before the broker queue.",
+                                                      "priority", "high", TRUE);
+    shed->overruns = metrics_counter("traffic_guard_msg_queue_overruns_total",
+                                     "Batches arriving at a full broker queue; each one leaks a batch "
+                                     "when the queue is leaky.", NULL, NULL, TRUE);
+    /* Emitted by the streaming thread, before the queue leaks or blocks. */
+    shed->overrun_id = g_signal_connect(queue, "overrun", G_CALLBACK(on_overrun), shed->overruns);
+    return shed;
+}
+
+void msg_shed_free(MsgShed *shed)
+{
+    if (!shed)
+        return;
+    g_signal_handler_disconnect(shed->queue, shed->overrun_id);
+    gst_object_unref(shed->queue);
+    g_free(shed);
+}
+
+void msg_shed_set_spool(MsgShed *shed, EventSpool *spool)
+{
+    shed->spool = spool;
+}
+
+MsgPriority msg_shed_floor(const MsgShedOptions *options, guint fill_pct)
+{
+    if (fill_pct >= options->normal_pct)
+        return MSG_PRIORITY_HIGH;
+    if (fill_pct >= options->low_pct)
+        return MSG_PRIORITY_NORMAL;
+    return MSG_PRIORITY_LOW;
+}
+
+static guint fill_pct(GstElement *queue)
+{
+    guint buffers = 0, max_buffers = 0;
+    element_util_queue_level(queue, "current-level-buffers", &buffers,
+                                    "max-size-buffers", &max_buffers, NULL);
+    return max_buffers ? buffers * 100 / max_buffers : 0;
+}
+
+guint msg_shed_batch(MsgShed *shed, NvDsBatchMeta *batch_meta)
+{
+    guint floor = shed->spool && !event_spool_broker_up(shed->spool)
+        ? SHED_ALL : msg_shed_floor(&shed->options, fill_pct(shed->queue));
+    if (floor == MSG_PRIORITY_LOW)
+        return 0;
+
+    guint removed[MSG_PRIORITY_HIGH + 1] = { 0 };
+    guint spilled = 0;
+    nvds_acquire_meta_lock(batch_meta);
+    for (NvDsMetaList *l_frame = batch_meta->frame_meta_list; l_frame; l_frame = l_frame->next) {
+        NvDsFrameMeta *frame_meta = (NvDsFrameMeta *)l_frame->data;
+        NvDsMetaList *l_user = frame_meta->frame_user_meta_list;
+        while (l_user) {
+            NvDsUserMeta *user_meta = (NvDsUserMeta *)l_user->data;
+            l_user = l_user->next;   /* removal unlinks the current node */
+            if (user_meta->base_meta.meta_type != NVDS_CUSTOM_MSG_BLOB)
+                continue;
+            NvDsCustomMsgInfo *msg = (NvDsCustomMsgInfo *)user_meta->user_meta_data;
+            MsgPriority priority = msg_pool_get_priority(msg);
+            if (priority >= floor)
+                continue;
+            if (shed->spool && event_spool_spill(shed->spool, msg->message, msg->size))
+                spilled++;
+            else
+                removed[priority]++;
+            nvds_remove_user_meta_from_frame(frame_meta, user_meta);
+        }
+    }
+    nvds_release_meta_lock(batch_meta);
+
+    guint total = spilled;
+    for (guint p = MSG_PRIORITY_LOW; p <= MSG_PRIORITY_HIGH; p++) {
+        metrics_counter_add(shed->shed[p], removed[p]);
+        total += removed[p];
+    }
+    return total;
+}
@@ -0,0 +1,494 @@
+#include <string.h>
+
+#include "payload_encoder.h"
+
+/* Appends until something does not fit, then only counts, so len is always the full length. */
+typedef struct {
+    gchar *buf;
+    gsize  size;
+    gsize  len;
+} Out;
+
+static inline void put(Out *o, const void *data, gsize n)
+{
+    if (o->len + n < o->size)
+        memcpy(o->buf + o->len, data, n);
+    o->len += n;
+}
+
+static inline void put_str(Out *o, const gchar *s)
+{
+    put(o, s, strlen(s));
+}
+
+static void put_uint(Out *o, guint64 v)
+{
+    gchar tmp[20];
+    gsize i = sizeof(tmp);
+    do {
+        tmp[--i] = (gchar)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    put(o, tmp + i, sizeof(tmp) - i);
+}
+
+static void put_int(Out *o, gint64 v)
+{
+    if (v < 0) {
+        put(o, "-", 1);
+        put_uint(o, (guint64)0 - (guint64)v);
+    } else {
+        put_uint(o, (guint64)v);
+    }
+}
+
+static gint64 round_px(gfloat v)
+{
+    return (gint64)(v < 0 ? v - 0.5f : v + 0.5f);
+}
+
+static guint milli(gfloat conf)
+{
+    return conf <= 0.0f ? 0 : conf >= 1.0f ? 1000 : (guint)(conf * 1000.0f + 0.5f);
+}
+
+/* ---- text ---- */
+
+static gsize encode_text(const PayloadEvent *e, gchar *buf, gsize size)
+{
+    const gchar *brand = e->brand ? e->brand : "NULL";
+    const gchar *type  = e->type  ? e->type  : "NULL";
+    const gchar *plate = e->plate ? e->plate : "NULL";
+    gint len = e->event != TRACK_EVENT_NONE
+        ? g_snprintf(buf, (gulong)size,
+              "Vehicle ID: %" G_GUINT64_FORMAT ", Brand: %s, Type: %s, Plate: %s, Source: %u, Event: %s",
+              e->object_id, brand, type, plate, e->source_id, track_event_name(e->event))
+        : g_snprintf(buf, (gulong)size,
+              "Vehicle ID: %" G_GUINT64_FORMAT ", Brand: %s, Type: %s, Plate: %s, Source: %u",
+              e->object_id, brand, type, plate, e->source_id);
+    return len < 0 ? 0 : (gsize)len;
+}
+
+/* ---- json ---- */
+
+static void put_json_string(Out *o, const gchar *s)
+{
+    static const gchar hex[] = "0123456789abcdef";
+    put(o, "\"", 1);
+    const gchar *run = s;
+    for (; *s; s++) {
+        guchar c = (guchar)*s;
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+        put(o, run, (gsize)(s - run));
+        if (c == '"' || c == '\\') {
+            gchar esc[2] = { '\\', (gchar)c };
+            put(o, esc, 2);
+        } else {
+            gchar esc[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf] };
+            put(o, esc, 6);
+        }
+        run = s + 1;
+    }
+    put(o, run, (gsize)(s - run));
+    put(o, "\"", 1);
+}
+
+static void put_json_conf(Out *o, gfloat conf)
+{
+    if (conf < 0.0f) {
+        put_str(o, "null");
+        return;
+    }
+    guint m = milli(conf);
+    gchar tmp[5] = { (gchar)('0' + m / 1000), '.',
+                     (gchar)('0' + m / 100 % 10), (gchar)('0' + m / 10 % 10), (gchar)('0' + m % 10) };
+    put(o, tmp, sizeof(tmp));
+}
+
+static void put_json_label(Out *o, const gchar *key, const gchar *conf_key,
+                           const gchar *label, gfloat conf)
+{
+    put_str(o, key);
+    if (label)
+        put_json_string(o, label);
+    else
+        put_str(o, "null");
+    put_str(o, conf_key);
+    put_json_conf(o, label ? conf : -1.0f);
+}
+
+static gsize encode_json(const PayloadEvent *e, gchar *buf, gsize size)
+{
+    Out o = { buf, size, 0 };
+    put_str(&o, "{\"v\":1,\"object_id\":");
+    put_uint(&o, e->object_id);
+    put_str(&o, ",\"source_id\":");
+    put_uint(&o, e->source_id);
+    put_str(&o, ",\"frame\":");
+    put_int(&o, e->frame_num);
+    put_str(&o, ",\"timestamp_ns\":");
+    put_uint(&o, e->timestamp_ns);
+    put_str(&o, ",\"event\":");
+    if (e->event != TRACK_EVENT_NONE)
+        put_json_string(&o, track_event_name(e->event));
+    else
+        put_str(&o, "null");
+    if (e->has_bbox) {
+        put_str(&o, ",\"bbox\":[");
+        put_int(&o, round_px(e->left));
+        put(&o, ",", 1);
+        put_int(&o, round_px(e->top));
+        put(&o, ",", 1);
+        put_int(&o, round_px(e->width));
+        put(&o, ",", 1);
+        put_int(&o, round_px(e->height));
+        put_str(&o, "],\"confidence\":");
+        put_json_conf(&o, e->confidence);
+    } else {
+        put_str(&o, ",\"bbox\":null,\"confidence\":null");
+    }
+    put_json_label(&o, ",\"brand\":", ",\"brand_conf\":", e->brand, e->brand_conf);
+    put_json_label(&o, ",\"type\":", ",\"type_conf\":", e->type, e->type_conf);
+    put_json_label(&o, ",\"plate\":", ",\"plate_conf\":", e->plate, e->plate_conf);
+    put(&o, "}", 1);
+    if (o.len < o.size)
+        o.buf[o.len] = '\0';
+    return o.len;
+}
+
+/* ---- binary ---- */
+
+enum {
+    FIELD_OBJECT_ID = 1,
+    FIELD_SOURCE_ID,
+    FIELD_FRAME_NUM,
+    FIELD_TIMESTAMP,
+    FIELD_EVENT,
+    FIELD_LEFT,
+    FIELD_TOP,
+    FIELD_WIDTH,
+    FIELD_HEIGHT,
+    FIELD_CONFIDENCE,
+    FIELD_BRAND,
+    FIELD_BRAND_CONF,
+    FIELD_TYPE,
+    FIELD_TYPE_CONF,
+    FIELD_PLATE,
+    FIELD_PLATE_CONF,
+};
+
+enum { WIRE_VARINT = 0, WIRE_FIXED64 = 1, WIRE_BYTES = 2, WIRE_FIXED32 = 5 };
+
+static inline void put_varint(Out *o, guint64 v)
+{
+    if (G_LIKELY(o->len + 10 < o->size)) {
+        guint8 *p = (guint8 *)o->buf + o->len, *start = p;
+        while (v >= 0x80) {
+            *p++ = (guint8)(v | 0x80);
+            v >>= 7;
+        }
+        *p++ = (guint8)v;
+        o->len += (gsize)(p - start);
+        return;
+    }
+    guint8 tmp[10];
+    gsize n = 0;
+    while (v >= 0x80) {
+        tmp[n++] = (guint8)(v | 0x80);
+        v >>= 7;
+    }
+    tmp[n++] = (guint8)v;
+    put(o, tmp, n);
+}
+
+static inline void put_field(Out *o, guint field, guint64 v)
+{
+    put_varint(o, (guint64)field << 3 | WIRE_VARINT);
+    put_varint(o, v);
+}
+
+static inline void put_conf(Out *o, guint field, gfloat conf)
+{
+    if (conf >= 0.0f)
+        put_field(o, field, milli(conf));
+}
+
+static inline void put_sfield(Out *o, guint field, gint64 v)
+{
+    put_field(o, field, ((guint64)v << 1) ^ (guint64)(v >> 63));
+}
+
+static void put_label(Out *o, guint field, guint conf_field, const gchar *label, gfloat conf)
+{
+    if (!label)
+        return;
+    gsize n = strlen(label);
+    put_varint(o, (guint64)field << 3 | WIRE_BYTES);
+    put_varint(o, n);
+    put(o, label, n);
+    put_conf(o, conf_field, conf);
+}
+
+static gsize encode_binary(const PayloadEvent *e, gchar *buf, gsize size)
+{
+    Out o = { buf, size, 0 };
+    const guint8 head[2] = { PAYLOAD_BINARY_MAGIC, PAYLOAD_BINARY_VERSION };
+    put(&o, head, sizeof(head));
+    put_field(&o, FIELD_OBJECT_ID, e->object_id);
+    put_field(&o, FIELD_SOURCE_ID, e->source_id);
+    put_field(&o, FIELD_FRAME_NUM, (guint64)e->frame_num);
+    if (e->timestamp_ns)
+        put_field(&o, FIELD_TIMESTAMP, e->timestamp_ns);
+    if (e->event != TRACK_EVENT_NONE)
+        put_field(&o, FIELD_EVENT, e->event);
+    if (e->has_bbox) {
+        put_sfield(&o, FIELD_LEFT, round_px(e->left));
+        put_sfield(&o, FIELD_TOP, round_px(e->top));
+        put_field(&o, FIELD_WIDTH, (guint64)MAX(round_px(e->width), 0));
+        put_field(&o, FIELD_HEIGHT, (guint64)MAX(round_px(e->height), 0));
+        put_conf(&o, FIELD_CONFIDENCE, e->confidence);
+    }
+    put_label(&o, FIELD_BRAND, FIELD_BRAND_CONF, e->brand, e->brand_conf);
+    put_label(&o, FIELD_TYPE, FIELD_TYPE_CONF, e->type, e->type_conf);
+    put_label(&o, FIELD_PLATE, FIELD_PLATE_CONF, e->plate, e->plate_conf);
+    return o.len;
+}
+
+static gboolean get_varint(const guint8 **p, const guint8 *end, guint64 *v)
+{
+    guint64 r = 0;
+    for (guint shift = 0; shift < 64 && *p < end; shift += 7) {
+        guint8 b = *(*p)++;
+        r |= (guint64)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *v = r;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static void get_label(gchar *dst, const guint8 *src, guint64 n)
+{
+    gsize keep = MIN(n, (guint64)PAYLOAD_LABEL_MAX - 1);
+    memcpy(dst, src, keep);
+    dst[keep] = '\0';
+}
+
+gboolean payload_decode_binary(const void *data, gsize len, PayloadDecoded *out)
+{
+    const guint8 *p = data, *end = p + len;
+    memset(out, 0, sizeof(*out));
+    if (len < 2 || p[0] != PAYLOAD_BINARY_MAGIC || p[1] == 0 || p[1] > PAYLOAD_BINARY_VERSION)
+        return FALSE;
+    p += 2;
+
+    PayloadEvent *e = &out->event;
+    e->confidence = e->brand_conf = e->type_conf = e->plate_conf = -1.0f;
+    while (p < end) {
+        guint64 key, v;
+        if (!get_varint(&p, end, &key))
+            return FALSE;
+        guint field = (guint)(key >> 3);
+        switch (key & 7) {
+        case WIRE_VARINT:
+            if (!get_varint(&p, end, &v))
+                return FALSE;
+            break;
+        case WIRE_BYTES:
+            if (!get_varint(&p, end, &v) || v > (guint64)(end - p))
+                return FALSE;
+            if (field == FIELD_BRAND) {
+                get_label(out->brand, p, v);
+                e->brand = out->brand;
+            } else if (field == FIELD_TYPE) {
+                get_label(out->type, p, v);
+                e->type = out->type;
+            } else if (field == FIELD_PLATE) {
+                get_label(out->plate, p, v);
+                e->plate = out->plate;
+            }
+            p += v;
+            continue;
+        case WIRE_FIXED64:
+        case WIRE_FIXED32: {
+            gsize n = (key & 7) == WIRE_FIXED64 ? 8 : 4;
+            if ((gsize)(end - p) < n)
+                return FALSE;
+            p += n;
+            continue;
+        }
+        default:
+            return FALSE;
+        }
+
+        gint64 s = (gint64)(v >> 1) ^ -(gint64)(v & 1);
+        switch (field) {
+        case FIELD_OBJECT_ID:  e->object_id    = v; break;
+        case FIELD_SOURCE_ID:  e->source_id    = (guint)v; break;
+        case FIELD_FRAME_NUM:  e->frame_num    = (gint64)v; break;
+        case FIELD_TIMESTAMP:  e->timestamp_ns = v; break;
+        case FIELD_EVENT:      e->event        = (TrackEvent)v; break;
+        case FIELD_LEFT:       e->left   = (gfloat)s; e->has_bbox = TRUE; break;
+        case FIELD_TOP:        e->top    = (gfloat)s; e->has_bbox = TRUE; break;
+        case FIELD_WIDTH:      e->width  = (gfloat)v; e->has_bbox = TRUE; break;
+        case FIELD_HEIGHT:     e->height = (gfloat)v; e->has_bbox = TRUE; break;
+        case FIELD_CONFIDENCE: e->confidence = v / 1000.0f; break;
+        case FIELD_BRAND_CONF: e->brand_conf = v / 1000.0f; break;
+        case FIELD_TYPE_CONF:  e->type_conf  = v / 1000.0f; break;
+        case FIELD_PLATE_CONF: e->plate_conf = v / 1000.0f; break;
+        default: break;
+        }
+    }
+    return TRUE;
+}
+
+static const PayloadEncoder encoders[] = {
+    { "text",   PAYLOAD_FORMAT_TEXT,   FALSE, encode_text },
+    { "json",   PAYLOAD_FORMAT_JSON,   FALSE, encode_json },
+    { "binary", PAYLOAD_FORMAT_BINARY, TRUE,  encode_binary },
+};
+
+const PayloadEncoder *payload_encoder_lookup(const gchar *name)
+{
+    for (guint i = 0; name && i < G_N_ELEMENTS(encoders); i++)
+        if (strcmp(name, encoders[i].name) == 0)
+            return &encoders[i];
+    return NULL;
+}
+
+/* ---- blobs ---- */
+
+/* Longest count header plus closing bytes of any format. */
+#define BLOB_FRAME_BYTES 48
+
+struct PayloadBlob {
+    const PayloadEncoder *encoder;
+    gsize                 max_bytes;
+    gchar                *records;   /* each after its separator or length */
+    gsize                 len;
+    guint                 count;
+};
+
+PayloadBlob *payload_blob_new(const PayloadEncoder *encoder, gsize max_bytes)
+{
+    PayloadBlob *blob = g_new0(PayloadBlob, 1);
+    blob->encoder   = encoder;
+    blob->max_bytes = MAX(max_bytes, BLOB_FRAME_BYTES + 1);
+    blob->records   = g_malloc(blob->max_bytes - BLOB_FRAME_BYTES);
+    return blob;
+}
+
+void payload_blob_free(PayloadBlob *blob)
+{
+    if (!blob)
+        return;
+    g_free(blob->records);
+    g_free(blob);
+}
+
+static gsize varint_len(guint64 v)
+{
+    gsize n = 1;
+    for (; v >= 0x80; v >>= 7)
+        n++;
+    return n;
+}
+
+gboolean payload_blob_add(PayloadBlob *blob, const PayloadEvent *event)
+{
+    gsize room = blob->max_bytes - BLOB_FRAME_BYTES - blob->len;
+    gchar *at  = blob->records + blob->len;
+    /* One byte ahead of the record: a separator, or the length when it fits in one. */
+    if (room < 2)
+        return FALSE;
+    gsize len = blob->encoder->encode(event, at + 1, room - 1);
+    if (len >= room - 1)
+        return FALSE;
+
+    gsize head = 1;
+    switch (blob->encoder->format) {
+    case PAYLOAD_FORMAT_TEXT:
+        at[0] = '\n';
+        break;
+    case PAYLOAD_FORMAT_JSON:
+        if (blob->count) {
+            at[0] = ',';
+        } else {
+            memmove(at, at + 1, len);
+            head = 0;
+        }
+        break;
+    case PAYLOAD_FORMAT_BINARY: {
+        head = varint_len(len);
+        if (1 + len + head - 1 >= room)
+            return FALSE;
+        memmove(at + head, at + 1, len);
+        Out o = { at, head + 1, 0 };
+        put_varint(&o, len);
+        break;
+    }
+    }
+    blob->len += head + len;
+    blob->count++;
+    return TRUE;
+}
+
+guint payload_blob_count(const PayloadBlob *blob)
+{
+    return blob->count;
+}
+
+gsize payload_blob_write(const PayloadBlob *blob, gchar *buf, gsize size)
+{
+    Out o = { buf, size, 0 };
+    switch (blob->encoder->format) {
+    case PAYLOAD_FORMAT_TEXT:
+        put_str(&o, "Events: ");
+        put_uint(&o, blob->count);
+        put(&o, blob->records, blob->len);
+        break;
+    case PAYLOAD_FORMAT_JSON:
+        put_str(&o, "{\"v\":1,\"count\":");
+        put_uint(&o, blob->count);
+        put_str(&o, ",\"events\":[");
+        put(&o, blob->records, blob->len);
+        put_str(&o, "]}");
+        break;
+    case PAYLOAD_FORMAT_BINARY: {
+        const guint8 head[2] = { PAYLOAD_BINARY_BLOB_MAGIC, PAYLOAD_BINARY_VERSION };
+        put(&o, head, sizeof(head));
+        put_varint(&o, blob->count);
+        put(&o, blob->records, blob->len);
+        break;
+    }
+    }
+    if (o.len < o.size)
+        o.buf[o.len] = '\0';
+    return o.len;
+}
+
+void payload_blob_reset(PayloadBlob *blob)
+{
+    blob->len   = 0;
+    blob->count = 0;
+}
+
+gboolean payload_split_binary_blob(const void *data, gsize len, PayloadRecordFunc func,
+                                   gpointer user_data)
+{
+    const guint8 *p = data, *end = p + len;
+    guint64 count, n;
+    if (len < 2 || p[0] != PAYLOAD_BINARY_BLOB_MAGIC || p[1] == 0 || p[1] > PAYLOAD_BINARY_VERSION)
+        return FALSE;
+    p += 2;
+    if (!get_varint(&p, end, &count))
+        return FALSE;
+    for (guint64 i = 0; i < count; i++) {
+        if (!get_varint(&p, end, &n) || n > (guint64)(end - p) || !func(p, n, user_data))
+            return FALSE;
+        p += n;
+    }
+    return p == end;
+}
@@ -1,18 +1,31 @@
 #include <gst/gst.h>
 #include <cuda_runtime_api.h>
 
-#include "nvds_yml_parser.h"
 #include "pipeline_builder.h"
+#include "source_bin.h"
+#include "fake_infer.h"
+#include "gie_join.h"
+#include "element_util.h"
 #include "logger.h"
 
 struct PipelineBuilder {
-    GstElement *pipeline;
-    char       *config_path;
+    GstElement            *pipeline;
+    const PipelineConfig  *config;
+    guint                  n_sources;
+    PipelineBuilderOptions options;
 };
 
-PipelineBuilder *pipeline_builder_new(const char *config_path)
+PipelineBuilder *pipeline_builder_new(const PipelineConfig         *config,
+                                      const PipelineBuilderOptions *options)
 {
     PipelineBuilder *builder = g_new0(PipelineBuilder, 1);
+    if (options)
+        builder->options = *options;
+    if (builder->options.backend == PIPELINE_BACKEND_SOFTWARE && !fake_infer_register()) {
+        log_error("Failed to register %s", FAKE_INFER_FACTORY);
+        g_free(builder);
+        return NULL;
+    }
 
     builder->pipeline = gst_pipeline_new("deepstream-app");
     if (!builder->pipeline) {
@@ -21,7 +34,7 @@ PipelineBuilder *pipeline_builder_new(const char *config_path)
         return NULL;
     }
 
-    builder->config_path = g_strdup(config_path);
+    builder->config = config;
     return builder;
 }
 
@@ -31,7 +44,6 @@ void pipeline_builder_free(PipelineBuilder *builder)
         return;
     if (builder->pipeline)
         gst_object_unref(GST_OBJECT(builder->pipeline));
-    g_free(builder->config_path);
     g_free(builder);
 }
 
@@ -62,48 +74,168 @@ static GstElement *make_and_add(PipelineBuilder *builder,
     return elem;
 }
 
-GstElement *pipeline_builder_add_source(PipelineBuilder *builder)
+static gboolean is_software(PipelineBuilder *builder)
+{
+    return builder->options.backend == PIPELINE_BACKEND_SOFTWARE;
+}
+
+/* DeepStream filters become identity so names, pads and probes stay where they were. */
+static GstElement *make_filter(PipelineBuilder *builder,
+                                const gchar     *factory,
+                                const gchar     *element_name)
+{
+    return make_and_add(builder, is_software(builder) ? "identity" : factory, element_name);
+}
+
+static GstElement *make_fake_sink(PipelineBuilder *builder, const gchar *element_name)
 {
-    GstElement *elem = make_and_add(builder, "filesrc", "file-source");
+    GstElement *elem = make_and_add(builder, "fakesink", element_name);
     if (elem)
-        nvds_parse_file_source(elem, builder->config_path, "source");
+        g_object_set(G_OBJECT(elem), "sync", FALSE, NULL);
     return elem;
 }
 
-GstElement *pipeline_builder_add_h264parser(PipelineBuilder *builder)
+/* Properties the config leaves out keep the element's default. */
+static void set_int(GstElement *elem, const gchar *property, gint value)
+{
+    if (value != PIPELINE_CONFIG_UNSET)
+        g_object_set(G_OBJECT(elem), property, value, NULL);
+}
+
+static void set_uint(GstElement *elem, const gchar *property, gint value)
+{
+    if (value != PIPELINE_CONFIG_UNSET)
+        g_object_set(G_OBJECT(elem), property, (guint)value, NULL);
+}
+
+static void set_flag(GstElement *elem, const gchar *property, gint value)
+{
+    if (value != PIPELINE_CONFIG_UNSET)
+        g_object_set(G_OBJECT(elem), property, (gboolean)value, NULL);
+}
+
+static void set_text(GstElement *elem, const gchar *property, const gchar *value)
 {
-    return make_and_add(builder, "h264parse", "h264-parser");
+    if (value)
+        g_object_set(G_OBJECT(elem), property, value, NULL);
 }
 
-GstElement *pipeline_builder_add_decoder(PipelineBuilder *builder)
+static gboolean append_fake_infer(PipelineBuilder *builder, GstElement *bin, guint index)
 {
-    return make_and_add(builder, "nvv4l2decoder", "nvv4l2-decoder");
+    gchar name[32];
+    g_snprintf(name, sizeof(name), "fake-infer-%u", index);
+    GstElement *elem = gst_element_factory_make(FAKE_INFER_FACTORY, name);
+    if (!elem) {
+        log_error("Failed to create element '%s' (factory '%s')", name, FAKE_INFER_FACTORY);
+        return FALSE;
+    }
+    const SyntheticMetaParams *params = &builder->options.synthetic;
+    g_object_set(G_OBJECT(elem),
+                 "source-id",         index,
+                 "objects-per-frame", CLAMP(params->objects_per_frame, 1u, 1024u),
+                 "plate-ratio",       params->plate_ratio,
+                 "label-cardinality", MAX(params->label_cardinality, 1u),
+                 "seed",              params->seed,
+                 NULL);
+    return source_bin_append(bin, elem);
+}
+
+guint pipeline_builder_get_n_sources(PipelineBuilder *builder)
+{
+    return builder ? builder->n_sources : 0;
+}
+
+gboolean pipeline_builder_add_sources(PipelineBuilder *builder)
+{
+    const SourceList *sources = builder->config->sources;
+    const gchar *decoder = is_software(builder) ? "avdec_h264" : "nvv4l2decoder";
+    for (guint i = 0; i < sources->n; i++) {
+        GstElement *bin = source_bin_new(i, &sources->items[i], decoder);
+        if (!bin)
+            return FALSE;
+        gst_bin_add(GST_BIN(builder->pipeline), bin);
+        /* The fake GIE chain sits before the muxer: funnel does not tell sources apart. */
+        if (is_software(builder) && !append_fake_infer(builder, bin, i))
+            return FALSE;
+        builder->n_sources++;
+        log_info("pipeline_builder: source %u '%s' from %s", i,
+                 sources->items[i].name, sources->items[i].location);
+    }
+    return TRUE;
 }
 
 GstElement *pipeline_builder_add_streamux(PipelineBuilder *builder)
 {
+    if (is_software(builder))
+        return make_and_add(builder, "funnel", "muxer");
+
     GstElement *elem = make_and_add(builder, "nvstreammux", "muxer");
-    if (elem)
-        nvds_parse_streammux(elem, builder->config_path, "streammux");
+    if (elem) {
+        const StreammuxConfig *c = &builder->config->streammux;
+        set_int (elem, "batched-push-timeout", c->batched_push_timeout);
+        set_uint(elem, "width",                c->width);
+        set_uint(elem, "height",               c->height);
+        set_flag(elem, "live-source",          c->live_source);
+        set_flag(elem, "enable-padding",       c->enable_padding);
+        set_uint(elem, "gpu-id",               c->gpu_id);
+        set_uint(elem, "nvbuf-memory-type",    c->nvbuf_memory_type);
+        /* One frame per source per batch; the YAML batch-size is ignored. */
+        if (builder->n_sources)
+            g_object_set(G_OBJECT(elem), "batch-size", builder->n_sources, NULL);
+    }
     return elem;
 }
 
-GstElement *pipeline_builder_add_tracker(PipelineBuilder *builder)
+GstElement *pipeline_builder_add_tracker(PipelineBuilder     *builder,
+                                          const gchar         *element_name,
+                                          const TrackerConfig *config)
 {
-    GstElement *elem = make_and_add(builder, "nvtracker", "tracker");
-    if (elem)
-        nvds_parse_tracker(elem, builder->config_path, "tracker");
+    GstElement *elem = make_filter(builder, "nvtracker", element_name);
+    if (elem && !is_software(builder)) {
+        set_uint(elem, "tracker-width",       config->tracker_width);
+        set_uint(elem, "tracker-height",      config->tracker_height);
+        set_uint(elem, "gpu-id",              config->gpu_id);
+        set_text(elem, "ll-lib-file",         config->ll_lib_file);
+        set_text(elem, "ll-config-file",      config->ll_config_file);
+        set_flag(elem, "display-tracking-id", config->display_tracking_id);
+    }
     return elem;
 }
 
+/* Headless, the OSD and its conversion only keep their names for the probes. */
 GstElement *pipeline_builder_add_nvvidconv(PipelineBuilder *builder)
 {
-    return make_and_add(builder, "nvvideoconvert", "nvvideo-converter");
+    if (builder->options.headless)
+        return make_and_add(builder, "identity", "nvvideo-converter");
+    return make_filter(builder, "nvvideoconvert", "nvvideo-converter");
 }
 
 GstElement *pipeline_builder_add_nvosd(PipelineBuilder *builder)
 {
-    return make_and_add(builder, "nvdsosd", "on-screen-display");
+    if (builder->options.headless)
+        return make_and_add(builder, "identity", "on-screen-display");
+    return make_filter(builder, "nvdsosd", "on-screen-display");
+}
+
+GstElement *pipeline_builder_add_tiler(PipelineBuilder *builder)
+{
+    GstElement *elem = make_filter(builder, "nvmultistreamtiler", "tiler");
+    if (!elem || is_software(builder))
+        return elem;
+
+    guint columns = 1;
+    while (columns * columns < builder->n_sources)
+        columns++;
+    guint rows = (builder->n_sources + columns - 1) / columns;
+    guint width = 1920, height = 1080;
+    GstElement *muxer = pipeline_builder_get_element(builder, "muxer");
+    if (muxer) {
+        g_object_get(G_OBJECT(muxer), "width", &width, "height", &height, NULL);
+        gst_object_unref(muxer);
+    }
+    g_object_set(G_OBJECT(elem), "rows", rows, "columns", columns,
+                 "width", width, "height", height, NULL);
+    return elem;
 }
 
 GstElement *pipeline_builder_add_tee(PipelineBuilder *builder)
@@ -113,24 +245,50 @@ GstElement *pipeline_builder_add_tee(PipelineBuilder *builder)
 
 GstElement *pipeline_builder_add_msgconv(PipelineBuilder *builder)
 {
-    GstElement *elem = make_and_add(builder, "nvmsgconv", "nvmsg-converter");
-    if (elem) {
-        g_object_set(G_OBJECT(elem), "config", "msgconv_config.yml", NULL);
-        nvds_parse_msgconv(elem, builder->config_path, "msgconv");
+    GstElement *elem = make_filter(builder, "nvmsgconv", "nvmsg-converter");
+    if (elem && !is_software(builder)) {
+        const MsgconvConfig *c = &builder->config->msgconv;
+        set_text(elem, "config",            c->config);
+        set_int (elem, "payload-type",      c->payload_type);
+        set_text(elem, "msg2p-lib",         c->msg2p_lib);
+        set_flag(elem, "msg2p-newapi",      c->msg2p_newapi);
+        set_uint(elem, "frame-interval",    c->frame_interval);
+        set_text(elem, "debug-payload-dir", c->debug_payload_dir);
+        set_uint(elem, "comp-id",           c->comp_id);
     }
     return elem;
 }
 
 GstElement *pipeline_builder_add_msgbroker(PipelineBuilder *builder)
 {
+    if (is_software(builder))
+        return make_fake_sink(builder, "msg-broker");
+
     GstElement *elem = make_and_add(builder, "nvmsgbroker", "msg-broker");
-    if (elem)
-        nvds_parse_msgbroker(elem, builder->config_path, "msgbroker");
+    if (elem) {
+        const MsgbrokerConfig *c = &builder->config->msgbroker;
+        set_text(elem, "proto-lib", c->link.proto_lib);
+        set_text(elem, "conn-str",  c->link.conn_str);
+        set_text(elem, "topic",     c->link.topic);
+        set_text(elem, "config",    c->link.config);
+        set_flag(elem, "sync",      c->sync);
+        set_uint(elem, "comp-id",   c->comp_id);
+        if (builder->options.headless)
+            g_object_set(G_OBJECT(elem), "sync", FALSE, NULL);
+    }
     return elem;
 }
 
+GstElement *pipeline_builder_add_msg_sink(PipelineBuilder *builder)
+{
+    return make_fake_sink(builder, "msg-broker");
+}
+
 GstElement *pipeline_builder_add_sink(PipelineBuilder *builder)
 {
+    if (is_software(builder))
+        return make_fake_sink(builder, "fake-sink");
+
     int current_device = -1;
     cudaGetDevice(&current_device);
     struct cudaDeviceProp prop;
@@ -142,13 +300,18 @@ GstElement *pipeline_builder_add_sink(PipelineBuilder *builder)
         return make_and_add(builder, "nveglglessink", "nvvideo-renderer");
 }
 
-GstElement *pipeline_builder_add_infer(PipelineBuilder *builder,
-                                        const gchar     *element_name,
-                                        const gchar     *config_section)
+GstElement *pipeline_builder_add_infer(PipelineBuilder   *builder,
+                                        const gchar       *element_name,
+                                        const InferConfig *config)
 {
-    GstElement *elem = make_and_add(builder, "nvinfer", element_name);
-    if (elem)
-        nvds_parse_gie(elem, builder->config_path, config_section);
+    GstElement *elem = make_filter(builder, "nvinfer", element_name);
+    if (elem && !is_software(builder)) {
+        set_text(elem, "config-file-path", config->config_file_path);
+        set_uint(elem, "batch-size",       config->batch_size);
+        set_uint(elem, "interval",         config->interval);
+        set_uint(elem, "gpu-id",           config->gpu_id);
+        set_uint(elem, "unique-id",        config->unique_id);
+    }
     return elem;
 }
 
@@ -157,3 +320,77 @@ GstElement *pipeline_builder_add_queue(PipelineBuilder *builder,
 {
     return make_and_add(builder, "queue", element_name);
 }
+
+GstElement *pipeline_builder_add_bounded_queue(PipelineBuilder *builder,
+                                                const gchar     *element_name,
+                                                guint            max_buffers,
+                                                const gchar     *leaky)
+{
+    GstElement *elem = make_and_add(builder, "queue", element_name);
+    if (!elem)
+        return NULL;
+    g_object_set(G_OBJECT(elem), "max-size-buffers", MAX(max_buffers, 1u),
+                 "max-size-bytes", 0u, "max-size-time", (guint64)0, NULL);
+    gst_util_set_object_arg(G_OBJECT(elem), "leaky", leaky);
+    return elem;
+}
+
+static gboolean add_gie_node(PipelineBuilder *builder, const GieGraph *graph, guint node)
+{
+    const GieNode *n = &graph->nodes[node];
+    const GieNodeConfig *config = &builder->config->nodes[node];
+    GstElement *elem = n->type == GIE_NODE_TRACKER
+        ? pipeline_builder_add_tracker(builder, n->name, &config->tracker)
+        : pipeline_builder_add_infer(builder, n->name, &config->infer);
+    if (!elem)
+        return FALSE;
+    /* runtime.pgie-interval wins over the PGIE section's, as it does on a reload. */
+    if (node == 0 && element_util_has_property(elem, "interval"))
+        set_uint(elem, "interval", builder->config->runtime.pgie_interval);
+
+    guint peers[GIE_GRAPH_MAX_NODES];
+    gchar name[64];
+    guint n_succ = gie_graph_successors(graph, node, peers);
+    if (n_succ > 1) {
+        g_snprintf(name, sizeof(name), GIE_GRAPH_TEE_FMT, n->name);
+        if (!make_and_add(builder, "tee", name))
+            return FALSE;
+        for (guint k = 0; k < n_succ; k++) {
+            g_snprintf(name, sizeof(name), GIE_GRAPH_QUEUE_FMT, n->name, k);
+            if (!pipeline_builder_add_queue(builder, name))
+                return FALSE;
+        }
+    }
+    if (gie_graph_predecessors(graph, node, peers) > 1) {
+        g_snprintf(name, sizeof(name), GIE_GRAPH_JOIN_FMT, n->name);
+        if (!make_and_add(builder, GIE_JOIN_FACTORY, name))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+gboolean pipeline_builder_add_gie_graph(PipelineBuilder *builder)
+{
+    const GieGraph *graph = builder->config->gie_graph;
+
+    /* Idempotent; a plain chain just never instantiates the factory. */
+    if (!gie_join_register()) {
+        log_error("Failed to register %s", GIE_JOIN_FACTORY);
+        return FALSE;
+    }
+
+    guint exits[GIE_GRAPH_MAX_NODES];
+    guint n_exits = gie_graph_exits(graph, exits);
+
+    for (guint i = 0; i < graph->n_nodes; i++)
+        if (!add_gie_node(builder, graph, i))
+            return FALSE;
+    if (n_exits > 1 && !make_and_add(builder, GIE_JOIN_FACTORY, GIE_GRAPH_EXIT_JOIN))
+        return FALSE;
+    return TRUE;
+}
+
+const GieGraph *pipeline_builder_get_gie_graph(PipelineBuilder *builder)
+{
+    return builder ? builder->config->gie_graph : NULL;
+}
@@ -0,0 +1,471 @@
+#include "pipeline_config.h"
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "frame_index.h"
+#include "yaml_util.h"
+#include "config.h"
+#include "logger.h"
+
+typedef enum {
+    KEY_NUMBER,    /* gint in [min, max] */
+    KEY_FLAG,      /* gint, 0 or 1 */
+    KEY_PROB,      /* gfloat in [0, 1] */
+    KEY_TEXT,
+    KEY_FILE,      /* relative to the YAML's dir */
+    KEY_LIB,       /* a file when it has a '/', else left to dlopen */
+    KEY_DIR,
+    KEY_IGNORED,
+} KeyKind;
+
+typedef struct {
+    const gchar *key;
+    KeyKind      kind;
+    gsize        offset;
+    gint         min;
+    gint         max;
+} KeySpec;
+
+#define NUMBER(key, type, field, min, max) { key, KEY_NUMBER, offsetof(type, field), min, max }
+#define FIELD(key, kind, type, field)      { key, kind, offsetof(type, field), 0, 0 }
+
+static const KeySpec streammux_keys[] = {
+    { "batch-size", KEY_IGNORED, 0, 0, 0 },
+    NUMBER("batched-push-timeout", StreammuxConfig, batched_push_timeout, -1, G_MAXINT),
+    NUMBER("width",                StreammuxConfig, width,                1, 16384),
+    NUMBER("height",               StreammuxConfig, height,               1, 16384),
+    FIELD ("live-source",    KEY_FLAG, StreammuxConfig, live_source),
+    FIELD ("enable-padding", KEY_FLAG, StreammuxConfig, enable_padding),
+    NUMBER("gpu-id",               StreammuxConfig, gpu_id,               0, G_MAXINT),
+    NUMBER("nvbuf-memory-type",    StreammuxConfig, nvbuf_memory_type,    0, 3),
+};
+
+static const KeySpec infer_keys[] = {
+    { "plugin-type", KEY_IGNORED, 0, 0, 0 },   /* checked on its own */
+    FIELD ("config-file-path", KEY_FILE, InferConfig, config_file_path),
+    NUMBER("batch-size", InferConfig, batch_size, 1, 1024),
+    NUMBER("interval",   InferConfig, interval,   0, G_MAXINT),
+    NUMBER("gpu-id",     InferConfig, gpu_id,     0, G_MAXINT),
+    NUMBER("unique-id",  InferConfig, unique_id,  0, G_MAXINT),
+};
+
+static const KeySpec tracker_keys[] = {
+    NUMBER("tracker-width",  TrackerConfig, tracker_width,  1, 16384),
+    NUMBER("tracker-height", TrackerConfig, tracker_height, 1, 16384),
+    NUMBER("gpu-id",         TrackerConfig, gpu_id,         0, G_MAXINT),
+    FIELD ("ll-lib-file",         KEY_LIB,  TrackerConfig, ll_lib_file),
+    FIELD ("ll-config-file",      KEY_FILE, TrackerConfig, ll_config_file),
+    FIELD ("display-tracking-id", KEY_FLAG, TrackerConfig, display_tracking_id),
+};
+
+static const KeySpec msgconv_keys[] = {
+    FIELD ("config",            KEY_FILE, MsgconvConfig, config),
+    NUMBER("payload-type",   MsgconvConfig, payload_type,   0, 257),
+    FIELD ("msg2p-lib",         KEY_LIB,  MsgconvConfig, msg2p_lib),
+    FIELD ("msg2p-newapi",      KEY_FLAG, MsgconvConfig, msg2p_newapi),
+    NUMBER("frame-interval", MsgconvConfig, frame_interval, 1, G_MAXINT),
+    FIELD ("debug-payload-dir", KEY_DIR,  MsgconvConfig, debug_payload_dir),
+    NUMBER("comp-id",        MsgconvConfig, comp_id,        0, G_MAXINT),
+};
+
+static const KeySpec msgbroker_keys[] = {
+    FIELD ("proto-lib", KEY_LIB,  MsgbrokerConfig, link.proto_lib),
+    FIELD ("conn-str",  KEY_TEXT, MsgbrokerConfig, link.conn_str),
+    FIELD ("topic",     KEY_TEXT, MsgbrokerConfig, link.topic),
+    FIELD ("config",    KEY_FILE, MsgbrokerConfig, link.config),
+    FIELD ("sync",      KEY_FLAG, MsgbrokerConfig, sync),
+    NUMBER("comp-id",   MsgbrokerConfig, comp_id, 0, G_MAXINT),
+};
+
+static const KeySpec runtime_keys[] = {
+    NUMBER("pgie-interval", RuntimeConfig, pgie_interval, 0, G_MAXINT),
+    FIELD ("make-threshold",  KEY_PROB, RuntimeConfig, min_prob[RUNTIME_MAKE_THRESHOLD]),
+    FIELD ("type-threshold",  KEY_PROB, RuntimeConfig, min_prob[RUNTIME_TYPE_THRESHOLD]),
+    FIELD ("plate-threshold", KEY_PROB, RuntimeConfig, min_prob[RUNTIME_PLATE_THRESHOLD]),
+    FIELD ("detection-output-dir", KEY_TEXT, RuntimeConfig, detection_output_dir),
+    NUMBER("track-heartbeat-frames", RuntimeConfig, track_heartbeat_frames, 0, G_MAXINT),
+    NUMBER("track-lost-frames",      RuntimeConfig, track_lost_frames,      0, G_MAXINT),
+};
+
+static const struct {
+    const gchar *key;
+    gint         component_id;
+} thresholds[RUNTIME_N_THRESHOLDS] = {
+    [RUNTIME_MAKE_THRESHOLD]  = { "make-threshold",  GIE_ID_VEHICLE_MAKE },
+    [RUNTIME_TYPE_THRESHOLD]  = { "type-threshold",  GIE_ID_VEHICLE_TYPE },
+    [RUNTIME_PLATE_THRESHOLD] = { "plate-threshold", GIE_ID_PLATE_READER },
+};
+
+/* Top-level sections read here; any other one must be named by a gie-graph node. */
+static const gchar *const known_sections[] = {
+    "sources", "source", "streammux", "gie-graph", "msgconv", "msgbroker", "runtime",
+};
+
+/* What the settings will build, so only the files it opens must exist. */
+typedef struct {
+    gboolean deepstream;    /* nvstreammux, nvinfer and nvtracker rather than the software backend */
+    gboolean nvmsgbroker;   /* nvmsgconv and nvmsgbroker rather than the native publisher */
+} PipelineConfigOptions;
+
+typedef struct {
+    yaml_document_t *doc;
+    const gchar     *path;
+    gchar           *dir;      /* relative file names are under it */
+    guint            errors;
+} Parser;
+
+static void report(Parser *p, yaml_node_t *node, const gchar *fmt, ...) G_GNUC_PRINTF(3, 4);
+
+/* Logs one problem and carries on, so a single run lists them all. */
+static void report(Parser *p, yaml_node_t *node, const gchar *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    gchar *message = g_strdup_vprintf(fmt, args);
+    va_end(args);
+    if (node)
+        log_error("pipeline_config: %s:%zu: %s", p->path, node->start_mark.line + 1, message);
+    else
+        log_error("pipeline_config: %s: %s", p->path, message);
+    g_free(message);
+    p->errors++;
+}
+
+static gchar *resolve(const Parser *p, const gchar *name)
+{
+    return g_path_is_absolute(name) ? g_strdup(name) : g_build_filename(p->dir, name, NULL);
+}
+
+static void set_text(gpointer out, gsize offset, gchar *text)
+{
+    g_free(G_STRUCT_MEMBER(gchar *, out, offset));
+    G_STRUCT_MEMBER(gchar *, out, offset) = text;
+}
+
+static void parse_value(Parser *p, const gchar *section, const KeySpec *spec, yaml_node_t *node,
+                        gboolean check_files, gpointer out)
+{
+    const gchar *text = yaml_util_scalar(node);
+    if (!text || (!text[0] && spec->kind != KEY_TEXT)) {
+        report(p, node, "%s.%s: needs a single value", section, spec->key);
+        return;
+    }
+
+    gchar *end = NULL;
+    switch (spec->kind) {
+    case KEY_NUMBER: {
+        gint64 value = g_ascii_strtoll(text, &end, 10);
+        if (*end)
+            report(p, node, "%s.%s: '%s' is not a number", section, spec->key, text);
+        else if (value < spec->min || value > spec->max)
+            report(p, node, "%s.%s: %s is not in %d..%d", section, spec->key, text, spec->min, spec->max);
+        else
+            G_STRUCT_MEMBER(gint, out, spec->offset) = (gint)value;
+        break;
+    }
+    case KEY_FLAG:
+        if (g_strcmp0(text, "0") == 0 || g_ascii_strcasecmp(text, "false") == 0)
+            G_STRUCT_MEMBER(gint, out, spec->offset) = 0;
+        else if (g_strcmp0(text, "1") == 0 || g_ascii_strcasecmp(text, "true") == 0)
+            G_STRUCT_MEMBER(gint, out, spec->offset) = 1;
+        else
+            report(p, node, "%s.%s: '%s' is not 0 or 1", section, spec->key, text);
+        break;
+    case KEY_PROB: {
+        gdouble value = g_ascii_strtod(text, &end);
+        if (*end || !(value >= 0.0 && value <= 1.0))
+            report(p, node, "%s.%s: '%s' is not a probability", section, spec->key, text);
+        else
+            G_STRUCT_MEMBER(gfloat, out, spec->offset) = (gfloat)value;
+        break;
+    }
+    case KEY_TEXT:
+        set_text(out, spec->offset, g_strdup(text));
+        break;
+    case KEY_FILE:
+    case KEY_LIB: {
+        gboolean is_path = spec->kind == KEY_FILE || strchr(text, '/');
+        gchar *path = is_path ? resolve(p, text) : g_strdup(text);
+        if (check_files && is_path && !g_file_test(path, G_FILE_TEST_IS_REGULAR))
+            report(p, node, "%s.%s: no file %s", section, spec->key, path);
+        set_text(out, spec->offset, path);
+        break;
+    }
+    case KEY_DIR:
+        if (check_files && !g_file_test(text, G_FILE_TEST_IS_DIR))
+            report(p, node, "%s.%s: no directory %s", section, spec->key, text);
+        set_text(out, spec->offset, g_strdup(text));
+        break;
+    case KEY_IGNORED:
+        break;
+    }
+}
+
+/* The mapping under name, NULL when absent or with every key commented out. */
+static yaml_node_t *get_section(Parser *p, const gchar *name)
+{
+    yaml_node_t *node = yaml_util_get(p->doc, yaml_document_get_root_node(p->doc), name);
+    if (!node || g_strcmp0(yaml_util_scalar(node), "") == 0)
+        return NULL;
+    if (node->type != YAML_MAPPING_NODE) {
+        report(p, node, "%s: must be a mapping", name);
+        return NULL;
+    }
+    return node;
+}
+
+/* Fills out from section after resetting every number and flag of specs to PIPELINE_CONFIG_UNSET. */
+static void parse_section(Parser *p, const gchar *name, yaml_node_t *section,
+                          const KeySpec *specs, guint n_specs, gboolean check_files, gpointer out)
+{
+    for (guint i = 0; i < n_specs; i++)
+        if (specs[i].kind == KEY_NUMBER || specs[i].kind == KEY_FLAG)
+            G_STRUCT_MEMBER(gint, out, specs[i].offset) = PIPELINE_CONFIG_UNSET;
+    if (!section)
+        return;
+
+    for (yaml_node_pair_t *pair = section->data.mapping.pairs.start;
+         pair < section->data.mapping.pairs.top; pair++) {
+        yaml_node_t *key_node = yaml_document_get_node(p->doc, pair->key);
+        const gchar *key = yaml_util_scalar(key_node);
+        const KeySpec *spec = NULL;
+        for (guint i = 0; i < n_specs && !spec; i++)
+            if (g_strcmp0(specs[i].key, key) == 0)
+                spec = &specs[i];
+        if (!spec) {
+            report(p, key_node, "%s: unknown key '%s'", name, key ? key : "?");
+            continue;
+        }
+        parse_value(p, name, spec, yaml_document_get_node(p->doc, pair->value), check_files, out);
+    }
+}
+
+static void clear_section(const KeySpec *specs, guint n_specs, gpointer out)
+{
+    for (guint i = 0; i < n_specs; i++)
+        if (specs[i].kind == KEY_TEXT || specs[i].kind == KEY_FILE ||
+            specs[i].kind == KEY_LIB  || specs[i].kind == KEY_DIR)
+            g_clear_pointer(&G_STRUCT_MEMBER(gchar *, out, specs[i].offset), g_free);
+}
+
+static void parse_runtime(Parser *p, const AppSettings *settings, RuntimeConfig *out)
+{
+    memset(out, 0, sizeof(*out));
+    parse_section(p, "runtime", get_section(p, "runtime"),
+                  runtime_keys, G_N_ELEMENTS(runtime_keys), FALSE, out);
+    RuntimeConfig defaults;
+    runtime_config_init(&defaults, settings);
+    if (!out->detection_output_dir)
+        out->detection_output_dir = g_strdup(defaults.detection_output_dir);
+    if (out->track_heartbeat_frames == PIPELINE_CONFIG_UNSET)
+        out->track_heartbeat_frames = defaults.track_heartbeat_frames;
+    if (out->track_lost_frames == PIPELINE_CONFIG_UNSET)
+        out->track_lost_frames = defaults.track_lost_frames;
+    runtime_config_clear(&defaults);
+}
+
+static void check_sources(Parser *p, const SourceList *sources)
+{
+    for (guint i = 0; i < sources->n; i++)
+        if (!g_file_test(sources->items[i].location, G_FILE_TEST_EXISTS))
+            report(p, NULL, "sources: %s: no file %s", sources->items[i].name, sources->items[i].location);
+}
+
+static void parse_node(Parser *p, const GieNode *node, const PipelineConfigOptions *options,
+                       GieNodeConfig *out)
+{
+    yaml_node_t *section = get_section(p, node->config);
+    if (!section && options->deepstream)
+        report(p, NULL, "gie-graph: node '%s' names section '%s', which is not set", node->name, node->config);
+    if (node->type == GIE_NODE_TRACKER) {
+        parse_section(p, node->config, section, tracker_keys, G_N_ELEMENTS(tracker_keys),
+                      options->deepstream, &out->tracker);
+        if (section && options->deepstream && !out->tracker.ll_lib_file)
+            report(p, section, "%s: tracker '%s' needs ll-lib-file", node->config, node->name);
+        return;
+    }
+
+    parse_section(p, node->config, section, infer_keys, G_N_ELEMENTS(infer_keys),
+                  options->deepstream, &out->infer);
+    const gchar *plugin_type = yaml_util_scalar(yaml_util_get(p->doc, section, "plugin-type"));
+    if (plugin_type && g_strcmp0(plugin_type, "0") != 0)
+        report(p, section, "%s.plugin-type: %s is not supported, only nvinfer (0)", node->config, plugin_type);
+    if (section && options->deepstream && !out->infer.config_file_path)
+        report(p, section, "%s: '%s' needs config-file-path", node->config, node->name);
+}
+
+static void parse_msgbroker(Parser *p, const PipelineConfigOptions *options, MsgbrokerConfig *out)
+{
+    yaml_node_t *section = get_section(p, "msgbroker");
+    gboolean element = options->deepstream && options->nvmsgbroker;
+    parse_section(p, "msgbroker", section, msgbroker_keys, G_N_ELEMENTS(msgbroker_keys), element, out);
+
+    /* Every publisher path needs somewhere to publish. */
+    if (!out->link.conn_str || !out->link.conn_str[0])
+        report(p, section, "msgbroker: conn-str is required");
+    if (!out->link.topic || !out->link.topic[0])
+        report(p, section, "msgbroker: topic is required");
+    if (element && !out->link.proto_lib)
+        report(p, section, "msgbroker: proto-lib is required with MSG_PUBLISHER=nvmsgbroker");
+
+    gchar **conn = out->link.conn_str ? g_strsplit(out->link.conn_str, ";", 3) : NULL;
+    if (conn && conn[0] && conn[1]) {
+        gchar *end = NULL;
+        guint64 port = g_ascii_strtoull(conn[1], &end, 10);
+        if (*end || port == 0 || port > 65535)
+            report(p, section, "msgbroker.conn-str: '%s' is not a port", conn[1]);
+    }
+    g_strfreev(conn);
+}
+
+static void warn_unused_sections(Parser *p, const GieGraph *graph)
+{
+    yaml_node_t *root = yaml_document_get_root_node(p->doc);
+    for (yaml_node_pair_t *pair = root->data.mapping.pairs.start;
+         pair < root->data.mapping.pairs.top; pair++) {
+        yaml_node_t *key_node = yaml_document_get_node(p->doc, pair->key);
+        const gchar *name = yaml_util_scalar(key_node);
+        gboolean used = FALSE;
+        for (guint i = 0; i < G_N_ELEMENTS(known_sections) && !used; i++)
+            used = g_strcmp0(known_sections[i], name) == 0;
+        for (guint i = 0; i < graph->n_nodes && !used; i++)
+            used = g_strcmp0(graph->nodes[i].config, name) == 0;
+        if (!used)
+            log_warning("pipeline_config: %s:%zu: section '%s' is not used", p->path,
+                        key_node->start_mark.line + 1, name ? name : "?");
+    }
+}
+
+static void parse_document(Parser *p, const PipelineConfigOptions *options, PipelineConfig *config)
+{
+    yaml_node_t *root = yaml_document_get_root_node(p->doc);
+    if (!root || root->type != YAML_MAPPING_NODE) {
+        report(p, root, "not a mapping of sections");
+        return;
+    }
+
+    if (!(config->sources = source_list_parse(p->doc)))
+        p->errors++;
+    else
+        check_sources(p, config->sources);
+
+    yaml_node_t *streammux = get_section(p, "streammux");
+    parse_section(p, "streammux", streammux, streammux_keys, G_N_ELEMENTS(streammux_keys), FALSE,
+                  &config->streammux);
+    if (options->deepstream && (!yaml_util_get(p->doc, streammux, "width") ||
+                                !yaml_util_get(p->doc, streammux, "height")))
+        report(p, streammux, "streammux: width and height are required");
+
+    if (!(config->gie_graph = gie_graph_parse(p->doc))) {
+        p->errors++;
+    } else {
+        config->nodes = g_new0(GieNodeConfig, config->gie_graph->n_nodes);
+        for (guint i = 0; i < config->gie_graph->n_nodes; i++)
+            parse_node(p, &config->gie_graph->nodes[i], options, &config->nodes[i]);
+        warn_unused_sections(p, config->gie_graph);
+    }
+
+    yaml_node_t *msgconv = get_section(p, "msgconv");
+    parse_section(p, "msgconv", msgconv, msgconv_keys, G_N_ELEMENTS(msgconv_keys),
+                  options->deepstream && options->nvmsgbroker, &config->msgconv);
+    gint payload_type = config->msgconv.payload_type;
+    if (payload_type > 2 && payload_type != 257)
+        report(p, msgconv, "msgconv.payload-type: %d is not 0, 1, 2 or 257", payload_type);
+    parse_msgbroker(p, options, &config->msgbroker);
+    parse_runtime(p, &config->settings, &config->runtime);
+}
+
+PipelineConfig *pipeline_config_load(const char *yaml_path)
+{
+    gint64 mtime_ns, size;
+    yaml_util_stamp(yaml_path, &mtime_ns, &size);
+    yaml_document_t *doc = g_new(yaml_document_t, 1);
+    if (!yaml_util_load(yaml_path, doc, "pipeline_config")) {
+        g_free(doc);
+        return NULL;
+    }
+
+    PipelineConfig *config = g_new0(PipelineConfig, 1);
+    config->path     = g_strdup(yaml_path);
+    config->doc      = doc;
+    config->mtime_ns = mtime_ns;
+    config->size     = size;
+    Parser p = { .doc = doc, .path = yaml_path, .dir = g_path_get_dirname(yaml_path) };
+    p.errors = config_load_settings(&config->settings);
+    PipelineConfigOptions options = {
+        .deepstream  = g_strcmp0(config->settings.pipeline_backend, "deepstream") == 0,
+        .nvmsgbroker = g_strcmp0(config->settings.msg_publisher, "nvmsgbroker") == 0,
+    };
+    parse_document(&p, &options, config);
+    g_free(p.dir);
+
+    if (p.errors) {
+        log_error("pipeline_config: %s: %u %s, nothing built", yaml_path, p.errors,
+                  p.errors == 1 ? "problem" : "problems");
+        pipeline_config_free(config);
+        return NULL;
+    }
+    log_info("pipeline_config: %s: %u sources, %u GIE graph nodes", yaml_path,
+             config->sources->n, config->gie_graph->n_nodes);
+    return config;
+}
+
+void pipeline_config_free(PipelineConfig *config)
+{
+    if (!config)
+        return;
+    for (guint i = 0; config->nodes && i < config->gie_graph->n_nodes; i++) {
+        clear_section(infer_keys,   G_N_ELEMENTS(infer_keys),   &config->nodes[i].infer);
+        clear_section(tracker_keys, G_N_ELEMENTS(tracker_keys), &config->nodes[i].tracker);
+    }
+    g_free(config->nodes);
+    gie_graph_free(config->gie_graph);
+    source_list_free(config->sources);
+    clear_section(msgconv_keys, G_N_ELEMENTS(msgconv_keys), &config->msgconv);
+    broker_link_options_clear(&config->msgbroker.link);
+    runtime_config_clear(&config->runtime);
+    if (config->doc) {
+        yaml_document_delete(config->doc);
+        g_free(config->doc);
+    }
+    g_free(config->path);
+    g_free(config);
+}
+
+gboolean pipeline_config_parse_runtime(yaml_document_t *doc, const char *yaml_path,
+                                       const AppSettings *settings, RuntimeConfig *out)
+{
+    Parser p = { .doc = doc, .path = yaml_path, .dir = g_path_get_dirname(yaml_path) };
+    parse_runtime(&p, settings, out);
+    g_free(p.dir);
+    if (p.errors)
+        runtime_config_clear(out);
+    return p.errors == 0;
+}
+
+void runtime_config_init(RuntimeConfig *runtime, const AppSettings *settings)
+{
+    *runtime = (RuntimeConfig){
+        .pgie_interval          = PIPELINE_CONFIG_UNSET,
+        .detection_output_dir   = g_strdup(settings->detection_output_dir),
+        .track_heartbeat_frames = (gint)settings->track_heartbeat_frames,
+        .track_lost_frames      = (gint)settings->track_lost_frames,
+    };
+}
+
+void runtime_config_clear(RuntimeConfig *runtime)
+{
+    clear_section(runtime_keys, G_N_ELEMENTS(runtime_keys), runtime);
+}
+
+const gchar *runtime_threshold_key(RuntimeThreshold threshold)
+{
+    return thresholds[threshold].key;
+}
+
+gint runtime_threshold_component(RuntimeThreshold threshold)
+{
+    return thresholds[threshold].component_id;
+}
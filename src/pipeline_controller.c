@@ -1,14 +1,86 @@
 #include "pipeline_controller.h"
 
+#include <signal.h>
 #include <gst/gst.h>
 #include <glib.h>
+#include <glib-unix.h>
+
+#include "config.h"
+#include "load_shedder.h"
+#include "logger.h"
+#include "probe_stats.h"
+#include "run_report.h"
+#include "buffer_trace.h"
+#include "config_reload.h"
 
 struct PipelineController {
     GstElement *pipeline;
     GMainLoop  *loop;
     guint       bus_watch_id;
+    guint       stats_timer_id;
+    guint       load_timer_id;
+    guint       trace_signal_id;
+    guint       reload_signal_id;
+    guint       reload_timer_id;
+    LoadShedder *load_shedder;   /* owned by the pipeline */
+    RunReport   *run_report;     /* owned by the pipeline */
+    BufferTrace *buffer_trace;   /* owned by the pipeline */
+    ConfigReload *config_reload; /* owned by the pipeline */
 };
 
+static gboolean log_probe_stats(gpointer data)
+{
+    (void) data;
+    probe_stats_log();
+    return G_SOURCE_CONTINUE;
+}
+
+/* Level changes go out as "load-level" application messages on the pipeline bus. */
+static gboolean load_tick(gpointer data)
+{
+    PipelineController *controller = (PipelineController *) data;
+    LoadControlStats stats;
+    if (!load_shedder_tick(controller->load_shedder, &stats))
+        return G_SOURCE_CONTINUE;
+
+    const LoadLevel *level = load_control_settings(stats.level);
+    log_info("load: level %u (latency %.0f ms, queue fill %.0f%%): PGIE interval %u, make/type %s, LPR 1/%u frames",
+             stats.level, stats.latency_ms, stats.queue_fill * 100.0, level->pgie_interval,
+             level->classify ? "on" : "off", level->lpr_every);
+    GstStructure *event = gst_structure_new("load-level",
+                                            "level",      G_TYPE_UINT,   stats.level,
+                                            "latency-ms", G_TYPE_DOUBLE, stats.latency_ms,
+                                            "queue-fill", G_TYPE_DOUBLE, stats.queue_fill,
+                                            NULL);
+    gst_element_post_message(controller->pipeline,
+                             gst_message_new_application(GST_OBJECT(controller->pipeline), event));
+    return G_SOURCE_CONTINUE;
+}
+
+/* SIGUSR1 writes the trace so far without stopping the run. */
+static gboolean write_trace(gpointer data)
+{
+    PipelineController *controller = (PipelineController *) data;
+    buffer_trace_write(controller->buffer_trace);
+    return G_SOURCE_CONTINUE;
+}
+
+/* SIGHUP re-reads the config; the stream keeps running. */
+static gboolean reload_config(gpointer data)
+{
+    PipelineController *controller = (PipelineController *) data;
+    config_reload_apply(controller->config_reload);
+    return G_SOURCE_CONTINUE;
+}
+
+static gboolean watch_config(gpointer data)
+{
+    PipelineController *controller = (PipelineController *) data;
+    if (config_reload_file_changed(controller->config_reload))
+        config_reload_apply(controller->config_reload);
+    return G_SOURCE_CONTINUE;
+}
+
 static gboolean bus_call(GstBus *bus, GstMessage *msg, gpointer data)
 {
     PipelineController *controller = (PipelineController *) data;
@@ -18,6 +90,9 @@ static gboolean bus_call(GstBus *bus, GstMessage *msg, gpointer data)
     switch (GST_MESSAGE_TYPE(msg)) {
         case GST_MESSAGE_EOS:
             g_print("End of stream\n");
+            probe_stats_log();
+            run_report_log(controller->run_report);
+            buffer_trace_write(controller->buffer_trace);
             g_main_loop_quit(controller->loop);
             break;
         case GST_MESSAGE_ERROR: {
@@ -53,6 +128,29 @@ PipelineController *pipeline_controller_new(GstElement *pipeline)
     controller->bus_watch_id = gst_bus_add_watch(bus, bus_call, controller);
     gst_object_unref(bus);
 
+    /* From director_build; none for a pipeline built elsewhere. */
+    const AppSettings *settings = g_object_get_data(G_OBJECT(pipeline), "settings");
+    if (settings && settings->probe_stats_interval_s)
+        controller->stats_timer_id = g_timeout_add_seconds(settings->probe_stats_interval_s,
+                                                           log_probe_stats, NULL);
+
+    controller->run_report   = g_object_get_data(G_OBJECT(pipeline), "run-report");
+    controller->buffer_trace = g_object_get_data(G_OBJECT(pipeline), "buffer-trace");
+    controller->load_shedder = g_object_get_data(G_OBJECT(pipeline), "load-shedder");
+    if (controller->buffer_trace)
+        controller->trace_signal_id = g_unix_signal_add(SIGUSR1, write_trace, controller);
+
+    controller->config_reload = g_object_get_data(G_OBJECT(pipeline), "config-reload");
+    if (controller->config_reload) {
+        controller->reload_signal_id = g_unix_signal_add(SIGHUP, reload_config, controller);
+        guint watch_ms = settings ? settings->config_watch_ms : 0;
+        if (watch_ms)
+            controller->reload_timer_id = g_timeout_add(MAX(watch_ms, 100u), watch_config, controller);
+    }
+    if (controller->load_shedder && settings)
+        controller->load_timer_id = g_timeout_add(MAX(settings->load_interval_ms, 10u),
+                                                  load_tick, controller);
+
     return controller;
 }
 
@@ -66,6 +164,21 @@ void pipeline_controller_free(PipelineController *controller)
     if (controller->bus_watch_id)
         g_source_remove(controller->bus_watch_id);
 
+    if (controller->stats_timer_id)
+        g_source_remove(controller->stats_timer_id);
+
+    if (controller->load_timer_id)
+        g_source_remove(controller->load_timer_id);
+
+    if (controller->trace_signal_id)
+        g_source_remove(controller->trace_signal_id);
+
+    if (controller->reload_signal_id)
+        g_source_remove(controller->reload_signal_id);
+
+    if (controller->reload_timer_id)
+        g_source_remove(controller->reload_timer_id);
+
     if (controller->loop)
         g_main_loop_unref(controller->loop);
 
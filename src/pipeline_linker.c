@@ -2,6 +2,8 @@
 
 #include "pipeline_builder.h"
 #include "pipeline_linker.h"
+#include "source_bin.h"
+#include "gie_join.h"
 #include "logger.h"
 
 /* Caller owns the returned reference and must gst_object_unref() it; logs and returns NULL when the element is missing. */
@@ -13,78 +15,217 @@ static GstElement *get_elem(PipelineBuilder *builder, const gchar *name)
     return elem;
 }
 
+/* Element feeding succ from node: the tee queue towards it after a fan-out, else node itself. */
+static void output_name(const GieGraph *graph, guint node, guint succ, gchar *name, gsize size)
+{
+    guint succs[GIE_GRAPH_MAX_NODES];
+    guint n_succ = gie_graph_successors(graph, node, succs);
+    if (n_succ < 2) {
+        g_strlcpy(name, graph->nodes[node].name, size);
+        return;
+    }
+    guint k = 0;
+    while (k < n_succ && succs[k] != succ)
+        k++;
+    g_snprintf(name, size, GIE_GRAPH_QUEUE_FMT, graph->nodes[node].name, k);
+}
+
+/* Element taking node's input: its join after a fan-in, else node itself. */
+static void input_name(const GieGraph *graph, guint node, gchar *name, gsize size)
+{
+    guint preds[GIE_GRAPH_MAX_NODES];
+    if (gie_graph_predecessors(graph, node, preds) > 1)
+        g_snprintf(name, size, GIE_GRAPH_JOIN_FMT, graph->nodes[node].name);
+    else
+        g_strlcpy(name, graph->nodes[node].name, size);
+}
+
+static gboolean link_by_name(PipelineBuilder *builder, const gchar *from, const gchar *to)
+{
+    GstElement *src  = get_elem(builder, from);
+    GstElement *sink = get_elem(builder, to);
+    gboolean ok = src && sink && gst_element_link(src, sink);
+    if (src && sink && !ok)
+        log_error("pipeline_linker: failed to link %s → %s", from, to);
+    if (src)  gst_object_unref(src);
+    if (sink) gst_object_unref(sink);
+    return ok;
+}
+
+/* nvinfer's gie-unique-id of every node in mask; trackers add no component of their own. */
+static void branch_components(PipelineBuilder *builder, const GieGraph *graph,
+                              guint32 mask, MetaMergeComponents *out)
+{
+    out->n = 0;
+    for (guint i = 0; i < graph->n_nodes && out->n < META_MERGE_MAX_COMPONENTS; i++) {
+        if (!(mask & (1u << i)))
+            continue;
+        GstElement *elem = pipeline_builder_get_element(builder, graph->nodes[i].name);
+        if (!elem)
+            continue;
+        if (g_object_class_find_property(G_OBJECT_GET_CLASS(elem), "unique-id")) {
+            guint id = 0;
+            g_object_get(G_OBJECT(elem), "unique-id", &id, NULL);
+            out->ids[out->n++] = (gint)id;
+        }
+        gst_object_unref(elem);
+    }
+}
+
+/*
+ * Links each branch into join.  A branch's components are the nodes upstream
+ * of it but not of every branch (those were there at the fan-out); a node on
+ * several branches counts for the first one only, so it is merged once.
+ */
+static gboolean link_join(PipelineBuilder *builder, const GieGraph *graph,
+                          const gchar *join_name, const guint *preds, guint n_preds,
+                          gint node)
+{
+    GstElement *join = get_elem(builder, join_name);
+    if (!join)
+        return FALSE;
+
+    guint32 common = G_MAXUINT32;
+    for (guint j = 0; j < n_preds; j++)
+        common &= gie_graph_ancestors(graph, preds[j]);
+
+    gboolean ok = TRUE;
+    guint32 seen = common;
+    for (guint j = 0; ok && j < n_preds; j++) {
+        guint32 mask = gie_graph_ancestors(graph, preds[j]) & ~seen;
+        seen |= mask;
+
+        MetaMergeComponents components;
+        branch_components(builder, graph, mask, &components);
+        gchar name[64];
+        if (node < 0)
+            g_strlcpy(name, graph->nodes[preds[j]].name, sizeof(name));
+        else
+            output_name(graph, preds[j], (guint)node, name, sizeof(name));
+        GstElement *upstream = get_elem(builder, name);
+        ok = upstream && gie_join_link_branch(join, upstream, &components);
+        if (upstream)
+            gst_object_unref(upstream);
+    }
+    gst_object_unref(join);
+    return ok;
+}
+
+/* muxer → graph entry → ... → graph exit (or its join) → next. */
+static gboolean link_gie_graph(PipelineBuilder *builder, const gchar *muxer, const gchar *next)
+{
+    const GieGraph *graph = pipeline_builder_get_gie_graph(builder);
+    if (!graph || graph->n_nodes == 0) {
+        log_error("pipeline_linker: no gie graph");
+        return FALSE;
+    }
+
+    gchar from[64], to[64];
+    input_name(graph, 0, to, sizeof(to));
+    if (!link_by_name(builder, muxer, to))
+        return FALSE;
+
+    for (guint i = 0; i < graph->n_nodes; i++) {
+        const gchar *node = graph->nodes[i].name;
+        guint peers[GIE_GRAPH_MAX_NODES];
+
+        guint n_preds = gie_graph_predecessors(graph, i, peers);
+        if (n_preds > 1) {
+            input_name(graph, i, to, sizeof(to));
+            if (!link_join(builder, graph, to, peers, n_preds, (gint)i) ||
+                !link_by_name(builder, to, node))
+                return FALSE;
+        } else if (n_preds == 1) {
+            output_name(graph, peers[0], i, from, sizeof(from));
+            if (!link_by_name(builder, from, node))
+                return FALSE;
+        }
+
+        /* tee request pads are taken by gst_element_link. */
+        guint n_succ = gie_graph_successors(graph, i, peers);
+        if (n_succ > 1) {
+            g_snprintf(from, sizeof(from), GIE_GRAPH_TEE_FMT, node);
+            if (!link_by_name(builder, node, from))
+                return FALSE;
+            for (guint k = 0; k < n_succ; k++) {
+                g_snprintf(to, sizeof(to), GIE_GRAPH_QUEUE_FMT, node, k);
+                if (!link_by_name(builder, from, to))
+                    return FALSE;
+                /* The tee pushes one buffer to every branch; each GIE must write its own meta. */
+                GstElement *queue = get_elem(builder, to);
+                if (!queue)
+                    return FALSE;
+                gie_join_split_branch(queue);
+                gst_object_unref(queue);
+            }
+        }
+    }
+
+    guint exits[GIE_GRAPH_MAX_NODES];
+    guint n_exits = gie_graph_exits(graph, exits);
+    if (n_exits > 1 &&
+        !link_join(builder, graph, GIE_GRAPH_EXIT_JOIN, exits, n_exits, -1))
+        return FALSE;
+    return link_by_name(builder, gie_graph_exit_name(graph), next);
+}
+
 gboolean pipeline_linker_link(PipelineBuilder *builder)
 {
     gboolean ret = FALSE;
 
     /* Refs come from gst_bin_get_by_name; cleanup must unref every element. */
-    GstElement *source    = get_elem(builder, "file-source");
-    GstElement *h264parser= get_elem(builder, "h264-parser");
-    GstElement *decoder   = get_elem(builder, "nvv4l2-decoder");
     GstElement *streamux  = get_elem(builder, "muxer");
-    GstElement *pgie      = get_elem(builder, "primary-inference");
-    GstElement *nvtracker = get_elem(builder, "tracker");
-    GstElement *sgie1     = get_elem(builder, "secondary-inference-1");
-    GstElement *sgie2     = get_elem(builder, "secondary-inference-2");
-    GstElement *sgie3     = get_elem(builder, "secondary-inference-3");
-    GstElement *sgie4     = get_elem(builder, "secondary-inference-4");
     GstElement *nvvidconv = get_elem(builder, "nvvideo-converter");
     GstElement *nvosd     = get_elem(builder, "on-screen-display");
-    GstElement *tee       = get_elem(builder, "tee");
     GstElement *queue1    = get_elem(builder, "queue1");
-    GstElement *queue2    = get_elem(builder, "queue2");
-    GstElement *msgconv   = get_elem(builder, "nvmsg-converter");
     GstElement *msgbroker = get_elem(builder, "msg-broker");
+    /* Headless pipelines have no render branch: nvosd feeds queue1 directly. */
+    GstElement *tee       = pipeline_builder_get_element(builder, "tee");
+    GstElement *queue2    = NULL;
+    GstElement *sink      = NULL;
+    /* Absent when an in-process publisher takes the messages at the msg-broker sink. */
+    GstElement *msgconv   = pipeline_builder_get_element(builder, "nvmsg-converter");
+    /* Only multi-source pipelines tile the render branch. */
+    GstElement *tiler     = pipeline_builder_get_element(builder, "tiler");
 
-    /* Sink element name varies by GPU: nv3d-sink (integrated) or nvvideo-renderer (discrete). */
-    GstElement *sink = pipeline_builder_get_element(builder, "nv3d-sink");
-    if (!sink)
-        sink = pipeline_builder_get_element(builder, "nvvideo-renderer");
-    if (!sink)
-        log_error("pipeline_linker: neither 'nv3d-sink' nor 'nvvideo-renderer' found");
-
-    if (!source || !h264parser || !decoder || !streamux || !pgie || !nvtracker ||
-        !sgie1  || !sgie2     || !sgie3   || !sgie4    ||
-        !nvvidconv || !nvosd  || !tee     ||
-        !queue1 || !queue2    || !msgconv || !msgbroker || !sink)
-        goto cleanup;
+    if (tee) {
+        queue2 = get_elem(builder, "queue2");
+        /* Sink element name varies by GPU: nv3d-sink (integrated) or nvvideo-renderer (discrete); fake-sink without one. */
+        sink = pipeline_builder_get_element(builder, "nv3d-sink");
+        if (!sink)
+            sink = pipeline_builder_get_element(builder, "nvvideo-renderer");
+        if (!sink)
+            sink = pipeline_builder_get_element(builder, "fake-sink");
+        if (!sink)
+            log_error("pipeline_linker: none of 'nv3d-sink', 'nvvideo-renderer', 'fake-sink' found");
+        if (!queue2 || !sink)
+            goto cleanup;
+    }
 
-    if (!gst_element_link_many(source, h264parser, decoder, NULL)) {
-        log_error("pipeline_linker: failed to link source → h264parser → decoder");
+    if (!streamux || !nvvidconv || !nvosd || !queue1 || !msgbroker)
         goto cleanup;
-    }
 
-    /* streamux uses request pads; obtain sink_0 and link decoder to it. */
-    {
-        GstPad *sinkpad = gst_element_request_pad_simple(streamux, "sink_0");
-        if (!sinkpad) {
-            log_error("pipeline_linker: failed to request sink_0 from streamux");
+    /* Each source bin takes muxer pad sink_<i>, so frames from it carry source_id i. */
+    for (guint i = 0; i < pipeline_builder_get_n_sources(builder); i++) {
+        gchar name[32];
+        g_snprintf(name, sizeof(name), "source-bin-%u", i);
+        GstElement *source_bin = get_elem(builder, name);
+        gboolean linked = source_bin && source_bin_link(source_bin, streamux, i);
+        if (source_bin)
+            gst_object_unref(source_bin);
+        if (!linked)
             goto cleanup;
-        }
-        GstPad *srcpad = gst_element_get_static_pad(decoder, "src");
-        if (!srcpad) {
-            log_error("pipeline_linker: failed to get src pad from decoder");
-            gst_object_unref(sinkpad);
-            goto cleanup;
-        }
-        GstPadLinkReturn link_ret = gst_pad_link(srcpad, sinkpad);
-        gst_object_unref(srcpad);
-        gst_object_unref(sinkpad);
-        if (link_ret != GST_PAD_LINK_OK) {
-            log_error("pipeline_linker: failed to link decoder → streamux");
-            goto cleanup;
-        }
     }
 
-    if (!gst_element_link_many(streamux, pgie, nvtracker,
-                                sgie1, sgie2, sgie3, sgie4,
-                                nvvidconv, nvosd, tee, NULL)) {
-        log_error("pipeline_linker: failed to link inference chain");
+    if (!link_gie_graph(builder, "muxer", "nvvideo-converter"))
+        goto cleanup;
+    if (!gst_element_link_many(nvvidconv, nvosd, tee ? tee : queue1, NULL)) {
+        log_error("pipeline_linker: failed to link nvvidconv → nvosd → %s", tee ? "tee" : "queue1");
         goto cleanup;
     }
 
     /* tee uses request pads; obtain two src pads and link them to queue1 and queue2. */
-    {
+    if (tee) {
         GstPad *tee_msg_pad    = gst_element_request_pad_simple(tee, "src_%u");
         GstPad *tee_render_pad = gst_element_request_pad_simple(tee, "src_%u");
 
@@ -126,11 +267,13 @@ gboolean pipeline_linker_link(PipelineBuilder *builder)
         }
     }
 
-    if (!gst_element_link_many(queue1, msgconv, msgbroker, NULL)) {
-        log_error("pipeline_linker: failed to link queue1 → msgconv → msgbroker");
+    if (msgconv ? !gst_element_link_many(queue1, msgconv, msgbroker, NULL)
+                : !gst_element_link_many(queue1, msgbroker, NULL)) {
+        log_error("pipeline_linker: failed to link queue1 → msgbroker");
         goto cleanup;
     }
-    if (!gst_element_link_many(queue2, sink, NULL)) {
+    if (tee && (tiler ? !gst_element_link_many(queue2, tiler, sink, NULL)
+                      : !gst_element_link_many(queue2, sink, NULL))) {
         log_error("pipeline_linker: failed to link queue2 → sink");
         goto cleanup;
     }
@@ -139,16 +282,7 @@ gboolean pipeline_linker_link(PipelineBuilder *builder)
 
 cleanup:
     /* Release every element reference acquired above. */
-    if (source)     gst_object_unref(source);
-    if (h264parser) gst_object_unref(h264parser);
-    if (decoder)    gst_object_unref(decoder);
     if (streamux)   gst_object_unref(streamux);
-    if (pgie)       gst_object_unref(pgie);
-    if (nvtracker)  gst_object_unref(nvtracker);
-    if (sgie1)      gst_object_unref(sgie1);
-    if (sgie2)      gst_object_unref(sgie2);
-    if (sgie3)      gst_object_unref(sgie3);
-    if (sgie4)      gst_object_unref(sgie4);
     if (nvvidconv)  gst_object_unref(nvvidconv);
     if (nvosd)      gst_object_unref(nvosd);
     if (tee)        gst_object_unref(tee);
@@ -156,6 +290,7 @@ cleanup:
     if (queue2)     gst_object_unref(queue2);
     if (msgconv)    gst_object_unref(msgconv);
     if (msgbroker)  gst_object_unref(msgbroker);
+    if (tiler)      gst_object_unref(tiler);
     if (sink)       gst_object_unref(sink);
 
     return ret;
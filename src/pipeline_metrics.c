@@ -0,0 +1,80 @@
+#include "pipeline_metrics.h"
+#include "element_util.h"
+#include "metrics.h"
+#include "logger.h"
+
+typedef struct {
+    GstElement   *queue;
+    MetricsGauge *buffers;
+    MetricsGauge *bytes;
+} QueueLevel;
+
+static GstPadProbeReturn count_buffers(GstPad          *pad,
+                                       GstPadProbeInfo *info,
+                                       gpointer         user_data)
+{
+    (void)pad;
+    guint64 n = 1;
+    if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST)
+        n = gst_buffer_list_length(GST_PAD_PROBE_INFO_BUFFER_LIST(info));
+    metrics_counter_add((MetricsCounter *)user_data, n);
+    return GST_PAD_PROBE_OK;
+}
+
+static void collect_queue_level(gpointer user_data)
+{
+    QueueLevel *level = (QueueLevel *)user_data;
+    guint buffers = 0, bytes = 0;
+    element_util_queue_level(level->queue, "current-level-buffers", &buffers,
+                                           "current-level-bytes",   &bytes, NULL);
+    metrics_gauge_set(level->buffers, buffers);
+    metrics_gauge_set(level->bytes,   bytes);
+}
+
+static void queue_level_free(gpointer user_data)
+{
+    QueueLevel *level = (QueueLevel *)user_data;
+    gst_object_unref(level->queue);
+    g_free(level);
+}
+
+static void watch_element(MetricsServer *server, GstElement *element)
+{
+    const gchar *name = GST_ELEMENT_NAME(element);
+
+    GstPad *pad = gst_element_get_static_pad(element, "src");
+    if (!pad)
+        pad = gst_element_get_static_pad(element, "sink");
+    if (pad) {
+        MetricsCounter *counter = metrics_counter("traffic_guard_element_buffers_total",
+                                                  "Buffers out of each element (into it for sinks).",
+                                                  "element", name, TRUE);
+        if (counter)
+            gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+                              count_buffers, counter, NULL);
+        gst_object_unref(pad);
+    }
+
+    GstElementFactory *factory = gst_element_get_factory(element);
+    if (factory && g_strcmp0(GST_OBJECT_NAME(factory), "queue") == 0) {
+        QueueLevel *level = g_new0(QueueLevel, 1);
+        level->queue   = gst_object_ref(element);
+        level->buffers = metrics_gauge("traffic_guard_queue_level_buffers",
+                                       "Buffers currently held by each queue.", "queue", name);
+        level->bytes   = metrics_gauge("traffic_guard_queue_level_bytes",
+                                       "Bytes currently held by each queue.", "queue", name);
+        metrics_server_add_collector(server, collect_queue_level, level, queue_level_free);
+    }
+}
+
+void pipeline_metrics_watch(MetricsServer *server, GstElement *pipeline)
+{
+    if (!server || !GST_IS_BIN(pipeline))
+        return;
+
+    GPtrArray *elements = element_util_collect(gst_bin_iterate_recurse(GST_BIN(pipeline)));
+    for (guint i = 0; i < elements->len; i++)
+        watch_element(server, elements->pdata[i]);
+    log_info("pipeline_metrics: watching %u elements", elements->len);
+    g_ptr_array_free(elements, TRUE);
+}
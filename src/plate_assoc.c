@@ -0,0 +1,566 @@
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "plate_assoc.h"
+#include "frame_index.h"
+
+#define GRID_MIN_CARS   16       /* below this the kernel scans every car */
+#define GRID_MAX_CELLS  4096
+#define GRID_MIN_CELL   16.0f
+
+/* Structure-of-arrays boxes; right/bottom/area are precomputed once per frame. */
+typedef struct {
+    gfloat *left;
+    gfloat *top;
+    gfloat *right;
+    gfloat *bottom;
+    gfloat *area;
+} Boxes;
+
+typedef struct {
+    guint32 plate;
+    guint32 car;
+    gfloat  primary;
+    gfloat  secondary;
+} Pair;
+
+typedef struct {
+    NvDsObjectMeta *obj;
+    guint32         index;
+} CarRef;
+
+struct PlateAssoc {
+    PlateAssocOptions options;
+
+    /* Car-sized arrays share car_capacity. */
+    NvDsObjectMeta **cars;
+    Boxes            car_boxes;
+    Boxes            scratch;      /* grid candidates gathered for one plate */
+    gfloat          *cont;
+    gfloat          *iou;
+    guint32         *stamp;
+    guint32         *candidates;
+    gboolean        *taken;
+    CarRef          *by_pointer;   /* sorted, for parent lookups in one-to-one mode */
+    guint            n_cars;
+    guint            car_capacity;
+    guint32          query;
+
+    NvDsObjectMeta **plates;
+    NvDsObjectMeta **matches;
+    guint            n_plates;
+    guint            plate_capacity;
+
+    /* Uniform grid in CSR form: cell c holds cell_items[cell_start[c] .. cell_start[c + 1]). */
+    gboolean         use_grid;
+    gfloat           grid_x0;
+    gfloat           grid_y0;
+    gfloat           cell_inv;
+    guint            cols;
+    guint            rows;
+    guint32         *cell_start;
+    guint            cell_capacity;
+    guint32         *cell_items;
+    guint            item_capacity;
+
+    Pair            *pairs;
+    guint            n_pairs;
+    guint            pair_capacity;
+};
+
+static guint grow_to(guint capacity, guint needed)
+{
+    guint cap = capacity ? capacity : 64;
+    while (cap < needed)
+        cap *= 2;
+    return cap;
+}
+
+static void boxes_resize(Boxes *b, guint capacity)
+{
+    gsize bytes = (gsize)capacity * sizeof(gfloat);
+    b->left   = g_realloc(b->left,   bytes);
+    b->top    = g_realloc(b->top,    bytes);
+    b->right  = g_realloc(b->right,  bytes);
+    b->bottom = g_realloc(b->bottom, bytes);
+    b->area   = g_realloc(b->area,   bytes);
+}
+
+static void boxes_free(Boxes *b)
+{
+    g_free(b->left);
+    g_free(b->top);
+    g_free(b->right);
+    g_free(b->bottom);
+    g_free(b->area);
+}
+
+static void reserve_cars(PlateAssoc *assoc, guint needed)
+{
+    if (needed <= assoc->car_capacity)
+        return;
+    guint cap = grow_to(assoc->car_capacity, needed);
+    gsize scores = (gsize)cap * sizeof(gfloat);
+
+    assoc->cars       = g_renew(NvDsObjectMeta *, assoc->cars, cap);
+    boxes_resize(&assoc->car_boxes, cap);
+    boxes_resize(&assoc->scratch, cap);
+    assoc->cont       = g_realloc(assoc->cont, scores);
+    assoc->iou        = g_realloc(assoc->iou, scores);
+    assoc->candidates = g_renew(guint32, assoc->candidates, cap);
+    assoc->taken      = g_renew(gboolean, assoc->taken, cap);
+    assoc->by_pointer = g_renew(CarRef, assoc->by_pointer, cap);
+    /* New stamps must not collide with the running query counter. */
+    assoc->stamp      = g_renew(guint32, assoc->stamp, cap);
+    memset(assoc->stamp, 0, cap * sizeof(guint32));
+    assoc->query      = 0;
+    assoc->car_capacity = cap;
+}
+
+static void reserve_plates(PlateAssoc *assoc, guint needed)
+{
+    if (needed <= assoc->plate_capacity)
+        return;
+    guint cap = grow_to(assoc->plate_capacity, needed);
+    assoc->plates  = g_renew(NvDsObjectMeta *, assoc->plates, cap);
+    assoc->matches = g_renew(NvDsObjectMeta *, assoc->matches, cap);
+    assoc->plate_capacity = cap;
+}
+
+PlateAssoc *plate_assoc_new(const PlateAssocOptions *options)
+{
+    PlateAssoc *assoc = g_new0(PlateAssoc, 1);
+    assoc->options = *options;
+    reserve_cars(assoc, 64);
+    reserve_plates(assoc, 64);
+    return assoc;
+}
+
+void plate_assoc_free(PlateAssoc *assoc)
+{
+    if (!assoc)
+        return;
+    g_free(assoc->cars);
+    boxes_free(&assoc->car_boxes);
+    boxes_free(&assoc->scratch);
+    g_free(assoc->cont);
+    g_free(assoc->iou);
+    g_free(assoc->stamp);
+    g_free(assoc->candidates);
+    g_free(assoc->taken);
+    g_free(assoc->by_pointer);
+    g_free(assoc->plates);
+    g_free(assoc->matches);
+    g_free(assoc->cell_start);
+    g_free(assoc->cell_items);
+    g_free(assoc->pairs);
+    g_free(assoc);
+}
+
+/*
+ * Containment (intersection / plate area) and IoU of one plate against n
+ * boxes.  The arithmetic follows the original scalar iou() operation for
+ * operation, so IoU mode picks the same car.
+ */
+static void score_kernel(const Boxes *b, guint n, const NvOSD_RectParams *p,
+                         gfloat *cont, gfloat *iou)
+{
+    const gfloat pl = p->left, pt = p->top;
+    const gfloat pr = p->left + p->width, pb = p->top + p->height;
+    const gfloat pa = p->width * p->height;
+    guint i = 0;
+
+#if defined(__AVX__)
+    {
+        const __m256 vl = _mm256_set1_ps(pl), vt = _mm256_set1_ps(pt);
+        const __m256 vr = _mm256_set1_ps(pr), vb = _mm256_set1_ps(pb);
+        const __m256 va = _mm256_set1_ps(pa), zero = _mm256_setzero_ps();
+        const __m256 pa_ok = _mm256_cmp_ps(va, zero, _CMP_GT_OQ);
+        for (; i + 8 <= n; i += 8) {
+            __m256 iw = _mm256_max_ps(zero, _mm256_sub_ps(_mm256_min_ps(_mm256_loadu_ps(b->right + i), vr),
+                                                          _mm256_max_ps(_mm256_loadu_ps(b->left + i), vl)));
+            __m256 ih = _mm256_max_ps(zero, _mm256_sub_ps(_mm256_min_ps(_mm256_loadu_ps(b->bottom + i), vb),
+                                                          _mm256_max_ps(_mm256_loadu_ps(b->top + i), vt)));
+            __m256 inter = _mm256_mul_ps(iw, ih);
+            __m256 uni   = _mm256_sub_ps(_mm256_add_ps(_mm256_loadu_ps(b->area + i), va), inter);
+            __m256 ok    = _mm256_cmp_ps(uni, zero, _CMP_GT_OQ);
+            _mm256_storeu_ps(iou + i, _mm256_and_ps(ok, _mm256_div_ps(inter, uni)));
+            _mm256_storeu_ps(cont + i, _mm256_and_ps(pa_ok, _mm256_div_ps(inter, va)));
+        }
+    }
+#elif defined(__SSE2__)
+    {
+        const __m128 vl = _mm_set1_ps(pl), vt = _mm_set1_ps(pt);
+        const __m128 vr = _mm_set1_ps(pr), vb = _mm_set1_ps(pb);
+        const __m128 va = _mm_set1_ps(pa), zero = _mm_setzero_ps();
+        const __m128 pa_ok = _mm_cmpgt_ps(va, zero);
+        for (; i + 4 <= n; i += 4) {
+            __m128 iw = _mm_max_ps(zero, _mm_sub_ps(_mm_min_ps(_mm_loadu_ps(b->right + i), vr),
+                                                    _mm_max_ps(_mm_loadu_ps(b->left + i), vl)));
+            __m128 ih = _mm_max_ps(zero, _mm_sub_ps(_mm_min_ps(_mm_loadu_ps(b->bottom + i), vb),
+                                                    _mm_max_ps(_mm_loadu_ps(b->top + i), vt)));
+            __m128 inter = _mm_mul_ps(iw, ih);
+            __m128 uni   = _mm_sub_ps(_mm_add_ps(_mm_loadu_ps(b->area + i), va), inter);
+            __m128 ok    = _mm_cmpgt_ps(uni, zero);
+            _mm_storeu_ps(iou + i, _mm_and_ps(ok, _mm_div_ps(inter, uni)));
+            _mm_storeu_ps(cont + i, _mm_and_ps(pa_ok, _mm_div_ps(inter, va)));
+        }
+    }
+#endif
+
+    for (; i < n; i++) {
+        gfloat iw = MAX(0.0f, MIN(b->right[i], pr) - MAX(b->left[i], pl));
+        gfloat ih = MAX(0.0f, MIN(b->bottom[i], pb) - MAX(b->top[i], pt));
+        gfloat inter = iw * ih;
+        gfloat uni = b->area[i] + pa - inter;
+        iou[i]  = (uni > 0.0f) ? inter / uni : 0.0f;
+        cont[i] = (pa > 0.0f) ? inter / pa : 0.0f;
+    }
+}
+
+static void collect(PlateAssoc *assoc, NvDsFrameMeta *frame_meta)
+{
+    assoc->n_cars = 0;
+    assoc->n_plates = 0;
+
+    for (NvDsMetaList *l_obj = frame_meta->obj_meta_list; l_obj != NULL;
+         l_obj = l_obj->next) {
+        NvDsObjectMeta *obj = (NvDsObjectMeta *)(l_obj->data);
+        if (obj->unique_component_id == GIE_ID_VEHICLE_DETECTOR) {
+            reserve_cars(assoc, assoc->n_cars + 1);
+            guint i = assoc->n_cars++;
+            const NvOSD_RectParams *r = &obj->rect_params;
+            assoc->cars[i] = obj;
+            assoc->car_boxes.left[i]   = r->left;
+            assoc->car_boxes.top[i]    = r->top;
+            assoc->car_boxes.right[i]  = r->left + r->width;
+            assoc->car_boxes.bottom[i] = r->top + r->height;
+            assoc->car_boxes.area[i]   = r->width * r->height;
+        } else if (obj->unique_component_id == GIE_ID_PLATE_DETECTOR) {
+            reserve_plates(assoc, assoc->n_plates + 1);
+            assoc->plates[assoc->n_plates]  = obj;
+            assoc->matches[assoc->n_plates] = NULL;
+            assoc->n_plates++;
+        }
+    }
+}
+
+static guint cell_coord(gfloat v, gfloat origin, gfloat inv, guint limit)
+{
+    gfloat c = (v - origin) * inv;
+    if (!(c > 0.0f))
+        return 0;
+    if (c >= (gfloat)limit)
+        return limit - 1;
+    return (guint)c;
+}
+
+static void build_grid(PlateAssoc *assoc)
+{
+    const Boxes *b = &assoc->car_boxes;
+    guint n = assoc->n_cars;
+
+    assoc->use_grid = n > GRID_MIN_CARS;
+    if (!assoc->use_grid)
+        return;
+
+    gfloat x0 = b->left[0], y0 = b->top[0], x1 = b->right[0], y1 = b->bottom[0];
+    gdouble sum_w = 0.0, sum_h = 0.0;
+    for (guint i = 0; i < n; i++) {
+        x0 = MIN(x0, b->left[i]);
+        y0 = MIN(y0, b->top[i]);
+        x1 = MAX(x1, b->right[i]);
+        y1 = MAX(y1, b->bottom[i]);
+        sum_w += b->right[i] - b->left[i];
+        sum_h += b->bottom[i] - b->top[i];
+    }
+
+    /* Cells about one average car across keep each car in a handful of cells. */
+    gfloat cell = MAX((gfloat)MAX(sum_w, sum_h) / (gfloat)n, GRID_MIN_CELL);
+    guint cols, rows;
+    for (;;) {
+        cols = (guint)((x1 - x0) / cell) + 1;
+        rows = (guint)((y1 - y0) / cell) + 1;
+        if ((guint64)cols * rows <= GRID_MAX_CELLS)
+            break;
+        cell *= 2.0f;
+    }
+    assoc->grid_x0  = x0;
+    assoc->grid_y0  = y0;
+    assoc->cell_inv = 1.0f / cell;
+    assoc->cols     = cols;
+    assoc->rows     = rows;
+
+    guint n_cells = cols * rows;
+    if (n_cells + 1 > assoc->cell_capacity) {
+        assoc->cell_capacity = grow_to(assoc->cell_capacity, n_cells + 1);
+        assoc->cell_start = g_renew(guint32, assoc->cell_start, assoc->cell_capacity);
+    }
+    memset(assoc->cell_start, 0, (n_cells + 1) * sizeof(guint32));
+
+    guint total = 0;
+    for (guint i = 0; i < n; i++) {
+        guint c0 = cell_coord(b->left[i],   x0, assoc->cell_inv, cols);
+        guint c1 = cell_coord(b->right[i],  x0, assoc->cell_inv, cols);
+        guint r0 = cell_coord(b->top[i],    y0, assoc->cell_inv, rows);
+        guint r1 = cell_coord(b->bottom[i], y0, assoc->cell_inv, rows);
+        for (guint r = r0; r <= r1; r++)
+            for (guint c = c0; c <= c1; c++)
+                assoc->cell_start[r * cols + c + 1]++;
+        total += (r1 - r0 + 1) * (c1 - c0 + 1);
+    }
+    for (guint c = 0; c < n_cells; c++)
+        assoc->cell_start[c + 1] += assoc->cell_start[c];
+
+    if (total > assoc->item_capacity) {
+        assoc->item_capacity = grow_to(assoc->item_capacity, total);
+        assoc->cell_items = g_renew(guint32, assoc->cell_items, assoc->item_capacity);
+    }
+
+    /* Fill advances each start to the next cell's start; shift back afterwards. */
+    for (guint i = 0; i < n; i++) {
+        guint c0 = cell_coord(b->left[i],   x0, assoc->cell_inv, cols);
+        guint c1 = cell_coord(b->right[i],  x0, assoc->cell_inv, cols);
+        guint r0 = cell_coord(b->top[i],    y0, assoc->cell_inv, rows);
+        guint r1 = cell_coord(b->bottom[i], y0, assoc->cell_inv, rows);
+        for (guint r = r0; r <= r1; r++)
+            for (guint c = c0; c <= c1; c++)
+                assoc->cell_items[assoc->cell_start[r * cols + c]++] = i;
+    }
+    memmove(assoc->cell_start + 1, assoc->cell_start, n_cells * sizeof(guint32));
+    assoc->cell_start[0] = 0;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    guint32 x = *(const guint32 *)a, y = *(const guint32 *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Scores one plate against its candidate cars.  Returns the candidate count;
+ * candidate j is car index ids[j] (or j itself when ids is NULL).
+ */
+static guint score_plate(PlateAssoc *assoc, const NvOSD_RectParams *p, const guint32 **ids)
+{
+    if (!assoc->use_grid) {
+        score_kernel(&assoc->car_boxes, assoc->n_cars, p, assoc->cont, assoc->iou);
+        *ids = NULL;
+        return assoc->n_cars;
+    }
+
+    if (++assoc->query == 0) {
+        memset(assoc->stamp, 0, assoc->car_capacity * sizeof(guint32));
+        assoc->query = 1;
+    }
+
+    guint cols = assoc->cols;
+    guint c0 = cell_coord(p->left,             assoc->grid_x0, assoc->cell_inv, cols);
+    guint c1 = cell_coord(p->left + p->width,  assoc->grid_x0, assoc->cell_inv, cols);
+    guint r0 = cell_coord(p->top,              assoc->grid_y0, assoc->cell_inv, assoc->rows);
+    guint r1 = cell_coord(p->top + p->height,  assoc->grid_y0, assoc->cell_inv, assoc->rows);
+
+    guint k = 0;
+    for (guint r = r0; r <= r1; r++) {
+        for (guint c = c0; c <= c1; c++) {
+            guint cell = r * cols + c;
+            for (guint32 j = assoc->cell_start[cell]; j < assoc->cell_start[cell + 1]; j++) {
+                guint32 car = assoc->cell_items[j];
+                if (assoc->stamp[car] == assoc->query)
+                    continue;
+                assoc->stamp[car] = assoc->query;
+                assoc->candidates[k++] = car;
+            }
+        }
+    }
+    /* List order decides ties, as in the full scan. */
+    if (k > 1)
+        qsort(assoc->candidates, k, sizeof(guint32), cmp_u32);
+
+    const Boxes *src = &assoc->car_boxes;
+    Boxes *dst = &assoc->scratch;
+    for (guint j = 0; j < k; j++) {
+        guint32 car = assoc->candidates[j];
+        dst->left[j]   = src->left[car];
+        dst->top[j]    = src->top[car];
+        dst->right[j]  = src->right[car];
+        dst->bottom[j] = src->bottom[car];
+        dst->area[j]   = src->area[car];
+    }
+    score_kernel(dst, k, p, assoc->cont, assoc->iou);
+    *ids = assoc->candidates;
+    return k;
+}
+
+static inline void pair_scores(const PlateAssoc *assoc, guint j, gfloat *primary, gfloat *secondary)
+{
+    if (assoc->options.score == PLATE_ASSOC_SCORE_IOU) {
+        *primary   = assoc->iou[j];
+        *secondary = 0.0f;
+    } else {
+        *primary   = assoc->cont[j];
+        *secondary = assoc->iou[j];
+    }
+}
+
+static gboolean has_parent_car(const PlateAssoc *assoc, const NvDsObjectMeta *plate)
+{
+    return assoc->options.use_parent && plate->parent &&
+           plate->parent->unique_component_id == GIE_ID_VEHICLE_DETECTOR;
+}
+
+static void match_greedy(PlateAssoc *assoc)
+{
+    for (guint p = 0; p < assoc->n_plates; p++) {
+        NvDsObjectMeta *plate = assoc->plates[p];
+        if (has_parent_car(assoc, plate)) {
+            assoc->matches[p] = plate->parent;
+            continue;
+        }
+
+        const guint32 *ids;
+        guint k = score_plate(assoc, &plate->rect_params, &ids);
+        gint best = -1;
+        gfloat best_p = 0.0f, best_s = 0.0f;
+        for (guint j = 0; j < k; j++) {
+            gfloat primary, secondary;
+            pair_scores(assoc, j, &primary, &secondary);
+            if (!(primary > assoc->options.min_score))
+                continue;
+            if (best < 0 || primary > best_p || (primary == best_p && secondary > best_s)) {
+                best   = (gint)j;
+                best_p = primary;
+                best_s = secondary;
+            }
+        }
+        if (best >= 0)
+            assoc->matches[p] = assoc->cars[ids ? ids[best] : (guint32)best];
+    }
+}
+
+static void push_pair(PlateAssoc *assoc, guint32 plate, guint32 car, gfloat primary, gfloat secondary)
+{
+    if (assoc->n_pairs == assoc->pair_capacity) {
+        assoc->pair_capacity = grow_to(assoc->pair_capacity, assoc->n_pairs + 1);
+        assoc->pairs = g_renew(Pair, assoc->pairs, assoc->pair_capacity);
+    }
+    Pair *pair = &assoc->pairs[assoc->n_pairs++];
+    pair->plate     = plate;
+    pair->car       = car;
+    pair->primary   = primary;
+    pair->secondary = secondary;
+}
+
+static int cmp_pair(const void *a, const void *b)
+{
+    const Pair *x = a, *y = b;
+    if (x->primary != y->primary)
+        return x->primary > y->primary ? -1 : 1;
+    if (x->secondary != y->secondary)
+        return x->secondary > y->secondary ? -1 : 1;
+    if (x->plate != y->plate)
+        return x->plate < y->plate ? -1 : 1;
+    return (x->car > y->car) - (x->car < y->car);
+}
+
+static int cmp_car_ref(const void *a, const void *b)
+{
+    const CarRef *x = a, *y = b;
+    return (x->obj > y->obj) - (x->obj < y->obj);
+}
+
+static gint car_index(const PlateAssoc *assoc, const NvDsObjectMeta *car)
+{
+    CarRef key = { (NvDsObjectMeta *)car, 0 };
+    const CarRef *hit = bsearch(&key, assoc->by_pointer, assoc->n_cars, sizeof(CarRef), cmp_car_ref);
+    return hit ? (gint)hit->index : -1;
+}
+
+/* Every scored pair above min_score, best first; parent links outrank any score. */
+static void match_one_to_one(PlateAssoc *assoc)
+{
+    assoc->n_pairs = 0;
+    gboolean sorted_refs = FALSE;
+
+    for (guint p = 0; p < assoc->n_plates; p++) {
+        NvDsObjectMeta *plate = assoc->plates[p];
+        if (has_parent_car(assoc, plate)) {
+            if (!sorted_refs) {
+                for (guint i = 0; i < assoc->n_cars; i++) {
+                    assoc->by_pointer[i].obj   = assoc->cars[i];
+                    assoc->by_pointer[i].index = i;
+                }
+                qsort(assoc->by_pointer, assoc->n_cars, sizeof(CarRef), cmp_car_ref);
+                sorted_refs = TRUE;
+            }
+            gint car = car_index(assoc, plate->parent);
+            if (car >= 0) {
+                push_pair(assoc, p, (guint32)car, G_MAXFLOAT, G_MAXFLOAT);
+                continue;
+            }
+        }
+
+        const guint32 *ids;
+        guint k = score_plate(assoc, &plate->rect_params, &ids);
+        for (guint j = 0; j < k; j++) {
+            gfloat primary, secondary;
+            pair_scores(assoc, j, &primary, &secondary);
+            if (primary > assoc->options.min_score)
+                push_pair(assoc, p, ids ? ids[j] : j, primary, secondary);
+        }
+    }
+
+    qsort(assoc->pairs, assoc->n_pairs, sizeof(Pair), cmp_pair);
+    memset(assoc->taken, 0, assoc->n_cars * sizeof(gboolean));
+    for (guint i = 0; i < assoc->n_pairs; i++) {
+        const Pair *pair = &assoc->pairs[i];
+        if (assoc->matches[pair->plate] || assoc->taken[pair->car])
+            continue;
+        assoc->matches[pair->plate] = assoc->cars[pair->car];
+        assoc->taken[pair->car] = TRUE;
+    }
+}
+
+guint plate_assoc_match_frame(PlateAssoc *assoc, NvDsFrameMeta *frame_meta)
+{
+    collect(assoc, frame_meta);
+    if (assoc->n_plates == 0 || assoc->n_cars == 0)
+        return assoc->n_plates;
+
+    build_grid(assoc);
+    if (assoc->options.one_to_one)
+        match_one_to_one(assoc);
+    else
+        match_greedy(assoc);
+    return assoc->n_plates;
+}
+
+NvDsObjectMeta *plate_assoc_plate(const PlateAssoc *assoc, guint i)
+{
+    return i < assoc->n_plates ? assoc->plates[i] : NULL;
+}
+
+NvDsObjectMeta *plate_assoc_car(const PlateAssoc *assoc, guint i)
+{
+    return i < assoc->n_plates ? assoc->matches[i] : NULL;
+}
+
+guint plate_assoc_apply(PlateAssoc *assoc, NvDsFrameMeta *frame_meta)
+{
+    guint n = plate_assoc_match_frame(assoc, frame_meta);
+    guint matched = 0;
+    for (guint i = 0; i < n; i++) {
+        NvDsObjectMeta *car = assoc->matches[i];
+        if (!car)
+            continue;
+        assoc->plates[i]->object_id = car->object_id;
+        matched++;
+    }
+    return matched;
+}
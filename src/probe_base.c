@@ -1,4 +1,5 @@
 #include "probe_base.h"
+#include "probe_stats.h"
 #include "logger.h"
 
 gboolean probe_base_add_buffer_probe(
@@ -13,7 +14,33 @@ gboolean probe_base_add_buffer_probe(
                   pad_name, GST_ELEMENT_NAME(element));
         return FALSE;
     }
+#ifdef ENABLE_PROBE_STATS
+    gchar *name = g_strdup_printf("%s:%s", GST_ELEMENT_NAME(element), pad_name);
+    ProbeStatsSlot *slot = probe_stats_register(name, callback, user_data);
+    g_free(name);
+    if (slot) {
+        callback  = probe_stats_probe;
+        user_data = slot;
+    }
+#endif
     gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, callback, user_data, NULL);
     gst_object_unref(pad);
     return TRUE;
 }
+
+gboolean probe_base_add_event_probe(
+    GstElement *element,
+    const char *pad_name,
+    GstPadProbeReturn (*callback)(GstPad *, GstPadProbeInfo *, gpointer),
+    gpointer user_data)
+{
+    GstPad *pad = gst_element_get_static_pad(element, pad_name);
+    if (!pad) {
+        log_error("probe_base: could not get pad '%s' from element '%s'",
+                  pad_name, GST_ELEMENT_NAME(element));
+        return FALSE;
+    }
+    gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM, callback, user_data, NULL);
+    gst_object_unref(pad);
+    return TRUE;
+}
@@ -0,0 +1,271 @@
+#include "probe_stats.h"
+#include "logger.h"
+
+#ifdef ENABLE_PROBE_STATS
+
+#include <stdatomic.h>
+#include <time.h>
+
+#define SUB_COUNT (1u << PROBE_STATS_SUB_BITS)
+#define MAX_TRACKED_NS ((G_GUINT64_CONSTANT(1) << 41) - 1)
+
+struct ProbeStatsSlot {
+    GstPadProbeCallback   callback;
+    gpointer              user_data;
+    gchar                 name[PROBE_STATS_NAME_MAX];
+    atomic_uint_least64_t drops;
+    atomic_uint_least64_t total_ns;
+    atomic_uint_least64_t max_ns;
+    atomic_uint_least64_t buckets[PROBE_STATS_BUCKETS];
+};
+
+static ProbeStatsSlot slots[PROBE_STATS_MAX_PROBES];
+static atomic_uint    n_slots;
+static GMutex         register_lock;
+
+/*
+ * Two clock_gettime() calls cost more than most probes they would time, so
+ * the hot path reads the cycle counter and scales ticks to ns with a 32.32
+ * fixed-point factor calibrated once, at the first registration.
+ */
+static guint64 tick_mult = G_GUINT64_CONSTANT(1) << 32;   /* ns per tick << 32 */
+
+static inline guint64 clock_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (guint64)ts.tv_sec * 1000000000ull + (guint64)ts.tv_nsec;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+
+static inline guint64 now_ticks(void)
+{
+    return __rdtsc();
+}
+
+static void calibrate_ticks(void)
+{
+    guint64 t0 = clock_ns(), c0 = now_ticks(), t1;
+    do
+        t1 = clock_ns();
+    while (t1 - t0 < 2000000);
+    guint64 c1 = now_ticks();
+    if (c1 > c0)
+        tick_mult = (guint64)(((gdouble)(t1 - t0) / (gdouble)(c1 - c0)) * 4294967296.0);
+}
+#elif defined(__aarch64__)
+static inline guint64 now_ticks(void)
+{
+    guint64 v;
+    __asm__ __volatile__("isb; mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+}
+
+static void calibrate_ticks(void)
+{
+    guint64 freq;
+    __asm__ __volatile__("mrs %0, cntfrq_el0" : "=r"(freq));
+    if (freq)
+        tick_mult = (1000000000ull << 32) / freq;
+}
+#else
+static inline guint64 now_ticks(void)
+{
+    return clock_ns();
+}
+
+static void calibrate_ticks(void)
+{
+}
+#endif
+
+static inline guint64 ticks_to_ns(guint64 ticks)
+{
+    /* The product overflows only past ~2^32 ticks, i.e. a probe running for seconds. */
+    if (G_UNLIKELY(ticks >> 32))
+        return (guint64)((gdouble)ticks * ((gdouble)tick_mult / 4294967296.0));
+    return (ticks * tick_mult) >> 32;
+}
+
+static inline guint bucket_of(guint64 ns)
+{
+    if (ns < SUB_COUNT)
+        return (guint)ns;
+    if (ns > MAX_TRACKED_NS)
+        ns = MAX_TRACKED_NS;
+    guint msb   = 63 - (guint)__builtin_clzll(ns);
+    guint shift = msb - PROBE_STATS_SUB_BITS;
+    return ((shift + 1) << PROBE_STATS_SUB_BITS) + (guint)((ns >> shift) & (SUB_COUNT - 1));
+}
+
+guint64 probe_stats_bucket_upper_ns(guint bucket)
+{
+    if (bucket < SUB_COUNT)
+        return bucket;
+    guint shift = (bucket >> PROBE_STATS_SUB_BITS) - 1;
+    guint64 base = (guint64)(SUB_COUNT + (bucket & (SUB_COUNT - 1))) << shift;
+    return base + (G_GUINT64_CONSTANT(1) << shift) - 1;
+}
+
+/*
+ * A pad's buffers flow under its stream lock, so each slot has one writer at a
+ * time: a relaxed load and store avoids the locked read-modify-write, and
+ * readers on other threads still never see a torn value.
+ */
+static inline void bump(atomic_uint_least64_t *counter, guint64 v)
+{
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + v,
+                          memory_order_relaxed);
+}
+
+ProbeStatsSlot *probe_stats_register(const gchar        *name,
+                                     GstPadProbeCallback callback,
+                                     gpointer            user_data)
+{
+    ProbeStatsSlot *slot = NULL;
+    g_mutex_lock(&register_lock);
+    guint n = atomic_load_explicit(&n_slots, memory_order_relaxed);
+    if (n == 0)
+        calibrate_ticks();
+    if (n < PROBE_STATS_MAX_PROBES) {
+        slot = &slots[n];
+        slot->callback  = callback;
+        slot->user_data = user_data;
+        g_strlcpy(slot->name, name, sizeof(slot->name));
+        /* Publish after the slot is filled, for snapshots taken on other threads. */
+        atomic_store_explicit(&n_slots, n + 1, memory_order_release);
+    }
+    g_mutex_unlock(&register_lock);
+    if (!slot)
+        log_warning("probe_stats: no slot left for '%s', it runs untimed", name);
+    return slot;
+}
+
+GstPadProbeReturn probe_stats_probe(GstPad          *pad,
+                                    GstPadProbeInfo *info,
+                                    gpointer         user_data)
+{
+    ProbeStatsSlot *slot = (ProbeStatsSlot *)user_data;
+
+    guint64 t0 = now_ticks();
+    GstPadProbeReturn ret = slot->callback(pad, info, slot->user_data);
+    guint64 elapsed = ticks_to_ns(now_ticks() - t0);
+
+    bump(&slot->buckets[bucket_of(elapsed)], 1);
+    bump(&slot->total_ns, elapsed);
+    if (ret == GST_PAD_PROBE_DROP)
+        bump(&slot->drops, 1);
+    if (G_UNLIKELY(elapsed > atomic_load_explicit(&slot->max_ns, memory_order_relaxed)))
+        atomic_store_explicit(&slot->max_ns, elapsed, memory_order_relaxed);
+    return ret;
+}
+
+gboolean probe_stats_histogram(guint i, guint64 counts[PROBE_STATS_BUCKETS])
+{
+    if (i >= atomic_load_explicit(&n_slots, memory_order_acquire))
+        return FALSE;
+    for (guint b = 0; b < PROBE_STATS_BUCKETS; b++)
+        counts[b] = atomic_load_explicit(&slots[i].buckets[b], memory_order_relaxed);
+    return TRUE;
+}
+
+static guint64 percentile(const guint64 *counts, guint64 calls, guint pct)
+{
+    guint64 rank = (calls * pct + 99) / 100;
+    guint64 seen = 0;
+    for (guint b = 0; b < PROBE_STATS_BUCKETS; b++) {
+        seen += counts[b];
+        if (seen >= rank && seen > 0)
+            return probe_stats_bucket_upper_ns(b);
+    }
+    return 0;
+}
+
+guint probe_stats_snapshot(ProbeStatsSnapshot *out, guint max)
+{
+    guint n = MIN(atomic_load_explicit(&n_slots, memory_order_acquire), max);
+    guint64 counts[PROBE_STATS_BUCKETS];
+
+    for (guint i = 0; i < n; i++) {
+        ProbeStatsSlot *slot = &slots[i];
+        ProbeStatsSnapshot *s = &out[i];
+        probe_stats_histogram(i, counts);
+
+        g_strlcpy(s->name, slot->name, sizeof(s->name));
+        s->calls = 0;
+        for (guint b = 0; b < PROBE_STATS_BUCKETS; b++)
+            s->calls += counts[b];
+        s->drops    = atomic_load_explicit(&slot->drops, memory_order_relaxed);
+        s->total_ns = atomic_load_explicit(&slot->total_ns, memory_order_relaxed);
+        s->max_ns   = atomic_load_explicit(&slot->max_ns, memory_order_relaxed);
+        s->p50_ns   = percentile(counts, s->calls, 50);
+        s->p90_ns   = percentile(counts, s->calls, 90);
+        s->p99_ns   = percentile(counts, s->calls, 99);
+    }
+    return n;
+}
+
+void probe_stats_log(void)
+{
+    ProbeStatsSnapshot snaps[PROBE_STATS_MAX_PROBES];
+    guint n = probe_stats_snapshot(snaps, PROBE_STATS_MAX_PROBES);
+    for (guint i = 0; i < n; i++) {
+        const ProbeStatsSnapshot *s = &snaps[i];
+        log_info("probe_stats: %-40s calls %" G_GUINT64_FORMAT " drops %" G_GUINT64_FORMAT
+                 " mean %.2f us p50 %.2f p90 %.2f p99 %.2f max %.2f",
+                 s->name, s->calls, s->drops,
+                 s->calls ? (gdouble)s->total_ns / s->calls / 1000.0 : 0.0,
+                 s->p50_ns / 1000.0, s->p90_ns / 1000.0, s->p99_ns / 1000.0,
+                 s->max_ns / 1000.0);
+    }
+}
+
+#else
+
+ProbeStatsSlot *probe_stats_register(const gchar        *name,
+                                     GstPadProbeCallback callback,
+                                     gpointer            user_data)
+{
+    (void)name;
+    (void)callback;
+    (void)user_data;
+    return NULL;
+}
+
+GstPadProbeReturn probe_stats_probe(GstPad          *pad,
+                                    GstPadProbeInfo *info,
+                                    gpointer         user_data)
+{
+    (void)pad;
+    (void)info;
+    (void)user_data;
+    return GST_PAD_PROBE_OK;
+}
+
+guint probe_stats_snapshot(ProbeStatsSnapshot *out, guint max)
+{
+    (void)out;
+    (void)max;
+    return 0;
+}
+
+gboolean probe_stats_histogram(guint i, guint64 counts[PROBE_STATS_BUCKETS])
+{
+    (void)i;
+    (void)counts;
+    return FALSE;
+}
+
+guint64 probe_stats_bucket_upper_ns(guint bucket)
+{
+    (void)bucket;
+    return 0;
+}
+
+void probe_stats_log(void)
+{
+}
+
+#endif
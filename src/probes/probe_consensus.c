@@ -0,0 +1,45 @@
+#include "gstnvdsmeta.h"
+
+#include "probes/probe_consensus.h"
+#include "track_consensus.h"
+
+void probe_consensus_vote(const FrameIndex *index, gpointer user_data)
+{
+    TrackConsensus *tc = (TrackConsensus *)user_data;
+    if (tc)
+        track_consensus_vote_frame(tc, index);
+}
+
+GstPadProbeReturn probe_consensus_gate(GstPad *pad,
+                                       GstPadProbeInfo *info,
+                                       gpointer user_data)
+{
+    (void)pad;
+    TrackConsensus *tc = (TrackConsensus *)user_data;
+    GstBuffer *buf = (GstBuffer *)info->data;
+    NvDsBatchMeta *batch_meta = gst_buffer_get_nvds_batch_meta(buf);
+    if (!tc || !batch_meta)
+        return GST_PAD_PROBE_OK;
+
+    for (NvDsMetaList *l_frame = batch_meta->frame_meta_list; l_frame != NULL;
+         l_frame = l_frame->next)
+        track_consensus_gate_frame(tc, (NvDsFrameMeta *)(l_frame->data));
+    return GST_PAD_PROBE_OK;
+}
+
+GstPadProbeReturn probe_consensus_restore(GstPad *pad,
+                                          GstPadProbeInfo *info,
+                                          gpointer user_data)
+{
+    (void)pad;
+    (void)user_data;
+    GstBuffer *buf = (GstBuffer *)info->data;
+    NvDsBatchMeta *batch_meta = gst_buffer_get_nvds_batch_meta(buf);
+    if (!batch_meta)
+        return GST_PAD_PROBE_OK;
+
+    for (NvDsMetaList *l_frame = batch_meta->frame_meta_list; l_frame != NULL;
+         l_frame = l_frame->next)
+        track_consensus_restore_frame((NvDsFrameMeta *)(l_frame->data));
+    return GST_PAD_PROBE_OK;
+}
@@ -1,129 +1,62 @@
-#include <stdio.h>
 #include <glib.h>
 
-#include "gstnvdsmeta.h"
+#include "nvdsmeta.h"
 
 #include "probes/probe_detections.h"
-#include "config.h"
-#include "logger.h"
+#include "detection_writer.h"
 
 #define PGIE_CLASS_ID_VEHICLE 0
-#define DETECTION_OUTPUT_FILENAME_PATTERN "frame_%06d.txt"
 
-static gint detection_frame_counter = 0;
-
-/* Caller must g_free() the returned string. */
-static gchar *get_plate_text_from_plate_obj(NvDsObjectMeta *plate_obj)
+static void add_record(DetectionFrame *frame, DetectionKind kind,
+                       NvDsObjectMeta *obj, const gchar *text)
 {
-    NvDsClassifierMetaList *l_class = NULL;
-    NvDsLabelInfoList *l_label = NULL;
-
-    for (l_class = plate_obj->classifier_meta_list; l_class != NULL;
-         l_class = l_class->next) {
-        NvDsClassifierMeta *cm = (NvDsClassifierMeta *)(l_class->data);
-        if (cm->unique_component_id != 5)
-            continue;
-        for (l_label = cm->label_info_list; l_label != NULL;
-             l_label = l_label->next) {
-            NvDsLabelInfo *li = (NvDsLabelInfo *)(l_label->data);
-            if (li->result_label)
-                return g_strdup(li->result_label);
-            return g_strdup("-");
-        }
-        return g_strdup("-");
+    if (frame->n_records >= DETECTION_MAX_RECORDS_PER_FRAME) {
+        frame->n_cut++;
+        return;
     }
-    return NULL;
+
+    DetectionRecord *rec = &frame->records[frame->n_records++];
+    rec->left         = obj->rect_params.left;
+    rec->top          = obj->rect_params.top;
+    rec->width        = obj->rect_params.width;
+    rec->height       = obj->rect_params.height;
+    rec->object_id    = obj->object_id;
+    rec->component_id = (guint16)obj->unique_component_id;
+    rec->kind         = (guint8)kind;
+    g_strlcpy(rec->text, (text && text[0]) ? text : "-", sizeof(rec->text));
 }
 
-/* Caller must g_free() the returned string; may return NULL when no plate is found. */
-static gchar *get_plate_text_for_car(NvDsFrameMeta *frame_meta,
-                                     NvDsObjectMeta *car_obj)
+void probe_write_detections(const FrameIndex *index, gpointer user_data)
 {
-    NvDsMetaList *l_obj = NULL;
-    for (l_obj = frame_meta->obj_meta_list; l_obj != NULL;
-         l_obj = l_obj->next) {
-        NvDsObjectMeta *obj = (NvDsObjectMeta *)(l_obj->data);
-        if (obj->unique_component_id != 4)
+    DetectionWriter *writer = (DetectionWriter *)user_data;
+    if (!writer)
+        return;
+
+    NvDsFrameMeta *frame_meta = frame_index_frame_meta(index);
+    DetectionFrame *frame = detection_writer_begin_frame(writer);
+    if (!frame)
+        return;
+    /* The muxer numbers each source's frames from 0; dumps have always started at 1. */
+    frame->frame_num = (gint64)frame_meta->frame_num + 1;
+    frame->source_id = frame_meta->source_id;
+
+    /* Tracker matching gave each plate its car's object_id, so the car's plate is one lookup. */
+    const FrameIndexBucket *cars = frame_index_bucket(index, GIE_ID_VEHICLE_DETECTOR);
+    for (guint i = 0; i < cars->n; i++) {
+        NvDsObjectMeta *obj = cars->items[i].obj;
+        if (obj->class_id != PGIE_CLASS_ID_VEHICLE)
             continue;
-        if (obj->object_id != car_obj->object_id)
-            continue;
-        gchar *text = get_plate_text_from_plate_obj(obj);
-        return text ? text : g_strdup("-");
+        const FrameIndexObject *plate = frame_index_find_plate(index, obj->object_id);
+        add_record(frame, DETECTION_KIND_CAR, obj, plate ? plate->plate : NULL);
     }
-    return NULL;
-}
-
-GstPadProbeReturn probe_write_detections(GstPad *pad,
-                                         GstPadProbeInfo *info,
-                                         gpointer user_data)
-{
-    (void)pad;
-    (void)user_data;
 
-    const gchar *output_dir = config_get_detection_output_dir();
-    if (!output_dir || !output_dir[0])
-        return GST_PAD_PROBE_OK;
-
-    GstBuffer *buf = (GstBuffer *)info->data;
-    NvDsBatchMeta *batch_meta = gst_buffer_get_nvds_batch_meta(buf);
-    NvDsMetaList *l_frame = NULL;
-    NvDsMetaList *l_obj = NULL;
-
-    for (l_frame = batch_meta->frame_meta_list; l_frame != NULL;
-         l_frame = l_frame->next) {
-        NvDsFrameMeta *frame_meta = (NvDsFrameMeta *)(l_frame->data);
-        detection_frame_counter++;
-
-        gchar *filename = g_strdup_printf(DETECTION_OUTPUT_FILENAME_PATTERN,
-                                          detection_frame_counter);
-        gchar *path = g_build_filename(output_dir, filename, NULL);
-        g_free(filename);
-
-        FILE *fp = fopen(path, "w");
-        g_free(path);
-        if (!fp)
+    const FrameIndexBucket *plates = frame_index_bucket(index, GIE_ID_PLATE_DETECTOR);
+    for (guint i = 0; i < plates->n; i++) {
+        NvDsObjectMeta *obj = plates->items[i].obj;
+        if (obj->class_id != PGIE_CLASS_ID_VEHICLE)
             continue;
-
-        for (l_obj = frame_meta->obj_meta_list; l_obj != NULL;
-             l_obj = l_obj->next) {
-            NvDsObjectMeta *obj = (NvDsObjectMeta *)(l_obj->data);
-            if (obj->class_id != PGIE_CLASS_ID_VEHICLE)
-                continue;
-            if (obj->unique_component_id != 1)
-                continue;
-            gchar *plate_text = get_plate_text_for_car(frame_meta, obj);
-            if (!plate_text)
-                plate_text = g_strdup("-");
-            fprintf(fp, "car %.6g %.6g %.6g %.6g %s\n",
-                    (double)obj->rect_params.left,
-                    (double)obj->rect_params.top,
-                    (double)obj->rect_params.width,
-                    (double)obj->rect_params.height,
-                    plate_text);
-            g_free(plate_text);
-        }
-
-        for (l_obj = frame_meta->obj_meta_list; l_obj != NULL;
-             l_obj = l_obj->next) {
-            NvDsObjectMeta *obj = (NvDsObjectMeta *)(l_obj->data);
-            if (obj->class_id != PGIE_CLASS_ID_VEHICLE)
-                continue;
-            if (obj->unique_component_id != 4)
-                continue;
-            gchar *plate_text = get_plate_text_from_plate_obj(obj);
-            if (!plate_text)
-                plate_text = g_strdup("-");
-            fprintf(fp, "plate %.6g %.6g %.6g %.6g %s\n",
-                    (double)obj->rect_params.left,
-                    (double)obj->rect_params.top,
-                    (double)obj->rect_params.width,
-                    (double)obj->rect_params.height,
-                    plate_text);
-            g_free(plate_text);
-        }
-
-        fclose(fp);
+        add_record(frame, DETECTION_KIND_PLATE, obj, plates->items[i].plate);
     }
 
-    return GST_PAD_PROBE_OK;
+    detection_writer_commit_frame(writer);
 }
@@ -1,13 +1,13 @@
 #include "gstnvdsmeta.h"
 
 #include "probes/probe_drop.h"
+#include "metrics.h"
 
 GstPadProbeReturn probe_drop_frame(GstPad *pad,
                                    GstPadProbeInfo *info,
                                    gpointer user_data)
 {
     (void)pad;
-    (void)user_data;
 
     GstBuffer *buf = (GstBuffer *)info->data;
     NvDsBatchMeta *batch_meta = gst_buffer_get_nvds_batch_meta(buf);
@@ -16,8 +16,9 @@ GstPadProbeReturn probe_drop_frame(GstPad *pad,
     for (l_frame = batch_meta->frame_meta_list; l_frame != NULL;
          l_frame = l_frame->next) {
         NvDsFrameMeta *frame_meta = (NvDsFrameMeta *)(l_frame->data);
-        if (frame_meta->frame_user_meta_list == NULL)
-            return GST_PAD_PROBE_DROP;
+        if (frame_meta->frame_user_meta_list != NULL)
+            return GST_PAD_PROBE_OK;
     }
-    return GST_PAD_PROBE_OK;
+    metrics_counter_add((MetricsCounter *)user_data, batch_meta->num_frames_in_batch);
+    return GST_PAD_PROBE_DROP;
 }
@@ -0,0 +1,57 @@
+#include "gstnvdsmeta.h"
+
+#include "probes/probe_load_shed.h"
+#include "load_shedder.h"
+
+GstPadProbeReturn probe_load_shed_hide(GstPad *pad,
+                                       GstPadProbeInfo *info,
+                                       gpointer user_data)
+{
+    (void)pad;
+    const LoadShedGate *gate = (const LoadShedGate *)user_data;
+    NvDsBatchMeta *batch_meta = gst_buffer_get_nvds_batch_meta((GstBuffer *)info->data);
+    if (!gate || !batch_meta)
+        return GST_PAD_PROBE_OK;
+
+    for (NvDsMetaList *l_frame = batch_meta->frame_meta_list; l_frame != NULL;
+         l_frame = l_frame->next)
+        load_shedder_hide_frame(gate, (NvDsFrameMeta *)(l_frame->data));
+    return GST_PAD_PROBE_OK;
+}
+
+GstPadProbeReturn probe_load_shed_restore(GstPad *pad,
+                                          GstPadProbeInfo *info,
+                                          gpointer user_data)
+{
+    (void)pad;
+    const LoadShedGate *gate = (const LoadShedGate *)user_data;
+    NvDsBatchMeta *batch_meta = gst_buffer_get_nvds_batch_meta((GstBuffer *)info->data);
+    if (!gate || !batch_meta)
+        return GST_PAD_PROBE_OK;
+
+    for (NvDsMetaList *l_frame = batch_meta->frame_meta_list; l_frame != NULL;
+         l_frame = l_frame->next)
+        load_shedder_restore_frame(gate, (NvDsFrameMeta *)(l_frame->data));
+    return GST_PAD_PROBE_OK;
+}
+
+GstPadProbeReturn probe_load_shed_latency(GstPad *pad,
+                                          GstPadProbeInfo *info,
+                                          gpointer user_data)
+{
+    GstBuffer *buf = (GstBuffer *)info->data;
+    GstElement *element = GST_ELEMENT(GST_PAD_PARENT(pad));
+    if (!element || !GST_BUFFER_PTS_IS_VALID(buf))
+        return GST_PAD_PROBE_OK;
+
+    GstClock *clock = gst_element_get_clock(element);
+    if (!clock)
+        return GST_PAD_PROBE_OK;
+    GstClockTime running = gst_clock_get_time(clock) - gst_element_get_base_time(element);
+    gst_object_unref(clock);
+
+    /* A sink running ahead of the clock has no backlog. */
+    gint64 latency = GST_CLOCK_DIFF(GST_BUFFER_PTS(buf), running);
+    load_shedder_note_latency((LoadShedder *)user_data, MAX(latency, 0) / (gint64)GST_USECOND);
+    return GST_PAD_PROBE_OK;
+}
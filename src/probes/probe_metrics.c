@@ -0,0 +1,33 @@
+#include "gstnvdsmeta.h"
+
+#include "probes/probe_metrics.h"
+
+GstPadProbeReturn probe_count_source_frames(GstPad *pad,
+                                            GstPadProbeInfo *info,
+                                            gpointer user_data)
+{
+    (void)pad;
+
+    SourceFrameCounters *counters = (SourceFrameCounters *)user_data;
+    GstBuffer *buf = (GstBuffer *)info->data;
+    NvDsBatchMeta *batch_meta = gst_buffer_get_nvds_batch_meta(buf);
+    if (!counters || !batch_meta)
+        return GST_PAD_PROBE_OK;
+
+    for (NvDsMetaList *l_frame = batch_meta->frame_meta_list; l_frame != NULL;
+         l_frame = l_frame->next) {
+        guint source = ((NvDsFrameMeta *)l_frame->data)->source_id;
+        if (source >= PROBE_METRICS_MAX_SOURCES)
+            continue;
+        /* Registration locks, but only on the first frame of each source. */
+        if (G_UNLIKELY(!counters->frames[source])) {
+            gchar label[16];
+            g_snprintf(label, sizeof(label), "%u", source);
+            counters->frames[source] = metrics_counter("traffic_guard_frames_total",
+                                                       "Frames out of the muxer per source.",
+                                                       "source", label, TRUE);
+        }
+        metrics_counter_add(counters->frames[source], 1);
+    }
+    return GST_PAD_PROBE_OK;
+}
@@ -0,0 +1,15 @@
+#include "gstnvdsmeta.h"
+
+#include "probes/probe_msg_shed.h"
+#include "msg_shed.h"
+
+GstPadProbeReturn probe_msg_shed(GstPad *pad,
+                                 GstPadProbeInfo *info,
+                                 gpointer user_data)
+{
+    (void)pad;
+    NvDsBatchMeta *batch_meta = gst_buffer_get_nvds_batch_meta((GstBuffer *)info->data);
+    if (user_data && batch_meta)
+        msg_shed_batch((MsgShed *)user_data, batch_meta);
+    return GST_PAD_PROBE_OK;
+}
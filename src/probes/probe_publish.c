@@ -0,0 +1,46 @@
+#include "gstnvdsmeta.h"
+#include "nvdsmeta_schema.h"
+
+#include "probes/probe_publish.h"
+#include "mqtt_publisher.h"
+#include "msg_pool.h"
+#include "logger.h"
+
+GstPadProbeReturn probe_publish(GstPad *pad,
+                                GstPadProbeInfo *info,
+                                gpointer user_data)
+{
+    (void)pad;
+    MqttPublisher *publisher = (MqttPublisher *)user_data;
+    NvDsBatchMeta *batch_meta = gst_buffer_get_nvds_batch_meta((GstBuffer *)info->data);
+    if (!publisher || !batch_meta)
+        return GST_PAD_PROBE_OK;
+
+    for (NvDsMetaList *l_frame = batch_meta->frame_meta_list; l_frame; l_frame = l_frame->next) {
+        NvDsFrameMeta *frame_meta = (NvDsFrameMeta *)l_frame->data;
+        for (NvDsMetaList *l_user = frame_meta->frame_user_meta_list; l_user; l_user = l_user->next) {
+            NvDsUserMeta *user_meta = (NvDsUserMeta *)l_user->data;
+            if (user_meta->base_meta.meta_type != NVDS_CUSTOM_MSG_BLOB)
+                continue;
+            NvDsCustomMsgInfo *msg = (NvDsCustomMsgInfo *)user_meta->user_meta_data;
+            mqtt_publisher_post(publisher, msg->message, msg->size);
+        }
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+GstPadProbeReturn probe_publish_eos(GstPad *pad,
+                                    GstPadProbeInfo *info,
+                                    gpointer user_data)
+{
+    (void)pad;
+    ProbePublishEos *eos = (ProbePublishEos *)user_data;
+    if (!eos || GST_EVENT_TYPE(GST_PAD_PROBE_INFO_EVENT(info)) != GST_EVENT_EOS)
+        return GST_PAD_PROBE_OK;
+
+    NvDsCustomMsgInfo *msg = probe_send_take_blob(eos->send);
+    if (msg && !mqtt_publisher_post(eos->publisher, msg->message, msg->size))
+        log_warning("probe_publish: last blob dropped at EOS");
+    msg_pool_release(msg);
+    return GST_PAD_PROBE_OK;
+}
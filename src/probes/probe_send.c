@@ -1,4 +1,3 @@
-#include <string.h>
 #include <glib.h>
 
 #include "gstnvdsmeta.h"
@@ -6,6 +5,9 @@
 #include "nvdsmeta_schema.h"
 
 #include "probes/probe_send.h"
+#include "msg_pool.h"
+#include "payload_encoder.h"
+#include "logger.h"
 
 #define PGIE_CLASS_ID_VEHICLE 0
 
@@ -13,111 +15,255 @@ static gpointer meta_copy_func(gpointer data, gpointer user_data)
 {
     (void)user_data;
     NvDsUserMeta *user_meta = (NvDsUserMeta *)data;
-    NvDsCustomMsgInfo *src = (NvDsCustomMsgInfo *)user_meta->user_meta_data;
-    NvDsCustomMsgInfo *dst = (NvDsCustomMsgInfo *)g_memdup2(src,
-                                                             sizeof(NvDsCustomMsgInfo));
-    if (src->message)
-        dst->message = (gpointer)g_strdup((const char *)src->message);
-    dst->size = src->size;
-    return dst;
+    return msg_pool_copy((NvDsCustomMsgInfo *)user_meta->user_meta_data);
 }
 
 static void meta_free_func(gpointer data, gpointer user_data)
 {
     (void)user_data;
     NvDsUserMeta *user_meta = (NvDsUserMeta *)data;
-    NvDsCustomMsgInfo *src = (NvDsCustomMsgInfo *)user_meta->user_meta_data;
-    if (src->message)
-        g_free(src->message);
-    src->size = 0;
-    g_free(user_meta->user_meta_data);
+    msg_pool_release((NvDsCustomMsgInfo *)user_meta->user_meta_data);
+    user_meta->user_meta_data = NULL;
 }
 
-static gchar *build_payload(guint64 id, gchar *brand, gchar *type,
-                             gchar *plate)
+typedef struct {
+    ProbeSendContext     *ctx;
+    const PayloadEncoder *encoder;
+    const FrameIndex     *index;
+    NvDsBatchMeta        *batch_meta;
+    NvDsFrameMeta        *frame_meta;
+} FrameTarget;
+
+typedef struct {
+    const PayloadEncoder *encoder;
+    const PayloadEvent   *event;
+} EncodeJob;
+
+static gsize write_payload(gchar *buf, gsize size, gpointer user_data)
 {
-    gchar *safe_id    = g_strdup_printf("%" G_GUINT64_FORMAT, id);
-    const gchar *sb   = brand ? brand : "NULL";
-    const gchar *st   = type  ? type  : "NULL";
-    const gchar *sp   = plate ? plate : "NULL";
-    gchar *payload = g_strconcat("Vehicle ID: ", safe_id,
-                                 ", Brand: ", sb,
-                                 ", Type: ", st,
-                                 ", Plate: ", sp, NULL);
-    g_free(safe_id);
-    return payload;
+    const EncodeJob *job = (const EncodeJob *)user_data;
+    return job->encoder->encode(job->event, buf, size);
 }
 
-GstPadProbeReturn probe_send(GstPad *pad,
-                             GstPadProbeInfo *info,
-                             gpointer user_data)
+/*
+ * The object of source_id as frame_num saw it, with the consensus labels where
+ * it has them; view holds their storage.  e is that frame's entry, if any.
+ */
+static void describe(const FrameTarget *target, const FrameIndexObject *e, guint source_id,
+                     gint64 frame_num, guint64 object_id, PayloadEvent *event, TrackConsensusView *view)
 {
-    (void)pad;
-    (void)user_data;
+    *event = (PayloadEvent){
+        .object_id    = object_id,
+        .source_id    = source_id,
+        .frame_num    = frame_num,
+        .timestamp_ns = target->frame_meta->ntp_timestamp,
+        .confidence   = -1.0f,
+        .brand_conf   = -1.0f,
+        .type_conf    = -1.0f,
+        .plate_conf   = -1.0f,
+    };
+    if (e) {
+        const NvOSD_RectParams *r = &e->obj->rect_params;
+        event->has_bbox   = TRUE;
+        event->left       = r->left;
+        event->top        = r->top;
+        event->width      = r->width;
+        event->height     = r->height;
+        event->confidence = e->obj->confidence;
+        event->brand      = e->brand;
+        event->type       = e->type;
+        event->plate      = e->plate;
+        if (e->brand) event->brand_conf = e->brand_prob;
+        if (e->type)  event->type_conf  = e->type_prob;
+        if (e->plate) event->plate_conf = e->plate_prob;
+    }
+    if (target->ctx->consensus &&
+        track_consensus_lookup(target->ctx->consensus, source_id, object_id, view)) {
+        if (view->brand[0]) {
+            event->brand      = view->brand;
+            event->brand_conf = view->share[CONSENSUS_BRAND];
+        }
+        if (view->type[0]) {
+            event->type      = view->type;
+            event->type_conf = view->share[CONSENSUS_TYPE];
+        }
+        if (view->plate[0]) {
+            event->plate      = view->plate;
+            event->plate_conf = view->share[CONSENSUS_PLATE];
+        }
+    }
+}
 
-    GstBuffer *buf = (GstBuffer *)info->data;
-    NvDsBatchMeta *batch_meta = gst_buffer_get_nvds_batch_meta(buf);
-    NvDsMetaList *l_frame = NULL;
-    NvDsMetaList *l_obj = NULL;
+static void attach(const FrameTarget *target, NvDsCustomMsgInfo *msg, MsgPriority priority)
+{
+    if (!msg)
+        return;
+    msg_pool_set_priority(msg, priority);
 
-    for (l_frame = batch_meta->frame_meta_list; l_frame != NULL;
-         l_frame = l_frame->next) {
-        NvDsFrameMeta *frame_meta = (NvDsFrameMeta *)(l_frame->data);
+    NvDsUserMeta *user_meta = nvds_acquire_user_meta_from_pool(target->batch_meta);
+    if (!user_meta) {
+        msg_pool_release(msg);
+        return;
+    }
+    user_meta->user_meta_data         = (void *)msg;
+    user_meta->base_meta.meta_type    = NVDS_CUSTOM_MSG_BLOB;
+    user_meta->base_meta.copy_func    = (NvDsMetaCopyFunc)meta_copy_func;
+    user_meta->base_meta.release_func = (NvDsMetaReleaseFunc)meta_free_func;
+    nvds_add_user_meta_to_frame(target->frame_meta, user_meta);
+    metrics_counter_add(target->ctx->messages, 1);
+}
 
-        for (l_obj = frame_meta->obj_meta_list; l_obj != NULL;
-             l_obj = l_obj->next) {
-            NvDsObjectMeta *obj = (NvDsObjectMeta *)(l_obj->data);
+/* Encoded straight into a pooled block. */
+static void attach_message(const FrameTarget *target, const PayloadEvent *event, MsgPriority priority)
+{
+    EncodeJob job = { target->encoder, event };
+    attach(target, msg_pool_write(target->ctx->pool, write_payload, &job), priority);
+}
 
-            if (obj->class_id != PGIE_CLASS_ID_VEHICLE)
-                continue;
-            if (obj->unique_component_id != 1 && obj->unique_component_id != 4)
-                continue;
+static gsize write_blob(gchar *buf, gsize size, gpointer user_data)
+{
+    return payload_blob_write((const PayloadBlob *)user_data, buf, size);
+}
+
+/* The open blob goes out on this frame as one message, at the priority of its most urgent event. */
+static void flush_blob(const FrameTarget *target)
+{
+    ProbeSendContext *ctx = target->ctx;
+    if (!payload_blob_count(ctx->blob))
+        return;
+    attach(target, msg_pool_write(ctx->pool, write_blob, ctx->blob), ctx->blob_priority);
+    payload_blob_reset(ctx->blob);
+}
+
+static void send_event(const FrameTarget *target, const PayloadEvent *event, MsgPriority priority)
+{
+    ProbeSendContext *ctx = target->ctx;
+    if (!ctx->blob) {
+        attach_message(target, event, priority);
+        return;
+    }
+    if (!payload_blob_add(ctx->blob, event)) {
+        flush_blob(target);
+        if (!payload_blob_add(ctx->blob, event)) {
+            /* Larger than a blob on its own. */
+            attach_message(target, event, priority);
+            return;
+        }
+    }
+    if (payload_blob_count(ctx->blob) == 1) {
+        ctx->blob_priority  = priority;
+        ctx->blob_opened_us = g_get_monotonic_time();
+    } else {
+        ctx->blob_priority = MAX(ctx->blob_priority, priority);
+    }
+}
+
+/* A track's labels may be from earlier frames; their confidence is known only when this frame agrees. */
+static void track_label(const gchar **label, gfloat *conf, const gchar *track_label)
+{
+    if (g_strcmp0(*label, track_label) != 0)
+        *conf = -1.0f;
+    *label = track_label;
+}
+
+static MsgPriority event_priority(const TrackInfo *track, TrackEvent event)
+{
+    switch (event) {
+    case TRACK_EVENT_NEW:       return MSG_PRIORITY_HIGH;
+    case TRACK_EVENT_CHANGED:   return track->plate_changed ? MSG_PRIORITY_HIGH : MSG_PRIORITY_NORMAL;
+    case TRACK_EVENT_HEARTBEAT: return MSG_PRIORITY_LOW;
+    default:                    return MSG_PRIORITY_NORMAL;
+    }
+}
+
+static void emit_track(const TrackInfo *track, TrackEvent event, gpointer user_data)
+{
+    const FrameTarget *target = (const FrameTarget *)user_data;
+    const FrameIndexObject *e = NULL;
+    /* The expiry sweep covers every source, so a lost track is reported where it was last seen. */
+    gint64 frame_num = track->last_seen;
+    if (event != TRACK_EVENT_LOST) {
+        e = frame_index_find_car(target->index, track->object_id);
+        if (!e)
+            e = frame_index_find_plate(target->index, track->object_id);
+        frame_num = target->frame_meta->frame_num;
+    }
 
-            gchar *brand = NULL, *type = NULL, *plate = NULL;
-            NvDsClassifierMetaList *l_class = NULL;
-            for (l_class = obj->classifier_meta_list; l_class != NULL;
-                 l_class = l_class->next) {
-                NvDsClassifierMeta *cm = (NvDsClassifierMeta *)(l_class->data);
-                NvDsLabelInfoList *l_label = NULL;
-                for (l_label = cm->label_info_list; l_label != NULL;
-                     l_label = l_label->next) {
-                    NvDsLabelInfo *li = (NvDsLabelInfo *)(l_label->data);
-                    switch (cm->unique_component_id) {
-                        case 2: brand = g_strdup(li->result_label); break;
-                        case 3: type  = g_strdup(li->result_label); break;
-                        case 5: plate = g_strdup(li->result_label); break;
-                        default: break;
-                    }
-                }
-            }
-
-            NvDsUserMeta *user_meta =
-                nvds_acquire_user_meta_from_pool(batch_meta);
-            NvDsCustomMsgInfo *msg =
-                (NvDsCustomMsgInfo *)g_malloc0(sizeof(NvDsCustomMsgInfo));
-
-            gchar *payload = build_payload(obj->object_id, brand, type, plate);
-            msg->size    = (guint)strlen(payload);
-            msg->message = g_strdup(payload);
-            g_free(payload);
-
-            if (user_meta) {
-                user_meta->user_meta_data = (void *)msg;
-                user_meta->base_meta.meta_type    = NVDS_CUSTOM_MSG_BLOB;
-                user_meta->base_meta.copy_func    =
-                    (NvDsMetaCopyFunc)meta_copy_func;
-                user_meta->base_meta.release_func =
-                    (NvDsMetaReleaseFunc)meta_free_func;
-                nvds_add_user_meta_to_frame(frame_meta, user_meta);
-            } else {
-                g_free(msg->message);
-                g_free(msg);
-            }
-
-            g_free(brand);
-            g_free(type);
-            g_free(plate);
+    PayloadEvent payload;
+    TrackConsensusView view;
+    describe(target, e, track->source_id, frame_num, track->object_id, &payload, &view);
+    payload.event     = event;
+    track_label(&payload.brand, &payload.brand_conf, track->brand);
+    track_label(&payload.type,  &payload.type_conf,  track->type);
+    track_label(&payload.plate, &payload.plate_conf, track->plate);
+    send_event(target, &payload, event_priority(track, event));
+}
+
+void probe_send(const FrameIndex *index, gpointer user_data)
+{
+    ProbeSendContext *ctx = (ProbeSendContext *)user_data;
+    if (!ctx || !ctx->pool)
+        return;
+
+    static const gint components[] = { GIE_ID_VEHICLE_DETECTOR, GIE_ID_PLATE_DETECTOR };
+    FrameTarget target = {
+        .ctx        = ctx,
+        .encoder    = ctx->encoder ? ctx->encoder : payload_encoder_lookup("text"),
+        .index      = index,
+        .batch_meta = frame_index_batch_meta(index),
+        .frame_meta = frame_index_frame_meta(index),
+    };
+
+    if (ctx->tracks && atomic_exchange_explicit(&ctx->track_timing_changed, FALSE, memory_order_acquire))
+        track_state_set_timing(ctx->tracks,
+                               atomic_load_explicit(&ctx->next_heartbeat_frames, memory_order_relaxed),
+                               atomic_load_explicit(&ctx->next_lost_frames, memory_order_relaxed));
+
+    /* Car and plate share an object_id after tracker matching, so they merge into one track. */
+    if (ctx->tracks)
+        track_state_begin_frame(ctx->tracks, target.frame_meta->source_id,
+                                target.frame_meta->frame_num, emit_track, &target);
+
+    for (guint c = 0; c < G_N_ELEMENTS(components); c++) {
+        const FrameIndexBucket *bucket = frame_index_bucket(index, components[c]);
+        for (guint i = 0; i < bucket->n; i++) {
+            const FrameIndexObject *e = &bucket->items[i];
+            if (e->obj->class_id != PGIE_CLASS_ID_VEHICLE)
+                continue;
+            PayloadEvent event;
+            TrackConsensusView view;
+            describe(&target, e, target.frame_meta->source_id, target.frame_meta->frame_num,
+                     e->obj->object_id, &event, &view);
+            if (ctx->tracks)
+                track_state_observe(ctx->tracks, e->obj->object_id, event.brand, event.type, event.plate);
+            else
+                send_event(&target, &event, MSG_PRIORITY_LOW);
         }
     }
-    return GST_PAD_PROBE_OK;
+
+    if (ctx->tracks)
+        track_state_end_frame(ctx->tracks, emit_track, &target);
+
+    if (ctx->blob && payload_blob_count(ctx->blob) &&
+        (!ctx->blob_window_ms ||
+         g_get_monotonic_time() - ctx->blob_opened_us >= (gint64)ctx->blob_window_ms * G_TIME_SPAN_MILLISECOND))
+        flush_blob(&target);
+}
+
+NvDsCustomMsgInfo *probe_send_take_blob(ProbeSendContext *ctx)
+{
+    if (!ctx || !ctx->blob || !payload_blob_count(ctx->blob))
+        return NULL;
+    NvDsCustomMsgInfo *msg = msg_pool_write(ctx->pool, write_blob, ctx->blob);
+    payload_blob_reset(ctx->blob);
+    if (msg)
+        msg_pool_set_priority(msg, ctx->blob_priority);
+    return msg;
+}
+
+void probe_send_set_track_timing(ProbeSendContext *ctx, guint heartbeat_frames, guint lost_after_frames)
+{
+    atomic_store_explicit(&ctx->next_heartbeat_frames, heartbeat_frames, memory_order_relaxed);
+    atomic_store_explicit(&ctx->next_lost_frames, lost_after_frames, memory_order_relaxed);
+    atomic_store_explicit(&ctx->track_timing_changed, TRUE, memory_order_release);
 }
@@ -0,0 +1,210 @@
+#include "run_report.h"
+
+#include <time.h>
+
+#include "gstnvdsmeta.h"
+
+#include "element_util.h"
+#include "logger.h"
+
+/* Batches timed inside one element at once; a batch past that is not timed there. */
+#define IN_FLIGHT 16
+/* An entry whose batch never left (dropped, or held past this) stops waiting. */
+#define IN_FLIGHT_TTL_NS (10 * 1000000000ull)
+
+/* A batch by its first frame, as buffer_trace.c keys frames; elements that copy into a new buffer keep both. */
+typedef struct {
+    guint64 pts;
+    guint   source;
+} BatchKey;
+
+typedef struct {
+    BatchKey key;
+    guint64  in_ns;   /* 0: free */
+} InFlight;
+
+typedef struct {
+    gchar   *name;
+    GMutex   lock;   /* src runs on the element's own thread when it has one */
+    InFlight in_flight[IN_FLIGHT];
+    guint    next;
+    guint64  batches;
+    guint64  total_ns;
+    guint64  expired;
+} Stage;
+
+struct RunReport {
+    GPtrArray *stages;     /* upstream first */
+    GMutex     lock;       /* sinks run on threads of their own */
+    guint64    start_ns;   /* first batch out of the muxer */
+    guint64    end_ns;     /* last batch into a sink */
+    guint64    frames;
+    guint64    batches;
+};
+
+static inline guint64 clock_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (guint64)ts.tv_sec * 1000000000ull + (guint64)ts.tv_nsec;
+}
+
+static void stage_free(gpointer data)
+{
+    Stage *stage = (Stage *)data;
+    g_mutex_clear(&stage->lock);
+    g_free(stage->name);
+    g_free(stage);
+}
+
+/* FALSE when the buffer has no usable timestamp. */
+static gboolean batch_key(GstBuffer *buf, BatchKey *key)
+{
+    NvDsBatchMeta *batch_meta = gst_buffer_get_nvds_batch_meta(buf);
+    if (batch_meta && batch_meta->frame_meta_list) {
+        const NvDsFrameMeta *frame_meta = batch_meta->frame_meta_list->data;
+        *key = (BatchKey){ frame_meta->buf_pts, frame_meta->source_id };
+    } else {
+        *key = (BatchKey){ GST_BUFFER_PTS(buf), 0 };
+    }
+    return GST_CLOCK_TIME_IS_VALID(key->pts);
+}
+
+static GstPadProbeReturn stage_in(GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+    (void)pad;
+    Stage *stage = (Stage *)user_data;
+    BatchKey key;
+    if (!batch_key(GST_PAD_PROBE_INFO_BUFFER(info), &key))
+        return GST_PAD_PROBE_OK;
+    guint64 now = clock_ns();
+    g_mutex_lock(&stage->lock);
+    InFlight *f = &stage->in_flight[stage->next];
+    if (f->in_ns)
+        stage->expired++;
+    *f = (InFlight){ key, now };
+    stage->next = (stage->next + 1) % IN_FLIGHT;
+    g_mutex_unlock(&stage->lock);
+    return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn stage_out(GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+    (void)pad;
+    Stage *stage = (Stage *)user_data;
+    BatchKey key;
+    if (!batch_key(GST_PAD_PROBE_INFO_BUFFER(info), &key))
+        return GST_PAD_PROBE_OK;
+    guint64 now = clock_ns();
+    g_mutex_lock(&stage->lock);
+    for (guint i = 0; i < IN_FLIGHT; i++) {
+        InFlight *f = &stage->in_flight[i];
+        if (!f->in_ns)
+            continue;
+        if (now - f->in_ns > IN_FLIGHT_TTL_NS) {
+            f->in_ns = 0;
+            stage->expired++;
+        } else if (f->key.pts == key.pts && f->key.source == key.source) {
+            stage->batches++;
+            stage->total_ns += now - f->in_ns;
+            f->in_ns = 0;
+            break;
+        }
+    }
+    g_mutex_unlock(&stage->lock);
+    return GST_PAD_PROBE_OK;
+}
+
+/* The muxer's src runs on one thread, and nothing reads the counts until the run is over. */
+static GstPadProbeReturn count_batch(GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+    (void)pad;
+    RunReport *report = (RunReport *)user_data;
+    NvDsBatchMeta *batch_meta = gst_buffer_get_nvds_batch_meta(GST_PAD_PROBE_INFO_BUFFER(info));
+    if (!report->batches)
+        report->start_ns = clock_ns();
+    report->batches++;
+    report->frames += batch_meta ? batch_meta->num_frames_in_batch : 1;
+    return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn sink_in(GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+    (void)pad;
+    (void)info;
+    RunReport *report = (RunReport *)user_data;
+    guint64 now = clock_ns();
+    g_mutex_lock(&report->lock);
+    report->end_ns = MAX(report->end_ns, now);
+    g_mutex_unlock(&report->lock);
+    return GST_PAD_PROBE_OK;
+}
+
+static void watch_element(RunReport *report, GstElement *element)
+{
+    GstPad *sink = gst_element_get_static_pad(element, "sink");
+    GstPad *src  = gst_element_get_static_pad(element, "src");
+    if (g_strcmp0(GST_ELEMENT_NAME(element), "muxer") == 0 && src) {
+        gst_pad_add_probe(src, GST_PAD_PROBE_TYPE_BUFFER, count_batch, report, NULL);
+    } else if (sink && src) {
+        Stage *stage = g_new0(Stage, 1);
+        stage->name = g_strdup(GST_ELEMENT_NAME(element));
+        g_mutex_init(&stage->lock);
+        gst_pad_add_probe(sink, GST_PAD_PROBE_TYPE_BUFFER, stage_in,  stage, NULL);
+        gst_pad_add_probe(src,  GST_PAD_PROBE_TYPE_BUFFER, stage_out, stage, NULL);
+        g_ptr_array_add(report->stages, stage);
+    } else if (sink && GST_OBJECT_FLAG_IS_SET(element, GST_ELEMENT_FLAG_SINK)) {
+        gst_pad_add_probe(sink, GST_PAD_PROBE_TYPE_BUFFER, sink_in, report, NULL);
+    }
+    if (sink) gst_object_unref(sink);
+    if (src)  gst_object_unref(src);
+}
+
+RunReport *run_report_new(GstElement *pipeline)
+{
+    if (!GST_IS_BIN(pipeline))
+        return NULL;
+
+    RunReport *report = g_new0(RunReport, 1);
+    report->stages = g_ptr_array_new_with_free_func(stage_free);
+    g_mutex_init(&report->lock);
+
+    /* Sorted sinks first; reversed below so stages log in stream order. */
+    GPtrArray *elements = element_util_collect(gst_bin_iterate_sorted(GST_BIN(pipeline)));
+
+    /* The bin holds the elements for as long as the pipeline exists. */
+    for (guint i = elements->len; i > 0; i--)
+        watch_element(report, elements->pdata[i - 1]);
+    g_ptr_array_free(elements, TRUE);
+    return report;
+}
+
+void run_report_free(RunReport *report)
+{
+    if (!report)
+        return;
+    g_ptr_array_unref(report->stages);
+    g_mutex_clear(&report->lock);
+    g_free(report);
+}
+
+void run_report_log(RunReport *report)
+{
+    if (!report)
+        return;
+    gdouble seconds = report->end_ns > report->start_ns
+                    ? (report->end_ns - report->start_ns) / 1e9 : 0.0;
+    log_info("run: %" G_GUINT64_FORMAT " frames in %" G_GUINT64_FORMAT " batches, %.3f s, %.1f fps",
+             report->frames, report->batches, seconds,
+             seconds > 0 ? report->frames / seconds : 0.0);
+    for (guint i = 0; i < report->stages->len; i++) {
+        const Stage *stage = report->stages->pdata[i];
+        if (!stage->batches)
+            continue;
+        log_info("run:   %-24s %10" G_GUINT64_FORMAT " batches %10.3f ms/batch",
+                 stage->name, stage->batches, stage->total_ns / 1e6 / stage->batches);
+        if (stage->expired)
+            log_info("run:   %-24s %10" G_GUINT64_FORMAT " batches in without a match out",
+                     stage->name, stage->expired);
+    }
+}
@@ -0,0 +1,85 @@
+#include "source_bin.h"
+#include "logger.h"
+
+static GstElement *make(const gchar *factory, const gchar *kind, guint index)
+{
+    gchar *name = g_strdup_printf("%s-%u", kind, index);
+    GstElement *elem = gst_element_factory_make(factory, name);
+    if (!elem)
+        log_error("source_bin: failed to create '%s' (factory '%s')", name, factory);
+    g_free(name);
+    return elem;
+}
+
+GstElement *source_bin_new(guint index, const SourceSpec *spec, const gchar *decoder_factory)
+{
+    GstElement *source  = make("filesrc",       "file-source", index);
+    GstElement *parser  = make("h264parse",     "h264-parser", index);
+    GstElement *decoder = make(decoder_factory, "decoder",     index);
+    if (!source || !parser || !decoder) {
+        if (source)  gst_object_unref(source);
+        if (parser)  gst_object_unref(parser);
+        if (decoder) gst_object_unref(decoder);
+        return NULL;
+    }
+    g_object_set(G_OBJECT(source), "location", spec->location, NULL);
+
+    gchar *name = g_strdup_printf("source-bin-%u", index);
+    GstElement *bin = gst_bin_new(name);
+    g_free(name);
+    gst_bin_add_many(GST_BIN(bin), source, parser, decoder, NULL);
+    if (!gst_element_link_many(source, parser, decoder, NULL)) {
+        log_error("source_bin: failed to link source %u (%s)", index, spec->name);
+        gst_object_unref(bin);
+        return NULL;
+    }
+
+    GstPad *decoder_src = gst_element_get_static_pad(decoder, "src");
+    gst_element_add_pad(bin, gst_ghost_pad_new("src", decoder_src));
+    gst_object_unref(decoder_src);
+    return bin;
+}
+
+gboolean source_bin_append(GstElement *source_bin, GstElement *element)
+{
+    GstPad *ghost  = gst_element_get_static_pad(source_bin, "src");
+    GstPad *target = gst_ghost_pad_get_target(GST_GHOST_PAD(ghost));
+    GstPad *sink   = gst_element_get_static_pad(element, "sink");
+    GstPad *src    = gst_element_get_static_pad(element, "src");
+
+    gst_bin_add(GST_BIN(source_bin), element);
+    gboolean ok = sink && src && gst_pad_link(target, sink) == GST_PAD_LINK_OK &&
+                  gst_ghost_pad_set_target(GST_GHOST_PAD(ghost), src);
+    if (!ok)
+        log_error("source_bin: failed to append %s to %s", GST_ELEMENT_NAME(element),
+                  GST_ELEMENT_NAME(source_bin));
+
+    if (src)  gst_object_unref(src);
+    if (sink) gst_object_unref(sink);
+    gst_object_unref(target);
+    gst_object_unref(ghost);
+    return ok;
+}
+
+gboolean source_bin_link(GstElement *source_bin, GstElement *muxer, guint index)
+{
+    gchar pad_name[16];
+    g_snprintf(pad_name, sizeof(pad_name), "sink_%u", index);
+
+    GstPad *sinkpad = gst_element_request_pad_simple(muxer, pad_name);
+    if (!sinkpad) {
+        log_error("source_bin: failed to request %s from %s", pad_name, GST_ELEMENT_NAME(muxer));
+        return FALSE;
+    }
+    GstPad *srcpad = gst_element_get_static_pad(source_bin, "src");
+    GstPadLinkReturn link_ret = srcpad ? gst_pad_link(srcpad, sinkpad) : GST_PAD_LINK_REFUSED;
+    if (srcpad)
+        gst_object_unref(srcpad);
+    gst_object_unref(sinkpad);
+    if (link_ret != GST_PAD_LINK_OK) {
+        log_error("source_bin: failed to link %s → %s:%s", GST_ELEMENT_NAME(source_bin),
+                  GST_ELEMENT_NAME(muxer), pad_name);
+        return FALSE;
+    }
+    return TRUE;
+}
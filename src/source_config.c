@@ -0,0 +1,91 @@
+#include "source_config.h"
+#include "yaml_util.h"
+#include "logger.h"
+
+static gboolean add_source(GArray *items, yaml_document_t *doc, yaml_node_t *entry)
+{
+    const gchar *location = yaml_util_scalar(yaml_util_get(doc, entry, "location"));
+    if (!location || !location[0]) {
+        log_error("source_config: source %u has no location", items->len);
+        return FALSE;
+    }
+    const gchar *name = yaml_util_scalar(yaml_util_get(doc, entry, "name"));
+
+    SourceSpec spec = {
+        .name     = name && name[0] ? g_strdup(name) : g_strdup_printf("source-%u", items->len),
+        .location = g_strdup(location),
+    };
+    g_array_append_val(items, spec);
+    return TRUE;
+}
+
+static gboolean collect_sources(GArray *items, yaml_document_t *doc)
+{
+    yaml_node_t *root = yaml_document_get_root_node(doc);
+    yaml_node_t *list = yaml_util_get(doc, root, "sources");
+
+    if (!list) {
+        yaml_node_t *single = yaml_util_get(doc, root, "source");
+        if (!single) {
+            log_error("source_config: neither sources: nor source: is set");
+            return FALSE;
+        }
+        return add_source(items, doc, single);
+    }
+
+    if (list->type != YAML_SEQUENCE_NODE) {
+        log_error("source_config: sources: must be a list");
+        return FALSE;
+    }
+    for (yaml_node_item_t *item = list->data.sequence.items.start;
+         item < list->data.sequence.items.top; item++) {
+        if (items->len == SOURCE_CONFIG_MAX_SOURCES) {
+            log_error("source_config: more than %u sources", SOURCE_CONFIG_MAX_SOURCES);
+            return FALSE;
+        }
+        if (!add_source(items, doc, yaml_document_get_node(doc, *item)))
+            return FALSE;
+    }
+    if (items->len == 0) {
+        log_error("source_config: sources: is empty");
+        return FALSE;
+    }
+    return TRUE;
+}
+
+SourceList *source_list_parse(yaml_document_t *doc)
+{
+    GArray *items = g_array_new(FALSE, FALSE, sizeof(SourceSpec));
+    gboolean ok = collect_sources(items, doc);
+
+    SourceList *sources = g_new0(SourceList, 1);
+    sources->n     = items->len;
+    sources->items = (SourceSpec *)g_array_free(items, FALSE);
+    if (!ok) {
+        source_list_free(sources);
+        return NULL;
+    }
+    return sources;
+}
+
+SourceList *source_list_load(const char *yaml_path)
+{
+    yaml_document_t doc;
+    if (!yaml_util_load(yaml_path, &doc, "source_config"))
+        return NULL;
+    SourceList *sources = source_list_parse(&doc);
+    yaml_document_delete(&doc);
+    return sources;
+}
+
+void source_list_free(SourceList *sources)
+{
+    if (!sources)
+        return;
+    for (guint i = 0; i < sources->n; i++) {
+        g_free(sources->items[i].name);
+        g_free(sources->items[i].location);
+    }
+    g_free(sources->items);
+    g_free(sources);
+}
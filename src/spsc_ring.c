@@ -0,0 +1,80 @@
+#include <stdatomic.h>
+
+#include "spsc_ring.h"
+
+#define CACHE_LINE 64
+
+struct SpscRing {
+    guint8 *slots;
+    gsize   slot_size;
+    guint   mask;
+
+    /* Free-running counters; head and tail live on separate cache lines. */
+    _Alignas(CACHE_LINE) atomic_uint head;
+    _Alignas(CACHE_LINE) atomic_uint tail;
+};
+
+SpscRing *spsc_ring_new(guint capacity, gsize slot_size)
+{
+    guint size = 1;
+    while (size < capacity)
+        size <<= 1;
+
+    SpscRing *ring = g_new0(SpscRing, 1);
+    ring->slot_size = slot_size;
+    ring->mask      = size - 1;
+    ring->slots     = g_malloc0((gsize)size * slot_size);
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    return ring;
+}
+
+void spsc_ring_free(SpscRing *ring)
+{
+    if (!ring)
+        return;
+    g_free(ring->slots);
+    g_free(ring);
+}
+
+guint spsc_ring_capacity(const SpscRing *ring)
+{
+    return ring->mask + 1;
+}
+
+guint spsc_ring_count(const SpscRing *ring)
+{
+    guint head = atomic_load_explicit(&((SpscRing *)ring)->head, memory_order_acquire);
+    guint tail = atomic_load_explicit(&((SpscRing *)ring)->tail, memory_order_acquire);
+    return head - tail;
+}
+
+gpointer spsc_ring_reserve(SpscRing *ring)
+{
+    guint head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    guint tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - tail > ring->mask)
+        return NULL;
+    return ring->slots + (gsize)(head & ring->mask) * ring->slot_size;
+}
+
+void spsc_ring_commit(SpscRing *ring)
+{
+    guint head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+gpointer spsc_ring_peek(SpscRing *ring)
+{
+    guint tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    guint head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (head == tail)
+        return NULL;
+    return ring->slots + (gsize)(tail & ring->mask) * ring->slot_size;
+}
+
+void spsc_ring_release(SpscRing *ring)
+{
+    guint tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
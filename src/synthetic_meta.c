@@ -0,0 +1,99 @@
+#include "synthetic_meta.h"
+#include "frame_index.h"
+
+static void add_label(NvDsBatchMeta *batch_meta, NvDsObjectMeta *obj,
+                      gint component_id, const gchar *text, gfloat prob)
+{
+    NvDsClassifierMeta *cm = nvds_acquire_classifier_meta_from_pool(batch_meta);
+    cm->unique_component_id = component_id;
+    cm->num_labels = 1;
+
+    NvDsLabelInfo *li = nvds_acquire_label_info_meta_from_pool(batch_meta);
+    g_strlcpy(li->result_label, text, sizeof(li->result_label));
+    li->result_prob = prob;
+    nvds_add_label_info_meta_to_classifier(cm, li);
+    nvds_add_classifier_meta_to_object(obj, cm);
+}
+
+static NvDsObjectMeta *add_object(NvDsBatchMeta *batch_meta, NvDsFrameMeta *frame_meta,
+                                  NvDsObjectMeta *parent, gint component_id,
+                                  guint64 object_id, GRand *rand)
+{
+    NvDsObjectMeta *obj = nvds_acquire_obj_meta_from_pool(batch_meta);
+    obj->unique_component_id = component_id;
+    obj->class_id            = 0;
+    obj->object_id           = object_id;
+    obj->confidence          = (gfloat)g_rand_double_range(rand, 0.3, 1.0);
+    if (parent) {
+        obj->rect_params.left   = parent->rect_params.left + parent->rect_params.width * 0.3f;
+        obj->rect_params.top    = parent->rect_params.top + parent->rect_params.height * 0.7f;
+        obj->rect_params.width  = parent->rect_params.width * 0.4f;
+        obj->rect_params.height = parent->rect_params.height * 0.15f;
+    } else {
+        obj->rect_params.left   = (gfloat)g_rand_int_range(rand, 0, 1700);
+        obj->rect_params.top    = (gfloat)g_rand_int_range(rand, 0, 950);
+        obj->rect_params.width  = (gfloat)g_rand_int_range(rand, 60, 220);
+        obj->rect_params.height = (gfloat)g_rand_int_range(rand, 40, 130);
+    }
+    nvds_add_obj_meta_to_frame(frame_meta, obj, parent);
+    return obj;
+}
+
+static void plate_text(gchar *out, gsize len, GRand *rand)
+{
+    static const gchar alphabet[] = "ABCDEFGHJKLMNPRSTUVWXYZ0123456789";
+    gsize n = MIN(len - 1, 7);
+    for (gsize i = 0; i < n; i++)
+        out[i] = alphabet[g_rand_int_range(rand, 0, (gint32)sizeof(alphabet) - 1)];
+    out[n] = '\0';
+}
+
+void synthetic_meta_add_frame(NvDsBatchMeta *batch_meta, const SyntheticMetaParams *params,
+                              guint source_id, guint frame_num, GRand *rand)
+{
+    guint cardinality = MAX(params->label_cardinality, 1);
+    NvDsFrameMeta *frame_meta = nvds_acquire_frame_meta_from_pool(batch_meta);
+    frame_meta->source_id = source_id;
+    frame_meta->pad_index = source_id;
+    frame_meta->batch_id  = batch_meta->num_frames_in_batch;
+    frame_meta->frame_num = frame_num;
+    nvds_add_frame_meta_to_batch(batch_meta, frame_meta);
+
+    /* SGIE LPDNet appends plates after every car is in the list, as in the pipeline. */
+    guint n_cars = (guint)((gdouble)params->objects_per_frame / (1.0 + params->plate_ratio) + 0.5);
+    n_cars = MAX(MIN(n_cars, params->objects_per_frame), 1);
+    NvDsObjectMeta **cars = g_new(NvDsObjectMeta *, n_cars);
+
+    for (guint i = 0; i < n_cars; i++) {
+        gchar label[32];
+        cars[i] = add_object(batch_meta, frame_meta, NULL, GIE_ID_VEHICLE_DETECTOR,
+                             (guint64)source_id * 100000 + i + 1, rand);
+        g_snprintf(label, sizeof(label), "make_%u", g_rand_int_range(rand, 0, (gint32)cardinality));
+        add_label(batch_meta, cars[i], GIE_ID_VEHICLE_MAKE, label, 0.9f);
+        g_snprintf(label, sizeof(label), "type_%u", g_rand_int_range(rand, 0, (gint32)cardinality));
+        add_label(batch_meta, cars[i], GIE_ID_VEHICLE_TYPE, label, 0.8f);
+    }
+
+    guint n_plates = params->objects_per_frame > n_cars ? params->objects_per_frame - n_cars : 0;
+    for (guint i = 0; i < n_plates; i++) {
+        gchar text[16];
+        NvDsObjectMeta *car = cars[i % n_cars];
+        NvDsObjectMeta *plate = add_object(batch_meta, frame_meta, car,
+                                           GIE_ID_PLATE_DETECTOR, car->object_id, rand);
+        plate_text(text, sizeof(text), rand);
+        add_label(batch_meta, plate, GIE_ID_PLATE_READER, text, 0.7f);
+    }
+    g_free(cars);
+}
+
+NvDsBatchMeta *synthetic_meta_new(const SyntheticMetaParams *params)
+{
+    GRand *rand = g_rand_new_with_seed(params->seed);
+    NvDsBatchMeta *batch_meta = nvds_create_batch_meta(params->batch_size);
+
+    for (guint f = 0; f < params->batch_size; f++)
+        synthetic_meta_add_frame(batch_meta, params, f, 0, rand);
+
+    g_rand_free(rand);
+    return batch_meta;
+}
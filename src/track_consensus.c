@@ -0,0 +1,353 @@
+#include <string.h>
+
+#include "track_consensus.h"
+#include "logger.h"
+
+#define SOURCE_CLOCKS 64
+
+typedef struct {
+    gchar  text[TRACK_CONSENSUS_LABEL_MAX];
+    gfloat weight;                /* 0 marks a free candidate */
+} Candidate;
+
+typedef struct {
+    Candidate cand[TRACK_CONSENSUS_CANDIDATES];
+    gfloat    total;
+    guint32   votes;
+} Ballot;
+
+typedef struct {
+    guint64 object_id;
+    guint32 source_id;
+    guint8  used;
+    guint8  stable;
+    gint64  last_seen;
+    gint64  stable_since;
+    Ballot  ballots[CONSENSUS_N_ATTRS];
+} Track;
+
+struct TrackConsensus {
+    TrackConsensusOptions options;
+    GMutex   lock;
+    Track   *slots;
+    guint    mask;
+    guint    count;
+    guint    n_stable;
+    guint    hand;
+    guint    sweep_step;
+    gint64   now[SOURCE_CLOCKS];
+    TrackConsensusStats stats;
+};
+
+static inline guint hash_key(guint64 object_id, guint source_id)
+{
+    guint64 h = object_id ^ ((guint64)source_id * 0x9e3779b97f4a7c15ull);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return (guint)h;
+}
+
+TrackConsensus *track_consensus_new(const TrackConsensusOptions *options)
+{
+    TrackConsensus *tc = g_new0(TrackConsensus, 1);
+    tc->options = *options;
+    if (tc->options.max_tracks == 0)
+        tc->options.max_tracks = 1;
+    g_mutex_init(&tc->lock);
+
+    guint size = 16;
+    while (size < 2 * tc->options.max_tracks)
+        size <<= 1;
+    tc->slots = g_new0(Track, size);
+    tc->mask  = size - 1;
+
+    guint ttl = MAX(tc->options.ttl_frames, 1);
+    tc->sweep_step = MAX(16u, (size + ttl - 1) / ttl);
+    return tc;
+}
+
+void track_consensus_free(TrackConsensus *tc)
+{
+    if (!tc)
+        return;
+    log_info("track_consensus: %" G_GUINT64_FORMAT " votes, %" G_GUINT64_FORMAT
+             " car-frames skipped by SGIEs, %" G_GUINT64_FORMAT " rechecks, %u tracks (%u stable), %"
+             G_GUINT64_FORMAT " expired, %" G_GUINT64_FORMAT " evicted",
+             tc->stats.votes, tc->stats.masked, tc->stats.rechecks,
+             tc->count, tc->n_stable, tc->stats.expired, tc->stats.evicted);
+    g_mutex_clear(&tc->lock);
+    g_free(tc->slots);
+    g_free(tc);
+}
+
+static Track *lookup(TrackConsensus *tc, guint64 object_id, guint source_id)
+{
+    guint i = hash_key(object_id, source_id) & tc->mask;
+    for (;;) {
+        Track *t = &tc->slots[i];
+        if (!t->used)
+            return NULL;
+        if (t->object_id == object_id && t->source_id == source_id)
+            return t;
+        i = (i + 1) & tc->mask;
+    }
+}
+
+static void remove_at(TrackConsensus *tc, guint hole)
+{
+    if (tc->slots[hole].stable)
+        tc->n_stable--;
+    guint i = hole;
+    for (;;) {
+        i = (i + 1) & tc->mask;
+        Track *t = &tc->slots[i];
+        if (!t->used)
+            break;
+        guint home = hash_key(t->object_id, t->source_id) & tc->mask;
+        if (((i - home) & tc->mask) >= ((i - hole) & tc->mask)) {
+            tc->slots[hole] = *t;
+            hole = i;
+        }
+    }
+    tc->slots[hole].used = 0;
+    tc->count--;
+}
+
+static gboolean expired(const TrackConsensus *tc, const Track *t)
+{
+    guint ttl = tc->options.ttl_frames;
+    return ttl && tc->now[t->source_id % SOURCE_CLOCKS] - t->last_seen >= (gint64)ttl;
+}
+
+static void advance(TrackConsensus *tc, guint source_id, gint64 frame_num)
+{
+    gint64 *now = &tc->now[source_id % SOURCE_CLOCKS];
+    if (*now == frame_num)
+        return;
+    *now = frame_num;
+
+    for (guint n = 0; n < tc->sweep_step && tc->count > 0; n++) {
+        guint i = tc->hand;
+        if (tc->slots[i].used && expired(tc, &tc->slots[i])) {
+            remove_at(tc, i);
+            tc->stats.expired++;
+            continue;
+        }
+        tc->hand = (i + 1) & tc->mask;
+    }
+}
+
+static Track *find_or_insert(TrackConsensus *tc, guint source_id, guint64 object_id)
+{
+    Track *t = lookup(tc, object_id, source_id);
+    if (t)
+        return t;
+
+    if (tc->count >= tc->options.max_tracks) {
+        /* Evict whatever the hand finds first that was not seen this frame. */
+        gboolean evicted = FALSE;
+        for (guint n = 0; n <= tc->mask && !evicted; n++) {
+            guint i = tc->hand;
+            tc->hand = (i + 1) & tc->mask;
+            Track *old = &tc->slots[i];
+            if (old->used && old->last_seen != tc->now[old->source_id % SOURCE_CLOCKS]) {
+                remove_at(tc, i);
+                tc->stats.evicted++;
+                evicted = TRUE;
+            }
+        }
+        if (!evicted)
+            return NULL;
+    }
+
+    guint i = hash_key(object_id, source_id) & tc->mask;
+    while (tc->slots[i].used)
+        i = (i + 1) & tc->mask;
+    t = &tc->slots[i];
+    memset(t, 0, sizeof(*t));
+    t->used      = 1;
+    t->object_id = object_id;
+    t->source_id = source_id;
+    t->last_seen = tc->now[source_id % SOURCE_CLOCKS];
+    tc->count++;
+    return t;
+}
+
+/* Space-saving: a new label with every slot taken replaces the lightest and inherits its weight. */
+static void cast(Ballot *b, const gchar *label, gfloat weight)
+{
+    gint free_slot = -1, lightest = 0;
+    b->votes++;
+    b->total += weight;
+    for (gint i = 0; i < TRACK_CONSENSUS_CANDIDATES; i++) {
+        Candidate *c = &b->cand[i];
+        if (c->weight > 0.0f && strncmp(c->text, label, TRACK_CONSENSUS_LABEL_MAX - 1) == 0) {
+            c->weight += weight;
+            return;
+        }
+        if (c->weight == 0.0f && free_slot < 0)
+            free_slot = i;
+        if (c->weight < b->cand[lightest].weight)
+            lightest = i;
+    }
+    Candidate *c = &b->cand[free_slot >= 0 ? free_slot : lightest];
+    g_strlcpy(c->text, label, sizeof(c->text));
+    c->weight += weight;
+}
+
+static const Candidate *winner(const Ballot *b)
+{
+    const Candidate *best = NULL;
+    for (gint i = 0; i < TRACK_CONSENSUS_CANDIDATES; i++) {
+        const Candidate *c = &b->cand[i];
+        if (c->weight > 0.0f && (!best || c->weight > best->weight))
+            best = c;
+    }
+    return best;
+}
+
+static gboolean ballot_stable(const TrackConsensus *tc, const Ballot *b)
+{
+    const Candidate *w = winner(b);
+    return w && b->votes >= tc->options.min_votes &&
+           w->weight >= tc->options.min_share * b->total;
+}
+
+static void update_stable(TrackConsensus *tc, Track *t)
+{
+    gboolean stable = ballot_stable(tc, &t->ballots[CONSENSUS_BRAND]) &&
+                      ballot_stable(tc, &t->ballots[CONSENSUS_TYPE]) &&
+                      (!tc->options.require_plate || ballot_stable(tc, &t->ballots[CONSENSUS_PLATE]));
+    if (stable && !t->stable) {
+        t->stable_since = t->last_seen;
+        tc->n_stable++;
+    } else if (!stable && t->stable) {
+        tc->n_stable--;
+    }
+    t->stable = stable;
+}
+
+static void vote_locked(TrackConsensus *tc, guint source_id, guint64 object_id,
+                        ConsensusAttr attr, const gchar *label, gfloat prob)
+{
+    Track *t = find_or_insert(tc, source_id, object_id);
+    if (!t)
+        return;
+    t->last_seen = tc->now[source_id % SOURCE_CLOCKS];
+    if (!label || !label[0])
+        return;
+    cast(&t->ballots[attr], label, CLAMP(prob, 0.01f, 1.0f));
+    tc->stats.votes++;
+    update_stable(tc, t);
+}
+
+void track_consensus_advance(TrackConsensus *tc, guint source_id, gint64 frame_num)
+{
+    g_mutex_lock(&tc->lock);
+    advance(tc, source_id, frame_num);
+    g_mutex_unlock(&tc->lock);
+}
+
+void track_consensus_vote(TrackConsensus *tc, guint source_id, guint64 object_id,
+                          ConsensusAttr attr, const gchar *label, gfloat prob)
+{
+    g_mutex_lock(&tc->lock);
+    vote_locked(tc, source_id, object_id, attr, label, prob);
+    g_mutex_unlock(&tc->lock);
+}
+
+void track_consensus_vote_frame(TrackConsensus *tc, const FrameIndex *index)
+{
+    NvDsFrameMeta *frame_meta = frame_index_frame_meta(index);
+    guint source_id = frame_meta->source_id;
+    const FrameIndexBucket *cars   = frame_index_bucket(index, GIE_ID_VEHICLE_DETECTOR);
+    const FrameIndexBucket *plates = frame_index_bucket(index, GIE_ID_PLATE_DETECTOR);
+
+    g_mutex_lock(&tc->lock);
+    advance(tc, source_id, frame_meta->frame_num);
+    for (guint i = 0; i < cars->n; i++) {
+        const FrameIndexObject *e = &cars->items[i];
+        guint64 id = e->obj->object_id;
+        /* A car with no labels this frame still refreshes its track. */
+        vote_locked(tc, source_id, id, CONSENSUS_BRAND, e->brand, e->brand_prob);
+        if (e->type)
+            vote_locked(tc, source_id, id, CONSENSUS_TYPE, e->type, e->type_prob);
+    }
+    for (guint i = 0; i < plates->n; i++) {
+        const FrameIndexObject *e = &plates->items[i];
+        if (e->plate)
+            vote_locked(tc, source_id, e->obj->object_id, CONSENSUS_PLATE, e->plate, e->plate_prob);
+    }
+    g_mutex_unlock(&tc->lock);
+}
+
+gboolean track_consensus_lookup(TrackConsensus *tc, guint source_id, guint64 object_id,
+                                TrackConsensusView *view)
+{
+    g_mutex_lock(&tc->lock);
+    const Track *t = lookup(tc, object_id, source_id);
+    if (t) {
+        gchar *out[CONSENSUS_N_ATTRS] = { view->brand, view->type, view->plate };
+        for (gint a = 0; a < CONSENSUS_N_ATTRS; a++) {
+            const Ballot *b = &t->ballots[a];
+            const Candidate *w = winner(b);
+            g_strlcpy(out[a], w ? w->text : "", TRACK_CONSENSUS_LABEL_MAX);
+            view->share[a] = (w && b->total > 0.0f) ? w->weight / b->total : 0.0f;
+        }
+        view->stable = t->stable;
+    }
+    g_mutex_unlock(&tc->lock);
+    return t != NULL;
+}
+
+guint track_consensus_gate_frame(TrackConsensus *tc, NvDsFrameMeta *frame_meta)
+{
+    guint masked = 0;
+    guint recheck = tc->options.recheck_frames;
+
+    g_mutex_lock(&tc->lock);
+    if (tc->n_stable == 0) {
+        g_mutex_unlock(&tc->lock);
+        return 0;
+    }
+    for (NvDsMetaList *l_obj = frame_meta->obj_meta_list; l_obj != NULL;
+         l_obj = l_obj->next) {
+        NvDsObjectMeta *obj = (NvDsObjectMeta *)(l_obj->data);
+        if (obj->unique_component_id != GIE_ID_VEHICLE_DETECTOR ||
+            obj->class_id < 0 || obj->class_id >= TRACK_CONSENSUS_CLASS_OFFSET)
+            continue;
+        const Track *t = lookup(tc, obj->object_id, frame_meta->source_id);
+        if (!t || !t->stable)
+            continue;
+        if (recheck && (frame_meta->frame_num - t->stable_since) % recheck == 0) {
+            tc->stats.rechecks++;
+            continue;
+        }
+        obj->class_id += TRACK_CONSENSUS_CLASS_OFFSET;
+        masked++;
+    }
+    tc->stats.masked += masked;
+    g_mutex_unlock(&tc->lock);
+    return masked;
+}
+
+void track_consensus_restore_frame(NvDsFrameMeta *frame_meta)
+{
+    for (NvDsMetaList *l_obj = frame_meta->obj_meta_list; l_obj != NULL;
+         l_obj = l_obj->next) {
+        NvDsObjectMeta *obj = (NvDsObjectMeta *)(l_obj->data);
+        if (obj->unique_component_id == GIE_ID_VEHICLE_DETECTOR &&
+            obj->class_id >= TRACK_CONSENSUS_CLASS_OFFSET)
+            obj->class_id -= TRACK_CONSENSUS_CLASS_OFFSET;
+    }
+}
+
+void track_consensus_get_stats(TrackConsensus *tc, TrackConsensusStats *stats)
+{
+    g_mutex_lock(&tc->lock);
+    *stats = tc->stats;
+    stats->tracks = tc->count;
+    stats->stable = tc->n_stable;
+    g_mutex_unlock(&tc->lock);
+}
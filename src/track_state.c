@@ -0,0 +1,313 @@
+#include <string.h>
+
+#include "track_state.h"
+#include "logger.h"
+
+#define DIRTY_LABELS 0x1
+#define DIRTY_PLATE  0x2
+
+typedef struct {
+    guint64 object_id;
+    guint32 source_id;
+    guint8  used;
+    guint8  dirty;          /* DIRTY_* attributes changed since the last emission */
+    guint8  announced;      /* NEW has been emitted */
+    guint32 frame_tick;     /* tick of the frame that last observed it */
+    gint64  last_seen;      /* in its source's frame numbers */
+    gint64  last_emitted;
+    gchar   brand[TRACK_STATE_LABEL_MAX];
+    gchar   type[TRACK_STATE_LABEL_MAX];
+    gchar   plate[TRACK_STATE_LABEL_MAX];
+} Track;
+
+struct TrackState {
+    TrackStateOptions options;
+    Track   *slots;
+    guint    mask;
+    guint    count;
+    guint    hand;           /* clock hand for expiry and eviction */
+    guint    sweep_step;
+
+    guint32  tick;           /* incremented per begin_frame; 0 is never a live tick */
+    guint    source_id;
+    gint64   now[TRACK_STATE_MAX_SOURCES];
+
+    /* Tracks observed in the current frame, by key; re-looked-up at end_frame. */
+    guint64 *touched;
+    guint    n_touched;
+
+    TrackStateStats stats;
+};
+
+static inline guint hash_key(guint64 object_id, guint source_id)
+{
+    guint64 h = object_id ^ ((guint64)source_id * 0x9e3779b97f4a7c15ull);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return (guint)h;
+}
+
+static inline gint64 source_now(const TrackState *state, guint source_id)
+{
+    return state->now[source_id % TRACK_STATE_MAX_SOURCES];
+}
+
+/* A full turn of the hand every lost_after_frames frames. */
+static void set_sweep_step(TrackState *state)
+{
+    guint size = state->mask + 1;
+    guint lost = MAX(state->options.lost_after_frames, 1);
+    state->sweep_step = MAX(16u, (size + lost - 1) / lost);
+}
+
+TrackState *track_state_new(const TrackStateOptions *options)
+{
+    TrackState *state = g_new0(TrackState, 1);
+    state->options = *options;
+    if (state->options.max_tracks == 0)
+        state->options.max_tracks = 1;
+
+    /* At most half full keeps probe sequences short. */
+    guint size = 16;
+    while (size < 2 * state->options.max_tracks)
+        size <<= 1;
+    state->slots = g_new0(Track, size);
+    state->mask  = size - 1;
+
+    set_sweep_step(state);
+
+    state->touched = g_new(guint64, state->options.max_tracks);
+    state->stats.max_tracks = state->options.max_tracks;
+    return state;
+}
+
+void track_state_free(TrackState *state)
+{
+    if (!state)
+        return;
+    const TrackStateStats *st = &state->stats;
+    log_info("track_state: %" G_GUINT64_FORMAT " observations, %" G_GUINT64_FORMAT " suppressed, "
+             "emitted new %" G_GUINT64_FORMAT " changed %" G_GUINT64_FORMAT
+             " heartbeat %" G_GUINT64_FORMAT " lost %" G_GUINT64_FORMAT
+             ", %" G_GUINT64_FORMAT " evicted, %" G_GUINT64_FORMAT " overflowed",
+             st->observed, st->suppressed,
+             st->emitted[TRACK_EVENT_NEW], st->emitted[TRACK_EVENT_CHANGED],
+             st->emitted[TRACK_EVENT_HEARTBEAT], st->emitted[TRACK_EVENT_LOST],
+             st->evicted, st->overflow);
+    g_free(state->slots);
+    g_free(state->touched);
+    g_free(state);
+}
+
+static Track *lookup(TrackState *state, guint64 object_id, guint source_id)
+{
+    guint i = hash_key(object_id, source_id) & state->mask;
+    for (;;) {
+        Track *t = &state->slots[i];
+        if (!t->used)
+            return NULL;
+        if (t->object_id == object_id && t->source_id == source_id)
+            return t;
+        i = (i + 1) & state->mask;
+    }
+}
+
+/* Backward-shift deletion: pull later members of the probe run into the hole. */
+static void remove_at(TrackState *state, guint hole)
+{
+    guint i = hole;
+    for (;;) {
+        i = (i + 1) & state->mask;
+        Track *t = &state->slots[i];
+        if (!t->used)
+            break;
+        guint home = hash_key(t->object_id, t->source_id) & state->mask;
+        /* Movable when home does not lie cyclically in (hole, i]. */
+        if (((i - home) & state->mask) >= ((i - hole) & state->mask)) {
+            state->slots[hole] = *t;
+            hole = i;
+        }
+    }
+    state->slots[hole].used = 0;
+    state->count--;
+}
+
+static void fill_info(const Track *t, TrackInfo *info)
+{
+    info->object_id = t->object_id;
+    info->source_id = t->source_id;
+    info->last_seen = t->last_seen;
+    info->brand     = t->brand[0] ? t->brand : NULL;
+    info->type      = t->type[0]  ? t->type  : NULL;
+    info->plate     = t->plate[0] ? t->plate : NULL;
+    info->plate_changed = (t->dirty & DIRTY_PLATE) != 0;
+}
+
+static gboolean expired(const TrackState *state, const Track *t)
+{
+    guint lost = state->options.lost_after_frames;
+    return lost && source_now(state, t->source_id) - t->last_seen >= (gint64)lost;
+}
+
+static void sweep(TrackState *state, TrackStateEmitFunc lost, gpointer user_data)
+{
+    for (guint n = 0; n < state->sweep_step && state->count > 0; n++) {
+        guint i = state->hand;
+        Track *t = &state->slots[i];
+        if (t->used && expired(state, t)) {
+            if (lost) {
+                TrackInfo info;
+                fill_info(t, &info);
+                lost(&info, TRACK_EVENT_LOST, user_data);
+            }
+            state->stats.emitted[TRACK_EVENT_LOST]++;
+            remove_at(state, i);
+            /* The slot may now hold a shifted track; look at it again. */
+            continue;
+        }
+        state->hand = (i + 1) & state->mask;
+    }
+}
+
+/* Table full: drop the first track the hand finds that was not observed this frame. */
+static gboolean evict_one(TrackState *state)
+{
+    for (guint n = 0; n <= state->mask; n++) {
+        guint i = state->hand;
+        state->hand = (i + 1) & state->mask;
+        Track *t = &state->slots[i];
+        if (t->used && t->frame_tick != state->tick) {
+            remove_at(state, i);
+            state->stats.evicted++;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+void track_state_begin_frame(TrackState        *state,
+                             guint              source_id,
+                             gint64             frame_num,
+                             TrackStateEmitFunc lost,
+                             gpointer           user_data)
+{
+    if (++state->tick == 0) {
+        /* Stale ticks could alias the new ones; clear them once every 2^32 frames. */
+        for (guint i = 0; i <= state->mask; i++)
+            state->slots[i].frame_tick = 0;
+        state->tick = 1;
+    }
+    state->source_id = source_id;
+    state->now[source_id % TRACK_STATE_MAX_SOURCES] = frame_num;
+    state->n_touched = 0;
+    sweep(state, lost, user_data);
+}
+
+static gboolean merge_label(gchar *stored, const gchar *label)
+{
+    if (!label || !label[0])
+        return FALSE;
+    if (strncmp(stored, label, TRACK_STATE_LABEL_MAX - 1) == 0)
+        return FALSE;
+    g_strlcpy(stored, label, TRACK_STATE_LABEL_MAX);
+    return TRUE;
+}
+
+void track_state_observe(TrackState  *state,
+                         guint64      object_id,
+                         const gchar *brand,
+                         const gchar *type,
+                         const gchar *plate)
+{
+    guint source_id = state->source_id;
+    state->stats.observed++;
+
+    Track *t = lookup(state, object_id, source_id);
+    if (!t) {
+        if (state->count >= state->options.max_tracks && !evict_one(state)) {
+            state->stats.overflow++;
+            return;
+        }
+        guint i = hash_key(object_id, source_id) & state->mask;
+        while (state->slots[i].used)
+            i = (i + 1) & state->mask;
+        t = &state->slots[i];
+        memset(t, 0, sizeof(*t));
+        t->used      = 1;
+        t->object_id = object_id;
+        t->source_id = source_id;
+        state->count++;
+    }
+
+    t->last_seen = source_now(state, source_id);
+    if (merge_label(t->brand, brand)) t->dirty |= DIRTY_LABELS;
+    if (merge_label(t->type, type))   t->dirty |= DIRTY_LABELS;
+    if (merge_label(t->plate, plate)) t->dirty |= DIRTY_PLATE;
+
+    if (t->frame_tick != state->tick) {
+        t->frame_tick = state->tick;
+        state->touched[state->n_touched++] = object_id;
+    }
+}
+
+void track_state_end_frame(TrackState        *state,
+                           TrackStateEmitFunc emit,
+                           gpointer           user_data)
+{
+    gint64 now = source_now(state, state->source_id);
+    guint heartbeat = state->options.heartbeat_frames;
+
+    for (guint k = 0; k < state->n_touched; k++) {
+        Track *t = lookup(state, state->touched[k], state->source_id);
+        if (!t)
+            continue;
+
+        TrackEvent event = TRACK_EVENT_NONE;
+        if (!t->announced)
+            event = TRACK_EVENT_NEW;
+        else if (t->dirty)
+            event = TRACK_EVENT_CHANGED;
+        else if (heartbeat && now - t->last_emitted >= (gint64)heartbeat)
+            event = TRACK_EVENT_HEARTBEAT;
+
+        if (event == TRACK_EVENT_NONE) {
+            state->stats.suppressed++;
+            continue;
+        }
+        if (emit) {
+            TrackInfo info;
+            fill_info(t, &info);
+            emit(&info, event, user_data);
+        }
+        t->announced    = 1;
+        t->dirty        = 0;
+        t->last_emitted = now;
+        state->stats.emitted[event]++;
+    }
+    state->n_touched = 0;
+}
+
+void track_state_set_timing(TrackState *state, guint heartbeat_frames, guint lost_after_frames)
+{
+    state->options.heartbeat_frames  = heartbeat_frames;
+    state->options.lost_after_frames = lost_after_frames;
+    set_sweep_step(state);
+}
+
+void track_state_get_stats(const TrackState *state, TrackStateStats *stats)
+{
+    *stats = state->stats;
+    stats->tracks = state->count;
+}
+
+const char *track_event_name(TrackEvent event)
+{
+    switch (event) {
+    case TRACK_EVENT_NEW:       return "new";
+    case TRACK_EVENT_CHANGED:   return "changed";
+    case TRACK_EVENT_HEARTBEAT: return "heartbeat";
+    case TRACK_EVENT_LOST:      return "lost";
+    default:                    return "none";
+    }
+}
@@ -0,0 +1,53 @@
+#include <stdio.h>
+#include <sys/stat.h>
+
+#include "yaml_util.h"
+#include "logger.h"
+
+gboolean yaml_util_load(const char *yaml_path, yaml_document_t *doc, const gchar *component)
+{
+    FILE *f = fopen(yaml_path, "rb");
+    if (!f) {
+        log_error("%s: cannot open %s", component, yaml_path);
+        return FALSE;
+    }
+
+    yaml_parser_t parser;
+    yaml_parser_initialize(&parser);
+    yaml_parser_set_input_file(&parser, f);
+    gboolean loaded = yaml_parser_load(&parser, doc) != 0;
+    if (!loaded)
+        log_error("%s: %s:%zu: %s", component, yaml_path, parser.problem_mark.line + 1,
+                  parser.problem ? parser.problem : "parse error");
+    yaml_parser_delete(&parser);
+    fclose(f);
+    return loaded;
+}
+
+void yaml_util_stamp(const char *yaml_path, gint64 *mtime_ns, gint64 *size)
+{
+    struct stat st;
+    if (stat(yaml_path, &st) != 0) {
+        *mtime_ns = *size = -1;
+        return;
+    }
+    *mtime_ns = (gint64)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    *size     = (gint64)st.st_size;
+}
+
+const gchar *yaml_util_scalar(yaml_node_t *node)
+{
+    return (node && node->type == YAML_SCALAR_NODE) ? (const gchar *)node->data.scalar.value : NULL;
+}
+
+yaml_node_t *yaml_util_get(yaml_document_t *doc, yaml_node_t *map, const gchar *key)
+{
+    if (!map || map->type != YAML_MAPPING_NODE)
+        return NULL;
+    for (yaml_node_pair_t *pair = map->data.mapping.pairs.start;
+         pair < map->data.mapping.pairs.top; pair++) {
+        if (g_strcmp0(yaml_util_scalar(yaml_document_get_node(doc, pair->key)), key) == 0)
+            return yaml_document_get_node(doc, pair->value);
+    }
+    return NULL;
+}
@@ -0,0 +1,166 @@
+/*
+ * deteval: detection and LPR metrics against COCO ground truth, the native
+ * counterpart of scripts/metrics/compute_detection_metrics.py with the same
+ * options, printout and --output JSON.
+ *
+ *   deteval [--coco PATH] [--detections-dir DIR] [--frame-offset N]
+ *           [--source-id N] [--detection-width W] [--detection-height H]
+ *           [--iou-threshold T] [--output PATH] [--threads N]
+ *
+ * Paths default to data/annotations/instances_default.json and logs/detections
+ * under the current directory.
+ */
+#include <errno.h>
+#include <getopt.h>
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "detection_eval.h"
+
+enum {
+    OPT_COCO = 256,
+    OPT_DETECTIONS_DIR,
+    OPT_FRAME_OFFSET,
+    OPT_SOURCE_ID,
+    OPT_DETECTION_WIDTH,
+    OPT_DETECTION_HEIGHT,
+    OPT_IOU_THRESHOLD,
+    OPT_OUTPUT,
+    OPT_THREADS,
+};
+
+static const struct option long_options[] = {
+    { "coco",             required_argument, NULL, OPT_COCO },
+    { "detections-dir",   required_argument, NULL, OPT_DETECTIONS_DIR },
+    { "frame-offset",     required_argument, NULL, OPT_FRAME_OFFSET },
+    { "source-id",        required_argument, NULL, OPT_SOURCE_ID },
+    { "detection-width",  required_argument, NULL, OPT_DETECTION_WIDTH },
+    { "detection-height", required_argument, NULL, OPT_DETECTION_HEIGHT },
+    { "iou-threshold",    required_argument, NULL, OPT_IOU_THRESHOLD },
+    { "output",           required_argument, NULL, OPT_OUTPUT },
+    { "threads",          required_argument, NULL, OPT_THREADS },
+    { "help",             no_argument,       NULL, 'h' },
+    { NULL, 0, NULL, 0 },
+};
+
+static int usage(void)
+{
+    fprintf(stderr,
+            "usage: deteval [--coco PATH] [--detections-dir DIR] [--frame-offset N]\n"
+            "               [--source-id N] [--detection-width W] [--detection-height H]\n"
+            "               [--iou-threshold T] [--output PATH] [--threads N]\n");
+    return 2;
+}
+
+static int arg_int(const char *name, const char *text, long long *out)
+{
+    char *end;
+    errno = 0;
+    *out = strtoll(text, &end, 10);
+    if (errno != 0 || end == text || *end != '\0') {
+        fprintf(stderr, "deteval: --%s: invalid int value: '%s'\n", name, text);
+        return -1;
+    }
+    return 0;
+}
+
+/* mkdir -p of path's parent. */
+static int make_parent_dirs(const char *path)
+{
+    char dir[4096];
+    snprintf(dir, sizeof(dir), "%s", path);
+    char *slash = strrchr(dir, '/');
+    if (!slash || slash == dir)
+        return 0;
+    *slash = '\0';
+    for (char *p = dir + 1; *p; p++) {
+        if (*p != '/')
+            continue;
+        *p = '\0';
+        if (mkdir(dir, 0755) != 0 && errno != EEXIST)
+            return -1;
+        *p = '/';
+    }
+    return mkdir(dir, 0755) != 0 && errno != EEXIST ? -1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    /* Plate texts are upper-cased per code point, beyond ASCII too. */
+    if (!setlocale(LC_CTYPE, "C.UTF-8"))
+        setlocale(LC_CTYPE, "");
+
+    const char *coco = "data/annotations/instances_default.json";
+    const char *detections_dir = "logs/detections";
+    const char *output = NULL;
+    DetEvalOptions options;
+    deteval_options_init(&options);
+
+    int c;
+    long long v;
+    while ((c = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+        const char *name = c >= OPT_COCO ? long_options[c - OPT_COCO].name : NULL;
+        switch (c) {
+        case OPT_COCO:           coco = optarg; break;
+        case OPT_DETECTIONS_DIR: detections_dir = optarg; break;
+        case OPT_OUTPUT:         output = optarg; break;
+        case OPT_FRAME_OFFSET:
+        case OPT_SOURCE_ID:
+        case OPT_DETECTION_WIDTH:
+        case OPT_DETECTION_HEIGHT:
+        case OPT_THREADS:
+            if (arg_int(name, optarg, &v) != 0)
+                return 2;
+            if (c == OPT_FRAME_OFFSET)
+                options.frame_offset = v;
+            else if (c == OPT_SOURCE_ID)
+                options.source_id = v;
+            else if (c == OPT_DETECTION_WIDTH)
+                options.det_width = (int)v;
+            else if (c == OPT_DETECTION_HEIGHT)
+                options.det_height = (int)v;
+            else
+                options.threads = v > 0 ? (unsigned)v : 0;
+            break;
+        case OPT_IOU_THRESHOLD: {
+            char *end;
+            options.iou_threshold = strtod(optarg, &end);
+            if (end == optarg || *end != '\0') {
+                fprintf(stderr, "deteval: --%s: invalid float value: '%s'\n", name, optarg);
+                return 2;
+            }
+            break;
+        }
+        default:
+            return usage();
+        }
+    }
+    if (optind < argc)
+        return usage();
+
+    DetEvalResult result;
+    char err[512];
+    if (deteval_run(coco, detections_dir, &options, &result, err, sizeof(err)) != 0) {
+        fprintf(stderr, "%s\n", err);
+        return 1;
+    }
+    deteval_print_summary(&result, stdout);
+
+    if (output) {
+        FILE *fp = make_parent_dirs(output) == 0 ? fopen(output, "w") : NULL;
+        if (!fp) {
+            fprintf(stderr, "deteval: %s: %s\n", output, strerror(errno));
+            return 1;
+        }
+        deteval_write_json(&result, fp);
+        if (fclose(fp) != 0) {
+            fprintf(stderr, "deteval: %s: %s\n", output, strerror(errno));
+            return 1;
+        }
+        printf("\nWrote summary to %s\n", output);
+    }
+    return 0;
+}
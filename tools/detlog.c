@@ -0,0 +1,207 @@
+/*
+ * detlog: inspect binary detection segments written with DETECTION_OUTPUT_FORMAT=binary.
+ *
+ *   detlog info   PATH...                  segment summary
+ *   detlog cat    PATH...                  all frames in detections.txt text form
+ *   detlog frame  PATH FRAME [SOURCE]      one frame as legacy detection lines
+ *   detlog export PATH OUT_DIR [SOURCE]    legacy frame_NNNNNN.txt files for compute_detection_metrics.py
+ *
+ * PATH is a segment file or a directory of detections_NNNNNN.tgdl segments.
+ */
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "detection_log_reader.h"
+
+typedef struct {
+    char  **paths;
+    size_t  count;
+} PathList;
+
+static int cmp_str(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static void path_list_add(PathList *list, const char *path)
+{
+    list->paths = realloc(list->paths, (list->count + 1) * sizeof(char *));
+    if (!list->paths) {
+        perror("detlog");
+        exit(1);
+    }
+    list->paths[list->count++] = strdup(path);
+}
+
+/* Expands directories into their segments, sorted by name (= write order). */
+static void collect_segments(PathList *list, const char *path)
+{
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        fprintf(stderr, "detlog: %s: %s\n", path, strerror(errno));
+        exit(1);
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        path_list_add(list, path);
+        return;
+    }
+
+    DIR *dir = opendir(path);
+    if (!dir) {
+        fprintf(stderr, "detlog: %s: %s\n", path, strerror(errno));
+        exit(1);
+    }
+    size_t first = list->count;
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        unsigned idx;
+        char tail;
+        if (sscanf(ent->d_name, "detections_%u.tgd%c", &idx, &tail) != 2 || tail != 'l')
+            continue;
+        char full[4096];
+        snprintf(full, sizeof(full), "%s/%s", path, ent->d_name);
+        path_list_add(list, full);
+    }
+    closedir(dir);
+    qsort(list->paths + first, list->count - first, sizeof(char *), cmp_str);
+}
+
+static DetLogSegment *open_or_die(const char *path)
+{
+    DetLogSegment *seg = detlog_segment_open(path);
+    if (!seg) {
+        fprintf(stderr, "detlog: %s: %s\n", path, strerror(errno));
+        exit(1);
+    }
+    return seg;
+}
+
+static int cmd_info(const PathList *list)
+{
+    for (size_t i = 0; i < list->count; i++) {
+        DetLogSegment *seg = open_or_die(list->paths[i]);
+        size_t n = detlog_segment_frame_count(seg);
+        unsigned long long records = 0;
+        DetLogFrame first = { 0 }, last = { 0 }, frame;
+        for (size_t f = 0; f < n; f++) {
+            if (detlog_segment_frame_at(seg, f, &frame) != 0)
+                continue;
+            if (f == 0)
+                first = frame;
+            last = frame;
+            records += frame.n_records;
+        }
+        printf("%s: segment %u, %s, %zu frames (%lld..%lld), %llu records\n",
+               list->paths[i], detlog_segment_index(seg),
+               detlog_segment_is_sealed(seg) ? "sealed" : "unsealed (index rebuilt)",
+               n, (long long)first.frame_num, (long long)last.frame_num, records);
+        detlog_segment_close(seg);
+    }
+    return 0;
+}
+
+static int cmd_cat(const PathList *list)
+{
+    for (size_t i = 0; i < list->count; i++) {
+        DetLogSegment *seg = open_or_die(list->paths[i]);
+        DetLogFrame frame;
+        for (size_t f = 0; f < detlog_segment_frame_count(seg); f++) {
+            if (detlog_segment_frame_at(seg, f, &frame) != 0)
+                continue;
+            printf("frame %lld %u\n", (long long)frame.frame_num, frame.source_id);
+            detlog_write_legacy_lines(seg, &frame, stdout);
+        }
+        detlog_segment_close(seg);
+    }
+    return 0;
+}
+
+static int cmd_frame(const PathList *list, long long frame_num, unsigned source_id)
+{
+    for (size_t i = 0; i < list->count; i++) {
+        DetLogSegment *seg = open_or_die(list->paths[i]);
+        DetLogFrame frame;
+        int found = detlog_segment_find_frame(seg, frame_num, source_id, &frame) == 0;
+        if (found)
+            detlog_write_legacy_lines(seg, &frame, stdout);
+        detlog_segment_close(seg);
+        if (found)
+            return 0;
+    }
+    fprintf(stderr, "detlog: frame %lld of source %u not found\n", frame_num, source_id);
+    return 1;
+}
+
+static int cmd_export(const PathList *list, const char *out_dir, unsigned source_id)
+{
+    if (mkdir(out_dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "detlog: %s: %s\n", out_dir, strerror(errno));
+        return 1;
+    }
+
+    unsigned long long written = 0;
+    for (size_t i = 0; i < list->count; i++) {
+        DetLogSegment *seg = open_or_die(list->paths[i]);
+        DetLogFrame frame;
+        for (size_t f = 0; f < detlog_segment_frame_count(seg); f++) {
+            if (detlog_segment_frame_at(seg, f, &frame) != 0 ||
+                frame.source_id != source_id)
+                continue;
+            char path[4096];
+            snprintf(path, sizeof(path), "%s/frame_%06lld.txt",
+                     out_dir, (long long)frame.frame_num);
+            FILE *fp = fopen(path, "w");
+            if (!fp) {
+                fprintf(stderr, "detlog: %s: %s\n", path, strerror(errno));
+                detlog_segment_close(seg);
+                return 1;
+            }
+            detlog_write_legacy_lines(seg, &frame, fp);
+            fclose(fp);
+            written++;
+        }
+        detlog_segment_close(seg);
+    }
+    printf("exported %llu frames of source %u to %s\n", written, source_id, out_dir);
+    return 0;
+}
+
+static int usage(void)
+{
+    fprintf(stderr,
+            "usage: detlog info   PATH...\n"
+            "       detlog cat    PATH...\n"
+            "       detlog frame  PATH FRAME [SOURCE]\n"
+            "       detlog export PATH OUT_DIR [SOURCE]\n");
+    return 2;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+        return usage();
+
+    const char *cmd = argv[1];
+    PathList list = { 0 };
+
+    if (strcmp(cmd, "info") == 0 || strcmp(cmd, "cat") == 0) {
+        for (int i = 2; i < argc; i++)
+            collect_segments(&list, argv[i]);
+        return strcmp(cmd, "info") == 0 ? cmd_info(&list) : cmd_cat(&list);
+    }
+    if (strcmp(cmd, "frame") == 0 && argc >= 4) {
+        collect_segments(&list, argv[2]);
+        return cmd_frame(&list, strtoll(argv[3], NULL, 10),
+                         argc > 4 ? (unsigned)strtoul(argv[4], NULL, 10) : 0);
+    }
+    if (strcmp(cmd, "export") == 0 && argc >= 4) {
+        collect_segments(&list, argv[2]);
+        return cmd_export(&list, argv[3],
+                          argc > 4 ? (unsigned)strtoul(argv[4], NULL, 10) : 0);
+    }
+    return usage();
+}